@@ -103,7 +103,7 @@ main(int argc, char **argv) {
 	dns_masterformat_t inputformat = dns_masterformat_text;
 	dns_masterformat_t outputformat = dns_masterformat_text;
 	dns_masterrawheader_t header;
-	uint32_t rawversion = 1, serialnum = 0;
+	uint32_t rawversion = DNS_RAWFORMAT_VERSION, serialnum = 0;
 	dns_ttl_t maxttl = 0;
 	bool snset = false;
 	bool logdump = false;
@@ -476,7 +476,7 @@ main(int argc, char **argv) {
 			outputformat = dns_masterformat_raw;
 			rawversion = strtol(outputformatstr + 4, &end, 10);
 			if (end == outputformatstr + 4 || *end != '\0' ||
-			    rawversion > 1U)
+			    rawversion > DNS_RAWFORMAT_MAXVERSION)
 			{
 				fprintf(stderr, "unknown raw format version\n");
 				exit(EXIT_FAILURE);
@@ -138,7 +138,7 @@ static char *tempfile = NULL;
 static const dns_master_style_t *masterstyle;
 static dns_masterformat_t inputformat = dns_masterformat_text;
 static dns_masterformat_t outputformat = dns_masterformat_text;
-static uint32_t rawversion = 1, serialnum = 0;
+static uint32_t rawversion = DNS_RAWFORMAT_VERSION, serialnum = 0;
 static bool snset = false;
 static atomic_uint_fast32_t nsigned = 0, nretained = 0, ndropped = 0;
 static atomic_uint_fast32_t nverified = 0, nverifyfailed = 0;
@@ -3799,7 +3799,7 @@ main(int argc, char *argv[]) {
 			outputformat = dns_masterformat_raw;
 			rawversion = strtol(outputformatstr + 4, &end, 10);
 			if (end == outputformatstr + 4 || *end != '\0' ||
-			    rawversion > 1U)
+			    rawversion > DNS_RAWFORMAT_MAXVERSION)
 			{
 				fprintf(stderr, "unknown raw format version\n");
 				exit(EXIT_FAILURE);
@@ -4068,6 +4068,7 @@ main(int argc, char *argv[]) {
 			header.flags = DNS_MASTERRAW_SOURCESERIALSET;
 			header.sourceserial = serialnum;
 		}
+		header.version = rawversion;
 		result = dns_master_dumptostream(mctx, gdb, gversion,
 						 masterstyle, outputformat,
 						 &header, outfp);
@@ -64,6 +64,7 @@ options {\n\
 #endif /* if defined(HAVE_GEOIP2) */
 			    "\
 	interface-interval 60;\n\
+	intern-rdataslabs no;\n\
 	listen-on {any;};\n\
 	listen-on-v6 {any;};\n\
 	match-mapped-addresses no;\n\
@@ -72,6 +73,7 @@ options {\n\
 	max-udp-size 1232;\n\
 	memstatistics-file \"named.memstats\";\n\
 	nocookie-udp-size 4096;\n\
+	notify-pipeline 0;\n\
 	notify-rate 20;\n\
 	nta-lifetime 3600;\n\
 	nta-recheck 300;\n\
@@ -85,7 +87,8 @@ options {\n\
 	reuseport no;\n"
 #endif
 			    "\
-	tls-port 853;\n"
+	tls-port 853;\n\
+	tls-ticket-key-lifetime 3600;\n"
 #if HAVE_LIBNGHTTP2
 			    "\
 	http-port 80;\n\
@@ -95,15 +98,19 @@ options {\n\
 #endif
 			    "\
 	prefetch 2 9;\n\
+	prefetch-popular-names 0;\n\
+	prefetch-popular-rate 100;\n\
 #	querylog <boolean>;\n\
 	recursing-file \"named.recursing\";\n\
 	recursive-clients 1000;\n\
 	request-nsid false;\n\
+	resolver-hedge-budget 0;\n\
 	resolver-query-timeout 10;\n\
 #	responselog <boolean>;\n\
 	rrset-order { order random; };\n\
 	secroots-file \"named.secroots\";\n\
 	send-cookie true;\n\
+	serial-query-pipeline 0;\n\
 	serial-query-rate 20;\n\
 	server-id none;\n\
 	session-keyalg hmac-sha256;\n\
@@ -118,6 +125,7 @@ options {\n\
 	tcp-initial-timeout 300;\n\
 	tcp-keepalive-timeout 300;\n\
 	tcp-listen-queue 10;\n\
+	tcp-pipeline-depth 22;\n\
 	tcp-receive-buffer 0;\n\
 	tcp-send-buffer 0;\n\
 #	tkey-domain <none>\n\
@@ -129,6 +137,7 @@ options {\n\
 	trust-anchor-telemetry yes;\n\
 	udp-receive-buffer 0;\n\
 	udp-send-buffer 0;\n\
+	udp-socket-reuse 1;\n\
 	update-quota 100;\n\
 \n\
 	/* view */\n\
@@ -142,6 +151,7 @@ options {\n\
 	allow-recursion-on { any; };\n\
 	allow-update-forwarding {none;};\n\
 	auth-nxdomain false;\n\
+	cache-wire-rdata no;\n\
 	check-dup-records warn;\n\
 	check-mx warn;\n\
 	check-names primary fail;\n\
@@ -159,6 +169,7 @@ options {\n\
 	fetch-quota-params 100 0.1 0.3 0.7;\n\
 	fetches-per-server 0;\n\
 	fetches-per-zone 0;\n\
+	forwarder-connections 0;\n\
 	lame-ttl 0;\n"
 #ifdef HAVE_LMDB
 			    "	lmdb-mapsize 32M;\n"
@@ -166,6 +177,7 @@ options {\n\
 			    "	max-cache-size 90%;\n\
 	max-cache-ttl 604800; /* 1 week */\n\
 	max-clients-per-query 100;\n\
+	max-ncache-size unlimited;\n\
 	max-ncache-ttl 10800; /* 3 hours */\n\
 	max-recursion-depth 7;\n\
 	max-recursion-queries 32;\n\
@@ -216,10 +228,12 @@ options {\n\
 	check-srv-cname warn;\n\
 	check-wildcard yes;\n\
 	dnssec-loadkeys-interval 60;\n\
+	dump-sync-size unlimited;\n\
 #	forward <none>\n\
 #	forwarders <none>\n\
 #	inline-signing no;\n\
 	ixfr-from-differences false;\n\
+	max-dump-rate unlimited;\n\
 	max-journal-size default;\n\
 	max-records 0;\n\
 	max-records-per-type 100;\n\
@@ -240,6 +254,7 @@ options {\n\
 	sig-signing-nodes 100;\n\
 	sig-signing-signatures 10;\n\
 	sig-signing-type 65534;\n\
+	sig-signing-workers 0;\n\
 	transfer-source *;\n\
 	transfer-source-v6 *;\n\
 	try-tcp-refresh yes; /* BIND 8 compat */\n\
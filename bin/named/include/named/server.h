@@ -100,8 +100,9 @@ struct named_server {
 
 	dns_dtenv_t *dtenv; /*%< Dnstap environment */
 
-	isc_tlsctx_cache_t *tlsctx_server_cache;
-	isc_tlsctx_cache_t *tlsctx_client_cache;
+	isc_tlsctx_cache_t	*tlsctx_server_cache;
+	isc_tlsctx_cache_t	*tlsctx_client_cache;
+	isc_tlsctx_ticketkeys_t *tlsticketkeys;
 
 	isc_signal_t *sighup;
 	isc_signal_t *sigusr1;
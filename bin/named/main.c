@@ -33,6 +33,7 @@
 #include <isc/fips.h>
 #include <isc/hash.h>
 #include <isc/httpd.h>
+#include <isc/loop.h>
 #include <isc/managers.h>
 #include <isc/netmgr.h>
 #include <isc/os.h>
@@ -302,10 +303,10 @@ library_unexpected_error(const char *file, int line, const char *func,
 
 static void
 usage(void) {
-	fprintf(stderr, "usage: named [-4|-6] [-c conffile] [-d debuglevel] "
-			"[-D comment]\n"
-			"             [-f|-g] [-L logfile] [-n number_of_cpus] "
-			"[-p port] [-s]\n"
+	fprintf(stderr, "usage: named [-4|-6] [-a none|cpu|numa] [-c conffile] "
+			"[-d debuglevel]\n"
+			"             [-D comment] [-f|-g] [-L logfile] "
+			"[-n number_of_cpus] [-p port] [-s]\n"
 			"             [-S sockets] [-t chrootdir] [-u "
 			"username] [-U listeners]\n"
 			"             [-m "
@@ -860,6 +861,22 @@ parse_command_line(int argc, char *argv[]) {
 			isc_net_disableipv4();
 			disable4 = true;
 			break;
+		case 'a':
+			if (strcmp(isc_commandline_argument, "none") == 0) {
+				isc_loopmgr_setaffinity(isc_loopaffinity_none);
+			} else if (strcmp(isc_commandline_argument, "cpu") == 0)
+			{
+				isc_loopmgr_setaffinity(isc_loopaffinity_cpu);
+			} else if (strcmp(isc_commandline_argument, "numa") ==
+				   0)
+			{
+				isc_loopmgr_setaffinity(isc_loopaffinity_numa);
+			} else {
+				named_main_earlyfatal("unknown thread affinity "
+						      "'%s'",
+						      isc_commandline_argument);
+			}
+			break;
 		case 'A':
 			parse_fuzz_arg();
 			break;
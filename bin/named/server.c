@@ -94,6 +94,7 @@
 #include <dns/rdatalist.h>
 #include <dns/rdataset.h>
 #include <dns/rdatastruct.h>
+#include <dns/refresher.h>
 #include <dns/resolver.h>
 #include <dns/rootns.h>
 #include <dns/rriterator.h>
@@ -170,6 +171,7 @@
 #define MAX_KEEPALIVE_TIMEOUT  UINT32_C(UINT16_MAX * 100)
 #define MIN_ADVERTISED_TIMEOUT UINT32_C(0) /* No minimum */
 #define MAX_ADVERTISED_TIMEOUT UINT32_C(UINT16_MAX * 100)
+#define MAX_PIPELINE_DEPTH     UINT32_C(65535)
 
 /*%
  * Check an operation for failure.  Assumes that the function
@@ -328,18 +330,41 @@ typedef struct {
 	isc_refcount_t refs;
 } ns_zoneload_t;
 
+typedef enum {
+	CATZ_ADDZONE,
+	CATZ_MODZONE,
+	CATZ_DELZONE,
+} catz_type_t;
+
+typedef struct catz_chgzone catz_chgzone_t;
+
+/*%
+ * Maximum number of queued catalog zone member changes which are
+ * processed during a single pause of the loop manager.
+ */
+#define CATZ_BATCH_SIZE 1024
+
 typedef struct {
 	named_server_t *server;
+	isc_mutex_t lock;
+	ISC_LIST(catz_chgzone_t) pending;
+	unsigned int npending;
+	bool scheduled;
 } catz_cb_data_t;
 
-typedef struct catz_chgzone {
+struct catz_chgzone {
 	isc_mem_t *mctx;
 	dns_catz_entry_t *entry;
 	dns_catz_zone_t *origin;
 	dns_view_t *view;
 	catz_cb_data_t *cbd;
-	bool mod;
-} catz_chgzone_t;
+	catz_type_t type;
+	isc_nanosecs_t queued;
+	isc_result_t result;
+	cfg_obj_t *zoneconf;
+	dns_zone_t *zone;
+	ISC_LINK(catz_chgzone_t) link;
+};
 
 typedef struct catz_reconfig_data {
 	dns_catz_zone_t *catz;
@@ -347,12 +372,6 @@ typedef struct catz_reconfig_data {
 	catz_cb_data_t *cbd;
 } catz_reconfig_data_t;
 
-typedef enum {
-	CATZ_ADDZONE,
-	CATZ_MODZONE,
-	CATZ_DELZONE,
-} catz_type_t;
-
 typedef struct {
 	unsigned int magic;
 #define DZARG_MAGIC ISC_MAGIC('D', 'z', 'a', 'r')
@@ -2372,22 +2391,38 @@ configure_rpz(dns_view_t *view, dns_view_t *pview, const cfg_obj_t *rpz_obj,
 }
 
 static void
-catz_addmodzone_cb(void *arg) {
-	catz_chgzone_t *cz = (catz_chgzone_t *)arg;
+catz_chgzone_free(catz_chgzone_t **czp) {
+	catz_chgzone_t *cz = *czp;
+	*czp = NULL;
+
+	if (cz->zone != NULL) {
+		dns_zone_detach(&cz->zone);
+	}
+	if (cz->zoneconf != NULL) {
+		ns_cfgctx_t *cfg = (ns_cfgctx_t *)cz->view->new_zone_config;
+		INSIST(cfg != NULL);
+		cfg_obj_destroy(cfg->add_parser, &cz->zoneconf);
+	}
+	dns_catz_entry_detach(cz->origin, &cz->entry);
+	dns_catz_zone_detach(&cz->origin);
+	dns_view_weakdetach(&cz->view);
+	isc_mem_putanddetach(&cz->mctx, cz, sizeof(*cz));
+}
+
+/*
+ * Generate and parse the configuration for a member zone that is about
+ * to be added or modified.  This only depends on the catalog entry, so it
+ * is done before the loop manager is paused.
+ */
+static isc_result_t
+catz_chgzone_prepare(catz_chgzone_t *cz) {
 	isc_result_t result;
-	dns_forwarders_t *dnsforwarders = NULL;
-	dns_name_t *name = NULL;
-	isc_buffer_t namebuf;
 	isc_buffer_t *confbuf = NULL;
 	char nameb[DNS_NAME_FORMATSIZE];
-	const cfg_obj_t *zlist = NULL;
-	cfg_obj_t *zoneconf = NULL;
-	cfg_obj_t *zoneobj = NULL;
 	ns_cfgctx_t *cfg = NULL;
-	dns_zone_t *zone = NULL;
 
-	if (isc_loop_shuttingdown(isc_loop_get(named_g_loopmgr, isc_tid()))) {
-		goto cleanup;
+	if (cz->type == CATZ_DELZONE) {
+		return (ISC_R_SUCCESS);
 	}
 
 	/*
@@ -2396,6 +2431,53 @@ catz_addmodzone_cb(void *arg) {
 	 */
 	cfg = (ns_cfgctx_t *)cz->view->new_zone_config;
 	if (cfg == NULL) {
+		return (ISC_R_FAILURE);
+	}
+
+	result = dns_catz_generate_zonecfg(cz->origin, cz->entry, &confbuf);
+	if (result == ISC_R_SUCCESS) {
+		cfg_parser_reset(cfg->add_parser);
+		result = cfg_parse_buffer(cfg->add_parser, confbuf, "catz", 0,
+					  &cfg_type_addzoneconf, 0,
+					  &cz->zoneconf);
+		isc_buffer_free(&confbuf);
+	}
+	/*
+	 * Fail if either dns_catz_generate_zonecfg() or cfg_parse_buffer()
+	 * failed.
+	 */
+	if (result != ISC_R_SUCCESS) {
+		dns_name_format(dns_catz_entry_getname(cz->entry), nameb,
+				DNS_NAME_FORMATSIZE);
+		isc_log_write(NAMED_LOGCATEGORY_GENERAL, NAMED_LOGMODULE_SERVER,
+			      ISC_LOG_ERROR,
+			      "catz: error \"%s\" while trying to generate "
+			      "config for zone '%s'",
+			      isc_result_totext(result), nameb);
+	}
+
+	return (result);
+}
+
+/*
+ * Configure a member zone.  Must be called with the loop manager paused;
+ * on success 'cz->zone' is set and the zone still needs to be loaded.
+ */
+static isc_result_t
+catz_addmodzone_cb(catz_chgzone_t *cz) {
+	isc_result_t result;
+	dns_forwarders_t *dnsforwarders = NULL;
+	dns_name_t *name = NULL;
+	isc_buffer_t namebuf;
+	char nameb[DNS_NAME_FORMATSIZE];
+	const cfg_obj_t *zlist = NULL;
+	cfg_obj_t *zoneobj = NULL;
+	ns_cfgctx_t *cfg = NULL;
+	dns_zone_t *zone = NULL;
+	bool mod = (cz->type == CATZ_MODZONE);
+
+	cfg = (ns_cfgctx_t *)cz->view->new_zone_config;
+	if (cfg == NULL || cz->zoneconf == NULL) {
 		CHECK(ISC_R_FAILURE);
 	}
 
@@ -2415,12 +2497,12 @@ catz_addmodzone_cb(void *arg) {
 			      "zone '%s' will not be processed because of the "
 			      "explicitly configured forwarding for that zone",
 			      nameb);
-		goto cleanup;
+		CHECK(ISC_R_FAILURE);
 	}
 
 	result = dns_view_findzone(cz->view, name, DNS_ZTFIND_EXACT, &zone);
 
-	if (cz->mod) {
+	if (mod) {
 		dns_catz_zone_t *parentcatz;
 
 		if (result != ISC_R_SUCCESS) {
@@ -2439,7 +2521,7 @@ catz_addmodzone_cb(void *arg) {
 				      "zone '%s' is not a dynamically "
 				      "added zone",
 				      nameb);
-			goto cleanup;
+			CHECK(ISC_R_FAILURE);
 		}
 
 		parentcatz = dns_zone_get_parentcatz(zone);
@@ -2451,7 +2533,7 @@ catz_addmodzone_cb(void *arg) {
 				      "zone '%s' exists and is not added by "
 				      "a catalog zone, so won't be modified",
 				      nameb);
-			goto cleanup;
+			CHECK(ISC_R_FAILURE);
 		}
 		if (parentcatz != cz->origin) {
 			isc_log_write(NAMED_LOGCATEGORY_GENERAL,
@@ -2460,7 +2542,7 @@ catz_addmodzone_cb(void *arg) {
 				      "zone '%s' exists in multiple "
 				      "catalog zones",
 				      nameb);
-			goto cleanup;
+			CHECK(ISC_R_FAILURE);
 		}
 
 		dns_zone_detach(&zone);
@@ -2489,34 +2571,14 @@ catz_addmodzone_cb(void *arg) {
 					      "that zone",
 					      nameb);
 			}
-			goto cleanup;
+			CHECK(ISC_R_EXISTS);
 		} else {
 			RUNTIME_CHECK(result == ISC_R_NOTFOUND);
 		}
 	}
 	RUNTIME_CHECK(zone == NULL);
-	/* Create a config for new zone */
-	confbuf = NULL;
-	result = dns_catz_generate_zonecfg(cz->origin, cz->entry, &confbuf);
-	if (result == ISC_R_SUCCESS) {
-		cfg_parser_reset(cfg->add_parser);
-		result = cfg_parse_buffer(cfg->add_parser, confbuf, "catz", 0,
-					  &cfg_type_addzoneconf, 0, &zoneconf);
-		isc_buffer_free(&confbuf);
-	}
-	/*
-	 * Fail if either dns_catz_generate_zonecfg() or cfg_parse_buffer()
-	 * failed.
-	 */
-	if (result != ISC_R_SUCCESS) {
-		isc_log_write(NAMED_LOGCATEGORY_GENERAL, NAMED_LOGMODULE_SERVER,
-			      ISC_LOG_ERROR,
-			      "catz: error \"%s\" while trying to generate "
-			      "config for zone '%s'",
-			      isc_result_totext(result), nameb);
-		goto cleanup;
-	}
-	CHECK(cfg_map_get(zoneconf, "zone", &zlist));
+
+	CHECK(cfg_map_get(cz->zoneconf, "zone", &zlist));
 	if (!cfg_obj_islist(zlist)) {
 		CHECK(ISC_R_FAILURE);
 	}
@@ -2525,15 +2587,13 @@ catz_addmodzone_cb(void *arg) {
 	zoneobj = cfg_listelt_value(cfg_list_first(zlist));
 
 	/* Mark view unfrozen so that zone can be added */
-	isc_loopmgr_pause(named_g_loopmgr);
 	dns_view_thaw(cz->view);
 	result = configure_zone(cfg->config, zoneobj, cfg->vconfig, cz->view,
 				&cz->cbd->server->viewlist,
 				&cz->cbd->server->kasplist,
 				&cz->cbd->server->keystorelist, cfg->actx, true,
-				false, true, cz->mod);
+				false, true, mod);
 	dns_view_freeze(cz->view);
-	isc_loopmgr_resume(named_g_loopmgr);
 
 	if (result != ISC_R_SUCCESS) {
 		isc_log_write(NAMED_LOGCATEGORY_GENERAL, NAMED_LOGMODULE_SERVER,
@@ -2544,66 +2604,77 @@ catz_addmodzone_cb(void *arg) {
 	}
 
 	/* Is it there yet? */
-	CHECK(dns_view_findzone(cz->view, name, DNS_ZTFIND_EXACT, &zone));
+	CHECK(dns_view_findzone(cz->view, name, DNS_ZTFIND_EXACT, &cz->zone));
 
 	/*
-	 * Load the zone from the master file.	If this fails, we'll
-	 * need to undo the configuration we've done already.
+	 * Flag the zone as having been added at runtime now, so that
+	 * later entries in the same batch (e.g. a modification following
+	 * the addition) see it as owned by this catalog zone.
 	 */
-	result = dns_zone_load(zone, true);
-	if (result != ISC_R_SUCCESS) {
-		dns_db_t *dbp = NULL;
-		isc_log_write(NAMED_LOGCATEGORY_GENERAL, NAMED_LOGMODULE_SERVER,
-			      ISC_LOG_ERROR,
-			      "catz: dns_zone_load() failed "
-			      "with %s; reverting.",
-			      isc_result_totext(result));
-
-		/* If the zone loaded partially, unload it */
-		if (dns_zone_getdb(zone, &dbp) == ISC_R_SUCCESS) {
-			dns_db_detach(&dbp);
-			dns_zone_unload(zone);
-		}
-
-		/* Remove the zone from the zone table */
-		dns_view_delzone(cz->view, zone);
-		goto cleanup;
-	}
-
-	/* Flag the zone as having been added at runtime */
-	dns_zone_setadded(zone, true);
-	dns_zone_set_parentcatz(zone, cz->origin);
+	dns_zone_setadded(cz->zone, true);
+	dns_zone_set_parentcatz(cz->zone, cz->origin);
 
 cleanup:
 	if (zone != NULL) {
 		dns_zone_detach(&zone);
 	}
-	if (zoneconf != NULL) {
-		cfg_obj_destroy(cfg->add_parser, &zoneconf);
-	}
 	if (dnsforwarders != NULL) {
 		dns_forwarders_detach(&dnsforwarders);
 	}
-	dns_catz_entry_detach(cz->origin, &cz->entry);
-	dns_catz_zone_detach(&cz->origin);
-	dns_view_weakdetach(&cz->view);
-	isc_mem_putanddetach(&cz->mctx, cz, sizeof(*cz));
+
+	return (result);
 }
 
-static void
-catz_delzone_cb(void *arg) {
-	catz_chgzone_t *cz = (catz_chgzone_t *)arg;
+/*
+ * Load a member zone configured by catz_addmodzone_cb().  This is done after
+ * the loop manager has been resumed.  For secondary zones without a
+ * master file this only schedules the initial refresh, which is then
+ * paced by the zone manager's refresh rate limiter.
+ */
+static isc_result_t
+catz_loadzone(catz_chgzone_t *cz) {
 	isc_result_t result;
-	dns_zone_t *zone = NULL;
 	dns_db_t *dbp = NULL;
-	char cname[DNS_NAME_FORMATSIZE];
-	const char *file = NULL;
 
-	if (isc_loop_shuttingdown(isc_loop_get(named_g_loopmgr, isc_tid()))) {
-		goto cleanup;
+	INSIST(cz->zone != NULL);
+
+	/*
+	 * Load the zone from the master file.	If this fails, we'll
+	 * need to undo the configuration we've done already.
+	 */
+	result = dns_zone_load(cz->zone, true);
+	if (result == ISC_R_SUCCESS) {
+		return (result);
 	}
 
-	isc_loopmgr_pause(named_g_loopmgr);
+	isc_log_write(NAMED_LOGCATEGORY_GENERAL, NAMED_LOGMODULE_SERVER,
+		      ISC_LOG_ERROR,
+		      "catz: dns_zone_load() failed "
+		      "with %s; reverting.",
+		      isc_result_totext(result));
+
+	/* If the zone loaded partially, unload it */
+	if (dns_zone_getdb(cz->zone, &dbp) == ISC_R_SUCCESS) {
+		dns_db_detach(&dbp);
+		dns_zone_unload(cz->zone);
+	}
+
+	/* Remove the zone from the zone table */
+	dns_view_delzone(cz->view, cz->zone);
+
+	return (result);
+}
+
+/*
+ * Delete a member zone.  Must be called with the loop manager paused.
+ */
+static isc_result_t
+catz_delzone_cb(catz_chgzone_t *cz) {
+	isc_result_t result;
+	dns_zone_t *zone = NULL;
+	dns_db_t *dbp = NULL;
+	char cname[DNS_NAME_FORMATSIZE];
+	const char *file = NULL;
 
 	dns_name_format(dns_catz_entry_getname(cz->entry), cname,
 			DNS_NAME_FORMATSIZE);
@@ -2615,7 +2686,7 @@ catz_delzone_cb(void *arg) {
 			      "catz: catz_delzone_cb: "
 			      "zone '%s' not found",
 			      cname);
-		goto resume;
+		goto cleanup;
 	}
 
 	if (!dns_zone_getadded(zone)) {
@@ -2624,7 +2695,7 @@ catz_delzone_cb(void *arg) {
 			      "catz: catz_delzone_cb: "
 			      "zone '%s' is not a dynamically added zone",
 			      cname);
-		goto resume;
+		CHECK(ISC_R_FAILURE);
 	}
 
 	if (dns_zone_get_parentcatz(zone) != cz->origin) {
@@ -2633,7 +2704,7 @@ catz_delzone_cb(void *arg) {
 			      "catz: catz_delzone_cb: zone "
 			      "'%s' exists in multiple catalog zones",
 			      cname);
-		goto resume;
+		CHECK(ISC_R_FAILURE);
 	}
 
 	/* Stop answering for this zone */
@@ -2642,9 +2713,7 @@ catz_delzone_cb(void *arg) {
 		dns_zone_unload(zone);
 	}
 
-	if (dns_view_delzone(cz->view, zone) != ISC_R_SUCCESS) {
-		goto resume;
-	}
+	CHECK(dns_view_delzone(cz->view, zone));
 	file = dns_zone_getfile(zone);
 	if (file != NULL) {
 		isc_file_remove(file);
@@ -2659,31 +2728,175 @@ catz_delzone_cb(void *arg) {
 		      "catz: catz_delzone_cb: "
 		      "zone '%s' deleted",
 		      cname);
-resume:
-	isc_loopmgr_resume(named_g_loopmgr);
+
 cleanup:
 	if (zone != NULL) {
 		dns_zone_detach(&zone);
 	}
-	dns_catz_entry_detach(cz->origin, &cz->entry);
-	dns_catz_zone_detach(&cz->origin);
-	dns_view_weakdetach(&cz->view);
-	isc_mem_putanddetach(&cz->mctx, cz, sizeof(*cz));
+
+	return (result);
+}
+
+/*
+ * A member zone has been deleted by 'del'.  If it was added or modified
+ * earlier in the same batch, it must not be loaded after all.
+ */
+static void
+catz_batch_dropzone(catz_chgzone_t *del) {
+	const dns_name_t *name = dns_catz_entry_getname(del->entry);
+
+	for (catz_chgzone_t *cz = ISC_LIST_PREV(del, link); cz != NULL;
+	     cz = ISC_LIST_PREV(cz, link))
+	{
+		if (cz->zone != NULL &&
+		    dns_name_equal(dns_catz_entry_getname(cz->entry), name))
+		{
+			dns_zone_detach(&cz->zone);
+		}
+	}
+}
+
+/*
+ * Process up to CATZ_BATCH_SIZE queued member zone changes.  All the
+ * changes of a batch share a single pause of the loop manager, instead
+ * of stopping every loop once per member zone.
+ */
+static void
+catz_batch_cb(void *arg) {
+	catz_cb_data_t *cbd = (catz_cb_data_t *)arg;
+	ns_stats_t *nsstats = cbd->server->sctx->nsstats;
+	ISC_LIST(catz_chgzone_t) batch;
+	catz_chgzone_t *cz = NULL, *next = NULL;
+	isc_nanosecs_t start, now;
+	unsigned int count = 0, failed = 0, remaining;
+	bool shuttingdown;
+
+	ISC_LIST_INIT(batch);
+
+	start = isc_time_monotonic();
+	shuttingdown = isc_loop_shuttingdown(
+		isc_loop_get(named_g_loopmgr, isc_tid()));
+
+	/*
+	 * When shutting down, drain the whole queue without processing it.
+	 */
+	LOCK(&cbd->lock);
+	while ((shuttingdown || count < CATZ_BATCH_SIZE) &&
+	       (cz = ISC_LIST_HEAD(cbd->pending)) != NULL)
+	{
+		ISC_LIST_UNLINK(cbd->pending, cz, link);
+		ISC_LIST_APPEND(batch, cz, link);
+		count++;
+	}
+	INSIST(cbd->npending >= count);
+	cbd->npending -= count;
+	remaining = cbd->npending;
+	cbd->scheduled = (remaining > 0);
+	UNLOCK(&cbd->lock);
+
+	/* Phase 1: build the zone configurations */
+	if (!shuttingdown) {
+		for (cz = ISC_LIST_HEAD(batch); cz != NULL;
+		     cz = ISC_LIST_NEXT(cz, link))
+		{
+			cz->result = catz_chgzone_prepare(cz);
+		}
+	}
+
+	/* Phase 2: add, modify and delete the zones in queue order */
+	if (!shuttingdown) {
+		isc_loopmgr_pause(named_g_loopmgr);
+		for (cz = ISC_LIST_HEAD(batch); cz != NULL;
+		     cz = ISC_LIST_NEXT(cz, link))
+		{
+			if (cz->result != ISC_R_SUCCESS) {
+				continue;
+			}
+			if (cz->type == CATZ_DELZONE) {
+				cz->result = catz_delzone_cb(cz);
+				if (cz->result == ISC_R_SUCCESS) {
+					catz_batch_dropzone(cz);
+				}
+			} else {
+				cz->result = catz_addmodzone_cb(cz);
+			}
+		}
+		isc_loopmgr_resume(named_g_loopmgr);
+	}
+
+	/* Phase 3: load the new zones and account for the results */
+	for (cz = ISC_LIST_HEAD(batch); cz != NULL; cz = next) {
+		next = ISC_LIST_NEXT(cz, link);
+		ISC_LIST_UNLINK(batch, cz, link);
+
+		if (!shuttingdown && cz->result == ISC_R_SUCCESS &&
+		    cz->zone != NULL)
+		{
+			cz->result = catz_loadzone(cz);
+		}
+
+		ns_stats_decrement(nsstats, ns_statscounter_catzqueued);
+		if (shuttingdown) {
+			/* Not processed, not a failure either. */
+		} else if (cz->result != ISC_R_SUCCESS) {
+			ns_stats_increment(nsstats, ns_statscounter_catzfailed);
+			failed++;
+		} else {
+			switch (cz->type) {
+			case CATZ_ADDZONE:
+				ns_stats_increment(nsstats,
+						   ns_statscounter_catzadded);
+				break;
+			case CATZ_MODZONE:
+				ns_stats_increment(
+					nsstats, ns_statscounter_catzmodified);
+				break;
+			case CATZ_DELZONE:
+				ns_stats_increment(
+					nsstats, ns_statscounter_catzdeleted);
+				break;
+			default:
+				UNREACHABLE();
+			}
+		}
+
+		now = isc_time_monotonic();
+		ns_stats_update_if_greater(
+			nsstats, ns_statscounter_catzlatencyhighwater,
+			(isc_statscounter_t)((now - cz->queued) / NS_PER_MS));
+
+		catz_chgzone_free(&cz);
+	}
+
+	if (shuttingdown) {
+		return;
+	}
+
+	ns_stats_increment(nsstats, ns_statscounter_catzbatches);
+	isc_log_write(NAMED_LOGCATEGORY_GENERAL, NAMED_LOGMODULE_SERVER,
+		      ISC_LOG_INFO,
+		      "catz: processed %u member zone change(s) "
+		      "(%u failed) in %" PRIu64 " ms, %u still queued",
+		      count, failed,
+		      (uint64_t)((isc_time_monotonic() - start) / NS_PER_MS),
+		      remaining);
+
+	if (remaining > 0) {
+		isc_async_run(named_g_mainloop, catz_batch_cb, cbd);
+	}
 }
 
 static isc_result_t
 catz_run(dns_catz_entry_t *entry, dns_catz_zone_t *origin, dns_view_t *view,
 	 void *udata, catz_type_t type) {
+	catz_cb_data_t *cbd = (catz_cb_data_t *)udata;
 	catz_chgzone_t *cz = NULL;
-	isc_job_cb action = NULL;
+	bool schedule = false;
 
 	switch (type) {
 	case CATZ_ADDZONE:
 	case CATZ_MODZONE:
-		action = catz_addmodzone_cb;
-		break;
 	case CATZ_DELZONE:
-		action = catz_delzone_cb;
 		break;
 	default:
 		REQUIRE(0);
@@ -2692,8 +2905,11 @@ catz_run(dns_catz_entry_t *entry, dns_catz_zone_t *origin, dns_view_t *view,
 
 	cz = isc_mem_get(view->mctx, sizeof(*cz));
 	*cz = (catz_chgzone_t){
-		.cbd = (catz_cb_data_t *)udata,
-		.mod = (type == CATZ_MODZONE),
+		.cbd = cbd,
+		.type = type,
+		.queued = isc_time_monotonic(),
+		.result = ISC_R_SUCCESS,
+		.link = ISC_LINK_INITIALIZER,
 	};
 	isc_mem_attach(view->mctx, &cz->mctx);
 
@@ -2701,7 +2917,25 @@ catz_run(dns_catz_entry_t *entry, dns_catz_zone_t *origin, dns_view_t *view,
 	dns_catz_zone_attach(origin, &cz->origin);
 	dns_view_weakattach(view, &cz->view);
 
-	isc_async_run(named_g_mainloop, action, cz);
+	ns_stats_increment(cbd->server->sctx->nsstats,
+			   ns_statscounter_catzqueued);
+
+	/*
+	 * Changes are queued and processed in batches on the main loop;
+	 * only schedule the batch job when it isn't already pending.
+	 */
+	LOCK(&cbd->lock);
+	ISC_LIST_APPEND(cbd->pending, cz, link);
+	cbd->npending++;
+	if (!cbd->scheduled) {
+		cbd->scheduled = true;
+		schedule = true;
+	}
+	UNLOCK(&cbd->lock);
+
+	if (schedule) {
+		isc_async_run(named_g_mainloop, catz_batch_cb, cbd);
+	}
 
 	return (ISC_R_SUCCESS);
 }
@@ -3833,8 +4067,10 @@ configure_view(dns_view_t *view, dns_viewlist_t *viewlist, cfg_obj_t *config,
 	isc_result_t result;
 	size_t max_cache_size;
 	uint32_t max_cache_size_percent = 0;
+	size_t max_ncache_size;
 	size_t max_adb_size;
 	uint32_t lame_ttl, fail_ttl;
+	uint32_t popular_names, popular_rate;
 	uint32_t max_stale_ttl = 0;
 	uint32_t stale_refresh_time = 0;
 	dns_tsigkeyring_t *ring = NULL;
@@ -4495,6 +4731,31 @@ configure_view(dns_view_t *view, dns_viewlist_t *viewlist, cfg_obj_t *config,
 	dns_view_setcache(view, cache, shared_cache);
 
 	dns_cache_setcachesize(cache, max_cache_size);
+
+	/*
+	 * The budget for the negative answers, as a percentage of the
+	 * cache size (once adjusted by the cache) or in bytes.
+	 */
+	obj = NULL;
+	result = named_config_get(maps, "max-ncache-size", &obj);
+	INSIST(result == ISC_R_SUCCESS);
+	if (cfg_obj_isstring(obj)) {
+		INSIST(strcasecmp(cfg_obj_asstring(obj), "unlimited") == 0);
+		max_ncache_size = 0;
+	} else if (cfg_obj_ispercentage(obj)) {
+		max_ncache_size = dns_cache_getcachesize(cache) / 100 *
+				  cfg_obj_aspercentage(obj);
+	} else {
+		uint64_t value = cfg_obj_asuint64(obj);
+		max_ncache_size = (size_t)ISC_MIN(value, SIZE_MAX);
+	}
+	dns_cache_setmaxncachesize(cache, max_ncache_size);
+
+	obj = NULL;
+	result = named_config_get(maps, "cache-wire-rdata", &obj);
+	INSIST(result == ISC_R_SUCCESS);
+	dns_cache_setwirerdata(cache, cfg_obj_asboolean(obj));
+
 	dns_cache_setservestalettl(cache, max_stale_ttl);
 	dns_cache_setservestalerefresh(cache, stale_refresh_time);
 
@@ -4642,6 +4903,23 @@ configure_view(dns_view_t *view, dns_viewlist_t *viewlist, cfg_obj_t *config,
 	query_timeout = cfg_obj_asuint32(obj);
 	dns_resolver_settimeout(view->resolver, query_timeout);
 
+	/*
+	 * Set the budget for hedged queries.
+	 */
+	obj = NULL;
+	result = named_config_get(maps, "resolver-hedge-budget", &obj);
+	INSIST(result == ISC_R_SUCCESS);
+	dns_resolver_sethedgebudget(view->resolver, cfg_obj_asuint32(obj));
+
+	/*
+	 * Set the number of pooled connections to each forwarder.
+	 */
+	obj = NULL;
+	result = named_config_get(maps, "forwarder-connections", &obj);
+	INSIST(result == ISC_R_SUCCESS);
+	dns_resolver_setforwardconnections(view->resolver,
+					   cfg_obj_asuint32(obj));
+
 	/* Specify whether to use 0-TTL for negative response for SOA query */
 	dns_resolver_setzeronosoattl(view->resolver, zero_no_soattl);
 
@@ -5360,6 +5638,22 @@ configure_view(dns_view_t *view, dns_viewlist_t *viewlist, cfg_obj_t *config,
 		view->prefetch_eligible = view->prefetch_trigger + 6;
 	}
 
+	/*
+	 * Refresh the most popular names before they expire.
+	 */
+	obj = NULL;
+	result = named_config_get(maps, "prefetch-popular-names", &obj);
+	INSIST(result == ISC_R_SUCCESS);
+	popular_names = cfg_obj_asuint32(obj);
+	obj = NULL;
+	result = named_config_get(maps, "prefetch-popular-rate", &obj);
+	INSIST(result == ISC_R_SUCCESS);
+	popular_rate = cfg_obj_asuint32(obj);
+	if (popular_names > 0 && popular_rate > 0) {
+		dns_refresher_create(view, popular_names, popular_rate,
+				     &view->refresher);
+	}
+
 	/*
 	 * For now, there is only one kind of trusted keys, the
 	 * "security roots".
@@ -7960,6 +8254,7 @@ load_configuration(const char *filename, named_server_t *server,
 	uint32_t send_tcp_buffer_size;
 	uint32_t recv_udp_buffer_size;
 	uint32_t send_udp_buffer_size;
+	uint32_t pipeline_depth;
 	named_cache_t *nsc;
 	named_cachelist_t cachelist, tmpcachelist;
 	ns_altsecret_t *altsecret;
@@ -8346,6 +8641,24 @@ load_configuration(const char *filename, named_server_t *server,
 
 #undef CAP_IF_NOT_ZERO
 
+	obj = NULL;
+	result = named_config_get(maps, "tcp-pipeline-depth", &obj);
+	INSIST(result == ISC_R_SUCCESS);
+	pipeline_depth = cfg_obj_asuint32(obj);
+	if (pipeline_depth > MAX_PIPELINE_DEPTH) {
+		cfg_obj_log(obj, ISC_LOG_WARNING,
+			    "tcp-pipeline-depth value is out of range: "
+			    "lowering to %" PRIu32,
+			    MAX_PIPELINE_DEPTH);
+		pipeline_depth = MAX_PIPELINE_DEPTH;
+	} else if (pipeline_depth == 0) {
+		cfg_obj_log(obj, ISC_LOG_WARNING,
+			    "tcp-pipeline-depth value is out of range: "
+			    "raising to 1");
+		pipeline_depth = 1;
+	}
+	isc_nm_setpipelinedepth(named_g_netmgr, pipeline_depth);
+
 	/*
 	 * Configure sets of UDP query source ports.
 	 */
@@ -8402,6 +8715,11 @@ load_configuration(const char *filename, named_server_t *server,
 	dns_dispatchmgr_setavailports(named_g_dispatchmgr, v4portset,
 				      v6portset);
 
+	obj = NULL;
+	result = named_config_get(maps, "udp-socket-reuse", &obj);
+	INSIST(result == ISC_R_SUCCESS);
+	dns_dispatchmgr_setudpreuse(named_g_dispatchmgr, cfg_obj_asuint32(obj));
+
 	/*
 	 * Set the EDNS UDP size when we don't match a view.
 	 */
@@ -8448,6 +8766,19 @@ load_configuration(const char *filename, named_server_t *server,
 	INSIST(result == ISC_R_SUCCESS);
 	dns_zonemgr_setnotifyrate(server->zonemgr, cfg_obj_asuint32(obj));
 
+	obj = NULL;
+	result = named_config_get(maps, "notify-pipeline", &obj);
+	INSIST(result == ISC_R_SUCCESS);
+	pipeline_depth = cfg_obj_asuint32(obj);
+	if (pipeline_depth > MAX_PIPELINE_DEPTH) {
+		cfg_obj_log(obj, ISC_LOG_WARNING,
+			    "notify-pipeline value is out of range: "
+			    "lowering to %" PRIu32,
+			    MAX_PIPELINE_DEPTH);
+		pipeline_depth = MAX_PIPELINE_DEPTH;
+	}
+	dns_zonemgr_setnotifypipeline(server->zonemgr, pipeline_depth);
+
 	obj = NULL;
 	result = named_config_get(maps, "startup-notify-rate", &obj);
 	INSIST(result == ISC_R_SUCCESS);
@@ -8459,6 +8790,24 @@ load_configuration(const char *filename, named_server_t *server,
 	INSIST(result == ISC_R_SUCCESS);
 	dns_zonemgr_setserialqueryrate(server->zonemgr, cfg_obj_asuint32(obj));
 
+	obj = NULL;
+	result = named_config_get(maps, "serial-query-pipeline", &obj);
+	INSIST(result == ISC_R_SUCCESS);
+	pipeline_depth = cfg_obj_asuint32(obj);
+	if (pipeline_depth > MAX_PIPELINE_DEPTH) {
+		cfg_obj_log(obj, ISC_LOG_WARNING,
+			    "serial-query-pipeline value is out of range: "
+			    "lowering to %" PRIu32,
+			    MAX_PIPELINE_DEPTH);
+		pipeline_depth = MAX_PIPELINE_DEPTH;
+	}
+	dns_zonemgr_setserialquerypipeline(server->zonemgr, pipeline_depth);
+
+	obj = NULL;
+	result = named_config_get(maps, "intern-rdataslabs", &obj);
+	INSIST(result == ISC_R_SUCCESS);
+	dns_zonemgr_setinternslabs(server->zonemgr, cfg_obj_asboolean(obj));
+
 	/*
 	 * Determine which port to use for listening for incoming connections.
 	 */
@@ -8504,6 +8853,16 @@ load_configuration(const char *filename, named_server_t *server,
 	}
 #endif
 
+	/*
+	 * The TLS session ticket keys outlive the TLS contexts, so that
+	 * the clients can resume their sessions across reconfigurations.
+	 */
+	obj = NULL;
+	result = named_config_get(maps, "tls-ticket-key-lifetime", &obj);
+	INSIST(result == ISC_R_SUCCESS);
+	isc_tlsctx_ticketkeys_setlifetime(server->tlsticketkeys,
+					  cfg_obj_asduration(obj));
+
 	/*
 	 * Configure the interface manager according to the "listen-on"
 	 * statement.
@@ -9990,6 +10349,11 @@ named_server_create(isc_mem_t *mctx, named_server_t **serverp) {
 	ISC_LIST_INIT(server->keystorelist);
 	ISC_LIST_INIT(server->viewlist);
 
+	isc_mutex_init(&ns_catz_cbdata.lock);
+	ISC_LIST_INIT(ns_catz_cbdata.pending);
+
+	isc_tlsctx_ticketkeys_create(mctx, 3600, &server->tlsticketkeys);
+
 	CHECKFATAL(dns_rootns_create(mctx, dns_rdataclass_in, NULL,
 				     &server->in_roothints),
 		   "setting up root hints");
@@ -10092,6 +10456,8 @@ named_server_destroy(named_server_t **serverp) {
 	INSIST(ISC_LIST_EMPTY(server->keystorelist));
 	INSIST(ISC_LIST_EMPTY(server->viewlist));
 	INSIST(ISC_LIST_EMPTY(server->cachelist));
+	INSIST(ISC_LIST_EMPTY(ns_catz_cbdata.pending));
+	isc_mutex_destroy(&ns_catz_cbdata.lock);
 
 	if (server->tlsctx_server_cache != NULL) {
 		isc_tlsctx_cache_detach(&server->tlsctx_server_cache);
@@ -10101,6 +10467,8 @@ named_server_destroy(named_server_t **serverp) {
 		isc_tlsctx_cache_detach(&server->tlsctx_client_cache);
 	}
 
+	isc_tlsctx_ticketkeys_detach(&server->tlsticketkeys);
+
 	server->magic = 0;
 	isc_mem_put(server->mctx, server, sizeof(*server));
 	*serverp = NULL;
@@ -10798,6 +11166,7 @@ listenelt_fromconfig(const cfg_obj_t *listener, const cfg_obj_t *config,
 	bool tls_prefer_server_ciphers = false,
 	     tls_prefer_server_ciphers_set = false;
 	bool tls_session_tickets = false, tls_session_tickets_set = false;
+	bool tls_kernel_tls = false;
 	bool do_tls = false, no_tls = false, http = false;
 	ns_listenelt_t *delt = NULL;
 	uint32_t tls_protos = 0;
@@ -10827,6 +11196,7 @@ listenelt_fromconfig(const cfg_obj_t *listener, const cfg_obj_t *config,
 			const cfg_obj_t *cipher_suites_obj = NULL;
 			const cfg_obj_t *prefer_server_ciphers_obj = NULL;
 			const cfg_obj_t *session_tickets_obj = NULL;
+			const cfg_obj_t *kernel_tls_obj = NULL;
 
 			do_tls = true;
 
@@ -10908,6 +11278,13 @@ listenelt_fromconfig(const cfg_obj_t *listener, const cfg_obj_t *config,
 					cfg_obj_asboolean(session_tickets_obj);
 				tls_session_tickets_set = true;
 			}
+
+			if (cfg_map_get(tlsmap, "kernel-tls",
+					&kernel_tls_obj) == ISC_R_SUCCESS)
+			{
+				tls_kernel_tls =
+					cfg_obj_asboolean(kernel_tls_obj);
+			}
 		}
 	}
 
@@ -10923,7 +11300,9 @@ listenelt_fromconfig(const cfg_obj_t *listener, const cfg_obj_t *config,
 		.prefer_server_ciphers = tls_prefer_server_ciphers,
 		.prefer_server_ciphers_set = tls_prefer_server_ciphers_set,
 		.session_tickets = tls_session_tickets,
-		.session_tickets_set = tls_session_tickets_set
+		.session_tickets_set = tls_session_tickets_set,
+		.kernel_tls = tls_kernel_tls,
+		.ticketkeys = named_g_server->tlsticketkeys
 	};
 
 	httpobj = cfg_tuple_get(ltup, "http");
@@ -12005,6 +12384,7 @@ named_server_status(named_server_t *server, isc_buffer_t **text) {
 	char boottime[ISC_FORMATHTTPTIMESTAMP_SIZE];
 	char configtime[ISC_FORMATHTTPTIMESTAMP_SIZE];
 	char line[1024], hostname[256];
+	isc_tlsctx_ticketkeys_stats_t ticketstats;
 	named_reload_t reload_status;
 
 	REQUIRE(text != NULL);
@@ -12123,6 +12503,15 @@ named_server_status(named_server_t *server, isc_buffer_t **text) {
 			 server->sctx->nsstats, ns_statscounter_tcphighwater));
 	CHECK(putstr(text, line));
 
+	isc_tlsctx_ticketkeys_getstats(server->tlsticketkeys, &ticketstats);
+	snprintf(line, sizeof(line),
+		 "TLS session tickets: %" PRIu64 " issued, %" PRIu64
+		 " resumed, %" PRIu64 " renewed, %" PRIu64 " rejected, %" PRIu64
+		 " key rotations\n",
+		 ticketstats.issued, ticketstats.resumed, ticketstats.renewed,
+		 ticketstats.rejected, ticketstats.rotations);
+	CHECK(putstr(text, line));
+
 	reload_status = atomic_load(&server->reload_status);
 	if (reload_status != NAMED_RELOAD_DONE) {
 		snprintf(line, sizeof(line), "reload/reconfig %s\n",
@@ -14312,6 +14701,21 @@ newzone_cfgctx_destroy(void **cfgp) {
 	*cfgp = NULL;
 }
 
+static isc_result_t
+signing_progress(const dns_zone_signingprogress_t *progress, void *arg) {
+	isc_buffer_t **text = arg;
+	char algbuf[DNS_SECALG_FORMATSIZE];
+	char buf[256];
+
+	dns_secalg_format(progress->algorithm, algbuf, sizeof(algbuf));
+	snprintf(buf, sizeof(buf),
+		 "\n%s with key %u/%s: %" PRIu64 " of %" PRIu64 " nodes",
+		 progress->deleteit ? "Removing signatures" : "Signing",
+		 progress->keyid, algbuf, progress->nodes, progress->total);
+
+	return (putstr(text, buf));
+}
+
 isc_result_t
 named_server_signing(named_server_t *server, isc_lex_t *lex,
 		     isc_buffer_t **text) {
@@ -14335,6 +14739,7 @@ named_server_signing(named_server_t *server, isc_lex_t *lex,
 	const char *ptr;
 	size_t n;
 	bool kasp = false;
+	dns_zone_signingstats_t stats;
 
 	REQUIRE(text != NULL);
 
@@ -14499,13 +14904,33 @@ named_server_signing(named_server_t *server, isc_lex_t *lex,
 			CHECK(putstr(text, output));
 			first = false;
 		}
-		if (!first) {
-			CHECK(putnull(text));
+		if (result != ISC_R_NOMORE) {
+			goto cleanup;
 		}
 
-		if (result == ISC_R_NOMORE) {
-			result = ISC_R_SUCCESS;
+		CHECK(dns_zone_signingprogress(zone, signing_progress, text));
+
+		dns_zone_getsigningstats(zone, &stats);
+		if (stats.signatures > 0) {
+			double rate = 0.0;
+			char buf[256];
+
+			if (stats.usecs > 0) {
+				rate = stats.signatures * 1e6 / stats.usecs;
+			}
+			snprintf(buf, sizeof(buf),
+				 "\n%" PRIu64 " signatures generated in "
+				 "%" PRIu64 " quanta, %.0f per second with "
+				 "%u workers",
+				 stats.signatures, stats.quanta, rate,
+				 stats.workers);
+			CHECK(putstr(text, buf));
 		}
+
+		if (!first) {
+			CHECK(putnull(text));
+		}
+		result = ISC_R_SUCCESS;
 	} else if (kasp) {
 		(void)putstr(text, "zone uses dnssec-policy, use rndc dnssec "
 				   "command instead");
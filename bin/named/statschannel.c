@@ -379,6 +379,28 @@ init_desc(void) {
 		       "queries dropped due to recursive client limit",
 		       "RecLimitDropped");
 	SET_NSSTATDESC(updatequota, "Update quota exceeded", "UpdateQuota");
+	SET_NSSTATDESC(catzqueued, "catalog zone member changes queued",
+		       "CatzQueued");
+	SET_NSSTATDESC(catzadded, "catalog zone member zones added",
+		       "CatzAdded");
+	SET_NSSTATDESC(catzmodified, "catalog zone member zones modified",
+		       "CatzModified");
+	SET_NSSTATDESC(catzdeleted, "catalog zone member zones deleted",
+		       "CatzDeleted");
+	SET_NSSTATDESC(catzfailed, "catalog zone member changes failed",
+		       "CatzFailed");
+	SET_NSSTATDESC(catzbatches, "catalog zone member change batches",
+		       "CatzBatches");
+	SET_NSSTATDESC(catzlatencyhighwater,
+		       "catalog zone member change latency high-water (ms)",
+		       "CatzLatencyHighwater");
+	SET_NSSTATDESC(tcppipelined,
+		       "TCP requests received while others were in progress",
+		       "TCPPipelined");
+	SET_NSSTATDESC(tcppipelinehighwater, "TCP pipeline depth high-water",
+		       "TCPPipelineHighWater");
+	SET_NSSTATDESC(reqalloc, "requests that allocated client memory",
+		       "ReqAlloc");
 
 	INSIST(i == ns_statscounter_max);
 
@@ -474,6 +496,31 @@ init_desc(void) {
 	SET_RESSTATDESC(priming, "priming queries", "Priming");
 	SET_RESSTATDESC(forwardonlyfail, "all forwarders failed",
 			"ForwardOnlyFail");
+	SET_RESSTATDESC(hedged, "hedged queries sent", "HedgedQuery");
+	SET_RESSTATDESC(hedgeanswered, "hedged queries answered",
+			"HedgeAnswered");
+	SET_RESSTATDESC(hedgeoverbudget, "hedged queries over budget",
+			"HedgeOverBudget");
+	SET_RESSTATDESC(fetchtime50, "median fetch time (ms)", "FetchTime50");
+	SET_RESSTATDESC(fetchtime99, "99th percentile fetch time (ms)",
+			"FetchTime99");
+	SET_RESSTATDESC(refresh, "popular names refreshed", "RefreshFetch");
+	SET_RESSTATDESC(refreshfail, "popular name refreshes failed",
+			"RefreshFail");
+	SET_RESSTATDESC(refreshdeferred, "popular name refreshes deferred",
+			"RefreshDeferred");
+	SET_RESSTATDESC(refreshtracked, "popular names tracked",
+			"RefreshTracked");
+	SET_RESSTATDESC(tcppoolconns, "pooled TCP connections open",
+			"TCPPoolConns");
+	SET_RESSTATDESC(tcppoolopened, "pooled TCP connections opened",
+			"TCPPoolOpened");
+	SET_RESSTATDESC(tcppoolreused, "queries on open pooled TCP connections",
+			"TCPPoolReused");
+	SET_RESSTATDESC(udppoolreused, "queries on reused UDP sockets",
+			"UDPPoolReused");
+	SET_RESSTATDESC(udpsockopened, "UDP query sockets opened",
+			"UDPSockOpened");
 
 	INSIST(i == dns_resstatscounter_max);
 
@@ -1356,6 +1403,9 @@ zone_xmlrender(dns_zone_t *zone, void *arg) {
 		dns_stats_t *dnssecsignstats;
 		uint64_t nsstat_values[ns_statscounter_max];
 		uint64_t gluecachestats_values[dns_gluecachestatscounter_max];
+		uint64_t owned, shared;
+		dns_zone_signingstats_t signingstats;
+		dns_zone_dumpstats_t dumpstats;
 
 		zonestats = dns_zone_getrequeststats(zone);
 		if (zonestats != NULL) {
@@ -1442,6 +1492,109 @@ zone_xmlrender(dns_zone_t *zone, void *arg) {
 			/* counters type="dnssec-refresh"*/
 			TRY0(xmlTextWriterEndElement(writer));
 		}
+
+		if (dns_zone_getslabstats(zone, &owned, &shared) ==
+		    ISC_R_SUCCESS)
+		{
+			/* counters type="rdataslab"*/
+			TRY0(xmlTextWriterStartElement(writer,
+						       ISC_XMLCHAR "counters"));
+			TRY0(xmlTextWriterWriteAttribute(
+				writer, ISC_XMLCHAR "type",
+				ISC_XMLCHAR "rdataslab"));
+
+			TRY0(xmlTextWriterStartElement(writer,
+						       ISC_XMLCHAR "counter"));
+			TRY0(xmlTextWriterWriteAttribute(writer,
+							 ISC_XMLCHAR "name",
+							 ISC_XMLCHAR "owned"));
+			TRY0(xmlTextWriterWriteFormatString(writer, "%" PRIu64,
+							    owned));
+			TRY0(xmlTextWriterEndElement(writer)); /* counter */
+
+			TRY0(xmlTextWriterStartElement(writer,
+						       ISC_XMLCHAR "counter"));
+			TRY0(xmlTextWriterWriteAttribute(writer,
+							 ISC_XMLCHAR "name",
+							 ISC_XMLCHAR "shared"));
+			TRY0(xmlTextWriterWriteFormatString(writer, "%" PRIu64,
+							    shared));
+			TRY0(xmlTextWriterEndElement(writer)); /* counter */
+
+			/* counters type="rdataslab"*/
+			TRY0(xmlTextWriterEndElement(writer));
+		}
+
+		dns_zone_getsigningstats(zone, &signingstats);
+		if (signingstats.quanta > 0) {
+			const struct {
+				const char *name;
+				uint64_t value;
+			} counters[] = {
+				{ "signatures", signingstats.signatures },
+				{ "offloaded", signingstats.offloaded },
+				{ "nodes", signingstats.nodes },
+				{ "quanta", signingstats.quanta },
+				{ "usecs", signingstats.usecs },
+			};
+
+			/* counters type="signing"*/
+			TRY0(xmlTextWriterStartElement(writer,
+						       ISC_XMLCHAR "counters"));
+			TRY0(xmlTextWriterWriteAttribute(
+				writer, ISC_XMLCHAR "type",
+				ISC_XMLCHAR "signing"));
+
+			for (size_t i = 0; i < ARRAY_SIZE(counters); i++) {
+				TRY0(xmlTextWriterStartElement(
+					writer, ISC_XMLCHAR "counter"));
+				TRY0(xmlTextWriterWriteAttribute(
+					writer, ISC_XMLCHAR "name",
+					ISC_XMLCHAR counters[i].name));
+				TRY0(xmlTextWriterWriteFormatString(
+					writer, "%" PRIu64, counters[i].value));
+				TRY0(xmlTextWriterEndElement(writer));
+			}
+
+			/* counters type="signing"*/
+			TRY0(xmlTextWriterEndElement(writer));
+		}
+
+		dns_zone_getdumpstats(zone, &dumpstats);
+		if (dumpstats.dumps > 0) {
+			const struct {
+				const char *name;
+				uint64_t value;
+			} counters[] = {
+				{ "dumps", dumpstats.dumps },
+				{ "failed", dumpstats.failed },
+				{ "bytes", dumpstats.bytes },
+				{ "usecs", dumpstats.usecs },
+				{ "last-bytes", dumpstats.lastbytes },
+				{ "last-usecs", dumpstats.lastusecs },
+			};
+
+			/* counters type="dump"*/
+			TRY0(xmlTextWriterStartElement(writer,
+						       ISC_XMLCHAR "counters"));
+			TRY0(xmlTextWriterWriteAttribute(writer,
+							 ISC_XMLCHAR "type",
+							 ISC_XMLCHAR "dump"));
+
+			for (size_t i = 0; i < ARRAY_SIZE(counters); i++) {
+				TRY0(xmlTextWriterStartElement(
+					writer, ISC_XMLCHAR "counter"));
+				TRY0(xmlTextWriterWriteAttribute(
+					writer, ISC_XMLCHAR "name",
+					ISC_XMLCHAR counters[i].name));
+				TRY0(xmlTextWriterWriteFormatString(
+					writer, "%" PRIu64, counters[i].value));
+				TRY0(xmlTextWriterEndElement(writer));
+			}
+
+			/* counters type="dump"*/
+			TRY0(xmlTextWriterEndElement(writer));
+		}
 	}
 
 	TRY0(xmlTextWriterEndElement(writer)); /* zone */
@@ -1726,6 +1879,107 @@ cleanup:
 	return (ISC_R_FAILURE);
 }
 
+static isc_result_t
+peer_xmlrender(const dns_zonemgr_peerstats_t *stats, void *arg) {
+	char addr_buf[ISC_SOCKADDR_FORMATSIZE];
+	xmlTextWriterPtr writer = arg;
+	int xmlrc;
+
+	isc_sockaddr_format(&stats->addr, addr_buf, sizeof(addr_buf));
+
+	TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "server"));
+	TRY0(xmlTextWriterWriteAttribute(writer, ISC_XMLCHAR "address",
+					 ISC_XMLCHAR addr_buf));
+
+	TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "queued"));
+	TRY0(xmlTextWriterWriteFormatString(writer, "%u", stats->queued));
+	TRY0(xmlTextWriterEndElement(writer));
+
+	TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "inflight"));
+	TRY0(xmlTextWriterWriteFormatString(writer, "%u", stats->inflight));
+	TRY0(xmlTextWriterEndElement(writer));
+
+	TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "window"));
+	TRY0(xmlTextWriterWriteFormatString(writer, "%u", stats->window));
+	TRY0(xmlTextWriterEndElement(writer));
+
+	TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "completed"));
+	TRY0(xmlTextWriterWriteFormatString(writer, "%" PRIu64,
+					    stats->completed));
+	TRY0(xmlTextWriterEndElement(writer));
+
+	TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "failed"));
+	TRY0(xmlTextWriterWriteFormatString(writer, "%" PRIu64,
+					    stats->failed));
+	TRY0(xmlTextWriterEndElement(writer));
+
+	TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "srtt"));
+	TRY0(xmlTextWriterWriteFormatString(writer, "%" PRIu64, stats->srtt));
+	TRY0(xmlTextWriterEndElement(writer));
+
+	TRY0(xmlTextWriterEndElement(writer)); /* server */
+
+	return (ISC_R_SUCCESS);
+
+cleanup:
+	isc_log_write(NAMED_LOGCATEGORY_GENERAL, NAMED_LOGMODULE_SERVER,
+		      ISC_LOG_ERROR, "Failed at peer_xmlrender()");
+
+	return (ISC_R_FAILURE);
+}
+
+static isc_result_t
+slabpool_xmlrender(const dns_slabpool_stats_t *stats, xmlTextWriterPtr writer) {
+	int xmlrc;
+
+	TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "rdataslabpool"));
+
+	TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "entries"));
+	TRY0(xmlTextWriterWriteFormatString(writer, "%" PRIu64,
+					    stats->entries));
+	TRY0(xmlTextWriterEndElement(writer));
+
+	TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "references"));
+	TRY0(xmlTextWriterWriteFormatString(writer, "%" PRIu64,
+					    stats->references));
+	TRY0(xmlTextWriterEndElement(writer));
+
+	TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "dedupratio"));
+	TRY0(xmlTextWriterWriteFormatString(
+		writer, "%.2f",
+		stats->entries == 0
+			? 1.0
+			: (double)stats->references / stats->entries));
+	TRY0(xmlTextWriterEndElement(writer));
+
+	TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "InUse"));
+	TRY0(xmlTextWriterWriteFormatString(writer, "%" PRIu64, stats->bytes));
+	TRY0(xmlTextWriterEndElement(writer));
+
+	TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "Saved"));
+	TRY0(xmlTextWriterWriteFormatString(writer, "%" PRIu64, stats->saved));
+	TRY0(xmlTextWriterEndElement(writer));
+
+	TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "lookups"));
+	TRY0(xmlTextWriterWriteFormatString(writer, "%" PRIu64,
+					    stats->lookups));
+	TRY0(xmlTextWriterEndElement(writer));
+
+	TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "hits"));
+	TRY0(xmlTextWriterWriteFormatString(writer, "%" PRIu64, stats->hits));
+	TRY0(xmlTextWriterEndElement(writer));
+
+	TRY0(xmlTextWriterEndElement(writer)); /* rdataslabpool */
+
+	return (ISC_R_SUCCESS);
+
+cleanup:
+	isc_log_write(NAMED_LOGCATEGORY_GENERAL, NAMED_LOGMODULE_SERVER,
+		      ISC_LOG_ERROR, "Failed at slabpool_xmlrender()");
+
+	return (ISC_R_FAILURE);
+}
+
 static isc_result_t
 generatexml(named_server_t *server, uint32_t flags, int *buflen,
 	    xmlChar **buf) {
@@ -2109,9 +2363,31 @@ generatexml(named_server_t *server, uint32_t flags, int *buflen,
 	}
 	TRY0(xmlTextWriterEndElement(writer)); /* /views */
 
+	if ((flags & STATS_XML_XFRINS) != 0) {
+		TRY0(xmlTextWriterStartElement(writer,
+					       ISC_XMLCHAR "refreshes"));
+		CHECK(dns_zonemgr_refreshstats(server->zonemgr, peer_xmlrender,
+					       writer));
+		TRY0(xmlTextWriterEndElement(writer)); /* /refreshes */
+	}
+
+	if ((flags & STATS_XML_SERVER) != 0) {
+		TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "notifies"));
+		CHECK(dns_zonemgr_notifystats(server->zonemgr, peer_xmlrender,
+					      writer));
+		TRY0(xmlTextWriterEndElement(writer)); /* /notifies */
+	}
+
 	if ((flags & STATS_XML_MEM) != 0) {
+		dns_slabpool_stats_t slabstats;
+
 		TRY0(xmlTextWriterStartElement(writer, ISC_XMLCHAR "memory"));
 		TRY0(isc_mem_renderxml(writer));
+		if (dns_zonemgr_getslabpoolstats(server->zonemgr, &slabstats) ==
+		    ISC_R_SUCCESS)
+		{
+			CHECK(slabpool_xmlrender(&slabstats, writer));
+		}
 		TRY0(xmlTextWriterEndElement(writer)); /* /memory */
 	}
 
@@ -2383,6 +2659,9 @@ zone_jsonrender(dns_zone_t *zone, void *arg) {
 		dns_stats_t *dnssecsignstats;
 		uint64_t nsstat_values[ns_statscounter_max];
 		uint64_t gluecachestats_values[dns_gluecachestatscounter_max];
+		uint64_t owned, shared;
+		dns_zone_signingstats_t signingstats;
+		dns_zone_dumpstats_t dumpstats;
 
 		zonestats = dns_zone_getrequeststats(zone);
 		if (zonestats != NULL) {
@@ -2508,6 +2787,68 @@ zone_jsonrender(dns_zone_t *zone, void *arg) {
 				json_object_put(refresh_counters);
 			}
 		}
+
+		if (dns_zone_getslabstats(zone, &owned, &shared) ==
+		    ISC_R_SUCCESS)
+		{
+			json_object *counters = json_object_new_object();
+			CHECKMEM(counters);
+
+			json_object_object_add(counters, "owned",
+					       json_object_new_int64(owned));
+			json_object_object_add(counters, "shared",
+					       json_object_new_int64(shared));
+			json_object_object_add(zoneobj, "rdataslab", counters);
+		}
+
+		dns_zone_getsigningstats(zone, &signingstats);
+		if (signingstats.quanta > 0) {
+			json_object *counters = json_object_new_object();
+			CHECKMEM(counters);
+
+			json_object_object_add(
+				counters, "signatures",
+				json_object_new_int64(signingstats.signatures));
+			json_object_object_add(
+				counters, "offloaded",
+				json_object_new_int64(signingstats.offloaded));
+			json_object_object_add(
+				counters, "nodes",
+				json_object_new_int64(signingstats.nodes));
+			json_object_object_add(
+				counters, "quanta",
+				json_object_new_int64(signingstats.quanta));
+			json_object_object_add(
+				counters, "usecs",
+				json_object_new_int64(signingstats.usecs));
+			json_object_object_add(zoneobj, "signing", counters);
+		}
+
+		dns_zone_getdumpstats(zone, &dumpstats);
+		if (dumpstats.dumps > 0) {
+			json_object *counters = json_object_new_object();
+			CHECKMEM(counters);
+
+			json_object_object_add(
+				counters, "dumps",
+				json_object_new_int64(dumpstats.dumps));
+			json_object_object_add(
+				counters, "failed",
+				json_object_new_int64(dumpstats.failed));
+			json_object_object_add(
+				counters, "bytes",
+				json_object_new_int64(dumpstats.bytes));
+			json_object_object_add(
+				counters, "usecs",
+				json_object_new_int64(dumpstats.usecs));
+			json_object_object_add(
+				counters, "last-bytes",
+				json_object_new_int64(dumpstats.lastbytes));
+			json_object_object_add(
+				counters, "last-usecs",
+				json_object_new_int64(dumpstats.lastusecs));
+			json_object_object_add(zoneobj, "dump", counters);
+		}
 	}
 
 	json_object_array_add(zonearray, zoneobj);
@@ -2775,6 +3116,67 @@ cleanup:
 	return (result);
 }
 
+static isc_result_t
+peer_jsonrender(const dns_zonemgr_peerstats_t *stats, void *arg) {
+	char addr_buf[ISC_SOCKADDR_FORMATSIZE];
+	json_object *peerarray = (json_object *)arg;
+	json_object *peerobj = NULL;
+
+	peerobj = json_object_new_object();
+	if (peerobj == NULL) {
+		return (ISC_R_NOMEMORY);
+	}
+
+	isc_sockaddr_format(&stats->addr, addr_buf, sizeof(addr_buf));
+	json_object_object_add(peerobj, "address",
+			       json_object_new_string(addr_buf));
+	json_object_object_add(peerobj, "queued",
+			       json_object_new_int64(stats->queued));
+	json_object_object_add(peerobj, "inflight",
+			       json_object_new_int64(stats->inflight));
+	json_object_object_add(peerobj, "window",
+			       json_object_new_int64(stats->window));
+	json_object_object_add(peerobj, "completed",
+			       json_object_new_int64(stats->completed));
+	json_object_object_add(peerobj, "failed",
+			       json_object_new_int64(stats->failed));
+	json_object_object_add(peerobj, "srtt",
+			       json_object_new_int64(stats->srtt));
+
+	json_object_array_add(peerarray, peerobj);
+
+	return (ISC_R_SUCCESS);
+}
+
+static json_object *
+slabpool_jsonrender(const dns_slabpool_stats_t *stats) {
+	json_object *obj = json_object_new_object();
+
+	if (obj == NULL) {
+		return (NULL);
+	}
+
+	json_object_object_add(obj, "entries",
+			       json_object_new_int64(stats->entries));
+	json_object_object_add(obj, "references",
+			       json_object_new_int64(stats->references));
+	json_object_object_add(
+		obj, "dedupratio",
+		json_object_new_double(
+			stats->entries == 0
+				? 1.0
+				: (double)stats->references / stats->entries));
+	json_object_object_add(obj, "InUse",
+			       json_object_new_int64(stats->bytes));
+	json_object_object_add(obj, "Saved",
+			       json_object_new_int64(stats->saved));
+	json_object_object_add(obj, "lookups",
+			       json_object_new_int64(stats->lookups));
+	json_object_object_add(obj, "hits", json_object_new_int64(stats->hits));
+
+	return (obj);
+}
+
 static isc_result_t
 generatejson(named_server_t *server, size_t *msglen, const char **msg,
 	     json_object **rootp, uint32_t flags) {
@@ -3179,7 +3581,45 @@ generatejson(named_server_t *server, size_t *msglen, const char **msg,
 		}
 	}
 
+	if ((flags & STATS_JSON_XFRINS) != 0) {
+		json_object *refreshes = json_object_new_array();
+		CHECKMEM(refreshes);
+
+		result = dns_zonemgr_refreshstats(
+			server->zonemgr, peer_jsonrender, refreshes);
+		if (result != ISC_R_SUCCESS) {
+			json_object_put(refreshes);
+			goto cleanup;
+		}
+
+		if (json_object_array_length(refreshes) != 0) {
+			json_object_object_add(bindstats, "refreshes",
+					       refreshes);
+		} else {
+			json_object_put(refreshes);
+		}
+	}
+
+	if ((flags & STATS_JSON_SERVER) != 0) {
+		json_object *notifies = json_object_new_array();
+		CHECKMEM(notifies);
+
+		result = dns_zonemgr_notifystats(server->zonemgr,
+						 peer_jsonrender, notifies);
+		if (result != ISC_R_SUCCESS) {
+			json_object_put(notifies);
+			goto cleanup;
+		}
+
+		if (json_object_array_length(notifies) != 0) {
+			json_object_object_add(bindstats, "notifies", notifies);
+		} else {
+			json_object_put(notifies);
+		}
+	}
+
 	if ((flags & STATS_JSON_MEM) != 0) {
+		dns_slabpool_stats_t slabstats;
 		json_object *memory = json_object_new_object();
 		CHECKMEM(memory);
 
@@ -3189,6 +3629,18 @@ generatejson(named_server_t *server, size_t *msglen, const char **msg,
 			goto cleanup;
 		}
 
+		if (dns_zonemgr_getslabpoolstats(server->zonemgr, &slabstats) ==
+		    ISC_R_SUCCESS)
+		{
+			json_object *pool = slabpool_jsonrender(&slabstats);
+			if (pool == NULL) {
+				json_object_put(memory);
+				result = ISC_R_NOMEMORY;
+				goto cleanup;
+			}
+			json_object_object_add(memory, "rdataslabpool", pool);
+		}
+
 		json_object_object_add(bindstats, "memory", memory);
 	}
 
@@ -897,6 +897,7 @@ named_zone_configure(const cfg_obj_t *config, const cfg_obj_t *vconfig,
 	bool use_kasp = false;
 	dns_masterformat_t masterformat;
 	const dns_master_style_t *masterstyle = &dns_master_style_default;
+	dns_dumpopts_t dumpopts = { 0 };
 	isc_stats_t *zoneqrystats;
 	dns_stats_t *rcvquerystats;
 	dns_stats_t *dnssecsignstats;
@@ -1105,6 +1106,25 @@ named_zone_configure(const cfg_obj_t *config, const cfg_obj_t *vconfig,
 				       masterstyle));
 	}
 
+	obj = NULL;
+	result = named_config_get(maps, "max-dump-rate", &obj);
+	INSIST(result == ISC_R_SUCCESS && obj != NULL);
+	if (!cfg_obj_isstring(obj)) {
+		dumpopts.maxrate = cfg_obj_asuint64(obj);
+	}
+
+	obj = NULL;
+	result = named_config_get(maps, "dump-sync-size", &obj);
+	INSIST(result == ISC_R_SUCCESS && obj != NULL);
+	if (!cfg_obj_isstring(obj)) {
+		dumpopts.syncsize = cfg_obj_asuint64(obj);
+	}
+
+	dns_zone_setdumpopts(zone, &dumpopts);
+	if (raw != NULL) {
+		dns_zone_setdumpopts(raw, &dumpopts);
+	}
+
 	obj = NULL;
 	result = cfg_map_get(zoptions, "journal", &obj);
 	if (result == ISC_R_SUCCESS) {
@@ -1582,6 +1602,11 @@ named_zone_configure(const cfg_obj_t *config, const cfg_obj_t *vconfig,
 		INSIST(result == ISC_R_SUCCESS && obj != NULL);
 		dns_zone_setprivatetype(zone, cfg_obj_asuint32(obj));
 
+		obj = NULL;
+		result = named_config_get(maps, "sig-signing-workers", &obj);
+		INSIST(result == ISC_R_SUCCESS && obj != NULL);
+		dns_zone_setsigningworkers(zone, cfg_obj_asuint32(obj));
+
 		obj = NULL;
 		result = named_config_get(maps, "dnssec-loadkeys-interval",
 					  &obj);
@@ -2652,6 +2652,55 @@ wait_for_soa @10.53.0.4 tls1.example. dig.out.test$n || ret=1
 if [ $ret -ne 0 ]; then echo_i "failed"; fi
 status=$((status + ret))
 
+##########################################################################
+echo_i "Testing adding and deleting a member zone in quick succession"
+n=$((n + 1))
+echo_i "Adding a domain domaddel.example. to primary via RNDC ($n)"
+ret=0
+echo "@ 3600 IN SOA . . 1 3600 3600 3600 3600" >ns1/domaddel.example.db
+echo "@ 3600 IN NS invalid." >>ns1/domaddel.example.db
+rndccmd 10.53.0.1 addzone domaddel.example. in default '{ type primary; file "domaddel.example.db"; };' || ret=1
+wait_for_soa @10.53.0.1 domaddel.example. dig.out.test$n || ret=1
+if [ $ret -ne 0 ]; then echo_i "failed"; fi
+status=$((status + ret))
+
+nextpart ns2/named.run >/dev/null
+
+n=$((n + 1))
+echo_i "adding domain domaddel.example. to catalog1 zone and deleting it again ($n)"
+ret=0
+$NSUPDATE -d <<END >>nsupdate.out.test$n 2>&1 || ret=1
+    server 10.53.0.1 ${PORT}
+    update add domaddel.zones.catalog1.example. 3600 IN PTR domaddel.example.
+    send
+    update delete domaddel.zones.catalog1.example. 3600 IN PTR domaddel.example.
+    send
+END
+if [ $ret -ne 0 ]; then echo_i "failed"; fi
+status=$((status + ret))
+
+n=$((n + 1))
+echo_i "waiting for secondary to sync up ($n)"
+ret=0
+wait_for_catalog1_serial() {
+  dig_with_opts @10.53.0.1 SOA catalog1.example. +short >dig.out.ns1.test$n || return 1
+  dig_with_opts @10.53.0.2 SOA catalog1.example. +short >dig.out.ns2.test$n || return 1
+  [ -s dig.out.ns1.test$n ] && cmp -s dig.out.ns1.test$n dig.out.ns2.test$n
+}
+retry_quiet 10 wait_for_catalog1_serial || ret=1
+# give the queued member zone changes time to be processed
+sleep 2
+if [ $ret -ne 0 ]; then echo_i "failed"; fi
+status=$((status + ret))
+
+n=$((n + 1))
+echo_i "checking that domaddel.example. is not served or loaded by secondary ($n)"
+ret=0
+wait_for_no_soa @10.53.0.2 domaddel.example. dig.out.test$n || ret=1
+[ -f "ns2/zonedir/__catz__default_catalog1.example_domaddel.example.db" ] && ret=1
+if [ $ret -ne 0 ]; then echo_i "failed"; fi
+status=$((status + ret))
+
 ##########################################################################
 # GL #3777
 nextpart ns4/named.run >/dev/null
@@ -80,6 +80,27 @@
 
 #define DNS_ADB_MINADBSIZE (1024U * 1024U) /*%< 1 Megabyte */
 
+/*%
+ * Each address keeps a histogram of the round trip times of the UDP
+ * queries that were answered, for dns_adb_rttquantile().  These are the
+ * upper bounds of the buckets in microseconds; the last one takes the
+ * rest.  The counts are halved whenever ADB_RTT_MAXSAMPLES is reached,
+ * so that the histogram follows the recent behavior of the server, and
+ * no quantile is known until ADB_RTT_MINSAMPLES have been counted.
+ */
+static const unsigned int rttbounds[] = {
+	1000,	1500,	2000,	3000,	 4000,	  6000,	   8000,    12000,
+	16000,	24000,	32000,	48000,	 64000,	  96000,   128000,  192000,
+	256000, 384000, 512000, 768000, 1024000, 1536000, 2048000, UINT_MAX,
+};
+
+#define ADB_RTT_BUCKETS	   24
+#define ADB_RTT_MAXSAMPLES 1000
+#define ADB_RTT_MINSAMPLES 10
+
+STATIC_ASSERT(ARRAY_SIZE(rttbounds) == ADB_RTT_BUCKETS,
+	      "rttbounds must have ADB_RTT_BUCKETS entries");
+
 typedef ISC_LIST(dns_adbname_t) dns_adbnamelist_t;
 typedef struct dns_adbnamehook dns_adbnamehook_t;
 typedef ISC_LIST(dns_adbnamehook_t) dns_adbnamehooklist_t;
@@ -217,6 +238,8 @@ struct dns_adbentry {
 
 	atomic_uint flags;
 	atomic_uint srtt;
+	uint16_t rtthist[ADB_RTT_BUCKETS];
+	uint16_t rttsamples;
 	unsigned int completed;
 	unsigned int timeouts;
 	unsigned char plain;
@@ -3071,6 +3094,56 @@ adjustsrtt(dns_adbaddrinfo_t *addr, unsigned int rtt, unsigned int factor,
 	}
 }
 
+void
+dns_adb_rttsample(dns_adb_t *adb, dns_adbaddrinfo_t *addr, unsigned int rtt) {
+	REQUIRE(DNS_ADB_VALID(adb));
+	REQUIRE(DNS_ADBADDRINFO_VALID(addr));
+
+	dns_adbentry_t *entry = addr->entry;
+	size_t bucket = 0;
+
+	while (rtt > rttbounds[bucket]) {
+		bucket++;
+	}
+
+	LOCK(&entry->lock);
+	entry->rtthist[bucket]++;
+	if (++entry->rttsamples >= ADB_RTT_MAXSAMPLES) {
+		entry->rttsamples = 0;
+		for (size_t i = 0; i < ADB_RTT_BUCKETS; i++) {
+			entry->rtthist[i] >>= 1;
+			entry->rttsamples += entry->rtthist[i];
+		}
+	}
+	UNLOCK(&entry->lock);
+}
+
+unsigned int
+dns_adb_rttquantile(dns_adb_t *adb, dns_adbaddrinfo_t *addr,
+		    unsigned int permille) {
+	REQUIRE(DNS_ADB_VALID(adb));
+	REQUIRE(DNS_ADBADDRINFO_VALID(addr));
+	REQUIRE(permille > 0 && permille <= 1000);
+
+	dns_adbentry_t *entry = addr->entry;
+	unsigned int rtt = 0, want, seen = 0;
+
+	LOCK(&entry->lock);
+	if (entry->rttsamples >= ADB_RTT_MINSAMPLES) {
+		want = (entry->rttsamples * permille + 999) / 1000;
+		for (size_t i = 0; i < ADB_RTT_BUCKETS; i++) {
+			seen += entry->rtthist[i];
+			if (seen >= want) {
+				rtt = rttbounds[i];
+				break;
+			}
+		}
+	}
+	UNLOCK(&entry->lock);
+
+	return (rtt);
+}
+
 void
 dns_adb_changeflags(dns_adb_t *adb, dns_adbaddrinfo_t *addr, unsigned int bits,
 		    unsigned int mask) {
@@ -82,6 +82,8 @@ struct dns_cache {
 	isc_stats_t *stats;
 	uint32_t maxrrperset;
 	uint32_t maxtypepername;
+	size_t maxncachesize;
+	bool wirerdata;
 };
 
 /***
@@ -132,6 +134,8 @@ cache_create_db(dns_cache_t *cache, dns_db_t **dbp, isc_mem_t **tmctxp,
 	dns_db_setservestalerefresh(db, cache->serve_stale_refresh);
 	dns_db_setmaxrrperset(db, cache->maxrrperset);
 	dns_db_setmaxtypepername(db, cache->maxtypepername);
+	dns_db_setmaxncachesize(db, cache->maxncachesize);
+	dns_db_setwirerdata(db, cache->wirerdata);
 
 	/*
 	 * XXX this is only used by the RBT cache, and can
@@ -288,6 +292,26 @@ dns_cache_getcachesize(dns_cache_t *cache) {
 	return (size);
 }
 
+void
+dns_cache_setmaxncachesize(dns_cache_t *cache, size_t size) {
+	REQUIRE(VALID_CACHE(cache));
+
+	cache->maxncachesize = size;
+	if (cache->db != NULL) {
+		dns_db_setmaxncachesize(cache->db, size);
+	}
+}
+
+void
+dns_cache_setwirerdata(dns_cache_t *cache, bool value) {
+	REQUIRE(VALID_CACHE(cache));
+
+	cache->wirerdata = value;
+	if (cache->db != NULL) {
+		dns_db_setwirerdata(cache->db, value);
+	}
+}
+
 void
 dns_cache_setservestalettl(dns_cache_t *cache, dns_ttl_t ttl) {
 	REQUIRE(VALID_CACHE(cache));
@@ -611,11 +635,13 @@ void
 dns_cache_dumpstats(dns_cache_t *cache, FILE *fp) {
 	int indices[dns_cachestatscounter_max];
 	uint64_t values[dns_cachestatscounter_max];
+	uint64_t positive = 0, negative = 0, proofs = 0;
 
 	REQUIRE(VALID_CACHE(cache));
 
 	getcounters(cache->stats, isc_statsformat_file,
 		    dns_cachestatscounter_max, indices, values);
+	(void)dns_db_getcachemem(cache->db, &positive, &negative, &proofs);
 
 	fprintf(fp, "%20" PRIu64 " %s\n", values[dns_cachestatscounter_hits],
 		"cache hits");
@@ -648,6 +674,13 @@ dns_cache_dumpstats(dns_cache_t *cache, FILE *fp) {
 
 	fprintf(fp, "%20" PRIu64 " %s\n", (uint64_t)isc_mem_inuse(cache->hmctx),
 		"cache heap memory in use");
+
+	fprintf(fp, "%20" PRIu64 " %s\n", positive,
+		"cache positive entries memory in use");
+	fprintf(fp, "%20" PRIu64 " %s\n", negative,
+		"cache negative entries memory in use");
+	fprintf(fp, "%20" PRIu64 " %s\n", proofs,
+		"cache shared negative records memory in use");
 }
 
 #ifdef HAVE_LIBXML2
@@ -675,6 +708,7 @@ int
 dns_cache_renderxml(dns_cache_t *cache, void *writer0) {
 	int indices[dns_cachestatscounter_max];
 	uint64_t values[dns_cachestatscounter_max];
+	uint64_t positive = 0, negative = 0, proofs = 0;
 	int xmlrc;
 	xmlTextWriterPtr writer = (xmlTextWriterPtr)writer0;
 
@@ -682,6 +716,7 @@ dns_cache_renderxml(dns_cache_t *cache, void *writer0) {
 
 	getcounters(cache->stats, isc_statsformat_file,
 		    dns_cachestatscounter_max, indices, values);
+	(void)dns_db_getcachemem(cache->db, &positive, &negative, &proofs);
 	TRY0(renderstat("CacheHits", values[dns_cachestatscounter_hits],
 			writer));
 	TRY0(renderstat("CacheMisses", values[dns_cachestatscounter_misses],
@@ -706,6 +741,10 @@ dns_cache_renderxml(dns_cache_t *cache, void *writer0) {
 	TRY0(renderstat("TreeMemInUse", isc_mem_inuse(cache->tmctx), writer));
 
 	TRY0(renderstat("HeapMemInUse", isc_mem_inuse(cache->hmctx), writer));
+
+	TRY0(renderstat("PositiveMemInUse", positive, writer));
+	TRY0(renderstat("NegativeMemInUse", negative, writer));
+	TRY0(renderstat("SharedNegativeMemInUse", proofs, writer));
 error:
 	return (xmlrc);
 }
@@ -725,6 +764,7 @@ dns_cache_renderjson(dns_cache_t *cache, void *cstats0) {
 	isc_result_t result = ISC_R_SUCCESS;
 	int indices[dns_cachestatscounter_max];
 	uint64_t values[dns_cachestatscounter_max];
+	uint64_t positive = 0, negative = 0, proofs = 0;
 	json_object *obj;
 	json_object *cstats = (json_object *)cstats0;
 
@@ -732,6 +772,7 @@ dns_cache_renderjson(dns_cache_t *cache, void *cstats0) {
 
 	getcounters(cache->stats, isc_statsformat_file,
 		    dns_cachestatscounter_max, indices, values);
+	(void)dns_db_getcachemem(cache->db, &positive, &negative, &proofs);
 
 	obj = json_object_new_int64(values[dns_cachestatscounter_hits]);
 	CHECKMEM(obj);
@@ -783,6 +824,18 @@ dns_cache_renderjson(dns_cache_t *cache, void *cstats0) {
 	CHECKMEM(obj);
 	json_object_object_add(cstats, "HeapMemInUse", obj);
 
+	obj = json_object_new_int64(positive);
+	CHECKMEM(obj);
+	json_object_object_add(cstats, "PositiveMemInUse", obj);
+
+	obj = json_object_new_int64(negative);
+	CHECKMEM(obj);
+	json_object_object_add(cstats, "NegativeMemInUse", obj);
+
+	obj = json_object_new_int64(proofs);
+	CHECKMEM(obj);
+	json_object_object_add(cstats, "SharedNegativeMemInUse", obj);
+
 	result = ISC_R_SUCCESS;
 error:
 	return (result);
@@ -43,21 +43,27 @@ dns_compress_init(dns_compress_t *cctx, isc_mem_t *mctx,
 		mask = count - 1;
 		set = isc_mem_callocate(mctx, count, sizeof(*set));
 	} else {
-		mask = ARRAY_SIZE(cctx->smallset) - 1;
+		size_t count = (1 << DNS_COMPRESS_TINYBITS);
+		mask = count - 1;
 		set = cctx->smallset;
+		memset(set, 0, count * sizeof(*set));
 	}
 
 	/*
 	 * The lifetime of this object is limited to the stack frame of the
 	 * caller, so we don't need to attach to the memory context.
+	 *
+	 * The fields are set one by one so that the unused part of the
+	 * small hash set is not cleared until it is needed (see grow()).
 	 */
-	*cctx = (dns_compress_t){
-		.magic = CCTX_MAGIC,
-		.flags = flags | DNS_COMPRESS_PERMITTED,
-		.mctx = mctx,
-		.mask = mask,
-		.set = set,
-	};
+	cctx->magic = CCTX_MAGIC;
+	cctx->flags = flags | DNS_COMPRESS_PERMITTED;
+	cctx->mask = mask;
+	cctx->count = 0;
+	cctx->mctx = mctx;
+	cctx->set = set;
+	cctx->apex = NULL;
+	cctx->apexcoff = 0;
 }
 
 void
@@ -66,7 +72,9 @@ dns_compress_invalidate(dns_compress_t *cctx) {
 	if (cctx->set != cctx->smallset) {
 		isc_mem_free(cctx->mctx, cctx->set);
 	}
-	*cctx = (dns_compress_t){ 0 };
+	cctx->magic = 0;
+	cctx->set = NULL;
+	cctx->apex = NULL;
 }
 
 void
@@ -217,18 +225,9 @@ slot_index(dns_compress_t *cctx, unsigned int hash, unsigned int probe) {
 	return ((hash + probe) & cctx->mask);
 }
 
-static bool
-insert_label(dns_compress_t *cctx, isc_buffer_t *buffer, const dns_name_t *name,
-	     unsigned int label, uint16_t hash, unsigned int probe) {
-	/*
-	 * hash set entries must have valid compression offsets
-	 * and the hash set must not get too full (75% load)
-	 */
-	unsigned int prefix_len = name->offsets[label];
-	unsigned int coff = isc_buffer_usedlength(buffer) + prefix_len;
-	if (coff >= 0x4000 || cctx->count > cctx->mask * 3 / 4) {
-		return (false);
-	}
+static void
+insert_slot(dns_compress_t *cctx, uint16_t hash, unsigned int coff,
+	    unsigned int probe) {
 	for (;;) {
 		unsigned int slot = slot_index(cctx, hash, probe);
 		/* we can stop when we find an empty slot */
@@ -236,7 +235,7 @@ insert_label(dns_compress_t *cctx, isc_buffer_t *buffer, const dns_name_t *name,
 			cctx->set[slot].hash = hash;
 			cctx->set[slot].coff = coff;
 			cctx->count++;
-			return (true);
+			return;
 		}
 		/* he steals from the rich and gives to the poor */
 		if (probe > probe_distance(cctx, slot)) {
@@ -248,21 +247,82 @@ insert_label(dns_compress_t *cctx, isc_buffer_t *buffer, const dns_name_t *name,
 	}
 }
 
+/*
+ * The small hash set starts with only its first slots in use, which is
+ * enough for most responses; when they get too full, clear the rest of
+ * it and move the entries to where they belong in the whole of it. The
+ * hash values do not depend on the size of the set, so this makes no
+ * difference to the names that are found in it.
+ */
+static bool
+grow(dns_compress_t *cctx) {
+	dns_compress_slot_t tiny[1 << DNS_COMPRESS_TINYBITS];
+
+	if (cctx->set != cctx->smallset ||
+	    cctx->mask == ARRAY_SIZE(cctx->smallset) - 1)
+	{
+		return (false);
+	}
+
+	INSIST(cctx->mask == ARRAY_SIZE(tiny) - 1);
+	memmove(tiny, cctx->smallset, sizeof(tiny));
+	memset(cctx->smallset, 0, sizeof(cctx->smallset));
+	cctx->mask = ARRAY_SIZE(cctx->smallset) - 1;
+	cctx->count = 0;
+
+	for (unsigned int slot = 0; slot < ARRAY_SIZE(tiny); slot++) {
+		if (tiny[slot].coff != 0) {
+			insert_slot(cctx, tiny[slot].hash, tiny[slot].coff, 0);
+		}
+	}
+
+	return (true);
+}
+
+static bool
+insert_label(dns_compress_t *cctx, isc_buffer_t *buffer, const dns_name_t *name,
+	     unsigned int label, uint16_t hash, unsigned int probe) {
+	/*
+	 * hash set entries must have valid compression offsets
+	 * and the hash set must not get too full (75% load)
+	 */
+	unsigned int prefix_len = name->offsets[label];
+	unsigned int coff = isc_buffer_usedlength(buffer) + prefix_len;
+	if (coff >= 0x4000) {
+		return (false);
+	}
+	if (cctx->count > cctx->mask * 3 / 4) {
+		if (!grow(cctx)) {
+			return (false);
+		}
+		/* the probe sequence starts over in the larger set */
+		probe = 0;
+	}
+	insert_slot(cctx, hash, coff, probe);
+	return (true);
+}
+
 /*
  * Add the unmatched prefix of the name to the hash set.
  */
 static void
 insert(dns_compress_t *cctx, isc_buffer_t *buffer, const dns_name_t *name,
-       unsigned int label, uint16_t hash, unsigned int probe) {
+       unsigned int label, uint16_t hash, unsigned int probe,
+       unsigned int apexlabel) {
 	bool sensitive = (cctx->flags & DNS_COMPRESS_CASE) != 0;
 	/*
 	 * this insertion loop continues from the search loop inside
 	 * dns_compress_name() below, iterating over the remaining labels
 	 * of the name and accumulating the hash in the same manner
 	 */
-	while (insert_label(cctx, buffer, name, label, hash, probe) &&
-	       label-- > 0)
-	{
+	while (insert_label(cctx, buffer, name, label, hash, probe)) {
+		if (label == apexlabel) {
+			cctx->apexcoff = isc_buffer_usedlength(buffer) +
+					 name->offsets[label];
+		}
+		if (label-- == 0) {
+			break;
+		}
 		unsigned int prefix_len = name->offsets[label];
 		uint8_t *suffix_ptr = name->ndata + prefix_len;
 		hash = hash_label(hash, suffix_ptr, sensitive);
@@ -270,6 +330,32 @@ insert(dns_compress_t *cctx, isc_buffer_t *buffer, const dns_name_t *name,
 	}
 }
 
+/*
+ * If the name is at or below the apex of the zone template, return the
+ * index of the first label of the apex in the name; otherwise return
+ * the number of labels in the name, which is not a valid index.
+ */
+static unsigned int
+apex_label(dns_compress_t *cctx, const dns_name_t *name, bool sensitive) {
+	const dns_name_t *apex = cctx->apex->name;
+	unsigned int label, prefix_len;
+
+	if (name->labels < apex->labels) {
+		return (name->labels);
+	}
+
+	label = name->labels - apex->labels;
+	prefix_len = name->offsets[label];
+	if (name->length - prefix_len != apex->length ||
+	    !match_wirename(name->ndata + prefix_len, apex->ndata,
+			    apex->length, sensitive))
+	{
+		return (name->labels);
+	}
+
+	return (label);
+}
+
 void
 dns_compress_name(dns_compress_t *cctx, isc_buffer_t *buffer,
 		  const dns_name_t *name, unsigned int *return_prefix,
@@ -291,6 +377,23 @@ dns_compress_name(dns_compress_t *cctx, isc_buffer_t *buffer,
 
 	uint16_t hash = HASH_INIT_DJB2;
 	unsigned int label = name->labels - 1; /* skip the root label */
+	unsigned int apexlabel = name->labels; /* not below the apex */
+
+	if (cctx->apex != NULL) {
+		apexlabel = apex_label(cctx, name, sensitive);
+	}
+
+	/*
+	 * once the apex is in the message, we already know where the
+	 * longest suffix that this name has in common with it is, so
+	 * start searching from the label before the apex
+	 */
+	if (apexlabel < name->labels && cctx->apexcoff != 0) {
+		label = apexlabel;
+		hash = sensitive ? cctx->apex->hash : cctx->apex->lowerhash;
+		*return_coff = cctx->apexcoff;
+		*return_prefix = name->offsets[label];
+	}
 
 	/*
 	 * find out how much of the name's suffix is in the hash set,
@@ -313,7 +416,8 @@ dns_compress_name(dns_compress_t *cctx, isc_buffer_t *buffer,
 			 * the rest of the name (its prefix) into the set
 			 */
 			if (coff == 0 || probe > probe_distance(cctx, slot)) {
-				insert(cctx, buffer, name, label, hash, probe);
+				insert(cctx, buffer, name, label, hash, probe,
+				       apexlabel);
 				return;
 			}
 
@@ -327,6 +431,9 @@ dns_compress_name(dns_compress_t *cctx, isc_buffer_t *buffer,
 			{
 				*return_coff = coff;
 				*return_prefix = prefix_len;
+				if (label == apexlabel) {
+					cctx->apexcoff = coff;
+				}
 				break;
 			}
 		}
@@ -337,8 +444,13 @@ void
 dns_compress_rollback(dns_compress_t *cctx, unsigned int coff) {
 	REQUIRE(CCTX_VALID(cctx));
 
-	for (unsigned int slot = 0; slot <= cctx->mask; slot++) {
-		if (cctx->set[slot].coff < coff) {
+	if (cctx->apexcoff >= coff) {
+		cctx->apexcoff = 0;
+	}
+
+	for (unsigned int slot = 0; slot <= cctx->mask;) {
+		if (cctx->set[slot].coff == 0 || cctx->set[slot].coff < coff) {
+			slot++;
 			continue;
 		}
 		/*
@@ -360,5 +472,50 @@ dns_compress_rollback(dns_compress_t *cctx, unsigned int coff) {
 		cctx->set[prev].coff = 0;
 		cctx->set[prev].hash = 0;
 		cctx->count--;
+		/*
+		 * An entry may have slid into this slot; look at it again,
+		 * otherwise whether it survives depends on the table size.
+		 */
+	}
+}
+
+void
+dns_compress_apexinit(dns_compress_apex_t *apex, const dns_name_t *name) {
+	dns_offsets_t offsets;
+	dns_name_t clone;
+	uint16_t hash = HASH_INIT_DJB2;
+	uint16_t lowerhash = HASH_INIT_DJB2;
+
+	REQUIRE(apex != NULL);
+	REQUIRE(DNS_NAME_VALID(name));
+	REQUIRE(dns_name_isabsolute(name));
+
+	dns_name_init(&clone, offsets);
+	dns_name_clone(name, &clone);
+
+	/* the same as the search loop in dns_compress_name() */
+	unsigned int label = clone.labels - 1;
+	while (label-- > 0) {
+		uint8_t *suffix_ptr = clone.ndata + clone.offsets[label];
+		hash = hash_label(hash, suffix_ptr, true);
+		lowerhash = hash_label(lowerhash, suffix_ptr, false);
+	}
+
+	*apex = (dns_compress_apex_t){
+		.name = name,
+		.hash = hash,
+		.lowerhash = lowerhash,
+	};
+}
+
+void
+dns_compress_setapex(dns_compress_t *cctx, const dns_compress_apex_t *apex) {
+	REQUIRE(CCTX_VALID(cctx));
+	REQUIRE(cctx->count == 0);
+	REQUIRE(apex != NULL && DNS_NAME_VALID(apex->name));
+
+	if (apex->name->labels > 1) {
+		cctx->apex = apex;
+		cctx->apexcoff = 0;
 	}
 }
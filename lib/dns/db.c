@@ -1188,3 +1188,61 @@ dns_db_setmaxtypepername(dns_db_t *db, uint32_t value) {
 		(db->methods->setmaxtypepername)(db, value);
 	}
 }
+
+void
+dns_db_setslabsharing(dns_db_t *db, bool value) {
+	REQUIRE(DNS_DB_VALID(db));
+
+	if (db->methods->setslabsharing != NULL) {
+		(db->methods->setslabsharing)(db, value);
+	}
+}
+
+void
+dns_db_setslabpool(dns_db_t *db, dns_slabpool_t *pool) {
+	REQUIRE(DNS_DB_VALID(db));
+
+	if (db->methods->setslabpool != NULL) {
+		(db->methods->setslabpool)(db, pool);
+	}
+}
+
+isc_result_t
+dns_db_getslabstats(dns_db_t *db, uint64_t *owned, uint64_t *shared) {
+	REQUIRE(DNS_DB_VALID(db));
+
+	if (db->methods->getslabstats != NULL) {
+		return ((db->methods->getslabstats)(db, owned, shared));
+	}
+	return (ISC_R_NOTIMPLEMENTED);
+}
+
+void
+dns_db_setmaxncachesize(dns_db_t *db, size_t size) {
+	REQUIRE(DNS_DB_VALID(db));
+
+	if (db->methods->setmaxncachesize != NULL) {
+		(db->methods->setmaxncachesize)(db, size);
+	}
+}
+
+isc_result_t
+dns_db_getcachemem(dns_db_t *db, uint64_t *positive, uint64_t *negative,
+		   uint64_t *proofs) {
+	REQUIRE(DNS_DB_VALID(db));
+
+	if (db->methods->getcachemem != NULL) {
+		return ((db->methods->getcachemem)(db, positive, negative,
+						   proofs));
+	}
+	return (ISC_R_NOTIMPLEMENTED);
+}
+
+void
+dns_db_setwirerdata(dns_db_t *db, bool value) {
+	REQUIRE(DNS_DB_VALID(db));
+
+	if (db->methods->setwirerdata != NULL) {
+		(db->methods->setwirerdata)(db, value);
+	}
+}
@@ -47,6 +47,30 @@
 
 typedef ISC_LIST(dns_dispentry_t) dns_displist_t;
 
+/*%
+ * An idle connected UDP socket, kept for the next query to the same
+ * server (see dns_dispatchmgr_setudpreuse()).
+ */
+typedef struct udpsock udpsock_t;
+struct udpsock {
+	isc_nmhandle_t *handle;
+	isc_sockaddr_t local;
+	isc_sockaddr_t peer;
+	isc_time_t opened;
+	unsigned int uses; /*%< number of queries sent so far */
+	ISC_LINK(udpsock_t) link;
+};
+
+/*%
+ * The idle UDP sockets of a loop; only used from that loop.
+ */
+typedef struct udppool {
+	ISC_LIST(udpsock_t) socks;
+	unsigned int nsocks;
+	bool registered; /*%< the teardown job has been set up */
+	bool shutdown;
+} udppool_t;
+
 struct dns_dispatchmgr {
 	/* Unlocked. */
 	unsigned int magic;
@@ -66,6 +90,9 @@ struct dns_dispatchmgr {
 	unsigned int nv4ports; /*%< # of available ports for IPv4 */
 	in_port_t *v6ports;    /*%< available ports for IPv4 */
 	unsigned int nv6ports; /*%< # of available ports for IPv4 */
+
+	atomic_uint_fast32_t udpreuse; /*%< max queries per UDP socket */
+	udppool_t *udppools;	       /*%< idle UDP sockets, per loop */
 };
 
 typedef enum {
@@ -88,6 +115,9 @@ struct dns_dispentry {
 	unsigned int retries;
 	unsigned int timeout;
 	isc_time_t start;
+	isc_time_t opened; /*%< when the UDP socket was opened */
+	unsigned int uses; /*%< earlier queries on the UDP socket */
+	bool reusable;	   /*%< the UDP socket can be pooled */
 	isc_sockaddr_t local;
 	isc_sockaddr_t peer;
 	in_port_t port;
@@ -120,8 +150,10 @@ struct dns_dispatch {
 
 	dns_dispatchopt_t options;
 	dns_dispatchstate_t state;
+	dns_transport_t *transport; /*%< transport of a pooled TCP dispatch */
 
 	bool reading;
+	bool pooled; /*%< the pool holds a reference while idle */
 
 	dns_displist_t pending;
 	dns_displist_t active;
@@ -162,6 +194,21 @@ ISC_REFCOUNT_DECL(dns_dispentry);
  */
 #define QID_MAX_TRIES 64
 
+/*
+ * The number of queries outstanding on a pooled TCP connection before
+ * another connection to the same server is opened, and how long, in
+ * milliseconds, an idle pooled connection is kept open.
+ */
+#define POOL_DEPTH 100
+#define POOL_IDLE  5000
+
+/*
+ * The number of idle UDP sockets kept by each loop, and how long, in
+ * milliseconds, a UDP socket may be reused for after it was opened.
+ */
+#define UDP_POOL_SIZE	  64
+#define UDP_POOL_LIFETIME 2000
+
 /*
  * Initial and minimum QID table sizes.
  */
@@ -332,8 +379,141 @@ dispentry_log(dns_dispentry_t *resp, int level, const char *fmt, ...) {
 		     socktype2str(resp), resp, msgbuf);
 }
 
+static void
+udpsock_free(dns_dispatchmgr_t *mgr, udpsock_t *sock) {
+	isc_nmhandle_detach(&sock->handle);
+	isc_mem_put(mgr->mctx, sock, sizeof(*sock));
+}
+
+static bool
+udpsock_expired(const isc_time_t *opened, const isc_time_t *now) {
+	return (isc_time_microdiff(now, opened) / 1000 >= UDP_POOL_LIFETIME);
+}
+
+static void
+udppool_shutdown(void *arg) {
+	dns_dispatchmgr_t *mgr = arg;
+	udppool_t *pool = &mgr->udppools[isc_tid()];
+	udpsock_t *sock = NULL, *next = NULL;
+
+	ISC_LIST_FOREACH_SAFE (pool->socks, sock, link, next) {
+		ISC_LIST_UNLINK(pool->socks, sock, link);
+		udpsock_free(mgr, sock);
+	}
+	pool->nsocks = 0;
+	pool->shutdown = true;
+
+	dns_dispatchmgr_unref(mgr);
+}
+
+/*%
+ * Take an idle socket connected from the address of 'resp->local' to
+ * 'resp->peer' out of the pool of the current loop.
+ */
+static bool
+udppool_get(dns_dispatchmgr_t *mgr, dns_dispentry_t *resp) {
+	udppool_t *pool = &mgr->udppools[isc_tid()];
+	udpsock_t *sock = NULL, *prev = NULL;
+	isc_time_t now;
+
+	if (ISC_LIST_EMPTY(pool->socks)) {
+		return (false);
+	}
+
+	now = isc_loop_now(isc_loop());
+	ISC_LIST_FOREACH_REV_SAFE (pool->socks, sock, link, prev) {
+		if (!isc_sockaddr_equal(&sock->peer, &resp->peer) ||
+		    !isc_sockaddr_eqaddr(&sock->local, &resp->local))
+		{
+			continue;
+		}
+
+		ISC_LIST_UNLINK(pool->socks, sock, link);
+		pool->nsocks--;
+
+		if (udpsock_expired(&sock->opened, &now)) {
+			udpsock_free(mgr, sock);
+			continue;
+		}
+
+		resp->handle = sock->handle;
+		resp->local = sock->local;
+		resp->opened = sock->opened;
+		resp->uses = sock->uses;
+		sock->handle = NULL;
+		isc_mem_put(mgr->mctx, sock, sizeof(*sock));
+
+		return (true);
+	}
+
+	return (false);
+}
+
 /*%
- * Choose a random port number for a dispatch entry.
+ * Keep the socket of a finished UDP query for the next query to the
+ * same server, unless it has been used for long enough already.  The
+ * sockets are only reused after their last read succeeded; the others
+ * have been closed by the network manager.
+ */
+static bool
+udppool_put(dns_dispentry_t *resp) {
+	dns_dispatch_t *disp = resp->disp;
+	dns_dispatchmgr_t *mgr = disp->mgr;
+	udppool_t *pool = NULL;
+	udpsock_t *sock = NULL, *next = NULL;
+	isc_time_t now;
+
+	if (!resp->reusable || resp->reading || disp->tid != isc_tid() ||
+	    resp->uses + 1 >= atomic_load_relaxed(&mgr->udpreuse))
+	{
+		return (false);
+	}
+
+	pool = &mgr->udppools[disp->tid];
+	now = isc_loop_now(isc_loop());
+	if (pool->shutdown || udpsock_expired(&resp->opened, &now)) {
+		return (false);
+	}
+
+	if (!pool->registered) {
+		/* The pooled sockets must be closed before the loop stops */
+		pool->registered = true;
+		dns_dispatchmgr_ref(mgr);
+		(void)isc_loop_teardown(isc_loop(), udppool_shutdown, mgr);
+	}
+
+	/* Close the sockets nobody has asked for in a while */
+	ISC_LIST_FOREACH_SAFE (pool->socks, sock, link, next) {
+		if (pool->nsocks < UDP_POOL_SIZE &&
+		    !udpsock_expired(&sock->opened, &now))
+		{
+			continue;
+		}
+		ISC_LIST_UNLINK(pool->socks, sock, link);
+		pool->nsocks--;
+		udpsock_free(mgr, sock);
+	}
+
+	sock = isc_mem_get(mgr->mctx, sizeof(*sock));
+	*sock = (udpsock_t){
+		.local = resp->local,
+		.peer = resp->peer,
+		.opened = resp->opened,
+		.uses = resp->uses + 1,
+		.link = ISC_LINK_INITIALIZER,
+	};
+	sock->handle = resp->handle;
+	resp->handle = NULL;
+
+	ISC_LIST_APPEND(pool->socks, sock, link);
+	pool->nsocks++;
+
+	return (true);
+}
+
+/*%
+ * Choose a random port number for a dispatch entry, or an idle socket
+ * to the same server from the pool.
  */
 static isc_result_t
 setup_socket(dns_dispatch_t *disp, dns_dispentry_t *resp,
@@ -362,8 +542,13 @@ setup_socket(dns_dispatch_t *disp, dns_dispentry_t *resp,
 	resp->peer = *dest;
 
 	if (port == 0) {
-		port = ports[isc_random_uniform(nports)];
-		isc_sockaddr_setport(&resp->local, port);
+		if (resp->retries == 1 && udppool_get(mgr, resp)) {
+			port = isc_sockaddr_getport(&resp->local);
+			inc_stats(mgr, dns_resstatscounter_udppoolreused);
+		} else {
+			port = ports[isc_random_uniform(nports)];
+			isc_sockaddr_setport(&resp->local, port);
+		}
 		*portp = port;
 	}
 	resp->port = port;
@@ -422,7 +607,7 @@ dispentry_destroy(dns_dispentry_t *resp) {
 
 	dispentry_log(resp, ISC_LOG_DEBUG(90), "destroying");
 
-	if (resp->handle != NULL) {
+	if (resp->handle != NULL && !udppool_put(resp)) {
 		dispentry_log(resp, ISC_LOG_DEBUG(90),
 			      "detaching handle %p from %p", resp->handle,
 			      &resp->handle);
@@ -581,8 +766,10 @@ udp_recv(isc_nmhandle_t *handle, isc_result_t eresult, isc_region_t *region,
 	}
 
 	/*
-	 * We have the right resp, so call the caller back.
+	 * We have the right resp, so call the caller back.  The socket
+	 * can be used for another query now.
 	 */
+	resp->reusable = true;
 	goto done;
 
 next:
@@ -778,6 +965,7 @@ tcp_recv(isc_nmhandle_t *handle, isc_result_t result, isc_region_t *region,
 	dns_displist_t resps = ISC_LIST_INITIALIZER;
 	isc_time_t now;
 	int timeout = 0;
+	bool unpool = false;
 
 	REQUIRE(VALID_DISPATCH(disp));
 
@@ -797,6 +985,12 @@ tcp_recv(isc_nmhandle_t *handle, isc_result_t result, isc_region_t *region,
 	 */
 	switch (result) {
 	case ISC_R_TIMEDOUT:
+		if (disp->pooled && ISC_LIST_EMPTY(disp->active)) {
+			/* The pooled connection has been idle for too long */
+			result = ISC_R_EOF;
+			break;
+		}
+
 		/*
 		 * Time out the oldest response in the active queue.
 		 */
@@ -880,7 +1074,9 @@ tcp_recv(isc_nmhandle_t *handle, isc_result_t result, isc_region_t *region,
 	}
 
 	/*
-	 * Phase 5: Resume reading if there are still active responses
+	 * Phase 5: Resume reading if there are still active responses,
+	 * or if this is an idle pooled connection.  The pool lets go
+	 * of the connections which have been shut down.
 	 */
 	resp = ISC_LIST_HEAD(disp->active);
 	if (resp != NULL) {
@@ -892,6 +1088,14 @@ tcp_recv(isc_nmhandle_t *handle, isc_result_t result, isc_region_t *region,
 		if (timeout > 0) {
 			isc_nmhandle_settimeout(handle, timeout);
 		}
+	} else if (disp->pooled && disp->state == DNS_DISPATCHSTATE_CONNECTED)
+	{
+		tcp_startrecv(disp, NULL);
+		isc_nmhandle_settimeout(handle, POOL_IDLE);
+	} else if (disp->pooled && disp->state == DNS_DISPATCHSTATE_CANCELED) {
+		disp->pooled = false;
+		dec_stats(disp->mgr, dns_resstatscounter_tcppoolconns);
+		unpool = true;
 	}
 
 	rcu_read_unlock();
@@ -901,6 +1105,10 @@ tcp_recv(isc_nmhandle_t *handle, isc_result_t result, isc_region_t *region,
 	 */
 	tcp_recv_processall(&resps, region);
 
+	if (unpool) {
+		dns_dispatch_unref(disp); /* DISPATCH005 */
+	}
+
 	dns_dispatch_detach(&disp); /* DISPATCH002 */
 }
 
@@ -1015,6 +1223,12 @@ dns_dispatchmgr_create(isc_mem_t *mctx, isc_loopmgr_t *loopmgr, isc_nm_t *nm,
 				 CDS_LFHT_AUTO_RESIZE | CDS_LFHT_ACCOUNTING,
 				 NULL);
 
+	mgr->udppools = isc_mem_cget(mgr->mctx, mgr->nloops,
+				     sizeof(mgr->udppools[0]));
+	for (size_t i = 0; i < mgr->nloops; i++) {
+		ISC_LIST_INIT(mgr->udppools[i].socks);
+	}
+
 	mgr->magic = DNS_DISPATCHMGR_MAGIC;
 
 	*mgrp = mgr;
@@ -1049,6 +1263,13 @@ dns_dispatchmgr_setavailports(dns_dispatchmgr_t *mgr, isc_portset_t *v4portset,
 	return (setavailports(mgr, v4portset, v6portset));
 }
 
+void
+dns_dispatchmgr_setudpreuse(dns_dispatchmgr_t *mgr, unsigned int queries) {
+	REQUIRE(VALID_DISPATCHMGR(mgr));
+
+	atomic_store_relaxed(&mgr->udpreuse, queries);
+}
+
 static void
 dispatchmgr_destroy(dns_dispatchmgr_t *mgr) {
 	REQUIRE(VALID_DISPATCHMGR(mgr));
@@ -1064,6 +1285,12 @@ dispatchmgr_destroy(dns_dispatchmgr_t *mgr) {
 	}
 	isc_mem_cput(mgr->mctx, mgr->tcps, mgr->nloops, sizeof(mgr->tcps[0]));
 
+	for (size_t i = 0; i < mgr->nloops; i++) {
+		INSIST(ISC_LIST_EMPTY(mgr->udppools[i].socks));
+	}
+	isc_mem_cput(mgr->mctx, mgr->udppools, mgr->nloops,
+		     sizeof(mgr->udppools[0]));
+
 	if (mgr->blackhole != NULL) {
 		dns_acl_detach(&mgr->blackhole);
 	}
@@ -1246,6 +1473,11 @@ dns_dispatch_gettcp(dns_dispatchmgr_t *mgr, const isc_sockaddr_t *destaddr,
 		INSIST(disp->tid == isc_tid());
 		INSIST(disp->socktype == isc_socktype_tcp);
 
+		if ((disp->options & DNS_DISPATCHOPT_POOLED) != 0) {
+			/* Leave the pooled dispatches to their pool */
+			continue;
+		}
+
 		switch (disp->state) {
 		case DNS_DISPATCHSTATE_NONE:
 			/* A dispatch in indeterminate state, skip it */
@@ -1302,6 +1534,87 @@ dns_dispatch_gettcp(dns_dispatchmgr_t *mgr, const isc_sockaddr_t *destaddr,
 	return (result);
 }
 
+static int
+pool_match(struct cds_lfht_node *node, const void *key0) {
+	dns_dispatch_t *disp = caa_container_of(node, dns_dispatch_t, ht_node);
+	const struct dispatch_key *key = key0;
+
+	return ((disp->options & DNS_DISPATCHOPT_POOLED) != 0 &&
+		isc_sockaddr_equal(&disp->peer, key->peer) &&
+		isc_sockaddr_equal(&disp->local, key->local));
+}
+
+isc_result_t
+dns_dispatch_getpooled(dns_dispatchmgr_t *mgr, const isc_sockaddr_t *localaddr,
+		       const isc_sockaddr_t *destaddr,
+		       dns_transport_t *transport, unsigned int maxconns,
+		       dns_dispatch_t **dispp) {
+	dns_dispatch_t *best = NULL;
+	unsigned int nconns = 0;
+	uint32_t tid = isc_tid();
+	isc_result_t result;
+
+	REQUIRE(VALID_DISPATCHMGR(mgr));
+	REQUIRE(localaddr != NULL);
+	REQUIRE(destaddr != NULL);
+	REQUIRE(maxconns > 0);
+	REQUIRE(dispp != NULL && *dispp == NULL);
+
+	struct dispatch_key key = {
+		.local = localaddr,
+		.peer = destaddr,
+	};
+
+	/*
+	 * Find the least busy of the connections to this server, over
+	 * the same transport, which are open or being opened.
+	 */
+	rcu_read_lock();
+	struct cds_lfht_iter iter;
+	dns_dispatch_t *disp = NULL;
+	cds_lfht_for_each_entry_duplicate(mgr->tcps[tid], dispatch_hash(&key),
+					  pool_match, &key, &iter, disp,
+					  ht_node) {
+		INSIST(disp->tid == isc_tid());
+
+		if (disp->transport != transport ||
+		    (disp->state != DNS_DISPATCHSTATE_CONNECTING &&
+		     disp->state != DNS_DISPATCHSTATE_CONNECTED))
+		{
+			continue;
+		}
+
+		nconns++;
+		if (best == NULL || disp->requests < best->requests) {
+			best = disp;
+		}
+	}
+
+	/*
+	 * Queries are pipelined on the existing connections until they
+	 * are all busy, and only then is another connection opened.
+	 */
+	if (best != NULL && (best->requests < POOL_DEPTH || nconns >= maxconns))
+	{
+		dns_dispatch_attach(best, dispp);
+		rcu_read_unlock();
+
+		if (best->state == DNS_DISPATCHSTATE_CONNECTED) {
+			inc_stats(mgr, dns_resstatscounter_tcppoolreused);
+		}
+		return (ISC_R_SUCCESS);
+	}
+	rcu_read_unlock();
+
+	result = dns_dispatch_createtcp(mgr, localaddr, destaddr,
+					DNS_DISPATCHOPT_POOLED, dispp);
+	if (result == ISC_R_SUCCESS && transport != NULL) {
+		dns_transport_attach(transport, &(*dispp)->transport);
+	}
+
+	return (result);
+}
+
 isc_result_t
 dns_dispatch_createudp(dns_dispatchmgr_t *mgr, const isc_sockaddr_t *localaddr,
 		       dns_dispatch_t **dispp) {
@@ -1388,6 +1701,7 @@ dispatch_destroy(dns_dispatch_t *disp) {
 	INSIST(disp->requests == 0);
 	INSIST(ISC_LIST_EMPTY(disp->pending));
 	INSIST(ISC_LIST_EMPTY(disp->active));
+	INSIST(!disp->pooled);
 
 	dispatch_log(disp, ISC_LOG_DEBUG(90), "destroying dispatch %p", disp);
 
@@ -1397,6 +1711,9 @@ dispatch_destroy(dns_dispatch_t *disp) {
 			     &disp->handle);
 		isc_nmhandle_detach(&disp->handle);
 	}
+	if (disp->transport != NULL) {
+		dns_transport_detach(&disp->transport);
+	}
 	dns_dispatchmgr_detach(&disp->mgr);
 
 	call_rcu(&disp->rcu_head, dispatch_destroy_rcu);
@@ -1496,6 +1813,9 @@ dns_dispatch_add(dns_dispatch_t *disp, isc_loop_t *loop,
 	} while (i++ < QID_MAX_TRIES);
 fail:
 	if (result != ISC_R_SUCCESS) {
+		if (resp->handle != NULL) {
+			isc_nmhandle_detach(&resp->handle);
+		}
 		isc_mem_put(disp->mctx, resp, sizeof(*resp));
 		rcu_read_unlock();
 		return (result);
@@ -1660,7 +1980,18 @@ tcp_dispentry_cancel(dns_dispentry_t *resp, isc_result_t result) {
 
 		INSIST(!ISC_LINK_LINKED(resp, alink));
 
-		if (ISC_LIST_EMPTY(disp->active)) {
+		if (ISC_LIST_EMPTY(disp->active) && disp->pooled) {
+			/*
+			 * Keep reading from the idle pooled connection, so
+			 * that we notice when the server closes it, or
+			 * close it ourselves when it has been idle too long.
+			 */
+			isc_nmhandle_cleartimeout(disp->handle);
+			isc_nmhandle_settimeout(disp->handle, POOL_IDLE);
+			if (!disp->reading) {
+				tcp_startrecv(disp, NULL);
+			}
+		} else if (ISC_LIST_EMPTY(disp->active)) {
 			INSIST(disp->handle != NULL);
 
 #if DISPATCH_TCP_KEEPALIVE
@@ -1769,6 +2100,7 @@ udp_startrecv(isc_nmhandle_t *handle, dns_dispentry_t *resp) {
 	dispentry_log(resp, ISC_LOG_DEBUG(90), "reading");
 	isc_nm_read(resp->handle, udp_recv, resp);
 	resp->reading = true;
+	resp->reusable = false;
 }
 
 static void
@@ -1855,13 +2187,33 @@ tcp_connected(isc_nmhandle_t *handle, isc_result_t eresult, void *arg) {
 		}
 	}
 
-	if (ISC_LIST_EMPTY(disp->active)) {
+	if (eresult == ISC_R_SUCCESS &&
+	    (disp->options & DNS_DISPATCHOPT_POOLED) != 0)
+	{
+		/*
+		 * The pool keeps the connection open, even if all the
+		 * responses have been canceled in the meantime.
+		 */
+		disp->state = DNS_DISPATCHSTATE_CONNECTED;
+		isc_nmhandle_attach(handle, &disp->handle);
+		dns_dispatch_ref(disp); /* DISPATCH005 */
+		disp->pooled = true;
+		inc_stats(disp->mgr, dns_resstatscounter_tcppoolconns);
+		inc_stats(disp->mgr, dns_resstatscounter_tcppoolopened);
+		if (ISC_LIST_EMPTY(disp->active)) {
+			isc_nmhandle_settimeout(handle, POOL_IDLE);
+		}
+		tcp_startrecv(disp, NULL);
+	} else if (ISC_LIST_EMPTY(disp->active)) {
 		/* All responses have been canceled */
 		disp->state = DNS_DISPATCHSTATE_CANCELED;
 	} else if (eresult == ISC_R_SUCCESS) {
 		disp->state = DNS_DISPATCHSTATE_CONNECTED;
 		isc_nmhandle_attach(handle, &disp->handle);
 		tcp_startrecv(disp, resp);
+	} else if ((disp->options & DNS_DISPATCHOPT_POOLED) != 0) {
+		/* Don't hand out a pooled connection that failed */
+		disp->state = DNS_DISPATCHSTATE_CANCELED;
 	} else {
 		disp->state = DNS_DISPATCHSTATE_NONE;
 	}
@@ -1902,6 +2254,8 @@ udp_connected(isc_nmhandle_t *handle, isc_result_t eresult, void *arg) {
 		break;
 	case ISC_R_SUCCESS:
 		resp->state = DNS_DISPATCHSTATE_CONNECTED;
+		resp->opened = isc_loop_now(resp->loop);
+		inc_stats(disp->mgr, dns_resstatscounter_udpsockopened);
 		udp_startrecv(handle, resp);
 		break;
 	case ISC_R_NOPERM:
@@ -1935,6 +2289,25 @@ detach:
 static void
 udp_dispatch_connect(dns_dispatch_t *disp, dns_dispentry_t *resp) {
 	REQUIRE(disp->tid == isc_tid());
+
+	if (resp->handle != NULL) {
+		/*
+		 * The socket came from the pool and is connected already;
+		 * start reading and call the connected cb asynchronously.
+		 */
+		resp->state = DNS_DISPATCHSTATE_CONNECTED;
+		resp->start = isc_loop_now(resp->loop);
+		resp->result = ISC_R_SUCCESS;
+		isc_nmhandle_settimeout(resp->handle, resp->timeout);
+		dns_dispentry_ref(resp); /* DISPENTRY003 */
+		isc_nm_read(resp->handle, udp_recv, resp);
+		resp->reading = true;
+
+		dns_dispentry_ref(resp); /* DISPENTRY005 */
+		isc_async_run(resp->loop, resp_connected, resp);
+		return;
+	}
+
 	resp->state = DNS_DISPATCHSTATE_CONNECTING;
 	resp->start = isc_loop_now(resp->loop);
 	dns_dispentry_ref(resp); /* DISPENTRY004 */
@@ -2009,6 +2382,13 @@ tcp_dispatch_connect(dns_dispatch_t *disp, dns_dispentry_t *resp) {
 		resp->state = DNS_DISPATCHSTATE_CONNECTED;
 		resp->start = isc_loop_now(resp->loop);
 
+		/* An idle pooled connection is read with the idle timeout */
+		if (disp->reading && ISC_LIST_EMPTY(disp->active) &&
+		    resp->timeout > 0)
+		{
+			isc_nmhandle_settimeout(disp->handle, resp->timeout);
+		}
+
 		/* Add the resp to the reading list */
 		ISC_LIST_APPEND(disp->active, resp, alink);
 		dispentry_log(resp, ISC_LOG_DEBUG(90),
@@ -2117,6 +2497,7 @@ udp_dispatch_getnext(dns_dispentry_t *resp, int32_t timeout) {
 	dns_dispentry_ref(resp); /* DISPENTRY003 */
 	isc_nm_read(resp->handle, udp_recv, resp);
 	resp->reading = true;
+	resp->reusable = false;
 }
 
 void
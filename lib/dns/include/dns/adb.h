@@ -483,6 +483,42 @@ dns_adb_agesrtt(dns_adb_t *adb, dns_adbaddrinfo_t *addr, isc_stdtime_t now);
  *	srtt value.  This may include changes made by others.
  */
 
+void
+dns_adb_rttsample(dns_adb_t *adb, dns_adbaddrinfo_t *addr, unsigned int rtt);
+/*%<
+ * Count the round trip time 'rtt', in microseconds, of a UDP query that
+ * was answered by 'addr' in its response time histogram.  Unlike the
+ * smoothed rtt, the histogram only counts actual responses.
+ *
+ * Requires:
+ *
+ *\li	adb be valid.
+ *
+ *\li	addr be valid.
+ */
+
+unsigned int
+dns_adb_rttquantile(dns_adb_t *adb, dns_adbaddrinfo_t *addr,
+		    unsigned int permille);
+/*%<
+ * Return a round trip time, in microseconds, within which at least
+ * 'permille' thousandths of the recent responses from 'addr' were
+ * received.  The value is rounded up to the next bucket of the
+ * histogram; it is UINT_MAX if the quantile falls into the last bucket.
+ *
+ * Requires:
+ *
+ *\li	adb be valid.
+ *
+ *\li	addr be valid.
+ *
+ *\li	0 < permille <= 1000
+ *
+ * Returns:
+ *
+ *\li	0 if too few responses have been counted yet.
+ */
+
 void
 dns_adb_changeflags(dns_adb_t *adb, dns_adbaddrinfo_t *addr, unsigned int bits,
 		    unsigned int mask);
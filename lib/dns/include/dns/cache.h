@@ -143,6 +143,24 @@ dns_cache_getcachesize(dns_cache_t *cache);
  * Get the maximum cache size.
  */
 
+void
+dns_cache_setmaxncachesize(dns_cache_t *cache, size_t size);
+/*%<
+ * Set the maximum number of bytes the negative answers in the cache may
+ * take, so that a flood of queries for nonexistent names can't push
+ * the positive answers out of it.  0 means that they are only limited
+ * by the cache size.
+ */
+
+void
+dns_cache_setwirerdata(dns_cache_t *cache, bool value);
+/*%<
+ * If 'value' is true, the rdata of the positive answers from the cache
+ * is copied to the responses as it is stored, without compressing the
+ * names in it.  This makes rendering the responses cheaper, at the cost
+ * of making some of them larger.
+ */
+
 void
 dns_cache_setservestalettl(dns_cache_t *cache, dns_ttl_t ttl);
 /*%<
@@ -51,6 +51,16 @@ ISC_LANG_BEGINDECLS
  * outgoing zone transfers (which are handled in lib/ns/xfrout.c) and
  * update requests (for which nsupdate uses DNS_REQUESTOPT_LARGE - see
  * request.h).
+ *
+ * Most responses are much smaller still, so the small hash set starts
+ * with only 16 of its entries in use, and it only clears the rest and
+ * grows into them when a message turns out to need them.
+ *
+ * The names in an authoritative response are mostly in the zone that
+ * answers, so a zone can give the compression context its apex (see
+ * dns_compress_setapex()).  Once the apex is in the message, the names
+ * below it skip straight to its offset instead of hashing and looking
+ * up each of the suffixes they have in common with it.
  */
 
 /*
@@ -64,6 +74,7 @@ ISC_LANG_BEGINDECLS
  * per message.
  */
 enum {
+	DNS_COMPRESS_TINYBITS = 4,
 	DNS_COMPRESS_SMALLBITS = 6,
 	DNS_COMPRESS_LARGEBITS = 10,
 };
@@ -89,14 +100,26 @@ struct dns_compress_slot {
 	uint16_t coff;
 };
 
+/*
+ * The apex of a zone, with the hashes of its name precomputed for the
+ * case sensitive and insensitive compression contexts.
+ */
+struct dns_compress_apex {
+	const dns_name_t *name;
+	uint16_t	  hash;
+	uint16_t	  lowerhash;
+};
+
 struct dns_compress {
-	unsigned int	     magic;
-	dns_compress_flags_t flags;
-	uint16_t	     mask;
-	uint16_t	     count;
-	isc_mem_t	    *mctx;
-	dns_compress_slot_t *set;
-	dns_compress_slot_t  smallset[1 << DNS_COMPRESS_SMALLBITS];
+	unsigned int		   magic;
+	dns_compress_flags_t	   flags;
+	uint16_t		   mask;
+	uint16_t		   count;
+	isc_mem_t		  *mctx;
+	dns_compress_slot_t	  *set;
+	const dns_compress_apex_t *apex;
+	uint16_t		   apexcoff;
+	dns_compress_slot_t	   smallset[1 << DNS_COMPRESS_SMALLBITS];
 };
 
 /*
@@ -206,6 +229,31 @@ dns_compress_rollback(dns_compress_t *cctx, unsigned int offset);
  *\li		'cctx' is initialized.
  */
 
+void
+dns_compress_apexinit(dns_compress_apex_t *apex, const dns_name_t *name);
+/*%<
+ *	Precompute the apex template for the zone whose origin is 'name'.
+ *	The template refers to 'name', which must outlive it.
+ *
+ *	Requires:
+ *\li		'apex' is not NULL.
+ *\li		'name' is a valid absolute name.
+ */
+
+void
+dns_compress_setapex(dns_compress_t *cctx, const dns_compress_apex_t *apex);
+/*%<
+ *	Use the apex template 'apex' for the names compressed in 'cctx'.
+ *	This makes no difference to the compressed names, only to the
+ *	time it takes to compress the names below the apex.  The template
+ *	of the root zone is ignored, as all names are below it.
+ *
+ *	Requires:
+ *\li		'cctx' is initialized, and no name has been compressed yet.
+ *\li		'apex' was initialized with dns_compress_apexinit(), and
+ *		outlives 'cctx'.
+ */
+
 /*%
  *	Set whether decompression is allowed, according to RFC 3597
  */
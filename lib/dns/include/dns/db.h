@@ -185,6 +185,14 @@ typedef struct dns_dbmethods {
 				     dns_name_t *name);
 	void (*setmaxrrperset)(dns_db_t *db, uint32_t value);
 	void (*setmaxtypepername)(dns_db_t *db, uint32_t value);
+	void (*setslabsharing)(dns_db_t *db, bool value);
+	void (*setslabpool)(dns_db_t *db, dns_slabpool_t *pool);
+	isc_result_t (*getslabstats)(dns_db_t *db, uint64_t *owned,
+				     uint64_t *shared);
+	void (*setmaxncachesize)(dns_db_t *db, size_t size);
+	isc_result_t (*getcachemem)(dns_db_t *db, uint64_t *positive,
+				    uint64_t *negative, uint64_t *proofs);
+	void (*setwirerdata)(dns_db_t *db, bool value);
 } dns_dbmethods_t;
 
 typedef isc_result_t (*dns_dbcreatefunc_t)(isc_mem_t	    *mctx,
@@ -1821,4 +1829,92 @@ dns_db_setmaxtypepername(dns_db_t *db, uint32_t value);
  * stored at a given node, then any subsequent attempt to add an rdataset
  * with a new RR type will return ISC_R_TOOMANYRECORDS.
  */
+
+void
+dns_db_setslabsharing(dns_db_t *db, bool value);
+/*%<
+ * If 'value' is true, store the rdataslabs of 'db' so that other
+ * databases can refer to them instead of making copies of their own:
+ * the secure database of an inline-signed zone refers to the unsigned
+ * data in the raw database this way.  This must be set before any data
+ * is added to 'db'.
+ *
+ * Requires:
+ *
+ * \li 'db' is a valid database
+ */
+
+void
+dns_db_setslabpool(dns_db_t *db, dns_slabpool_t *pool);
+/*%<
+ * Intern the rdataslabs added to 'db' in 'pool' (see dns/slabpool.h), so
+ * that the databases using the same pool share the identical RRsets.
+ * If 'pool' is NULL, stop using the pool.  This must be set before any
+ * data is added to 'db'.
+ *
+ * Requires:
+ *
+ * \li 'db' is a valid database
+ */
+
+isc_result_t
+dns_db_getslabstats(dns_db_t *db, uint64_t *owned, uint64_t *shared);
+/*%<
+ * Get the number of bytes of rdataslabs in 'db' which were allocated by
+ * 'db' itself ('owned') and which 'db' refers to in other databases
+ * ('shared').  Either of 'owned' and 'shared' can be NULL.
+ *
+ * Requires:
+ *
+ * \li 'db' is a valid database
+ *
+ * Returns:
+ * \li #ISC_R_SUCCESS
+ * \li #ISC_R_NOTIMPLEMENTED
+ */
+
+void
+dns_db_setmaxncachesize(dns_db_t *db, size_t size);
+/*%<
+ * Set the maximum number of bytes the negative entries in the cache
+ * database 'db' may take.  When adding a negative entry would go over
+ * it, the least recently used negative entries are purged first.  If
+ * 'size' is zero, the negative entries are only limited by the size of
+ * the cache.
+ *
+ * Requires:
+ *
+ * \li 'db' is a valid database
+ */
+
+isc_result_t
+dns_db_getcachemem(dns_db_t *db, uint64_t *positive, uint64_t *negative,
+		   uint64_t *proofs);
+/*%<
+ * Get the number of bytes taken by the positive and the negative
+ * entries in the cache database 'db', and by the negative cache records
+ * which they share (see dns_rdataslab_fromncache()).  Any of
+ * 'positive', 'negative' and 'proofs' can be NULL.
+ *
+ * Requires:
+ *
+ * \li 'db' is a valid database
+ *
+ * Returns:
+ * \li #ISC_R_SUCCESS
+ * \li #ISC_R_NOTIMPLEMENTED
+ */
+
+void
+dns_db_setwirerdata(dns_db_t *db, bool value);
+/*%<
+ * If 'value' is true, mark the positive rdatasets found in the cache
+ * database 'db' with #DNS_RDATASETATTR_WIRE, so that their rdata is
+ * copied to the messages they are rendered to as it is stored, and only
+ * their owner names are compressed.
+ *
+ * Requires:
+ *
+ * \li 'db' is a valid database
+ */
 ISC_LANG_ENDDECLS
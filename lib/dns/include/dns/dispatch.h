@@ -75,6 +75,7 @@ struct dns_dispatchset {
 typedef enum dns_dispatchopt {
 	DNS_DISPATCHOPT_FIXEDID = 1 << 0,
 	DNS_DISPATCHOPT_UNSHARED = 1 << 1, /* Don't share this connection */
+	DNS_DISPATCHOPT_POOLED = 1 << 2,   /* Keep this connection open */
 } dns_dispatchopt_t;
 
 isc_result_t
@@ -150,6 +151,25 @@ dns_dispatchmgr_setavailports(dns_dispatchmgr_t *mgr, isc_portset_t *v4portset,
  *\li	v6portset is NULL or a valid port set
  */
 
+void
+dns_dispatchmgr_setudpreuse(dns_dispatchmgr_t *mgr, unsigned int queries);
+/*%<
+ * Sets the number of queries that may be sent from one UDP socket.
+ *
+ * When this is more than 1, the connected UDP socket of a query which
+ * got its response is kept in a pool of the loop, and used for the next
+ * query to the same server from that loop, instead of opening a new
+ * socket on another random port.  The responses are still matched to
+ * their queries by the message ID and the address of the server.  A
+ * socket is closed after it has been used for 'queries' queries, or a
+ * couple of seconds after it was opened, whichever comes first, so that
+ * the source ports keep changing.  0 or 1, the default, opens a new
+ * socket for every query.
+ *
+ * Requires:
+ *\li	mgr is a valid dispatchmgr
+ */
+
 void
 dns_dispatchmgr_setstats(dns_dispatchmgr_t *mgr, isc_stats_t *stats);
 /*%<
@@ -260,6 +280,39 @@ dns_dispatch_gettcp(dns_dispatchmgr_t *mgr, const isc_sockaddr_t *destaddr,
  * Attempt to connect to a existing TCP connection.
  */
 
+isc_result_t
+dns_dispatch_getpooled(dns_dispatchmgr_t *mgr, const isc_sockaddr_t *localaddr,
+		       const isc_sockaddr_t *destaddr,
+		       dns_transport_t *transport, unsigned int maxconns,
+		       dns_dispatch_t **dispp);
+/*%<
+ * Get a TCP dispatch to 'destaddr' from 'localaddr' over 'transport'
+ * (plain TCP if NULL) from the pool of persistent connections of the
+ * current loop.
+ *
+ * The queries are pipelined on the connections to the server which are
+ * already open or being opened, and matched to their responses by
+ * their message IDs.  A new connection is only opened when all the
+ * existing ones have many queries outstanding, and there are fewer
+ * than 'maxconns' of them.  A pooled connection stays open when its
+ * last query is done, until it has been idle for a few seconds or the
+ * server closes it.
+ *
+ * Requires:
+ *\li	'mgr' is a valid dispatch manager.
+ *
+ *\li	'localaddr' and 'destaddr' are valid socket addresses.
+ *
+ *\li	'maxconns' is greater than zero.
+ *
+ *\li	dispp != NULL && *dispp == NULL
+ *
+ * Returns:
+ *\li	ISC_R_SUCCESS	-- success.
+ *
+ *\li	Anything else	-- failure.
+ */
+
 typedef void (*dispatch_cb_t)(isc_result_t eresult, isc_region_t *region,
 			      void *cbarg);
 
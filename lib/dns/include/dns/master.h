@@ -71,6 +71,28 @@ ISC_LANG_BEGINDECLS
  */
 #define DNS_RAWFORMAT_VERSION 1
 
+/*
+ * The newest version of the "raw" format understood.  It is only
+ * written when asked for, as older releases cannot read it.
+ */
+#define DNS_RAWFORMAT_MAXVERSION 2
+
+/*
+ * Since version 2, the RRsets in a raw file are grouped in blocks, each
+ * starting with the length of the RRsets in it (not including the block
+ * header itself) and their number, in network byte order:
+ *
+ *	uint32_t length;
+ *	uint32_t count;
+ *	... followed by 'count' RRsets in the version 1 encoding
+ *
+ * The blocks are about DNS_RAWBLOCK_SIZE long, but they never split a
+ * node, and they are never longer than DNS_RAWBLOCK_MAXSIZE.  The loader
+ * can decode them in parallel, as each of them is self-contained.
+ */
+#define DNS_RAWBLOCK_SIZE    (64 * 1024)
+#define DNS_RAWBLOCK_MAXSIZE (256 * 1024 * 1024)
+
 /*
  * Flags to indicate the status of the data in the raw file header
  */
@@ -83,7 +105,8 @@ struct dns_masterrawheader {
 	uint32_t format;       /* must be
 				* dns_masterformat_raw */
 	uint32_t version;      /* compatibility for future
-				* extensions */
+				* extensions; when dumping,
+				* 0 means DNS_RAWFORMAT_VERSION */
 	uint32_t dumptime;     /* timestamp on creation
 				* (currently unused) */
 	uint32_t flags;	       /* Flags */
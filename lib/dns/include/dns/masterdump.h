@@ -19,6 +19,7 @@
  ***	Imports
  ***/
 
+#include <inttypes.h>
 #include <stdio.h>
 
 #include <isc/lang.h>
@@ -31,6 +32,24 @@
 
 typedef struct dns_master_style dns_master_style_t;
 
+/*%
+ * Options of an asynchronous dump to a file; see dns_master_dumpasync().
+ */
+typedef struct dns_dumpopts {
+	uint64_t maxrate;  /*%< bytes per second, 0 for no limit */
+	uint64_t syncsize; /*%< bytes between fsync()s, 0 for only at the end */
+} dns_dumpopts_t;
+
+/*%
+ * Statistics of an asynchronous dump; see dns_dumpctx_getstats().
+ */
+typedef struct dns_dumpstats {
+	uint64_t bytes;	 /*%< bytes written so far */
+	uint64_t usecs;	 /*%< microseconds since the dump was started */
+	uint64_t quanta; /*%< work pool jobs the dump was split into */
+	uint64_t syncs;	 /*%< intermediate fsync()s */
+} dns_dumpstats_t;
+
 /***
  *** Definitions
  ***/
@@ -222,7 +241,9 @@ dns_dumpctx_detach(dns_dumpctx_t **dctxp);
 void
 dns_dumpctx_cancel(dns_dumpctx_t *dctx);
 /*%<
- * Cancel a in progress dump.
+ * Cancel a in progress dump.  A rate-limited dump stops waiting for
+ * its next quantum; its completion callback is called with
+ * ISC_R_CANCELED.
  *
  * Require:
  *\li	'dctx' to be valid.
@@ -246,6 +267,17 @@ dns_dumpctx_db(dns_dumpctx_t *dctx);
  *\li	'dctx' to be valid.
  */
 
+void
+dns_dumpctx_getstats(dns_dumpctx_t *dctx, dns_dumpstats_t *stats);
+/*%<
+ * Fill in 'stats' with the statistics of the dump; they are final when
+ * the dump's 'done' callback is called.
+ *
+ * Require:
+ *\li	'dctx' to be valid.
+ *\li	'stats' to be non NULL.
+ */
+
 /*@{*/
 isc_result_t
 dns_master_dumptostreamasync(isc_mem_t *mctx, dns_db_t *db,
@@ -288,7 +320,7 @@ dns_master_dumpasync(isc_mem_t *mctx, dns_db_t *db, dns_dbversion_t *version,
 		     const dns_master_style_t *style, const char *filename,
 		     isc_loop_t *loop, dns_dumpdonefunc_t done, void *done_arg,
 		     dns_dumpctx_t **dctxp, dns_masterformat_t format,
-		     dns_masterrawheader_t *header);
+		     dns_masterrawheader_t *header, const dns_dumpopts_t *opts);
 
 isc_result_t
 dns_master_dump(isc_mem_t *mctx, dns_db_t *db, dns_dbversion_t *version,
@@ -303,6 +335,15 @@ dns_master_dump(isc_mem_t *mctx, dns_db_t *db, dns_dbversion_t *version,
  * If 'format' is dns_masterformat_raw, then 'header' can contain
  * information to be written to the file header.
  *
+ * dns_master_dumpasync() writes the file from the work pool threads.
+ * If 'opts' is not NULL, the file is written in large fixed size chunks
+ * and 'opts->syncsize' bytes at most are written before they are
+ * synced to the disk, rather than all of them at the end.  If
+ * 'opts->maxrate' is not 0, the dump is split into a series of work
+ * pool jobs spread over time so that the file is not written faster
+ * than 'opts->maxrate' bytes per second on average; no thread is kept
+ * waiting in between.
+ *
  * Temporary dynamic memory may be allocated from 'mctx'.
  *
  * Returns:
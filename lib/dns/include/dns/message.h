@@ -224,6 +224,9 @@ typedef enum dns_message_intent {
 #define DNS_MESSAGEPARSE_IGNORETRUNCATION \
 	0x0008 /*%< truncation errors are \
 		* not fatal. */
+#define DNS_MESSAGEPARSE_FASTQUERY \
+	0x0010 /*%< try the fast path for \
+		* simple queries */
 
 /*
  * Control behavior of rendering
@@ -240,6 +243,7 @@ typedef enum dns_message_intent {
 /* Obsolete: DNS_MESSAGERENDER_FILTER_AAAA	0x0020	*/
 
 typedef struct dns_msgblock dns_msgblock_t;
+typedef struct dns_msgfast  dns_msgfast_t;
 
 struct dns_sortlist_arg {
 	dns_aclenv_t	       *env;
@@ -316,6 +320,8 @@ struct dns_message {
 	ISC_LIST(dns_rdata_t) freerdata;
 	ISC_LIST(dns_rdatalist_t) freerdatalist;
 
+	dns_msgfast_t *fast; /* storage for DNS_MESSAGEPARSE_FASTQUERY */
+
 	dns_rcode_t tsigstatus;
 	dns_rcode_t querytsigstatus;
 	dns_name_t *tsigname; /* Owner name of TSIG, if any
@@ -562,6 +568,13 @@ dns_message_parse(dns_message_t *msg, isc_buffer_t *source,
  * If #DNS_MESSAGEPARSE_IGNORETRUNCATION is set then return as many complete
  * RR's as possible, DNS_R_RECOVERABLE will be returned.
  *
+ * If #DNS_MESSAGEPARSE_FASTQUERY is set and the message is a query with
+ * one question and nothing else but an OPT record, the question and the
+ * OPT record are decoded into storage that is kept with the message for
+ * reuse, and none of the general machinery is involved.  Any other
+ * message is parsed as usual.  The names and rdatasets of such a
+ * message are owned by 'msg', and must not be moved to another message.
+ *
  * OPT and TSIG records are always handled specially, regardless of the
  * 'preserve_order' setting.
  *
@@ -100,6 +100,11 @@ typedef struct dns_qp dns_qp_t;
  */
 typedef struct dns_qpmulti dns_qpmulti_t;
 
+/*%
+ * A `dns_qpbuild_t` fills an empty `dns_qp_t` with leaves in key order.
+ */
+typedef struct dns_qpbuild dns_qpbuild_t;
+
 /*%
  * Read-only parts of a qp-trie.
  *
@@ -621,6 +626,63 @@ dns_qp_deletename(dns_qp_t *qp, const dns_name_t *name, void **pval_r,
  * \li  ISC_R_SUCCESS if the leaf was deleted from the trie
  */
 
+void
+dns_qpbuild_begin(dns_qp_t *qp, dns_qpbuild_t **qpbp);
+/*%<
+ * Start building a qp-trie from leaves that are added in key order,
+ * i.e. in DNS canonical order when the keys are made from names.
+ *
+ * This is a lot cheaper than adding the leaves with `dns_qp_insert()`:
+ * there is no search from the root for each leaf, and each branch's
+ * twigs are allocated once, when the branch is complete, so the new
+ * trie is packed into its chunks without any garbage. This is meant
+ * for loading a whole trie at once from sorted input, such as a zone
+ * from a raw file, or a trie that is rebuilt from scratch.
+ *
+ * The trie may already contain one leaf (such as the zone apex that
+ * the zone databases add when they are created), which becomes the
+ * first leaf of the build.
+ *
+ * The trie must not be used in any other way until the build is
+ * finished.
+ *
+ * Requires:
+ * \li  `qp` is a pointer to a valid qp-trie with at most one leaf
+ * \li  `qpbp != NULL && *qpbp == NULL`
+ */
+
+isc_result_t
+dns_qpbuild_add(dns_qpbuild_t *qpb, void *pval, uint32_t ival);
+/*%<
+ * Add a leaf after the leaves that have been added so far.
+ *
+ * Leaves which are out of order are not added; the caller can finish
+ * the build and use `dns_qp_insert()` for them and the rest.
+ *
+ * Requires:
+ * \li  `qpb` is a pointer to a valid qp-trie builder
+ * \li  `pval != NULL`
+ * \li  `alignof(pval) >= 4`
+ *
+ * Returns:
+ * \li  ISC_R_EXISTS if the leaf has the same key as the previous leaf
+ * \li  ISC_R_RANGE if the leaf's key is before the previous leaf's key
+ * \li  ISC_R_SUCCESS if the leaf was added
+ */
+
+void
+dns_qpbuild_finish(dns_qpbuild_t **qpbp);
+/*%<
+ * Finish building the trie and free the builder. After this the trie
+ * can be used normally.
+ *
+ * Requires:
+ * \li  `qpbp != NULL` and `*qpbp` is a pointer to a valid builder
+ *
+ * Ensures:
+ * \li  `*qpbp == NULL`
+ */
+
 void
 dns_qpiter_init(dns_qpreadable_t qpr, dns_qpiter_t *qpi);
 /*%<
@@ -167,9 +167,12 @@ struct dns_rdataset {
 		/*
 		 * An ncache rdataset is a view of memory held elsewhere:
 		 * raw can point to either a buffer on the stack or to an
-		 * rdataslab, such as in an rbtdb database.
+		 * rdataslab, such as in an rbtdb database.  'trust'
+		 * points to where its trust is kept, which may not be
+		 * just before 'raw' (see dns_rdataslab_fromncache()).
 		 */
 		struct {
+			unsigned char *trust;
 			unsigned char *raw;
 			unsigned char *iter_pos;
 			unsigned int   iter_count;
@@ -181,11 +184,14 @@ struct dns_rdataset {
 		 * memory immediately following a slabheader. (There
 		 * is an exception in the case of rdatasets returned by
 		 * the `getnoqname` and `getclosest` methods; see
-		 * comments in rbtdb.c for details.)
+		 * comments in rbtdb.c for details.)  If 'header' is
+		 * set, it points to the slabheader, as the slab may be
+		 * shared between databases and kept apart from it.
 		 */
 		struct {
 			struct dns_db	       *db;
 			dns_dbnode_t	       *node;
+			struct dns_slabheader  *header;
 			unsigned char	       *raw;
 			unsigned char	       *iter_pos;
 			unsigned int		iter_count;
@@ -232,6 +238,10 @@ struct dns_rdataset {
  *	Set on rdatasets that were added during a stale-answer-client-timeout
  *	lookup. In other words, the RRset was added during a lookup of stale
  *	data and does not necessarily mean that the rdataset itself is stale.
+ *
+ * \def DNS_RDATASETATTR_WIRE
+ *	The rdata is rendered by copying it to the message as it is, without
+ *	compressing the names in it; only the owner name is compressed.
  */
 
 #define DNS_RDATASETATTR_NONE	      0x00000000 /*%< No ordering. */
@@ -266,6 +276,7 @@ struct dns_rdataset {
 #define DNS_RDATASETATTR_STALE_ADDED  0x08000000
 #define DNS_RDATASETATTR_KEEPCASE     0x10000000
 #define DNS_RDATASETATTR_STATICSTUB   0x20000000
+#define DNS_RDATASETATTR_WIRE	      0x40000000
 
 /*%
  * _OMITDNSSEC:
@@ -46,6 +46,7 @@
 #include <isc/atomic.h>
 #include <isc/heap.h>
 #include <isc/lang.h>
+#include <isc/refcount.h>
 #include <isc/stdtime.h>
 #include <isc/urcu.h>
 
@@ -60,6 +61,16 @@ ISC_LANG_BEGINDECLS
 
 #define DNS_RDATASLAB_OFFLINE 0x01 /* RRSIG is for offline DNSKEY */
 
+/*%
+ * When the owner name, type and trust of a record of a negative cache
+ * rdataslab are followed by this byte, which can't start an rdata
+ * count followed by as few rdatas, the rest of the record is a pointer
+ * to the shared rdataslab holding its rdatas (see
+ * dns_rdataslab_fromncache()).  Such records can only be read through
+ * the dns_ncache functions.
+ */
+#define DNS_RDATASLAB_NCACHEREF 0xff
+
 struct dns_slabheader_proof {
 	dns_name_t	name;
 	void	       *neg;
@@ -67,6 +78,17 @@ struct dns_slabheader_proof {
 	dns_rdatatype_t type;
 };
 
+/*%
+ * An immutable rdataslab that is kept apart from its header, so that
+ * the headers in several databases can refer to the same rdata.  The
+ * rdataslab immediately follows this structure in memory, and it is
+ * freed when the last header referring to it is destroyed.
+ */
+struct dns_slabshared {
+	isc_mem_t     *mctx;
+	isc_refcount_t references;
+};
+
 struct dns_slabheader {
 	/*%
 	 * Locked by the owning node's lock.
@@ -133,6 +155,12 @@ struct dns_slabheader {
 	unsigned char upper[32];
 
 	isc_heap_t *heap;
+
+	dns_slabshared_t *shared;
+	/*%<
+	 * If not NULL, the rdataslab of this header; otherwise the
+	 * rdataslab immediately follows the header in memory.
+	 */
 };
 
 enum {
@@ -150,6 +178,7 @@ enum {
 	DNS_SLABHEADERATTR_CASEFULLYLOWER = 1 << 11,
 	DNS_SLABHEADERATTR_ANCIENT = 1 << 12,
 	DNS_SLABHEADERATTR_STALE_WINDOW = 1 << 13,
+	DNS_SLABHEADERATTR_NCACHEREF = 1 << 14,
 };
 
 #define DNS_SLABHEADER_GETATTR(header, attribute) \
@@ -187,6 +216,57 @@ dns_rdataslab_fromrdataset(dns_rdataset_t *rdataset, isc_mem_t *mctx,
  *\li	XXX others
  */
 
+isc_result_t
+dns_rdataslab_fromncache(dns_rdataset_t *rdataset, isc_mem_t *mctx,
+			 dns_slabpool_t *pool, isc_region_t *region,
+			 unsigned int reservelen, uint32_t limit,
+			 bool *sharedp);
+/*%<
+ * Like dns_rdataslab_fromrdataset(), but for a negative cache rdataset
+ * (see dns/ncache.h).  The rdatas of each of its records, when they
+ * are longer than a pointer, are interned in 'pool' as a shared
+ * rdataslab of their own, and the record only refers to it, so the SOA
+ * and the NSEC or NSEC3 proofs shared by the negative answers from a
+ * zone are only stored once.  The owner name, type and trust stay in
+ * the record, so that the trust of one entry can be changed without
+ * changing the others.
+ *
+ * The references are only resolved by the dns_ncache functions, with
+ * dns_rdataslab_ncachetail(); the rdataslab rdataset methods return
+ * the records as they are stored, references included.  The records of
+ * a negative cache rdataset made from such a slab must therefore only
+ * be read with dns_ncache_current(), dns_ncache_getrdataset(),
+ * dns_ncache_getsigrdataset() and dns_ncache_towire(), never by
+ * parsing the rdata returned by dns_rdataset_current() directly.
+ *
+ * '*sharedp' is set to true if
+ * the slab refers to any shared rdataslab: the header of such a slab
+ * must then be given the DNS_SLABHEADERATTR_NCACHEREF attribute, so
+ * that dns_slabheader_destroy() lets go of them.
+ *
+ * Requires:
+ *\li	'rdataset' is a valid negative cache rdataset.
+ *\li	'pool' is a valid slab pool.
+ *\li	'sharedp' is not NULL.
+ *
+ * Returns:
+ *\li	ISC_R_SUCCESS
+ *\li	DNS_R_TOOMANYRECORDS	- the rdataset has more than 'limit' records
+ *\li	others from dns_rdataslab_fromrdataset()
+ */
+
+void
+dns_rdataslab_ncachetail(isc_region_t *region);
+/*%<
+ * If 'region' is what follows the trust in a record of a negative
+ * cache rdataslab made by dns_rdataslab_fromncache(), and it is a
+ * reference to shared rdatas, point 'region' at the shared rdatas
+ * instead: the rdata count, then the length and data of each rdata.
+ *
+ * Requires:
+ *\li	'region' is not NULL.
+ */
+
 unsigned int
 dns_rdataslab_size(unsigned char *slab, unsigned int reservelen);
 /*%<
@@ -270,6 +350,30 @@ dns_rdataslab_equalx(unsigned char *slab1, unsigned char *slab2,
  *\li	true if the slabs are equal, #false otherwise.
  */
 
+isc_result_t
+dns_rdataslab_fromrdatasetshared(dns_rdataset_t *rdataset, isc_mem_t *mctx,
+				 uint32_t limit, dns_slabshared_t **sharedp);
+/*%<
+ * Slabify a rdataset into a new shared rdataslab with one reference.
+ *
+ * Requires:
+ *\li	'rdataset' is valid and not empty.
+ *\li	'sharedp' is not NULL and '*sharedp' is NULL.
+ *
+ * Returns:
+ *\li	ISC_R_SUCCESS
+ *\li	DNS_R_TOOMANYRECORDS	- the rdataset has more than 'limit' records
+ *\li	XXX others
+ */
+
+unsigned int
+dns_slabshared_size(dns_slabshared_t *shared);
+/*%<
+ * Return the number of bytes allocated for 'shared'.
+ */
+
+ISC_REFCOUNT_DECL(dns_slabshared);
+
 dns_slabheader_t *
 dns_slabheader_fromrdataset(const dns_rdataset_t *rdataset);
 /*%
@@ -279,7 +383,39 @@ dns_slabheader_fromrdataset(const dns_rdataset_t *rdataset);
 void *
 dns_slabheader_raw(dns_slabheader_t *header);
 /*%
- * Returns the address of the raw memory following a dns_slabheader.
+ * Returns the address of the rdataslab of a dns_slabheader: either the
+ * raw memory following it, or its shared rdataslab.
+ */
+
+unsigned int
+dns_slabheader_size(dns_slabheader_t *header);
+/*%<
+ * Returns the number of bytes of rdata held by 'header', not counting
+ * the header itself.
+ */
+
+isc_result_t
+dns_slabheader_merge(dns_slabheader_t *oheader, dns_slabheader_t *nheader,
+		     isc_mem_t *mctx, dns_rdataclass_t rdclass,
+		     dns_rdatatype_t type, unsigned int flags,
+		     uint32_t maxrrperset, dns_slabheader_t **theaderp);
+/*%<
+ * Like dns_rdataslab_merge(), but for the rdataslabs of 'oheader' and
+ * 'nheader', either of which may be shared.  The new header is
+ * allocated together with its rdataslab, and the contents of 'nheader'
+ * are copied into it.
+ */
+
+isc_result_t
+dns_slabheader_subtract(dns_slabheader_t *mheader, dns_slabheader_t *sheader,
+			isc_mem_t *mctx, dns_rdataclass_t rdclass,
+			dns_rdatatype_t type, unsigned int flags,
+			dns_slabheader_t **theaderp);
+/*%<
+ * Like dns_rdataslab_subtract(), but for the rdataslabs of 'mheader'
+ * and 'sheader', either of which may be shared.  The new header is
+ * allocated together with its rdataslab, and the contents of 'mheader'
+ * are copied into it.
  */
 
 void
@@ -308,6 +444,14 @@ dns_slabheader_new(dns_db_t *db, dns_dbnode_t *node);
  * in database 'db'/node 'node'.
  */
 
+dns_slabheader_t *
+dns_slabheader_newshared(dns_db_t *db, dns_dbnode_t *node,
+			 dns_slabshared_t *shared);
+/*%<
+ * Like dns_slabheader_new(), but the new header refers to the shared
+ * rdataslab 'shared', which it attaches to.
+ */
+
 void
 dns_slabheader_destroy(dns_slabheader_t **headerp);
 /*%<
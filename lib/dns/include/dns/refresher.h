@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+/*****
+***** Module Info
+*****/
+
+/*! \file
+ * \brief
+ * The refresher keeps the most popular names in the cache of a view
+ * fresh by refetching them shortly before they expire, so that clients
+ * asking for them do not have to wait for the resolver.
+ *
+ * The popularity of the names answered from the cache is estimated
+ * with a count-min sketch, whose counters are halved once a minute so
+ * that the names which are no longer asked for fall out of it.  The
+ * most popular of them are kept in a table of a fixed size, and a
+ * timer refetches the ones that are about to expire, most popular
+ * first, as fast as a token bucket allows.
+ */
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include <isc/lang.h>
+#include <isc/refcount.h>
+#include <isc/stdtime.h>
+
+#include <dns/types.h>
+
+/* Add -DDNS_REFRESHER_TRACE=1 to CFLAGS for detailed reference tracing */
+
+ISC_LANG_BEGINDECLS
+
+void
+dns_refresher_create(dns_view_t *view, uint32_t size, uint32_t rate,
+		     dns_refresher_t **refresherp);
+/*%<
+ * Create a refresher for the cache of 'view', which tracks up to
+ * 'size' popular names and refetches at most 'rate' of them per
+ * second.  The fetches are started from, and finish on, the current
+ * loop.  The refresh times are based on the prefetch settings of
+ * 'view', which must already be configured.
+ *
+ * Requires:
+ *
+ *\li	'view' is a valid view with a resolver.
+ *\li	'size' and 'rate' are greater than zero.
+ *\li	refresherp != NULL && *refresherp == NULL
+ */
+
+#if DNS_REFRESHER_TRACE
+#define dns_refresher_ref(ptr) \
+	dns_refresher__ref(ptr, __func__, __FILE__, __LINE__)
+#define dns_refresher_unref(ptr) \
+	dns_refresher__unref(ptr, __func__, __FILE__, __LINE__)
+#define dns_refresher_attach(ptr, ptrp) \
+	dns_refresher__attach(ptr, ptrp, __func__, __FILE__, __LINE__)
+#define dns_refresher_detach(ptrp) \
+	dns_refresher__detach(ptrp, __func__, __FILE__, __LINE__)
+ISC_REFCOUNT_TRACE_DECL(dns_refresher);
+#else
+ISC_REFCOUNT_DECL(dns_refresher);
+#endif
+/*%
+ * Reference counting for dns_refresher
+ */
+
+void
+dns_refresher_hit(dns_refresher_t *refresher, const dns_name_t *name,
+		  dns_rdatatype_t type, dns_ttl_t ttl, isc_stdtime_t now);
+/*%<
+ * Count an answer to a query for 'name'/'type' from the cache, with
+ * 'ttl' seconds left before the answer expires.
+ *
+ * This is called for every answer from the cache, from any thread, so
+ * the table of popular names is only looked at for the names which
+ * are popular enough to be in it, and then only for some of the hits.
+ *
+ * Requires:
+ *
+ *\li	'refresher' is a valid refresher.
+ *\li	'name' is a valid absolute name.
+ */
+
+void
+dns_refresher_shutdown(dns_refresher_t *refresher);
+/*%<
+ * Stop refreshing and cancel the fetches in progress.  The refresher
+ * lets go of the resolver of the view, so that the view can be freed
+ * even while references to the refresher remain; the hits counted
+ * afterwards are ignored.
+ *
+ * Requires:
+ *
+ *\li	'refresher' is a valid refresher.
+ */
+
+ISC_LANG_ENDDECLS
@@ -494,6 +494,51 @@ dns_resolver_gettimeout(dns_resolver_t *resolver);
  * \li  resolver to be valid.
  */
 
+void
+dns_resolver_sethedgebudget(dns_resolver_t *resolver, unsigned int percent);
+/*%<
+ * Allow the resolver to send up to 'percent' hedged queries for every
+ * hundred other queries.  A hedged query is sent to another server when
+ * a UDP query has not been answered within the time in which its server
+ * answered 95% of its recent queries (see dns_adb_rttquantile()), and
+ * the first of the two responses is used.  Values over 100 are treated
+ * as 100; 0, the default, disables hedged queries.
+ *
+ * Requires:
+ * \li  resolver to be valid.
+ */
+
+unsigned int
+dns_resolver_gethedgebudget(dns_resolver_t *resolver);
+/*%<
+ * Get the percentage of hedged queries the resolver may send.
+ *
+ * Requires:
+ * \li  resolver to be valid.
+ */
+
+void
+dns_resolver_setforwardconnections(dns_resolver_t *resolver,
+				   unsigned int conns);
+/*%<
+ * Send the TCP and TLS queries to forwarders over a pool of up to
+ * 'conns' persistent connections per forwarder in each loop, with many
+ * queries outstanding on each connection (see dns_dispatch_getpooled()).
+ * 0, the default, opens a new connection for every query.
+ *
+ * Requires:
+ * \li  resolver to be valid.
+ */
+
+unsigned int
+dns_resolver_getforwardconnections(dns_resolver_t *resolver);
+/*%<
+ * Get the number of pooled connections per forwarder and loop.
+ *
+ * Requires:
+ * \li  resolver to be valid.
+ */
+
 void
 dns_resolver_setclientsperquery(dns_resolver_t *resolver, uint32_t min,
 				uint32_t max);
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+/*****
+***** Module Info
+*****/
+
+/*! \file dns/slabpool.h
+ * \brief
+ * Defines dns_slabpool_t, a pool of interned rdataslabs.
+ *
+ * Notes:
+ *\li	A slab pool is a hash table of shared rdataslabs (see
+ *	dns/rdataslab.h) keyed by their content.  Zone databases which
+ *	use the same pool get a reference to the one copy of each
+ *	distinct RRset instead of allocating their own, which saves a
+ *	lot of memory when many zones are made from the same template
+ *	(the same NS, MX, TXT or CAA RRsets in every zone).
+ *
+ *\li	The pool holds a reference to each of its rdataslabs.  The
+ *	rdataslabs nobody else refers to are purged from the pool as it
+ *	grows, and by dns_slabpool_purge().
+ *
+ * MP:
+ *\li	The pool is locked internally and may be used from any thread.
+ */
+
+/***
+ ***	Imports
+ ***/
+
+#include <inttypes.h>
+
+#include <isc/mem.h>
+#include <isc/refcount.h>
+
+#include <dns/types.h>
+
+ISC_LANG_BEGINDECLS
+
+/*%
+ * Slab pool statistics.
+ */
+typedef struct dns_slabpool_stats {
+	uint64_t entries;    /*%< distinct rdataslabs in the pool */
+	uint64_t bytes;	     /*%< bytes of the distinct rdataslabs */
+	uint64_t references; /*%< references to them outside the pool */
+	uint64_t saved;	     /*%< bytes the other references would take */
+	uint64_t lookups;    /*%< rdataslabs interned so far */
+	uint64_t hits;	     /*%< ... which were already in the pool */
+} dns_slabpool_stats_t;
+
+/***
+ ***	Functions
+ ***/
+
+void
+dns_slabpool_create(isc_mem_t *mctx, dns_slabpool_t **poolp);
+/*%<
+ * Create an empty slab pool; its rdataslabs will be allocated from
+ * 'mctx'.
+ *
+ * Requires:
+ *\li	'mctx' is a valid memory context
+ *\li	'poolp' is not NULL and '*poolp' is NULL
+ */
+
+ISC_REFCOUNT_DECL(dns_slabpool);
+
+isc_result_t
+dns_slabpool_intern(dns_slabpool_t *pool, dns_rdataset_t *rdataset,
+		    uint32_t maxrrperset, dns_slabshared_t **sharedp);
+/*%<
+ * Slabify 'rdataset' and return a reference to the rdataslab with the
+ * same content in 'pool', adding it to the pool first if it is not
+ * there yet.
+ *
+ * Requires:
+ *\li	'pool' is a valid slab pool
+ *\li	'rdataset' is valid and not empty
+ *\li	'sharedp' is not NULL and '*sharedp' is NULL
+ *
+ * Returns:
+ *\li	ISC_R_SUCCESS
+ *\li	DNS_R_TOOMANYRECORDS	- 'rdataset' has more than 'maxrrperset'
+ *				  records
+ *\li	others from dns_rdataslab_fromrdataset()
+ */
+
+void
+dns_slabpool_purge(dns_slabpool_t *pool);
+/*%<
+ * Remove the rdataslabs which are not used outside of 'pool' from it.
+ *
+ * Requires:
+ *\li	'pool' is a valid slab pool
+ */
+
+uint64_t
+dns_slabpool_inuse(dns_slabpool_t *pool);
+/*%<
+ * Return the number of bytes taken by the rdataslabs in 'pool', whether
+ * they are used outside of it or not.  This is cheaper than
+ * dns_slabpool_getstats().
+ *
+ * Requires:
+ *\li	'pool' is a valid slab pool
+ */
+
+void
+dns_slabpool_getstats(dns_slabpool_t *pool, dns_slabpool_stats_t *stats);
+/*%<
+ * Fill in 'stats' with the current statistics of 'pool'.
+ *
+ * Requires:
+ *\li	'pool' is a valid slab pool
+ *\li	'stats' is not NULL
+ */
+
+ISC_LANG_ENDDECLS
@@ -75,7 +75,21 @@ enum {
 	dns_resstatscounter_nextitem = 44,
 	dns_resstatscounter_priming = 45,
 	dns_resstatscounter_forwardonlyfail = 46,
-	dns_resstatscounter_max = 47,
+	dns_resstatscounter_hedged = 47,
+	dns_resstatscounter_hedgeanswered = 48,
+	dns_resstatscounter_hedgeoverbudget = 49,
+	dns_resstatscounter_fetchtime50 = 50,
+	dns_resstatscounter_fetchtime99 = 51,
+	dns_resstatscounter_refresh = 52,
+	dns_resstatscounter_refreshfail = 53,
+	dns_resstatscounter_refreshdeferred = 54,
+	dns_resstatscounter_refreshtracked = 55,
+	dns_resstatscounter_tcppoolconns = 56,
+	dns_resstatscounter_tcppoolopened = 57,
+	dns_resstatscounter_tcppoolreused = 58,
+	dns_resstatscounter_udppoolreused = 59,
+	dns_resstatscounter_udpsockopened = 60,
+	dns_resstatscounter_max = 61,
 
 	/*
 	 * DNSSEC stats.
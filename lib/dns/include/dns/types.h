@@ -55,6 +55,7 @@ typedef void			       dns_clientupdatetrans_t;
 typedef struct dns_cache	       dns_cache_t;
 typedef uint16_t		       dns_cert_t;
 typedef struct dns_compress	       dns_compress_t;
+typedef struct dns_compress_apex       dns_compress_apex_t;
 typedef enum dns_compress_flags	       dns_compress_flags_t;
 typedef struct dns_compress_slot       dns_compress_slot_t;
 typedef struct dns_db		       dns_db_t;
@@ -141,6 +142,7 @@ typedef struct dns_rdataset	  dns_rdataset_t;
 typedef ISC_LIST(dns_rdataset_t) dns_rdatasetlist_t;
 typedef struct dns_rdatasetiter dns_rdatasetiter_t;
 typedef uint16_t		dns_rdatatype_t;
+typedef struct dns_refresher	dns_refresher_t;
 typedef struct dns_remote	dns_remote_t;
 typedef struct dns_request	dns_request_t;
 typedef struct dns_requestmgr	dns_requestmgr_t;
@@ -152,6 +154,8 @@ typedef struct dns_signature	dns_signature_t;
 typedef struct dns_skr		dns_skr_t;
 typedef struct dns_slabheader	dns_slabheader_t;
 typedef ISC_LIST(dns_slabheader_t) dns_slabheaderlist_t;
+typedef struct dns_slabpool	dns_slabpool_t;
+typedef struct dns_slabshared	dns_slabshared_t;
 typedef struct dns_sortlist_arg	  dns_sortlist_arg_t;
 typedef struct dns_ssurule	  dns_ssurule_t;
 typedef struct dns_ssutable	  dns_ssutable_t;
@@ -159,6 +159,7 @@ struct dns_view {
 	char		     *nta_file;
 	dns_ttl_t	      prefetch_trigger;
 	dns_ttl_t	      prefetch_eligible;
+	dns_refresher_t	     *refresher;
 	in_port_t	      dstport;
 	dns_aclenv_t	     *aclenv;
 	dns_rdatatype_t	      preferred_glue;
@@ -26,6 +26,7 @@
 #include <isc/formatcheck.h>
 #include <isc/lang.h>
 #include <isc/rwlock.h>
+#include <isc/sockaddr.h>
 #include <isc/tls.h>
 
 #include <dns/catz.h>
@@ -35,6 +36,7 @@
 #include <dns/rdatastruct.h>
 #include <dns/rpz.h>
 #include <dns/skr.h>
+#include <dns/slabpool.h>
 #include <dns/types.h>
 #include <dns/xfrin.h>
 #include <dns/zt.h>
@@ -129,6 +131,65 @@ typedef enum {
 	DNS_ZONESTATE_AUTOMATIC,
 } dns_zonestate_t;
 
+/*%
+ * Counters of the pipelined SOA queries sent to a single primary server,
+ * or of the pipelined NOTIFY messages sent to a single secondary server;
+ * see dns_zonemgr_setserialquerypipeline() and
+ * dns_zonemgr_setnotifypipeline().
+ */
+typedef struct dns_zonemgr_peerstats {
+	isc_sockaddr_t addr;	  /*%< address of the server */
+	unsigned int   queued;	  /*%< messages waiting to be sent */
+	unsigned int   inflight;  /*%< messages waiting for a response */
+	unsigned int   window;	  /*%< current limit of 'inflight' */
+	uint64_t       completed; /*%< messages answered */
+	uint64_t       failed;	  /*%< messages failed or timed out */
+	uint64_t       srtt;	  /*%< smoothed round trip time (us) */
+} dns_zonemgr_peerstats_t;
+
+typedef isc_result_t (*dns_zonemgr_peerstats_cb_t)(
+	const dns_zonemgr_peerstats_t *stats, void *arg);
+
+/*%
+ * Throughput counters of the signing and re-signing quanta of a zone;
+ * see dns_zone_setsigningworkers().
+ */
+typedef struct dns_zone_signingstats {
+	uint64_t     signatures; /*%< RRSIGs generated */
+	uint64_t     offloaded;	 /*%< ... by the work pool threads */
+	uint64_t     nodes;	 /*%< nodes visited while signing */
+	uint64_t     quanta;	 /*%< signing and re-signing quanta */
+	uint64_t     usecs;	 /*%< time spent generating the RRSIGs */
+	unsigned int workers;	 /*%< threads generating the RRSIGs */
+} dns_zone_signingstats_t;
+
+/*%
+ * The progress of signing a zone with a key, or of removing the
+ * signatures of a key from it.
+ */
+typedef struct dns_zone_signingprogress {
+	dns_secalg_t algorithm;
+	uint16_t     keyid;
+	bool	     deleteit; /*%< removing the signatures */
+	uint64_t     nodes;    /*%< nodes processed */
+	uint64_t     total;    /*%< nodes in the zone when it started */
+} dns_zone_signingprogress_t;
+
+typedef isc_result_t (*dns_zone_signingprogress_cb_t)(
+	const dns_zone_signingprogress_t *progress, void *arg);
+
+/*%
+ * Statistics of the asynchronous dumps of a zone to its file.
+ */
+typedef struct dns_zone_dumpstats {
+	uint64_t dumps;	    /*%< dumps completed */
+	uint64_t failed;    /*%< ... of which failed or were canceled */
+	uint64_t bytes;	    /*%< bytes written */
+	uint64_t usecs;	    /*%< time spent dumping */
+	uint64_t lastbytes; /*%< bytes written by the last dump */
+	uint64_t lastusecs; /*%< time the last dump took */
+} dns_zone_dumpstats_t;
+
 #ifndef DNS_ZONE_MINREFRESH
 #define DNS_ZONE_MINREFRESH 300 /*%< 5 minutes */
 #endif				/* ifndef DNS_ZONE_MINREFRESH */
@@ -292,6 +353,17 @@ dns_zone_getorigin(dns_zone_t *zone);
  *\li	'zone' to be a valid zone.
  */
 
+const dns_compress_apex_t *
+dns_zone_getcompressapex(dns_zone_t *zone);
+/*%<
+ *	Returns the compression template of the zone apex, for the
+ *	responses from the zone (see dns_compress_setapex()), or NULL if
+ *	the origin of the zone has not been set.
+ *
+ * Require:
+ *\li	'zone' to be a valid zone.
+ */
+
 isc_result_t
 dns_zone_setfile(dns_zone_t *zone, const char *file, dns_masterformat_t format,
 		 const dns_master_style_t *style);
@@ -1244,6 +1316,29 @@ dns_zone_getjournalsize(dns_zone_t *zone);
  *\li	'zone' to be a valid zone.
  */
 
+void
+dns_zone_setdumpopts(dns_zone_t *zone, const dns_dumpopts_t *opts);
+/*%<
+ *	Set the bandwidth limit and the sync interval of the background
+ *	dumps of the zone to its file (see dns_master_dumpasync()).
+ *	If 'opts' is NULL, the file is written at full speed and synced
+ *	at the end, which is the default.
+ *
+ * Requires:
+ *\li	'zone' to be a valid zone.
+ */
+
+void
+dns_zone_getdumpstats(dns_zone_t *zone, dns_zone_dumpstats_t *stats);
+/*%<
+ *	Fill in 'stats' with the statistics of the background dumps of
+ *	the zone to its file.
+ *
+ * Requires:
+ *\li	'zone' to be a valid zone.
+ *\li	'stats' is not NULL.
+ */
+
 isc_result_t
 dns_zone_notifyreceive(dns_zone_t *zone, isc_sockaddr_t *from,
 		       isc_sockaddr_t *to, dns_message_t *msg);
@@ -1890,6 +1985,109 @@ dns_zonemgr_setserialqueryrate(dns_zonemgr_t *zmgr, unsigned int value);
  *\li	'zmgr' to be a valid zone manager
  */
 
+void
+dns_zonemgr_setserialquerypipeline(dns_zonemgr_t *zmgr, unsigned int depth);
+/*%<
+ *	Set the maximum number of SOA queries that can be outstanding at
+ *	the same time for a single primary server.  When 'depth' is not
+ *	zero, the refresh SOA queries of the secondary zones are grouped
+ *	by primary and pipelined over TCP instead of being paced by the
+ *	serial query rate; the number of outstanding queries is adapted
+ *	to the round trip time and the losses, up to 'depth'.  Zero
+ *	disables the pipelining.
+ *
+ * Requires:
+ *\li	'zmgr' to be a valid zone manager
+ */
+
+unsigned int
+dns_zonemgr_getserialquerypipeline(dns_zonemgr_t *zmgr);
+/*%<
+ *	Return the maximum number of pipelined SOA queries per primary.
+ *
+ * Requires:
+ *\li	'zmgr' to be a valid zone manager.
+ */
+
+isc_result_t
+dns_zonemgr_refreshstats(dns_zonemgr_t *zmgr, dns_zonemgr_peerstats_cb_t cb,
+			 void *arg);
+/*%<
+ *	Call 'cb' with the pipelined SOA query counters of each primary
+ *	server that has been queried, stopping at the first call that does
+ *	not return ISC_R_SUCCESS and returning its result.
+ *
+ * Requires:
+ *\li	'zmgr' to be a valid zone manager.
+ *\li	'cb' is not NULL.
+ */
+
+void
+dns_zonemgr_setnotifypipeline(dns_zonemgr_t *zmgr, unsigned int depth);
+/*%<
+ *	Set the maximum number of NOTIFY messages that can be outstanding
+ *	at the same time for a single secondary server.  When 'depth' is
+ *	not zero, the NOTIFY messages are queued per destination and paced
+ *	by a congestion window adapted to the round trip time and the
+ *	losses, up to 'depth', instead of by the notify rate; a backlog of
+ *	messages to the same destination is sent over TCP.  Zero disables
+ *	the pipelining.
+ *
+ * Requires:
+ *\li	'zmgr' to be a valid zone manager
+ */
+
+unsigned int
+dns_zonemgr_getnotifypipeline(dns_zonemgr_t *zmgr);
+/*%<
+ *	Return the maximum number of pipelined NOTIFY messages per
+ *	secondary server.
+ *
+ * Requires:
+ *\li	'zmgr' to be a valid zone manager.
+ */
+
+isc_result_t
+dns_zonemgr_notifystats(dns_zonemgr_t *zmgr, dns_zonemgr_peerstats_cb_t cb,
+			void *arg);
+/*%<
+ *	Call 'cb' with the pipelined NOTIFY counters of each destination
+ *	that has been notified, stopping at the first call that does not
+ *	return ISC_R_SUCCESS and returning its result.
+ *
+ * Requires:
+ *\li	'zmgr' to be a valid zone manager.
+ *\li	'cb' is not NULL.
+ */
+
+void
+dns_zonemgr_setinternslabs(dns_zonemgr_t *zmgr, bool value);
+/*%<
+ *	If 'value' is true, the databases of the zones made afterwards
+ *	intern their rdataslabs in a slab pool shared by all the zones of
+ *	'zmgr' (see dns/slabpool.h), so that the RRsets identical in many
+ *	zones are only stored once.  If 'value' is false, the pool is
+ *	released; the zones already using it keep it until they are
+ *	reloaded.
+ *
+ * Requires:
+ *\li	'zmgr' to be a valid zone manager.
+ */
+
+isc_result_t
+dns_zonemgr_getslabpoolstats(dns_zonemgr_t *zmgr, dns_slabpool_stats_t *stats);
+/*%<
+ *	Fill in 'stats' with the statistics of the slab pool of 'zmgr'.
+ *
+ * Requires:
+ *\li	'zmgr' to be a valid zone manager.
+ *\li	'stats' is not NULL.
+ *
+ * Returns:
+ *\li	ISC_R_SUCCESS
+ *\li	ISC_R_NOTFOUND if the rdataslabs are not interned.
+ */
+
 unsigned int
 dns_zonemgr_getnotifyrate(dns_zonemgr_t *zmgr);
 /*%<
@@ -2238,6 +2436,57 @@ dns_zone_getsignatures(dns_zone_t *zone);
  * Get the number of signatures that will be generated per quantum.
  */
 
+void
+dns_zone_setsigningworkers(dns_zone_t *zone, uint32_t workers);
+/*%<
+ * Set the number of threads generating the signatures of a signing or
+ * re-signing quantum in parallel.  The zone's loop adds the signatures
+ * to the zone in order once they are all generated.  The number of
+ * nodes and signatures processed per quantum (see dns_zone_setnodes()
+ * and dns_zone_setsignatures()) is multiplied by the number of workers.
+ *
+ * Zero, the default, means one per loop of the zone manager; the value
+ * is capped at the number of loops.  One means no parallel signing.
+ *
+ * Requires:
+ *\li	'zone' to be a valid zone.
+ */
+
+uint32_t
+dns_zone_getsigningworkers(dns_zone_t *zone);
+/*%<
+ * Get the number of threads generating the signatures of the zone, as
+ * set by dns_zone_setsigningworkers().
+ *
+ * Requires:
+ *\li	'zone' to be a valid zone.
+ */
+
+void
+dns_zone_getsigningstats(dns_zone_t *zone, dns_zone_signingstats_t *stats);
+/*%<
+ * Fill in 'stats' with the throughput counters of the signing and
+ * re-signing quanta of 'zone'.
+ *
+ * Requires:
+ *\li	'zone' to be a valid zone.
+ *\li	'stats' is not NULL.
+ */
+
+isc_result_t
+dns_zone_signingprogress(dns_zone_t *zone, dns_zone_signingprogress_cb_t cb,
+			 void *arg);
+/*%<
+ * Call 'cb' with the progress of each key the zone is being signed with
+ * or unsigned from, as of the last signing quantum, stopping at the
+ * first call that does not return ISC_R_SUCCESS and returning its
+ * result.
+ *
+ * Requires:
+ *\li	'zone' to be a valid zone.
+ *\li	'cb' is not NULL.
+ */
+
 isc_result_t
 dns_zone_signwithkey(dns_zone_t *zone, dns_secalg_t algorithm, uint16_t keyid,
 		     bool deleteit);
@@ -2556,6 +2805,15 @@ dns_zone_getrefreshkeytime(dns_zone_t *zone, isc_time_t *refreshkeytime);
  * Return the time of the next scheduled DNSSEC key event.
  */
 
+isc_result_t
+dns_zone_getslabstats(dns_zone_t *zone, uint64_t *owned, uint64_t *shared);
+/*%
+ * Return the number of bytes of rdata the zone database allocated itself
+ * and the number of bytes it shares with the raw database of the zone,
+ * see dns_db_getslabstats().  Returns ISC_R_NOTFOUND if the zone is not
+ * loaded.
+ */
+
 unsigned int
 dns_zone_getincludes(dns_zone_t *zone, char ***includesp);
 /*%
@@ -18,10 +18,13 @@
 
 #include <isc/async.h>
 #include <isc/atomic.h>
+#include <isc/condition.h>
+#include <isc/file.h>
 #include <isc/lex.h>
 #include <isc/loop.h>
 #include <isc/magic.h>
 #include <isc/mem.h>
+#include <isc/mutex.h>
 #include <isc/refcount.h>
 #include <isc/result.h>
 #include <isc/serial.h>
@@ -93,6 +96,56 @@ typedef ISC_LIST(dns_rdatalist_t) rdatalist_head_t;
 
 typedef struct dns_incctx dns_incctx_t;
 
+/*
+ * The blocks of a version 2 raw file are decoded by the loader and by up
+ * to RAWLOAD_MAXHELPERS helpers running on the work pool, at most
+ * RAWLOAD_WINDOW blocks ahead of the one being committed.  The helpers
+ * are only started for the files of at least RAWLOAD_PARALLELSIZE bytes.
+ *
+ * A helper never waits: it decodes blocks until the window is full and
+ * ends, and the loader queues a new one as it commits the blocks.
+ */
+#define RAWLOAD_MAXHELPERS   4
+#define RAWLOAD_WINDOW	     16
+#define RAWLOAD_PARALLELSIZE (1024 * 1024)
+
+typedef enum {
+	rawblock_free = 0,
+	rawblock_claimed,
+	rawblock_decoded,
+} rawblock_state_t;
+
+typedef struct rawrrset {
+	dns_name_t name; /* in the block data */
+	dns_rdatalist_t rdatalist;
+} rawrrset_t;
+
+typedef struct rawblock {
+	rawblock_state_t state;
+	isc_result_t result;
+	unsigned char *data;
+	uint32_t datasize;
+	uint32_t length;
+	uint32_t count;
+	rawrrset_t *rrsets;
+	uint32_t nrrsets;
+	dns_rdata_t *rdata;
+	uint32_t nrdata;
+} rawblock_t;
+
+typedef struct rawload {
+	isc_mutex_t lock;
+	isc_condition_t cond;
+	unsigned int helpers;
+	/* locked by lock */
+	unsigned int running; /* helpers queued or running */
+	uint64_t nextread;
+	uint64_t nextcommit;
+	bool eof;
+	bool done;
+	rawblock_t blocks[RAWLOAD_WINDOW];
+} rawload_t;
+
 /*%
  * Master file load state.
  */
@@ -133,6 +186,8 @@ struct dns_loadctx {
 	FILE *f;
 	bool first;
 	dns_masterrawheader_t header;
+	isc_loop_t *loop;
+	rawload_t *rawload;
 
 	/* Which fixed buffers we are using? */
 	isc_result_t result;
@@ -204,6 +259,9 @@ grow_rdata(int, dns_rdata_t *, int, rdatalist_head_t *, rdatalist_head_t *,
 static void
 loadctx_destroy(dns_loadctx_t *lctx);
 
+static void
+rawload_destroy(dns_loadctx_t *lctx);
+
 #define LCTX_MANYERRORS(lctx) (((lctx)->options & DNS_MASTER_MANYERRORS) != 0)
 
 #define GETTOKENERR(lexer, options, token, eol, err)                         \
@@ -451,6 +509,10 @@ loadctx_destroy(dns_loadctx_t *lctx) {
 		incctx_destroy(lctx->mctx, lctx->inc);
 	}
 
+	if (lctx->rawload != NULL) {
+		rawload_destroy(lctx);
+	}
+
 	if (lctx->f != NULL) {
 		isc_result_t result = isc_stdio_close(lctx->f);
 		if (result != ISC_R_SUCCESS) {
@@ -2304,7 +2366,8 @@ load_header(dns_loadctx_t *lctx) {
 	case 0:
 		remainder = sizeof(header.dumptime);
 		break;
-	case DNS_RAWFORMAT_VERSION:
+	case 1:
+	case 2:
 		remainder = sizeof(header) - commonlen;
 		break;
 	default:
@@ -2323,7 +2386,7 @@ load_header(dns_loadctx_t *lctx) {
 
 	isc_buffer_add(&target, (unsigned int)remainder);
 	header.dumptime = isc_buffer_getuint32(&target);
-	if (header.version == DNS_RAWFORMAT_VERSION) {
+	if (header.version >= 1) {
 		header.flags = isc_buffer_getuint32(&target);
 		header.sourceserial = isc_buffer_getuint32(&target);
 		header.lastxfrin = isc_buffer_getuint32(&target);
@@ -2348,6 +2411,493 @@ openfile_raw(dns_loadctx_t *lctx, const char *master_file) {
 	return (result);
 }
 
+/*
+ * Length of the fixed part of an RRset in the raw format: the total
+ * length, class, type, covers, TTL and the number of the records.
+ */
+#define RAWRRSET_HDRLEN (4 + 2 + 2 + 2 + 4 + 4)
+
+/*
+ * Read the next block of a version 2 raw file into 'block'.  Returns
+ * ISC_R_NOMORE at the end of the file.
+ */
+static isc_result_t
+rawblock_read(dns_loadctx_t *lctx, rawblock_t *block) {
+	isc_result_t result;
+	isc_buffer_t buffer;
+	unsigned char data[2 * sizeof(uint32_t)];
+
+	result = isc_stdio_read(data, 1, sizeof(data), lctx->f, NULL);
+	if (result == ISC_R_EOF) {
+		return (ISC_R_NOMORE);
+	}
+	if (result != ISC_R_SUCCESS) {
+		return (result);
+	}
+
+	isc_buffer_init(&buffer, data, sizeof(data));
+	isc_buffer_add(&buffer, sizeof(data));
+	block->length = isc_buffer_getuint32(&buffer);
+	block->count = isc_buffer_getuint32(&buffer);
+	if (block->count == 0 || block->length > DNS_RAWBLOCK_MAXSIZE ||
+	    block->length / RAWRRSET_HDRLEN < block->count)
+	{
+		return (ISC_R_RANGE);
+	}
+
+	if (block->length > block->datasize) {
+		if (block->data != NULL) {
+			isc_mem_put(lctx->mctx, block->data, block->datasize);
+		}
+		block->datasize = ISC_MAX(block->length, DNS_RAWBLOCK_SIZE);
+		block->data = isc_mem_get(lctx->mctx, block->datasize);
+	}
+
+	result = isc_stdio_read(block->data, 1, block->length, lctx->f, NULL);
+	if (result == ISC_R_EOF) {
+		result = ISC_R_UNEXPECTEDEND;
+	}
+
+	return (result);
+}
+
+/*
+ * Decode the RRsets of 'block' in place.  This does not touch the load
+ * callbacks, so it can be done by any thread.
+ */
+static isc_result_t
+rawblock_decode(dns_loadctx_t *lctx, rawblock_t *block) {
+	isc_result_t result;
+	isc_buffer_t source, target;
+	unsigned char *p = block->data;
+	unsigned char *end = block->data + block->length;
+	dns_rdata_t *rdata = NULL;
+	uint32_t nrdata = 0;
+
+	/*
+	 * Check the RRset lengths and count the records first, so that
+	 * the rdata array can be allocated up front: the rdatalists link
+	 * their members in place.
+	 */
+	for (uint32_t i = 0; i < block->count; i++) {
+		uint32_t totallen, rdcount;
+
+		if (end - p < RAWRRSET_HDRLEN) {
+			return (ISC_R_RANGE);
+		}
+		isc_buffer_init(&source, p, RAWRRSET_HDRLEN);
+		isc_buffer_add(&source, RAWRRSET_HDRLEN);
+		totallen = isc_buffer_getuint32(&source);
+		isc_buffer_forward(&source, 3 * sizeof(uint16_t) +
+						    sizeof(uint32_t));
+		rdcount = isc_buffer_getuint32(&source);
+		if (totallen < RAWRRSET_HDRLEN || totallen > end - p ||
+		    rdcount == 0 || rdcount > 0xffff ||
+		    rdcount > (totallen - RAWRRSET_HDRLEN) / sizeof(uint16_t))
+		{
+			return (ISC_R_RANGE);
+		}
+		nrdata += rdcount;
+		p += totallen;
+	}
+	if (p != end) {
+		return (ISC_R_RANGE);
+	}
+
+	if (block->count > block->nrrsets) {
+		if (block->rrsets != NULL) {
+			isc_mem_cput(lctx->mctx, block->rrsets, block->nrrsets,
+				     sizeof(block->rrsets[0]));
+		}
+		block->nrrsets = block->count;
+		block->rrsets = isc_mem_cget(lctx->mctx, block->nrrsets,
+					     sizeof(block->rrsets[0]));
+	}
+	if (nrdata > block->nrdata) {
+		if (block->rdata != NULL) {
+			isc_mem_cput(lctx->mctx, block->rdata, block->nrdata,
+				     sizeof(block->rdata[0]));
+		}
+		block->nrdata = nrdata;
+		block->rdata = isc_mem_cget(lctx->mctx, block->nrdata,
+					    sizeof(block->rdata[0]));
+	}
+
+	/*
+	 * Decompression is disabled and nothing is downcased, so the
+	 * names and the rdata can be decoded onto themselves.
+	 */
+	p = block->data;
+	rdata = block->rdata;
+	for (uint32_t i = 0; i < block->count; i++) {
+		rawrrset_t *rrset = &block->rrsets[i];
+		dns_rdatalist_t *rdatalist = &rrset->rdatalist;
+		uint32_t totallen, rdcount;
+		uint16_t namelen;
+		unsigned char *name;
+
+		isc_buffer_init(&source, p, end - p);
+		isc_buffer_add(&source, end - p);
+		totallen = isc_buffer_getuint32(&source);
+		isc_buffer_init(&source, p, totallen);
+		isc_buffer_add(&source, totallen);
+		isc_buffer_forward(&source, sizeof(totallen));
+		p += totallen;
+
+		dns_rdatalist_init(rdatalist);
+		rdatalist->rdclass = isc_buffer_getuint16(&source);
+		if (rdatalist->rdclass != lctx->zclass) {
+			return (DNS_R_BADCLASS);
+		}
+		rdatalist->type = isc_buffer_getuint16(&source);
+		rdatalist->covers = isc_buffer_getuint16(&source);
+		rdatalist->ttl = isc_buffer_getuint32(&source);
+		rdcount = isc_buffer_getuint32(&source);
+
+		/* Owner name: length followed by name */
+		if (isc_buffer_remaininglength(&source) < sizeof(namelen)) {
+			return (ISC_R_RANGE);
+		}
+		namelen = isc_buffer_getuint16(&source);
+		if (namelen > DNS_NAME_MAXWIRE ||
+		    isc_buffer_remaininglength(&source) < namelen)
+		{
+			return (ISC_R_RANGE);
+		}
+		name = isc_buffer_current(&source);
+		dns_name_init(&rrset->name, NULL);
+		isc_buffer_setactive(&source, namelen);
+		isc_buffer_init(&target, name, namelen);
+		result = dns_name_fromwire(&rrset->name, &source,
+					   DNS_DECOMPRESS_NEVER, &target);
+		if (result != ISC_R_SUCCESS) {
+			return (result);
+		}
+		if ((unsigned char *)isc_buffer_current(&source) !=
+		    name + namelen)
+		{
+			return (ISC_R_RANGE);
+		}
+
+		/* Rdata contents */
+		for (uint32_t j = 0; j < rdcount; j++, rdata++) {
+			uint16_t rdlen;
+
+			if (isc_buffer_remaininglength(&source) < sizeof(rdlen))
+			{
+				return (ISC_R_RANGE);
+			}
+			rdlen = isc_buffer_getuint16(&source);
+			if (isc_buffer_remaininglength(&source) < rdlen) {
+				return (ISC_R_RANGE);
+			}
+			dns_rdata_init(rdata);
+			isc_buffer_setactive(&source, rdlen);
+			isc_buffer_init(&target, isc_buffer_current(&source),
+					rdlen);
+			result = dns_rdata_fromwire(
+				rdata, rdatalist->rdclass, rdatalist->type,
+				&source, DNS_DECOMPRESS_NEVER, &target);
+			if (result != ISC_R_SUCCESS) {
+				return (result);
+			}
+			ISC_LIST_APPEND(rdatalist->rdata, rdata, link);
+		}
+
+		if (isc_buffer_remaininglength(&source) != 0) {
+			return (ISC_R_RANGE);
+		}
+	}
+
+	return (ISC_R_SUCCESS);
+}
+
+/*
+ * Add the RRsets of a decoded block to the database.  Only the loader
+ * calls this, in the file order.
+ */
+static isc_result_t
+rawblock_commit(dns_loadctx_t *lctx, rawblock_t *block) {
+	dns_rdatacallbacks_t *callbacks = lctx->callbacks;
+	rdatalist_head_t head;
+	isc_result_t result;
+
+	if (block->result != ISC_R_SUCCESS) {
+		return (block->result);
+	}
+
+	ISC_LIST_INIT(head);
+	for (uint32_t i = 0; i < block->count; i++) {
+		rawrrset_t *rrset = &block->rrsets[i];
+
+		if ((lctx->options & DNS_MASTER_CHECKTTL) != 0 &&
+		    rrset->rdatalist.ttl > lctx->maxttl)
+		{
+			(callbacks->error)(callbacks,
+					   "dns_master_load: "
+					   "TTL %d exceeds configured "
+					   "max-zone-ttl %d",
+					   rrset->rdatalist.ttl, lctx->maxttl);
+			return (ISC_R_RANGE);
+		}
+
+		/* Commit this RRset.  rdatalist will be unlinked. */
+		ISC_LIST_APPEND(head, &rrset->rdatalist, link);
+		result = commit(callbacks, lctx, &head, &rrset->name, NULL, 0);
+		if (result != ISC_R_SUCCESS) {
+			return (result);
+		}
+	}
+
+	return (ISC_R_SUCCESS);
+}
+
+/*
+ * Read the next block into the window for decoding, or return NULL at
+ * the end of the file.  A read error is recorded in the block, to be
+ * reported when the loader gets to it.  Must be called with the lock
+ * held, and with room in the window.
+ */
+static rawblock_t *
+rawload_claim(dns_loadctx_t *lctx) {
+	rawload_t *rl = lctx->rawload;
+	rawblock_t *block = NULL;
+	isc_result_t result;
+
+	REQUIRE(!rl->eof && !rl->done);
+	REQUIRE(rl->nextread - rl->nextcommit < RAWLOAD_WINDOW);
+
+	block = &rl->blocks[rl->nextread % RAWLOAD_WINDOW];
+	INSIST(block->state == rawblock_free);
+
+	result = rawblock_read(lctx, block);
+	if (result == ISC_R_NOMORE) {
+		rl->eof = true;
+		return (NULL);
+	} else if (result != ISC_R_SUCCESS) {
+		rl->eof = true;
+	}
+
+	block->state = rawblock_claimed;
+	block->result = result;
+	rl->nextread++;
+
+	return (block);
+}
+
+static void
+rawload_decode(dns_loadctx_t *lctx, rawblock_t *block) {
+	rawload_t *rl = lctx->rawload;
+
+	if (block->result == ISC_R_SUCCESS) {
+		block->result = rawblock_decode(lctx, block);
+	}
+
+	LOCK(&rl->lock);
+	block->state = rawblock_decoded;
+	SIGNAL(&rl->cond);
+	UNLOCK(&rl->lock);
+}
+
+/*
+ * Is there a block left for a helper to read and decode?  Must be called
+ * with the lock held.
+ */
+static bool
+rawload_ahead(rawload_t *rl) {
+	return (!rl->eof && !rl->done &&
+		rl->nextread - rl->nextcommit < RAWLOAD_WINDOW);
+}
+
+/*
+ * A helper decodes the blocks ahead of the loader until the window is
+ * full or the end of the file.
+ */
+static void
+rawload_help(void *arg) {
+	dns_loadctx_t *lctx = arg;
+	rawload_t *rl = lctx->rawload;
+
+	LOCK(&rl->lock);
+	while (rawload_ahead(rl)) {
+		rawblock_t *block = rawload_claim(lctx);
+		if (block != NULL) {
+			UNLOCK(&rl->lock);
+			rawload_decode(lctx, block);
+			LOCK(&rl->lock);
+		}
+	}
+	UNLOCK(&rl->lock);
+}
+
+static void
+rawload_helped(void *arg) {
+	dns_loadctx_t *lctx = arg;
+	rawload_t *rl = lctx->rawload;
+
+	LOCK(&rl->lock);
+	INSIST(rl->running > 0);
+	rl->running--;
+	UNLOCK(&rl->lock);
+
+	dns_loadctx_detach(&lctx);
+}
+
+/*
+ * The helpers are queued from the loop the load was started from, as
+ * isc_work_enqueue() must be.
+ */
+static void
+rawload_start(void *arg) {
+	dns_loadctx_t *lctx = arg;
+
+	isc_work_enqueue(lctx->loop, rawload_help, rawload_helped, lctx);
+}
+
+/*
+ * Queue a helper if fewer than allowed are running and there is work
+ * for it.  The loader does not depend on them: when they are late, it
+ * decodes the blocks itself.  Must be called with the lock held.
+ */
+static void
+rawload_spawn(dns_loadctx_t *lctx) {
+	rawload_t *rl = lctx->rawload;
+	dns_loadctx_t *helper = NULL;
+
+	if (rl->running >= rl->helpers || !rawload_ahead(rl)) {
+		return;
+	}
+
+	rl->running++;
+	dns_loadctx_attach(lctx, &helper);
+	isc_async_run(lctx->loop, rawload_start, helper);
+}
+
+static void
+rawload_destroy(dns_loadctx_t *lctx) {
+	rawload_t *rl = lctx->rawload;
+
+	lctx->rawload = NULL;
+
+	for (size_t i = 0; i < RAWLOAD_WINDOW; i++) {
+		rawblock_t *block = &rl->blocks[i];
+
+		if (block->data != NULL) {
+			isc_mem_put(lctx->mctx, block->data, block->datasize);
+		}
+		if (block->rrsets != NULL) {
+			isc_mem_cput(lctx->mctx, block->rrsets, block->nrrsets,
+				     sizeof(block->rrsets[0]));
+		}
+		if (block->rdata != NULL) {
+			isc_mem_cput(lctx->mctx, block->rdata, block->nrdata,
+				     sizeof(block->rdata[0]));
+		}
+	}
+
+	isc_condition_destroy(&rl->cond);
+	isc_mutex_destroy(&rl->lock);
+	isc_mem_put(lctx->mctx, rl, sizeof(*rl));
+}
+
+/*
+ * Load the blocks of a version 2 raw file.  They are decoded in
+ * parallel, but committed in the file order, so the database still
+ * gets the names in the DNSSEC order they were dumped in.
+ */
+static isc_result_t
+load_rawblocks(dns_loadctx_t *lctx) {
+	isc_result_t result = ISC_R_SUCCESS;
+	dns_rdatacallbacks_t *callbacks = lctx->callbacks;
+	rawload_t *rl = NULL;
+	off_t size;
+
+	rl = isc_mem_get(lctx->mctx, sizeof(*rl));
+	*rl = (rawload_t){ 0 };
+	isc_mutex_init(&rl->lock);
+	isc_condition_init(&rl->cond);
+	lctx->rawload = rl;
+
+	if (lctx->loop != NULL &&
+	    isc_file_getsizefd(fileno(lctx->f), &size) == ISC_R_SUCCESS &&
+	    size >= RAWLOAD_PARALLELSIZE)
+	{
+		isc_loopmgr_t *loopmgr = isc_loop_getloopmgr(lctx->loop);
+
+		rl->helpers = ISC_MIN(isc_loopmgr_nloops(loopmgr) - 1,
+				      RAWLOAD_MAXHELPERS);
+	}
+
+	/* open a database transaction */
+	if (callbacks->setup != NULL) {
+		callbacks->setup(callbacks->add_private);
+	}
+
+	LOCK(&rl->lock);
+	for (unsigned int i = 0; i < rl->helpers; i++) {
+		rawload_spawn(lctx);
+	}
+	while (result == ISC_R_SUCCESS) {
+		rawblock_t *block = &rl->blocks[rl->nextcommit %
+						RAWLOAD_WINDOW];
+
+		switch (block->state) {
+		case rawblock_free:
+			/* Nobody has got to this block yet */
+			if (rl->eof) {
+				result = ISC_R_NOMORE;
+				break;
+			}
+			block = rawload_claim(lctx);
+			if (block != NULL) {
+				UNLOCK(&rl->lock);
+				rawload_decode(lctx, block);
+				LOCK(&rl->lock);
+			}
+			break;
+		case rawblock_claimed:
+			WAIT(&rl->cond, &rl->lock);
+			break;
+		case rawblock_decoded:
+			UNLOCK(&rl->lock);
+			if (atomic_load_acquire(&lctx->canceled)) {
+				result = ISC_R_CANCELED;
+			} else {
+				result = rawblock_commit(lctx, block);
+			}
+			LOCK(&rl->lock);
+			block->state = rawblock_free;
+			rl->nextcommit++;
+			rawload_spawn(lctx);
+			break;
+		default:
+			UNREACHABLE();
+		}
+	}
+	rl->done = true;
+	UNLOCK(&rl->lock);
+
+	if (result == ISC_R_NOMORE) {
+		result = lctx->result;
+	}
+
+	if (result == ISC_R_SUCCESS && callbacks->rawdata != NULL) {
+		(*callbacks->rawdata)(callbacks->zone, &lctx->header);
+	}
+
+	/* commit the database transaction */
+	if (callbacks->commit != NULL) {
+		callbacks->commit(callbacks->add_private);
+	}
+
+	if (result != ISC_R_SUCCESS) {
+		(*callbacks->error)(callbacks, "dns_master_load: %s",
+				    isc_result_totext(result));
+	}
+
+	return (result);
+}
+
 static isc_result_t
 load_raw(dns_loadctx_t *lctx) {
 	isc_result_t result = ISC_R_SUCCESS;
@@ -2375,6 +2925,10 @@ load_raw(dns_loadctx_t *lctx) {
 		}
 	}
 
+	if (lctx->header.version >= 2) {
+		return (load_rawblocks(lctx));
+	}
+
 	ISC_LIST_INIT(head);
 	ISC_LIST_INIT(dummy);
 
@@ -2717,6 +3271,7 @@ dns_master_loadfileasync(const char *master_file, dns_name_t *top,
 		       &lctx);
 
 	lctx->maxttl = maxttl;
+	lctx->loop = loop;
 
 	result = (lctx->openfile)(lctx, master_file);
 	if (result != ISC_R_SUCCESS) {
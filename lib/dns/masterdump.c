@@ -30,6 +30,7 @@
 #include <isc/stdio.h>
 #include <isc/string.h>
 #include <isc/time.h>
+#include <isc/timer.h>
 #include <isc/types.h>
 #include <isc/util.h>
 #include <isc/work.h>
@@ -102,6 +103,8 @@ typedef struct dns_totext_ctx {
 	bool current_ttl_valid;
 	dns_ttl_t serve_stale_ttl;
 	dns_indent_t indent;
+	isc_buffer_t *rawblock; /* raw version 2 block being filled */
+	uint32_t rawcount;	/* number of RRsets in 'rawblock' */
 } dns_totext_ctx_t;
 
 const dns_master_style_t dns_master_style_keyzone = {
@@ -269,8 +272,31 @@ struct dns_dumpctx {
 				 dns_rdatasetiter_t *rdsiter,
 				 dns_totext_ctx_t *ctx, isc_buffer_t *buffer,
 				 FILE *f);
+	/* dns_master_dumpasync() with dns_dumpopts_t */
+	dns_dumpopts_t opts;
+	isc_loop_t *loop;
+	isc_timer_t *timer;
+	bool waiting; /* for 'timer' to resume the dump */
+	char *iobuf;
+	bool started;
+	isc_time_t start;
+	uint64_t synced;
+	dns_dumpstats_t stats;
 };
 
+/*
+ * The dumps with dns_dumpopts_t are written through a stdio buffer of
+ * this size, so the file is written in chunks of this size at offsets
+ * aligned to it.
+ */
+#define DUMP_IOBUFSIZE (256 * 1024)
+
+/*
+ * The rate-limited dumps are split into quanta of about 1/8th of a
+ * second's worth of the rate, but not smaller than the stdio buffer.
+ */
+#define DUMP_QUANTA_PER_SEC 8
+
 #define NXDOMAIN(x) (((x)->attributes & DNS_RDATASETATTR_NXDOMAIN) != 0)
 
 static const dns_indent_t default_indent = { "\t", 1 };
@@ -438,6 +464,8 @@ totext_ctx_init(const dns_master_style_t *style, const dns_indent_t *indentctx,
 	ctx->current_ttl_valid = false;
 	ctx->serve_stale_ttl = 0;
 	ctx->indent = *indentctx;
+	ctx->rawblock = NULL;
+	ctx->rawcount = 0;
 
 	return (ISC_R_SUCCESS);
 }
@@ -1216,11 +1244,48 @@ again:
 }
 
 /*
- * Dump given RRsets in the "raw" format.
+ * Write out the raw version 2 block collected in 'ctx', if any.
+ */
+static isc_result_t
+dump_rawblock(dns_totext_ctx_t *ctx, FILE *f) {
+	isc_result_t result;
+	isc_buffer_t buffer;
+	unsigned char data[2 * sizeof(uint32_t)];
+
+	if (ctx->rawcount == 0) {
+		return (ISC_R_SUCCESS);
+	}
+
+	isc_buffer_init(&buffer, data, sizeof(data));
+	isc_buffer_putuint32(&buffer, isc_buffer_usedlength(ctx->rawblock));
+	isc_buffer_putuint32(&buffer, ctx->rawcount);
+
+	result = isc_stdio_write(data, 1, sizeof(data), f, NULL);
+	if (result == ISC_R_SUCCESS) {
+		result = isc_stdio_write(isc_buffer_base(ctx->rawblock), 1,
+					 isc_buffer_usedlength(ctx->rawblock),
+					 f, NULL);
+	}
+	if (result != ISC_R_SUCCESS) {
+		UNEXPECTED_ERROR("raw master file write failed: %s",
+				 isc_result_totext(result));
+		return (result);
+	}
+
+	isc_buffer_clear(ctx->rawblock);
+	ctx->rawcount = 0;
+
+	return (ISC_R_SUCCESS);
+}
+
+/*
+ * Dump given RRsets in the "raw" format.  In version 2, they are added
+ * to the block in 'ctx' instead of being written out directly.
  */
 static isc_result_t
 dump_rdataset_raw(isc_mem_t *mctx, const dns_name_t *name,
-		  dns_rdataset_t *rdataset, isc_buffer_t *buffer, FILE *f) {
+		  dns_rdataset_t *rdataset, dns_totext_ctx_t *ctx,
+		  isc_buffer_t *buffer, FILE *f) {
 	isc_result_t result;
 	uint32_t totallen;
 	uint16_t dlen;
@@ -1308,6 +1373,23 @@ restart:
 	isc_buffer_putuint32(buffer, totallen);
 	INSIST(isc_buffer_usedlength(buffer) < totallen);
 
+	if (ctx->rawblock != NULL) {
+		if (r.length > DNS_RAWBLOCK_MAXSIZE) {
+			return (ISC_R_RANGE);
+		}
+		if (isc_buffer_usedlength(ctx->rawblock) + r.length >
+		    DNS_RAWBLOCK_MAXSIZE)
+		{
+			result = dump_rawblock(ctx, f);
+			if (result != ISC_R_SUCCESS) {
+				return (result);
+			}
+		}
+		isc_buffer_putmem(ctx->rawblock, r.base, r.length);
+		ctx->rawcount++;
+		return (ISC_R_SUCCESS);
+	}
+
 	/*
 	 * Write the buffer contents to the raw master file.
 	 */
@@ -1346,7 +1428,7 @@ dump_rdatasets_raw(isc_mem_t *mctx, const dns_name_t *owner_name,
 		{
 			/* Omit negative cache entries */
 		} else {
-			result = dump_rdataset_raw(mctx, name, &rdataset,
+			result = dump_rdataset_raw(mctx, name, &rdataset, ctx,
 						   buffer, f);
 		}
 		dns_rdataset_disassociate(&rdataset);
@@ -1359,6 +1441,13 @@ dump_rdatasets_raw(isc_mem_t *mctx, const dns_name_t *owner_name,
 		result = ISC_R_SUCCESS;
 	}
 
+	/* End the block at the first node boundary past its target size */
+	if (result == ISC_R_SUCCESS && ctx->rawblock != NULL &&
+	    isc_buffer_usedlength(ctx->rawblock) >= DNS_RAWBLOCK_SIZE)
+	{
+		result = dump_rawblock(ctx, f);
+	}
+
 	return (result);
 }
 
@@ -1377,6 +1466,15 @@ static const int initial_buffer_length = 1200;
 static isc_result_t
 dumptostream(dns_dumpctx_t *dctx);
 
+static void
+master_dump_next(dns_dumpctx_t *dctx);
+
+static void
+master_dump_resume(void *data);
+
+static void
+dump_tell(dns_dumpctx_t *dctx);
+
 static void
 dumpctx_destroy(dns_dumpctx_t *dctx) {
 	dctx->magic = 0;
@@ -1392,6 +1490,12 @@ dumpctx_destroy(dns_dumpctx_t *dctx) {
 	if (dctx->tmpfile != NULL) {
 		isc_mem_free(dctx->mctx, dctx->tmpfile);
 	}
+	if (dctx->iobuf != NULL) {
+		isc_mem_put(dctx->mctx, dctx->iobuf, DUMP_IOBUFSIZE);
+	}
+	if (dctx->tctx.rawblock != NULL) {
+		isc_buffer_free(&dctx->tctx.rawblock);
+	}
 	isc_mem_putanddetach(&dctx->mctx, dctx, sizeof(*dctx));
 }
 
@@ -1431,11 +1535,41 @@ dns_dumpctx_db(dns_dumpctx_t *dctx) {
 	return (dctx->db);
 }
 
+void
+dns_dumpctx_getstats(dns_dumpctx_t *dctx, dns_dumpstats_t *stats) {
+	REQUIRE(DNS_DCTX_VALID(dctx));
+	REQUIRE(stats != NULL);
+
+	*stats = dctx->stats;
+}
+
+/*
+ * Do not wait for the next quantum of a rate-limited dump to finish it.
+ */
+static void
+dump_cancel(void *data) {
+	dns_dumpctx_t *dctx = data;
+
+	if (dctx->waiting) {
+		isc_timer_stop(dctx->timer);
+		master_dump_resume(dctx);
+	}
+
+	dns_dumpctx_detach(&dctx);
+}
+
 void
 dns_dumpctx_cancel(dns_dumpctx_t *dctx) {
+	dns_dumpctx_t *ref = NULL;
+
 	REQUIRE(DNS_DCTX_VALID(dctx));
 
 	atomic_store_release(&dctx->canceled, true);
+
+	if (dctx->opts.maxrate != 0) {
+		dns_dumpctx_attach(dctx, &ref);
+		isc_async_run(dctx->loop, dump_cancel, ref);
+	}
 }
 
 static isc_result_t
@@ -1529,6 +1663,15 @@ master_dump_cb(void *data) {
 	} else {
 		result = dumptostream(dctx);
 	}
+	dctx->stats.quanta++;
+
+	if (result == DNS_R_CONTINUE) {
+		/* Rate-limited, master_dump_done_cb() will schedule the rest */
+		dctx->result = result;
+		return;
+	}
+
+	dump_tell(dctx);
 
 	if (dctx->file != NULL) {
 		isc_result_t tresult = ISC_R_UNSET;
@@ -1550,11 +1693,60 @@ master_dump_cb(void *data) {
 static void
 master_dump_done_cb(void *data) {
 	dns_dumpctx_t *dctx = data;
+	isc_time_t now = isc_time_now_hires();
+
+	dctx->stats.usecs = isc_time_microdiff(&now, &dctx->start);
+
+	if (dctx->result == DNS_R_CONTINUE) {
+		master_dump_next(dctx);
+		return;
+	}
+
+	if (dctx->timer != NULL) {
+		isc_timer_destroy(&dctx->timer);
+	}
 
 	(dctx->done)(dctx->done_arg, dctx->result);
 	dns_dumpctx_detach(&dctx);
 }
 
+static void
+master_dump_resume(void *data) {
+	dns_dumpctx_t *dctx = data;
+
+	dctx->waiting = false;
+	isc_work_enqueue(dctx->loop, master_dump_cb, master_dump_done_cb, dctx);
+}
+
+/*
+ * Schedule the next quantum of a rate-limited dump when the bytes
+ * written so far are due at the configured rate.  This runs on the
+ * loop, so no thread is kept waiting in the meantime.
+ */
+static void
+master_dump_next(dns_dumpctx_t *dctx) {
+	isc_interval_t interval;
+	uint64_t due;
+
+	INSIST(dctx->opts.maxrate != 0);
+
+	due = dctx->stats.bytes * US_PER_SEC / dctx->opts.maxrate;
+	if (due <= dctx->stats.usecs || atomic_load_acquire(&dctx->canceled)) {
+		master_dump_resume(dctx);
+		return;
+	}
+
+	due -= dctx->stats.usecs;
+	if (dctx->timer == NULL) {
+		isc_timer_create(dctx->loop, master_dump_resume, dctx,
+				 &dctx->timer);
+	}
+	isc_interval_set(&interval, due / US_PER_SEC,
+			 (due % US_PER_SEC) * NS_PER_US);
+	isc_timer_start(dctx->timer, isc_timertype_once, &interval);
+	dctx->waiting = true;
+}
+
 static isc_result_t
 dumpctx_create(isc_mem_t *mctx, dns_db_t *db, dns_dbversion_t *version,
 	       const dns_master_style_t *style, FILE *f, dns_dumpctx_t **dctxp,
@@ -1593,6 +1785,7 @@ dumpctx_create(isc_mem_t *mctx, dns_db_t *db, dns_dbversion_t *version,
 	}
 
 	dctx->now = isc_stdtime_now();
+	dctx->start = isc_time_now_hires();
 	dns_db_attach(db, &dctx->db);
 
 	dctx->do_date = dns_db_iscache(dctx->db);
@@ -1676,16 +1869,24 @@ writeheader(dns_dumpctx_t *dctx) {
 		r.length = sizeof(rawheader);
 		isc_buffer_region(&buffer, &r);
 		now32 = dctx->now;
-		rawversion = 1;
+		rawversion = DNS_RAWFORMAT_VERSION;
 		if ((dctx->header.flags & DNS_MASTERRAW_COMPAT) != 0) {
 			rawversion = 0;
+		} else if (dctx->header.version != 0) {
+			rawversion = dctx->header.version;
 		}
+		INSIST(rawversion <= DNS_RAWFORMAT_MAXVERSION);
 
 		isc_buffer_putuint32(&buffer, dctx->format);
 		isc_buffer_putuint32(&buffer, rawversion);
 		isc_buffer_putuint32(&buffer, now32);
 
-		if (rawversion == 1) {
+		if (rawversion >= 2) {
+			isc_buffer_allocate(dctx->mctx, &dctx->tctx.rawblock,
+					    DNS_RAWBLOCK_SIZE);
+		}
+
+		if (rawversion >= 1) {
 			isc_buffer_putuint32(&buffer, dctx->header.flags);
 			isc_buffer_putuint32(&buffer,
 					     dctx->header.sourceserial);
@@ -1709,6 +1910,48 @@ writeheader(dns_dumpctx_t *dctx) {
 	return (result);
 }
 
+static void
+dump_tell(dns_dumpctx_t *dctx) {
+	off_t offset;
+
+	if (isc_stdio_tell(dctx->f, &offset) == ISC_R_SUCCESS) {
+		dctx->stats.bytes = offset;
+	}
+}
+
+/*
+ * Called between the nodes of a dump with dns_dumpopts_t: sync the file
+ * if enough has been written since the last time, and end the quantum
+ * with DNS_R_CONTINUE once 'limit' bytes have been written.
+ */
+static isc_result_t
+dump_progress(dns_dumpctx_t *dctx, uint64_t limit) {
+	isc_result_t result;
+
+	dump_tell(dctx);
+
+	if (dctx->opts.syncsize != 0 &&
+	    dctx->stats.bytes - dctx->synced >= dctx->opts.syncsize)
+	{
+		result = flushandsync(dctx->f, ISC_R_SUCCESS, dctx->tmpfile);
+		if (result != ISC_R_SUCCESS) {
+			return (result);
+		}
+		dctx->synced = dctx->stats.bytes;
+		dctx->stats.syncs++;
+#if defined(POSIX_FADV_DONTNEED)
+		/* Do not let a large dump push everything out of the cache */
+		posix_fadvise(fileno(dctx->f), 0, 0, POSIX_FADV_DONTNEED);
+#endif
+	}
+
+	if (limit != 0 && dctx->stats.bytes >= limit) {
+		return (DNS_R_CONTINUE);
+	}
+
+	return (ISC_R_SUCCESS);
+}
+
 static isc_result_t
 dumptostream(dns_dumpctx_t *dctx) {
 	isc_result_t result = ISC_R_SUCCESS;
@@ -1717,6 +1960,8 @@ dumptostream(dns_dumpctx_t *dctx) {
 	dns_name_t *name;
 	dns_fixedname_t fixname;
 	unsigned int options = DNS_DB_STALEOK;
+	bool progress = (dctx->opts.maxrate != 0 || dctx->opts.syncsize != 0);
+	uint64_t limit = 0;
 
 	if ((dctx->tctx.style.flags & DNS_STYLEFLAG_EXPIRED) != 0) {
 		options |= DNS_DB_EXPIREDOK;
@@ -1728,11 +1973,25 @@ dumptostream(dns_dumpctx_t *dctx) {
 
 	name = dns_fixedname_initname(&fixname);
 
-	CHECK(writeheader(dctx));
+	/*
+	 * A rate-limited dump resumes at the node the iterator was left
+	 * at by the previous quantum.
+	 */
+	if (!dctx->started) {
+		dctx->started = true;
+
+		CHECK(writeheader(dctx));
 
-	result = dns_dbiterator_first(dctx->dbiter);
-	if (result != ISC_R_SUCCESS && result != ISC_R_NOMORE) {
-		goto cleanup;
+		result = dns_dbiterator_first(dctx->dbiter);
+		if (result != ISC_R_SUCCESS && result != ISC_R_NOMORE) {
+			goto cleanup;
+		}
+	}
+
+	if (dctx->opts.maxrate != 0) {
+		limit = dctx->stats.bytes +
+			ISC_MAX(dctx->opts.maxrate / DUMP_QUANTA_PER_SEC,
+				DUMP_IOBUFSIZE);
 	}
 
 	while (result == ISC_R_SUCCESS) {
@@ -1774,11 +2033,17 @@ dumptostream(dns_dumpctx_t *dctx) {
 		}
 		dns_db_detachnode(dctx->db, &node);
 		result = dns_dbiterator_next(dctx->dbiter);
+		if (result == ISC_R_SUCCESS && progress) {
+			result = dump_progress(dctx, limit);
+		}
 	}
 
 	if (result == ISC_R_NOMORE) {
 		result = ISC_R_SUCCESS;
 	}
+	if (result == ISC_R_SUCCESS && dctx->tctx.rawblock != NULL) {
+		result = dump_rawblock(&dctx->tctx, dctx->f);
+	}
 cleanup:
 	RUNTIME_CHECK(dns_dbiterator_pause(dctx->dbiter) == ISC_R_SUCCESS);
 	isc_mem_put(dctx->mctx, buffer.base, buffer.length);
@@ -1805,6 +2070,7 @@ dns_master_dumptostreamasync(isc_mem_t *mctx, dns_db_t *db,
 	}
 	dctx->done = done;
 	dctx->done_arg = done_arg;
+	dctx->loop = loop;
 
 	dns_dumpctx_attach(dctx, dctxp);
 	isc_work_enqueue(loop, master_dump_cb, master_dump_done_cb, dctx);
@@ -1876,7 +2142,8 @@ dns_master_dumpasync(isc_mem_t *mctx, dns_db_t *db, dns_dbversion_t *version,
 		     const dns_master_style_t *style, const char *filename,
 		     isc_loop_t *loop, dns_dumpdonefunc_t done, void *done_arg,
 		     dns_dumpctx_t **dctxp, dns_masterformat_t format,
-		     dns_masterrawheader_t *header) {
+		     dns_masterrawheader_t *header,
+		     const dns_dumpopts_t *opts) {
 	FILE *f = NULL;
 	isc_result_t result;
 	char *tempname = NULL;
@@ -1898,9 +2165,16 @@ dns_master_dumpasync(isc_mem_t *mctx, dns_db_t *db, dns_dbversion_t *version,
 
 	dctx->done = done;
 	dctx->done_arg = done_arg;
+	dctx->loop = loop;
 	dctx->file = file;
 	dctx->tmpfile = tempname;
 
+	if (opts != NULL) {
+		dctx->opts = *opts;
+		dctx->iobuf = isc_mem_get(mctx, DUMP_IOBUFSIZE);
+		(void)setvbuf(f, dctx->iobuf, _IOFBF, DUMP_IOBUFSIZE);
+	}
+
 	dns_dumpctx_attach(dctx, dctxp);
 	isc_work_enqueue(loop, master_dump_cb, master_dump_done_cb, dctx);
 
@@ -35,6 +35,7 @@
 #include <isc/work.h>
 
 #include <dns/dnssec.h>
+#include <dns/fixedname.h>
 #include <dns/keyvalues.h>
 #include <dns/masterdump.h>
 #include <dns/message.h>
@@ -123,6 +124,13 @@ hexdump(const char *msg, const char *msg2, void *base, size_t len) {
 #define RDATASET_FILLCOUNT 1024
 #define RDATASET_FREEMAX   8 * RDATASET_FILLCOUNT
 
+/*%
+ * The largest OPT record the fast path of dns_message_parse() takes;
+ * the ones in the queries hardly ever have more than a cookie, an ECS
+ * option and some padding.
+ */
+#define FAST_OPTSIZE 512
+
 /*%
  * Text representation of the different items, for message_totext
  * functions.
@@ -183,6 +191,21 @@ msgblock_allocate(isc_mem_t *, unsigned int, unsigned int);
 #define msgblock_get(block, type) \
 	((type *)msgblock_internalget(block, sizeof(type)))
 
+/*%
+ * The storage for the question and the OPT record of a query parsed by
+ * the fast path (see getfastquery()).  It is allocated with the first
+ * such query and kept until the message is destroyed.
+ */
+struct dns_msgfast {
+	dns_fixedname_t qname;
+	dns_rdatalist_t qlist;
+	dns_rdataset_t qrdataset;
+	dns_rdata_t optrdata;
+	dns_rdatalist_t optlist;
+	dns_rdataset_t optrdataset;
+	unsigned char optdata[FAST_OPTSIZE];
+};
+
 /*
  * A context type to pass information when checking a message signature
  * asynchronously.
@@ -784,6 +807,10 @@ dns__message_destroy(dns_message_t *msg) {
 
 	msg->magic = 0;
 
+	if (msg->fast != NULL) {
+		isc_mem_put(msg->mctx, msg->fast, sizeof(*msg->fast));
+	}
+
 	if (msg->free_pools) {
 		dns_message_destroypools(&msg->namepool, &msg->rdspool);
 	}
@@ -1740,6 +1767,162 @@ cleanup:
 	return (result);
 }
 
+/*
+ * The objects of the fast path are part of msg->fast, so they must not
+ * be put back to the memory pools or to the free lists.
+ */
+static bool
+isfast(dns_message_t *msg, const void *item) {
+	const unsigned char *p = item;
+	const unsigned char *fast = (const unsigned char *)msg->fast;
+
+	return (fast != NULL && p >= fast && p < fast + sizeof(*msg->fast));
+}
+
+/*
+ * Parse the rest of the most common message of all: a query with one
+ * question, and either nothing else or just an OPT record.  The header
+ * has already been read.
+ *
+ * Everything is decoded straight into msg->fast, so apart from the
+ * first time, nothing is allocated.  The question name is never
+ * compressed, as there is nothing before it that it could point to,
+ * and the OPT owner is always the root name, so neither needs the
+ * general name decompression.
+ *
+ * If the message is anything else, or anything about it is odd,
+ * return false without touching 'source' or 'msg' except for
+ * msg->fast, and let the general parser deal with it (and report
+ * the errors, if there are any).
+ */
+static bool
+getfastquery(isc_buffer_t *source, dns_message_t *msg) {
+	isc_buffer_t buffer = *source;
+	isc_buffer_t target;
+	isc_region_t r;
+	dns_msgfast_t *fast = NULL;
+	dns_name_t *qname = NULL;
+	dns_rdatatype_t qtype;
+	dns_rdataclass_t qclass;
+	bool hasopt = false;
+
+	if ((msg->flags & DNS_MESSAGEFLAG_QR) != 0 ||
+	    msg->opcode != dns_opcode_query ||
+	    msg->counts[DNS_SECTION_QUESTION] != 1 ||
+	    msg->counts[DNS_SECTION_ANSWER] != 0 ||
+	    msg->counts[DNS_SECTION_AUTHORITY] != 0 ||
+	    msg->counts[DNS_SECTION_ADDITIONAL] > 1)
+	{
+		return (false);
+	}
+
+	if (msg->fast == NULL) {
+		msg->fast = isc_mem_get(msg->mctx, sizeof(*msg->fast));
+	}
+	fast = msg->fast;
+
+	/*
+	 * The question.
+	 */
+	qname = dns_fixedname_initname(&fast->qname);
+	isc_buffer_remainingregion(&buffer, &r);
+	isc_buffer_setactive(&buffer, r.length);
+	if (dns_name_fromwire(qname, &buffer, DNS_DECOMPRESS_NEVER, NULL) !=
+	    ISC_R_SUCCESS)
+	{
+		return (false);
+	}
+
+	isc_buffer_remainingregion(&buffer, &r);
+	if (r.length < 4) {
+		return (false);
+	}
+	qtype = isc_buffer_getuint16(&buffer);
+	qclass = isc_buffer_getuint16(&buffer);
+
+	/*
+	 * The OPT record, with the same checks as in getsection().
+	 */
+	if (msg->counts[DNS_SECTION_ADDITIONAL] == 1) {
+		dns_rdataclass_t udpsize;
+		dns_ttl_t ttl;
+		unsigned int rdatalen;
+
+		isc_buffer_remainingregion(&buffer, &r);
+		if (r.length < 1 + 2 + 2 + 4 + 2 || r.base[0] != 0 ||
+		    (r.base[1] << 8 | r.base[2]) != dns_rdatatype_opt)
+		{
+			return (false);
+		}
+		isc_buffer_forward(&buffer, 1 + 2);
+		udpsize = isc_buffer_getuint16(&buffer);
+		ttl = isc_buffer_getuint32(&buffer);
+		rdatalen = isc_buffer_getuint16(&buffer);
+		if (r.length - (1 + 2 + 2 + 4 + 2) < rdatalen ||
+		    rdatalen > sizeof(fast->optdata))
+		{
+			return (false);
+		}
+
+		dns_rdata_init(&fast->optrdata);
+		isc_buffer_init(&target, fast->optdata, sizeof(fast->optdata));
+		isc_buffer_setactive(&buffer, rdatalen);
+		if (dns_rdata_fromwire(&fast->optrdata, udpsize,
+				       dns_rdatatype_opt, &buffer,
+				       DNS_DECOMPRESS_NEVER,
+				       &target) != ISC_R_SUCCESS)
+		{
+			return (false);
+		}
+
+		dns_rdatalist_init(&fast->optlist);
+		fast->optlist.type = dns_rdatatype_opt;
+		fast->optlist.rdclass = udpsize;
+		fast->optlist.ttl = ttl;
+		ISC_LIST_APPEND(fast->optlist.rdata, &fast->optrdata, link);
+		dns_rdataset_init(&fast->optrdataset);
+		dns_rdatalist_tordataset(&fast->optlist, &fast->optrdataset);
+		hasopt = true;
+	}
+
+	/* Leave the trailing garbage for the general parser to log */
+	if (isc_buffer_remaininglength(&buffer) != 0) {
+		if (hasopt) {
+			dns_rdataset_disassociate(&fast->optrdataset);
+		}
+		return (false);
+	}
+
+	/*
+	 * All is well, fill in the message.
+	 */
+	dns_rdatalist_init(&fast->qlist);
+	fast->qlist.type = qtype;
+	fast->qlist.rdclass = qclass;
+	dns_rdataset_init(&fast->qrdataset);
+	dns_rdatalist_tordataset(&fast->qlist, &fast->qrdataset);
+	fast->qrdataset.attributes |= DNS_RDATASETATTR_QUESTION;
+
+	ISC_LIST_APPEND(qname->list, &fast->qrdataset, link);
+	ISC_LIST_APPEND(msg->sections[DNS_SECTION_QUESTION], qname, link);
+	msg->rdclass = qclass;
+	msg->rdclass_set = 1;
+	if (qtype == dns_rdatatype_tkey) {
+		msg->tkey = 1;
+	}
+
+	if (hasopt) {
+		msg->opt = &fast->optrdataset;
+		msg->rcode |= (dns_rcode_t)((msg->opt->ttl &
+					     DNS_MESSAGE_EDNSRCODE_MASK) >>
+					    20);
+	}
+
+	*source = buffer;
+
+	return (true);
+}
+
 isc_result_t
 dns_message_parse(dns_message_t *msg, isc_buffer_t *source,
 		  unsigned int options) {
@@ -1792,6 +1975,13 @@ dns_message_parse(dns_message_t *msg, isc_buffer_t *source,
 	msg->header_ok = 1;
 	msg->state = DNS_SECTION_QUESTION;
 
+	if ((options & DNS_MESSAGEPARSE_FASTQUERY) != 0 &&
+	    getfastquery(source, msg))
+	{
+		msg->question_ok = 1;
+		return (ISC_R_SUCCESS);
+	}
+
 	dctx = DNS_DECOMPRESS_ALWAYS;
 
 	ret = getquestions(source, msg, dctx, options);
@@ -2657,6 +2847,10 @@ dns_message_puttempname(dns_message_t *msg, dns_name_t **itemp) {
 	REQUIRE(!ISC_LINK_LINKED(item, link));
 	REQUIRE(ISC_LIST_HEAD(item->list) == NULL);
 
+	if (isfast(msg, item)) {
+		return;
+	}
+
 	if (item->hashmap != NULL) {
 		isc_hashmap_destroy(&item->hashmap);
 	}
@@ -2681,7 +2875,9 @@ dns_message_puttemprdata(dns_message_t *msg, dns_rdata_t **item) {
 	REQUIRE(DNS_MESSAGE_VALID(msg));
 	REQUIRE(item != NULL && *item != NULL);
 
-	releaserdata(msg, *item);
+	if (!isfast(msg, *item)) {
+		releaserdata(msg, *item);
+	}
 	*item = NULL;
 }
 
@@ -2697,7 +2893,9 @@ dns_message_puttemprdataset(dns_message_t *msg, dns_rdataset_t **item) {
 	REQUIRE(item != NULL && *item != NULL);
 
 	REQUIRE(!dns_rdataset_isassociated(*item));
-	isc_mempool_put(msg->rdspool, *item);
+	if (!isfast(msg, *item)) {
+		isc_mempool_put(msg->rdspool, *item);
+	}
 	*item = NULL;
 }
 
@@ -2706,7 +2904,9 @@ dns_message_puttemprdatalist(dns_message_t *msg, dns_rdatalist_t **item) {
 	REQUIRE(DNS_MESSAGE_VALID(msg));
 	REQUIRE(item != NULL && *item != NULL);
 
-	releaserdatalist(msg, *item);
+	if (!isfast(msg, *item)) {
+		releaserdatalist(msg, *item);
+	}
 	*item = NULL;
 }
 
@@ -25,6 +25,7 @@
 #include <dns/rdata.h>
 #include <dns/rdatalist.h>
 #include <dns/rdataset.h>
+#include <dns/rdataslab.h>
 #include <dns/rdatastruct.h>
 
 #define DNS_NCACHE_RDATA 100U
@@ -40,6 +41,10 @@
  *	rdata length			These two occur 'rdata
  *	rdata				count' times.
  *
+ * In a cache, everything after the trust may be kept in an rdataslab
+ * shared with other negative entries, and only referred to from the
+ * record (see dns_rdataslab_fromncache()).  The trust, which the
+ * validator may change, always stays in the record itself.
  */
 
 static uint8_t
@@ -332,6 +337,11 @@ dns_ncache_towire(dns_rdataset_t *rdataset, dns_compress_t *cctx,
 		INSIST(remaining.length >= 5);
 		type = isc_buffer_getuint16(&source);
 		isc_buffer_forward(&source, 1);
+
+		isc_buffer_remainingregion(&source, &remaining);
+		dns_rdataslab_ncachetail(&remaining);
+		isc_buffer_init(&source, remaining.base, remaining.length);
+		isc_buffer_add(&source, remaining.length);
 		rcount = isc_buffer_getuint16(&source);
 
 		for (i = 0; i < rcount; i++) {
@@ -501,10 +511,10 @@ rdataset_count(dns_rdataset_t *rdataset) {
 
 static void
 rdataset_settrust(dns_rdataset_t *rdataset, dns_trust_t trust) {
-	atomic_uchar *raw;
+	atomic_uchar *trustp;
 
-	raw = (atomic_uchar *)rdataset->ncache.raw;
-	atomic_store_relaxed(&raw[-1], (unsigned char)trust);
+	trustp = (atomic_uchar *)rdataset->ncache.trust;
+	atomic_store_relaxed(trustp, (unsigned char)trust);
 	rdataset->trust = trust;
 }
 
@@ -528,6 +538,7 @@ dns_ncache_getrdataset(dns_rdataset_t *ncacherdataset, dns_name_t *name,
 	dns_name_t tname;
 	dns_rdatatype_t ttype;
 	dns_trust_t trust = dns_trust_none;
+	unsigned char *trustp = NULL;
 	dns_rdataset_t rclone;
 
 	REQUIRE(ncacherdataset != NULL);
@@ -556,9 +567,11 @@ dns_ncache_getrdataset(dns_rdataset_t *ncacherdataset, dns_name_t *name,
 		ttype = isc_buffer_getuint16(&source);
 
 		if (ttype == type && dns_name_equal(&tname, name)) {
+			trustp = isc_buffer_current(&source);
 			trust = atomic_getuint8(&source);
 			INSIST(trust <= dns_trust_ultimate);
 			isc_buffer_remainingregion(&source, &remaining);
+			dns_rdataslab_ncachetail(&remaining);
 			break;
 		}
 		result = dns_rdataset_next(&rclone);
@@ -580,6 +593,7 @@ dns_ncache_getrdataset(dns_rdataset_t *ncacherdataset, dns_name_t *name,
 	rdataset->covers = 0;
 	rdataset->ttl = ncacherdataset->ttl;
 	rdataset->trust = trust;
+	rdataset->ncache.trust = trustp;
 	rdataset->ncache.raw = remaining.base;
 	rdataset->ncache.iter_pos = NULL;
 	rdataset->ncache.iter_count = 0;
@@ -596,6 +610,7 @@ dns_ncache_getsigrdataset(dns_rdataset_t *ncacherdataset, dns_name_t *name,
 	dns_rdataset_t rclone;
 	dns_rdatatype_t type;
 	dns_trust_t trust = dns_trust_none;
+	unsigned char *trustp = NULL;
 	isc_buffer_t source;
 	isc_region_t remaining, sigregion;
 	isc_result_t result;
@@ -635,9 +650,11 @@ dns_ncache_getsigrdataset(dns_rdataset_t *ncacherdataset, dns_name_t *name,
 		}
 
 		INSIST(remaining.length >= 1);
+		trustp = isc_buffer_current(&source);
 		trust = atomic_getuint8(&source);
 		INSIST(trust <= dns_trust_ultimate);
 		isc_region_consume(&remaining, 1);
+		dns_rdataslab_ncachetail(&remaining);
 
 		raw = remaining.base;
 		count = raw[0] * 256 + raw[1];
@@ -651,7 +668,6 @@ dns_ncache_getsigrdataset(dns_rdataset_t *ncacherdataset, dns_name_t *name,
 				     dns_rdatatype_rrsig, &sigregion);
 		(void)dns_rdata_tostruct(&rdata, &rrsig, NULL);
 		if (rrsig.covered == covers) {
-			isc_buffer_remainingregion(&source, &remaining);
 			break;
 		}
 
@@ -674,6 +690,7 @@ dns_ncache_getsigrdataset(dns_rdataset_t *ncacherdataset, dns_name_t *name,
 	rdataset->covers = covers;
 	rdataset->ttl = ncacherdataset->ttl;
 	rdataset->trust = trust;
+	rdataset->ncache.trust = trustp;
 	rdataset->ncache.raw = remaining.base;
 	rdataset->ncache.iter_pos = NULL;
 	rdataset->ncache.iter_count = 0;
@@ -686,6 +703,7 @@ dns_ncache_current(dns_rdataset_t *ncacherdataset, dns_name_t *found,
 		   dns_rdataset_t *rdataset) {
 	dns_rdata_t rdata = DNS_RDATA_INIT;
 	dns_trust_t trust;
+	unsigned char *trustp = NULL;
 	isc_region_t remaining, sigregion;
 	isc_buffer_t source;
 	dns_name_t tname;
@@ -713,9 +731,11 @@ dns_ncache_current(dns_rdataset_t *ncacherdataset, dns_name_t *found,
 
 	INSIST(remaining.length >= 5);
 	type = isc_buffer_getuint16(&source);
+	trustp = isc_buffer_current(&source);
 	trust = atomic_getuint8(&source);
 	INSIST(trust <= dns_trust_ultimate);
 	isc_buffer_remainingregion(&source, &remaining);
+	dns_rdataslab_ncachetail(&remaining);
 
 	covers = 0;
 	if (type == dns_rdatatype_rrsig) {
@@ -742,6 +762,7 @@ dns_ncache_current(dns_rdataset_t *ncacherdataset, dns_name_t *found,
 	rdataset->covers = covers;
 	rdataset->ttl = ncacherdataset->ttl;
 	rdataset->trust = trust;
+	rdataset->ncache.trust = trustp;
 	rdataset->ncache.raw = remaining.base;
 	rdataset->ncache.iter_pos = NULL;
 	rdataset->ncache.iter_count = 0;
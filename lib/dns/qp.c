@@ -1766,6 +1766,190 @@ dns_qp_deletename(dns_qp_t *qp, const dns_name_t *name, void **pval_r,
 	return (dns_qp_deletekey(qp, key, keylen, pval_r, ival_r));
 }
 
+/***********************************************************************
+ *
+ *  bulk loading
+ */
+
+/*
+ * A branch can have a twig for each bit between SHIFT_NOBYTE and
+ * SHIFT_OFFSET.
+ */
+#define QPBUILD_MAX_TWIGS (SHIFT_OFFSET - SHIFT_NOBYTE)
+
+/*
+ * The leaves arrive in key order, so the trie is built bottom-up along
+ * its right-hand edge. Each level is a branch on the path to the last
+ * leaf that has not been finished yet; its twigs are kept here until
+ * no more leaves can be added below it, and then they are allocated
+ * in one go. The twig that contains the last leaf is not in `twigs`
+ * yet: it is the level above's (or the builder's) `last` node.
+ */
+typedef struct qpbuild_level {
+	size_t offset;
+	uint64_t bitmap;
+	dns_qpweight_t size;
+	dns_qpnode_t twigs[QPBUILD_MAX_TWIGS];
+} qpbuild_level_t;
+
+struct dns_qpbuild {
+	uint32_t magic;
+	dns_qp_t *qp;
+	dns_qpnode_t last;
+	dns_qpkey_t key;
+	size_t keylen;
+	qpbuild_level_t *level;
+	size_t depth;
+	size_t max_depth;
+};
+
+/*
+ * Finish the branch at the top of the stack by allocating its twigs,
+ * including `last`, and return the branch node.
+ */
+static dns_qpnode_t
+build_branch(dns_qpbuild_t *qpb) {
+	dns_qp_t *qp = qpb->qp;
+	qpbuild_level_t *level = &qpb->level[--qpb->depth];
+	dns_qpref_t ref;
+	uint64_t index;
+
+	level->twigs[level->size++] = qpb->last;
+	ref = alloc_twigs(qp, level->size);
+	move_twigs(ref_ptr(qp, ref), level->twigs, level->size);
+
+	index = BRANCH_TAG | level->bitmap |
+		((uint64_t)level->offset << SHIFT_OFFSET);
+	return (make_node(index, ref));
+}
+
+void
+dns_qpbuild_begin(dns_qp_t *qp, dns_qpbuild_t **qpbp) {
+	dns_qpbuild_t *qpb = NULL;
+
+	REQUIRE(QP_VALID(qp));
+	REQUIRE(qp->leaf_count <= 1);
+	REQUIRE(qpbp != NULL && *qpbp == NULL);
+
+	qpb = isc_mem_get(qp->mctx, sizeof(*qpb));
+	*qpb = (dns_qpbuild_t){
+		.magic = QPBUILD_MAGIC,
+		.qp = qp,
+		.max_depth = 8,
+	};
+	qpb->level = isc_mem_cget(qp->mctx, qpb->max_depth,
+				  sizeof(qpb->level[0]));
+
+	/*
+	 * Take the existing leaf out of the trie; the root is put back
+	 * when the build is finished.
+	 */
+	if (qp->leaf_count == 1) {
+		qpb->last = *ref_ptr(qp, qp->root_ref);
+		INSIST(!is_branch(&qpb->last));
+		qpb->keylen = leaf_qpkey(qp, &qpb->last, qpb->key);
+		if (!free_twigs(qp, qp->root_ref, 1)) {
+			attach_leaf(qp, &qpb->last);
+		}
+		qp->root_ref = INVALID_REF;
+	}
+
+	*qpbp = qpb;
+}
+
+isc_result_t
+dns_qpbuild_add(dns_qpbuild_t *qpb, void *pval, uint32_t ival) {
+	dns_qp_t *qp = NULL;
+	dns_qpnode_t new_leaf;
+	dns_qpkey_t new_key;
+	size_t new_keylen;
+	dns_qpshift_t new_bit, old_bit;
+	size_t offset;
+
+	REQUIRE(QPBUILD_VALID(qpb));
+
+	qp = qpb->qp;
+	new_leaf = make_leaf(pval, ival);
+	new_keylen = leaf_qpkey(qp, &new_leaf, new_key);
+
+	if (qp->leaf_count > 0) {
+		offset = qpkey_compare(new_key, new_keylen, qpb->key,
+				       qpb->keylen);
+		if (offset == QPKEY_EQUAL) {
+			return (ISC_R_EXISTS);
+		}
+		new_bit = qpkey_bit(new_key, new_keylen, offset);
+		old_bit = qpkey_bit(qpb->key, qpb->keylen, offset);
+		if (new_bit < old_bit) {
+			return (ISC_R_RANGE);
+		}
+
+		/* the branches below the new leaf's are complete */
+		while (qpb->depth > 0 &&
+		       qpb->level[qpb->depth - 1].offset > offset)
+		{
+			qpb->last = build_branch(qpb);
+		}
+
+		if (qpb->depth > 0 &&
+		    qpb->level[qpb->depth - 1].offset == offset)
+		{
+			/* grow the branch */
+			qpbuild_level_t *level = &qpb->level[qpb->depth - 1];
+			level->twigs[level->size++] = qpb->last;
+			level->bitmap |= 1ULL << new_bit;
+		} else {
+			/* new branch */
+			if (qpb->depth == qpb->max_depth) {
+				size_t max_depth = GROWTH_FACTOR(qpb->depth);
+				qpb->level = isc_mem_creget(
+					qp->mctx, qpb->level, qpb->max_depth,
+					max_depth, sizeof(qpb->level[0]));
+				qpb->max_depth = max_depth;
+			}
+			qpb->level[qpb->depth++] = (qpbuild_level_t){
+				.offset = offset,
+				.bitmap = (1ULL << old_bit) | (1ULL << new_bit),
+				.size = 1,
+				.twigs = { qpb->last },
+			};
+		}
+	}
+
+	qpb->last = new_leaf;
+	memmove(qpb->key, new_key, new_keylen);
+	qpb->keylen = new_keylen;
+	attach_leaf(qp, &new_leaf);
+	qp->leaf_count++;
+
+	return (ISC_R_SUCCESS);
+}
+
+void
+dns_qpbuild_finish(dns_qpbuild_t **qpbp) {
+	dns_qpbuild_t *qpb = NULL;
+	dns_qp_t *qp = NULL;
+
+	REQUIRE(qpbp != NULL && QPBUILD_VALID(*qpbp));
+
+	qpb = *qpbp;
+	*qpbp = NULL;
+	qp = qpb->qp;
+
+	while (qpb->depth > 0) {
+		qpb->last = build_branch(qpb);
+	}
+	if (qp->leaf_count > 0) {
+		qp->root_ref = alloc_twigs(qp, 1);
+		*ref_ptr(qp, qp->root_ref) = qpb->last;
+	}
+
+	isc_mem_cput(qp->mctx, qpb->level, qpb->max_depth,
+		     sizeof(qpb->level[0]));
+	qpb->magic = 0;
+	isc_mem_put(qp->mctx, qpb, sizeof(*qpb));
+}
+
 /***********************************************************************
  *  chains
  */
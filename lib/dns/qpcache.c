@@ -53,6 +53,7 @@
 #include <dns/rdatasetiter.h>
 #include <dns/rdataslab.h>
 #include <dns/rdatastruct.h>
+#include <dns/slabpool.h>
 #include <dns/stats.h>
 #include <dns/time.h>
 #include <dns/view.h>
@@ -108,6 +109,10 @@
 #define STALE_TTL(header, qpdb) \
 	(NXDOMAIN(header) ? 0 : qpdb->common.serve_stale_ttl)
 
+#define LRULIST(qpdb, header)                                  \
+	(NEGATIVE(header) ? &(qpdb)->nlru[HEADERNODE(header)->locknum] \
+			  : &(qpdb)->lru[HEADERNODE(header)->locknum])
+
 #define ACTIVE(header, now) \
 	(((header)->ttl > (now)) || ((header)->ttl == (now) && ZEROTTL(header)))
 
@@ -230,6 +235,34 @@ struct qpcache {
 	 */
 	dns_slabheaderlist_t *lru;
 
+	/*
+	 * The negative entries are kept on LRU lists of their own, so that
+	 * they can be purged without going through the positive ones.
+	 */
+	dns_slabheaderlist_t *nlru;
+
+	/*
+	 * The negative cache records shared by the negative entries (see
+	 * dns_rdataslab_fromncache()), and the budget for the negative
+	 * entries and the records they share.
+	 */
+	dns_slabpool_t *ncachepool;
+	size_t maxncachesize;
+
+	/*
+	 * Whether the positive rdatasets are rendered by copying their
+	 * rdata as it is stored in the slabs (see DNS_RDATASETATTR_WIRE).
+	 * It can be changed while the cache is being read.
+	 */
+	atomic_bool wirerdata;
+
+	/*
+	 * The number of bytes taken by the positive and the negative
+	 * entries.
+	 */
+	atomic_uint_fast64_t rrsetbytes;
+	atomic_uint_fast64_t ncachebytes;
+
 	/*
 	 * Start point % node_lock_count for next LRU cleanup.
 	 */
@@ -492,9 +525,9 @@ update_header(qpcache_t *qpdb, dns_slabheader_t *header, isc_stdtime_t now) {
 	/* To be checked: can we really assume this? XXXMLG */
 	INSIST(ISC_LINK_LINKED(header, link));
 
-	ISC_LIST_UNLINK(qpdb->lru[HEADERNODE(header)->locknum], header, link);
+	ISC_LIST_UNLINK(*LRULIST(qpdb, header), header, link);
 	header->last_used = now;
-	ISC_LIST_PREPEND(qpdb->lru[HEADERNODE(header)->locknum], header, link);
+	ISC_LIST_PREPEND(*LRULIST(qpdb, header), header, link);
 }
 
 /*
@@ -1041,6 +1074,8 @@ bindrdataset(qpcache_t *qpdb, qpcnode_t *node, dns_slabheader_t *header,
 
 	if (NEGATIVE(header)) {
 		rdataset->attributes |= DNS_RDATASETATTR_NEGATIVE;
+	} else if (atomic_load_relaxed(&qpdb->wirerdata)) {
+		rdataset->attributes |= DNS_RDATASETATTR_WIRE;
 	}
 	if (NXDOMAIN(header)) {
 		rdataset->attributes |= DNS_RDATASETATTR_NXDOMAIN;
@@ -2337,17 +2372,23 @@ rdataset_size(dns_slabheader_t *header) {
 	return (sizeof(*header));
 }
 
+/*
+ * Expire the headers from the tail of the LRU list 'lru' which were last
+ * used at or before 'last_used', until more than 'purgesize' bytes are
+ * purged.
+ */
 static size_t
-expire_lru_headers(qpcache_t *qpdb, unsigned int locknum,
-		   isc_rwlocktype_t *nlocktypep, isc_rwlocktype_t *tlocktypep,
+expire_lru_headers(qpcache_t *qpdb, dns_slabheaderlist_t *lru,
+		   isc_stdtime_t last_used, isc_rwlocktype_t *nlocktypep,
+		   isc_rwlocktype_t *tlocktypep,
 		   size_t purgesize DNS__DB_FLARG) {
 	dns_slabheader_t *header = NULL;
 	size_t purged = 0;
 
-	for (header = ISC_LIST_TAIL(qpdb->lru[locknum]);
-	     header != NULL && header->last_used <= qpdb->last_used &&
+	for (header = ISC_LIST_TAIL(*lru);
+	     header != NULL && header->last_used <= last_used &&
 	     purged <= purgesize;
-	     header = ISC_LIST_TAIL(qpdb->lru[locknum]))
+	     header = ISC_LIST_TAIL(*lru))
 	{
 		size_t header_size = rdataset_size(header);
 
@@ -2358,7 +2399,7 @@ expire_lru_headers(qpcache_t *qpdb, unsigned int locknum,
 		 * referenced any more (so unlinking is safe) since the
 		 * TTL will be reset to 0.
 		 */
-		ISC_LIST_UNLINK(qpdb->lru[locknum], header, link);
+		ISC_LIST_UNLINK(*lru, header, link);
 		expireheader(header, nlocktypep, tlocktypep,
 			     dns_expire_lru DNS__DB_FLARG_PASS);
 		purged += header_size;
@@ -2402,19 +2443,36 @@ again:
 		isc_rwlocktype_t nlocktype = isc_rwlocktype_none;
 		NODE_WRLOCK(&qpdb->node_locks[locknum].lock, &nlocktype);
 
+		/*
+		 * The negative entries go first: they are what fills the
+		 * cache under a flood of queries for random names.
+		 */
 		purged += expire_lru_headers(
-			qpdb, locknum, &nlocktype, tlocktypep,
-			purgesize - purged DNS__DB_FLARG_PASS);
+			qpdb, &qpdb->nlru[locknum], qpdb->last_used, &nlocktype,
+			tlocktypep, purgesize - purged DNS__DB_FLARG_PASS);
+		if (purged <= purgesize) {
+			purged += expire_lru_headers(
+				qpdb, &qpdb->lru[locknum], qpdb->last_used,
+				&nlocktype, tlocktypep,
+				purgesize - purged DNS__DB_FLARG_PASS);
+		}
 
 		/*
 		 * Work out the oldest remaining last_used values of the list
 		 * tails as we walk across the array of lru lists.
 		 */
-		dns_slabheader_t *header = ISC_LIST_TAIL(qpdb->lru[locknum]);
-		if (header != NULL &&
-		    (min_last_used == 0 || header->last_used < min_last_used))
-		{
-			min_last_used = header->last_used;
+		dns_slabheader_t *tails[] = {
+			ISC_LIST_TAIL(qpdb->nlru[locknum]),
+			ISC_LIST_TAIL(qpdb->lru[locknum]),
+		};
+		for (size_t i = 0; i < ARRAY_SIZE(tails); i++) {
+			dns_slabheader_t *header = tails[i];
+			if (header != NULL &&
+			    (min_last_used == 0 ||
+			     header->last_used < min_last_used))
+			{
+				min_last_used = header->last_used;
+			}
 		}
 		NODE_UNLOCK(&qpdb->node_locks[locknum].lock, &nlocktype);
 		locknum = (locknum + 1) % qpdb->node_lock_count;
@@ -2434,6 +2492,61 @@ again:
 	}
 }
 
+/*%
+ * The memory taken by the negative entries and by the records they
+ * share, which counts against the budget for the negative entries.
+ */
+static uint64_t
+ncache_inuse(qpcache_t *qpdb) {
+	return (atomic_load_relaxed(&qpdb->ncachebytes) +
+		dns_slabpool_inuse(qpdb->ncachepool));
+}
+
+/*%
+ * Purge the least recently used negative entries when they take more
+ * memory than their budget, which includes the newly added negative
+ * entry, and then the shared records they no longer use.
+ *
+ * Going over the whole pool of shared records takes time, so enough
+ * entries are purged to get an eighth under the budget, and the next
+ * purge is some way off.
+ *
+ * A write lock on the tree must be held.
+ */
+static void
+overncache(qpcache_t *qpdb, isc_rwlocktype_t *tlocktypep DNS__DB_FLARG) {
+	uint32_t locknum = qpdb->lru_sweep++ % qpdb->node_lock_count;
+	uint64_t inuse = ncache_inuse(qpdb);
+	uint64_t entries = atomic_load_relaxed(&qpdb->ncachebytes);
+	uint64_t lowater = qpdb->maxncachesize - (qpdb->maxncachesize >> 3);
+	size_t purgesize, purged = 0;
+
+	if (inuse <= qpdb->maxncachesize) {
+		return;
+	}
+
+	/*
+	 * Only the size of the entries themselves is known as they are
+	 * purged; assume that the shared records go with them in
+	 * proportion.
+	 */
+	purgesize = (inuse - lowater) * entries / inuse;
+
+	for (size_t i = 0; i < qpdb->node_lock_count && purged <= purgesize;
+	     i++)
+	{
+		isc_rwlocktype_t nlocktype = isc_rwlocktype_none;
+		NODE_WRLOCK(&qpdb->node_locks[locknum].lock, &nlocktype);
+		purged += expire_lru_headers(
+			qpdb, &qpdb->nlru[locknum], UINT32_MAX, &nlocktype,
+			tlocktypep, purgesize - purged DNS__DB_FLARG_PASS);
+		NODE_UNLOCK(&qpdb->node_locks[locknum].lock, &nlocktype);
+		locknum = (locknum + 1) % qpdb->node_lock_count;
+	}
+
+	dns_slabpool_purge(qpdb->ncachepool);
+}
+
 /*%
  * These functions allow the heap code to rank the priority of each
  * element.  It returns true if v1 happens "sooner" than v2.
@@ -2506,6 +2619,14 @@ free_qpdb(qpcache_t *qpdb, bool log) {
 			     qpdb->node_lock_count,
 			     sizeof(dns_slabheaderlist_t));
 	}
+	if (qpdb->nlru != NULL) {
+		for (i = 0; i < qpdb->node_lock_count; i++) {
+			INSIST(ISC_LIST_EMPTY(qpdb->nlru[i]));
+		}
+		isc_mem_cput(qpdb->common.mctx, qpdb->nlru,
+			     qpdb->node_lock_count,
+			     sizeof(dns_slabheaderlist_t));
+	}
 	/*
 	 * Clean up dead node buckets.
 	 */
@@ -2536,6 +2657,9 @@ free_qpdb(qpcache_t *qpdb, bool log) {
 	if (qpdb->gluecachestats != NULL) {
 		isc_stats_detach(&qpdb->gluecachestats);
 	}
+	if (qpdb->ncachepool != NULL) {
+		dns_slabpool_detach(&qpdb->ncachepool);
+	}
 
 	isc_mem_cput(qpdb->common.mctx, qpdb->node_locks, qpdb->node_lock_count,
 		     sizeof(db_nodelock_t));
@@ -3060,13 +3184,11 @@ find_header:
 				setttl(header, newheader->ttl);
 			}
 			if (header->last_used != now) {
-				ISC_LIST_UNLINK(
-					qpdb->lru[HEADERNODE(header)->locknum],
-					header, link);
+				ISC_LIST_UNLINK(*LRULIST(qpdb, header),
+						header, link);
 				header->last_used = now;
-				ISC_LIST_PREPEND(
-					qpdb->lru[HEADERNODE(header)->locknum],
-					header, link);
+				ISC_LIST_PREPEND(*LRULIST(qpdb, header),
+						 header, link);
 			}
 			if (header->noqname == NULL &&
 			    newheader->noqname != NULL)
@@ -3122,13 +3244,11 @@ find_header:
 				setttl(header, newheader->ttl);
 			}
 			if (header->last_used != now) {
-				ISC_LIST_UNLINK(
-					qpdb->lru[HEADERNODE(header)->locknum],
-					header, link);
+				ISC_LIST_UNLINK(*LRULIST(qpdb, header),
+						header, link);
 				header->last_used = now;
-				ISC_LIST_PREPEND(
-					qpdb->lru[HEADERNODE(header)->locknum],
-					header, link);
+				ISC_LIST_PREPEND(*LRULIST(qpdb, header),
+						 header, link);
 			}
 			if (header->noqname == NULL &&
 			    newheader->noqname != NULL)
@@ -3156,11 +3276,11 @@ find_header:
 			idx = HEADERNODE(newheader)->locknum;
 			if (ZEROTTL(newheader)) {
 				newheader->last_used = qpdb->last_used + 1;
-				ISC_LIST_APPEND(qpdb->lru[idx], newheader,
-						link);
+				ISC_LIST_APPEND(*LRULIST(qpdb, newheader),
+						newheader, link);
 			} else {
-				ISC_LIST_PREPEND(qpdb->lru[idx], newheader,
-						 link);
+				ISC_LIST_PREPEND(*LRULIST(qpdb, newheader),
+						 newheader, link);
 			}
 			INSIST(qpdb->heaps != NULL);
 			isc_heap_insert(qpdb->heaps[idx], newheader);
@@ -3186,11 +3306,11 @@ find_header:
 			newheader->heap = qpdb->heaps[idx];
 			if (ZEROTTL(newheader)) {
 				newheader->last_used = qpdb->last_used + 1;
-				ISC_LIST_APPEND(qpdb->lru[idx], newheader,
-						link);
+				ISC_LIST_APPEND(*LRULIST(qpdb, newheader),
+						newheader, link);
 			} else {
-				ISC_LIST_PREPEND(qpdb->lru[idx], newheader,
-						 link);
+				ISC_LIST_PREPEND(*LRULIST(qpdb, newheader),
+						 newheader, link);
 			}
 			if (topheader_prev != NULL) {
 				topheader_prev->next = newheader;
@@ -3224,9 +3344,11 @@ find_header:
 		isc_heap_insert(qpdb->heaps[idx], newheader);
 		newheader->heap = qpdb->heaps[idx];
 		if (ZEROTTL(newheader)) {
-			ISC_LIST_APPEND(qpdb->lru[idx], newheader, link);
+			ISC_LIST_APPEND(*LRULIST(qpdb, newheader), newheader,
+					link);
 		} else {
-			ISC_LIST_PREPEND(qpdb->lru[idx], newheader, link);
+			ISC_LIST_PREPEND(*LRULIST(qpdb, newheader), newheader,
+					 link);
 		}
 
 		if (topheader != NULL) {
@@ -3398,6 +3520,8 @@ addrdataset(dns_db_t *db, dns_dbnode_t *node, dns_dbversion_t *version,
 	isc_rwlocktype_t tlocktype = isc_rwlocktype_none;
 	isc_rwlocktype_t nlocktype = isc_rwlocktype_none;
 	bool cache_is_overmem = false;
+	bool ncache_is_over = false;
+	bool ncacheref = false;
 	dns_fixedname_t fixed;
 	dns_name_t *name = NULL;
 
@@ -3408,9 +3532,20 @@ addrdataset(dns_db_t *db, dns_dbnode_t *node, dns_dbversion_t *version,
 		now = isc_stdtime_now();
 	}
 
-	result = dns_rdataslab_fromrdataset(rdataset, qpdb->common.mctx,
-					    &region, sizeof(dns_slabheader_t),
-					    qpdb->maxrrperset);
+	if ((rdataset->attributes & DNS_RDATASETATTR_NEGATIVE) != 0) {
+		/*
+		 * Only keep one copy of the SOA and the proofs which the
+		 * negative answers from the same zone have in common.
+		 */
+		result = dns_rdataslab_fromncache(
+			rdataset, qpdb->common.mctx, qpdb->ncachepool, &region,
+			sizeof(dns_slabheader_t), qpdb->maxrrperset,
+			&ncacheref);
+	} else {
+		result = dns_rdataslab_fromrdataset(
+			rdataset, qpdb->common.mctx, &region,
+			sizeof(dns_slabheader_t), qpdb->maxrrperset);
+	}
 	if (result != ISC_R_SUCCESS) {
 		return (result);
 	}
@@ -3446,6 +3581,12 @@ addrdataset(dns_db_t *db, dns_dbnode_t *node, dns_dbversion_t *version,
 	if ((rdataset->attributes & DNS_RDATASETATTR_OPTOUT) != 0) {
 		DNS_SLABHEADER_SETATTR(newheader, DNS_SLABHEADERATTR_OPTOUT);
 	}
+	if (ncacheref) {
+		DNS_SLABHEADER_SETATTR(newheader, DNS_SLABHEADERATTR_NCACHEREF);
+	}
+	atomic_fetch_add_relaxed(NEGATIVE(newheader) ? &qpdb->ncachebytes
+						     : &qpdb->rrsetbytes,
+				 rdataset_size(newheader));
 	if ((rdataset->attributes & DNS_RDATASETATTR_NOQNAME) != 0) {
 		result = addnoqname(qpdb->common.mctx, newheader,
 				    qpdb->maxrrperset, rdataset);
@@ -3495,13 +3636,21 @@ addrdataset(dns_db_t *db, dns_dbnode_t *node, dns_dbversion_t *version,
 	if (isc_mem_isovermem(qpdb->common.mctx)) {
 		cache_is_overmem = true;
 	}
-	if (delegating || newnsec || cache_is_overmem) {
+	if (NEGATIVE(newheader) && qpdb->maxncachesize != 0 &&
+	    ncache_inuse(qpdb) > qpdb->maxncachesize)
+	{
+		ncache_is_over = true;
+	}
+	if (delegating || newnsec || cache_is_overmem || ncache_is_over) {
 		TREE_WRLOCK(&qpdb->tree_lock, &tlocktype);
 	}
 
 	if (cache_is_overmem) {
 		overmem(qpdb, newheader, &tlocktype DNS__DB_FLARG_PASS);
 	}
+	if (ncache_is_over) {
+		overncache(qpdb, &tlocktype DNS__DB_FLARG_PASS);
+	}
 
 	NODE_WRLOCK(&qpdb->node_locks[qpnode->locknum].lock, &nlocktype);
 
@@ -3702,6 +3851,12 @@ dns__qpcache_create(isc_mem_t *mctx, const dns_name_t *origin,
 	for (i = 0; i < (int)qpdb->node_lock_count; i++) {
 		ISC_LIST_INIT(qpdb->lru[i]);
 	}
+	qpdb->nlru = isc_mem_cget(mctx, qpdb->node_lock_count,
+				  sizeof(dns_slabheaderlist_t));
+	for (i = 0; i < (int)qpdb->node_lock_count; i++) {
+		ISC_LIST_INIT(qpdb->nlru[i]);
+	}
+	dns_slabpool_create(mctx, &qpdb->ncachepool);
 
 	/*
 	 * Create the heaps.
@@ -4302,8 +4457,13 @@ deletedata(dns_db_t *db ISC_ATTR_UNUSED, dns_dbnode_t *node ISC_ATTR_UNUSED,
 			  atomic_load_acquire(&header->attributes), false);
 
 	if (ISC_LINK_LINKED(header, link)) {
-		int idx = HEADERNODE(header)->locknum;
-		ISC_LIST_UNLINK(qpdb->lru[idx], header, link);
+		ISC_LIST_UNLINK(*LRULIST(qpdb, header), header, link);
+	}
+
+	if (!NONEXISTENT(header)) {
+		atomic_fetch_sub_relaxed(NEGATIVE(header) ? &qpdb->ncachebytes
+							  : &qpdb->rrsetbytes,
+					 rdataset_size(header));
 	}
 
 	if (header->noqname != NULL) {
@@ -4371,6 +4531,44 @@ setmaxtypepername(dns_db_t *db, uint32_t value) {
 	qpdb->maxtypepername = value;
 }
 
+static void
+setmaxncachesize(dns_db_t *db, size_t size) {
+	qpcache_t *qpdb = (qpcache_t *)db;
+
+	REQUIRE(VALID_QPDB(qpdb));
+
+	qpdb->maxncachesize = size;
+}
+
+static isc_result_t
+getcachemem(dns_db_t *db, uint64_t *positive, uint64_t *negative,
+	    uint64_t *proofs) {
+	qpcache_t *qpdb = (qpcache_t *)db;
+
+	REQUIRE(VALID_QPDB(qpdb));
+
+	if (positive != NULL) {
+		*positive = atomic_load_relaxed(&qpdb->rrsetbytes);
+	}
+	if (negative != NULL) {
+		*negative = atomic_load_relaxed(&qpdb->ncachebytes);
+	}
+	if (proofs != NULL) {
+		*proofs = dns_slabpool_inuse(qpdb->ncachepool);
+	}
+
+	return (ISC_R_SUCCESS);
+}
+
+static void
+setwirerdata(dns_db_t *db, bool value) {
+	qpcache_t *qpdb = (qpcache_t *)db;
+
+	REQUIRE(VALID_QPDB(qpdb));
+
+	atomic_store_relaxed(&qpdb->wirerdata, value);
+}
+
 static dns_dbmethods_t qpdb_cachemethods = {
 	.destroy = qpdb_destroy,
 	.findnode = findnode,
@@ -4397,6 +4595,9 @@ static dns_dbmethods_t qpdb_cachemethods = {
 	.deletedata = deletedata,
 	.setmaxrrperset = setmaxrrperset,
 	.setmaxtypepername = setmaxtypepername,
+	.setmaxncachesize = setmaxncachesize,
+	.getcachemem = getcachemem,
+	.setwirerdata = setwirerdata,
 };
 
 static void
@@ -53,6 +53,7 @@
 #include <dns/rdatasetiter.h>
 #include <dns/rdataslab.h>
 #include <dns/rdatastruct.h>
+#include <dns/slabpool.h>
 #include <dns/stats.h>
 #include <dns/time.h>
 #include <dns/view.h>
@@ -171,6 +172,7 @@ struct qpzonedb {
 	qpznode_t *origin;
 	qpznode_t *nsec3_origin;
 	isc_stats_t *gluecachestats;
+	dns_slabpool_t *slabpool;
 	/* Locked by lock. */
 	unsigned int active;
 	unsigned int attributes;
@@ -179,6 +181,7 @@ struct qpzonedb {
 	uint32_t next_serial;
 	uint32_t maxrrperset;	 /* Maximum RRs per RRset */
 	uint32_t maxtypepername; /* Maximum number of RR types per owner */
+	bool slabsharing;	 /* Make rdataslabs others can share */
 	qpz_version_t *current_version;
 	qpz_version_t *future_version;
 	qpz_versionlist_t open_versions;
@@ -190,6 +193,10 @@ struct qpzonedb {
 	dns_qpmulti_t *tree;  /* Main QP trie for data storage */
 	dns_qpmulti_t *nsec;  /* NSEC nodes only */
 	dns_qpmulti_t *nsec3; /* NSEC3 nodes only */
+
+	/* Bytes of rdataslabs allocated here and shared from elsewhere */
+	atomic_uint_fast64_t ownedbytes;
+	atomic_uint_fast64_t sharedbytes;
 };
 
 /*%
@@ -224,15 +231,30 @@ typedef struct dns_gluenode_t {
 	struct rcu_head rcu_head;
 } dns_gluenode_t;
 
+/*%
+ * A tree that nodes are being added to.
+ *
+ * When a zone is loaded, as long as the names arrive in DNS canonical
+ * order (as they do from a raw file or a zone transfer), the new nodes
+ * are appended to the tree with a dns_qpbuild_t; 'last' is the last
+ * node that was added. After the first name that is out of order, the
+ * builder is finished and the remaining names are inserted one by one.
+ */
+typedef struct {
+	dns_qp_t *qp;
+	dns_qpbuild_t *build;
+	qpznode_t *last;
+} qpz_loadtree_t;
+
 /*%
  * Load Context
  */
 typedef struct {
 	dns_db_t *db;
 	isc_stdtime_t now;
-	dns_qp_t *tree;
-	dns_qp_t *nsec;
-	dns_qp_t *nsec3;
+	qpz_loadtree_t tree;
+	qpz_loadtree_t nsec;
+	qpz_loadtree_t nsec3;
 } qpz_load_t;
 
 static dns_dbmethods_t qpdb_zonemethods;
@@ -415,6 +437,10 @@ free_db_rcu(struct rcu_head *rcu_head) {
 		isc_stats_detach(&qpdb->gluecachestats);
 	}
 
+	if (qpdb->slabpool != NULL) {
+		dns_slabpool_detach(&qpdb->slabpool);
+	}
+
 	isc_mem_cput(qpdb->common.mctx, qpdb->node_locks, qpdb->node_lock_count,
 		     sizeof(db_nodelock_t));
 	isc_refcount_destroy(&qpdb->common.references);
@@ -948,6 +974,7 @@ bindrdataset(qpzonedb_t *qpdb, qpznode_t *node, dns_slabheader_t *header,
 
 	rdataset->slab.db = (dns_db_t *)qpdb;
 	rdataset->slab.node = (dns_dbnode_t *)node;
+	rdataset->slab.header = header;
 	rdataset->slab.raw = dns_slabheader_raw(header);
 	rdataset->slab.iter_pos = NULL;
 	rdataset->slab.iter_count = 0;
@@ -1594,45 +1621,71 @@ delegating_type(qpzonedb_t *qpdb, qpznode_t *node, dns_typepair_t type) {
 		 (node != qpdb->origin || IS_STUB(qpdb))));
 }
 
+/*
+ * Find or create the node for 'name' in one of the trees being loaded.
+ * Returns true if the node is new.
+ */
+static bool
+loading_getnode(qpzonedb_t *qpdb, qpz_loadtree_t *loadtree,
+		const dns_name_t *name, qpznode_t **nodep) {
+	isc_result_t result;
+	qpznode_t *node = NULL;
+
+	if (loadtree->build != NULL) {
+		if (loadtree->last != NULL &&
+		    dns_name_equal(&loadtree->last->name, name))
+		{
+			*nodep = loadtree->last;
+			return (false);
+		}
+
+		node = new_qpznode(qpdb, name);
+		result = dns_qpbuild_add(loadtree->build, node, 0);
+		if (result == ISC_R_SUCCESS) {
+			loadtree->last = node;
+			qpznode_unref(node);
+			*nodep = node;
+			return (true);
+		}
+
+		/* out of order, fall back to dns_qp_insert() */
+		qpznode_detach(&node);
+		dns_qpbuild_finish(&loadtree->build);
+		loadtree->last = NULL;
+	}
+
+	result = dns_qp_getname(loadtree->qp, name, (void **)&node, NULL);
+	if (result == ISC_R_SUCCESS) {
+		*nodep = node;
+		return (false);
+	}
+
+	INSIST(node == NULL);
+	node = new_qpznode(qpdb, name);
+	result = dns_qp_insert(loadtree->qp, node, 0);
+	INSIST(result == ISC_R_SUCCESS);
+	qpznode_unref(node);
+	*nodep = node;
+	return (true);
+}
+
 static void
 loading_addnode(qpz_load_t *loadctx, const dns_name_t *name,
 		dns_rdatatype_t type, dns_rdatatype_t covers,
 		qpznode_t **nodep) {
 	qpzonedb_t *qpdb = (qpzonedb_t *)loadctx->db;
-	isc_result_t result;
 	qpznode_t *node = NULL, *nsecnode = NULL;
 
 	if (type == dns_rdatatype_nsec3 || covers == dns_rdatatype_nsec3) {
-		result = dns_qp_getname(loadctx->nsec3, name, (void **)&node,
-					NULL);
-		if (result == ISC_R_SUCCESS) {
-			*nodep = node;
-		} else {
-			node = new_qpznode(qpdb, name);
-			result = dns_qp_insert(loadctx->nsec3, node, 0);
-			INSIST(result == ISC_R_SUCCESS);
+		if (loading_getnode(qpdb, &loadctx->nsec3, name, &node)) {
 			node->nsec = DNS_DB_NSEC_NSEC3;
-			*nodep = node;
-			qpznode_detach(&node);
 		}
+		*nodep = node;
 		return;
 	}
 
-	result = dns_qp_getname(loadctx->tree, name, (void **)&node, NULL);
-	if (result == ISC_R_SUCCESS) {
-		if (type == dns_rdatatype_nsec &&
-		    node->nsec == DNS_DB_NSEC_HAS_NSEC)
-		{
-			goto done;
-		}
-	} else {
-		INSIST(node == NULL);
-		node = new_qpznode(qpdb, name);
-		result = dns_qp_insert(loadctx->tree, node, 0);
-		INSIST(result == ISC_R_SUCCESS);
-		qpznode_unref(node);
-	}
-	if (type != dns_rdatatype_nsec) {
+	(void)loading_getnode(qpdb, &loadctx->tree, name, &node);
+	if (type != dns_rdatatype_nsec || node->nsec == DNS_DB_NSEC_HAS_NSEC) {
 		goto done;
 	}
 
@@ -1641,13 +1694,10 @@ loading_addnode(qpz_load_t *loadctx, const dns_name_t *name,
 	 * too. This tree speeds searches for closest NSECs that would
 	 * otherwise need to examine many irrelevant nodes in large TLDs.
 	 */
-	nsecnode = new_qpznode(qpdb, name);
-	result = dns_qp_insert(loadctx->nsec, nsecnode, 0);
-	node->nsec = DNS_DB_NSEC_HAS_NSEC;
-	if (result == ISC_R_SUCCESS) {
+	if (loading_getnode(qpdb, &loadctx->nsec, name, &nsecnode)) {
 		nsecnode->nsec = DNS_DB_NSEC_NSEC;
 	}
-	qpznode_detach(&nsecnode);
+	node->nsec = DNS_DB_NSEC_HAS_NSEC;
 
 done:
 	*nodep = node;
@@ -1738,10 +1788,92 @@ add_changed(dns_slabheader_t *header, qpz_version_t *version DNS__DB_FLARG) {
 	return (changed);
 }
 
+static void
+slabaccount(qpzonedb_t *qpdb, dns_slabheader_t *header) {
+	if (header->shared != NULL && !qpdb->slabsharing) {
+		atomic_fetch_add_relaxed(&qpdb->sharedbytes,
+					 dns_slabheader_size(header));
+	} else {
+		atomic_fetch_add_relaxed(&qpdb->ownedbytes,
+					 dns_slabheader_size(header));
+	}
+}
+
+/*
+ * Make a new slab header holding the data of 'rdataset'.  If 'rdataset'
+ * is bound to a shared rdataslab (e.g. it comes from the raw database of
+ * an inline-signed zone), the new header refers to the same rdataslab
+ * instead of copying it.  Otherwise, if the database has a slab pool,
+ * the header refers to the interned copy of the data in the pool; the
+ * DNSSEC records are unique to each zone, so they are not interned.
+ */
+static isc_result_t
+newslabheader(qpzonedb_t *qpdb, qpznode_t *node, dns_rdataset_t *rdataset,
+	      dns_slabheader_t **headerp) {
+	isc_result_t result;
+	isc_region_t region;
+	dns_slabheader_t *header = NULL;
+	dns_slabshared_t *shared = NULL;
+
+	if (!qpdb->slabsharing &&
+	    rdataset->methods == &dns_rdataslab_rdatasetmethods &&
+	    rdataset->slab.header != NULL &&
+	    rdataset->slab.header->shared != NULL)
+	{
+		if (qpdb->maxrrperset > 0 &&
+		    dns_rdataset_count(rdataset) > qpdb->maxrrperset)
+		{
+			return (DNS_R_TOOMANYRECORDS);
+		}
+		shared = rdataset->slab.header->shared;
+		header = dns_slabheader_newshared((dns_db_t *)qpdb,
+						  (dns_dbnode_t *)node, shared);
+	} else if (qpdb->slabpool != NULL && !qpdb->slabsharing &&
+		   dns_rdataset_count(rdataset) > 0 &&
+		   !dns_rdatatype_isdnssec(rdataset->type))
+	{
+		result = dns_slabpool_intern(qpdb->slabpool, rdataset,
+					     qpdb->maxrrperset, &shared);
+		if (result != ISC_R_SUCCESS) {
+			return (result);
+		}
+		header = dns_slabheader_newshared((dns_db_t *)qpdb,
+						  (dns_dbnode_t *)node, shared);
+		dns_slabshared_detach(&shared);
+	} else if (qpdb->slabsharing && dns_rdataset_count(rdataset) > 0) {
+		result = dns_rdataslab_fromrdatasetshared(
+			rdataset, qpdb->common.mctx, qpdb->maxrrperset,
+			&shared);
+		if (result != ISC_R_SUCCESS) {
+			return (result);
+		}
+		header = dns_slabheader_newshared((dns_db_t *)qpdb,
+						  (dns_dbnode_t *)node, shared);
+		dns_slabshared_detach(&shared);
+	} else {
+		result = dns_rdataslab_fromrdataset(
+			rdataset, qpdb->common.mctx, &region,
+			sizeof(dns_slabheader_t), qpdb->maxrrperset);
+		if (result != ISC_R_SUCCESS) {
+			return (result);
+		}
+		header = (dns_slabheader_t *)region.base;
+		*header = (dns_slabheader_t){
+			.link = ISC_LINK_INITIALIZER,
+		};
+		dns_slabheader_reset(header, (dns_db_t *)qpdb,
+				     (dns_dbnode_t *)node);
+	}
+
+	slabaccount(qpdb, header);
+
+	*headerp = header;
+	return (ISC_R_SUCCESS);
+}
+
 static uint64_t
 recordsize(dns_slabheader_t *header, unsigned int namelen) {
-	return (dns_rdataslab_rdatasize((unsigned char *)header,
-					sizeof(*header)) +
+	return (dns_rdataslab_rdatasize(dns_slabheader_raw(header), 0) +
 		sizeof(dns_ttl_t) + sizeof(dns_rdatatype_t) +
 		sizeof(dns_rdataclass_t) + namelen);
 }
@@ -1749,19 +1881,20 @@ recordsize(dns_slabheader_t *header, unsigned int namelen) {
 static void
 maybe_update_recordsandsize(bool add, qpz_version_t *version,
 			    dns_slabheader_t *header, unsigned int namelen) {
-	unsigned char *hdr = (unsigned char *)header;
-	size_t hdrsize = sizeof(*header);
+	unsigned char *raw = NULL;
 
 	if (NONEXISTENT(header)) {
 		return;
 	}
 
+	raw = dns_slabheader_raw(header);
+
 	RWLOCK(&version->rwlock, isc_rwlocktype_write);
 	if (add) {
-		version->records += dns_rdataslab_count(hdr, hdrsize);
+		version->records += dns_rdataslab_count(raw, 0);
 		version->xfrsize += recordsize(header, namelen);
 	} else {
-		version->records -= dns_rdataslab_count(hdr, hdrsize);
+		version->records -= dns_rdataslab_count(raw, 0);
 		version->xfrsize -= recordsize(header, namelen);
 	}
 	RWUNLOCK(&version->rwlock, isc_rwlocktype_write);
@@ -1776,7 +1909,7 @@ add(qpzonedb_t *qpdb, qpznode_t *node, const dns_name_t *nodename,
 	dns_slabheader_t *topheader = NULL, *topheader_prev = NULL;
 	dns_slabheader_t *prioheader = NULL;
 	dns_slabheader_t *header = NULL;
-	unsigned char *merged = NULL;
+	dns_slabheader_t *merged = NULL;
 	isc_result_t result;
 	bool merge = false;
 	uint32_t ntypes;
@@ -1841,11 +1974,9 @@ add(qpzonedb_t *qpdb, qpznode_t *node, const dns_name_t *nodename,
 				flags |= DNS_RDATASLAB_FORCE;
 			}
 			if (result == ISC_R_SUCCESS) {
-				result = dns_rdataslab_merge(
-					(unsigned char *)header,
-					(unsigned char *)newheader,
-					(unsigned int)(sizeof(*newheader)),
-					qpdb->common.mctx, qpdb->common.rdclass,
+				result = dns_slabheader_merge(
+					header, newheader, qpdb->common.mctx,
+					qpdb->common.rdclass,
 					(dns_rdatatype_t)header->type, flags,
 					qpdb->maxrrperset, &merged);
 			}
@@ -1859,10 +1990,11 @@ add(qpzonedb_t *qpdb, qpznode_t *node, const dns_name_t *nodename,
 				 * clean_zone_node() runs.
 				 */
 				dns_slabheader_destroy(&newheader);
-				newheader = (dns_slabheader_t *)merged;
+				newheader = merged;
 				dns_slabheader_reset(newheader,
 						     (dns_db_t *)qpdb,
 						     (dns_dbnode_t *)node);
+				slabaccount(qpdb, newheader);
 				dns_slabheader_copycase(newheader, header);
 				if (loading && RESIGN(newheader) &&
 				    RESIGN(header) &&
@@ -2010,8 +2142,8 @@ add(qpzonedb_t *qpdb, qpznode_t *node, const dns_name_t *nodename,
 }
 
 static void
-wildcardmagic(qpzonedb_t *qpdb, dns_qp_t *qp, const dns_name_t *name) {
-	isc_result_t result;
+wildcardmagic(qpzonedb_t *qpdb, qpz_loadtree_t *loadtree,
+	      const dns_name_t *name) {
 	dns_name_t foundname;
 	dns_offsets_t offsets;
 	unsigned int n;
@@ -2024,20 +2156,14 @@ wildcardmagic(qpzonedb_t *qpdb, dns_qp_t *qp, const dns_name_t *name) {
 	dns_name_getlabelsequence(name, 1, n, &foundname);
 
 	/* insert an empty node, if needed, to hold the wildcard bit */
-	result = dns_qp_getname(qp, &foundname, (void **)&node, NULL);
-	if (result != ISC_R_SUCCESS) {
-		INSIST(node == NULL);
-		node = new_qpznode(qpdb, &foundname);
-		result = dns_qp_insert(qp, node, 0);
-		INSIST(result == ISC_R_SUCCESS);
-		qpznode_unref(node);
-	}
+	(void)loading_getnode(qpdb, loadtree, &foundname, &node);
 
 	node->wild = true;
 }
 
 static void
-addwildcards(qpzonedb_t *qpdb, dns_qp_t *qp, const dns_name_t *name) {
+addwildcards(qpzonedb_t *qpdb, qpz_loadtree_t *loadtree,
+	     const dns_name_t *name) {
 	dns_name_t foundname;
 	dns_offsets_t offsets;
 	unsigned int n, l, i;
@@ -2049,7 +2175,7 @@ addwildcards(qpzonedb_t *qpdb, dns_qp_t *qp, const dns_name_t *name) {
 	while (i < n) {
 		dns_name_getlabelsequence(name, n - i, i, &foundname);
 		if (dns_name_iswildcard(&foundname)) {
-			wildcardmagic(qpdb, qp, &foundname);
+			wildcardmagic(qpdb, loadtree, &foundname);
 		}
 
 		i++;
@@ -2063,7 +2189,6 @@ loading_addrdataset(void *arg, const dns_name_t *name,
 	qpzonedb_t *qpdb = (qpzonedb_t *)loadctx->db;
 	qpznode_t *node = NULL;
 	isc_result_t result = ISC_R_SUCCESS;
-	isc_region_t region;
 	dns_slabheader_t *newheader = NULL;
 	isc_rwlocktype_t nlocktype = isc_rwlocktype_none;
 
@@ -2081,7 +2206,7 @@ loading_addrdataset(void *arg, const dns_name_t *name,
 	if (rdataset->type != dns_rdatatype_nsec3 &&
 	    rdataset->covers != dns_rdatatype_nsec3)
 	{
-		addwildcards(qpdb, loadctx->tree, name);
+		addwildcards(qpdb, &loadctx->tree, name);
 	}
 
 	if (dns_name_iswildcard(name)) {
@@ -2099,28 +2224,20 @@ loading_addrdataset(void *arg, const dns_name_t *name,
 			return (DNS_R_INVALIDNSEC3);
 		}
 
-		wildcardmagic(qpdb, loadctx->tree, name);
+		wildcardmagic(qpdb, &loadctx->tree, name);
 	}
 
 	loading_addnode(loadctx, name, rdataset->type, rdataset->covers, &node);
-	result = dns_rdataslab_fromrdataset(rdataset, qpdb->common.mctx,
-					    &region, sizeof(dns_slabheader_t),
-					    qpdb->maxrrperset);
+	result = newslabheader(qpdb, node, rdataset, &newheader);
 	if (result != ISC_R_SUCCESS) {
 		return (result);
 	}
 
-	newheader = (dns_slabheader_t *)region.base;
-	*newheader = (dns_slabheader_t){
-		.type = DNS_TYPEPAIR_VALUE(rdataset->type, rdataset->covers),
-		.ttl = rdataset->ttl + loadctx->now,
-		.trust = rdataset->trust,
-		.node = node,
-		.serial = 1,
-		.count = 1,
-	};
-
-	dns_slabheader_reset(newheader, (dns_db_t *)qpdb, node);
+	newheader->type = DNS_TYPEPAIR_VALUE(rdataset->type, rdataset->covers);
+	newheader->ttl = rdataset->ttl + loadctx->now;
+	newheader->trust = rdataset->trust;
+	newheader->serial = 1;
+	atomic_init(&newheader->count, 1);
 	dns_slabheader_setownercase(newheader, name);
 
 	if ((rdataset->attributes & DNS_RDATASETATTR_RESIGN) != 0) {
@@ -2147,14 +2264,44 @@ loading_addrdataset(void *arg, const dns_name_t *name,
 	return (result);
 }
 
+static void
+loading_begin(dns_qpmulti_t *multi, qpz_loadtree_t *loadtree,
+	      qpznode_t *origin) {
+	size_t leaves;
+
+	dns_qpmulti_write(multi, &loadtree->qp);
+
+	/*
+	 * A new zone database only has the apex node (if any), which is
+	 * the first name in canonical order.
+	 */
+	leaves = dns_qp_memusage(loadtree->qp).leaves;
+	if (leaves <= 1) {
+		dns_qpbuild_begin(loadtree->qp, &loadtree->build);
+		loadtree->last = (leaves == 1) ? origin : NULL;
+	}
+}
+
+static void
+loading_end(dns_qpmulti_t *multi, qpz_loadtree_t *loadtree) {
+	if (loadtree->build != NULL) {
+		dns_qpbuild_finish(&loadtree->build);
+		loadtree->last = NULL;
+	}
+	if (loadtree->qp != NULL) {
+		dns_qp_compact(loadtree->qp, DNS_QPGC_MAYBE);
+		dns_qpmulti_commit(multi, &loadtree->qp);
+	}
+}
+
 static void
 loading_setup(void *arg) {
 	qpz_load_t *loadctx = arg;
 	qpzonedb_t *qpdb = (qpzonedb_t *)loadctx->db;
 
-	dns_qpmulti_write(qpdb->tree, &loadctx->tree);
-	dns_qpmulti_write(qpdb->nsec, &loadctx->nsec);
-	dns_qpmulti_write(qpdb->nsec3, &loadctx->nsec3);
+	loading_begin(qpdb->tree, &loadctx->tree, qpdb->origin);
+	loading_begin(qpdb->nsec, &loadctx->nsec, NULL);
+	loading_begin(qpdb->nsec3, &loadctx->nsec3, qpdb->nsec3_origin);
 }
 
 static void
@@ -2162,18 +2309,9 @@ loading_commit(void *arg) {
 	qpz_load_t *loadctx = arg;
 	qpzonedb_t *qpdb = (qpzonedb_t *)loadctx->db;
 
-	if (loadctx->tree != NULL) {
-		dns_qp_compact(loadctx->tree, DNS_QPGC_MAYBE);
-		dns_qpmulti_commit(qpdb->tree, &loadctx->tree);
-	}
-	if (loadctx->nsec != NULL) {
-		dns_qp_compact(loadctx->nsec, DNS_QPGC_MAYBE);
-		dns_qpmulti_commit(qpdb->nsec, &loadctx->nsec);
-	}
-	if (loadctx->nsec3 != NULL) {
-		dns_qp_compact(loadctx->nsec3, DNS_QPGC_MAYBE);
-		dns_qpmulti_commit(qpdb->nsec3, &loadctx->nsec3);
-	}
+	loading_end(qpdb->tree, &loadctx->tree);
+	loading_end(qpdb->nsec, &loadctx->nsec);
+	loading_end(qpdb->nsec3, &loadctx->nsec3);
 }
 
 static isc_result_t
@@ -2467,9 +2605,10 @@ findnodeintree(qpzonedb_t *qpdb, const dns_name_t *name, bool create,
 			if (nsec3) {
 				node->nsec = DNS_DB_NSEC_NSEC3;
 			} else {
-				addwildcards(qpdb, qp, name);
+				qpz_loadtree_t tree = { .qp = qp };
+				addwildcards(qpdb, &tree, name);
 				if (dns_name_iswildcard(name)) {
-					wildcardmagic(qpdb, qp, name);
+					wildcardmagic(qpdb, &tree, name);
 				}
 			}
 		}
@@ -2524,7 +2663,7 @@ matchparams(dns_slabheader_t *header, qpz_search_t *search) {
 
 	REQUIRE(header->type == dns_rdatatype_nsec3);
 
-	raw = (unsigned char *)header + sizeof(*header);
+	raw = dns_slabheader_raw(header);
 	count = raw[0] * 256 + raw[1]; /* count */
 	raw += DNS_RDATASET_COUNT + DNS_RDATASET_LENGTH;
 
@@ -3972,6 +4111,14 @@ deletedata(dns_db_t *db ISC_ATTR_UNUSED, dns_dbnode_t *node ISC_ATTR_UNUSED,
 	qpzonedb_t *qpdb = (qpzonedb_t *)db;
 	dns_slabheader_t *header = data;
 
+	if (header->shared != NULL && !qpdb->slabsharing) {
+		atomic_fetch_sub_relaxed(&qpdb->sharedbytes,
+					 dns_slabheader_size(header));
+	} else {
+		atomic_fetch_sub_relaxed(&qpdb->ownedbytes,
+					 dns_slabheader_size(header));
+	}
+
 	if (header->heap != NULL && header->heap_index != 0) {
 		RWLOCK(&qpdb->lock, isc_rwlocktype_write);
 		isc_heap_delete(header->heap, header->heap_index);
@@ -4577,7 +4724,6 @@ addrdataset(dns_db_t *db, dns_dbnode_t *dbnode, dns_dbversion_t *dbversion,
 	qpzonedb_t *qpdb = (qpzonedb_t *)db;
 	qpznode_t *node = (qpznode_t *)dbnode;
 	qpz_version_t *version = dbversion;
-	isc_region_t region;
 	dns_slabheader_t *newheader = NULL;
 	isc_rwlocktype_t nlocktype = isc_rwlocktype_none;
 	dns_fixedname_t fn;
@@ -4601,9 +4747,7 @@ addrdataset(dns_db_t *db, dns_dbnode_t *dbnode, dns_dbversion_t *dbversion,
 		  rdataset->type != dns_rdatatype_nsec3 &&
 		  rdataset->covers != dns_rdatatype_nsec3)));
 
-	result = dns_rdataslab_fromrdataset(rdataset, qpdb->common.mctx,
-					    &region, sizeof(dns_slabheader_t),
-					    qpdb->maxrrperset);
+	result = newslabheader(qpdb, node, rdataset, &newheader);
 	if (result != ISC_R_SUCCESS) {
 		return (result);
 	}
@@ -4611,14 +4755,8 @@ addrdataset(dns_db_t *db, dns_dbnode_t *dbnode, dns_dbversion_t *dbversion,
 	dns_name_copy(&node->name, name);
 	dns_rdataset_getownercase(rdataset, name);
 
-	newheader = (dns_slabheader_t *)region.base;
-	*newheader = (dns_slabheader_t){
-		.type = DNS_TYPEPAIR_VALUE(rdataset->type, rdataset->covers),
-		.trust = rdataset->trust,
-		.node = node,
-	};
-
-	dns_slabheader_reset(newheader, db, node);
+	newheader->type = DNS_TYPEPAIR_VALUE(rdataset->type, rdataset->covers);
+	newheader->trust = rdataset->trust;
 	newheader->ttl = rdataset->ttl;
 	if (rdataset->ttl == 0U) {
 		DNS_SLABHEADER_SETATTR(newheader, DNS_SLABHEADERATTR_ZEROTTL);
@@ -4704,7 +4842,7 @@ subtractrdataset(dns_db_t *db, dns_dbnode_t *dbnode, dns_dbversion_t *dbversion,
 	dns_name_t *nodename = dns_fixedname_initname(&fname);
 	dns_slabheader_t *topheader = NULL, *topheader_prev = NULL;
 	dns_slabheader_t *header = NULL, *newheader = NULL;
-	unsigned char *subresult = NULL;
+	dns_slabheader_t *subresult = NULL;
 	isc_region_t region;
 	isc_result_t result;
 	qpz_changed_t *changed = NULL;
@@ -4730,6 +4868,7 @@ subtractrdataset(dns_db_t *db, dns_dbnode_t *dbnode, dns_dbversion_t *dbversion,
 
 	newheader = (dns_slabheader_t *)region.base;
 	dns_slabheader_reset(newheader, db, node);
+	slabaccount(qpdb, newheader);
 	newheader->ttl = rdataset->ttl;
 	newheader->type = DNS_TYPEPAIR_VALUE(rdataset->type, rdataset->covers);
 	atomic_init(&newheader->attributes, 0);
@@ -4784,18 +4923,17 @@ subtractrdataset(dns_db_t *db, dns_dbnode_t *dbnode, dns_dbversion_t *dbversion,
 			}
 		}
 		if (result == ISC_R_SUCCESS) {
-			result = dns_rdataslab_subtract(
-				(unsigned char *)header,
-				(unsigned char *)newheader,
-				(unsigned int)(sizeof(*newheader)),
-				qpdb->common.mctx, qpdb->common.rdclass,
+			result = dns_slabheader_subtract(
+				header, newheader, qpdb->common.mctx,
+				qpdb->common.rdclass,
 				(dns_rdatatype_t)header->type, flags,
 				&subresult);
 		}
 		if (result == ISC_R_SUCCESS) {
 			dns_slabheader_destroy(&newheader);
-			newheader = (dns_slabheader_t *)subresult;
+			newheader = subresult;
 			dns_slabheader_reset(newheader, db, node);
+			slabaccount(qpdb, newheader);
 			dns_slabheader_copycase(newheader, header);
 			if (RESIGN(header)) {
 				DNS_SLABHEADER_SETATTR(
@@ -5351,6 +5489,41 @@ setmaxtypepername(dns_db_t *db, uint32_t value) {
 	qpdb->maxtypepername = value;
 }
 
+static void
+setslabsharing(dns_db_t *db, bool value) {
+	qpzonedb_t *qpdb = (qpzonedb_t *)db;
+
+	REQUIRE(VALID_QPZONE(qpdb));
+
+	qpdb->slabsharing = value;
+}
+
+static void
+setslabpool(dns_db_t *db, dns_slabpool_t *pool) {
+	qpzonedb_t *qpdb = (qpzonedb_t *)db;
+
+	REQUIRE(VALID_QPZONE(qpdb));
+
+	if (qpdb->slabpool != NULL) {
+		dns_slabpool_detach(&qpdb->slabpool);
+	}
+	if (pool != NULL) {
+		dns_slabpool_attach(pool, &qpdb->slabpool);
+	}
+}
+
+static isc_result_t
+getslabstats(dns_db_t *db, uint64_t *owned, uint64_t *shared) {
+	qpzonedb_t *qpdb = (qpzonedb_t *)db;
+
+	REQUIRE(VALID_QPZONE(qpdb));
+
+	SET_IF_NOT_NULL(owned, atomic_load_relaxed(&qpdb->ownedbytes));
+	SET_IF_NOT_NULL(shared, atomic_load_relaxed(&qpdb->sharedbytes));
+
+	return (ISC_R_SUCCESS);
+}
+
 static dns_dbmethods_t qpdb_zonemethods = {
 	.destroy = qpdb_destroy,
 	.beginload = beginload,
@@ -5386,6 +5559,9 @@ static dns_dbmethods_t qpdb_zonemethods = {
 	.nodefullname = nodefullname,
 	.setmaxrrperset = setmaxrrperset,
 	.setmaxtypepername = setmaxtypepername,
+	.setslabsharing = setslabsharing,
+	.setslabpool = setslabpool,
+	.getslabstats = getslabstats,
 };
 
 static void
@@ -248,7 +248,7 @@ towiresorted(dns_rdataset_t *rdataset, const dns_name_t *owner_name,
 	unsigned int headlen;
 	bool question = false;
 	bool shuffle = false, sort = false;
-	bool want_random, want_cyclic;
+	bool want_random, want_cyclic, wire;
 	dns_rdata_t in_fixed[MAX_SHUFFLE];
 	dns_rdata_t *in = in_fixed;
 	struct towire_sort out_fixed[MAX_SHUFFLE];
@@ -269,6 +269,7 @@ towiresorted(dns_rdataset_t *rdataset, const dns_name_t *owner_name,
 
 	want_random = WANT_RANDOM(rdataset);
 	want_cyclic = WANT_CYCLIC(rdataset);
+	wire = (rdataset->attributes & DNS_RDATASETATTR_WIRE) != 0;
 
 	if ((rdataset->attributes & DNS_RDATASETATTR_QUESTION) != 0) {
 		question = true;
@@ -421,9 +422,24 @@ towiresorted(dns_rdataset_t *rdataset, const dns_name_t *owner_name,
 				dns_rdata_reset(&rdata);
 				dns_rdataset_current(rdataset, &rdata);
 			}
-			result = dns_rdata_towire(&rdata, cctx, target);
-			if (result != ISC_R_SUCCESS) {
-				goto rollback;
+			if (wire) {
+				/*
+				 * The rdata is already in uncompressed wire
+				 * format, so it can simply be copied.
+				 */
+				if (isc_buffer_availablelength(target) <
+				    rdata.length)
+				{
+					result = ISC_R_NOSPACE;
+					goto rollback;
+				}
+				isc_buffer_putmem(target, rdata.data,
+						  rdata.length);
+			} else {
+				result = dns_rdata_towire(&rdata, cctx, target);
+				if (result != ISC_R_SUCCESS) {
+					goto rollback;
+				}
 			}
 			INSIST((target->used >= rdlen.used + 2) &&
 			       (target->used - rdlen.used - 2 < 65536));
@@ -26,8 +26,10 @@
 
 #include <dns/db.h>
 #include <dns/rdata.h>
+#include <dns/rdatalist.h>
 #include <dns/rdataset.h>
 #include <dns/rdataslab.h>
+#include <dns/slabpool.h>
 #include <dns/stats.h>
 
 #define CASESET(header)                                \
@@ -39,6 +41,22 @@
 #define NONEXISTENT(header)                            \
 	((atomic_load_acquire(&(header)->attributes) & \
 	  DNS_SLABHEADERATTR_NONEXISTENT) != 0)
+#define NCACHEREF(header)                              \
+	((atomic_load_acquire(&(header)->attributes) & \
+	  DNS_SLABHEADERATTR_NCACHEREF) != 0)
+
+/*
+ * The length of a reference to the shared records of a negative cache
+ * record: the DNS_RDATASLAB_NCACHEREF byte and the pointer to the
+ * shared rdataslab.
+ */
+#define NCACHEREF_LENGTH (1 + sizeof(dns_slabshared_t *))
+
+/*
+ * The longest owner name, type and trust of a negative cache record,
+ * which are kept in front of the reference.
+ */
+#define NCACHEREF_MAXPREFIX (DNS_NAME_MAXWIRE + 3)
 
 /*
  * The rdataslab structure allows iteration to occur in both load order
@@ -392,6 +410,228 @@ free_rdatas:
 	return (result);
 }
 
+static bool
+ncache_isref(const unsigned char *data, unsigned int length) {
+	return (length == NCACHEREF_LENGTH &&
+		data[0] == DNS_RDATASLAB_NCACHEREF);
+}
+
+/*
+ * The length of the owner name, type and trust at the start of the
+ * negative cache record 'data'.
+ */
+static unsigned int
+ncache_prefix(const unsigned char *data, unsigned int length) {
+	unsigned int i = 0;
+
+	while (i < length && data[i] != 0) {
+		i += data[i] + 1;
+	}
+	INSIST(i + 4 <= length);
+
+	return (i + 4);
+}
+
+static dns_slabshared_t *
+ncache_getref(const unsigned char *data) {
+	dns_slabshared_t *shared = NULL;
+
+	memmove(&shared, data + 1, sizeof(shared));
+	return (shared);
+}
+
+/*
+ * Take another reference to, or let go of, each of the shared records
+ * the negative cache rdataslab 'slab' refers to.  Returns true if there
+ * are any.
+ */
+static bool
+ncache_refs(unsigned char *slab, bool attach) {
+	unsigned char *current = slab;
+	uint16_t count = get_uint16(current);
+	bool found = false;
+
+#if DNS_RDATASET_FIXED
+	current += (4 * count);
+#endif /* if DNS_RDATASET_FIXED */
+
+	while (count-- > 0) {
+		uint16_t length = get_uint16(current);
+		unsigned int prefix;
+#if DNS_RDATASET_FIXED
+		current += 2;
+#endif /* if DNS_RDATASET_FIXED */
+		prefix = ncache_prefix(current, length);
+		if (ncache_isref(current + prefix, length - prefix)) {
+			dns_slabshared_t *shared =
+				ncache_getref(current + prefix);
+			if (attach) {
+				dns_slabshared_ref(shared);
+			} else {
+				dns_slabshared_unref(shared);
+			}
+			found = true;
+		}
+		current += length;
+	}
+
+	return (found);
+}
+
+/*
+ * Intern the records of the negative cache record 'rdata' of
+ * 'rdataset', which start at 'prefix', in 'pool'.
+ */
+static isc_result_t
+ncache_intern(dns_rdataset_t *rdataset, dns_rdata_t *rdata,
+	      unsigned int prefix, dns_slabpool_t *pool,
+	      dns_slabshared_t **sharedp) {
+	isc_result_t result;
+	dns_rdatalist_t rdatalist;
+	dns_rdataset_t record;
+	dns_rdata_t copy = DNS_RDATA_INIT;
+
+	dns_rdata_clone(rdata, &copy);
+	copy.data += prefix;
+	copy.length -= prefix;
+
+	dns_rdatalist_init(&rdatalist);
+	rdatalist.rdclass = rdataset->rdclass;
+	rdatalist.type = rdataset->type;
+	rdatalist.covers = rdataset->covers;
+	ISC_LIST_APPEND(rdatalist.rdata, &copy, link);
+
+	dns_rdataset_init(&record);
+	dns_rdatalist_tordataset(&rdatalist, &record);
+	result = dns_slabpool_intern(pool, &record, 0, sharedp);
+	dns_rdataset_disassociate(&record);
+
+	return (result);
+}
+
+isc_result_t
+dns_rdataslab_fromncache(dns_rdataset_t *rdataset, isc_mem_t *mctx,
+			 dns_slabpool_t *pool, isc_region_t *region,
+			 unsigned int reservelen, uint32_t limit,
+			 bool *sharedp) {
+	isc_result_t result;
+	dns_rdatalist_t rdatalist;
+	dns_rdataset_t refs;
+	dns_rdata_t *rdatas = NULL;
+	dns_slabshared_t **shared = NULL;
+	unsigned char(*bufs)[NCACHEREF_MAXPREFIX + NCACHEREF_LENGTH] = NULL;
+	unsigned int count, i = 0;
+
+	REQUIRE(DNS_RDATASET_VALID(rdataset));
+	REQUIRE(rdataset->type == 0);
+	REQUIRE(pool != NULL);
+	REQUIRE(sharedp != NULL);
+
+	*sharedp = false;
+
+	count = dns_rdataset_count(rdataset);
+	if (count == 0 || (limit > 0 && count > limit) || count > 0xffff) {
+		/* Nothing to share, or nothing that would fit */
+		return (dns_rdataslab_fromrdataset(rdataset, mctx, region,
+						   reservelen, limit));
+	}
+
+	rdatas = isc_mem_cget(mctx, count, sizeof(rdatas[0]));
+	shared = isc_mem_cget(mctx, count, sizeof(shared[0]));
+	bufs = isc_mem_cget(mctx, count, sizeof(bufs[0]));
+
+	dns_rdatalist_init(&rdatalist);
+	rdatalist.rdclass = rdataset->rdclass;
+	rdatalist.type = rdataset->type;
+	rdatalist.covers = rdataset->covers;
+	rdatalist.ttl = rdataset->ttl;
+
+	for (result = dns_rdataset_first(rdataset);
+	     result == ISC_R_SUCCESS && i < count;
+	     result = dns_rdataset_next(rdataset), i++)
+	{
+		dns_rdata_t *rdata = &rdatas[i];
+		unsigned int prefix;
+
+		dns_rdata_init(rdata);
+		dns_rdataset_current(rdataset, rdata);
+
+		/*
+		 * Replace the records which are longer than a reference
+		 * with a reference to the copy in the pool.  The owner
+		 * name, type and trust stay in the record: the trust may
+		 * be changed later, and it is the only part which can.
+		 */
+		prefix = ncache_prefix(rdata->data, rdata->length);
+		if (rdata->length - prefix > NCACHEREF_LENGTH) {
+			unsigned char *buf = bufs[i];
+
+			result = ncache_intern(rdataset, rdata, prefix, pool,
+					       &shared[i]);
+			if (result != ISC_R_SUCCESS) {
+				goto cleanup;
+			}
+			memmove(buf, rdata->data, prefix);
+			buf[prefix] = DNS_RDATASLAB_NCACHEREF;
+			memmove(&buf[prefix + 1], &shared[i],
+				sizeof(shared[i]));
+			rdata->data = buf;
+			rdata->length = prefix + NCACHEREF_LENGTH;
+		}
+		ISC_LIST_APPEND(rdatalist.rdata, rdata, link);
+	}
+	if (result != ISC_R_NOMORE || i != count) {
+		result = ISC_R_FAILURE;
+		goto cleanup;
+	}
+
+	dns_rdataset_init(&refs);
+	dns_rdatalist_tordataset(&rdatalist, &refs);
+	result = dns_rdataslab_fromrdataset(&refs, mctx, region, reservelen,
+					    limit);
+	dns_rdataset_disassociate(&refs);
+
+	/*
+	 * The slab takes its own references, as the duplicate records
+	 * have been left out of it.
+	 */
+	if (result == ISC_R_SUCCESS) {
+		*sharedp = ncache_refs(region->base + reservelen, true);
+	}
+
+cleanup:
+	for (i = 0; i < count; i++) {
+		if (shared[i] != NULL) {
+			dns_slabshared_detach(&shared[i]);
+		}
+	}
+	isc_mem_cput(mctx, bufs, count, sizeof(bufs[0]));
+	isc_mem_cput(mctx, shared, count, sizeof(shared[0]));
+	isc_mem_cput(mctx, rdatas, count, sizeof(rdatas[0]));
+
+	return (result);
+}
+
+void
+dns_rdataslab_ncachetail(isc_region_t *region) {
+	unsigned char *raw = NULL;
+
+	REQUIRE(region != NULL);
+
+	if (!ncache_isref(region->base, region->length)) {
+		return;
+	}
+
+	raw = (unsigned char *)(ncache_getref(region->base) + 1);
+	INSIST(peek_uint16(raw) == 1);
+	raw += 2;
+#if DNS_RDATASET_FIXED
+	raw += 4;
+#endif /* if DNS_RDATASET_FIXED */
+	region->length = peek_uint16(raw);
+	region->base = raw + DNS_RDATASET_ORDER + DNS_RDATASET_LENGTH;
+}
+
 unsigned int
 dns_rdataslab_size(unsigned char *slab, unsigned int reservelen) {
 	REQUIRE(slab != NULL);
@@ -515,12 +755,16 @@ rdata_in_slab(unsigned char *slab, unsigned int reservelen,
 	return (false);
 }
 
-isc_result_t
-dns_rdataslab_merge(unsigned char *oslab, unsigned char *nslab,
-		    unsigned int reservelen, isc_mem_t *mctx,
-		    dns_rdataclass_t rdclass, dns_rdatatype_t type,
-		    unsigned int flags, uint32_t maxrrperset,
-		    unsigned char **tslabp) {
+/*
+ * Merge the slab data at 'oslab' and 'nslab', which both begin with the
+ * record count, into a new slab, which begins with 'reservelen' bytes
+ * copied from 'reserve'.
+ */
+static isc_result_t
+slab_merge(const unsigned char *reserve, unsigned char *oslab,
+	   unsigned char *nslab, unsigned int reservelen, isc_mem_t *mctx,
+	   dns_rdataclass_t rdclass, dns_rdatatype_t type, unsigned int flags,
+	   uint32_t maxrrperset, unsigned char **tslabp) {
 	unsigned char *ocurrent = NULL, *ostart = NULL, *ncurrent = NULL;
 	unsigned char *tstart = NULL, *tcurrent = NULL, *data = NULL;
 	unsigned int ocount, ncount, count, olength, tlength, tcount, length;
@@ -546,13 +790,13 @@ dns_rdataslab_merge(unsigned char *oslab, unsigned char *nslab,
 	REQUIRE(tslabp != NULL && *tslabp == NULL);
 	REQUIRE(oslab != NULL && nslab != NULL);
 
-	ocurrent = oslab + reservelen;
+	ocurrent = oslab;
 	ocount = get_uint16(ocurrent);
 #if DNS_RDATASET_FIXED
 	ocurrent += (4 * ocount);
 #endif /* if DNS_RDATASET_FIXED */
 	ostart = ocurrent;
-	ncurrent = nslab + reservelen;
+	ncurrent = nslab;
 	ncount = get_uint16(ncurrent);
 #if DNS_RDATASET_FIXED
 	ncurrent += (4 * ncount);
@@ -599,7 +843,7 @@ dns_rdataslab_merge(unsigned char *oslab, unsigned char *nslab,
 	do {
 		dns_rdata_init(&nrdata);
 		rdata_from_slab(&ncurrent, rdclass, type, &nrdata);
-		if (!rdata_in_slab(oslab, reservelen, rdclass, type, &nrdata)) {
+		if (!rdata_in_slab(oslab, 0, rdclass, type, &nrdata)) {
 			/*
 			 * This rdata isn't in the old slab.
 			 */
@@ -644,10 +888,10 @@ dns_rdataslab_merge(unsigned char *oslab, unsigned char *nslab,
 	}
 
 	/*
-	 * Copy the reserved area from the new slab.
+	 * Copy the reserved area.
 	 */
 	tstart = isc_mem_get(mctx, tlength);
-	memmove(tstart, nslab, reservelen);
+	memmove(tstart, reserve, reservelen);
 	tcurrent = tstart + reservelen;
 #if DNS_RDATASET_FIXED
 	offsetbase = tcurrent;
@@ -680,7 +924,7 @@ dns_rdataslab_merge(unsigned char *oslab, unsigned char *nslab,
 #endif /* if DNS_RDATASET_FIXED */
 	rdata_from_slab(&ocurrent, rdclass, type, &ordata);
 
-	ncurrent = nslab + reservelen + 2;
+	ncurrent = nslab + 2;
 #if DNS_RDATASET_FIXED
 	ncurrent += (4 * oncount);
 #endif /* if DNS_RDATASET_FIXED */
@@ -694,8 +938,7 @@ dns_rdataslab_merge(unsigned char *oslab, unsigned char *nslab,
 			INSIST(norder < oncount);
 #endif /* if DNS_RDATASET_FIXED */
 			rdata_from_slab(&ncurrent, rdclass, type, &nrdata);
-		} while (rdata_in_slab(oslab, reservelen, rdclass, type,
-				       &nrdata));
+		} while (rdata_in_slab(oslab, 0, rdclass, type, &nrdata));
 	}
 
 	while (oadded < ocount || nadded < ncount) {
@@ -761,8 +1004,8 @@ dns_rdataslab_merge(unsigned char *oslab, unsigned char *nslab,
 #endif /* if DNS_RDATASET_FIXED */
 					rdata_from_slab(&ncurrent, rdclass,
 							type, &nrdata);
-				} while (rdata_in_slab(oslab, reservelen,
-						       rdclass, type, &nrdata));
+				} while (rdata_in_slab(oslab, 0, rdclass,
+						       type, &nrdata));
 			}
 		}
 	}
@@ -782,10 +1025,28 @@ dns_rdataslab_merge(unsigned char *oslab, unsigned char *nslab,
 }
 
 isc_result_t
-dns_rdataslab_subtract(unsigned char *mslab, unsigned char *sslab,
-		       unsigned int reservelen, isc_mem_t *mctx,
-		       dns_rdataclass_t rdclass, dns_rdatatype_t type,
-		       unsigned int flags, unsigned char **tslabp) {
+dns_rdataslab_merge(unsigned char *oslab, unsigned char *nslab,
+		    unsigned int reservelen, isc_mem_t *mctx,
+		    dns_rdataclass_t rdclass, dns_rdatatype_t type,
+		    unsigned int flags, uint32_t maxrrperset,
+		    unsigned char **tslabp) {
+	REQUIRE(oslab != NULL && nslab != NULL);
+
+	return (slab_merge(nslab, oslab + reservelen, nslab + reservelen,
+			   reservelen, mctx, rdclass, type, flags, maxrrperset,
+			   tslabp));
+}
+
+/*
+ * Subtract the slab data at 'sslab' from the slab data at 'mslab', which
+ * both begin with the record count, into a new slab, which begins with
+ * 'reservelen' bytes copied from 'reserve'.
+ */
+static isc_result_t
+slab_subtract(const unsigned char *reserve, unsigned char *mslab,
+	      unsigned char *sslab, unsigned int reservelen, isc_mem_t *mctx,
+	      dns_rdataclass_t rdclass, dns_rdatatype_t type,
+	      unsigned int flags, unsigned char **tslabp) {
 	unsigned char *mcurrent = NULL, *sstart = NULL, *scurrent = NULL;
 	unsigned char *tstart = NULL, *tcurrent = NULL;
 	unsigned int mcount, scount, rcount, count, tlength, tcount, i;
@@ -800,9 +1061,9 @@ dns_rdataslab_subtract(unsigned char *mslab, unsigned char *sslab,
 	REQUIRE(tslabp != NULL && *tslabp == NULL);
 	REQUIRE(mslab != NULL && sslab != NULL);
 
-	mcurrent = mslab + reservelen;
+	mcurrent = mslab;
 	mcount = get_uint16(mcurrent);
-	scurrent = sslab + reservelen;
+	scurrent = sslab;
 	scount = get_uint16(scurrent);
 	INSIST(mcount > 0 && scount > 0);
 
@@ -878,10 +1139,10 @@ dns_rdataslab_subtract(unsigned char *mslab, unsigned char *sslab,
 	}
 
 	/*
-	 * Copy the reserved area from the mslab.
+	 * Copy the reserved area.
 	 */
 	tstart = isc_mem_get(mctx, tlength);
-	memmove(tstart, mslab, reservelen);
+	memmove(tstart, reserve, reservelen);
 	tcurrent = tstart + reservelen;
 #if DNS_RDATASET_FIXED
 	offsetbase = tcurrent;
@@ -902,7 +1163,7 @@ dns_rdataslab_subtract(unsigned char *mslab, unsigned char *sslab,
 	/*
 	 * Copy the parts of mslab not in sslab.
 	 */
-	mcurrent = mslab + reservelen;
+	mcurrent = mslab;
 	mcount = get_uint16(mcurrent);
 #if DNS_RDATASET_FIXED
 	mcurrent += (4 * mcount);
@@ -951,6 +1212,17 @@ dns_rdataslab_subtract(unsigned char *mslab, unsigned char *sslab,
 	return (ISC_R_SUCCESS);
 }
 
+isc_result_t
+dns_rdataslab_subtract(unsigned char *mslab, unsigned char *sslab,
+		       unsigned int reservelen, isc_mem_t *mctx,
+		       dns_rdataclass_t rdclass, dns_rdatatype_t type,
+		       unsigned int flags, unsigned char **tslabp) {
+	REQUIRE(mslab != NULL && sslab != NULL);
+
+	return (slab_subtract(mslab, mslab + reservelen, sslab + reservelen,
+			      reservelen, mctx, rdclass, type, flags, tslabp));
+}
+
 bool
 dns_rdataslab_equal(unsigned char *slab1, unsigned char *slab2,
 		    unsigned int reservelen) {
@@ -1030,17 +1302,113 @@ dns_rdataslab_equalx(unsigned char *slab1, unsigned char *slab2,
 	return (true);
 }
 
+isc_result_t
+dns_rdataslab_fromrdatasetshared(dns_rdataset_t *rdataset, isc_mem_t *mctx,
+				 uint32_t limit, dns_slabshared_t **sharedp) {
+	isc_result_t result;
+	isc_region_t region;
+	dns_slabshared_t *shared = NULL;
+
+	REQUIRE(sharedp != NULL && *sharedp == NULL);
+	REQUIRE(dns_rdataset_count(rdataset) > 0);
+
+	result = dns_rdataslab_fromrdataset(rdataset, mctx, &region,
+					    sizeof(*shared), limit);
+	if (result != ISC_R_SUCCESS) {
+		return (result);
+	}
+
+	shared = (dns_slabshared_t *)region.base;
+	*shared = (dns_slabshared_t){
+		.references = ISC_REFCOUNT_INITIALIZER(1),
+	};
+	isc_mem_attach(mctx, &shared->mctx);
+
+	*sharedp = shared;
+	return (ISC_R_SUCCESS);
+}
+
+unsigned int
+dns_slabshared_size(dns_slabshared_t *shared) {
+	return (dns_rdataslab_size((unsigned char *)shared, sizeof(*shared)));
+}
+
+static void
+dns__slabshared_destroy(dns_slabshared_t *shared) {
+	isc_mem_putanddetach(&shared->mctx, shared,
+			     dns_slabshared_size(shared));
+}
+
+ISC_REFCOUNT_IMPL(dns_slabshared, dns__slabshared_destroy);
+
 dns_slabheader_t *
 dns_slabheader_fromrdataset(const dns_rdataset_t *rdataset) {
 	dns_slabheader_t *header = (dns_slabheader_t *)rdataset->slab.raw;
+
+	if (rdataset->slab.header != NULL) {
+		return (rdataset->slab.header);
+	}
 	return (header - 1);
 }
 
 void *
 dns_slabheader_raw(dns_slabheader_t *header) {
+	if (header->shared != NULL) {
+		return (header->shared + 1);
+	}
 	return (header + 1);
 }
 
+unsigned int
+dns_slabheader_size(dns_slabheader_t *header) {
+	if (NONEXISTENT(header)) {
+		return (0);
+	}
+	return (dns_rdataslab_size(dns_slabheader_raw(header), 0));
+}
+
+isc_result_t
+dns_slabheader_merge(dns_slabheader_t *oheader, dns_slabheader_t *nheader,
+		     isc_mem_t *mctx, dns_rdataclass_t rdclass,
+		     dns_rdatatype_t type, unsigned int flags,
+		     uint32_t maxrrperset, dns_slabheader_t **theaderp) {
+	isc_result_t result;
+	unsigned char *tslab = NULL;
+
+	REQUIRE(theaderp != NULL && *theaderp == NULL);
+
+	result = slab_merge((unsigned char *)nheader,
+			    dns_slabheader_raw(oheader),
+			    dns_slabheader_raw(nheader), sizeof(*nheader),
+			    mctx, rdclass, type, flags, maxrrperset, &tslab);
+	if (result == ISC_R_SUCCESS) {
+		*theaderp = (dns_slabheader_t *)tslab;
+		(*theaderp)->shared = NULL;
+	}
+	return (result);
+}
+
+isc_result_t
+dns_slabheader_subtract(dns_slabheader_t *mheader, dns_slabheader_t *sheader,
+			isc_mem_t *mctx, dns_rdataclass_t rdclass,
+			dns_rdatatype_t type, unsigned int flags,
+			dns_slabheader_t **theaderp) {
+	isc_result_t result;
+	unsigned char *tslab = NULL;
+
+	REQUIRE(theaderp != NULL && *theaderp == NULL);
+
+	result = slab_subtract((unsigned char *)mheader,
+			       dns_slabheader_raw(mheader),
+			       dns_slabheader_raw(sheader), sizeof(*mheader),
+			       mctx, rdclass, type, flags, &tslab);
+	if (result == ISC_R_SUCCESS) {
+		*theaderp = (dns_slabheader_t *)tslab;
+		(*theaderp)->shared = NULL;
+	}
+	return (result);
+}
+
 void
 dns_slabheader_setownercase(dns_slabheader_t *header, const dns_name_t *name) {
 	unsigned int i;
@@ -1084,6 +1452,8 @@ dns_slabheader_reset(dns_slabheader_t *h, dns_db_t *db, dns_dbnode_t *node) {
 	h->db = db;
 	h->node = node;
 
+	h->shared = NULL;
+
 	atomic_init(&h->attributes, 0);
 	atomic_init(&h->last_refresh_fail_ts, 0);
 
@@ -1104,6 +1474,15 @@ dns_slabheader_new(dns_db_t *db, dns_dbnode_t *node) {
 	return (h);
 }
 
+dns_slabheader_t *
+dns_slabheader_newshared(dns_db_t *db, dns_dbnode_t *node,
+			 dns_slabshared_t *shared) {
+	dns_slabheader_t *h = dns_slabheader_new(db, node);
+
+	dns_slabshared_attach(shared, &h->shared);
+	return (h);
+}
+
 void
 dns_slabheader_destroy(dns_slabheader_t **headerp) {
 	unsigned int size;
@@ -1115,9 +1494,15 @@ dns_slabheader_destroy(dns_slabheader_t **headerp) {
 
 	dns_db_deletedata(header->db, header->node, header);
 
-	if (NONEXISTENT(header)) {
+	if (header->shared != NULL) {
+		size = sizeof(*header);
+		dns_slabshared_detach(&header->shared);
+	} else if (NONEXISTENT(header)) {
 		size = sizeof(*header);
 	} else {
+		if (NCACHEREF(header)) {
+			(void)ncache_refs((unsigned char *)(header + 1), false);
+		}
 		size = dns_rdataslab_size((unsigned char *)header,
 					  sizeof(*header));
 	}
@@ -0,0 +1,604 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*! \file */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include <isc/async.h>
+#include <isc/atomic.h>
+#include <isc/hash.h>
+#include <isc/hashmap.h>
+#include <isc/heap.h>
+#include <isc/loop.h>
+#include <isc/magic.h>
+#include <isc/mem.h>
+#include <isc/mutex.h>
+#include <isc/result.h>
+#include <isc/stats.h>
+#include <isc/stdtime.h>
+#include <isc/time.h>
+#include <isc/timer.h>
+#include <isc/util.h>
+
+#include <dns/db.h>
+#include <dns/fixedname.h>
+#include <dns/name.h>
+#include <dns/rdataset.h>
+#include <dns/refresher.h>
+#include <dns/resolver.h>
+#include <dns/stats.h>
+#include <dns/view.h>
+
+#define REFRESHER_MAGIC	   ISC_MAGIC('R', 'f', 's', 'h')
+#define VALID_REFRESHER(r) ISC_MAGIC_VALID(r, REFRESHER_MAGIC)
+
+/*
+ * The count-min sketch: each hit increments one counter in each row,
+ * and the smallest of them is the estimate of the number of hits.
+ */
+#define SKETCH_DEPTH 4
+#define SKETCH_WIDTH 4096 /* must be a power of two */
+
+/*
+ * The timer fires every REFRESH_TICK milliseconds, so that the
+ * fetches allowed in a second are spread over it.  The counters are
+ * halved every REFRESH_DECAY ticks.
+ */
+#define REFRESH_TICK  100
+#define REFRESH_DECAY 600
+
+/*
+ * Only every REFRESH_OFFER'th hit of a name is offered to the table, to
+ * keep the busiest names from fighting over its lock.
+ */
+#define REFRESH_OFFER 8
+
+/*
+ * How many seconds before the prefetch trigger an entry is refreshed:
+ * enough for the timer to come round and the fetch to finish.
+ */
+#define REFRESH_LEAD 2
+
+typedef struct refresh_entry {
+	dns_refresher_t *refresher;
+	dns_fixedname_t fixed;
+	dns_name_t *name;
+	dns_rdatatype_t type;
+	uint32_t hashval;
+	uint32_t count;
+	unsigned int heapidx; /* 0 while it is being refreshed */
+	isc_stdtime_t expiry; /* 0 if unknown */
+	bool refreshing;
+	dns_fetch_t *fetch;
+	dns_rdataset_t rdataset;
+	dns_rdataset_t sigrdataset;
+} refresh_entry_t;
+
+typedef struct refresh_key {
+	const dns_name_t *name;
+	dns_rdatatype_t type;
+} refresh_key_t;
+
+typedef struct refresh_due {
+	refresh_entry_t *entry;
+	uint32_t count;
+} refresh_due_t;
+
+struct dns_refresher {
+	unsigned int magic;
+	isc_mem_t *mctx;
+	isc_loop_t *loop;
+	isc_refcount_t references;
+	dns_resolver_t *resolver;
+	isc_stats_t *stats;
+	isc_timer_t *timer;
+	atomic_bool shuttingdown;
+
+	dns_ttl_t lead;
+	dns_ttl_t eligible;
+
+	atomic_uint_fast32_t sketch[SKETCH_DEPTH][SKETCH_WIDTH];
+
+	/* Locked by lock. */
+	isc_mutex_t lock;
+	isc_hashmap_t *table;
+	isc_heap_t *heap; /* the entries not being refreshed, least hit first */
+	refresh_entry_t *entries;
+	uint32_t size;
+	uint32_t used;
+
+	/* The smallest count in the table, once it is full. */
+	atomic_uint_fast32_t floor;
+
+	/* Only used on the loop. */
+	refresh_due_t *due;
+	uint32_t rate;
+	uint64_t tokens; /* in thousandths of a fetch */
+	unsigned int ticks;
+};
+
+static void
+tick(void *arg);
+
+static uint64_t
+hash_key(const dns_name_t *name, dns_rdatatype_t type) {
+	isc_hash64_t state;
+
+	isc_hash64_init(&state);
+	isc_hash64_hash(&state, name->ndata, name->length, false);
+	isc_hash64_hash(&state, &type, sizeof(type), true);
+	return (isc_hash64_finalize(&state));
+}
+
+static bool
+match_entry(void *node, const void *key) {
+	const refresh_entry_t *entry = node;
+	const refresh_key_t *k = key;
+
+	return (entry->type == k->type && dns_name_equal(entry->name, k->name));
+}
+
+static bool
+heap_less(void *a, void *b) {
+	const refresh_entry_t *ea = a;
+	const refresh_entry_t *eb = b;
+
+	return (ea->count < eb->count);
+}
+
+static void
+heap_setindex(void *what, unsigned int idx) {
+	refresh_entry_t *entry = what;
+
+	entry->heapidx = idx;
+}
+
+static void
+inc_stats(dns_refresher_t *refresher, isc_statscounter_t counter) {
+	if (refresher->stats != NULL) {
+		isc_stats_increment(refresher->stats, counter);
+	}
+}
+
+void
+dns_refresher_create(dns_view_t *view, uint32_t size, uint32_t rate,
+		     dns_refresher_t **refresherp) {
+	dns_refresher_t *refresher = NULL;
+	isc_interval_t interval;
+	uint8_t bits = 1;
+
+	REQUIRE(DNS_VIEW_VALID(view));
+	REQUIRE(view->resolver != NULL);
+	REQUIRE(size > 0 && rate > 0);
+	REQUIRE(refresherp != NULL && *refresherp == NULL);
+
+	refresher = isc_mem_get(view->mctx, sizeof(*refresher));
+	*refresher = (dns_refresher_t){
+		.lead = view->prefetch_trigger + REFRESH_LEAD,
+		.eligible = view->prefetch_eligible,
+		.size = size,
+		.rate = rate,
+		.tokens = (uint64_t)rate * 1000,
+	};
+
+	isc_mem_attach(view->mctx, &refresher->mctx);
+	isc_loop_attach(isc_loop(), &refresher->loop);
+	dns_resolver_attach(view->resolver, &refresher->resolver);
+	dns_resolver_getstats(view->resolver, &refresher->stats);
+
+	for (size_t i = 0; i < SKETCH_DEPTH; i++) {
+		for (size_t j = 0; j < SKETCH_WIDTH; j++) {
+			atomic_init(&refresher->sketch[i][j], 0);
+		}
+	}
+	atomic_init(&refresher->shuttingdown, false);
+	atomic_init(&refresher->floor, 0);
+
+	isc_mutex_init(&refresher->lock);
+	while (bits < 32 && (1U << bits) < size) {
+		bits++;
+	}
+	isc_hashmap_create(refresher->mctx, bits, &refresher->table);
+	isc_heap_create(refresher->mctx, heap_less, heap_setindex, size,
+			&refresher->heap);
+	refresher->entries = isc_mem_cget(refresher->mctx, size,
+					  sizeof(refresher->entries[0]));
+	refresher->due = isc_mem_cget(refresher->mctx, size,
+				      sizeof(refresher->due[0]));
+	for (size_t i = 0; i < size; i++) {
+		refresh_entry_t *entry = &refresher->entries[i];
+
+		entry->refresher = refresher;
+		entry->name = dns_fixedname_initname(&entry->fixed);
+		dns_rdataset_init(&entry->rdataset);
+		dns_rdataset_init(&entry->sigrdataset);
+	}
+
+	isc_refcount_init(&refresher->references, 1);
+
+	isc_timer_create(refresher->loop, tick, refresher, &refresher->timer);
+	isc_interval_set(&interval, 0, REFRESH_TICK * NS_PER_MS);
+	isc_timer_start(refresher->timer, isc_timertype_ticker, &interval);
+
+	refresher->magic = REFRESHER_MAGIC;
+	*refresherp = refresher;
+}
+
+static void
+refresher_destroy(dns_refresher_t *refresher) {
+	REQUIRE(refresher->timer == NULL);
+
+	refresher->magic = 0;
+
+	isc_hashmap_destroy(&refresher->table);
+	isc_heap_destroy(&refresher->heap);
+	isc_mem_cput(refresher->mctx, refresher->due, refresher->size,
+		     sizeof(refresher->due[0]));
+	isc_mem_cput(refresher->mctx, refresher->entries, refresher->size,
+		     sizeof(refresher->entries[0]));
+	isc_mutex_destroy(&refresher->lock);
+
+	if (refresher->stats != NULL) {
+		isc_stats_detach(&refresher->stats);
+	}
+	if (refresher->resolver != NULL) {
+		dns_resolver_detach(&refresher->resolver);
+	}
+	if (refresher->loop != NULL) {
+		isc_loop_detach(&refresher->loop);
+	}
+	isc_mem_putanddetach(&refresher->mctx, refresher, sizeof(*refresher));
+}
+
+#if DNS_REFRESHER_TRACE
+ISC_REFCOUNT_TRACE_IMPL(dns_refresher, refresher_destroy);
+#else
+ISC_REFCOUNT_IMPL(dns_refresher, refresher_destroy);
+#endif
+
+/*
+ * Set the count of an entry, and move it in the heap if it is there.
+ */
+static void
+set_count(dns_refresher_t *refresher, refresh_entry_t *entry,
+	  uint32_t count) {
+	uint32_t old = entry->count;
+
+	entry->count = count;
+	if (entry->heapidx == 0) {
+		return;
+	} else if (count > old) {
+		isc_heap_decreased(refresher->heap, entry->heapidx);
+	} else if (count < old) {
+		isc_heap_increased(refresher->heap, entry->heapidx);
+	}
+}
+
+static void
+update_floor(dns_refresher_t *refresher) {
+	refresh_entry_t *least = NULL;
+
+	if (refresher->used == refresher->size) {
+		least = isc_heap_element(refresher->heap, 1);
+	}
+	atomic_store_relaxed(&refresher->floor,
+			     least != NULL ? least->count : 0);
+}
+
+void
+dns_refresher_hit(dns_refresher_t *refresher, const dns_name_t *name,
+		  dns_rdatatype_t type, dns_ttl_t ttl, isc_stdtime_t now) {
+	refresh_key_t key = { .name = name, .type = type };
+	refresh_entry_t *entry = NULL;
+	uint64_t hash;
+	uint32_t estimate = UINT32_MAX;
+	isc_result_t result;
+
+	REQUIRE(VALID_REFRESHER(refresher));
+	REQUIRE(dns_name_isabsolute(name));
+
+	if (atomic_load_relaxed(&refresher->shuttingdown)) {
+		return;
+	}
+
+	/* Each row takes its index from a different part of the hash */
+	hash = hash_key(name, type);
+	for (size_t i = 0; i < SKETCH_DEPTH; i++) {
+		size_t j = (hash >> (i * 16)) & (SKETCH_WIDTH - 1);
+		uint32_t count;
+
+		count = atomic_fetch_add_relaxed(&refresher->sketch[i][j], 1);
+		estimate = ISC_MIN(estimate, count + 1);
+	}
+
+	if (estimate % REFRESH_OFFER != 0 ||
+	    estimate <= atomic_load_relaxed(&refresher->floor))
+	{
+		return;
+	}
+
+	LOCK(&refresher->lock);
+	result = isc_hashmap_find(refresher->table, (uint32_t)hash,
+				  match_entry, &key, (void **)&entry);
+	if (result == ISC_R_SUCCESS) {
+		set_count(refresher, entry, estimate);
+		if (!entry->refreshing) {
+			entry->expiry = now + ttl;
+		}
+		goto floor;
+	}
+
+	if (refresher->used < refresher->size) {
+		entry = &refresher->entries[refresher->used++];
+		entry->count = estimate;
+		isc_heap_insert(refresher->heap, entry);
+	} else {
+		/* Replace the least popular entry not being refreshed */
+		entry = isc_heap_element(refresher->heap, 1);
+		if (entry == NULL || entry->count >= estimate) {
+			goto unlock;
+		}
+		key.name = entry->name;
+		key.type = entry->type;
+		result = isc_hashmap_delete(refresher->table, entry->hashval,
+					    match_entry, &key);
+		INSIST(result == ISC_R_SUCCESS);
+		set_count(refresher, entry, estimate);
+	}
+
+	dns_name_copy(name, entry->name);
+	entry->type = type;
+	entry->hashval = (uint32_t)hash;
+	entry->expiry = now + ttl;
+
+	key.name = entry->name;
+	key.type = entry->type;
+	result = isc_hashmap_add(refresher->table, entry->hashval, match_entry,
+				 &key, entry, NULL);
+	INSIST(result == ISC_R_SUCCESS);
+
+floor:
+	update_floor(refresher);
+
+unlock:
+	UNLOCK(&refresher->lock);
+}
+
+/*
+ * Halve all the counters, so that the names which are not asked for
+ * any more make room for those which are.
+ */
+static void
+decay(dns_refresher_t *refresher) {
+	for (size_t i = 0; i < SKETCH_DEPTH; i++) {
+		for (size_t j = 0; j < SKETCH_WIDTH; j++) {
+			atomic_uint_fast32_t *counter =
+				&refresher->sketch[i][j];
+			atomic_store_relaxed(counter,
+					     atomic_load_relaxed(counter) / 2);
+		}
+	}
+
+	/* Halving all the counts keeps the order of the heap */
+	LOCK(&refresher->lock);
+	for (size_t i = 0; i < refresher->used; i++) {
+		refresher->entries[i].count /= 2;
+	}
+	update_floor(refresher);
+	UNLOCK(&refresher->lock);
+}
+
+static int
+compare_due(const void *a, const void *b) {
+	const refresh_due_t *da = a;
+	const refresh_due_t *db = b;
+
+	if (da->count != db->count) {
+		return (da->count > db->count ? -1 : 1);
+	}
+	return (0);
+}
+
+/*
+ * Put an entry which is no longer being refreshed back in the heap,
+ * so that it can be replaced again.
+ */
+static void
+refresh_done(dns_refresher_t *refresher, refresh_entry_t *entry,
+	     isc_stdtime_t expiry) {
+	LOCK(&refresher->lock);
+	entry->refreshing = false;
+	entry->expiry = expiry;
+	isc_heap_insert(refresher->heap, entry);
+	update_floor(refresher);
+	UNLOCK(&refresher->lock);
+}
+
+static void
+fetch_done(void *arg) {
+	dns_fetchresponse_t *resp = (dns_fetchresponse_t *)arg;
+	refresh_entry_t *entry = resp->arg;
+	dns_refresher_t *refresher = entry->refresher;
+	isc_stdtime_t expiry = 0;
+
+	REQUIRE(VALID_REFRESHER(refresher));
+
+	/*
+	 * Whatever the answer was, it is in the cache now; keep
+	 * refreshing it if it will stay there long enough to be worth it.
+	 */
+	if (dns_rdataset_isassociated(&entry->rdataset)) {
+		if (entry->rdataset.ttl >= refresher->eligible) {
+			expiry = isc_stdtime_now() + entry->rdataset.ttl;
+		}
+		dns_rdataset_disassociate(&entry->rdataset);
+	} else if (resp->result != ISC_R_CANCELED &&
+		   resp->result != ISC_R_SHUTTINGDOWN)
+	{
+		inc_stats(refresher, dns_resstatscounter_refreshfail);
+	}
+	if (dns_rdataset_isassociated(&entry->sigrdataset)) {
+		dns_rdataset_disassociate(&entry->sigrdataset);
+	}
+	if (resp->node != NULL) {
+		dns_db_detachnode(resp->db, &resp->node);
+	}
+	if (resp->db != NULL) {
+		dns_db_detach(&resp->db);
+	}
+	dns_resolver_destroyfetch(&entry->fetch);
+	isc_mem_putanddetach(&resp->mctx, resp, sizeof(*resp));
+
+	refresh_done(refresher, entry, expiry);
+
+	dns_refresher_detach(&refresher); /* for dns_resolver_createfetch() */
+}
+
+static void
+tick(void *arg) {
+	dns_refresher_t *refresher = arg;
+	isc_stdtime_t now = isc_stdtime_now();
+	uint64_t burst = (uint64_t)refresher->rate * 1000;
+	uint32_t ndue = 0, nfetch = 0, nstarted = 0, used;
+
+	REQUIRE(VALID_REFRESHER(refresher));
+
+	if (atomic_load_acquire(&refresher->shuttingdown)) {
+		return;
+	}
+
+	if (++refresher->ticks % REFRESH_DECAY == 0) {
+		decay(refresher);
+	}
+
+	/* Refill the bucket with the fetches allowed in a tick */
+	refresher->tokens = ISC_MIN(
+		refresher->tokens + (uint64_t)refresher->rate * REFRESH_TICK,
+		burst);
+
+	LOCK(&refresher->lock);
+	for (size_t i = 0; i < refresher->used; i++) {
+		refresh_entry_t *entry = &refresher->entries[i];
+
+		if (!entry->refreshing && entry->expiry != 0 &&
+		    entry->expiry <= now + refresher->lead)
+		{
+			refresher->due[ndue++] = (refresh_due_t){
+				.entry = entry,
+				.count = entry->count,
+			};
+		}
+	}
+	UNLOCK(&refresher->lock);
+
+	/* The most popular names go first */
+	qsort(refresher->due, ndue, sizeof(refresher->due[0]), compare_due);
+	nfetch = ISC_MIN(ndue, refresher->tokens / 1000);
+
+	/*
+	 * An entry may have been replaced while the lock was let go;
+	 * whatever name is in it now is refreshed if it is due too.
+	 */
+	LOCK(&refresher->lock);
+	for (size_t i = 0; i < nfetch; i++) {
+		refresh_entry_t *entry = refresher->due[i].entry;
+
+		if (!entry->refreshing && entry->expiry != 0 &&
+		    entry->expiry <= now + refresher->lead)
+		{
+			entry->refreshing = true;
+			isc_heap_delete(refresher->heap, entry->heapidx);
+			refresher->due[nstarted++].entry = entry;
+		}
+	}
+	update_floor(refresher);
+	used = refresher->used;
+	UNLOCK(&refresher->lock);
+
+	/*
+	 * The entries being refreshed are not replaced in the table, so
+	 * their names can be used without the lock.
+	 */
+	for (size_t i = 0; i < nstarted; i++) {
+		refresh_entry_t *entry = refresher->due[i].entry;
+		isc_result_t result;
+
+		dns_refresher_ref(refresher);
+		result = dns_resolver_createfetch(
+			refresher->resolver, entry->name, entry->type, NULL,
+			NULL, NULL, NULL, 0, DNS_FETCHOPT_PREFETCH, 0, NULL,
+			refresher->loop, fetch_done, entry, &entry->rdataset,
+			&entry->sigrdataset, &entry->fetch);
+		if (result != ISC_R_SUCCESS) {
+			inc_stats(refresher, dns_resstatscounter_refreshfail);
+			refresh_done(refresher, entry, 0);
+			dns_refresher_unref(refresher);
+			continue;
+		}
+		inc_stats(refresher, dns_resstatscounter_refresh);
+	}
+	refresher->tokens -= (uint64_t)nstarted * 1000;
+
+	for (size_t i = nfetch; i < ndue; i++) {
+		inc_stats(refresher, dns_resstatscounter_refreshdeferred);
+	}
+	if (refresher->stats != NULL) {
+		isc_stats_set(refresher->stats, used,
+			      dns_resstatscounter_refreshtracked);
+	}
+}
+
+static void
+refresher_shutdown(void *arg) {
+	dns_refresher_t *refresher = arg;
+
+	REQUIRE(VALID_REFRESHER(refresher));
+
+	isc_timer_stop(refresher->timer);
+	isc_timer_destroy(&refresher->timer);
+
+	/* The fetches finish on this loop, so they can't go away */
+	LOCK(&refresher->lock);
+	for (size_t i = 0; i < refresher->used; i++) {
+		refresh_entry_t *entry = &refresher->entries[i];
+
+		if (entry->fetch != NULL) {
+			dns_resolver_cancelfetch(entry->fetch);
+		}
+	}
+	UNLOCK(&refresher->lock);
+
+	/*
+	 * The fetches hold the resolver themselves; let go of it now, so
+	 * that it and its view do not wait for the last fetch to finish.
+	 */
+	dns_resolver_detach(&refresher->resolver);
+	isc_loop_detach(&refresher->loop);
+
+	dns_refresher_detach(&refresher);
+}
+
+void
+dns_refresher_shutdown(dns_refresher_t *refresher) {
+	REQUIRE(VALID_REFRESHER(refresher));
+
+	if (atomic_compare_exchange_strong(&refresher->shuttingdown,
+					   &(bool){ false }, true))
+	{
+		dns_refresher_ref(refresher);
+		isc_async_run(refresher->loop, refresher_shutdown, refresher);
+	}
+}
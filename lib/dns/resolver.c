@@ -22,7 +22,6 @@
 #include <isc/atomic.h>
 #include <isc/counter.h>
 #include <isc/hash.h>
-#include <isc/hashmap.h>
 #include <isc/log.h>
 #include <isc/loop.h>
 #include <isc/mutex.h>
@@ -36,6 +35,7 @@
 #include <isc/tid.h>
 #include <isc/time.h>
 #include <isc/timer.h>
+#include <isc/urcu.h>
 #include <isc/util.h>
 
 #include <dns/acl.h>
@@ -231,10 +231,32 @@ STATIC_ASSERT(NS_PROCESSING_LIMIT > NS_RR_LIMIT,
 	      "delegation "
 	      "threshold (NS_RR_LIMIT).");
 
-/* Hash table for zone counters */
-#ifndef RES_DOMAIN_HASH_BITS
-#define RES_DOMAIN_HASH_BITS 12
-#endif /* ifndef RES_DOMAIN_HASH_BITS */
+/* Hash tables for fetch contexts and zone counters */
+#define RES_HASH_INIT_SIZE (1 << 12) /* Must be power of 2 */
+#define RES_HASH_MIN_SIZE  (1 << 8)  /* Must be power of 2 */
+
+/*%
+ * A hedged query is sent to another server when a UDP query has not been
+ * answered within HEDGE_QUANTILE thousandths of its server's recent
+ * responses, but not sooner than HEDGE_MIN_US.  Each other query sent
+ * earns 'hedgebudget' credits, a hedged query costs HEDGE_COST of them,
+ * and no more than HEDGE_MAXCREDIT are saved up for a burst.
+ */
+#define HEDGE_QUANTILE	950
+#define HEDGE_MIN_US	(10 * US_PER_MS)
+#define HEDGE_COST	100
+#define HEDGE_MAXCREDIT (100 * HEDGE_COST)
+
+/*%
+ * The fetch times are counted in FETCHTIME_BUCKETS buckets, each twice
+ * as wide as the one before, the first being under a millisecond.  The
+ * FetchTime50 and FetchTime99 statistics are updated every
+ * FETCHTIME_UPDATE fetches, and the counts are halved whenever
+ * FETCHTIME_WINDOW is reached, to follow the recent fetches.
+ */
+#define FETCHTIME_BUCKETS 16
+#define FETCHTIME_UPDATE  64
+#define FETCHTIME_WINDOW  8192
 
 /*%
  * Maximum EDNS0 input packet size.
@@ -264,6 +286,7 @@ typedef struct query {
 	isc_time_t start;
 	dns_messageid_t id;
 	dns_dispentry_t *dispentry;
+	isc_timer_t *hedgetimer;
 	ISC_LINK(struct query) link;
 	isc_buffer_t buffer;
 	isc_buffer_t *tsig;
@@ -297,9 +320,11 @@ struct tried {
 #define VALID_QUERY(query) ISC_MAGIC_VALID(query, QUERY_MAGIC)
 
 #define RESQUERY_ATTR_CANCELED 0x02
+#define RESQUERY_ATTR_HEDGE    0x04
 
 #define RESQUERY_CONNECTING(q) ((q)->connects > 0)
 #define RESQUERY_CANCELED(q)   (((q)->attributes & RESQUERY_ATTR_CANCELED) != 0)
+#define RESQUERY_HEDGE(q)      (((q)->attributes & RESQUERY_ATTR_HEDGE) != 0)
 #define RESQUERY_SENDING(q)    ((q)->sends > 0)
 
 typedef enum {
@@ -328,6 +353,8 @@ struct fctxcount {
 	uint_fast32_t allowed;
 	uint_fast32_t dropped;
 	isc_stdtime_t logged;
+	struct cds_lfht_node ht_node;
+	struct rcu_head rcu_head;
 };
 
 struct fetchctx {
@@ -355,6 +382,8 @@ struct fetchctx {
 	bool hashed;
 	bool cloned;
 	bool spilled;
+	struct cds_lfht_node ht_node;
+	struct rcu_head rcu_head;
 	ISC_LINK(struct fetchctx) link;
 	ISC_LIST(dns_fetchresponse_t) resps;
 
@@ -552,11 +581,13 @@ struct dns_resolver {
 	dns_dispatchset_t *dispatches4;
 	dns_dispatchset_t *dispatches6;
 
-	isc_hashmap_t *fctxs;
-	isc_rwlock_t fctxs_lock;
-
-	isc_hashmap_t *counters;
-	isc_rwlock_t counters_lock;
+	/*%
+	 * The active fetch contexts and the zone counters are in
+	 * lock-free hash tables, so that the loops do not contend on
+	 * them when they create and release fetches.
+	 */
+	struct cds_lfht *fctxs;
+	struct cds_lfht *counters;
 
 	uint32_t lame_ttl;
 	ISC_LIST(alternate_t) alternates;
@@ -587,6 +618,14 @@ struct dns_resolver {
 	atomic_uint_fast32_t maxvalidations;
 	atomic_uint_fast32_t maxvalidationfails;
 
+	atomic_uint_fast32_t hedgebudget; /* percent */
+	atomic_uint_fast32_t hedgecredit;
+
+	atomic_uint_fast32_t fetchtimes[FETCHTIME_BUCKETS];
+	atomic_uint_fast32_t nfetchtimes;
+
+	atomic_uint_fast32_t forwardconns; /* per forwarder and loop */
+
 	/* Locked by lock. */
 	unsigned int spillat; /* clients-per-query */
 
@@ -655,6 +694,8 @@ resquery_response_continue(void *arg, isc_result_t result);
 static void
 resquery_connected(isc_result_t eresult, isc_region_t *region, void *arg);
 static void
+resquery_hedge(void *arg);
+static void
 fctx_try(fetchctx_t *fctx, bool retrying, bool badcache);
 static void
 fctx_shutdown(void *arg);
@@ -1115,6 +1156,10 @@ fctx_cancelquery(resquery_t **queryp, isc_time_t *finish, bool no_response,
 
 	query->attributes |= RESQUERY_ATTR_CANCELED;
 
+	if (query->hedgetimer != NULL) {
+		isc_timer_destroy(&query->hedgetimer);
+	}
+
 	/*
 	 * Should we update the RTT?
 	 */
@@ -1132,6 +1177,11 @@ fctx_cancelquery(resquery_t **queryp, isc_time_t *finish, bool no_response,
 			rttms = rtt / US_PER_MS;
 			factor = DNS_ADB_RTTADJDEFAULT;
 
+			if ((query->options & DNS_FETCHOPT_TCP) == 0) {
+				dns_adb_rttsample(fctx->adb, query->addrinfo,
+						  rtt);
+			}
+
 			if (rttms < DNS_RESOLVER_QRYRTTCLASS0) {
 				inc_stats(fctx->res,
 					  dns_resstatscounter_queryrtt0);
@@ -1412,22 +1462,33 @@ fcount_logspill(fetchctx_t *fctx, fctxcount_t *counter, bool final) {
 	counter->logged = now;
 }
 
-static bool
-fcount_match(void *node, const void *key) {
-	const fctxcount_t *counter = node;
+static int
+fcount_match(struct cds_lfht_node *ht_node, const void *key) {
+	const fctxcount_t *counter = caa_container_of(ht_node, fctxcount_t,
+						      ht_node);
 	const dns_name_t *domain = key;
 
 	return (dns_name_equal(counter->domain, domain));
 }
 
+static void
+fcount_destroy(struct rcu_head *rcu_head) {
+	fctxcount_t *counter = caa_container_of(rcu_head, fctxcount_t,
+						rcu_head);
+
+	isc_mutex_destroy(&counter->lock);
+	isc_mem_putanddetach(&counter->mctx, counter, sizeof(*counter));
+}
+
 static isc_result_t
 fcount_incr(fetchctx_t *fctx, bool force) {
 	isc_result_t result = ISC_R_SUCCESS;
 	dns_resolver_t *res = NULL;
 	fctxcount_t *counter = NULL;
+	struct cds_lfht_iter iter;
+	struct cds_lfht_node *ht_node = NULL;
 	uint32_t hashval;
 	uint_fast32_t spill;
-	isc_rwlocktype_t locktype = isc_rwlocktype_read;
 
 	REQUIRE(fctx != NULL);
 	res = fctx->res;
@@ -1442,13 +1503,12 @@ fcount_incr(fetchctx_t *fctx, bool force) {
 
 	hashval = dns_name_hash(fctx->domain);
 
-	RWLOCK(&res->counters_lock, locktype);
-	result = isc_hashmap_find(res->counters, hashval, fcount_match,
-				  fctx->domain, (void **)&counter);
-	switch (result) {
-	case ISC_R_SUCCESS:
-		break;
-	case ISC_R_NOTFOUND:
+	rcu_read_lock();
+again:
+	cds_lfht_lookup(res->counters, hashval, fcount_match, fctx->domain,
+			&iter);
+	ht_node = cds_lfht_iter_get_node(&iter);
+	if (ht_node == NULL) {
 		counter = isc_mem_get(fctx->mctx, sizeof(*counter));
 		*counter = (fctxcount_t){
 			.magic = FCTXCOUNT_MAGIC,
@@ -1460,28 +1520,30 @@ fcount_incr(fetchctx_t *fctx, bool force) {
 		counter->domain = dns_fixedname_initname(&counter->dfname);
 		dns_name_copy(fctx->domain, counter->domain);
 
-		UPGRADELOCK(&res->counters_lock, locktype);
-
-		void *found = NULL;
-		result = isc_hashmap_add(res->counters, hashval, fcount_match,
-					 counter->domain, counter, &found);
-		if (result == ISC_R_EXISTS) {
+		ht_node = cds_lfht_add_unique(res->counters, hashval,
+					      fcount_match, counter->domain,
+					      &counter->ht_node);
+		if (ht_node != &counter->ht_node) {
+			/* Another fetch has added the counter first */
 			isc_mutex_destroy(&counter->lock);
 			isc_mem_putanddetach(&counter->mctx, counter,
 					     sizeof(*counter));
-			counter = found;
-			result = ISC_R_SUCCESS;
 		}
-
-		INSIST(result == ISC_R_SUCCESS);
-		break;
-	default:
-		UNREACHABLE();
 	}
+	counter = caa_container_of(ht_node, fctxcount_t, ht_node);
 	INSIST(VALID_FCTXCOUNT(counter));
 
-	INSIST(spill > 0);
 	LOCK(&counter->lock);
+	if (cds_lfht_is_node_deleted(&counter->ht_node)) {
+		/*
+		 * The last fetch for the domain has just released the
+		 * counter; look again and add a new one if need be.
+		 */
+		UNLOCK(&counter->lock);
+		goto again;
+	}
+
+	INSIST(spill > 0);
 	if (++counter->count > spill && !force) {
 		counter->count--;
 		INSIST(counter->count > 0);
@@ -1493,16 +1555,11 @@ fcount_incr(fetchctx_t *fctx, bool force) {
 		fctx->counter = counter;
 	}
 	UNLOCK(&counter->lock);
-	RWUNLOCK(&res->counters_lock, locktype);
+	rcu_read_unlock();
 
 	return (result);
 }
 
-static bool
-match_ptr(void *node, const void *key) {
-	return (node == key);
-}
-
 static void
 fcount_decr(fetchctx_t *fctx) {
 	REQUIRE(fctx != NULL);
@@ -1514,34 +1571,25 @@ fcount_decr(fetchctx_t *fctx) {
 	fctx->counter = NULL;
 
 	/*
-	 * FIXME: This should not require a write lock, but should be
-	 * implemented using reference counting later, otherwise we would could
-	 * encounter ABA problem here - the count could go up and down when we
-	 * switch from read to write lock.
+	 * The counter is removed from the table under its lock, so that
+	 * fcount_incr() cannot count a fetch in a counter on its way out.
 	 */
-	RWLOCK(&fctx->res->counters_lock, isc_rwlocktype_write);
-
 	LOCK(&counter->lock);
 	INSIST(VALID_FCTXCOUNT(counter));
 	INSIST(counter->count > 0);
 	if (--counter->count > 0) {
 		UNLOCK(&counter->lock);
-		RWUNLOCK(&fctx->res->counters_lock, isc_rwlocktype_write);
 		return;
 	}
 
-	isc_result_t result = isc_hashmap_delete(fctx->res->counters,
-						 dns_name_hash(counter->domain),
-						 match_ptr, counter);
-	INSIST(result == ISC_R_SUCCESS);
+	rcu_read_lock();
+	INSIST(!cds_lfht_del(fctx->res->counters, &counter->ht_node));
+	rcu_read_unlock();
 
 	fcount_logspill(fctx, counter, true);
 	UNLOCK(&counter->lock);
 
-	isc_mutex_destroy(&counter->lock);
-	isc_mem_putanddetach(&counter->mctx, counter, sizeof(*counter));
-
-	RWUNLOCK(&fctx->res->counters_lock, isc_rwlocktype_write);
+	call_rcu(&counter->rcu_head, fcount_destroy);
 }
 
 static void
@@ -1644,6 +1692,76 @@ fctx_sendevents(fetchctx_t *fctx, isc_result_t result) {
 	}
 }
 
+/*
+ * Return the 'permille' quantile of the fetch times in 'counts', in
+ * milliseconds, interpolated within its bucket.
+ */
+static uint64_t
+fetchtime_quantile(const uint_fast32_t *counts, uint64_t total,
+		   unsigned int permille) {
+	uint64_t want = (total * permille + 999) / 1000;
+	uint64_t seen = 0;
+
+	for (size_t i = 0; i < FETCHTIME_BUCKETS; i++) {
+		uint64_t lo = (i == 0) ? 0 : (1ULL << (i - 1));
+		uint64_t hi = 1ULL << i;
+
+		if (counts[i] > 0 && seen + counts[i] >= want) {
+			return (lo + (hi - lo) * (want - seen) / counts[i]);
+		}
+		seen += counts[i];
+	}
+
+	return (0);
+}
+
+/*
+ * Count the time 'fctx' took in the histogram of fetch times, and
+ * update the FetchTime50 and FetchTime99 statistics from time to time.
+ */
+static void
+fetchtime_count(fetchctx_t *fctx) {
+	dns_resolver_t *res = fctx->res;
+	uint_fast32_t counts[FETCHTIME_BUCKETS];
+	isc_time_t now = isc_time_now();
+	uint64_t ms = isc_time_microdiff(&now, &fctx->start) / US_PER_MS;
+	uint64_t total = 0;
+	uint_fast32_t n;
+	size_t bucket = 0;
+
+	while (bucket < FETCHTIME_BUCKETS - 1 && ms >= (1ULL << bucket)) {
+		bucket++;
+	}
+
+	atomic_fetch_add_relaxed(&res->fetchtimes[bucket], 1);
+	n = atomic_fetch_add_relaxed(&res->nfetchtimes, 1) + 1;
+	if (n % FETCHTIME_UPDATE != 0) {
+		return;
+	}
+
+	for (size_t i = 0; i < FETCHTIME_BUCKETS; i++) {
+		counts[i] = atomic_load_relaxed(&res->fetchtimes[i]);
+		total += counts[i];
+	}
+
+	set_stats(res, dns_resstatscounter_fetchtime50,
+		  fetchtime_quantile(counts, total, 500));
+	set_stats(res, dns_resstatscounter_fetchtime99,
+		  fetchtime_quantile(counts, total, 990));
+
+	/*
+	 * The counts of the fetches that finish while they are halved
+	 * may be lost; that does not matter for the statistics.
+	 */
+	if (n >= FETCHTIME_WINDOW) {
+		for (size_t i = 0; i < FETCHTIME_BUCKETS; i++) {
+			atomic_store_relaxed(&res->fetchtimes[i],
+					     counts[i] / 2);
+		}
+		atomic_store_relaxed(&res->nfetchtimes, n / 2);
+	}
+}
+
 static bool
 fctx__done(fetchctx_t *fctx, isc_result_t result, const char *func,
 	   const char *file, unsigned int line) {
@@ -1702,6 +1820,10 @@ fctx__done(fetchctx_t *fctx, isc_result_t result, const char *func,
 
 	fctx->qmin_warning = ISC_R_SUCCESS;
 
+	if (result != ISC_R_CANCELED && result != ISC_R_SHUTTINGDOWN) {
+		fetchtime_count(fctx);
+	}
+
 	fctx_cancelqueries(fctx, no_response, age_untried);
 	fctx_stoptimer(fctx);
 
@@ -1877,9 +1999,96 @@ fctx_setretryinterval(fetchctx_t *fctx, unsigned int rtt) {
 	isc_time_nowplusinterval(&fctx->next_timeout, &fctx->interval);
 }
 
+/*
+ * Add 'amount' credits for hedged queries, without saving up more than
+ * HEDGE_MAXCREDIT of them.
+ */
+static void
+hedge_credit(dns_resolver_t *res, uint_fast32_t amount) {
+	uint_fast32_t credit = atomic_load_relaxed(&res->hedgecredit);
+	uint_fast32_t next;
+
+	do {
+		next = ISC_MIN(credit + amount, HEDGE_MAXCREDIT);
+		if (next == credit) {
+			return;
+		}
+	} while (!atomic_compare_exchange_weak_relaxed(&res->hedgecredit,
+						       &credit, next));
+}
+
+/*
+ * Earn the credits for hedged queries for a query sent.
+ */
+static void
+hedge_earn(dns_resolver_t *res) {
+	uint_fast32_t budget = atomic_load_relaxed(&res->hedgebudget);
+
+	if (budget == 0) {
+		return;
+	}
+
+	hedge_credit(res, budget);
+}
+
+/*
+ * Spend the credits for a hedged query, if there are enough of them.
+ */
+static bool
+hedge_spend(dns_resolver_t *res) {
+	uint_fast32_t credit = atomic_load_relaxed(&res->hedgecredit);
+
+	do {
+		if (credit < HEDGE_COST) {
+			return (false);
+		}
+	} while (!atomic_compare_exchange_weak_relaxed(
+		&res->hedgecredit, &credit, credit - HEDGE_COST));
+
+	return (true);
+}
+
+static void
+hedge_refund(dns_resolver_t *res) {
+	hedge_credit(res, HEDGE_COST);
+}
+
+/*
+ * Start the timer after which a hedged query is sent to another server,
+ * if hedged queries are enabled and we know the server well enough to
+ * tell that its response is late.  There is no point in hedging once
+ * the query itself is about to time out.
+ */
+static void
+resquery_starthedge(resquery_t *query) {
+	fetchctx_t *fctx = query->fctx;
+	isc_interval_t interval;
+	unsigned int us;
+
+	if (atomic_load_relaxed(&fctx->res->hedgebudget) == 0) {
+		return;
+	}
+
+	us = dns_adb_rttquantile(fctx->adb, query->addrinfo, HEDGE_QUANTILE);
+	if (us == 0) {
+		return;
+	}
+	if (us < HEDGE_MIN_US) {
+		us = HEDGE_MIN_US;
+	}
+	if (us >= (uint64_t)isc_interval_ms(&fctx->interval) * US_PER_MS) {
+		return;
+	}
+
+	isc_interval_set(&interval, us / US_PER_SEC,
+			 (us % US_PER_SEC) * NS_PER_US);
+	isc_timer_create(fctx->loop, resquery_hedge, query, &query->hedgetimer);
+	isc_timer_start(query->hedgetimer, isc_timertype_once, &interval);
+}
+
 static isc_result_t
-fctx_query(fetchctx_t *fctx, dns_adbaddrinfo_t *addrinfo,
-	   unsigned int options) {
+fctx_query(fetchctx_t *fctx, dns_adbaddrinfo_t *addrinfo, unsigned int options,
+	   bool hedge) {
 	isc_result_t result;
 	dns_resolver_t *res = NULL;
 	dns_dns64_t *dns64 = NULL;
@@ -1938,6 +2147,7 @@ fctx_query(fetchctx_t *fctx, dns_adbaddrinfo_t *addrinfo,
 	query = isc_mem_get(fctx->mctx, sizeof(*query));
 	*query = (resquery_t){
 		.options = options,
+		.attributes = hedge ? RESQUERY_ATTR_HEDGE : 0,
 		.addrinfo = addrinfo,
 		.dispatchmgr = res->view->dispatchmgr,
 		.link = ISC_LINK_INITIALIZER,
@@ -2043,9 +2253,22 @@ fctx_query(fetchctx_t *fctx, dns_adbaddrinfo_t *addrinfo,
 		}
 		isc_sockaddr_setport(&addr, 0);
 
-		result = dns_dispatch_createtcp(
-			res->view->dispatchmgr, &addr, &sockaddr,
-			DNS_DISPATCHOPT_UNSHARED, &query->dispatch);
+		/*
+		 * The queries to forwarders can share persistent
+		 * connections; the others get a connection of their own.
+		 */
+		unsigned int forwardconns =
+			atomic_load_relaxed(&res->forwardconns);
+		if (ISFORWARDER(addrinfo) && forwardconns > 0) {
+			result = dns_dispatch_getpooled(
+				res->view->dispatchmgr, &addr, &sockaddr,
+				addrinfo->transport, forwardconns,
+				&query->dispatch);
+		} else {
+			result = dns_dispatch_createtcp(
+				res->view->dispatchmgr, &addr, &sockaddr,
+				DNS_DISPATCHOPT_UNSHARED, &query->dispatch);
+		}
 		if (result != ISC_R_SUCCESS) {
 			goto cleanup_query;
 		}
@@ -2143,6 +2366,13 @@ fctx_query(fetchctx_t *fctx, dns_adbaddrinfo_t *addrinfo,
 		RUNTIME_CHECK(result == ISC_R_SUCCESS);
 	}
 
+	if (!hedge) {
+		hedge_earn(res);
+		if ((query->options & DNS_FETCHOPT_TCP) == 0) {
+			resquery_starthedge(query);
+		}
+	}
+
 	return (result);
 
 cleanup_udpfetch:
@@ -4121,7 +4351,7 @@ fctx_try(fetchctx_t *fctx, bool retrying, bool badcache) {
 		goto done;
 	}
 
-	result = fctx_query(fctx, addrinfo, fctx->options);
+	result = fctx_query(fctx, addrinfo, fctx->options, false);
 	if (result != ISC_R_SUCCESS) {
 		goto done;
 	}
@@ -4135,6 +4365,103 @@ done:
 	}
 }
 
+/*
+ * Find an address for a hedged query.  While forwarding, only the
+ * forwarders are used; fctx_nextaddress() would move on to the
+ * authoritative servers when they run out.
+ */
+static dns_adbaddrinfo_t *
+fctx_hedgeaddress(fetchctx_t *fctx) {
+	dns_adbaddrinfo_t *addrinfo = NULL;
+
+	if (!fctx->forwarding) {
+		addrinfo = fctx_nextaddress(fctx);
+		while (addrinfo != NULL &&
+		       dns_adb_overquota(fctx->adb, addrinfo))
+		{
+			addrinfo = fctx_nextaddress(fctx);
+		}
+		return (addrinfo);
+	}
+
+	for (addrinfo = ISC_LIST_HEAD(fctx->forwaddrs); addrinfo != NULL;
+	     addrinfo = ISC_LIST_NEXT(addrinfo, publink))
+	{
+		if (!UNMARKED(addrinfo)) {
+			continue;
+		}
+		possibly_mark(fctx, addrinfo);
+		if (UNMARKED(addrinfo) &&
+		    !dns_adb_overquota(fctx->adb, addrinfo))
+		{
+			addrinfo->flags |= FCTX_ADDRINFO_MARK;
+			return (addrinfo);
+		}
+	}
+
+	return (NULL);
+}
+
+/*
+ * The response to 'query' is late: send the same query to another
+ * server, without canceling this one, and use whichever response
+ * comes first.  This is only done while 'query' is the only one
+ * outstanding for the fetch, and within the budget.
+ */
+static void
+resquery_hedge(void *arg) {
+	resquery_t *query = (resquery_t *)arg;
+	fetchctx_t *fctx = NULL;
+	dns_resolver_t *res = NULL;
+	dns_adbaddrinfo_t *addrinfo = NULL;
+	isc_result_t result;
+	bool hedge;
+
+	REQUIRE(VALID_QUERY(query));
+	fctx = query->fctx;
+	REQUIRE(VALID_FCTX(fctx));
+	REQUIRE(fctx->tid == isc_tid());
+
+	res = fctx->res;
+
+	isc_timer_destroy(&query->hedgetimer);
+
+	LOCK(&fctx->lock);
+	hedge = fctx->state == fetchstate_active && !SHUTTINGDOWN(fctx) &&
+		!ADDRWAIT(fctx) && !ISC_LIST_EMPTY(fctx->resps) &&
+		ISC_LIST_EMPTY(fctx->validators) &&
+		ISC_LIST_HEAD(fctx->queries) == query &&
+		ISC_LIST_NEXT(query, link) == NULL;
+	UNLOCK(&fctx->lock);
+
+	if (!hedge) {
+		return;
+	}
+
+	if (!hedge_spend(res)) {
+		inc_stats(res, dns_resstatscounter_hedgeoverbudget);
+		return;
+	}
+
+	addrinfo = fctx_hedgeaddress(fctx);
+	if (addrinfo == NULL ||
+	    isc_counter_increment(fctx->qc) != ISC_R_SUCCESS)
+	{
+		hedge_refund(res);
+		return;
+	}
+
+	FCTXTRACE("hedge");
+
+	result = fctx_query(fctx, addrinfo, fctx->options, true);
+	if (result != ISC_R_SUCCESS) {
+		hedge_refund(res);
+		return;
+	}
+
+	inc_stats(res, dns_resstatscounter_hedged);
+}
+
 static void
 resume_qmin(void *arg) {
 	dns_fetchresponse_t *resp = (dns_fetchresponse_t *)arg;
@@ -4302,6 +4629,16 @@ cleanup:
 	fetchctx_detach(&fctx);
 }
 
+static void
+fctx_destroy_rcu(struct rcu_head *rcu_head) {
+	fetchctx_t *fctx = caa_container_of(rcu_head, fetchctx_t, rcu_head);
+
+	isc_mutex_destroy(&fctx->lock);
+
+	isc_mem_free(fctx->mctx, fctx->info);
+	isc_mem_putanddetach(&fctx->mctx, fctx, sizeof(*fctx));
+}
+
 static void
 fctx_destroy(fetchctx_t *fctx) {
 	dns_resolver_t *res = NULL;
@@ -4360,10 +4697,11 @@ fctx_destroy(fetchctx_t *fctx) {
 
 	dns_resolver_detach(&fctx->res);
 
-	isc_mutex_destroy(&fctx->lock);
-
-	isc_mem_free(fctx->mctx, fctx->info);
-	isc_mem_putanddetach(&fctx->mctx, fctx, sizeof(*fctx));
+	/*
+	 * get_attached_fctx() may still be looking at the fctx it has
+	 * found in the table just before it was released.
+	 */
+	call_rcu(&fctx->rcu_head, fctx_destroy_rcu);
 }
 
 static void
@@ -7003,9 +7341,10 @@ fctx_hash(fetchctx_t *fctx) {
 	return (isc_hash32_finalize(&hash32));
 }
 
-static bool
-fctx_match(void *node, const void *key) {
-	const fetchctx_t *fctx0 = node;
+static int
+fctx_match(struct cds_lfht_node *ht_node, const void *key) {
+	const fetchctx_t *fctx0 = caa_container_of(ht_node, fetchctx_t,
+						   ht_node);
 	const fetchctx_t *fctx1 = key;
 
 	return (fctx0->options == fctx1->options &&
@@ -7016,19 +7355,14 @@ fctx_match(void *node, const void *key) {
 /* Must be fctx locked */
 static void
 release_fctx(fetchctx_t *fctx) {
-	isc_result_t result;
-	dns_resolver_t *res = fctx->res;
-
 	if (!fctx->hashed) {
 		return;
 	}
 
-	RWLOCK(&res->fctxs_lock, isc_rwlocktype_write);
-	result = isc_hashmap_delete(res->fctxs, fctx_hash(fctx), match_ptr,
-				    fctx);
-	INSIST(result == ISC_R_SUCCESS);
+	rcu_read_lock();
+	INSIST(!cds_lfht_del(fctx->res->fctxs, &fctx->ht_node));
+	rcu_read_unlock();
 	fctx->hashed = false;
-	RWUNLOCK(&res->fctxs_lock, isc_rwlocktype_write);
 }
 
 static void
@@ -7354,6 +7688,10 @@ resquery_response(isc_result_t eresult, isc_region_t *region, void *arg) {
 	fctx->timeout = false;
 	fctx->timeouts = 0;
 
+	if (RESQUERY_HEDGE(query)) {
+		inc_stats(fctx->res, dns_resstatscounter_hedgeanswered);
+	}
+
 	/*
 	 * Check whether the dispatcher has failed; if so we're done
 	 */
@@ -9507,6 +9845,20 @@ rctx_nextserver(respctx_t *rctx, dns_message_t *message,
 		fctx_cancelqueries(fctx, true, false);
 		fctx_cleanup(fctx);
 		retrying = false;
+	} else {
+		bool pending;
+
+		/*
+		 * If another query, such as a hedged one, is still
+		 * outstanding, wait for its response instead.
+		 */
+		LOCK(&fctx->lock);
+		pending = !ISC_LIST_EMPTY(fctx->queries);
+		UNLOCK(&fctx->lock);
+		if (pending) {
+			FCTXTRACE("waiting for another query");
+			return;
+		}
 	}
 
 	/*
@@ -9530,7 +9882,7 @@ rctx_resend(respctx_t *rctx, dns_adbaddrinfo_t *addrinfo) {
 
 	FCTXTRACE("resend");
 	inc_stats(fctx->res, dns_resstatscounter_retry);
-	result = fctx_query(fctx, addrinfo, rctx->retryopts);
+	result = fctx_query(fctx, addrinfo, rctx->retryopts, false);
 	if (result != ISC_R_SUCCESS) {
 		fctx_done_detach(&rctx->fctx, result);
 	}
@@ -9914,13 +10266,9 @@ dns_resolver__destroy(dns_resolver_t *res) {
 	isc_mutex_destroy(&res->primelock);
 	isc_mutex_destroy(&res->lock);
 
-	INSIST(isc_hashmap_count(res->fctxs) == 0);
-	isc_hashmap_destroy(&res->fctxs);
-	isc_rwlock_destroy(&res->fctxs_lock);
-
-	INSIST(isc_hashmap_count(res->counters) == 0);
-	isc_hashmap_destroy(&res->counters);
-	isc_rwlock_destroy(&res->counters_lock);
+	/* The tables must be empty by now */
+	RUNTIME_CHECK(!cds_lfht_destroy(res->fctxs, NULL));
+	RUNTIME_CHECK(!cds_lfht_destroy(res->counters, NULL));
 
 	if (res->dispatches4 != NULL) {
 		dns_dispatchset_destroy(&res->dispatches4);
@@ -10031,11 +10379,15 @@ dns_resolver_create(dns_view_t *view, isc_loopmgr_t *loopmgr, isc_nm_t *nm,
 
 	res->badcache = dns_badcache_new(res->mctx);
 
-	isc_hashmap_create(view->mctx, RES_DOMAIN_HASH_BITS, &res->fctxs);
-	isc_rwlock_init(&res->fctxs_lock);
+	res->fctxs = cds_lfht_new(RES_HASH_INIT_SIZE, RES_HASH_MIN_SIZE, 0,
+				  CDS_LFHT_AUTO_RESIZE | CDS_LFHT_ACCOUNTING,
+				  NULL);
+	INSIST(res->fctxs != NULL);
 
-	isc_hashmap_create(view->mctx, RES_DOMAIN_HASH_BITS, &res->counters);
-	isc_rwlock_init(&res->counters_lock);
+	res->counters = cds_lfht_new(RES_HASH_INIT_SIZE, RES_HASH_MIN_SIZE, 0,
+				     CDS_LFHT_AUTO_RESIZE | CDS_LFHT_ACCOUNTING,
+				     NULL);
+	INSIST(res->counters != NULL);
 
 	if (dispatchv4 != NULL) {
 		dns_dispatchset_create(res->mctx, dispatchv4, &res->dispatches4,
@@ -10182,7 +10534,6 @@ dns_resolver_freeze(dns_resolver_t *res) {
 
 void
 dns_resolver_shutdown(dns_resolver_t *res) {
-	isc_result_t result;
 	bool is_false = false;
 
 	REQUIRE(VALID_RESOLVER(res));
@@ -10190,26 +10541,22 @@ dns_resolver_shutdown(dns_resolver_t *res) {
 	RTRACE("shutdown");
 
 	if (atomic_compare_exchange_strong(&res->exiting, &is_false, true)) {
-		isc_hashmap_iter_t *it = NULL;
+		struct cds_lfht_iter iter;
+		fetchctx_t *fctx = NULL;
 
 		RTRACE("exiting");
 
-		RWLOCK(&res->fctxs_lock, isc_rwlocktype_write);
-		isc_hashmap_iter_create(res->fctxs, &it);
-		for (result = isc_hashmap_iter_first(it);
-		     result == ISC_R_SUCCESS;
-		     result = isc_hashmap_iter_next(it))
-		{
-			fetchctx_t *fctx = NULL;
-
-			isc_hashmap_iter_current(it, (void **)&fctx);
-			INSIST(fctx != NULL);
-
-			fetchctx_ref(fctx);
-			isc_async_run(fctx->loop, fctx_shutdown, fctx);
+		rcu_read_lock();
+		cds_lfht_for_each_entry(res->fctxs, &iter, fctx, ht_node) {
+			/* Skip the fctxs that are being released */
+			LOCK(&fctx->lock);
+			if (fctx->hashed) {
+				fetchctx_ref(fctx);
+				isc_async_run(fctx->loop, fctx_shutdown, fctx);
+			}
+			UNLOCK(&fctx->lock);
 		}
-		isc_hashmap_iter_destroy(&it);
-		RWUNLOCK(&res->fctxs_lock, isc_rwlocktype_write);
+		rcu_read_unlock();
 
 		LOCK(&res->lock);
 		if (res->spillattimer != NULL) {
@@ -10363,64 +10710,64 @@ get_attached_fctx(dns_resolver_t *res, isc_loop_t *loop, const dns_name_t *name,
 		.type = type,
 	};
 	fetchctx_t *fctx = NULL;
-	isc_rwlocktype_t locktype = isc_rwlocktype_read;
+	struct cds_lfht_iter iter;
+	struct cds_lfht_node *ht_node = NULL;
 	uint32_t hashval = fctx_hash(&key);
 
 again:
-	RWLOCK(&res->fctxs_lock, locktype);
-	result = isc_hashmap_find(res->fctxs, hashval, fctx_match, &key,
-				  (void **)&fctx);
-	switch (result) {
-	case ISC_R_SUCCESS:
-		break;
-	case ISC_R_NOTFOUND:
+	rcu_read_lock();
+	cds_lfht_lookup(res->fctxs, hashval, fctx_match, &key, &iter);
+	ht_node = cds_lfht_iter_get_node(&iter);
+	if (ht_node == NULL) {
 		result = fctx_create(res, loop, name, type, domain, nameservers,
 				     client, options, depth, qc, &fctx);
 		if (result != ISC_R_SUCCESS) {
-			goto unlock;
+			rcu_read_unlock();
+			return (result);
 		}
 
-		UPGRADELOCK(&res->fctxs_lock, locktype);
-
-		void *found = NULL;
-		result = isc_hashmap_add(res->fctxs, hashval, fctx_match, fctx,
-					 fctx, &found);
-		if (result == ISC_R_SUCCESS) {
+		fctx->hashed = true;
+		ht_node = cds_lfht_add_unique(res->fctxs, hashval, fctx_match,
+					      fctx, &fctx->ht_node);
+		if (ht_node == &fctx->ht_node) {
 			*new_fctx = true;
-			fctx->hashed = true;
 		} else {
-			fctx_done_detach(&fctx, result);
-			fctx = found;
-			result = ISC_R_SUCCESS;
+			/* Another fetch has added the same fctx first */
+			fctx->hashed = false;
+			fctx_done_detach(&fctx, ISC_R_EXISTS);
 		}
-		INSIST(result == ISC_R_SUCCESS);
-		break;
-	default:
-		UNREACHABLE();
 	}
-	fetchctx_ref(fctx);
-unlock:
-	RWUNLOCK(&res->fctxs_lock, locktype);
-	if (result == ISC_R_SUCCESS) {
-		LOCK(&fctx->lock);
-		if (SHUTTINGDOWN(fctx) || fctx->cloned) {
-			/*
-			 * This is the single place where fctx might get
-			 * accesses from a different thread, so we need to
-			 * double check whether fctxs is done (or cloned) and
-			 * help with the release if the fctx has been cloned.
-			 */
-			release_fctx(fctx);
-			UNLOCK(&fctx->lock);
-			fetchctx_detach(&fctx);
-			goto again;
-		}
+	fctx = caa_container_of(ht_node, fetchctx_t, ht_node);
 
-		INSIST(!SHUTTINGDOWN(fctx));
-		*fctxp = fctx;
+	/*
+	 * Until the fctx is released from the table, which is done under
+	 * its lock, it holds the reference it was created with, so it is
+	 * safe to take another one.  The fctx is returned locked.
+	 */
+	LOCK(&fctx->lock);
+	if (!fctx->hashed) {
+		UNLOCK(&fctx->lock);
+		rcu_read_unlock();
+		goto again;
+	}
+	if (SHUTTINGDOWN(fctx) || fctx->cloned) {
+		/*
+		 * This is the single place where fctx might get
+		 * accesses from a different thread, so we need to
+		 * double check whether fctxs is done (or cloned) and
+		 * help with the release if the fctx has been cloned.
+		 */
+		release_fctx(fctx);
+		UNLOCK(&fctx->lock);
+		rcu_read_unlock();
+		goto again;
 	}
 
-	return (result);
+	fetchctx_ref(fctx);
+	rcu_read_unlock();
+	*fctxp = fctx;
+
+	return (ISC_R_SUCCESS);
 }
 
 isc_result_t
@@ -10916,6 +11263,39 @@ dns_resolver_settimeout(dns_resolver_t *resolver, unsigned int timeout) {
 	resolver->query_timeout = timeout;
 }
 
+void
+dns_resolver_sethedgebudget(dns_resolver_t *resolver, unsigned int percent) {
+	REQUIRE(VALID_RESOLVER(resolver));
+
+	if (percent > 100) {
+		percent = 100;
+	}
+
+	atomic_store_relaxed(&resolver->hedgebudget, percent);
+}
+
+unsigned int
+dns_resolver_gethedgebudget(dns_resolver_t *resolver) {
+	REQUIRE(VALID_RESOLVER(resolver));
+
+	return (atomic_load_relaxed(&resolver->hedgebudget));
+}
+
+void
+dns_resolver_setforwardconnections(dns_resolver_t *resolver,
+				   unsigned int conns) {
+	REQUIRE(VALID_RESOLVER(resolver));
+
+	atomic_store_relaxed(&resolver->forwardconns, conns);
+}
+
+unsigned int
+dns_resolver_getforwardconnections(dns_resolver_t *resolver) {
+	REQUIRE(VALID_RESOLVER(resolver));
+
+	return (atomic_load_relaxed(&resolver->forwardconns));
+}
+
 void
 dns_resolver_setmaxvalidations(dns_resolver_t *resolver, uint32_t max) {
 	REQUIRE(VALID_RESOLVER(resolver));
@@ -10955,35 +11335,37 @@ dns_resolver_getmaxqueries(dns_resolver_t *resolver) {
 void
 dns_resolver_dumpfetches(dns_resolver_t *res, isc_statsformat_t format,
 			 FILE *fp) {
-	isc_result_t result;
-	isc_hashmap_iter_t *it = NULL;
+	struct cds_lfht_iter iter;
+	fctxcount_t *counter = NULL;
 
 	REQUIRE(VALID_RESOLVER(res));
 	REQUIRE(fp != NULL);
 	REQUIRE(format == isc_statsformat_file);
 
-	RWLOCK(&res->counters_lock, isc_rwlocktype_read);
-	isc_hashmap_iter_create(res->counters, &it);
-	for (result = isc_hashmap_iter_first(it); result == ISC_R_SUCCESS;
-	     result = isc_hashmap_iter_next(it))
-	{
-		fctxcount_t *counter = NULL;
-		isc_hashmap_iter_current(it, (void **)&counter);
+	rcu_read_lock();
+	cds_lfht_for_each_entry(res->counters, &iter, counter, ht_node) {
+		uint_fast32_t count, dropped, allowed;
+
+		LOCK(&counter->lock);
+		count = counter->count;
+		dropped = counter->dropped;
+		allowed = counter->allowed;
+		UNLOCK(&counter->lock);
 
 		dns_name_print(counter->domain, fp);
 		fprintf(fp,
 			": %" PRIuFAST32 " active (%" PRIuFAST32
 			" spilled, %" PRIuFAST32 " allowed)\n",
-			counter->count, counter->dropped, counter->allowed);
+			count, dropped, allowed);
 	}
-	RWUNLOCK(&res->counters_lock, isc_rwlocktype_read);
-	isc_hashmap_iter_destroy(&it);
+	rcu_read_unlock();
 }
 
 isc_result_t
 dns_resolver_dumpquota(dns_resolver_t *res, isc_buffer_t **buf) {
-	isc_result_t result;
-	isc_hashmap_iter_t *it = NULL;
+	isc_result_t result = ISC_R_SUCCESS;
+	struct cds_lfht_iter iter;
+	fctxcount_t *counter = NULL;
 	uint_fast32_t spill;
 
 	REQUIRE(VALID_RESOLVER(res));
@@ -10993,18 +11375,12 @@ dns_resolver_dumpquota(dns_resolver_t *res, isc_buffer_t **buf) {
 		return (ISC_R_SUCCESS);
 	}
 
-	RWLOCK(&res->counters_lock, isc_rwlocktype_read);
-	isc_hashmap_iter_create(res->counters, &it);
-	for (result = isc_hashmap_iter_first(it); result == ISC_R_SUCCESS;
-	     result = isc_hashmap_iter_next(it))
-	{
-		fctxcount_t *counter = NULL;
+	rcu_read_lock();
+	cds_lfht_for_each_entry(res->counters, &iter, counter, ht_node) {
 		uint_fast32_t count, dropped, allowed;
 		char nb[DNS_NAME_FORMATSIZE];
 		char text[DNS_NAME_FORMATSIZE + BUFSIZ];
 
-		isc_hashmap_iter_current(it, (void **)&counter);
-
 		LOCK(&counter->lock);
 		count = counter->count;
 		dropped = counter->dropped;
@@ -11027,13 +11403,9 @@ dns_resolver_dumpquota(dns_resolver_t *res, isc_buffer_t **buf) {
 		}
 		isc_buffer_putstr(*buf, text);
 	}
-	if (result == ISC_R_NOMORE) {
-		result = ISC_R_SUCCESS;
-	}
 
 cleanup:
-	RWUNLOCK(&res->counters_lock, isc_rwlocktype_read);
-	isc_hashmap_iter_destroy(&it);
+	rcu_read_unlock();
 	return (result);
 }
 
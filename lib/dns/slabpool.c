@@ -0,0 +1,275 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*! \file */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <isc/atomic.h>
+#include <isc/hash.h>
+#include <isc/hashmap.h>
+#include <isc/magic.h>
+#include <isc/mem.h>
+#include <isc/mutex.h>
+#include <isc/refcount.h>
+#include <isc/util.h>
+
+#include <dns/rdataset.h>
+#include <dns/rdataslab.h>
+#include <dns/slabpool.h>
+
+#define SLABPOOL_MAGIC	  ISC_MAGIC('S', 'l', 'b', 'P')
+#define VALID_SLABPOOL(p) ISC_MAGIC_VALID(p, SLABPOOL_MAGIC)
+
+/*
+ * The pool is split into shards by the hash value, so that the zones
+ * loading in parallel do not all wait for the same lock.
+ */
+#define SLABPOOL_SHARDS 16
+
+/*
+ * The unused rdataslabs are swept from a shard when the number of its
+ * entries reaches a threshold, which is then set to twice the number
+ * of entries left, but never less than SLABPOOL_SWEEP_MIN.
+ */
+#define SLABPOOL_SWEEP_MIN 1024
+
+#define SLABPOOL_HASH_BITS 10
+
+typedef struct slabpool_shard {
+	isc_mutex_t lock;
+	isc_hashmap_t *table;
+	unsigned int sweep;
+} slabpool_shard_t;
+
+struct dns_slabpool {
+	unsigned int magic;
+	isc_mem_t *mctx;
+	isc_refcount_t references;
+	slabpool_shard_t shards[SLABPOOL_SHARDS];
+	atomic_uint_fast64_t bytes; /* of the rdataslabs in the pool */
+	atomic_uint_fast64_t lookups;
+	atomic_uint_fast64_t hits;
+};
+
+typedef struct slabpool_key {
+	const unsigned char *raw;
+	unsigned int size;
+} slabpool_key_t;
+
+static unsigned char *
+shared_raw(dns_slabshared_t *shared) {
+	return ((unsigned char *)(shared + 1));
+}
+
+static unsigned int
+shared_rawsize(dns_slabshared_t *shared) {
+	return (dns_slabshared_size(shared) - sizeof(*shared));
+}
+
+/*
+ * The rdataslabs are only interchangeable when they are identical byte
+ * for byte: dns_rdataslab_equal() would also match the RRsets with the
+ * same records in a different order, which matters for the zones with
+ * 'rrset-order fixed'.
+ */
+static bool
+slabpool_match(void *node, const void *key) {
+	dns_slabshared_t *shared = node;
+	const slabpool_key_t *k = key;
+
+	return (shared_rawsize(shared) == k->size &&
+		memcmp(shared_raw(shared), k->raw, k->size) == 0);
+}
+
+void
+dns_slabpool_create(isc_mem_t *mctx, dns_slabpool_t **poolp) {
+	dns_slabpool_t *pool = NULL;
+
+	REQUIRE(poolp != NULL && *poolp == NULL);
+
+	pool = isc_mem_get(mctx, sizeof(*pool));
+	*pool = (dns_slabpool_t){
+		.references = ISC_REFCOUNT_INITIALIZER(1),
+		.magic = SLABPOOL_MAGIC,
+	};
+	for (size_t i = 0; i < SLABPOOL_SHARDS; i++) {
+		slabpool_shard_t *shard = &pool->shards[i];
+
+		isc_mutex_init(&shard->lock);
+		isc_hashmap_create(mctx, SLABPOOL_HASH_BITS, &shard->table);
+		shard->sweep = SLABPOOL_SWEEP_MIN;
+	}
+	isc_mem_attach(mctx, &pool->mctx);
+
+	*poolp = pool;
+}
+
+/*
+ * Remove the rdataslabs only referenced by the pool from 'shard'.
+ * The shard must be locked; as nobody else has a reference to these
+ * rdataslabs, nobody can get one without taking the lock first.
+ */
+static void
+shard_sweep(dns_slabpool_t *pool, slabpool_shard_t *shard, bool all) {
+	isc_hashmap_iter_t *it = NULL;
+	isc_result_t result;
+
+	isc_hashmap_iter_create(shard->table, &it);
+	result = isc_hashmap_iter_first(it);
+	while (result == ISC_R_SUCCESS) {
+		dns_slabshared_t *shared = NULL;
+
+		isc_hashmap_iter_current(it, (void **)&shared);
+		if (all || isc_refcount_current(&shared->references) == 1) {
+			result = isc_hashmap_iter_delcurrent_next(it);
+			atomic_fetch_sub_relaxed(&pool->bytes,
+						 dns_slabshared_size(shared));
+			dns_slabshared_detach(&shared);
+		} else {
+			result = isc_hashmap_iter_next(it);
+		}
+	}
+	isc_hashmap_iter_destroy(&it);
+
+	shard->sweep = ISC_MAX(2 * isc_hashmap_count(shard->table),
+			       SLABPOOL_SWEEP_MIN);
+}
+
+static void
+dns__slabpool_destroy(dns_slabpool_t *pool) {
+	pool->magic = 0;
+	for (size_t i = 0; i < SLABPOOL_SHARDS; i++) {
+		slabpool_shard_t *shard = &pool->shards[i];
+
+		shard_sweep(pool, shard, true);
+		isc_hashmap_destroy(&shard->table);
+		isc_mutex_destroy(&shard->lock);
+	}
+	isc_mem_putanddetach(&pool->mctx, pool, sizeof(*pool));
+}
+
+ISC_REFCOUNT_IMPL(dns_slabpool, dns__slabpool_destroy);
+
+isc_result_t
+dns_slabpool_intern(dns_slabpool_t *pool, dns_rdataset_t *rdataset,
+		    uint32_t maxrrperset, dns_slabshared_t **sharedp) {
+	isc_result_t result;
+	dns_slabshared_t *shared = NULL;
+	dns_slabshared_t *found = NULL;
+	slabpool_shard_t *shard = NULL;
+	slabpool_key_t key;
+	uint32_t hashval;
+
+	REQUIRE(VALID_SLABPOOL(pool));
+	REQUIRE(sharedp != NULL && *sharedp == NULL);
+
+	result = dns_rdataslab_fromrdatasetshared(rdataset, pool->mctx,
+						  maxrrperset, &shared);
+	if (result != ISC_R_SUCCESS) {
+		return (result);
+	}
+
+	key = (slabpool_key_t){
+		.raw = shared_raw(shared),
+		.size = shared_rawsize(shared),
+	};
+	hashval = isc_hash32(key.raw, key.size, true);
+	shard = &pool->shards[hashval % SLABPOOL_SHARDS];
+
+	atomic_fetch_add_relaxed(&pool->lookups, 1);
+
+	LOCK(&shard->lock);
+	result = isc_hashmap_add(shard->table, hashval, slabpool_match, &key,
+				 shared, (void **)&found);
+	if (result == ISC_R_EXISTS) {
+		atomic_fetch_add_relaxed(&pool->hits, 1);
+		dns_slabshared_detach(&shared);
+		dns_slabshared_attach(found, sharedp);
+	} else {
+		INSIST(result == ISC_R_SUCCESS);
+		/* The pool keeps the reference it got from the constructor */
+		dns_slabshared_attach(shared, sharedp);
+		atomic_fetch_add_relaxed(&pool->bytes,
+					 dns_slabshared_size(shared));
+		if (isc_hashmap_count(shard->table) >= shard->sweep) {
+			shard_sweep(pool, shard, false);
+		}
+	}
+	UNLOCK(&shard->lock);
+
+	return (ISC_R_SUCCESS);
+}
+
+void
+dns_slabpool_purge(dns_slabpool_t *pool) {
+	REQUIRE(VALID_SLABPOOL(pool));
+
+	for (size_t i = 0; i < SLABPOOL_SHARDS; i++) {
+		slabpool_shard_t *shard = &pool->shards[i];
+
+		LOCK(&shard->lock);
+		shard_sweep(pool, shard, false);
+		UNLOCK(&shard->lock);
+	}
+}
+
+uint64_t
+dns_slabpool_inuse(dns_slabpool_t *pool) {
+	REQUIRE(VALID_SLABPOOL(pool));
+
+	return (atomic_load_relaxed(&pool->bytes));
+}
+
+void
+dns_slabpool_getstats(dns_slabpool_t *pool, dns_slabpool_stats_t *stats) {
+	REQUIRE(VALID_SLABPOOL(pool));
+	REQUIRE(stats != NULL);
+
+	*stats = (dns_slabpool_stats_t){
+		.lookups = atomic_load_relaxed(&pool->lookups),
+		.hits = atomic_load_relaxed(&pool->hits),
+	};
+
+	for (size_t i = 0; i < SLABPOOL_SHARDS; i++) {
+		slabpool_shard_t *shard = &pool->shards[i];
+		isc_hashmap_iter_t *it = NULL;
+		isc_result_t result;
+
+		LOCK(&shard->lock);
+		isc_hashmap_iter_create(shard->table, &it);
+		for (result = isc_hashmap_iter_first(it);
+		     result == ISC_R_SUCCESS;
+		     result = isc_hashmap_iter_next(it))
+		{
+			dns_slabshared_t *shared = NULL;
+			unsigned int size;
+			uint64_t users;
+
+			isc_hashmap_iter_current(it, (void **)&shared);
+			size = dns_slabshared_size(shared);
+			users = isc_refcount_current(&shared->references) - 1;
+
+			stats->entries++;
+			stats->bytes += size;
+			stats->references += users;
+			if (users > 1) {
+				stats->saved += (users - 1) * size;
+			}
+		}
+		isc_hashmap_iter_destroy(&it);
+		UNLOCK(&shard->lock);
+	}
+}
@@ -53,6 +53,7 @@
 #include <dns/peer.h>
 #include <dns/rbt.h>
 #include <dns/rdataset.h>
+#include <dns/refresher.h>
 #include <dns/request.h>
 #include <dns/resolver.h>
 #include <dns/rpz.h>
@@ -370,6 +371,9 @@ destroy(dns_view_t *view) {
 	if (view->ntatable_priv != NULL) {
 		dns_ntatable_detach(&view->ntatable_priv);
 	}
+	if (view->refresher != NULL) {
+		dns_refresher_detach(&view->refresher);
+	}
 	for (dns64 = ISC_LIST_HEAD(view->dns64); dns64 != NULL;
 	     dns64 = ISC_LIST_HEAD(view->dns64))
 	{
@@ -452,6 +456,7 @@ dns_view_detach(dns_view_t **viewp) {
 		dns_adb_t *adb = NULL;
 		dns_requestmgr_t *requestmgr = NULL;
 		dns_dispatchmgr_t *dispatchmgr = NULL;
+		dns_refresher_t *refresher = NULL;
 
 		isc_refcount_destroy(&view->references);
 
@@ -515,9 +520,17 @@ dns_view_detach(dns_view_t **viewp) {
 		if (view->ntatable_priv != NULL) {
 			dns_ntatable_shutdown(view->ntatable_priv);
 		}
+		if (view->refresher != NULL) {
+			refresher = view->refresher;
+			view->refresher = NULL;
+		}
 		UNLOCK(&view->lock);
 
 		/* Detach outside view lock */
+		if (refresher != NULL) {
+			dns_refresher_shutdown(refresher);
+			dns_refresher_detach(&refresher);
+		}
 		if (resolver != NULL) {
 			dns_resolver_detach(&resolver);
 		}
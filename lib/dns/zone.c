@@ -41,13 +41,17 @@
 #include <isc/thread.h>
 #include <isc/tid.h>
 #include <isc/timer.h>
+#include <isc/timerwheel.h>
 #include <isc/tls.h>
+#include <isc/urcu.h>
 #include <isc/util.h>
+#include <isc/work.h>
 
 #include <dns/acl.h>
 #include <dns/adb.h>
 #include <dns/callbacks.h>
 #include <dns/catz.h>
+#include <dns/compress.h>
 #include <dns/db.h>
 #include <dns/dbiterator.h>
 #include <dns/dlz.h>
@@ -80,6 +84,7 @@
 #include <dns/resolver.h>
 #include <dns/rriterator.h>
 #include <dns/skr.h>
+#include <dns/slabpool.h>
 #include <dns/soa.h>
 #include <dns/ssu.h>
 #include <dns/stats.h>
@@ -123,6 +128,9 @@
 #define KEYFILEIO_MAGIC		  ISC_MAGIC('K', 'y', 'I', 'O')
 #define DNS_KEYFILEIO_VALID(kfio) ISC_MAGIC_VALID(kfio, KEYFILEIO_MAGIC)
 
+#define ZONEPEER_MAGIC		 ISC_MAGIC('Z', 'P', 'e', 'r')
+#define DNS_ZONEPEER_VALID(peer) ISC_MAGIC_VALID(peer, ZONEPEER_MAGIC)
+
 /*%
  * Ensure 'a' is at least 'min' but not more than 'max'.
  */
@@ -167,6 +175,11 @@
 #define DNS_DUMP_DELAY 900 /*%< 15 minutes */
 #endif			   /* ifndef DNS_DUMP_DELAY */
 
+/*%
+ * Resolution of the zone maintenance timers, in milliseconds.
+ */
+#define ZONE_TIMER_TICK 100
+
 typedef struct dns_notify dns_notify_t;
 typedef struct dns_checkds dns_checkds_t;
 typedef struct dns_stub dns_stub_t;
@@ -182,6 +195,8 @@ typedef struct dns_nsfetch dns_nsfetch_t;
 typedef struct dns_keyfetch dns_keyfetch_t;
 typedef struct dns_asyncload dns_asyncload_t;
 typedef struct dns_include dns_include_t;
+typedef struct dns_zonepeer dns_zonepeer_t;
+typedef struct dns_zonepeer_entry dns_zonepeer_entry_t;
 
 #define DNS_ZONE_CHECKLOCK
 #ifdef DNS_ZONE_CHECKLOCK
@@ -273,9 +288,10 @@ struct dns_zone {
 	dns_zonemgr_t *zmgr;
 	ISC_LINK(dns_zone_t) link; /* Used by zmgr. */
 	isc_loop_t *loop;
-	isc_timer_t *timer;
+	isc_timerwheel_entry_t timer;
 	isc_refcount_t irefs;
 	dns_name_t origin;
+	dns_compress_apex_t compressapex;
 	char *masterfile;
 	const FILE *stream;		     /* loading from a stream? */
 	ISC_LIST(dns_include_t) includes;    /* Include files */
@@ -285,6 +301,8 @@ struct dns_zone {
 	const dns_master_style_t *masterstyle;
 	char *journal;
 	int32_t journalsize;
+	dns_dumpopts_t dumpopts;
+	dns_zone_dumpstats_t dumpstats;
 	dns_rdataclass_t rdclass;
 	dns_zonetype_t type;
 	atomic_uint_fast64_t flags;
@@ -357,6 +375,8 @@ struct dns_zone {
 	ISC_LIST(dns_notify_t) notifies;
 	ISC_LIST(dns_checkds_t) checkds_requests;
 	dns_request_t *request;
+	dns_zonepeer_t *refreshpeer;
+	isc_time_t refreshsent; /* when the pipelined SOA query was sent */
 	dns_loadctx_t *loadctx;
 	dns_dumpctx_t *dumpctx;
 	uint32_t maxxfrin;
@@ -424,8 +444,16 @@ struct dns_zone {
 	 */
 	uint32_t signatures;
 	uint32_t nodes;
+	uint32_t signingworkers;
 	dns_rdatatype_t privatetype;
 
+	/*%
+	 * Signing throughput and progress, updated by each quantum.
+	 */
+	dns_zone_signingstats_t signingstats;
+	dns_zone_signingprogress_t *signingprogress;
+	size_t nsigningprogress;
+
 	/*%
 	 * Autosigning/key-maintenance options
 	 */
@@ -614,6 +642,10 @@ struct dns_zonemgr {
 	isc_ratelimiter_t *refreshrl;
 	isc_ratelimiter_t *startupnotifyrl;
 	isc_ratelimiter_t *startuprefreshrl;
+	isc_timerwheel_t **timerwheels;
+	isc_hashmap_t *notifypeers;
+	isc_hashmap_t *refreshpeers;
+	isc_mutex_t peerlock;
 	isc_rwlock_t rwlock;
 	isc_rwlock_t urlock;
 
@@ -621,6 +653,9 @@ struct dns_zonemgr {
 	dns_zonelist_t zones;
 	dns_zonelist_t waiting_for_xfrin;
 	dns_zonelist_t xfrin_in_progress;
+	dns_slabpool_t *slabpool;
+	atomic_bool slabpurge; /* a purge of 'slabpool' is scheduled */
+	struct rcu_head slabpurge_rcu;
 
 	/* Configuration data. */
 	uint32_t transfersin;
@@ -630,6 +665,9 @@ struct dns_zonemgr {
 	unsigned int startupnotifyrate;
 	unsigned int serialqueryrate;
 	unsigned int startupserialqueryrate;
+	/* Written under peerlock. */
+	atomic_uint_fast32_t notifypipeline;
+	atomic_uint_fast32_t serialquerypipeline;
 
 	/* Locked by urlock. */
 	/* LRU cache */
@@ -641,6 +679,45 @@ struct dns_zonemgr {
 	isc_rwlock_t tlsctx_cache_rwlock;
 };
 
+/*%
+ * A SOA query or a NOTIFY waiting to be sent to a zone peer.
+ */
+struct dns_zonepeer_entry {
+	isc_loop_t *loop;
+	isc_job_cb cb;
+	void *cbarg;
+	dns_zonepeer_t *peer;
+	bool canceled;
+	bool batched; /* sent along with other messages to the peer */
+	ISC_LINK(dns_zonepeer_entry_t) link;
+};
+
+/*%
+ * The SOA queries or the NOTIFY messages pipelined to a single remote
+ * server.  The number of messages in flight is limited by a congestion
+ * window, which grows by one message per window of timely responses,
+ * and is halved on a loss or when the round trip time shows the server
+ * is falling behind.
+ */
+struct dns_zonepeer {
+	unsigned int magic;
+	isc_mem_t *mctx;
+	isc_refcount_t references;
+	isc_mutex_t lock;
+	isc_sockaddr_t addr;
+
+	/* Locked by lock. */
+	ISC_LIST(dns_zonepeer_entry_t) queue;
+	unsigned int queued;
+	unsigned int inflight;
+	unsigned int window;
+	unsigned int acked;
+	uint64_t completed;
+	uint64_t failed;
+	uint64_t srtt;
+	uint64_t minrtt;
+};
+
 /*%
  * Hold notify state.
  */
@@ -658,6 +735,8 @@ struct dns_notify {
 	dns_transport_t *transport;
 	ISC_LINK(dns_notify_t) link;
 	isc_rlevent_t *rlevent;
+	dns_zonepeer_entry_t pentry;
+	isc_time_t sent;
 };
 
 typedef enum dns_notify_flags {
@@ -666,6 +745,15 @@ typedef enum dns_notify_flags {
 	DNS_NOTIFY_TCP = 1 << 2,
 } dns_notify_flags_t;
 
+/*%
+ * A refresh SOA query waiting to be sent.
+ */
+struct soaquery {
+	dns_zone_t *zone;
+	isc_rlevent_t *rlevent;
+	dns_zonepeer_entry_t pentry;
+};
+
 /*%
  * Hold checkds state.
  */
@@ -740,6 +828,8 @@ struct dns_signing {
 	uint16_t keyid;
 	bool deleteit;
 	bool done;
+	uint64_t nodes;
+	uint64_t total;
 	ISC_LINK(dns_signing_t) link;
 };
 
@@ -832,6 +922,10 @@ unsigned int dns_zone_mkey_month = MONTH;
 
 #define SEND_BUFFER_SIZE 2048
 
+static void
+zone_timer(void *arg);
+static void
+zone_timer_stop(dns_zone_t *zone);
 static void
 zone_timer_set(dns_zone_t *zone, isc_time_t *next, isc_time_t *now);
 
@@ -959,6 +1053,8 @@ zmgr_resume_xfrs(dns_zonemgr_t *zmgr, bool multi);
 static void
 zonemgr_free(dns_zonemgr_t *zmgr);
 static void
+zonemgr_slabpurge(dns_zonemgr_t *zmgr);
+static void
 rss_post(void *arg);
 
 static isc_result_t
@@ -1183,6 +1279,8 @@ dns_zone_create(dns_zone_t **zonep, isc_mem_t *mctx, unsigned int tid) {
 	isc_stats_create(mctx, &zone->gluecachestats,
 			 dns_gluecachestatscounter_max);
 
+	isc_timerwheel_entryinit(&zone->timer, zone_timer, zone);
+
 	zone->magic = ZONE_MAGIC;
 
 	/* Must be after magic is set. */
@@ -1213,7 +1311,7 @@ zone_free(dns_zone_t *zone) {
 
 	REQUIRE(DNS_ZONE_VALID(zone));
 	REQUIRE(!LOCKED_ZONE(zone));
-	REQUIRE(zone->timer == NULL);
+	REQUIRE(!isc_timerwheel_armed(&zone->timer));
 	REQUIRE(zone->zmgr == NULL);
 
 	isc_refcount_destroy(&zone->references);
@@ -1245,6 +1343,11 @@ zone_free(dns_zone_t *zone) {
 		dns_dbiterator_destroy(&signing->dbiterator);
 		isc_mem_put(zone->mctx, signing, sizeof *signing);
 	}
+	if (zone->signingprogress != NULL) {
+		isc_mem_cput(zone->mctx, zone->signingprogress,
+			     zone->nsigningprogress,
+			     sizeof(zone->signingprogress[0]));
+	}
 	for (nsec3chain = ISC_LIST_HEAD(zone->nsec3chain); nsec3chain != NULL;
 	     nsec3chain = ISC_LIST_HEAD(zone->nsec3chain))
 	{
@@ -1690,6 +1793,7 @@ dns_zone_setorigin(dns_zone_t *zone, const dns_name_t *origin) {
 		dns_name_init(&zone->origin, NULL);
 	}
 	dns_name_dup(origin, zone->mctx, &zone->origin);
+	dns_compress_apexinit(&zone->compressapex, &zone->origin);
 
 	if (zone->strnamerd != NULL) {
 		isc_mem_free(zone->mctx, zone->strnamerd);
@@ -6796,14 +6900,408 @@ failure:
 	return (result);
 }
 
+/*
+ * The RRSIGs of a signing or re-signing quantum are not generated one
+ * by one: sign_a_node() and add_sigs() queue them in a batch, and
+ * signbatch_flush() generates the queued RRSIGs on the zone's loop and
+ * on up to 'workers - 1' threads of the work pool at the same time.
+ * The RRSIGs are then added to the new version of the zone and to the
+ * diff by the zone's loop, in the order they were queued, so only the
+ * cryptography is done in parallel.
+ *
+ * The quantum keeps a version of the zone open, so it cannot be
+ * suspended until the work pool is done without holding off every
+ * other writer of the zone; instead the loop never waits for the work
+ * pool.  The work pool threads sign their own copy of the jobs, and
+ * once the loop runs out of jobs to claim, it generates itself the
+ * RRSIGs the work pool has not finished yet; those threads' results
+ * are then dropped.
+ *
+ * The batch must be flushed before anything looks at the RRSIGs of the
+ * queued RRsets, as those are not in the database yet.
+ */
+#define SIGNBATCH_PERWORKER 16
+
+typedef struct signjob {
+	dns_fixedname_t fname;
+	dns_name_t *name;
+	dns_rdataset_t rdataset;
+	dst_key_t *key;
+	isc_stdtime_t inception;
+	isc_stdtime_t expire;
+	isc_result_t result;
+	dns_rdata_t rdata;
+	unsigned char data[1024];
+} signjob_t;
+
+typedef struct signbatch {
+	dns_zone_t *zone;
+	unsigned int workers;
+	signjob_t *jobs;
+	size_t count;
+	size_t size;
+} signbatch_t;
+
+/*
+ * The state of a job of a flush: whoever moves it out of SIGNJOB_QUEUED
+ * first provides its RRSIG.
+ */
+enum {
+	SIGNJOB_QUEUED = 0,
+	SIGNJOB_OFFLOADED, /* signed by a work pool thread */
+	SIGNJOB_LOCAL,	   /* signed by the zone's loop */
+};
+
+/*
+ * The copy of the jobs of one flush handed to the work pool threads;
+ * it is freed on the zone's loop by the last of the flush and the work
+ * pool threads.
+ */
+typedef struct signrun {
+	isc_mem_t *mctx;
+	isc_refcount_t references;
+	signjob_t *jobs;
+	atomic_uint_fast32_t *states;
+	size_t count;
+	atomic_size_t next;
+} signrun_t;
+
+static unsigned int
+zone_signingworkers(dns_zone_t *zone) {
+	unsigned int nloops;
+
+	if (zone->zmgr == NULL || zone->loop == NULL) {
+		return (1);
+	}
+
+	nloops = isc_loopmgr_nloops(zone->zmgr->loopmgr);
+	if (zone->signingworkers == 0 || zone->signingworkers > nloops) {
+		return (nloops);
+	}
+	return (zone->signingworkers);
+}
+
+static void
+signbatch_init(dns_zone_t *zone, signbatch_t *batch) {
+	unsigned int workers = zone_signingworkers(zone);
+
+	*batch = (signbatch_t){
+		.zone = zone,
+		.workers = workers,
+		.size = SIGNBATCH_PERWORKER * workers,
+	};
+	batch->jobs = isc_mem_cget(zone->mctx, batch->size,
+				   sizeof(batch->jobs[0]));
+}
+
+static void
+signbatch_destroy(signbatch_t *batch) {
+	for (size_t i = 0; i < batch->count; i++) {
+		dns_rdataset_disassociate(&batch->jobs[i].rdataset);
+	}
+	isc_mem_cput(batch->zone->mctx, batch->jobs, batch->size,
+		     sizeof(batch->jobs[0]));
+}
+
+static void
+signjob_copy(signjob_t *source, signjob_t *target) {
+	*target = (signjob_t){
+		.inception = source->inception,
+		.expire = source->expire,
+		.result = ISC_R_UNSET,
+	};
+	target->name = dns_fixedname_initname(&target->fname);
+	dns_name_copy(source->name, target->name);
+	dns_rdataset_init(&target->rdataset);
+	dns_rdataset_clone(&source->rdataset, &target->rdataset);
+	dst_key_attach(source->key, &target->key);
+	dns_rdata_init(&target->rdata);
+}
+
+static void
+signjob_sign(signjob_t *job, isc_mem_t *mctx) {
+	isc_buffer_t buffer;
+
+	isc_buffer_init(&buffer, job->data, sizeof(job->data));
+	job->result = dns_dnssec_sign(job->name, &job->rdataset, job->key,
+				      &job->inception, &job->expire, mctx,
+				      &buffer, &job->rdata);
+}
+
+static signrun_t *
+signrun_new(signbatch_t *batch) {
+	isc_mem_t *mctx = batch->zone->mctx;
+	signrun_t *run = isc_mem_get(mctx, sizeof(*run));
+
+	*run = (signrun_t){
+		.references = ISC_REFCOUNT_INITIALIZER(1),
+		.count = batch->count,
+	};
+	isc_mem_attach(mctx, &run->mctx);
+	run->jobs = isc_mem_cget(mctx, run->count, sizeof(run->jobs[0]));
+	run->states = isc_mem_cget(mctx, run->count, sizeof(run->states[0]));
+	for (size_t i = 0; i < run->count; i++) {
+		signjob_copy(&batch->jobs[i], &run->jobs[i]);
+		atomic_init(&run->states[i], SIGNJOB_QUEUED);
+	}
+
+	return (run);
+}
+
+static void
+signrun_detach(signrun_t **runp) {
+	signrun_t *run = *runp;
+
+	*runp = NULL;
+	if (isc_refcount_decrement(&run->references) == 1) {
+		isc_refcount_destroy(&run->references);
+		for (size_t i = 0; i < run->count; i++) {
+			dns_rdataset_disassociate(&run->jobs[i].rdataset);
+			dst_key_free(&run->jobs[i].key);
+		}
+		isc_mem_cput(run->mctx, run->jobs, run->count,
+			     sizeof(run->jobs[0]));
+		isc_mem_cput(run->mctx, run->states, run->count,
+			     sizeof(run->states[0]));
+		isc_mem_putanddetach(&run->mctx, run, sizeof(*run));
+	}
+}
+
+/*
+ * Move job 'i' of 'run' from SIGNJOB_QUEUED to 'state'.
+ */
+static bool
+signrun_claim(signrun_t *run, size_t i, uint_fast32_t state) {
+	uint_fast32_t queued = SIGNJOB_QUEUED;
+
+	return (atomic_compare_exchange_strong_acq_rel(&run->states[i],
+						       &queued, state));
+}
+
+static void
+signrun_work(void *arg) {
+	signrun_t *run = arg;
+	size_t i;
+
+	while ((i = atomic_fetch_add_relaxed(&run->next, 1)) < run->count) {
+		if (atomic_load_acquire(&run->states[i]) != SIGNJOB_QUEUED) {
+			continue;
+		}
+		signjob_sign(&run->jobs[i], run->mctx);
+		(void)signrun_claim(run, i, SIGNJOB_OFFLOADED);
+	}
+}
+
+static void
+signrun_done(void *arg) {
+	signrun_t *run = arg;
+
+	signrun_detach(&run);
+}
+
+static void
+signstats_increment(dns_zone_t *zone, dst_key_t *key) {
+	dns_stats_t *dnssecsignstats = dns_zone_getdnssecsignstats(zone);
+
+	if (dnssecsignstats != NULL) {
+		/* Generated a new signature. */
+		dns_dnssecsignstats_increment(dnssecsignstats, ID(key),
+					      (uint8_t)ALG(key),
+					      dns_dnssecsignstats_sign);
+		/* This is a refresh. */
+		dns_dnssecsignstats_increment(dnssecsignstats, ID(key),
+					      (uint8_t)ALG(key),
+					      dns_dnssecsignstats_refresh);
+	}
+}
+
+/*
+ * Generate the RRSIG of 'job', or take the one a work pool thread
+ * generated, and add it to 'version' and 'diff'.
+ */
+static isc_result_t
+signbatch_apply(signbatch_t *batch, signrun_t *run, size_t i, dns_db_t *db,
+		dns_dbversion_t *version, dns_diff_t *diff, bool *offloaded) {
+	signjob_t *job = &batch->jobs[i];
+
+	*offloaded = false;
+	if (run != NULL && !signrun_claim(run, i, SIGNJOB_LOCAL) &&
+	    atomic_load_acquire(&run->states[i]) == SIGNJOB_OFFLOADED)
+	{
+		signjob_t *done = &run->jobs[i];
+
+		job->result = done->result;
+		if (job->result == ISC_R_SUCCESS) {
+			isc_region_t r;
+
+			dns_rdata_toregion(&done->rdata, &r);
+			INSIST(r.length <= sizeof(job->data));
+			memmove(job->data, r.base, r.length);
+			r.base = job->data;
+			dns_rdata_fromregion(&job->rdata, done->rdata.rdclass,
+					     done->rdata.type, &r);
+		}
+		*offloaded = true;
+	} else if (job->result == ISC_R_UNSET) {
+		signjob_sign(job, batch->zone->mctx);
+	}
+
+	if (job->result != ISC_R_SUCCESS) {
+		return (job->result);
+	}
+
+	/* XXX inefficient - will cause dataset merging */
+	return (update_one_rr(db, version, diff, DNS_DIFFOP_ADDRESIGN,
+			      job->name, job->rdataset.ttl, &job->rdata));
+}
+
+/*
+ * Generate the queued RRSIGs and add them to 'version' and 'diff'.
+ */
+static isc_result_t
+signbatch_flush(signbatch_t *batch, dns_db_t *db, dns_dbversion_t *version,
+		dns_diff_t *diff) {
+	dns_zone_t *zone = batch->zone;
+	isc_result_t result = ISC_R_SUCCESS;
+	signrun_t *run = NULL;
+	isc_time_t start, finish;
+	uint64_t signatures = 0, offloaded = 0;
+	size_t helpers;
+
+	if (batch->count == 0) {
+		return (ISC_R_SUCCESS);
+	}
+
+	start = isc_time_now();
+
+	helpers = ISC_MIN(batch->workers, batch->count) - 1;
+	if (helpers > 0) {
+		run = signrun_new(batch);
+		for (size_t i = 0; i < helpers; i++) {
+			isc_refcount_increment(&run->references);
+			isc_work_enqueue(zone->loop, signrun_work,
+					 signrun_done, run);
+		}
+	}
+
+	/*
+	 * Do our share of the jobs; the ones claimed by the work pool
+	 * threads that are not done yet by the time they are needed are
+	 * signed here too.
+	 */
+	if (run != NULL) {
+		size_t i;
+
+		while ((i = atomic_fetch_add_relaxed(&run->next, 1)) <
+		       run->count)
+		{
+			if (signrun_claim(run, i, SIGNJOB_LOCAL)) {
+				signjob_sign(&batch->jobs[i], zone->mctx);
+			}
+		}
+	}
+
+	for (size_t i = 0; i < batch->count; i++) {
+		signjob_t *job = &batch->jobs[i];
+		bool used = false;
+
+		if (result == ISC_R_SUCCESS) {
+			result = signbatch_apply(batch, run, i, db, version,
+						 diff, &used);
+			if (result == ISC_R_SUCCESS) {
+				signstats_increment(zone, job->key);
+				signatures++;
+				if (used) {
+					offloaded++;
+				}
+			}
+		} else if (run != NULL) {
+			/* Keep the work pool from signing the rest. */
+			(void)signrun_claim(run, i, SIGNJOB_LOCAL);
+		}
+		dns_rdataset_disassociate(&job->rdataset);
+	}
+
+	if (run != NULL) {
+		signrun_detach(&run);
+	}
+
+	finish = isc_time_now();
+
+	LOCK_ZONE(zone);
+	zone->signingstats.signatures += signatures;
+	zone->signingstats.offloaded += offloaded;
+	zone->signingstats.usecs += isc_time_microdiff(&finish, &start);
+	UNLOCK_ZONE(zone);
+
+	batch->count = 0;
+
+	return (result);
+}
+
+/*
+ * Queue signing 'rdataset' with 'key', flushing the batch first if it
+ * is full.
+ */
+static isc_result_t
+signbatch_add(signbatch_t *batch, dns_db_t *db, dns_dbversion_t *version,
+	      dns_diff_t *diff, dns_name_t *name, dns_rdataset_t *rdataset,
+	      dst_key_t *key, isc_stdtime_t inception, isc_stdtime_t expire) {
+	signjob_t *job = NULL;
+
+	if (batch->count == batch->size) {
+		isc_result_t result = signbatch_flush(batch, db, version, diff);
+		if (result != ISC_R_SUCCESS) {
+			return (result);
+		}
+	}
+
+	job = &batch->jobs[batch->count++];
+	*job = (signjob_t){
+		.key = key,
+		.inception = inception,
+		.expire = expire,
+		.result = ISC_R_UNSET,
+	};
+	job->name = dns_fixedname_initname(&job->fname);
+	dns_name_copy(name, job->name);
+	dns_rdataset_init(&job->rdataset);
+	dns_rdataset_clone(rdataset, &job->rdataset);
+	dns_rdata_init(&job->rdata);
+
+	return (ISC_R_SUCCESS);
+}
+
+/*
+ * Is there a queued RRSIG covering 'type' at 'name'?
+ */
+static bool
+signbatch_pending(signbatch_t *batch, const dns_name_t *name,
+		  dns_rdatatype_t type) {
+	for (size_t i = 0; i < batch->count; i++) {
+		signjob_t *job = &batch->jobs[i];
+
+		if (job->rdataset.type == type &&
+		    dns_name_equal(job->name, name))
+		{
+			return (true);
+		}
+	}
+	return (false);
+}
+
+/*
+ * Sign the 'type' RRset at 'name' with the applicable 'keys'.  If 'batch'
+ * is not NULL, the RRSIGs are queued in it rather than generated and
+ * added right away.
+ */
 static isc_result_t
 add_sigs(dns_db_t *db, dns_dbversion_t *ver, dns_name_t *name, dns_zone_t *zone,
 	 dns_rdatatype_t type, dns_diff_t *diff, dst_key_t **keys,
 	 unsigned int nkeys, isc_mem_t *mctx, isc_stdtime_t now,
-	 isc_stdtime_t inception, isc_stdtime_t expire) {
+	 isc_stdtime_t inception, isc_stdtime_t expire, signbatch_t *batch) {
 	isc_result_t result;
 	dns_dbnode_t *node = NULL;
-	dns_stats_t *dnssecsignstats;
 	dns_rdataset_t rdataset;
 	dns_rdata_t sig_rdata = DNS_RDATA_INIT;
 	unsigned char data[1024]; /* XXX */
@@ -6964,6 +7462,11 @@ add_sigs(dns_db_t *db, dns_dbversion_t *ver, dns_name_t *name, dns_zone_t *zone,
 			}
 			CHECK(dns_skrbundle_getsig(bundle, keys[i], type,
 						   &sig_rdata));
+		} else if (batch != NULL) {
+			CHECK(signbatch_add(batch, db, ver, diff, name,
+					    &rdataset, keys[i], inception,
+					    expire));
+			continue;
 		} else {
 			CHECK(dns_dnssec_sign(name, &rdataset, keys[i],
 					      &inception, &expire, mctx,
@@ -6978,19 +7481,7 @@ add_sigs(dns_db_t *db, dns_dbversion_t *ver, dns_name_t *name, dns_zone_t *zone,
 		isc_buffer_init(&buffer, data, sizeof(data));
 
 		/* Update DNSSEC sign statistics. */
-		dnssecsignstats = dns_zone_getdnssecsignstats(zone);
-		if (dnssecsignstats != NULL) {
-			/* Generated a new signature. */
-			dns_dnssecsignstats_increment(dnssecsignstats,
-						      ID(keys[i]),
-						      (uint8_t)ALG(keys[i]),
-						      dns_dnssecsignstats_sign);
-			/* This is a refresh. */
-			dns_dnssecsignstats_increment(
-				dnssecsignstats, ID(keys[i]),
-				(uint8_t)ALG(keys[i]),
-				dns_dnssecsignstats_refresh);
-		}
+		signstats_increment(zone, keys[i]);
 	}
 
 failure:
@@ -7065,11 +7556,13 @@ zone_resigninc(dns_zone_t *zone) {
 	unsigned int i;
 	unsigned int nkeys = 0;
 	isc_stdtime_t resign;
+	signbatch_t batch;
 
 	ENTER;
 
 	dns_diff_init(zone->mctx, &_sig_diff);
 	zonediff_init(&zonediff, &_sig_diff);
+	signbatch_init(zone, &batch);
 
 	/*
 	 * Zone is frozen. Pause for 5 minutes.
@@ -7135,11 +7628,28 @@ zone_resigninc(dns_zone_t *zone) {
 		/* XXXMPA increase number of RRsets signed pre call */
 		if ((covers == dns_rdatatype_soa &&
 		     dns_name_equal(name, &zone->origin)) ||
-		    i++ > zone->signatures || resign > stop)
+		    i++ > (uint64_t)zone->signatures * batch.workers ||
+		    resign > stop)
 		{
 			break;
 		}
 
+		/*
+		 * The RRset is due again before its queued RRSIGs were
+		 * added (some of its RRSIGs were kept); add them first.
+		 */
+		if (signbatch_pending(&batch, name, covers)) {
+			result = signbatch_flush(&batch, db, version,
+						 zonediff.diff);
+			if (result != ISC_R_SUCCESS) {
+				dns_zone_log(zone, ISC_LOG_ERROR,
+					     "zone_resigninc:signbatch_flush "
+					     "-> %s",
+					     isc_result_totext(result));
+				break;
+			}
+		}
+
 		result = del_sigs(zone, db, version, name, covers, &zonediff,
 				  zone_keys, nkeys, now, true);
 		if (result != ISC_R_SUCCESS) {
@@ -7158,7 +7668,8 @@ zone_resigninc(dns_zone_t *zone) {
 		result = add_sigs(db, version, name, zone, covers,
 				  zonediff.diff, zone_keys, nkeys, zone->mctx,
 				  now, inception,
-				  resign > (now - 300) ? expire : fullexpire);
+				  resign > (now - 300) ? expire : fullexpire,
+				  &batch);
 		if (result != ISC_R_SUCCESS) {
 			dns_zone_log(zone, ISC_LOG_ERROR,
 				     "zone_resigninc:add_sigs -> %s",
@@ -7182,6 +7693,14 @@ zone_resigninc(dns_zone_t *zone) {
 		goto failure;
 	}
 
+	result = signbatch_flush(&batch, db, version, zonediff.diff);
+	if (result != ISC_R_SUCCESS) {
+		dns_zone_log(zone, ISC_LOG_ERROR,
+			     "zone_resigninc:signbatch_flush -> %s",
+			     isc_result_totext(result));
+		goto failure;
+	}
+
 	result = del_sigs(zone, db, version, &zone->origin, dns_rdatatype_soa,
 			  &zonediff, zone_keys, nkeys, now, true);
 	if (result != ISC_R_SUCCESS) {
@@ -7220,7 +7739,7 @@ zone_resigninc(dns_zone_t *zone) {
 	 */
 	result = add_sigs(db, version, &zone->origin, zone, dns_rdatatype_soa,
 			  zonediff.diff, zone_keys, nkeys, zone->mctx, now,
-			  inception, soaexpire);
+			  inception, soaexpire, NULL);
 	if (result != ISC_R_SUCCESS) {
 		dns_zone_log(zone, ISC_LOG_ERROR,
 			     "zone_resigninc:add_sigs -> %s",
@@ -7235,6 +7754,7 @@ zone_resigninc(dns_zone_t *zone) {
 	dns_db_closeversion(db, &version, true);
 
 failure:
+	signbatch_destroy(&batch);
 	dns_diff_clear(&_sig_diff);
 	for (i = 0; i < nkeys; i++) {
 		dst_key_free(&zone_keys[i]);
@@ -7247,6 +7767,7 @@ failure:
 	}
 
 	LOCK_ZONE(zone);
+	zone->signingstats.quanta++;
 	if (result == ISC_R_SUCCESS) {
 		set_resigntime(zone);
 		zone_needdump(zone, DNS_DUMP_DELAY);
@@ -7456,15 +7977,12 @@ sign_a_node(dns_db_t *db, dns_zone_t *zone, dns_name_t *name,
 	    bool build_nsec, dst_key_t *key, isc_stdtime_t now,
 	    isc_stdtime_t inception, isc_stdtime_t expire, dns_ttl_t nsecttl,
 	    bool both, bool is_ksk, bool is_zsk, bool is_bottom_of_zone,
-	    dns_diff_t *diff, int32_t *signatures, isc_mem_t *mctx) {
+	    dns_diff_t *diff, int32_t *signatures, signbatch_t *batch) {
 	isc_result_t result;
 	dns_rdatasetiter_t *iterator = NULL;
 	dns_rdataset_t rdataset;
 	dns_rdata_t rdata = DNS_RDATA_INIT;
-	dns_stats_t *dnssecsignstats;
 	bool offlineksk = false;
-	isc_buffer_t buffer;
-	unsigned char data[1024];
 	bool seen_soa, seen_ns, seen_rr, seen_nsec, seen_nsec3, seen_ds;
 
 	if (zone->kasp != NULL) {
@@ -7480,7 +7998,6 @@ sign_a_node(dns_db_t *db, dns_zone_t *zone, dns_name_t *name,
 	}
 
 	dns_rdataset_init(&rdataset);
-	isc_buffer_init(&buffer, data, sizeof(data));
 	seen_rr = seen_soa = seen_ns = seen_nsec = seen_nsec3 = seen_ds = false;
 	for (result = dns_rdatasetiter_first(iterator); result == ISC_R_SUCCESS;
 	     result = dns_rdatasetiter_next(iterator))
@@ -7572,8 +8089,6 @@ sign_a_node(dns_db_t *db, dns_zone_t *zone, dns_name_t *name,
 			goto next_rdataset;
 		}
 
-		/* Calculate the signature, creating a RRSIG RDATA. */
-		isc_buffer_clear(&buffer);
 		if (offlineksk && dns_rdatatype_iskeymaterial(rdataset.type)) {
 			/* Look up the signature in the SKR bundle */
 			dns_skrbundle_t *bundle = dns_zone_getskrbundle(zone);
@@ -7582,28 +8097,20 @@ sign_a_node(dns_db_t *db, dns_zone_t *zone, dns_name_t *name,
 			}
 			CHECK(dns_skrbundle_getsig(bundle, key, rdataset.type,
 						   &rdata));
-		} else {
-			CHECK(dns_dnssec_sign(name, &rdataset, key, &inception,
-					      &expire, mctx, &buffer, &rdata));
-		}
 
-		/* Update the database and journal with the RRSIG. */
-		/* XXX inefficient - will cause dataset merging */
-		CHECK(update_one_rr(db, version, diff, DNS_DIFFOP_ADDRESIGN,
-				    name, rdataset.ttl, &rdata));
-		dns_rdata_reset(&rdata);
+			/* Update the database and journal with the RRSIG. */
+			/* XXX inefficient - will cause dataset merging */
+			CHECK(update_one_rr(db, version, diff,
+					    DNS_DIFFOP_ADDRESIGN, name,
+					    rdataset.ttl, &rdata));
+			dns_rdata_reset(&rdata);
 
-		/* Update DNSSEC sign statistics. */
-		dnssecsignstats = dns_zone_getdnssecsignstats(zone);
-		if (dnssecsignstats != NULL) {
-			/* Generated a new signature. */
-			dns_dnssecsignstats_increment(dnssecsignstats, ID(key),
-						      ALG(key),
-						      dns_dnssecsignstats_sign);
-			/* This is a refresh. */
-			dns_dnssecsignstats_increment(
-				dnssecsignstats, ID(key), ALG(key),
-				dns_dnssecsignstats_refresh);
+			/* Update DNSSEC sign statistics. */
+			signstats_increment(zone, key);
+		} else {
+			/* Calculate the signature, creating a RRSIG RDATA. */
+			CHECK(signbatch_add(batch, db, version, diff, name,
+					    &rdataset, key, inception, expire));
 		}
 
 		(*signatures)--;
@@ -8213,7 +8720,7 @@ dns__zone_updatesigs(dns_diff_t *diff, dns_db_t *db, dns_dbversion_t *version,
 		}
 		result = add_sigs(db, version, &tuple->name, zone,
 				  tuple->rdata.type, zonediff->diff, zone_keys,
-				  nkeys, zone->mctx, now, inception, exp);
+				  nkeys, zone->mctx, now, inception, exp, NULL);
 		if (result != ISC_R_SUCCESS) {
 			dns_zone_log(zone, ISC_LOG_ERROR,
 				     "dns__zone_updatesigs:add_sigs -> %s",
@@ -8959,7 +9466,7 @@ skip_removals:
 
 	result = add_sigs(db, version, &zone->origin, zone, dns_rdatatype_soa,
 			  zonediff.diff, zone_keys, nkeys, zone->mctx, now,
-			  inception, soaexpire);
+			  inception, soaexpire, NULL);
 	if (result != ISC_R_SUCCESS) {
 		dnssec_log(zone, ISC_LOG_ERROR,
 			   "zone_nsec3chain:add_sigs -> %s",
@@ -9310,6 +9817,52 @@ failure:
  * Incrementally sign the zone using the keys requested.
  * Builds the NSEC chain if required.
  */
+/*
+ * Take a snapshot of the progress of the zone's signings for
+ * dns_zone_signingprogress().
+ */
+static void
+zone_signingprogress_update(dns_zone_t *zone) {
+	dns_signing_t *signing = NULL;
+	size_t n = 0;
+
+	REQUIRE(LOCKED_ZONE(zone));
+
+	for (signing = ISC_LIST_HEAD(zone->signing); signing != NULL;
+	     signing = ISC_LIST_NEXT(signing, link))
+	{
+		n++;
+	}
+
+	if (n != zone->nsigningprogress) {
+		if (zone->signingprogress != NULL) {
+			isc_mem_cput(zone->mctx, zone->signingprogress,
+				     zone->nsigningprogress,
+				     sizeof(zone->signingprogress[0]));
+			zone->signingprogress = NULL;
+		}
+		zone->nsigningprogress = n;
+		if (n > 0) {
+			zone->signingprogress =
+				isc_mem_cget(zone->mctx, n,
+					     sizeof(zone->signingprogress[0]));
+		}
+	}
+
+	n = 0;
+	for (signing = ISC_LIST_HEAD(zone->signing); signing != NULL;
+	     signing = ISC_LIST_NEXT(signing, link))
+	{
+		zone->signingprogress[n++] = (dns_zone_signingprogress_t){
+			.algorithm = signing->algorithm,
+			.keyid = signing->keyid,
+			.deleteit = signing->deleteit,
+			.nodes = ISC_MIN(signing->nodes, signing->total),
+			.total = signing->total,
+		};
+	}
+}
+
 static void
 zone_sign(dns_zone_t *zone) {
 	dns_db_t *db = NULL;
@@ -9340,6 +9893,8 @@ zone_sign(dns_zone_t *zone) {
 	unsigned int i, j;
 	unsigned int nkeys = 0;
 	uint32_t nodes;
+	uint64_t nodesdone = 0;
+	signbatch_t batch;
 
 	ENTER;
 
@@ -9350,6 +9905,7 @@ zone_sign(dns_zone_t *zone) {
 	dns_diff_init(zone->mctx, &post_diff);
 	zonediff_init(&zonediff, &_sig_diff);
 	ISC_LIST_INIT(cleanup);
+	signbatch_init(zone, &batch);
 
 	/*
 	 * Updates are disabled.  Pause for 1 minute.
@@ -9396,10 +9952,12 @@ zone_sign(dns_zone_t *zone) {
 	/*
 	 * We keep pulling nodes off each iterator in turn until
 	 * we have no more nodes to pull off or we reach the limits
-	 * for this quantum.
+	 * for this quantum.  The signatures are generated by several
+	 * workers, so the limits are scaled accordingly.
 	 */
-	nodes = zone->nodes;
-	signatures = zone->signatures;
+	nodes = ISC_MIN((uint64_t)zone->nodes * batch.workers, UINT32_MAX);
+	signatures = ISC_MIN((uint64_t)zone->signatures * batch.workers,
+			     INT32_MAX);
 	signing = ISC_LIST_HEAD(zone->signing);
 	first = true;
 
@@ -9622,7 +10180,7 @@ zone_sign(dns_zone_t *zone) {
 				build_nsec, zone_keys[i], now, inception,
 				expire, zone_nsecttl(zone), both, is_ksk,
 				is_zsk, is_bottom_of_zone, zonediff.diff,
-				&signatures, zone->mctx));
+				&signatures, &batch));
 			/*
 			 * If we are adding we are done.  Look for other keys
 			 * of the same algorithm if deleting.
@@ -9643,6 +10201,8 @@ zone_sign(dns_zone_t *zone) {
 		 */
 	next_node:
 		first = false;
+		signing->nodes++;
+		nodesdone++;
 		dns_db_detachnode(db, &node);
 		do {
 			result = dns_dbiterator_next(signing->dbiterator);
@@ -9650,6 +10210,14 @@ zone_sign(dns_zone_t *zone) {
 				ISC_LIST_UNLINK(zone->signing, signing, link);
 				ISC_LIST_APPEND(cleanup, signing, link);
 				dns_dbiterator_pause(signing->dbiterator);
+				result = signbatch_flush(&batch, db, version,
+							 zonediff.diff);
+				if (result != ISC_R_SUCCESS) {
+					dnssec_log(zone, ISC_LOG_ERROR,
+						   "signbatch_flush -> %s",
+						   isc_result_totext(result));
+					goto cleanup;
+				}
 				if (nkeys != 0 && build_nsec) {
 					/*
 					 * We have finished regenerating the
@@ -9703,10 +10271,19 @@ zone_sign(dns_zone_t *zone) {
 
 	next_signing:
 		dns_dbiterator_pause(signing->dbiterator);
+		CHECK(signbatch_flush(&batch, db, version, zonediff.diff));
 		signing = nextsigning;
 		first = true;
 	}
 
+	result = signbatch_flush(&batch, db, version, zonediff.diff);
+	if (result != ISC_R_SUCCESS) {
+		dnssec_log(zone, ISC_LOG_ERROR,
+			   "zone_sign:signbatch_flush -> %s",
+			   isc_result_totext(result));
+		goto cleanup;
+	}
+
 	if (ISC_LIST_HEAD(post_diff.tuples) != NULL) {
 		result = dns__zone_updatesigs(&post_diff, db, version,
 					      zone_keys, nkeys, zone, inception,
@@ -9755,7 +10332,7 @@ zone_sign(dns_zone_t *zone) {
 	 */
 	result = add_sigs(db, version, &zone->origin, zone, dns_rdatatype_soa,
 			  zonediff.diff, zone_keys, nkeys, zone->mctx, now,
-			  inception, soaexpire);
+			  inception, soaexpire, NULL);
 	if (result != ISC_R_SUCCESS) {
 		dnssec_log(zone, ISC_LOG_ERROR, "zone_sign:add_sigs -> %s",
 			   isc_result_totext(result));
@@ -9833,9 +10410,11 @@ cleanup:
 		ISC_LIST_PREPEND(zone->signing, signing, link);
 		dns_dbiterator_first(signing->dbiterator);
 		dns_dbiterator_pause(signing->dbiterator);
+		signing->nodes = 0;
 		signing = ISC_LIST_HEAD(cleanup);
 	}
 
+	signbatch_destroy(&batch);
 	dns_diff_clear(&_sig_diff);
 	dns_diff_clear(&post_diff);
 
@@ -9855,6 +10434,9 @@ cleanup:
 	}
 
 	LOCK_ZONE(zone);
+	zone->signingstats.nodes += nodesdone;
+	zone->signingstats.quanta++;
+	zone_signingprogress_update(zone);
 	if (ISC_LIST_HEAD(zone->signing) != NULL) {
 		isc_interval_t interval;
 		if (zone->update_disabled || result != ISC_R_SUCCESS) {
@@ -11817,6 +12399,24 @@ dump_done(void *arg, isc_result_t result) {
 	}
 
 	if (zone->dumpctx != NULL) {
+		dns_dumpstats_t stats;
+
+		dns_dumpctx_getstats(zone->dumpctx, &stats);
+		zone->dumpstats.dumps++;
+		if (result != ISC_R_SUCCESS) {
+			zone->dumpstats.failed++;
+		}
+		zone->dumpstats.bytes += stats.bytes;
+		zone->dumpstats.usecs += stats.usecs;
+		zone->dumpstats.lastbytes = stats.bytes;
+		zone->dumpstats.lastusecs = stats.usecs;
+		dns_zone_log(zone, ISC_LOG_DEBUG(1),
+			     "dump_done: %s, %" PRIu64 " bytes in %" PRIu64
+			     " ms, %" PRIu64 " quanta, %" PRIu64 " syncs",
+			     isc_result_totext(result), stats.bytes,
+			     stats.usecs / US_PER_MS, stats.quanta,
+			     stats.syncs);
+
 		dns_dumpctx_detach(&zone->dumpctx);
 	}
 	UNLOCK_ZONE(zone);
@@ -11836,6 +12436,8 @@ zone_dump(dns_zone_t *zone, bool compact) {
 	dns_masterformat_t masterformat = dns_masterformat_none;
 	const dns_master_style_t *masterstyle = NULL;
 	dns_masterrawheader_t rawdata;
+	dns_dumpopts_t dumpopts;
+	bool hasdumpopts;
 
 	/*
 	 * 'compact' MUST only be set if we are loop locked.
@@ -11862,7 +12464,9 @@ redo:
 	} else {
 		masterstyle = &dns_master_style_default;
 	}
+	dumpopts = zone->dumpopts;
 	UNLOCK_ZONE(zone);
+	hasdumpopts = (dumpopts.maxrate != 0 || dumpopts.syncsize != 0);
 	if (db == NULL) {
 		result = DNS_R_NOTLOADED;
 		goto fail;
@@ -11889,7 +12493,7 @@ redo:
 		result = dns_master_dumpasync(
 			zone->mctx, db, version, masterstyle, masterfile,
 			zone->loop, dump_done, zone, &zone->dumpctx,
-			masterformat, &rawdata);
+			masterformat, &rawdata, hasdumpopts ? &dumpopts : NULL);
 
 		UNLOCK_ZONE(zone);
 		if (result != ISC_R_SUCCESS) {
@@ -11993,6 +12597,7 @@ dumptostream(dns_zone_t *zone, FILE *fd, const dns_master_style_t *style,
 		rawdata.flags = DNS_MASTERRAW_SOURCESERIALSET;
 		rawdata.sourceserial = zone->sourceserial;
 	}
+	rawdata.version = rawversion;
 	result = dns_master_dumptostream(zone->mctx, db, version, style, format,
 					 &rawdata, fd);
 	dns_db_closeversion(db, &version, false);
@@ -12100,6 +12705,14 @@ zone_unload(dns_zone_t *zone) {
 	DNS_ZONE_CLRFLAG(zone, DNS_ZONEFLG_LOADED);
 	DNS_ZONE_CLRFLAG(zone, DNS_ZONEFLG_NEEDDUMP);
 
+	/*
+	 * The interned rdataslabs only the unloaded database was using
+	 * can go now.
+	 */
+	if (zone->zmgr != NULL) {
+		zonemgr_slabpurge(zone->zmgr);
+	}
+
 	if (zone->type == dns_zone_mirror) {
 		dns_zone_log(zone, ISC_LOG_INFO,
 			     "mirror zone is no longer in use; "
@@ -12173,6 +12786,280 @@ dns_zone_setmaxtypepername(dns_zone_t *zone, uint32_t val) {
 	}
 }
 
+/*%
+ * Initial congestion window of the messages pipelined to a zone peer.
+ */
+#define ZONEPEER_INITWINDOW 4
+
+/*%
+ * A response that takes this many times the shortest round trip time
+ * seen for the peer so far does not grow the congestion window.
+ */
+#define ZONEPEER_RTTFACTOR 4
+
+static void
+zonepeer_destroy(dns_zonepeer_t *peer) {
+	REQUIRE(ISC_LIST_EMPTY(peer->queue));
+	REQUIRE(peer->inflight == 0);
+
+	peer->magic = 0;
+	isc_mutex_destroy(&peer->lock);
+	isc_mem_putanddetach(&peer->mctx, peer, sizeof(*peer));
+}
+
+ISC_REFCOUNT_STATIC_DECL(dns_zonepeer);
+ISC_REFCOUNT_STATIC_IMPL(dns_zonepeer, zonepeer_destroy);
+
+static bool
+zonepeer_match(void *node, const void *key) {
+	dns_zonepeer_t *peer = node;
+
+	return (isc_sockaddr_equal(&peer->addr, key));
+}
+
+/*
+ * Send as many of the queued messages as the congestion window allows,
+ * each of them on its own loop.  Every message that is sent has to be
+ * accounted for with zonepeer_release() or zonepeer_done().
+ */
+static void
+zonepeer_send(dns_zonepeer_t *peer) {
+	dns_zonepeer_entry_t *entry = NULL;
+
+	while (peer->inflight < peer->window &&
+	       (entry = ISC_LIST_HEAD(peer->queue)) != NULL)
+	{
+		ISC_LIST_UNLINK(peer->queue, entry, link);
+		peer->queued--;
+		peer->inflight++;
+		entry->batched = (peer->inflight > 1 || peer->queued > 0);
+		isc_async_run(entry->loop, entry->cb, entry->cbarg);
+	}
+}
+
+/*
+ * Queue 'entry' for the peer at 'addr' in 'peers', to run 'cb' on 'loop'
+ * once the congestion window of the peer allows, at most '*depthp'
+ * messages at a time.  If the pipelining has been turned off in the
+ * meantime, 'cb' is run right away with the entry canceled.
+ */
+static void
+zonepeer_enqueue(dns_zonemgr_t *zmgr, isc_hashmap_t *peers,
+		 atomic_uint_fast32_t *depthp, const isc_sockaddr_t *addr,
+		 dns_zonepeer_entry_t *entry, isc_loop_t *loop, isc_job_cb cb,
+		 void *cbarg) {
+	isc_result_t result;
+	dns_zonepeer_t *peer = NULL;
+	uint32_t hashval = isc_sockaddr_hash(addr, false);
+	unsigned int depth;
+
+	REQUIRE(entry->peer == NULL);
+
+	*entry = (dns_zonepeer_entry_t){
+		.loop = loop,
+		.cb = cb,
+		.cbarg = cbarg,
+		.link = ISC_LINK_INITIALIZER,
+	};
+
+	LOCK(&zmgr->peerlock);
+	depth = atomic_load_relaxed(depthp);
+	if (depth == 0) {
+		UNLOCK(&zmgr->peerlock);
+		entry->canceled = true;
+		isc_async_run(loop, cb, cbarg);
+		return;
+	}
+	result = isc_hashmap_find(peers, hashval, zonepeer_match, addr,
+				  (void **)&peer);
+	if (result != ISC_R_SUCCESS) {
+		peer = isc_mem_get(zmgr->mctx, sizeof(*peer));
+		*peer = (dns_zonepeer_t){
+			.addr = *addr,
+			.queue = ISC_LIST_INITIALIZER,
+			.window = RANGE(ZONEPEER_INITWINDOW, 1, depth),
+			.magic = ZONEPEER_MAGIC,
+		};
+		isc_mem_attach(zmgr->mctx, &peer->mctx);
+		isc_refcount_init(&peer->references, 1);
+		isc_mutex_init(&peer->lock);
+
+		result = isc_hashmap_add(peers, hashval, zonepeer_match,
+					 &peer->addr, peer, NULL);
+		INSIST(result == ISC_R_SUCCESS);
+	}
+	dns_zonepeer_attach(peer, &entry->peer);
+
+	/*
+	 * Queue the entry before releasing zmgr->peerlock, so that the
+	 * pipelining cannot be turned off after the depth was checked,
+	 * which would leave the entry in a queue that is never sent.
+	 */
+	LOCK(&peer->lock);
+	ISC_LIST_APPEND(peer->queue, entry, link);
+	peer->queued++;
+	zonepeer_send(peer);
+	UNLOCK(&peer->lock);
+	UNLOCK(&zmgr->peerlock);
+}
+
+/*
+ * A pipelined message is no longer in flight.
+ */
+static void
+zonepeer_release(dns_zonepeer_t **peerp) {
+	dns_zonepeer_t *peer = *peerp;
+
+	REQUIRE(DNS_ZONEPEER_VALID(peer));
+
+	LOCK(&peer->lock);
+	INSIST(peer->inflight > 0);
+	peer->inflight--;
+	zonepeer_send(peer);
+	UNLOCK(&peer->lock);
+
+	dns_zonepeer_detach(peerp);
+}
+
+/*
+ * A pipelined message has been answered with 'result' after 'rtt'
+ * microseconds; adapt the congestion window of the peer.  The message
+ * is still in flight.
+ */
+static void
+zonepeer_update(dns_zonepeer_t *peer, isc_result_t result, uint64_t rtt) {
+	REQUIRE(DNS_ZONEPEER_VALID(peer));
+
+	LOCK(&peer->lock);
+	switch (result) {
+	case ISC_R_SUCCESS:
+		peer->completed++;
+		peer->srtt = (peer->srtt == 0) ? rtt
+					       : (peer->srtt * 7 + rtt) / 8;
+		if (peer->minrtt == 0 || rtt < peer->minrtt) {
+			peer->minrtt = rtt;
+		}
+		if (rtt > peer->minrtt * ZONEPEER_RTTFACTOR) {
+			peer->acked = 0;
+		} else if (++peer->acked >= peer->window) {
+			peer->acked = 0;
+			peer->window++;
+		}
+		break;
+	case ISC_R_CANCELED:
+	case ISC_R_SHUTTINGDOWN:
+		break;
+	default:
+		peer->failed++;
+		peer->acked = 0;
+		peer->window = ISC_MAX(peer->window / 2, 1);
+		break;
+	}
+	UNLOCK(&peer->lock);
+}
+
+/*
+ * As zonepeer_update(), and the message is no longer in flight.
+ */
+static void
+zonepeer_done(dns_zonepeer_t **peerp, isc_result_t result, uint64_t rtt) {
+	zonepeer_update(*peerp, result, rtt);
+	zonepeer_release(peerp);
+}
+
+/*
+ * Set the maximum congestion window of the peers in 'peers' to 'depth';
+ * if 'depth' is zero, cancel all the queued messages.
+ */
+static void
+zonepeers_setdepth(dns_zonemgr_t *zmgr, isc_hashmap_t *peers,
+		   atomic_uint_fast32_t *depthp, unsigned int depth) {
+	isc_result_t result;
+	isc_hashmap_iter_t *it = NULL;
+
+	LOCK(&zmgr->peerlock);
+	atomic_store_relaxed(depthp, depth);
+	isc_hashmap_iter_create(peers, &it);
+	for (result = isc_hashmap_iter_first(it); result == ISC_R_SUCCESS;
+	     result = isc_hashmap_iter_next(it))
+	{
+		dns_zonepeer_t *peer = NULL;
+		dns_zonepeer_entry_t *entry = NULL;
+
+		isc_hashmap_iter_current(it, (void **)&peer);
+		LOCK(&peer->lock);
+		peer->window = RANGE(peer->window, 1, depth);
+		while (depth == 0 &&
+		       (entry = ISC_LIST_HEAD(peer->queue)) != NULL)
+		{
+			ISC_LIST_UNLINK(peer->queue, entry, link);
+			peer->queued--;
+			peer->inflight++;
+			entry->canceled = true;
+			isc_async_run(entry->loop, entry->cb, entry->cbarg);
+		}
+		zonepeer_send(peer);
+		UNLOCK(&peer->lock);
+	}
+	isc_hashmap_iter_destroy(&it);
+	UNLOCK(&zmgr->peerlock);
+}
+
+static isc_result_t
+zonepeers_stats(dns_zonemgr_t *zmgr, isc_hashmap_t *peers,
+		dns_zonemgr_peerstats_cb_t cb, void *arg) {
+	isc_result_t result;
+	isc_hashmap_iter_t *it = NULL;
+
+	LOCK(&zmgr->peerlock);
+	isc_hashmap_iter_create(peers, &it);
+	for (result = isc_hashmap_iter_first(it); result == ISC_R_SUCCESS;
+	     result = isc_hashmap_iter_next(it))
+	{
+		dns_zonepeer_t *peer = NULL;
+		dns_zonemgr_peerstats_t stats;
+
+		isc_hashmap_iter_current(it, (void **)&peer);
+		LOCK(&peer->lock);
+		stats = (dns_zonemgr_peerstats_t){
+			.addr = peer->addr,
+			.queued = peer->queued,
+			.inflight = peer->inflight,
+			.window = peer->window,
+			.completed = peer->completed,
+			.failed = peer->failed,
+			.srtt = peer->srtt,
+		};
+		UNLOCK(&peer->lock);
+
+		result = (cb)(&stats, arg);
+		if (result != ISC_R_SUCCESS) {
+			break;
+		}
+	}
+	isc_hashmap_iter_destroy(&it);
+	UNLOCK(&zmgr->peerlock);
+
+	return (result == ISC_R_NOMORE ? ISC_R_SUCCESS : result);
+}
+
+static void
+zonepeers_destroy(isc_hashmap_t **peersp) {
+	isc_result_t result;
+	isc_hashmap_iter_t *it = NULL;
+
+	isc_hashmap_iter_create(*peersp, &it);
+	for (result = isc_hashmap_iter_first(it); result == ISC_R_SUCCESS;
+	     result = isc_hashmap_iter_delcurrent_next(it))
+	{
+		dns_zonepeer_t *peer = NULL;
+		isc_hashmap_iter_current(it, (void **)&peer);
+		dns_zonepeer_detach(&peer);
+	}
+	isc_hashmap_iter_destroy(&it);
+	isc_hashmap_destroy(peersp);
+}
+
 static bool
 notify_isqueued(dns_zone_t *zone, unsigned int flags, dns_name_t *name,
 		isc_sockaddr_t *addr, dns_tsigkey_t *key,
@@ -12313,6 +13200,9 @@ notify_destroy(dns_notify_t *notify, bool locked) {
 	if (notify->transport != NULL) {
 		dns_transport_detach(&notify->transport);
 	}
+	if (notify->pentry.peer != NULL) {
+		zonepeer_release(&notify->pentry.peer);
+	}
 	mctx = notify->mctx;
 	isc_mem_put(notify->mctx, notify, sizeof(*notify));
 	isc_mem_detach(&mctx);
@@ -12418,6 +13308,20 @@ destroy:
 
 static isc_result_t
 notify_send_queue(dns_notify_t *notify, bool startup) {
+	dns_zonemgr_t *zmgr = notify->zone->zmgr;
+
+	/*
+	 * When pipelining, the NOTIFY messages to each secondary are paced
+	 * by its own congestion window rather than by the notify rate.
+	 */
+	if (atomic_load_relaxed(&zmgr->notifypipeline) > 0) {
+		zonepeer_enqueue(zmgr, zmgr->notifypeers, &zmgr->notifypipeline,
+				 &notify->dst, &notify->pentry,
+				 notify->zone->loop, notify_send_toaddr,
+				 notify);
+		return (ISC_R_SUCCESS);
+	}
+
 	return (isc_ratelimiter_enqueue(
 		startup ? notify->zone->zmgr->startupnotifyrl
 			: notify->zone->zmgr->notifyrl,
@@ -12444,7 +13348,8 @@ notify_send_toaddr(void *arg) {
 	isc_sockaddr_format(&notify->dst, addrbuf, sizeof(addrbuf));
 
 	if (DNS_ZONE_FLAG(notify->zone, DNS_ZONEFLG_LOADED) == 0 ||
-	    notify->rlevent->canceled ||
+	    (notify->rlevent != NULL && notify->rlevent->canceled) ||
+	    notify->pentry.canceled ||
 	    DNS_ZONE_FLAG(notify->zone, DNS_ZONEFLG_EXITING) ||
 	    notify->zone->view->requestmgr == NULL || notify->zone->db == NULL)
 	{
@@ -12542,6 +13447,13 @@ notify_send_toaddr(void *arg) {
 		result = ISC_R_NOTIMPLEMENTED;
 		goto cleanup_key;
 	}
+	/*
+	 * A batch of NOTIFY messages to the same secondary shares the TCP
+	 * connection to it instead of a UDP exchange each.
+	 */
+	if (notify->pentry.batched) {
+		notify->flags |= DNS_NOTIFY_TCP;
+	}
 	udptimeout = 5;
 	timeout = 3 * udptimeout + 1;
 again:
@@ -12555,6 +13467,7 @@ again:
 		NULL, NULL, options, key, timeout, udptimeout, 2,
 		notify->zone->loop, notify_done, notify, &notify->request);
 	if (result == ISC_R_SUCCESS) {
+		notify->sent = isc_time_now();
 		if (isc_sockaddr_pf(&notify->dst) == AF_INET) {
 			inc_stats(notify->zone,
 				  dns_zonestatscounter_notifyoutv4);
@@ -14222,10 +15135,59 @@ detach:
 	return;
 }
 
-struct soaquery {
-	dns_zone_t *zone;
-	isc_rlevent_t *rlevent;
-};
+/*
+ * Should the refresh SOA query of 'zone' be pipelined to its primary?
+ * The queries over TLS go through the zone transfer instead.
+ */
+static bool
+zone_pipelinerefresh(dns_zone_t *zone) {
+	REQUIRE(LOCKED_ZONE(zone));
+
+	if (zone->zmgr == NULL ||
+	    atomic_load_relaxed(&zone->zmgr->serialquerypipeline) == 0)
+	{
+		return (false);
+	}
+
+	switch (zone->type) {
+	case dns_zone_secondary:
+	case dns_zone_mirror:
+	case dns_zone_redirect:
+		break;
+	default:
+		return (false);
+	}
+
+	return (dns_remote_tlsname(&zone->primaries) == NULL);
+}
+
+/*
+ * A pipelined SOA query has finished; account for it with the primary
+ * before processing the response.
+ */
+static void
+refresh_pipelined_callback(void *arg) {
+	dns_request_t *request = (dns_request_t *)arg;
+	dns_zone_t *zone = dns_request_getarg(request);
+	dns_zonepeer_t *peer = NULL;
+	isc_time_t now = isc_time_now();
+	isc_time_t sent;
+
+	INSIST(DNS_ZONE_VALID(zone));
+
+	LOCK_ZONE(zone);
+	peer = zone->refreshpeer;
+	zone->refreshpeer = NULL;
+	sent = zone->refreshsent;
+	UNLOCK_ZONE(zone);
+
+	if (peer != NULL) {
+		zonepeer_done(&peer, dns_request_getresult(request),
+			      isc_time_microdiff(&now, &sent));
+	}
+
+	refresh_callback(arg);
+}
 
 static void
 queue_soa_query(dns_zone_t *zone) {
@@ -14253,6 +15215,13 @@ queue_soa_query(dns_zone_t *zone) {
 	 * Attach so that we won't clean up until the event is delivered.
 	 */
 	zone_iattach(zone, &sq->zone);
+	if (zone_pipelinerefresh(zone)) {
+		isc_sockaddr_t curraddr = dns_remote_curraddr(&zone->primaries);
+		zonepeer_enqueue(zone->zmgr, zone->zmgr->refreshpeers,
+				 &zone->zmgr->serialquerypipeline, &curraddr,
+				 &sq->pentry, zone->loop, soa_query, sq);
+		return;
+	}
 	result = isc_ratelimiter_enqueue(zone->zmgr->refreshrl, zone->loop,
 					 soa_query, sq, &sq->rlevent);
 	if (result != ISC_R_SUCCESS) {
@@ -14283,7 +15252,9 @@ soa_query(void *arg) {
 	ENTER;
 
 	LOCK_ZONE(zone);
-	if (sq->rlevent->canceled || DNS_ZONE_FLAG(zone, DNS_ZONEFLG_EXITING) ||
+	if ((sq->rlevent != NULL && sq->rlevent->canceled) ||
+	    sq->pentry.canceled ||
+	    DNS_ZONE_FLAG(zone, DNS_ZONEFLG_EXITING) ||
 	    zone->view->requestmgr == NULL)
 	{
 		if (DNS_ZONE_FLAG(zone, DNS_ZONEFLG_EXITING)) {
@@ -14304,6 +15275,13 @@ again:
 	curraddr = dns_remote_curraddr(&zone->primaries);
 	isc_netaddr_fromsockaddr(&primaryip, &curraddr);
 
+	if (sq->pentry.peer != NULL &&
+	    !isc_sockaddr_equal(&curraddr, &sq->pentry.peer->addr))
+	{
+		/* Moved on to another primary, query it on its own. */
+		zonepeer_release(&sq->pentry.peer);
+	}
+
 	if (isc_sockaddr_disabled(&curraddr)) {
 		goto skip_primary;
 	}
@@ -14436,13 +15414,30 @@ again:
 		}
 	}
 
+	/*
+	 * The pipelined queries share the TCP connection to the primary
+	 * that is already open on this loop.
+	 */
+	if (sq->pentry.peer != NULL) {
+		options |= DNS_REQUESTOPT_TCP;
+	}
+
 	zone_iattach(zone, &(dns_zone_t *){ NULL });
 
+	/*
+	 * The round trip time of a pipelined query is measured from here,
+	 * not from the time it was queued for the primary.
+	 */
+	zone->refreshsent = isc_time_now();
+
 	int timeout = 5;
 	result = dns_request_create(
 		zone->view->requestmgr, message, &zone->sourceaddr, &curraddr,
 		NULL, NULL, options, key, timeout * 3 + 1, timeout, 2,
-		zone->loop, refresh_callback, zone, &zone->request);
+		zone->loop,
+		sq->pentry.peer != NULL ? refresh_pipelined_callback
+					: refresh_callback,
+		zone, &zone->request);
 	if (result != ISC_R_SUCCESS) {
 		zone_idetach(&(dns_zone_t *){ zone });
 		zone_debuglogc(zone, DNS_LOGCATEGORY_XFER_IN, __func__, 1,
@@ -14458,9 +15453,18 @@ again:
 		} else {
 			inc_stats(zone, dns_zonestatscounter_soaoutv6);
 		}
+
+		if (sq->pentry.peer != NULL) {
+			INSIST(zone->refreshpeer == NULL);
+			zone->refreshpeer = sq->pentry.peer;
+			sq->pentry.peer = NULL;
+		}
 	}
 	cancel = false;
 cleanup:
+	if (sq->pentry.peer != NULL) {
+		zonepeer_release(&sq->pentry.peer);
+	}
 	if (transport != NULL) {
 		dns_transport_detach(&transport);
 	}
@@ -14484,7 +15488,9 @@ cleanup:
 	if (do_queue_xfrin) {
 		queue_xfrin(zone);
 	}
-	isc_rlevent_free(&sq->rlevent);
+	if (sq->rlevent != NULL) {
+		isc_rlevent_free(&sq->rlevent);
+	}
 	isc_mem_put(zone->mctx, sq, sizeof(*sq));
 	dns_zone_idetach(&zone);
 	return;
@@ -14840,10 +15846,7 @@ zone_shutdown(void *arg) {
 
 	forward_cancel(zone);
 
-	if (zone->timer != NULL) {
-		isc_refcount_decrement(&zone->irefs);
-		isc_timer_destroy(&zone->timer);
-	}
+	zone_timer_stop(zone);
 
 	/*
 	 * We have now canceled everything set the flag to allow exit_check()
@@ -14889,18 +15892,46 @@ zone_shutdown(void *arg) {
 static void
 zone_timer(void *arg) {
 	dns_zone_t *zone = (dns_zone_t *)arg;
+	bool free_needed;
 
 	REQUIRE(DNS_ZONE_VALID(zone));
 
 	zone_maintenance(zone);
+
+	/* Release the reference held by the expired timer */
+	LOCK_ZONE(zone);
+	isc_refcount_decrement(&zone->irefs);
+	free_needed = exit_check(zone);
+	UNLOCK_ZONE(zone);
+	if (free_needed) {
+		zone_free(zone);
+	}
 }
 
 static void
 zone_timer_stop(dns_zone_t *zone) {
 	zone_debuglog(zone, __func__, 10, "stop zone timer");
-	if (zone->timer != NULL) {
-		isc_timer_stop(zone->timer);
+	if (isc_timerwheel_armed(&zone->timer)) {
+		isc_timerwheel_cancel(&zone->timer);
+		isc_refcount_decrement(&zone->irefs);
+	}
+}
+
+/*
+ * The zone timers are kept on a timer wheel of the zone loop, which is
+ * created the first time it is needed.
+ */
+static isc_timerwheel_t *
+zonemgr_timerwheel(dns_zonemgr_t *zmgr, dns_zone_t *zone) {
+	isc_timerwheel_t **wheelp = &zmgr->timerwheels[zone->tid];
+
+	REQUIRE(zone->tid == isc_tid());
+
+	if (*wheelp == NULL) {
+		isc_timerwheel_create(zone->loop, ZONE_TIMER_TICK, wheelp);
 	}
+
+	return (*wheelp);
 }
 
 static void
@@ -14915,13 +15946,14 @@ zone_timer_set(dns_zone_t *zone, isc_time_t *next, isc_time_t *now) {
 
 	if (zone->loop == NULL) {
 		zone_debuglog(zone, __func__, 10, "zone is not managed");
-	} else if (zone->timer == NULL) {
-		isc_refcount_increment0(&zone->irefs);
-		isc_timer_create(zone->loop, zone_timer, zone, &zone->timer);
+		return;
 	}
-	if (zone->timer != NULL) {
-		isc_timer_start(zone->timer, isc_timertype_once, &interval);
+
+	if (!isc_timerwheel_armed(&zone->timer)) {
+		isc_refcount_increment0(&zone->irefs);
 	}
+	isc_timerwheel_arm(zonemgr_timerwheel(zone->zmgr, zone), &zone->timer,
+			   &interval);
 }
 
 static void
@@ -15694,6 +16726,29 @@ dns_zone_getjournalsize(dns_zone_t *zone) {
 	return (zone->journalsize);
 }
 
+void
+dns_zone_setdumpopts(dns_zone_t *zone, const dns_dumpopts_t *opts) {
+	REQUIRE(DNS_ZONE_VALID(zone));
+
+	LOCK_ZONE(zone);
+	if (opts != NULL) {
+		zone->dumpopts = *opts;
+	} else {
+		zone->dumpopts = (dns_dumpopts_t){ 0 };
+	}
+	UNLOCK_ZONE(zone);
+}
+
+void
+dns_zone_getdumpstats(dns_zone_t *zone, dns_zone_dumpstats_t *stats) {
+	REQUIRE(DNS_ZONE_VALID(zone));
+	REQUIRE(stats != NULL);
+
+	LOCK_ZONE(zone);
+	*stats = zone->dumpstats;
+	UNLOCK_ZONE(zone);
+}
+
 static void
 zone_namerd_tostr(dns_zone_t *zone, char *buf, size_t length) {
 	isc_result_t result = ISC_R_FAILURE;
@@ -16016,6 +17071,16 @@ dns_zone_getorigin(dns_zone_t *zone) {
 	return (&zone->origin);
 }
 
+const dns_compress_apex_t *
+dns_zone_getcompressapex(dns_zone_t *zone) {
+	REQUIRE(DNS_ZONE_VALID(zone));
+
+	if (zone->compressapex.name == NULL) {
+		return (NULL);
+	}
+	return (&zone->compressapex);
+}
+
 void
 dns_zone_setidlein(dns_zone_t *zone, uint32_t idlein) {
 	REQUIRE(DNS_ZONE_VALID(zone));
@@ -16065,6 +17130,15 @@ notify_done(void *arg) {
 			   DNS_MESSAGE_INTENTPARSE, &message);
 
 	result = dns_request_getresult(request);
+	if (notify->pentry.peer != NULL) {
+		/*
+		 * The message stays in flight until the notify is destroyed,
+		 * so that a retry over TCP is still accounted for.
+		 */
+		isc_time_t now = isc_time_now();
+		zonepeer_update(notify->pentry.peer, result,
+				isc_time_microdiff(&now, &notify->sent));
+	}
 	if (result != ISC_R_SUCCESS) {
 		goto fail;
 	}
@@ -16096,7 +17170,14 @@ fail:
 			   addrbuf, isc_result_totext(result));
 		notify->flags |= DNS_NOTIFY_TCP;
 		dns_request_destroy(&notify->request);
-		notify_send_queue(notify, (notify->flags & DNS_NOTIFY_STARTUP));
+		if (notify->pentry.peer != NULL) {
+			/* Keep the place in the congestion window */
+			isc_async_run(notify->zone->loop, notify_send_toaddr,
+				      notify);
+		} else {
+			notify_send_queue(notify,
+					  (notify->flags & DNS_NOTIFY_STARTUP));
+		}
 		return;
 	} else if (result == ISC_R_TIMEDOUT) {
 		notify_log(notify->zone, ISC_LOG_WARNING,
@@ -17259,6 +18340,10 @@ copy_non_dnssec_records(dns_db_t *db, dns_db_t *version, dns_db_t *rawdb,
 			result = checkandaddsoa(db, node, version, name,
 						&rdataset, *oldserial);
 		} else {
+			/*
+			 * The raw database shares its rdataslabs, so
+			 * this only adds a reference to the raw data.
+			 */
 			result = dns_db_addrdataset(db, node, version, 0,
 						    &rdataset, 0, NULL);
 		}
@@ -18966,8 +20051,15 @@ dns_zonemgr_create(isc_mem_t *mctx, isc_nm_t *netmgr, dns_zonemgr_t **zmgrp) {
 	isc_ratelimiter_create(loop, &zmgr->startupnotifyrl);
 	isc_ratelimiter_create(loop, &zmgr->startuprefreshrl);
 
+	/* Pipelined SOA queries. */
+	isc_hashmap_create(zmgr->mctx, 4, &zmgr->notifypeers);
+	isc_hashmap_create(zmgr->mctx, 4, &zmgr->refreshpeers);
+	isc_mutex_init(&zmgr->peerlock);
+
 	zmgr->mctxpool = isc_mem_cget(zmgr->mctx, zmgr->workers,
 				      sizeof(zmgr->mctxpool[0]));
+	zmgr->timerwheels = isc_mem_cget(zmgr->mctx, zmgr->workers,
+					 sizeof(zmgr->timerwheels[0]));
 	for (size_t i = 0; i < zmgr->workers; i++) {
 		isc_mem_create(&zmgr->mctxpool[i]);
 		isc_mem_setname(zmgr->mctxpool[i], "zonemgr-mctxpool");
@@ -19027,7 +20119,7 @@ dns_zonemgr_managezone(dns_zonemgr_t *zmgr, dns_zone_t *zone) {
 
 	RWLOCK(&zmgr->rwlock, isc_rwlocktype_write);
 	LOCK_ZONE(zone);
-	REQUIRE(zone->timer == NULL);
+	REQUIRE(!isc_timerwheel_armed(&zone->timer));
 	REQUIRE(zone->zmgr == NULL);
 
 	isc_loop_t *loop = isc_loop_get(zmgr->loopmgr, zone->tid);
@@ -19062,10 +20154,7 @@ dns_zonemgr_releasezone(dns_zonemgr_t *zmgr, dns_zone_t *zone) {
 		ENSURE(zone->kfio == NULL);
 	}
 
-	if (zone->timer != NULL) {
-		isc_refcount_decrement(&zone->irefs);
-		isc_timer_destroy(&zone->timer);
-	}
+	zone_timer_stop(zone);
 
 	isc_loop_detach(&zone->loop);
 
@@ -19142,6 +20231,9 @@ dns_zonemgr_shutdown(dns_zonemgr_t *zmgr) {
 	isc_ratelimiter_shutdown(zmgr->refreshrl);
 	isc_ratelimiter_shutdown(zmgr->startupnotifyrl);
 	isc_ratelimiter_shutdown(zmgr->startuprefreshrl);
+	zonepeers_setdepth(zmgr, zmgr->notifypeers, &zmgr->notifypipeline, 0);
+	zonepeers_setdepth(zmgr, zmgr->refreshpeers, &zmgr->serialquerypipeline,
+			   0);
 
 	for (size_t i = 0; i < zmgr->workers; i++) {
 		isc_mem_detach(&zmgr->mctxpool[i]);
@@ -19174,12 +20266,28 @@ zonemgr_free(dns_zonemgr_t *zmgr) {
 	isc_mem_cput(zmgr->mctx, zmgr->mctxpool, zmgr->workers,
 		     sizeof(zmgr->mctxpool[0]));
 
+	for (size_t i = 0; i < zmgr->workers; i++) {
+		if (zmgr->timerwheels[i] != NULL) {
+			isc_timerwheel_detach(&zmgr->timerwheels[i]);
+		}
+	}
+	isc_mem_cput(zmgr->mctx, zmgr->timerwheels, zmgr->workers,
+		     sizeof(zmgr->timerwheels[0]));
+
+	zonepeers_destroy(&zmgr->notifypeers);
+	zonepeers_destroy(&zmgr->refreshpeers);
+	isc_mutex_destroy(&zmgr->peerlock);
+
 	isc_rwlock_destroy(&zmgr->urlock);
 	isc_rwlock_destroy(&zmgr->rwlock);
 	isc_rwlock_destroy(&zmgr->tlsctx_cache_rwlock);
 
 	zonemgr_keymgmt_destroy(zmgr);
 
+	if (zmgr->slabpool != NULL) {
+		dns_slabpool_detach(&zmgr->slabpool);
+	}
+
 	if (zmgr->tlsctx_cache != NULL) {
 		isc_tlsctx_cache_detach(&zmgr->tlsctx_cache);
 	}
@@ -19453,6 +20561,124 @@ dns_zonemgr_setserialqueryrate(dns_zonemgr_t *zmgr, unsigned int value) {
 	setrl(zmgr->startuprefreshrl, &zmgr->startupserialqueryrate, value);
 }
 
+void
+dns_zonemgr_setserialquerypipeline(dns_zonemgr_t *zmgr, unsigned int depth) {
+	REQUIRE(DNS_ZONEMGR_VALID(zmgr));
+
+	zonepeers_setdepth(zmgr, zmgr->refreshpeers, &zmgr->serialquerypipeline,
+			   depth);
+}
+
+unsigned int
+dns_zonemgr_getserialquerypipeline(dns_zonemgr_t *zmgr) {
+	REQUIRE(DNS_ZONEMGR_VALID(zmgr));
+
+	return (atomic_load_relaxed(&zmgr->serialquerypipeline));
+}
+
+isc_result_t
+dns_zonemgr_refreshstats(dns_zonemgr_t *zmgr, dns_zonemgr_peerstats_cb_t cb,
+			 void *arg) {
+	REQUIRE(DNS_ZONEMGR_VALID(zmgr));
+	REQUIRE(cb != NULL);
+
+	return (zonepeers_stats(zmgr, zmgr->refreshpeers, cb, arg));
+}
+
+void
+dns_zonemgr_setnotifypipeline(dns_zonemgr_t *zmgr, unsigned int depth) {
+	REQUIRE(DNS_ZONEMGR_VALID(zmgr));
+
+	zonepeers_setdepth(zmgr, zmgr->notifypeers, &zmgr->notifypipeline,
+			   depth);
+}
+
+unsigned int
+dns_zonemgr_getnotifypipeline(dns_zonemgr_t *zmgr) {
+	REQUIRE(DNS_ZONEMGR_VALID(zmgr));
+
+	return (atomic_load_relaxed(&zmgr->notifypipeline));
+}
+
+isc_result_t
+dns_zonemgr_notifystats(dns_zonemgr_t *zmgr, dns_zonemgr_peerstats_cb_t cb,
+			void *arg) {
+	REQUIRE(DNS_ZONEMGR_VALID(zmgr));
+	REQUIRE(cb != NULL);
+
+	return (zonepeers_stats(zmgr, zmgr->notifypeers, cb, arg));
+}
+
+void
+dns_zonemgr_setinternslabs(dns_zonemgr_t *zmgr, bool value) {
+	REQUIRE(DNS_ZONEMGR_VALID(zmgr));
+
+	RWLOCK(&zmgr->rwlock, isc_rwlocktype_write);
+	if (value && zmgr->slabpool == NULL) {
+		dns_slabpool_create(zmgr->mctx, &zmgr->slabpool);
+	} else if (!value && zmgr->slabpool != NULL) {
+		/*
+		 * The databases already loaded keep the pool alive; release
+		 * the rdataslabs none of them refers to.
+		 */
+		dns_slabpool_purge(zmgr->slabpool);
+		dns_slabpool_detach(&zmgr->slabpool);
+	}
+	RWUNLOCK(&zmgr->rwlock, isc_rwlocktype_write);
+}
+
+static void
+zonemgr_slabpurge_cb(struct rcu_head *rcu_head) {
+	dns_zonemgr_t *zmgr = caa_container_of(rcu_head, dns_zonemgr_t,
+					       slabpurge_rcu);
+
+	atomic_store_release(&zmgr->slabpurge, false);
+
+	RWLOCK(&zmgr->rwlock, isc_rwlocktype_read);
+	if (zmgr->slabpool != NULL) {
+		dns_slabpool_purge(zmgr->slabpool);
+	}
+	RWUNLOCK(&zmgr->rwlock, isc_rwlocktype_read);
+
+	dns_zonemgr_detach(&zmgr);
+}
+
+/*
+ * Purge the slab pool once the databases detached so far are gone: a
+ * database frees its nodes, and with them its references to the pool,
+ * after an RCU grace period.  This also keeps zmgr->rwlock from being
+ * taken with the zone locked.  The purges requested while one is
+ * pending are coalesced.
+ */
+static void
+zonemgr_slabpurge(dns_zonemgr_t *zmgr) {
+	dns_zonemgr_t *ref = NULL;
+
+	if (atomic_exchange_acquire(&zmgr->slabpurge, true)) {
+		return;
+	}
+
+	dns_zonemgr_attach(zmgr, &ref);
+	call_rcu(&ref->slabpurge_rcu, zonemgr_slabpurge_cb);
+}
+
+isc_result_t
+dns_zonemgr_getslabpoolstats(dns_zonemgr_t *zmgr, dns_slabpool_stats_t *stats) {
+	isc_result_t result = ISC_R_NOTFOUND;
+
+	REQUIRE(DNS_ZONEMGR_VALID(zmgr));
+	REQUIRE(stats != NULL);
+
+	RWLOCK(&zmgr->rwlock, isc_rwlocktype_read);
+	if (zmgr->slabpool != NULL) {
+		dns_slabpool_getstats(zmgr->slabpool, stats);
+		result = ISC_R_SUCCESS;
+	}
+	RWUNLOCK(&zmgr->rwlock, isc_rwlocktype_read);
+
+	return (result);
+}
+
 unsigned int
 dns_zonemgr_getnotifyrate(dns_zonemgr_t *zmgr) {
 	REQUIRE(DNS_ZONEMGR_VALID(zmgr));
@@ -20112,6 +21338,48 @@ dns_zone_getsignatures(dns_zone_t *zone) {
 	return (zone->signatures);
 }
 
+void
+dns_zone_setsigningworkers(dns_zone_t *zone, uint32_t workers) {
+	REQUIRE(DNS_ZONE_VALID(zone));
+	zone->signingworkers = workers;
+}
+
+uint32_t
+dns_zone_getsigningworkers(dns_zone_t *zone) {
+	REQUIRE(DNS_ZONE_VALID(zone));
+	return (zone->signingworkers);
+}
+
+void
+dns_zone_getsigningstats(dns_zone_t *zone, dns_zone_signingstats_t *stats) {
+	REQUIRE(DNS_ZONE_VALID(zone));
+	REQUIRE(stats != NULL);
+
+	LOCK_ZONE(zone);
+	*stats = zone->signingstats;
+	stats->workers = zone_signingworkers(zone);
+	UNLOCK_ZONE(zone);
+}
+
+isc_result_t
+dns_zone_signingprogress(dns_zone_t *zone, dns_zone_signingprogress_cb_t cb,
+			 void *arg) {
+	isc_result_t result = ISC_R_SUCCESS;
+
+	REQUIRE(DNS_ZONE_VALID(zone));
+	REQUIRE(cb != NULL);
+
+	LOCK_ZONE(zone);
+	for (size_t i = 0;
+	     result == ISC_R_SUCCESS && i < zone->nsigningprogress; i++)
+	{
+		result = cb(&zone->signingprogress[i], arg);
+	}
+	UNLOCK_ZONE(zone);
+
+	return (result);
+}
+
 void
 dns_zone_setprivatetype(dns_zone_t *zone, dns_rdatatype_t type) {
 	REQUIRE(DNS_ZONE_VALID(zone));
@@ -20142,6 +21410,8 @@ zone_signwithkey(dns_zone_t *zone, dns_secalg_t algorithm, uint16_t keyid,
 	signing->keyid = keyid;
 	signing->deleteit = deleteit;
 	signing->done = false;
+	signing->nodes = 0;
+	signing->total = 0;
 
 	now = isc_time_now();
 
@@ -20157,6 +21427,8 @@ zone_signwithkey(dns_zone_t *zone, dns_secalg_t algorithm, uint16_t keyid,
 	}
 
 	dns_db_attach(db, &signing->db);
+	signing->total = dns_db_nodecount(db, dns_dbtree_main) +
+			 dns_db_nodecount(db, dns_dbtree_nsec3);
 
 	for (current = ISC_LIST_HEAD(zone->signing); current != NULL;
 	     current = ISC_LIST_NEXT(current, link))
@@ -20460,7 +21732,7 @@ tickle_apex_rrset(dns_rdatatype_t rrtype, dns_zone_t *zone, dns_db_t *db,
 		}
 		result = add_sigs(db, ver, &zone->origin, zone, rrtype,
 				  zonediff->diff, keys, nkeys, zone->mctx, now,
-				  inception, keyexpire);
+				  inception, keyexpire, NULL);
 		if (result != ISC_R_SUCCESS) {
 			dnssec_log(zone, ISC_LOG_ERROR,
 				   "sign_apex:add_sigs -> %s",
@@ -24148,6 +25420,21 @@ dns_zone_getrefreshkeytime(dns_zone_t *zone, isc_time_t *refreshkeytime) {
 	return (ISC_R_SUCCESS);
 }
 
+isc_result_t
+dns_zone_getslabstats(dns_zone_t *zone, uint64_t *owned, uint64_t *shared) {
+	isc_result_t result = ISC_R_NOTFOUND;
+
+	REQUIRE(DNS_ZONE_VALID(zone));
+
+	ZONEDB_LOCK(&zone->dblock, isc_rwlocktype_read);
+	if (zone->db != NULL) {
+		result = dns_db_getslabstats(zone->db, owned, shared);
+	}
+	ZONEDB_UNLOCK(&zone->dblock, isc_rwlocktype_read);
+
+	return (result);
+}
+
 unsigned int
 dns_zone_getincludes(dns_zone_t *zone, char ***includesp) {
 	dns_include_t *include;
@@ -24482,6 +25769,24 @@ dns_zone_makedb(dns_zone_t *zone, dns_db_t **dbp) {
 	dns_db_setmaxrrperset(db, zone->maxrrperset);
 	dns_db_setmaxtypepername(db, zone->maxtypepername);
 
+	/*
+	 * The secure zone refers to the unsigned data of the raw zone
+	 * rather than copying it, see receive_secure_db().
+	 */
+	if (inline_raw(zone)) {
+		dns_db_setslabsharing(db, true);
+	}
+
+	if (zone->zmgr != NULL) {
+		dns_zonemgr_t *zmgr = zone->zmgr;
+
+		RWLOCK(&zmgr->rwlock, isc_rwlocktype_read);
+		if (zmgr->slabpool != NULL) {
+			dns_db_setslabpool(db, zmgr->slabpool);
+		}
+		RWUNLOCK(&zmgr->rwlock, isc_rwlocktype_read);
+	}
+
 	*dbp = db;
 
 	return (ISC_R_SUCCESS);
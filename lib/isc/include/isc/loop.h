@@ -37,6 +37,36 @@ static inline isc_loop_t *
 isc_loop(void) {
 	return (isc__loop_local);
 }
+
+/*%
+ * How the loop threads are placed on the CPUs
+ */
+typedef enum isc_loopaffinity {
+	isc_loopaffinity_none = 0, /*%< wherever the OS runs them */
+	isc_loopaffinity_cpu,	   /*%< each loop on its own CPU */
+	isc_loopaffinity_numa,	   /*%< ditto, with node-local memory */
+} isc_loopaffinity_t;
+
+void
+isc_loopmgr_setaffinity(isc_loopaffinity_t affinity);
+/*%<
+ * Set how the loops of the loop managers that are created after this
+ * call are placed on the CPUs that the process may run on.
+ *
+ * With 'isc_loopaffinity_cpu', each loop thread is pinned to one CPU;
+ * the CPUs are taken in order of their NUMA node, and the loops are
+ * spread evenly over them.  The helper threads and the threads running
+ * isc_work_enqueue() callbacks may still run on any of the CPUs.
+ *
+ * With 'isc_loopaffinity_numa', the loops are pinned in the same way,
+ * each loop's helper thread is pinned to the NUMA node of its loop,
+ * and each loop's memory context (see isc_loop_getmctx() and
+ * isc_loop_createmctx()) has its own jemalloc arena, so that the
+ * memory the loop allocates comes from its own node.
+ *
+ * The default is 'isc_loopaffinity_none'.
+ */
+
 void
 isc_loopmgr_create(isc_mem_t *mctx, uint32_t nloops, isc_loopmgr_t **loopmgrp);
 /*%<
@@ -147,6 +177,19 @@ isc_loop_getmctx(isc_loop_t *loop);
  *\li	'loop' is a valid loop.
  */
 
+void
+isc_loop_createmctx(isc_loop_t *loop, isc_mem_t **mctxp);
+/*%<
+ * Create a memory context for objects that are mostly used by 'loop'.
+ * When the loops are placed with 'isc_loopaffinity_numa', the context
+ * has its own jemalloc arena, so that its memory comes from the NUMA
+ * node of 'loop'; otherwise this is the same as isc_mem_create().
+ *
+ * Requires:
+ *\li	'loop' is a valid loop.
+ *\li	'mctxp' is not NULL and '*mctxp' is NULL.
+ */
+
 isc_loop_t *
 isc_loop_main(isc_loopmgr_t *loopmgr);
 /*%<
@@ -558,6 +558,25 @@ isc_nm_setnetbuffers(isc_nm_t *mgr, int32_t recv_tcp, int32_t send_tcp,
  * \li	'mgr' is a valid netmgr.
  */
 
+void
+isc_nm_setpipelinedepth(isc_nm_t *mgr, uint32_t depth);
+uint32_t
+isc_nm_getpipelinedepth(isc_nm_t *mgr);
+/*%<
+ * Set and get the maximum number of DNS messages received over a single
+ * DNS over TCP or TLS connection that are processed at the same time.
+ * Once the limit is reached, no more messages are read from the
+ * connection until the processing of one of them has completed.  The
+ * responses are sent in the order in which they are ready, not in the
+ * order of the queries (RFC 7766, Section 6.2.1.1).
+ *
+ * The new value applies to the connections accepted after the call.
+ *
+ * Requires:
+ * \li	'mgr' is a valid netmgr.
+ * \li	'depth' is greater than zero.
+ */
+
 bool
 isc_nm_getloadbalancesockets(isc_nm_t *mgr);
 void
@@ -801,6 +820,18 @@ isc_nm_xfr_checkperm(isc_nmhandle_t *handle);
  * \li	'handle' is a valid connection handle.
  */
 
+size_t
+isc_nm_pipelinedepth(isc_nmhandle_t *handle);
+/*%<
+ * Return the number of DNS messages received over the same stream
+ * connection as 'handle' (including the one 'handle' was passed to the
+ * read callback for) that are currently being processed, or 0 if the
+ * handle does not belong to a DNS over TCP or TLS connection.
+ *
+ * Requires:
+ * \li	'handle' is a valid connection handle.
+ */
+
 void
 isc_nm_set_maxage(isc_nmhandle_t *handle, const uint32_t ttl);
 /*%<
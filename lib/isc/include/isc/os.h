@@ -35,6 +35,23 @@ isc_os_ncpus(void);
  * be determined.
  */
 
+size_t
+isc_os_cpulist(unsigned int *cpus, size_t size);
+/*%<
+ * Fill in up to 'size' elements of 'cpus' with the numbers of the CPUs
+ * that this process may run on, in ascending order, and return how
+ * many of them there are (which can be more than 'size'). If this
+ * cannot be determined, the CPUs are numbered from 0 to
+ * isc_os_ncpus() - 1.
+ */
+
+unsigned int
+isc_os_numanode(unsigned int cpu);
+/*%<
+ * Return the NUMA node that 'cpu' belongs to, or 0 if this cannot be
+ * determined.
+ */
+
 unsigned long
 isc_os_cacheline(void);
 /*%<
@@ -54,6 +54,18 @@ isc_thread_yield(void);
 void
 isc_thread_setname(isc_thread_t thread, const char *name);
 
+isc_result_t
+isc_thread_setaffinity(const unsigned int *cpus, size_t ncpus);
+/*%<
+ * Restrict the current thread to the given CPUs.
+ *
+ * Returns:
+ *\li	#ISC_R_SUCCESS
+ *\li	#ISC_R_NOTIMPLEMENTED if the system has no support for this
+ *\li	#ISC_R_RANGE if a CPU number is too large
+ *\li	other errors from pthread_setaffinity_np()
+ */
+
 #define isc_thread_self (uintptr_t)pthread_self
 
 ISC_LANG_ENDDECLS
@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#pragma once
+
+/*****
+***** Module Info
+*****/
+
+/*! \file isc/timerwheel.h
+ * \brief Coarse-grained timers for objects that exist in large numbers.
+ *
+ * A timer wheel multiplexes any number of one-shot timers onto a single
+ * isc_timer_t running on a single loop.  The timers are kept in a
+ * hierarchical wheel of time slots, so arming and cancelling a timer is
+ * O(1) regardless of the number of timers, and the timers which expire
+ * at the same tick are run together in one batch.
+ *
+ * The resolution of the wheel is the 'tick' given when the wheel is
+ * created: a timer never fires early, but it may fire up to one tick
+ * late.  This makes the wheel a good fit for the maintenance timers of
+ * zones, of which a secondary server can have a million, and a bad fit
+ * for anything that needs millisecond precision.
+ *
+ * \li MP:
+ *	A wheel and all of its timers must only be used on the loop the
+ *	wheel was created on.
+ */
+
+/***
+ *** Imports
+ ***/
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include <isc/job.h>
+#include <isc/lang.h>
+#include <isc/list.h>
+#include <isc/refcount.h>
+#include <isc/time.h>
+#include <isc/types.h>
+
+/***
+ *** Types
+ ***/
+
+typedef struct isc_timerwheel_entry isc_timerwheel_entry_t;
+
+/*%
+ * A timer on a timer wheel; it is meant to be embedded into the object
+ * it is the timer of.  The members are private to the wheel.
+ */
+struct isc_timerwheel_entry {
+	isc_timerwheel_t *wheel;
+	isc_job_cb	  cb;
+	void		 *cbarg;
+	uint64_t	  expires;
+	unsigned int	  slot;
+	ISC_LINK(isc_timerwheel_entry_t) link;
+};
+
+/*%
+ * Counters of the timer wheel activity.
+ */
+typedef struct isc_timerwheel_stats {
+	uint64_t armed;	   /*%< timers armed or rearmed */
+	uint64_t canceled; /*%< armed timers canceled */
+	uint64_t fired;	   /*%< timers that expired */
+	uint64_t cascaded; /*%< timers moved to a finer wheel level */
+	uint64_t batches;  /*%< batches of expired timers run */
+} isc_timerwheel_stats_t;
+
+ISC_LANG_BEGINDECLS
+
+/***
+ *** Functions
+ ***/
+
+void
+isc_timerwheel_create(isc_loop_t *loop, uint32_t tick,
+		      isc_timerwheel_t **wheelp);
+/*%<
+ * Create a timer wheel with the resolution of 'tick' milliseconds that
+ * runs the expired timers on 'loop'.
+ *
+ * Requires:
+ *
+ *\li	'loop' is the current loop
+ *\li	'tick' is greater than zero
+ *\li	'wheelp' is a valid pointer, and *wheelp == NULL
+ */
+
+void
+isc_timerwheel_entryinit(isc_timerwheel_entry_t *entry, isc_job_cb cb,
+			 void *cbarg);
+/*%<
+ * Initialize the disarmed timer 'entry' that will call 'cb' with 'cbarg'
+ * as its argument when it expires.
+ *
+ * Requires:
+ *
+ *\li	'entry' is not NULL
+ *\li	'cb' is not NULL
+ */
+
+void
+isc_timerwheel_arm(isc_timerwheel_t *wheel, isc_timerwheel_entry_t *entry,
+		   const isc_interval_t *interval);
+/*%<
+ * Arm the timer 'entry' on 'wheel' to expire after 'interval', or on the
+ * next loop iteration if 'interval' is zero or NULL.  An armed timer is
+ * rearmed.  The timer is disarmed before its callback is run.
+ *
+ * Requires:
+ *
+ *\li	'wheel' is a valid timer wheel of the current loop
+ *\li	'entry' is initialized, and it is not armed on another wheel
+ */
+
+void
+isc_timerwheel_cancel(isc_timerwheel_entry_t *entry);
+/*%<
+ * Disarm the timer 'entry', if it is armed.
+ *
+ * Requires:
+ *
+ *\li	'entry' is initialized
+ *\li	if 'entry' is armed, its wheel belongs to the current loop
+ */
+
+bool
+isc_timerwheel_armed(const isc_timerwheel_entry_t *entry);
+/*%<
+ * Return true if the timer 'entry' is armed.
+ */
+
+void
+isc_timerwheel_getstats(isc_timerwheel_t *wheel,
+			isc_timerwheel_stats_t *stats);
+/*%<
+ * Copy the counters of 'wheel' to 'stats'.
+ *
+ * Requires:
+ *
+ *\li	'wheel' is a valid timer wheel of the current loop
+ *\li	'stats' is not NULL
+ */
+
+ISC_REFCOUNT_DECL(isc_timerwheel);
+/*%<
+ * The timer wheel reference counting.  All the timers must be disarmed
+ * before the last reference is detached; the wheel may be detached from
+ * any thread.
+ */
+
+ISC_LANG_ENDDECLS
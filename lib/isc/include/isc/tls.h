@@ -182,6 +182,159 @@ isc_tlsctx_session_tickets(isc_tlsctx_t *ctx, const bool use);
  * \li	'ctx' != NULL.
  */
 
+typedef struct isc_tlsctx_ticketkeys isc_tlsctx_ticketkeys_t;
+/*%<
+ * A set of TLS session ticket encryption keys which can be shared between
+ * multiple TLS server contexts (and thus all the worker threads using
+ * them) and which outlives the contexts, so that the session tickets
+ * issued before a reconfiguration remain usable.
+ */
+
+typedef struct isc_tlsctx_ticketkeys_stats {
+	uint64_t issued;    /*%< session tickets issued */
+	uint64_t resumed;   /*%< sessions resumed from a ticket */
+	uint64_t renewed;   /*%< resumed with an old key, ticket renewed */
+	uint64_t rejected;  /*%< tickets with an unknown or retired key */
+	uint64_t rotations; /*%< key rotations */
+} isc_tlsctx_ticketkeys_stats_t;
+
+void
+isc_tlsctx_ticketkeys_create(isc_mem_t *mctx, uint32_t lifetime,
+			     isc_tlsctx_ticketkeys_t **keysp);
+/*%<
+ * Create a new set of TLS session ticket keys. A new key is generated
+ * every 'lifetime' seconds, while the previous keys are still accepted
+ * for decryption for a while (and the session tickets encrypted with
+ * them are renewed). If 'lifetime' is 0, the key is never rotated
+ * automatically.
+ *
+ * Requires:
+ *\li	'mctx' is a valid memory context;
+ *\li	'keysp' != NULL and '*keysp' == NULL.
+ */
+
+void
+isc_tlsctx_ticketkeys_attach(isc_tlsctx_ticketkeys_t *source,
+			     isc_tlsctx_ticketkeys_t **targetp);
+/*%<
+ * Attach to the set of TLS session ticket keys.
+ *
+ * Requires:
+ *\li	'source' is a valid set of TLS session ticket keys;
+ *\li	'targetp' != NULL and '*targetp' == NULL.
+ */
+
+void
+isc_tlsctx_ticketkeys_detach(isc_tlsctx_ticketkeys_t **keysp);
+/*%<
+ * Detach from the set of TLS session ticket keys. The keys are wiped
+ * from memory when the last reference is gone.
+ *
+ * Requires:
+ *\li	'keysp' != NULL and '*keysp' is a valid set of TLS session ticket
+ *	keys.
+ */
+
+void
+isc_tlsctx_ticketkeys_setlifetime(isc_tlsctx_ticketkeys_t *keys,
+				  uint32_t lifetime);
+/*%<
+ * Change the interval, in seconds, at which the keys are rotated.
+ *
+ * Requires:
+ *\li	'keys' is a valid set of TLS session ticket keys.
+ */
+
+void
+isc_tlsctx_ticketkeys_rotate(isc_tlsctx_ticketkeys_t *keys);
+/*%<
+ * Generate a new current key immediately.
+ *
+ * Requires:
+ *\li	'keys' is a valid set of TLS session ticket keys.
+ */
+
+void
+isc_tlsctx_ticketkeys_getstats(isc_tlsctx_ticketkeys_t *keys,
+			       isc_tlsctx_ticketkeys_stats_t *stats);
+/*%<
+ * Get the session ticket and resumption statistics of 'keys'.
+ *
+ * Requires:
+ *\li	'keys' is a valid set of TLS session ticket keys;
+ *\li	'stats' != NULL.
+ */
+
+void
+isc_tlsctx_set_ticketkeys(isc_tlsctx_t *ctx, isc_tlsctx_ticketkeys_t *keys,
+			  const char *const *sid_ctx);
+/*%<
+ * Make the TLS server context 'ctx' encrypt and decrypt the session
+ * tickets using 'keys', and enable session tickets. The session ID
+ * context of 'ctx' is derived from 'keys' and the NULL-terminated list
+ * of strings 'sid_ctx', which should uniquely identify the TLS
+ * configuration (e.g. its name, transport and files), so that the
+ * sessions can be resumed by the TLS contexts created for the same
+ * configuration later on.
+ *
+ * This replaces 'isc_tlsctx_set_random_session_id_context()'. If 'ctx'
+ * already uses a set of keys, it is replaced by 'keys'.
+ *
+ * Requires:
+ *\li	'ctx' != NULL;
+ *\li	'keys' is a valid set of TLS session ticket keys;
+ *\li	'sid_ctx' != NULL and sid_ctx[0] != NULL.
+ */
+
+void
+isc_tlsctx_enable_ktls(isc_tlsctx_t *ctx);
+/*%<
+ * Make the TLS 1.3 connections accepted using the server context 'ctx'
+ * eligible for kernel TLS transmit offload (see isc_tls_ktls_prepare()
+ * and isc_tls_ktls_install()). This does nothing on the platforms
+ * without kernel TLS support.
+ *
+ * Requires:
+ *\li	'ctx' != NULL.
+ */
+
+bool
+isc_tls_ktls_prepare(isc_tls_t *tls);
+/*%<
+ * Prepare the server side TLS connection 'tls', which has just completed
+ * its handshake, for kernel TLS transmit offload: if it is eligible, a
+ * TLS 1.3 KeyUpdate message is written to the output BIO of 'tls'.
+ *
+ * Returns 'true' if the connection is eligible, in which case the
+ * caller should send everything 'tls' has produced so far, and then call
+ * isc_tls_ktls_install(). 'tls' remains fully usable otherwise.
+ *
+ * Requires:
+ *\li	'tls' != NULL.
+ */
+
+isc_result_t
+isc_tls_ktls_install(isc_tls_t *tls, int fd);
+/*%<
+ * Make the kernel encrypt all the data written to the TCP socket 'fd'
+ * from now on, using the keys of 'tls'. Everything produced by 'tls'
+ * so far must have already been written to 'fd'.
+ *
+ * When the function succeeds, the application data must be written to
+ * 'fd' directly, and nothing produced by 'tls' may be sent anymore.
+ * Otherwise, 'tls' can still be used to encrypt the data.
+ *
+ * Requires:
+ *\li	isc_tls_ktls_prepare() has returned 'true' for 'tls';
+ *\li	'fd' is a valid socket descriptor.
+ *
+ * Returns:
+ *\li	#ISC_R_SUCCESS on success;
+ *\li	#ISC_R_NOTIMPLEMENTED if the kernel does not support the TLS
+ *	offload or the negotiated cipher;
+ *\li	other error codes on failure.
+ */
+
 isc_tls_t *
 isc_tls_create(isc_tlsctx_t *ctx);
 /*%<
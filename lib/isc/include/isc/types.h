@@ -74,6 +74,7 @@ typedef struct isc_symtab     isc_symtab_t;	/*%< Symbol Table */
 typedef struct isc_textregion isc_textregion_t; /*%< Text Region */
 typedef struct isc_time	      isc_time_t;	/*%< Time */
 typedef struct isc_timer      isc_timer_t;	/*%< Timer */
+typedef struct isc_timerwheel isc_timerwheel_t; /*%< Timer Wheel */
 typedef struct isc_work	      isc_work_t;	/*%< Work offloaded to an
 						 *   external thread */
 
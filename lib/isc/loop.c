@@ -26,6 +26,7 @@
 #include <isc/magic.h>
 #include <isc/mem.h>
 #include <isc/mutex.h>
+#include <isc/os.h>
 #include <isc/refcount.h>
 #include <isc/result.h>
 #include <isc/signal.h>
@@ -48,6 +49,8 @@
 
 thread_local isc_loop_t *isc__loop_local = NULL;
 
+static isc_loopaffinity_t loop_affinity = isc_loopaffinity_none;
+
 static void
 ignore_signal(int sig, void (*handler)(int)) {
 	struct sigaction sa = { .sa_handler = handler };
@@ -227,7 +230,11 @@ loop_init(isc_loop_t *loop, isc_loopmgr_t *loopmgr, uint32_t tid,
 
 	char name[16];
 	snprintf(name, sizeof(name), "%s-%08" PRIx32, kind, tid);
-	isc_mem_create(&loop->mctx);
+	if (loopmgr->affinity == isc_loopaffinity_numa) {
+		isc_mem_create_arena(&loop->mctx);
+	} else {
+		isc_mem_create(&loop->mctx);
+	}
 	isc_mem_setname(loop->mctx, name);
 
 	isc_refcount_init(&loop->references, 1);
@@ -273,10 +280,34 @@ loop_close(isc_loop_t *loop) {
 	isc_mem_detach(&loop->mctx);
 }
 
+/*
+ * Pin the calling thread to the CPUs chosen for 'loop'; this is only
+ * an optimization, so failing to do so is not fatal.
+ */
+static void
+loop_pin(isc_loop_t *loop, const char *kind) {
+	isc_result_t result;
+
+	if (loop->ncpus == 0) {
+		return;
+	}
+
+	result = isc_thread_setaffinity(loop->cpus, loop->ncpus);
+	if (result != ISC_R_SUCCESS) {
+		isc_log_write(ISC_LOGCATEGORY_GENERAL, ISC_LOGMODULE_OTHER,
+			      ISC_LOG_WARNING,
+			      "unable to pin %s %" PRIu32 " to CPU %u: %s",
+			      kind, loop->tid, loop->cpus[0],
+			      isc_result_totext(result));
+	}
+}
+
 static void *
 helper_thread(void *arg) {
 	isc_loop_t *helper = (isc_loop_t *)arg;
 
+	loop_pin(helper, "helper");
+
 	int r = uv_prepare_start(&helper->quiescent, quiescent_cb);
 	UV_RUNTIME_CHECK(uv_prepare_start, r);
 
@@ -306,11 +337,16 @@ loop_thread(void *arg) {
 
 	isc__tid_init(loop->tid);
 
-	/* Start the helper thread */
+	/*
+	 * Start the helper thread before pinning the loop, so that it does
+	 * not inherit the CPU of the loop.
+	 */
 	isc_thread_create(helper_thread, helper, &helper->thread);
 	snprintf(name, sizeof(name), "isc-helper-%04" PRIu32, loop->tid);
 	isc_thread_setname(helper->thread, name);
 
+	loop_pin(loop, "loop");
+
 	int r = uv_prepare_start(&loop->quiescent, quiescent_cb);
 	UV_RUNTIME_CHECK(uv_prepare_start, r);
 
@@ -368,6 +404,97 @@ ISC_REFCOUNT_TRACE_IMPL(isc_loop, loop_destroy)
 ISC_REFCOUNT_IMPL(isc_loop, loop_destroy);
 #endif
 
+void
+isc_loopmgr_setaffinity(isc_loopaffinity_t affinity) {
+	loop_affinity = affinity;
+}
+
+/*
+ * Choose the CPUs for the loops and their helpers.  The CPUs are sorted
+ * by their NUMA node, so that spreading the loops evenly over them also
+ * spreads them evenly over the nodes, and each helper can be given the
+ * CPUs of its loop's node, which are contiguous.
+ */
+static void
+loopmgr_place(isc_loopmgr_t *loopmgr) {
+	size_t ncpus = isc_os_cpulist(NULL, 0);
+	size_t nnodes = 0;
+
+	if (ncpus == 0) {
+		loopmgr->affinity = isc_loopaffinity_none;
+		return;
+	}
+
+	loopmgr->ncpus = ncpus;
+	loopmgr->cpus = isc_mem_cget(loopmgr->mctx, loopmgr->ncpus,
+				     sizeof(loopmgr->cpus[0]));
+	loopmgr->nodes = isc_mem_cget(loopmgr->mctx, loopmgr->ncpus,
+				      sizeof(loopmgr->nodes[0]));
+
+	/* The affinity mask could have shrunk since the first call */
+	ncpus = ISC_MIN(isc_os_cpulist(loopmgr->cpus, ncpus), ncpus);
+	loopmgr->nallowed = ncpus;
+
+	/* Stable insertion sort, the list is short and mostly sorted */
+	for (size_t i = 0; i < ncpus; i++) {
+		unsigned int cpu = loopmgr->cpus[i];
+		unsigned int node = isc_os_numanode(cpu);
+		size_t j = i;
+
+		while (j > 0 && loopmgr->nodes[j - 1] > node) {
+			loopmgr->cpus[j] = loopmgr->cpus[j - 1];
+			loopmgr->nodes[j] = loopmgr->nodes[j - 1];
+			j--;
+		}
+		loopmgr->cpus[j] = cpu;
+		loopmgr->nodes[j] = node;
+	}
+
+	for (size_t i = 0; i < ncpus; i++) {
+		if (i == 0 || loopmgr->nodes[i] != loopmgr->nodes[i - 1]) {
+			nnodes++;
+		}
+	}
+
+	for (size_t i = 0; i < loopmgr->nloops; i++) {
+		isc_loop_t *loop = &loopmgr->loops[i];
+		isc_loop_t *helper = &loopmgr->helpers[i];
+		size_t c = (loopmgr->nloops <= ncpus)
+				   ? i * ncpus / loopmgr->nloops
+				   : i % ncpus;
+		size_t first = c, last = c;
+
+		loop->cpus = &loopmgr->cpus[c];
+		loop->ncpus = 1;
+
+		if (loopmgr->affinity != isc_loopaffinity_numa) {
+			continue;
+		}
+
+		while (first > 0 &&
+		       loopmgr->nodes[first - 1] == loopmgr->nodes[c])
+		{
+			first--;
+		}
+		while (last + 1 < ncpus &&
+		       loopmgr->nodes[last + 1] == loopmgr->nodes[c])
+		{
+			last++;
+		}
+		helper->cpus = &loopmgr->cpus[first];
+		helper->ncpus = last - first + 1;
+	}
+
+	isc_log_write(ISC_LOGCATEGORY_GENERAL, ISC_LOGMODULE_OTHER,
+		      ISC_LOG_INFO,
+		      "pinning %" PRIuFAST32 " loops to %zu CPUs on %zu "
+		      "NUMA nodes%s",
+		      loopmgr->nloops, ncpus, nnodes,
+		      loopmgr->affinity == isc_loopaffinity_numa
+			      ? " with node-local memory"
+			      : "");
+}
+
 void
 isc_loopmgr_create(isc_mem_t *mctx, uint32_t nloops, isc_loopmgr_t **loopmgrp) {
 	isc_loopmgr_t *loopmgr = NULL;
@@ -381,6 +508,7 @@ isc_loopmgr_create(isc_mem_t *mctx, uint32_t nloops, isc_loopmgr_t **loopmgrp) {
 	loopmgr = isc_mem_get(mctx, sizeof(*loopmgr));
 	*loopmgr = (isc_loopmgr_t){
 		.nloops = nloops,
+		.affinity = loop_affinity,
 	};
 
 	isc_mem_attach(mctx, &loopmgr->mctx);
@@ -405,6 +533,10 @@ isc_loopmgr_create(isc_mem_t *mctx, uint32_t nloops, isc_loopmgr_t **loopmgrp) {
 		loop_init(loop, loopmgr, i, "helper");
 	}
 
+	if (loopmgr->affinity != isc_loopaffinity_none) {
+		loopmgr_place(loopmgr);
+	}
+
 	loopmgr->sigint = isc_signal_new(loopmgr, isc__loopmgr_signal, loopmgr,
 					 SIGINT);
 	loopmgr->sigterm = isc_signal_new(loopmgr, isc__loopmgr_signal, loopmgr,
@@ -486,6 +618,18 @@ isc_loopmgr_teardown(isc_loopmgr_t *loopmgr, isc_job_cb cb, void *cbarg) {
 	}
 }
 
+static void
+threadpool_noop(uv_work_t *req) {
+	UNUSED(req);
+}
+
+static void
+threadpool_started(uv_work_t *req, int status) {
+	UNUSED(req);
+
+	UV_RUNTIME_CHECK(uv_after_work_cb, status);
+}
+
 void
 isc_loopmgr_run(isc_loopmgr_t *loopmgr) {
 	REQUIRE(VALID_LOOPMGR(loopmgr));
@@ -497,6 +641,18 @@ isc_loopmgr_run(isc_loopmgr_t *loopmgr) {
 	 */
 	ignore_signal(SIGPIPE, SIG_IGN);
 
+	/*
+	 * libuv starts its work pool on the first uv_queue_work() and the
+	 * pool threads inherit the CPU mask of the thread that calls it,
+	 * so start the pool now from this unpinned thread.
+	 */
+	if (loopmgr->cpus != NULL) {
+		int r = uv_queue_work(&DEFAULT_LOOP(loopmgr)->loop,
+				      &loopmgr->threadpool, threadpool_noop,
+				      threadpool_started);
+		UV_RUNTIME_CHECK(uv_queue_work, r);
+	}
+
 	/*
 	 * The thread 0 is this one.
 	 */
@@ -511,6 +667,11 @@ isc_loopmgr_run(isc_loopmgr_t *loopmgr) {
 	}
 
 	isc_thread_main(loop_thread, &loopmgr->loops[0]);
+
+	/* Let this thread run anywhere again */
+	if (loopmgr->nallowed > 0) {
+		(void)isc_thread_setaffinity(loopmgr->cpus, loopmgr->nallowed);
+	}
 }
 
 void
@@ -613,6 +774,13 @@ isc_loopmgr_destroy(isc_loopmgr_t **loopmgrp) {
 	isc_mem_cput(loopmgr->mctx, loopmgr->loops, loopmgr->nloops,
 		     sizeof(loopmgr->loops[0]));
 
+	if (loopmgr->cpus != NULL) {
+		isc_mem_cput(loopmgr->mctx, loopmgr->cpus, loopmgr->ncpus,
+			     sizeof(loopmgr->cpus[0]));
+		isc_mem_cput(loopmgr->mctx, loopmgr->nodes, loopmgr->ncpus,
+			     sizeof(loopmgr->nodes[0]));
+	}
+
 	isc_barrier_destroy(&loopmgr->starting);
 	isc_barrier_destroy(&loopmgr->stopping);
 	isc_barrier_destroy(&loopmgr->resuming);
@@ -635,6 +803,18 @@ isc_loop_getmctx(isc_loop_t *loop) {
 	return (loop->mctx);
 }
 
+void
+isc_loop_createmctx(isc_loop_t *loop, isc_mem_t **mctxp) {
+	REQUIRE(VALID_LOOP(loop));
+	REQUIRE(mctxp != NULL && *mctxp == NULL);
+
+	if (loop->loopmgr->affinity == isc_loopaffinity_numa) {
+		isc_mem_create_arena(mctxp);
+	} else {
+		isc_mem_create(mctxp);
+	}
+}
+
 isc_loop_t *
 isc_loop_main(isc_loopmgr_t *loopmgr) {
 	REQUIRE(VALID_LOOPMGR(loopmgr));
@@ -49,6 +49,10 @@ struct isc_loop {
 	uv_loop_t loop;
 	uint32_t tid;
 
+	/* placement, see isc_loopmgr_setaffinity() */
+	const unsigned int *cpus;
+	size_t ncpus;
+
 	isc_mem_t *mctx;
 
 	/* states */
@@ -90,6 +94,16 @@ struct isc_loopmgr {
 
 	uint_fast32_t nloops;
 
+	/* placement, sorted by NUMA node */
+	isc_loopaffinity_t affinity;
+	unsigned int *cpus;
+	unsigned int *nodes;
+	size_t ncpus;
+	size_t nallowed; /* how many of 'cpus' are filled in */
+
+	/* forces the work pool to start before the loops are pinned */
+	uv_work_t threadpool;
+
 	atomic_bool shuttingdown;
 	atomic_bool running;
 	atomic_bool paused;
@@ -85,6 +85,20 @@
 
 #define INITIAL_DNS_MESSAGE_BUFFER_SIZE (512)
 
+/*
+ * The number of decoded DoH GET queries cached per HTTP/2 session.
+ * Stub resolvers use zero DNS message IDs with GET requests to make
+ * them cacheable, so the same query string tends to repeat on a
+ * connection.
+ */
+#define HTTP_QUERY_CACHE_SIZE (8)
+
+/*
+ * The maximum number of the server-side stream objects kept for reuse
+ * by an HTTP/2 session.
+ */
+#define MAX_FREE_SERVER_STREAMS (32)
+
 typedef struct isc_nm_http_response_status {
 	size_t code;
 	size_t content_length;
@@ -127,6 +141,13 @@ typedef struct http_cstream {
 
 typedef ISC_LIST(isc__nm_uvreq_t) isc__nm_http_pending_callbacks_t;
 
+typedef struct http_query_cache_entry {
+	char *key; /* base64url encoded query, as received */
+	size_t keylen;
+	uint8_t *data; /* decoded DNS message, allocated with the key */
+	size_t datalen;
+} http_query_cache_entry_t;
+
 struct isc_nm_http_session {
 	unsigned int magic;
 	isc_refcount_t references;
@@ -155,6 +176,14 @@ struct isc_nm_http_session {
 
 	isc__nm_http_pending_callbacks_t pending_write_callbacks;
 	isc_buffer_t *pending_write_data;
+
+	/* Server-side only */
+	isc_job_t flush_job;
+	bool flush_scheduled;
+	ISC_LIST(isc_nmsocket_h2_t) free_sstreams;
+	size_t nfree_sstreams;
+	http_query_cache_entry_t query_cache[HTTP_QUERY_CACHE_SIZE];
+	size_t query_cache_next;
 };
 
 typedef enum isc_http_error_responses {
@@ -298,10 +327,106 @@ new_session(isc_mem_t *mctx, isc_tlsctx_t *tctx,
 	ISC_LIST_INIT(session->cstreams);
 	ISC_LIST_INIT(session->sstreams);
 	ISC_LIST_INIT(session->pending_write_callbacks);
+	ISC_LIST_INIT(session->free_sstreams);
 
 	*sessionp = session;
 }
 
+/*
+ * Server-side stream objects are recycled within the session instead of
+ * being allocated anew for every HTTP/2 stream.
+ */
+static isc_nmsocket_h2_t *
+server_get_stream(isc_nm_http_session_t *session) {
+	isc_nmsocket_h2_t *h2 = ISC_LIST_HEAD(session->free_sstreams);
+
+	if (h2 != NULL) {
+		ISC_LIST_UNLINK(session->free_sstreams, h2, link);
+		session->nfree_sstreams--;
+		return (h2);
+	}
+
+	return (isc_mem_get(session->mctx, sizeof(*h2)));
+}
+
+static void
+server_put_stream(isc_nm_http_session_t *session, isc_nmsocket_h2_t *h2) {
+	if (session->closed ||
+	    session->nfree_sstreams >= MAX_FREE_SERVER_STREAMS)
+	{
+		isc_mem_put(session->mctx, h2, sizeof(*h2));
+		return;
+	}
+
+	*h2 = (isc_nmsocket_h2_t){ .link = ISC_LINK_INITIALIZER };
+	ISC_LIST_APPEND(session->free_sstreams, h2, link);
+	session->nfree_sstreams++;
+}
+
+static void
+server_free_streams(isc_nm_http_session_t *session) {
+	isc_nmsocket_h2_t *h2 = NULL;
+
+	while ((h2 = ISC_LIST_HEAD(session->free_sstreams)) != NULL) {
+		ISC_LIST_UNLINK(session->free_sstreams, h2, link);
+		isc_mem_put(session->mctx, h2, sizeof(*h2));
+	}
+	session->nfree_sstreams = 0;
+}
+
+static http_query_cache_entry_t *
+query_cache_find(isc_nm_http_session_t *session, const char *key,
+		 const size_t keylen) {
+	for (size_t i = 0; i < HTTP_QUERY_CACHE_SIZE; i++) {
+		http_query_cache_entry_t *entry = &session->query_cache[i];
+
+		if (entry->key != NULL && entry->keylen == keylen &&
+		    memcmp(entry->key, key, keylen) == 0)
+		{
+			return (entry);
+		}
+	}
+
+	return (NULL);
+}
+
+static void
+query_cache_add(isc_nm_http_session_t *session, const char *key,
+		const size_t keylen, const uint8_t *data,
+		const size_t datalen) {
+	http_query_cache_entry_t *entry =
+		&session->query_cache[session->query_cache_next];
+
+	/* Replace the entries in a round-robin fashion */
+	session->query_cache_next = (session->query_cache_next + 1) %
+				    HTTP_QUERY_CACHE_SIZE;
+
+	if (entry->key != NULL) {
+		isc_mem_put(session->mctx, entry->key,
+			    entry->keylen + entry->datalen);
+	}
+
+	entry->key = isc_mem_get(session->mctx, keylen + datalen);
+	entry->keylen = keylen;
+	entry->data = (uint8_t *)entry->key + keylen;
+	entry->datalen = datalen;
+	memmove(entry->key, key, keylen);
+	memmove(entry->data, data, datalen);
+}
+
+static void
+query_cache_flush(isc_nm_http_session_t *session) {
+	for (size_t i = 0; i < HTTP_QUERY_CACHE_SIZE; i++) {
+		http_query_cache_entry_t *entry = &session->query_cache[i];
+
+		if (entry->key != NULL) {
+			isc_mem_put(session->mctx, entry->key,
+				    entry->keylen + entry->datalen);
+			*entry = (http_query_cache_entry_t){ 0 };
+		}
+	}
+}
+
 void
 isc__nm_httpsession_attach(isc_nm_http_session_t *source,
 			   isc_nm_http_session_t **targetp) {
@@ -342,6 +467,9 @@ isc__nm_httpsession_detach(isc_nm_http_session_t **sessionp) {
 		isc_buffer_free(&session->buf);
 	}
 
+	server_free_streams(session);
+	query_cache_flush(session);
+
 	/* We need an acquire memory barrier here */
 	(void)isc_refcount_current(&session->references);
 
@@ -1705,7 +1833,7 @@ server_on_begin_headers_callback(nghttp2_session *ngsession,
 	socket = isc_mempool_get(worker->nmsocket_pool);
 	local = isc_nmhandle_localaddr(session->handle);
 	isc__nmsocket_init(socket, worker, isc_nm_httpsocket, &local, NULL);
-	http_initsocket(socket);
+	socket->h2 = server_get_stream(session);
 	socket->peer = isc_nmhandle_peeraddr(session->handle);
 	*socket->h2 = (isc_nmsocket_h2_t){
 		.psock = socket,
@@ -1776,12 +1904,23 @@ server_handle_path_header(isc_nmsocket_t *socket, const uint8_t *value,
 				if (socket->h2->query_data != NULL) {
 					isc_mem_free(socket->worker->mctx,
 						     socket->h2->query_data);
+					socket->h2->query_data = NULL;
+					socket->h2->query_data_len = 0;
+				}
+				/*
+				 * The query is kept base64url encoded, so it
+				 * can be looked up in the session query cache
+				 * and decoded only on a cache miss.
+				 */
+				if (dns_value_len > 0) {
+					socket->h2->query_data =
+						isc_mem_strndup(
+							socket->worker->mctx,
+							dns_value,
+							dns_value_len + 1);
+					socket->h2->query_data_len =
+						dns_value_len;
 				}
-				socket->h2->query_data =
-					isc__nm_base64url_to_base64(
-						socket->worker->mctx, dns_value,
-						dns_value_len,
-						&socket->h2->query_data_len);
 			} else {
 				socket->h2->query_too_large = true;
 				return (ISC_HTTP_ERROR_PAYLOAD_TOO_LARGE);
@@ -2110,6 +2249,41 @@ isc__nm_http_bad_request(isc_nmhandle_t *handle) {
 					 sock->h2->session->ngsession, sock);
 }
 
+static isc_result_t
+server_decode_get_query(isc_nmsocket_t *socket, isc_buffer_t *decoded) {
+	isc_nm_http_session_t *session = socket->h2->session;
+	http_query_cache_entry_t *entry = NULL;
+	char *base64 = NULL;
+	isc_region_t r;
+	isc_result_t result;
+
+	entry = query_cache_find(session, socket->h2->query_data,
+				 socket->h2->query_data_len);
+	if (entry != NULL) {
+		isc_buffer_putmem(decoded, entry->data, entry->datalen);
+		return (ISC_R_SUCCESS);
+	}
+
+	base64 = isc__nm_base64url_to_base64(socket->worker->mctx,
+					     socket->h2->query_data,
+					     socket->h2->query_data_len, NULL);
+	if (base64 == NULL) {
+		return (ISC_R_BADBASE64);
+	}
+
+	result = isc_base64_decodestring(base64, decoded);
+	isc_mem_free(socket->worker->mctx, base64);
+	if (result != ISC_R_SUCCESS) {
+		return (result);
+	}
+
+	isc_buffer_usedregion(decoded, &r);
+	query_cache_add(session, socket->h2->query_data,
+			socket->h2->query_data_len, r.base, r.length);
+
+	return (ISC_R_SUCCESS);
+}
+
 static int
 server_on_request_recv(nghttp2_session *ngsession, isc_nmsocket_t *socket) {
 	isc_result_t result;
@@ -2168,8 +2342,8 @@ server_on_request_recv(nghttp2_session *ngsession, isc_nmsocket_t *socket) {
 	if (socket->h2->request_type == ISC_HTTP_REQ_GET) {
 		isc_buffer_t decoded_buf;
 		isc_buffer_init(&decoded_buf, tmp_buf, sizeof(tmp_buf));
-		if (isc_base64_decodestring(socket->h2->query_data,
-					    &decoded_buf) != ISC_R_SUCCESS)
+		if (server_decode_get_query(socket, &decoded_buf) !=
+		    ISC_R_SUCCESS)
 		{
 			code = ISC_HTTP_ERROR_BAD_REQUEST;
 			goto error;
@@ -2253,6 +2427,51 @@ client_httpsend(isc_nmhandle_t *handle, isc_nmsocket_t *sock,
 	isc__nm_uvreq_put(&req);
 }
 
+#ifdef ENABLE_HTTP_WRITE_BUFFERING
+static void
+server_flush_cb(void *arg) {
+	isc_nm_http_session_t *session = arg;
+
+	REQUIRE(VALID_HTTP2_SESSION(session));
+
+	session->flush_scheduled = false;
+	http_do_bio(session, NULL, NULL, NULL);
+	isc__nm_httpsession_detach(&session);
+}
+#endif /* ENABLE_HTTP_WRITE_BUFFERING */
+
+/*
+ * Instead of writing each response to the transport as soon as it is
+ * submitted, put its write callback into the pending write callbacks
+ * list and flush the session once, after all the jobs queued for the
+ * current loop iteration have been run.  That way the frames of all the
+ * responses produced within the iteration go out in a single write.
+ */
+static void
+server_flush_later(isc_nm_http_session_t *session, isc_nmhandle_t *httphandle,
+		   isc_nm_cb_t cb, void *cbarg) {
+#ifdef ENABLE_HTTP_WRITE_BUFFERING
+	isc_nm_http_session_t *tmpsess = NULL;
+	isc__nm_uvreq_t *newcb = isc__nm_uvreq_get(httphandle->sock);
+
+	newcb->cb.send = cb;
+	newcb->cbarg = cbarg;
+	isc_nmhandle_attach(httphandle, &newcb->handle);
+	ISC_LIST_APPEND(session->pending_write_callbacks, newcb, link);
+
+	if (session->flush_scheduled) {
+		return;
+	}
+
+	session->flush_scheduled = true;
+	isc__nm_httpsession_attach(session, &tmpsess);
+	isc_job_run(session->handle->sock->worker->loop, &session->flush_job,
+		    server_flush_cb, tmpsess);
+#else
+	http_do_bio(session, httphandle, cb, cbarg);
+#endif /* ENABLE_HTTP_WRITE_BUFFERING */
+}
+
 static void
 server_httpsend(isc_nmhandle_t *handle, isc_nmsocket_t *sock,
 		isc__nm_uvreq_t *req) {
@@ -2301,7 +2520,7 @@ server_httpsend(isc_nmhandle_t *handle, isc_nmsocket_t *sock,
 				      sizeof(hdrs) / sizeof(nghttp2_nv), sock);
 
 	if (result == ISC_R_SUCCESS) {
-		http_do_bio(handle->httpsession, handle, cb, cbarg);
+		server_flush_later(handle->httpsession, handle, cb, cbarg);
 	} else {
 		cb(handle, result, cbarg);
 	}
@@ -3245,17 +3464,31 @@ isc__nm_http_cleanup_data(isc_nmsocket_t *sock) {
 	case isc_nm_tcpsocket:
 	case isc_nm_tlssocket:
 		if (sock->h2 != NULL) {
+			isc_nm_http_session_t *session = NULL;
+
 			if (sock->h2->session != NULL) {
 				if (sock->h2->connect.uri != NULL) {
 					isc_mem_free(sock->worker->mctx,
 						     sock->h2->connect.uri);
 					sock->h2->connect.uri = NULL;
 				}
-				isc__nm_httpsession_detach(&sock->h2->session);
+				session = sock->h2->session;
+				sock->h2->session = NULL;
 			}
 
-			isc_mem_put(sock->worker->mctx, sock->h2,
-				    sizeof(*sock->h2));
+			if (session != NULL && !session->client &&
+			    sock->type == isc_nm_httpsocket)
+			{
+				/* A server-side stream, recycle it */
+				server_put_stream(session, sock->h2);
+			} else {
+				isc_mem_put(sock->worker->mctx, sock->h2,
+					    sizeof(*sock->h2));
+			}
+
+			if (session != NULL) {
+				isc__nm_httpsession_detach(&session);
+			}
 		};
 		break;
 	default:
@@ -92,6 +92,14 @@ STATIC_ASSERT(ISC_NETMGR_TCP_RECVBUF_SIZE <= ISC_NETMGR_RECVBUF_SIZE,
  */
 #define ISC_NETMGR_MAX_STREAM_CLIENTS_PER_CONN 23
 
+/*%
+ * Default maximum number of DNS messages from a single stream connection
+ * that are processed at the same time, see isc_nm_setpipelinedepth().
+ * The handle used for reading from the connection takes the remaining
+ * one of ISC_NETMGR_MAX_STREAM_CLIENTS_PER_CONN.
+ */
+#define ISC_NETMGR_PIPELINE_DEPTH (ISC_NETMGR_MAX_STREAM_CLIENTS_PER_CONN - 1)
+
 /*%
  * Regular TCP buffer size.
  */
@@ -366,6 +374,12 @@ struct isc_nm {
 	atomic_int_fast32_t send_udp_buffer_size;
 	atomic_int_fast32_t recv_tcp_buffer_size;
 	atomic_int_fast32_t send_tcp_buffer_size;
+
+	/*
+	 * Maximum number of DNS messages received over a single stream
+	 * connection that are processed at the same time.
+	 */
+	atomic_uint_fast32_t pipeline_depth;
 };
 
 /*%
@@ -531,6 +545,12 @@ struct isc_nmsocket {
 		bool tcp_nodelay_value;
 		isc_nmsocket_tls_send_req_t *send_req; /*%< Send req to reuse */
 		bool reading;
+		enum {
+			TLS_KTLS_OFF,
+			TLS_KTLS_PENDING, /*%< KeyUpdate sent, not installed */
+			TLS_KTLS_ON,	  /*%< The kernel encrypts the data */
+			TLS_KTLS_CLOSING  /*%< Close once the data is sent */
+		} ktls;			  /*%< Kernel TLS offload state */
 	} tlsstream;
 
 #if HAVE_LIBNGHTTP2
@@ -546,6 +566,8 @@ struct isc_nmsocket {
 		void *send_req;
 		bool dot_alpn_negotiated;
 		const char *tls_verify_error;
+		isc_job_t resume_job; /*%< Process the next message */
+		bool resume_scheduled;
 	} streamdns;
 
 	struct {
@@ -1162,6 +1184,9 @@ isc__nm_streamdns_set_tlsctx(isc_nmsocket_t *listener, isc_tlsctx_t *tlsctx);
 isc_result_t
 isc__nm_streamdns_xfr_checkperm(isc_nmsocket_t *sock);
 
+size_t
+isc__nm_streamdns_pipelinedepth(isc_nmsocket_t *sock);
+
 void
 isc__nmsocket_streamdns_reset(isc_nmsocket_t *sock);
 
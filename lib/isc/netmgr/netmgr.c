@@ -186,6 +186,7 @@ isc_netmgr_create(isc_mem_t *mctx, isc_loopmgr_t *loopmgr, isc_nm_t **netmgrp) {
 	atomic_init(&netmgr->send_tcp_buffer_size, 0);
 	atomic_init(&netmgr->recv_udp_buffer_size, 0);
 	atomic_init(&netmgr->send_udp_buffer_size, 0);
+	atomic_init(&netmgr->pipeline_depth, ISC_NETMGR_PIPELINE_DEPTH);
 #if HAVE_SO_REUSEPORT_LB
 	netmgr->load_balance_sockets = true;
 #else
@@ -359,6 +360,21 @@ isc_nm_setnetbuffers(isc_nm_t *mgr, int32_t recv_tcp, int32_t send_tcp,
 	atomic_store_relaxed(&mgr->send_udp_buffer_size, send_udp);
 }
 
+void
+isc_nm_setpipelinedepth(isc_nm_t *mgr, uint32_t depth) {
+	REQUIRE(VALID_NM(mgr));
+	REQUIRE(depth > 0);
+
+	atomic_store_relaxed(&mgr->pipeline_depth, depth);
+}
+
+uint32_t
+isc_nm_getpipelinedepth(isc_nm_t *mgr) {
+	REQUIRE(VALID_NM(mgr));
+
+	return (atomic_load_relaxed(&mgr->pipeline_depth));
+}
+
 bool
 isc_nm_getloadbalancesockets(isc_nm_t *mgr) {
 	REQUIRE(VALID_NM(mgr));
@@ -2183,6 +2199,19 @@ isc_nm_xfr_checkperm(isc_nmhandle_t *handle) {
 	return (result);
 }
 
+size_t
+isc_nm_pipelinedepth(isc_nmhandle_t *handle) {
+	REQUIRE(VALID_NMHANDLE(handle));
+	REQUIRE(VALID_NMSOCK(handle->sock));
+
+	switch (handle->sock->type) {
+	case isc_nm_streamdnssocket:
+		return (isc__nm_streamdns_pipelinedepth(handle->sock));
+	default:
+		return (0);
+	}
+}
+
 bool
 isc_nm_is_http_handle(isc_nmhandle_t *handle) {
 	REQUIRE(VALID_NMHANDLE(handle));
@@ -14,8 +14,8 @@
 #include <limits.h>
 #include <unistd.h>
 
-#include <isc/async.h>
 #include <isc/atomic.h>
+#include <isc/job.h>
 #include <isc/result.h>
 #include <isc/thread.h>
 
@@ -94,6 +94,9 @@ streamdns_closing(isc_nmsocket_t *sock);
 static void
 streamdns_resume_processing(void *arg);
 
+static void
+streamdns_schedule_resume(isc_nmsocket_t *sock);
+
 static void
 streamdns_resumeread(isc_nmsocket_t *sock, isc_nmhandle_t *transphandle) {
 	if (!sock->streamdns.reading) {
@@ -193,8 +196,7 @@ streamdns_on_complete_dnsmessage(isc_dnsstream_assembler_t *dnsasm,
 		 * Process more DNS messages in the next loop tick.
 		 */
 		streamdns_pauseread(sock, transphandle);
-		isc_async_run(sock->worker->loop, streamdns_resume_processing,
-			      sock);
+		streamdns_schedule_resume(sock);
 	}
 
 	return (false);
@@ -696,6 +698,35 @@ streamdns_resume_processing(void *arg) {
 	streamdns_handle_incoming_data(sock, sock->outerhandle, NULL, 0);
 }
 
+static void
+streamdns_resume_job(void *arg) {
+	isc_nmsocket_t *sock = (isc_nmsocket_t *)arg;
+
+	sock->streamdns.resume_scheduled = false;
+	streamdns_resume_processing(sock);
+	isc__nmsocket_detach(&sock);
+}
+
+/*
+ * Process the next pipelined message in the next loop tick.  The jobs
+ * are run in the order in which they have been scheduled, so every
+ * connection with pending messages gets its turn before the same
+ * connection is processed again.
+ */
+static void
+streamdns_schedule_resume(isc_nmsocket_t *sock) {
+	isc_nmsocket_t *tsock = NULL;
+
+	if (sock->streamdns.resume_scheduled) {
+		return;
+	}
+
+	sock->streamdns.resume_scheduled = true;
+	isc__nmsocket_attach(sock, &tsock);
+	isc_job_run(sock->worker->loop, &sock->streamdns.resume_job,
+		    streamdns_resume_job, tsock);
+}
+
 static isc_result_t
 streamdns_accept_cb(isc_nmhandle_t *handle, isc_result_t result, void *cbarg) {
 	isc_nmsocket_t *listensock = (isc_nmsocket_t *)cbarg;
@@ -729,6 +760,9 @@ streamdns_accept_cb(isc_nmhandle_t *handle, isc_result_t result, void *cbarg) {
 	nsock->read_timeout = initial;
 	nsock->accepting = true;
 	nsock->active = true;
+	/* One more handle is used for reading from the connection */
+	nsock->active_handles_max =
+		isc_nm_getpipelinedepth(handle->sock->worker->netmgr) + 1;
 
 	isc__nmsocket_attach(handle->sock, &nsock->listener);
 	isc_nmhandle_attach(handle, &nsock->outerhandle);
@@ -1176,6 +1210,24 @@ isc__nm_streamdns_xfr_checkperm(isc_nmsocket_t *sock) {
 	return (result);
 }
 
+size_t
+isc__nm_streamdns_pipelinedepth(isc_nmsocket_t *sock) {
+	REQUIRE(VALID_NMSOCK(sock));
+	REQUIRE(sock->type == isc_nm_streamdnssocket);
+
+	if (sock->client) {
+		return (0);
+	}
+
+	/* Do not count the handle used for reading */
+	if (sock->recv_handle != NULL) {
+		INSIST(sock->active_handles_cur > 0);
+		return (sock->active_handles_cur - 1);
+	}
+
+	return (sock->active_handles_cur);
+}
+
 void
 isc__nmsocket_streamdns_reset(isc_nmsocket_t *sock) {
 	REQUIRE(VALID_NMSOCK(sock));
@@ -219,6 +219,12 @@ tls_senddone(isc_nmhandle_t *handle, isc_result_t eresult, void *cbarg) {
 	}
 	tlssock->tlsstream.nsending--;
 
+	if (tlssock->tlsstream.ktls == TLS_KTLS_CLOSING &&
+	    tlssock->tlsstream.nsending == 0)
+	{
+		finish = true;
+	}
+
 	if (send_cb != NULL) {
 		INSIST(VALID_NMHANDLE(tlssock->statichandle));
 		send_cb(send_handle, eresult, send_cbarg);
@@ -348,6 +354,35 @@ async_tls_do_bio(isc_nmsocket_t *sock) {
 	isc_async_run(sock->worker->loop, tls_do_bio_cb, sock);
 }
 
+static isc_nmsocket_tls_send_req_t *
+tls_get_send_req(isc_nmsocket_t *sock, bool finish, isc_nmhandle_t *tlshandle,
+		 isc_nm_cb_t cb, void *cbarg) {
+	isc_nmsocket_tls_send_req_t *send_req = NULL;
+
+	/* Try to reuse previously allocated object */
+	if (sock->tlsstream.send_req != NULL) {
+		send_req = sock->tlsstream.send_req;
+		send_req->finish = finish;
+		sock->tlsstream.send_req = NULL;
+	} else {
+		send_req = isc_mem_get(sock->worker->mctx, sizeof(*send_req));
+		*send_req = (isc_nmsocket_tls_send_req_t){ .finish = finish };
+		isc_buffer_init(&send_req->data, &send_req->smallbuf,
+				sizeof(send_req->smallbuf));
+		isc_buffer_setmctx(&send_req->data, sock->worker->mctx);
+	}
+	INSIST(isc_buffer_remaininglength(&send_req->data) == 0);
+
+	isc__nmsocket_attach(sock, &send_req->tlssock);
+	if (cb != NULL) {
+		send_req->cb = cb;
+		send_req->cbarg = cbarg;
+		isc_nmhandle_attach(tlshandle, &send_req->handle);
+	}
+
+	return (send_req);
+}
+
 static int
 tls_send_outgoing(isc_nmsocket_t *sock, bool finish, isc_nmhandle_t *tlshandle,
 		  isc_nm_cb_t cb, void *cbarg) {
@@ -355,7 +390,6 @@ tls_send_outgoing(isc_nmsocket_t *sock, bool finish, isc_nmhandle_t *tlshandle,
 	int pending;
 	int rv;
 	size_t len = 0;
-	bool new_send_req = false;
 	isc_region_t used_region = { 0 };
 	bool shutting_down = isc__nm_closing(sock->worker);
 
@@ -379,30 +413,7 @@ tls_send_outgoing(isc_nmsocket_t *sock, bool finish, isc_nmhandle_t *tlshandle,
 		return (pending);
 	}
 
-	/* Try to reuse previously allocated object */
-	if (sock->tlsstream.send_req != NULL) {
-		send_req = sock->tlsstream.send_req;
-		send_req->finish = finish;
-		sock->tlsstream.send_req = NULL;
-	} else {
-		send_req = isc_mem_get(sock->worker->mctx, sizeof(*send_req));
-		*send_req = (isc_nmsocket_tls_send_req_t){ .finish = finish };
-		new_send_req = true;
-	}
-
-	if (new_send_req) {
-		isc_buffer_init(&send_req->data, &send_req->smallbuf,
-				sizeof(send_req->smallbuf));
-		isc_buffer_setmctx(&send_req->data, sock->worker->mctx);
-	}
-	INSIST(isc_buffer_remaininglength(&send_req->data) == 0);
-
-	isc__nmsocket_attach(sock, &send_req->tlssock);
-	if (cb != NULL) {
-		send_req->cb = cb;
-		send_req->cbarg = cbarg;
-		isc_nmhandle_attach(tlshandle, &send_req->handle);
-	}
+	send_req = tls_get_send_req(sock, finish, tlshandle, cb, cbarg);
 
 	RUNTIME_CHECK(isc_buffer_reserve(&send_req->data, pending) ==
 		      ISC_R_SUCCESS);
@@ -447,6 +458,112 @@ tls_process_outgoing(isc_nmsocket_t *sock, bool finish,
 	return (pending);
 }
 
+/*
+ * Send the data as is: the kernel encrypts it.
+ */
+static void
+tls_send_plain(isc_nmsocket_t *sock, isc__nm_uvreq_t *send_data) {
+	isc_nmsocket_tls_send_req_t *send_req = NULL;
+	isc_region_t region = {
+		.base = (uint8_t *)send_data->uvbuf.base,
+		.length = send_data->uvbuf.len,
+	};
+
+	send_req = tls_get_send_req(sock, false, send_data->handle,
+				    send_data->cb.send, send_data->cbarg);
+
+	INSIST(VALID_NMHANDLE(sock->outerhandle));
+
+	sock->tlsstream.nsending++;
+	if (*(uint16_t *)send_data->tcplen != 0) {
+		isc__nm_senddns(sock->outerhandle, &region, tls_senddone,
+				send_req);
+	} else {
+		isc_nm_send(sock->outerhandle, &region, tls_senddone,
+			    send_req);
+	}
+}
+
+/*
+ * Hand the encryption of the outgoing data over to the kernel once
+ * everything encrypted by OpenSSL, up to and including the KeyUpdate
+ * message sent by isc_tls_ktls_prepare(), has reached the kernel.
+ */
+static void
+tls_try_enable_ktls(isc_nmsocket_t *sock) {
+	isc_nmsocket_t *tcpsock = NULL;
+	uv_os_fd_t fd;
+	isc_result_t result;
+
+	if (sock->tlsstream.ktls != TLS_KTLS_PENDING || inactive(sock) ||
+	    BIO_pending(sock->tlsstream.bio_out) > 0)
+	{
+		return;
+	}
+
+	tcpsock = sock->outerhandle->sock;
+	INSIST(tcpsock->type == isc_nm_tcpsocket);
+
+	if (uv_stream_get_write_queue_size(&tcpsock->uv_handle.stream) > 0) {
+		return;
+	}
+
+	sock->tlsstream.ktls = TLS_KTLS_OFF;
+
+	if (uv_fileno(&tcpsock->uv_handle.handle, &fd) != 0) {
+		return;
+	}
+
+	result = isc_tls_ktls_install(sock->tlsstream.tls, fd);
+	if (result != ISC_R_SUCCESS) {
+		isc__nmsocket_log(sock, ISC_LOG_DEBUG(3),
+				  "kernel TLS offload is not available: %s",
+				  isc_result_totext(result));
+		return;
+	}
+
+	sock->tlsstream.ktls = TLS_KTLS_ON;
+}
+
+/*
+ * The kernel encrypts the outgoing data, so nothing OpenSSL produces can
+ * be sent anymore.  That is either the close_notify alert, which we have
+ * to do without, or a reply to a KeyUpdate request, in which case the
+ * connection cannot continue.
+ *
+ * Returns ISC_R_EOF if the connection is being closed.
+ */
+static isc_result_t
+tls_ktls_process_outgoing(isc_nmsocket_t *sock, bool finish) {
+	bool received_shutdown = ((SSL_get_shutdown(sock->tlsstream.tls) &
+				   SSL_RECEIVED_SHUTDOWN) != 0);
+	bool pending = (BIO_pending(sock->tlsstream.bio_out) > 0);
+
+	(void)BIO_reset(sock->tlsstream.bio_out);
+
+	if (inactive(sock)) {
+		return (ISC_R_SUCCESS);
+	}
+
+	if (finish || received_shutdown ||
+	    sock->tlsstream.ktls == TLS_KTLS_CLOSING)
+	{
+		if (sock->tlsstream.nsending == 0) {
+			tls_failed_read_cb(sock, ISC_R_EOF);
+		} else {
+			/* Close in tls_senddone() */
+			sock->tlsstream.ktls = TLS_KTLS_CLOSING;
+		}
+		return (ISC_R_EOF);
+	}
+
+	if (pending) {
+		return (ISC_R_TLSERROR);
+	}
+
+	return (ISC_R_SUCCESS);
+}
+
 static int
 tls_try_handshake(isc_nmsocket_t *sock, isc_result_t *presult) {
 	REQUIRE(sock->tlsstream.state == TLS_HANDSHAKE);
@@ -464,6 +581,18 @@ tls_try_handshake(isc_nmsocket_t *sock, isc_result_t *presult) {
 		INSIST(SSL_is_init_finished(sock->tlsstream.tls) == 1);
 
 		isc__nmsocket_log_tls_session_reuse(sock, sock->tlsstream.tls);
+
+		/*
+		 * This has to be done before any application data is
+		 * written.
+		 */
+		if (sock->tlsstream.server && sock->outerhandle != NULL &&
+		    sock->outerhandle->sock->type == isc_nm_tcpsocket &&
+		    isc_tls_ktls_prepare(sock->tlsstream.tls))
+		{
+			sock->tlsstream.ktls = TLS_KTLS_PENDING;
+		}
+
 		tlshandle = isc__nmhandle_get(sock, &sock->peer, &sock->iface);
 		tls_read_stop(sock);
 
@@ -609,6 +738,23 @@ tls_do_bio(isc_nmsocket_t *sock, isc_region_t *received_data,
 				((SSL_get_shutdown(sock->tlsstream.tls) &
 				  SSL_SENT_SHUTDOWN) != 0);
 			bool write_failed = false;
+
+			if (sock->tlsstream.ktls == TLS_KTLS_PENDING) {
+				tls_try_enable_ktls(sock);
+				if (sock->tlsstream.ktls == TLS_KTLS_PENDING) {
+					/*
+					 * The KeyUpdate has not been sent yet,
+					 * let OpenSSL encrypt the data.
+					 */
+					sock->tlsstream.ktls = TLS_KTLS_OFF;
+				}
+			}
+
+			if (sock->tlsstream.ktls >= TLS_KTLS_ON) {
+				tls_send_plain(sock, send_data);
+				return;
+			}
+
 			if (*(uint16_t *)send_data->tcplen != 0) {
 				size_t sendlen = 0;
 				uint8_t sendbuf[MAX_DNS_MESSAGE_SIZE +
@@ -761,7 +907,20 @@ tls_do_bio(isc_nmsocket_t *sock, isc_region_t *received_data,
 		tls_status = SSL_ERROR_WANT_READ;
 	}
 
-	pending = tls_process_outgoing(sock, finish, send_data);
+	if (sock->tlsstream.ktls >= TLS_KTLS_ON) {
+		INSIST(send_data == NULL);
+		result = tls_ktls_process_outgoing(sock, finish);
+		if (result == ISC_R_EOF) {
+			return;
+		} else if (result != ISC_R_SUCCESS) {
+			goto error;
+		}
+		pending = 0;
+	} else {
+		pending = tls_process_outgoing(sock, finish, send_data);
+		tls_try_enable_ktls(sock);
+	}
+
 	if (pending > 0 && tls_status != SSL_ERROR_SSL) {
 		return;
 	}
@@ -868,6 +1027,7 @@ initialize_tls(isc_nmsocket_t *sock, bool server) {
 	sock->tlsstream.server = server;
 	sock->tlsstream.nsending = 0;
 	sock->tlsstream.state = TLS_INIT;
+	sock->tlsstream.ktls = TLS_KTLS_OFF;
 	return (ISC_R_SUCCESS);
 error:
 	isc_tls_free(&sock->tlsstream.tls);
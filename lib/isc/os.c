@@ -11,9 +11,21 @@
  * information regarding copyright ownership.
  */
 
+#include <ctype.h>
+#include <dirent.h>
 #include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <sys/stat.h>
 
+#if defined(HAVE_SCHED_GETAFFINITY)
+#include <sched.h>
+#elif defined(HAVE_CPUSET_GETAFFINITY)
+#include <sys/param.h>
+#include <sys/cpuset.h>
+#endif
+
 #include <isc/os.h>
 #include <isc/types.h>
 #include <isc/util.h>
@@ -181,6 +193,78 @@ isc_os_ncpus(void) {
 	return (isc__os_ncpus);
 }
 
+size_t
+isc_os_cpulist(unsigned int *cpus, size_t size) {
+	size_t count = 0;
+
+	REQUIRE(cpus != NULL || size == 0);
+
+#if defined(HAVE_SCHED_GETAFFINITY) || defined(HAVE_CPUSET_GETAFFINITY)
+#if defined(HAVE_SCHED_GETAFFINITY)
+	cpu_set_t set;
+	int r = sched_getaffinity(0, sizeof(set), &set);
+#else
+	cpuset_t set;
+	int r = cpuset_getaffinity(CPU_LEVEL_WHICH, CPU_WHICH_PID, -1,
+				   sizeof(set), &set);
+#endif
+	if (r != -1) {
+		for (unsigned int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+			if (!CPU_ISSET(cpu, &set)) {
+				continue;
+			}
+			if (count < size) {
+				cpus[count] = cpu;
+			}
+			count++;
+		}
+		return (count);
+	}
+#endif
+
+	for (unsigned int cpu = 0; cpu < isc__os_ncpus; cpu++) {
+		if (count < size) {
+			cpus[count] = cpu;
+		}
+		count++;
+	}
+	return (count);
+}
+
+unsigned int
+isc_os_numanode(unsigned int cpu) {
+#if defined(__linux__)
+	/*
+	 * Each CPU's sysfs directory has a link to its NUMA node,
+	 * e.g. /sys/devices/system/cpu/cpu0/node0
+	 */
+	char path[64];
+	unsigned int node = 0;
+	struct dirent *entry = NULL;
+	DIR *dir = NULL;
+
+	snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u", cpu);
+	dir = opendir(path);
+	if (dir == NULL) {
+		return (0);
+	}
+	while ((entry = readdir(dir)) != NULL) {
+		if (strncmp(entry->d_name, "node", 4) == 0 &&
+		    isdigit((unsigned char)entry->d_name[4]))
+		{
+			node = strtoul(entry->d_name + 4, NULL, 10);
+			break;
+		}
+	}
+	closedir(dir);
+
+	return (node);
+#else
+	UNUSED(cpu);
+	return (0);
+#endif
+}
+
 unsigned long
 isc_os_cacheline(void) {
 	return (isc__os_cacheline);
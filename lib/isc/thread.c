@@ -13,14 +13,14 @@
 
 /*! \file */
 
-#if defined(HAVE_SCHED_H)
+#if defined(HAVE_SCHED_H) || defined(HAVE_SCHED_GETAFFINITY)
 #include <sched.h>
-#endif /* if defined(HAVE_SCHED_H) */
+#endif /* if defined(HAVE_SCHED_H) || defined(HAVE_SCHED_GETAFFINITY) */
 
-#if defined(HAVE_CPUSET_H)
+#if defined(HAVE_CPUSET_H) || defined(HAVE_CPUSET_GETAFFINITY)
 #include <sys/cpuset.h>
 #include <sys/param.h>
-#endif /* if defined(HAVE_CPUSET_H) */
+#endif /* if defined(HAVE_CPUSET_H) || defined(HAVE_CPUSET_GETAFFINITY) */
 
 #if defined(HAVE_SYS_PROCSET_H)
 #include <sys/processor.h>
@@ -31,6 +31,7 @@
 #include <stdlib.h>
 
 #include <isc/atomic.h>
+#include <isc/errno.h>
 #include <isc/iterated_hash.h>
 #include <isc/strerr.h>
 #include <isc/thread.h>
@@ -169,6 +170,38 @@ isc_thread_setname(isc_thread_t thread, const char *name) {
 #endif /* if defined(HAVE_PTHREAD_SETNAME_NP) && !defined(__APPLE__) */
 }
 
+isc_result_t
+isc_thread_setaffinity(const unsigned int *cpus, size_t ncpus) {
+	REQUIRE(cpus != NULL && ncpus > 0);
+
+#if defined(HAVE_PTHREAD_SETAFFINITY_NP) && \
+	(defined(HAVE_SCHED_GETAFFINITY) || defined(HAVE_CPUSET_GETAFFINITY))
+#if defined(HAVE_SCHED_GETAFFINITY)
+	cpu_set_t set;
+#else  /* if defined(HAVE_SCHED_GETAFFINITY) */
+	cpuset_t set;
+#endif /* if defined(HAVE_SCHED_GETAFFINITY) */
+	int ret;
+
+	CPU_ZERO(&set);
+	for (size_t i = 0; i < ncpus; i++) {
+		if (cpus[i] >= CPU_SETSIZE) {
+			return (ISC_R_RANGE);
+		}
+		CPU_SET(cpus[i], &set);
+	}
+
+	ret = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+	if (ret != 0) {
+		return (isc_errno_toresult(ret));
+	}
+
+	return (ISC_R_SUCCESS);
+#else  /* if defined(HAVE_PTHREAD_SETAFFINITY_NP) && ... */
+	return (ISC_R_NOTIMPLEMENTED);
+#endif /* if defined(HAVE_PTHREAD_SETAFFINITY_NP) && ... */
+}
+
 void
 isc_thread_yield(void) {
 #if defined(HAVE_SCHED_YIELD)
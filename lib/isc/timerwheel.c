@@ -0,0 +1,515 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*! \file */
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+#include <isc/async.h>
+#include <isc/job.h>
+#include <isc/loop.h>
+#include <isc/magic.h>
+#include <isc/mem.h>
+#include <isc/refcount.h>
+#include <isc/time.h>
+#include <isc/timer.h>
+#include <isc/timerwheel.h>
+#include <isc/util.h>
+#include <isc/uv.h>
+
+#include "loop_p.h"
+
+#define TIMERWHEEL_MAGIC    ISC_MAGIC('T', 'W', 'h', 'l')
+#define VALID_TIMERWHEEL(t) ISC_MAGIC_VALID(t, TIMERWHEEL_MAGIC)
+
+/*
+ * Each level of the wheel has 64 slots, each slot of a level spans all
+ * of the slots of the level below it.  With five levels, the wheel
+ * covers 2^30 ticks; the timers beyond that are parked in the last slot
+ * that will be cascaded and placed again when the slot is reached.
+ */
+#define WHEEL_BITS   6
+#define WHEEL_SLOTS  (1U << WHEEL_BITS)
+#define WHEEL_MASK   (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 5
+#define WHEEL_SPAN   (UINT64_C(1) << (WHEEL_BITS * WHEEL_LEVELS))
+
+/*
+ * The 'slot' values of the timers that are not in a wheel slot.
+ */
+#define SLOT_NONE    UINT_MAX
+#define SLOT_DUE     (UINT_MAX - 1)
+#define SLOT_RUNNING (UINT_MAX - 2)
+
+#define NO_WAKEUP UINT64_MAX
+
+typedef ISC_LIST(isc_timerwheel_entry_t) entrylist_t;
+
+struct isc_timerwheel {
+	unsigned int magic;
+	isc_refcount_t references;
+	isc_mem_t *mctx;
+	isc_loop_t *loop;
+	isc_timer_t *timer;
+	uint64_t tick;
+
+	/* The next tick to be processed */
+	uint64_t base;
+
+	/* The tick 'timer' is set to fire on */
+	uint64_t wakeup;
+
+	/* Number of timers in the slots */
+	size_t count;
+
+	/* Expired timers, and the ones being run */
+	isc_job_t job;
+	bool job_scheduled;
+	entrylist_t due;
+	entrylist_t running;
+
+	isc_timerwheel_stats_t stats;
+
+	uint64_t occupied[WHEEL_LEVELS];
+	entrylist_t slots[WHEEL_LEVELS][WHEEL_SLOTS];
+};
+
+static void
+wheel_timer_cb(void *arg);
+
+static uint64_t
+wheel_now(isc_timerwheel_t *wheel) {
+	return (uv_now(&wheel->loop->loop) / wheel->tick);
+}
+
+static void
+wheel_unlink(isc_timerwheel_t *wheel, isc_timerwheel_entry_t *entry) {
+	switch (entry->slot) {
+	case SLOT_DUE:
+		ISC_LIST_UNLINK(wheel->due, entry, link);
+		break;
+	case SLOT_RUNNING:
+		ISC_LIST_UNLINK(wheel->running, entry, link);
+		break;
+	default: {
+		unsigned int level = entry->slot / WHEEL_SLOTS;
+		unsigned int slot = entry->slot % WHEEL_SLOTS;
+
+		INSIST(level < WHEEL_LEVELS);
+
+		ISC_LIST_UNLINK(wheel->slots[level][slot], entry, link);
+		if (ISC_LIST_EMPTY(wheel->slots[level][slot])) {
+			wheel->occupied[level] &= ~(UINT64_C(1) << slot);
+		}
+		wheel->count--;
+		break;
+	}
+	}
+
+	entry->slot = SLOT_NONE;
+}
+
+static void
+wheel_due(void *arg);
+
+static void
+wheel_setdue(isc_timerwheel_t *wheel, isc_timerwheel_entry_t *entry) {
+	entry->slot = SLOT_DUE;
+	ISC_LIST_APPEND(wheel->due, entry, link);
+
+	if (!wheel->job_scheduled) {
+		wheel->job_scheduled = true;
+		isc_timerwheel_ref(wheel);
+		isc_job_run(wheel->loop, &wheel->job, wheel_due, wheel);
+	}
+}
+
+/*
+ * Put 'entry' into the slot where it will be found when the wheel
+ * reaches 'entry->expires', directly or through the cascading of the
+ * higher levels.
+ */
+static void
+wheel_insert(isc_timerwheel_t *wheel, isc_timerwheel_entry_t *entry) {
+	uint64_t expires = entry->expires;
+	uint64_t delta;
+	unsigned int level, slot;
+
+	INSIST(expires >= wheel->base);
+
+	delta = expires - wheel->base;
+	if (delta >= WHEEL_SPAN) {
+		expires = wheel->base + WHEEL_SPAN - 1;
+		delta = WHEEL_SPAN - 1;
+	}
+
+	for (level = 0; level < WHEEL_LEVELS - 1; level++) {
+		if (delta < (UINT64_C(1) << (WHEEL_BITS * (level + 1)))) {
+			break;
+		}
+	}
+
+	slot = (expires >> (WHEEL_BITS * level)) & WHEEL_MASK;
+
+	entry->slot = level * WHEEL_SLOTS + slot;
+	ISC_LIST_APPEND(wheel->slots[level][slot], entry, link);
+	wheel->occupied[level] |= UINT64_C(1) << slot;
+	wheel->count++;
+}
+
+/*
+ * Return the first tick, not before 'wheel->base', at which a slot of
+ * the wheel either expires or cascades; the ticks in between are no-ops
+ * and can be skipped.
+ */
+static uint64_t
+wheel_next(isc_timerwheel_t *wheel) {
+	uint64_t next = NO_WAKEUP;
+
+	for (unsigned int level = 0; level < WHEEL_LEVELS; level++) {
+		uint64_t occupied = wheel->occupied[level];
+		unsigned int shift = WHEEL_BITS * level;
+		uint64_t block, tick;
+		unsigned int idx;
+
+		if (occupied == 0) {
+			continue;
+		}
+
+		/* The slots of the higher levels are processed whole */
+		block = wheel->base >> shift;
+		if ((wheel->base & ((UINT64_C(1) << shift) - 1)) != 0) {
+			block++;
+		}
+
+		/* Rotate the bitmap so that the current slot is bit 0 */
+		idx = block & WHEEL_MASK;
+		occupied = (occupied >> idx) |
+			   (occupied << ((WHEEL_SLOTS - idx) & WHEEL_MASK));
+
+		tick = (block + __builtin_ctzll(occupied)) << shift;
+		if (tick < next) {
+			next = tick;
+		}
+	}
+
+	return (next);
+}
+
+static void
+wheel_cascade(isc_timerwheel_t *wheel, unsigned int level, unsigned int slot) {
+	entrylist_t list = ISC_LIST_INITIALIZER;
+	isc_timerwheel_entry_t *entry = NULL;
+
+	ISC_LIST_MOVE(list, wheel->slots[level][slot]);
+	wheel->occupied[level] &= ~(UINT64_C(1) << slot);
+
+	while ((entry = ISC_LIST_HEAD(list)) != NULL) {
+		ISC_LIST_UNLINK(list, entry, link);
+		wheel->count--;
+		wheel->stats.cascaded++;
+
+		wheel_insert(wheel, entry);
+	}
+}
+
+/*
+ * Process the tick 'wheel->base': cascade the slots of the higher
+ * levels that start at this tick, and move the expired timers to the
+ * due list.
+ */
+static void
+wheel_process(isc_timerwheel_t *wheel) {
+	uint64_t tick = wheel->base;
+	unsigned int slot = tick & WHEEL_MASK;
+	isc_timerwheel_entry_t *entry = NULL;
+
+	for (unsigned int level = 1; level < WHEEL_LEVELS; level++) {
+		unsigned int idx;
+
+		if (((tick >> (WHEEL_BITS * (level - 1))) & WHEEL_MASK) != 0) {
+			break;
+		}
+
+		idx = (tick >> (WHEEL_BITS * level)) & WHEEL_MASK;
+		if ((wheel->occupied[level] & (UINT64_C(1) << idx)) != 0) {
+			wheel_cascade(wheel, level, idx);
+		}
+	}
+
+	while ((entry = ISC_LIST_HEAD(wheel->slots[0][slot])) != NULL) {
+		ISC_LIST_UNLINK(wheel->slots[0][slot], entry, link);
+		INSIST(entry->expires == tick);
+		wheel->count--;
+
+		entry->slot = SLOT_DUE;
+		ISC_LIST_APPEND(wheel->due, entry, link);
+	}
+	wheel->occupied[0] &= ~(UINT64_C(1) << slot);
+}
+
+static void
+wheel_advance(isc_timerwheel_t *wheel, uint64_t now) {
+	while (wheel->count > 0) {
+		uint64_t next = wheel_next(wheel);
+
+		if (next > now) {
+			break;
+		}
+
+		wheel->base = next;
+		wheel_process(wheel);
+		wheel->base++;
+	}
+
+	if (wheel->base <= now) {
+		wheel->base = now + 1;
+	}
+}
+
+static void
+wheel_schedule(isc_timerwheel_t *wheel) {
+	uint64_t next = wheel_next(wheel);
+	uint64_t now, ms;
+	isc_interval_t interval;
+
+	if (next >= wheel->wakeup) {
+		return;
+	}
+
+	now = uv_now(&wheel->loop->loop);
+	ms = next * wheel->tick;
+	ms = (ms > now) ? ms - now : 0;
+
+	isc_interval_set(&interval, ms / MS_PER_SEC,
+			 (ms % MS_PER_SEC) * NS_PER_MS);
+	isc_timer_start(wheel->timer, isc_timertype_once, &interval);
+	wheel->wakeup = next;
+}
+
+/*
+ * Run the expired timers as one batch.  The timers that expire while
+ * the batch is being run are left for the next one.
+ */
+static void
+wheel_run(isc_timerwheel_t *wheel) {
+	isc_timerwheel_entry_t *entry = NULL;
+
+	if (ISC_LIST_EMPTY(wheel->due)) {
+		return;
+	}
+
+	ISC_LIST_MOVE(wheel->running, wheel->due);
+	for (entry = ISC_LIST_HEAD(wheel->running); entry != NULL;
+	     entry = ISC_LIST_NEXT(entry, link))
+	{
+		entry->slot = SLOT_RUNNING;
+	}
+
+	wheel->stats.batches++;
+
+	while ((entry = ISC_LIST_HEAD(wheel->running)) != NULL) {
+		ISC_LIST_UNLINK(wheel->running, entry, link);
+		entry->slot = SLOT_NONE;
+		entry->wheel = NULL;
+
+		wheel->stats.fired++;
+
+		entry->cb(entry->cbarg);
+	}
+}
+
+static void
+wheel_due(void *arg) {
+	isc_timerwheel_t *wheel = arg;
+
+	REQUIRE(VALID_TIMERWHEEL(wheel));
+
+	wheel->job_scheduled = false;
+	wheel_run(wheel);
+
+	isc_timerwheel_unref(wheel);
+}
+
+static void
+wheel_timer_cb(void *arg) {
+	isc_timerwheel_t *wheel = arg;
+
+	REQUIRE(VALID_TIMERWHEEL(wheel));
+
+	isc_timerwheel_ref(wheel);
+
+	wheel->wakeup = NO_WAKEUP;
+	wheel_advance(wheel, wheel_now(wheel));
+	wheel_run(wheel);
+	wheel_schedule(wheel);
+
+	isc_timerwheel_unref(wheel);
+}
+
+void
+isc_timerwheel_create(isc_loop_t *loop, uint32_t tick,
+		      isc_timerwheel_t **wheelp) {
+	isc_timerwheel_t *wheel = NULL;
+
+	REQUIRE(VALID_LOOP(loop));
+	REQUIRE(loop == isc_loop());
+	REQUIRE(tick > 0);
+	REQUIRE(wheelp != NULL && *wheelp == NULL);
+
+	wheel = isc_mem_get(loop->mctx, sizeof(*wheel));
+	*wheel = (isc_timerwheel_t){
+		.tick = tick,
+		.wakeup = NO_WAKEUP,
+		.job = ISC_JOB_INITIALIZER,
+		.due = ISC_LIST_INITIALIZER,
+		.running = ISC_LIST_INITIALIZER,
+	};
+
+	for (size_t i = 0; i < WHEEL_LEVELS; i++) {
+		for (size_t j = 0; j < WHEEL_SLOTS; j++) {
+			ISC_LIST_INIT(wheel->slots[i][j]);
+		}
+	}
+
+	isc_refcount_init(&wheel->references, 1);
+	isc_mem_attach(loop->mctx, &wheel->mctx);
+	isc_loop_attach(loop, &wheel->loop);
+	isc_timer_create(loop, wheel_timer_cb, wheel, &wheel->timer);
+
+	wheel->base = wheel_now(wheel) + 1;
+	wheel->magic = TIMERWHEEL_MAGIC;
+
+	*wheelp = wheel;
+}
+
+void
+isc_timerwheel_entryinit(isc_timerwheel_entry_t *entry, isc_job_cb cb,
+			 void *cbarg) {
+	REQUIRE(entry != NULL);
+	REQUIRE(cb != NULL);
+
+	*entry = (isc_timerwheel_entry_t){
+		.cb = cb,
+		.cbarg = cbarg,
+		.slot = SLOT_NONE,
+		.link = ISC_LINK_INITIALIZER,
+	};
+}
+
+void
+isc_timerwheel_arm(isc_timerwheel_t *wheel, isc_timerwheel_entry_t *entry,
+		   const isc_interval_t *interval) {
+	uint64_t now, ms = 0;
+
+	REQUIRE(VALID_TIMERWHEEL(wheel));
+	REQUIRE(wheel->loop == isc_loop());
+	REQUIRE(entry != NULL && entry->cb != NULL);
+	REQUIRE(entry->wheel == NULL || entry->wheel == wheel);
+
+	if (entry->wheel != NULL) {
+		wheel_unlink(wheel, entry);
+	}
+
+	if (interval != NULL) {
+		ms = isc_interval_ms(interval);
+	}
+
+	/* Never expire early, round the expiration up to the next tick */
+	now = uv_now(&wheel->loop->loop);
+	entry->expires = (now + ms + wheel->tick - 1) / wheel->tick;
+	entry->wheel = wheel;
+
+	wheel->stats.armed++;
+
+	if (entry->expires <= now / wheel->tick) {
+		wheel_setdue(wheel, entry);
+		return;
+	}
+
+	if (wheel->count == 0) {
+		/* Nothing to catch up with */
+		wheel->base = now / wheel->tick + 1;
+	}
+
+	wheel_insert(wheel, entry);
+	wheel_schedule(wheel);
+}
+
+void
+isc_timerwheel_cancel(isc_timerwheel_entry_t *entry) {
+	isc_timerwheel_t *wheel = NULL;
+
+	REQUIRE(entry != NULL);
+
+	wheel = entry->wheel;
+	if (wheel == NULL) {
+		return;
+	}
+
+	REQUIRE(VALID_TIMERWHEEL(wheel));
+	REQUIRE(wheel->loop == isc_loop());
+
+	wheel_unlink(wheel, entry);
+	entry->wheel = NULL;
+
+	wheel->stats.canceled++;
+}
+
+bool
+isc_timerwheel_armed(const isc_timerwheel_entry_t *entry) {
+	REQUIRE(entry != NULL);
+
+	return (entry->wheel != NULL);
+}
+
+void
+isc_timerwheel_getstats(isc_timerwheel_t *wheel,
+			isc_timerwheel_stats_t *stats) {
+	REQUIRE(VALID_TIMERWHEEL(wheel));
+	REQUIRE(wheel->loop == isc_loop());
+	REQUIRE(stats != NULL);
+
+	*stats = wheel->stats;
+}
+
+static void
+timerwheel_free(void *arg) {
+	isc_timerwheel_t *wheel = arg;
+	isc_loop_t *loop = wheel->loop;
+
+	isc_timer_destroy(&wheel->timer);
+	isc_loop_detach(&loop);
+	isc_mem_putanddetach(&wheel->mctx, wheel, sizeof(*wheel));
+}
+
+static void
+timerwheel_destroy(isc_timerwheel_t *wheel) {
+	REQUIRE(wheel->count == 0);
+	REQUIRE(ISC_LIST_EMPTY(wheel->due));
+	REQUIRE(ISC_LIST_EMPTY(wheel->running));
+	INSIST(!wheel->job_scheduled);
+
+	wheel->magic = 0;
+
+	isc_refcount_destroy(&wheel->references);
+
+	if (wheel->loop == isc_loop()) {
+		timerwheel_free(wheel);
+	} else {
+		isc_async_run(wheel->loop, timerwheel_free, wheel);
+	}
+}
+
+ISC_REFCOUNT_IMPL(isc_timerwheel, timerwheel_destroy);
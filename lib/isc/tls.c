@@ -20,6 +20,10 @@
 #include <nghttp2/nghttp2.h>
 #endif /* HAVE_LIBNGHTTP2 */
 #include <arpa/inet.h>
+#if HAVE_LINUX_TLS_H
+#include <linux/tls.h>
+#include <netinet/tcp.h>
+#endif /* HAVE_LINUX_TLS_H */
 
 #include <openssl/bn.h>
 #include <openssl/conf.h>
@@ -27,18 +31,29 @@
 #include <openssl/dh.h>
 #include <openssl/err.h>
 #include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/kdf.h>
 #include <openssl/opensslv.h>
 #include <openssl/rand.h>
 #include <openssl/rsa.h>
 #include <openssl/x509_vfy.h>
 #include <openssl/x509v3.h>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#include <openssl/params.h>
+#endif /* OPENSSL_VERSION_NUMBER >= 0x30000000L */
 
 #include <isc/atomic.h>
+#include <isc/buffer.h>
 #include <isc/crypto.h>
+#include <isc/errno.h>
 #include <isc/fips.h>
+#include <isc/hex.h>
+#include <isc/hmac.h>
 #include <isc/ht.h>
 #include <isc/log.h>
 #include <isc/magic.h>
+#include <isc/md.h>
 #include <isc/mem.h>
 #include <isc/mutex.h>
 #include <isc/mutexblock.h>
@@ -46,7 +61,9 @@
 #include <isc/random.h>
 #include <isc/refcount.h>
 #include <isc/rwlock.h>
+#include <isc/safe.h>
 #include <isc/sockaddr.h>
+#include <isc/stdtime.h>
 #include <isc/thread.h>
 #include <isc/tls.h>
 #include <isc/util.h>
@@ -617,6 +634,729 @@ isc_tlsctx_session_tickets(isc_tlsctx_t *ctx, const bool use) {
 	}
 }
 
+/*
+ * TLS session ticket keys management.
+ */
+
+#define TLS_TICKETKEYS_MAGIC	ISC_MAGIC('T', 'k', 'e', 'y')
+#define VALID_TLS_TICKETKEYS(t) ISC_MAGIC_VALID(t, TLS_TICKETKEYS_MAGIC)
+
+#define TICKETKEY_NAME_LEN   16
+#define TICKETKEY_SECRET_LEN 32
+
+/*
+ * The number of keys kept: the current one, used to encrypt new tickets,
+ * and the previous ones, still accepted for decryption so that the
+ * tickets issued shortly before a rotation stay usable.
+ */
+#define TICKETKEYS_MAX 3
+
+typedef struct tls_ticketkey {
+	uint8_t name[TICKETKEY_NAME_LEN];
+	uint8_t aes_key[TICKETKEY_SECRET_LEN];
+	uint8_t hmac_key[TICKETKEY_SECRET_LEN];
+	isc_stdtime_t created;
+} tls_ticketkey_t;
+
+struct isc_tlsctx_ticketkeys {
+	unsigned int magic;
+	isc_mem_t *mctx;
+	isc_refcount_t references;
+	isc_rwlock_t lock;
+	uint32_t lifetime;
+	/* keys[0] is the current key, followed by the older ones */
+	tls_ticketkey_t keys[TICKETKEYS_MAX];
+	size_t nkeys;
+	/* secret used to derive stable session ID contexts */
+	uint8_t sid_secret[TICKETKEY_SECRET_LEN];
+	atomic_uint_fast64_t issued;
+	atomic_uint_fast64_t resumed;
+	atomic_uint_fast64_t renewed;
+	atomic_uint_fast64_t rejected;
+	atomic_uint_fast64_t rotations;
+};
+
+static isc_once_t ticketkeys_once = ISC_ONCE_INIT;
+static int ticketkeys_exidx = -1;
+
+static void
+ticketkeys_exfree(void *parent ISC_ATTR_UNUSED, void *ptr,
+		  CRYPTO_EX_DATA *ad ISC_ATTR_UNUSED, int idx ISC_ATTR_UNUSED,
+		  long argl ISC_ATTR_UNUSED, void *argp ISC_ATTR_UNUSED) {
+	isc_tlsctx_ticketkeys_t *keys = ptr;
+
+	if (keys != NULL) {
+		isc_tlsctx_ticketkeys_detach(&keys);
+	}
+}
+
+static void
+ticketkeys_initialize(void) {
+	ticketkeys_exidx = SSL_CTX_get_ex_new_index(0, NULL, NULL, NULL,
+						    ticketkeys_exfree);
+	RUNTIME_CHECK(ticketkeys_exidx >= 0);
+}
+
+static void
+ticketkey_generate(tls_ticketkey_t *key, isc_stdtime_t now) {
+	RUNTIME_CHECK(RAND_bytes(key->name, sizeof(key->name)) == 1);
+	RUNTIME_CHECK(RAND_bytes(key->aes_key, sizeof(key->aes_key)) == 1);
+	RUNTIME_CHECK(RAND_bytes(key->hmac_key, sizeof(key->hmac_key)) == 1);
+	key->created = now;
+}
+
+/*
+ * Generate a new current key, retiring the oldest one if needed.
+ * Requires the write lock.
+ */
+static void
+ticketkeys_rotate(isc_tlsctx_ticketkeys_t *keys, isc_stdtime_t now) {
+	if (keys->nkeys < TICKETKEYS_MAX) {
+		keys->nkeys++;
+	}
+	memmove(&keys->keys[1], &keys->keys[0],
+		(keys->nkeys - 1) * sizeof(keys->keys[0]));
+	ticketkey_generate(&keys->keys[0], now);
+
+	atomic_fetch_add_relaxed(&keys->rotations, 1);
+}
+
+static bool
+ticketkeys_expired(isc_tlsctx_ticketkeys_t *keys, isc_stdtime_t now) {
+	return (keys->lifetime > 0 &&
+		now - keys->keys[0].created >= keys->lifetime);
+}
+
+/*
+ * Make sure the current key is not older than the configured lifetime.
+ * This is done lazily from the ticket callback, so no timer is needed
+ * and idle contexts don't rotate keys needlessly.
+ */
+static void
+ticketkeys_maybe_rotate(isc_tlsctx_ticketkeys_t *keys, isc_stdtime_t now) {
+	bool expired;
+
+	RWLOCK(&keys->lock, isc_rwlocktype_read);
+	expired = ticketkeys_expired(keys, now);
+	RWUNLOCK(&keys->lock, isc_rwlocktype_read);
+
+	if (!expired) {
+		return;
+	}
+
+	RWLOCK(&keys->lock, isc_rwlocktype_write);
+	if (ticketkeys_expired(keys, now)) {
+		if (now - keys->keys[0].created >=
+		    (uint64_t)keys->lifetime * TICKETKEYS_MAX)
+		{
+			/* All the keys are too old to be used */
+			isc_safe_memwipe(keys->keys, sizeof(keys->keys));
+			keys->nkeys = 0;
+		}
+		ticketkeys_rotate(keys, now);
+	}
+	RWUNLOCK(&keys->lock, isc_rwlocktype_write);
+}
+
+void
+isc_tlsctx_ticketkeys_create(isc_mem_t *mctx, uint32_t lifetime,
+			     isc_tlsctx_ticketkeys_t **keysp) {
+	isc_tlsctx_ticketkeys_t *keys = NULL;
+
+	REQUIRE(mctx != NULL);
+	REQUIRE(keysp != NULL && *keysp == NULL);
+
+	isc_once_do(&ticketkeys_once, ticketkeys_initialize);
+
+	keys = isc_mem_get(mctx, sizeof(*keys));
+	*keys = (isc_tlsctx_ticketkeys_t){
+		.lifetime = lifetime,
+	};
+
+	isc_mem_attach(mctx, &keys->mctx);
+	isc_refcount_init(&keys->references, 1);
+	isc_rwlock_init(&keys->lock);
+	RUNTIME_CHECK(RAND_bytes(keys->sid_secret, sizeof(keys->sid_secret)) ==
+		      1);
+
+	ticketkey_generate(&keys->keys[0], isc_stdtime_now());
+	keys->nkeys = 1;
+
+	keys->magic = TLS_TICKETKEYS_MAGIC;
+	*keysp = keys;
+}
+
+void
+isc_tlsctx_ticketkeys_attach(isc_tlsctx_ticketkeys_t *source,
+			     isc_tlsctx_ticketkeys_t **targetp) {
+	REQUIRE(VALID_TLS_TICKETKEYS(source));
+	REQUIRE(targetp != NULL && *targetp == NULL);
+
+	isc_refcount_increment(&source->references);
+
+	*targetp = source;
+}
+
+void
+isc_tlsctx_ticketkeys_detach(isc_tlsctx_ticketkeys_t **keysp) {
+	isc_tlsctx_ticketkeys_t *keys = NULL;
+
+	REQUIRE(keysp != NULL);
+	keys = *keysp;
+	*keysp = NULL;
+	REQUIRE(VALID_TLS_TICKETKEYS(keys));
+
+	if (isc_refcount_decrement(&keys->references) != 1) {
+		return;
+	}
+
+	isc_refcount_destroy(&keys->references);
+	keys->magic = 0;
+
+	isc_safe_memwipe(keys->keys, sizeof(keys->keys));
+	isc_safe_memwipe(keys->sid_secret, sizeof(keys->sid_secret));
+	isc_rwlock_destroy(&keys->lock);
+	isc_mem_putanddetach(&keys->mctx, keys, sizeof(*keys));
+}
+
+void
+isc_tlsctx_ticketkeys_setlifetime(isc_tlsctx_ticketkeys_t *keys,
+				  uint32_t lifetime) {
+	REQUIRE(VALID_TLS_TICKETKEYS(keys));
+
+	RWLOCK(&keys->lock, isc_rwlocktype_write);
+	keys->lifetime = lifetime;
+	RWUNLOCK(&keys->lock, isc_rwlocktype_write);
+}
+
+void
+isc_tlsctx_ticketkeys_rotate(isc_tlsctx_ticketkeys_t *keys) {
+	REQUIRE(VALID_TLS_TICKETKEYS(keys));
+
+	RWLOCK(&keys->lock, isc_rwlocktype_write);
+	ticketkeys_rotate(keys, isc_stdtime_now());
+	RWUNLOCK(&keys->lock, isc_rwlocktype_write);
+}
+
+void
+isc_tlsctx_ticketkeys_getstats(isc_tlsctx_ticketkeys_t *keys,
+			       isc_tlsctx_ticketkeys_stats_t *stats) {
+	REQUIRE(VALID_TLS_TICKETKEYS(keys));
+	REQUIRE(stats != NULL);
+
+	*stats = (isc_tlsctx_ticketkeys_stats_t){
+		.issued = atomic_load_relaxed(&keys->issued),
+		.resumed = atomic_load_relaxed(&keys->resumed),
+		.renewed = atomic_load_relaxed(&keys->renewed),
+		.rejected = atomic_load_relaxed(&keys->rejected),
+		.rotations = atomic_load_relaxed(&keys->rotations),
+	};
+}
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+typedef EVP_MAC_CTX ticketkeys_hmac_ctx_t;
+
+static int
+ticketkeys_hmac_init(ticketkeys_hmac_ctx_t *hctx, uint8_t *key) {
+	OSSL_PARAM params[] = {
+		OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, key,
+						  TICKETKEY_SECRET_LEN),
+		OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST,
+						 (char *)"SHA256", 0),
+		OSSL_PARAM_construct_end(),
+	};
+
+	return (EVP_MAC_CTX_set_params(hctx, params));
+}
+#else  /* OPENSSL_VERSION_NUMBER >= 0x30000000L */
+typedef HMAC_CTX ticketkeys_hmac_ctx_t;
+
+static int
+ticketkeys_hmac_init(ticketkeys_hmac_ctx_t *hctx, uint8_t *key) {
+	return (HMAC_Init_ex(hctx, key, TICKETKEY_SECRET_LEN, EVP_sha256(),
+			     NULL));
+}
+#endif /* OPENSSL_VERSION_NUMBER >= 0x30000000L */
+
+/*
+ * Session ticket key callback, see the OpenSSL documentation for
+ * 'SSL_CTX_set_tlsext_ticket_key_evp_cb()'.  It might be called from
+ * any of the worker threads.
+ */
+static int
+ticketkeys_cb(SSL *ssl, unsigned char key_name[TICKETKEY_NAME_LEN],
+	      unsigned char *iv, EVP_CIPHER_CTX *cctx,
+	      ticketkeys_hmac_ctx_t *hctx, int enc) {
+	isc_tlsctx_ticketkeys_t *keys = NULL;
+	const EVP_CIPHER *cipher = EVP_aes_256_cbc();
+	tls_ticketkey_t key = { .created = 0 };
+	bool found = false;
+	size_t i = 0;
+	int ret = 1;
+
+	keys = SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), ticketkeys_exidx);
+	INSIST(VALID_TLS_TICKETKEYS(keys));
+
+	ticketkeys_maybe_rotate(keys, isc_stdtime_now());
+
+	RWLOCK(&keys->lock, isc_rwlocktype_read);
+	if (enc) {
+		key = keys->keys[0];
+		found = true;
+	} else {
+		for (i = 0; i < keys->nkeys; i++) {
+			if (memcmp(key_name, keys->keys[i].name,
+				   TICKETKEY_NAME_LEN) == 0)
+			{
+				key = keys->keys[i];
+				found = true;
+				break;
+			}
+		}
+	}
+	RWUNLOCK(&keys->lock, isc_rwlocktype_read);
+
+	if (enc) {
+		memmove(key_name, key.name, TICKETKEY_NAME_LEN);
+		if (RAND_bytes(iv, EVP_CIPHER_iv_length(cipher)) != 1 ||
+		    EVP_EncryptInit_ex(cctx, cipher, NULL, key.aes_key, iv) !=
+			    1 ||
+		    ticketkeys_hmac_init(hctx, key.hmac_key) != 1)
+		{
+			ret = -1;
+			goto done;
+		}
+		atomic_fetch_add_relaxed(&keys->issued, 1);
+	} else if (!found) {
+		/* Unknown or retired key: do a full handshake. */
+		atomic_fetch_add_relaxed(&keys->rejected, 1);
+		return (0);
+	} else {
+		if (EVP_DecryptInit_ex(cctx, cipher, NULL, key.aes_key, iv) !=
+			    1 ||
+		    ticketkeys_hmac_init(hctx, key.hmac_key) != 1)
+		{
+			ret = -1;
+			goto done;
+		}
+		atomic_fetch_add_relaxed(&keys->resumed, 1);
+		if (i != 0) {
+			/* Encrypted with an older key: issue a new ticket. */
+			atomic_fetch_add_relaxed(&keys->renewed, 1);
+			ret = 2;
+		}
+	}
+
+done:
+	isc_safe_memwipe(&key, sizeof(key));
+	return (ret);
+}
+
+void
+isc_tlsctx_set_ticketkeys(isc_tlsctx_t *ctx, isc_tlsctx_ticketkeys_t *keys,
+			  const char *const *sid_ctx) {
+	isc_tlsctx_ticketkeys_t *attached = NULL, *old = NULL;
+	isc_hmac_t *hmac = NULL;
+	uint8_t digest[ISC_MAX_MD_SIZE];
+	unsigned int digestlen = sizeof(digest);
+
+	REQUIRE(ctx != NULL);
+	REQUIRE(VALID_TLS_TICKETKEYS(keys));
+	REQUIRE(sid_ctx != NULL && sid_ctx[0] != NULL);
+
+	/*
+	 * The session ID context has to stay the same across TLS contexts
+	 * created for the same purpose (e.g. when reconfiguring), otherwise
+	 * OpenSSL refuses to resume the sessions from the tickets.  The
+	 * terminating NUL of each string separates it from the next one.
+	 */
+	hmac = isc_hmac_new();
+	RUNTIME_CHECK(isc_hmac_init(hmac, keys->sid_secret,
+				    sizeof(keys->sid_secret),
+				    ISC_MD_SHA256) == ISC_R_SUCCESS);
+	for (size_t i = 0; sid_ctx[i] != NULL; i++) {
+		RUNTIME_CHECK(isc_hmac_update(hmac,
+					      (const unsigned char *)sid_ctx[i],
+					      strlen(sid_ctx[i]) + 1) ==
+			      ISC_R_SUCCESS);
+	}
+	RUNTIME_CHECK(isc_hmac_final(hmac, digest, &digestlen) ==
+		      ISC_R_SUCCESS);
+	isc_hmac_free(hmac);
+
+	RUNTIME_CHECK(SSL_CTX_set_session_id_context(
+			      ctx, digest,
+			      ISC_MIN(digestlen, SSL_MAX_SID_CTX_LENGTH)) == 1);
+
+	isc_tlsctx_ticketkeys_attach(keys, &attached);
+	old = SSL_CTX_get_ex_data(ctx, ticketkeys_exidx);
+	RUNTIME_CHECK(SSL_CTX_set_ex_data(ctx, ticketkeys_exidx, attached) ==
+		      1);
+	if (old != NULL) {
+		isc_tlsctx_ticketkeys_detach(&old);
+	}
+
+	/* Tickets must not outlive the keys used to encrypt them */
+	if (keys->lifetime > 0) {
+		(void)SSL_CTX_set_timeout(ctx, keys->lifetime);
+	}
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+	RUNTIME_CHECK(SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx,
+							   ticketkeys_cb) == 1);
+#else  /* OPENSSL_VERSION_NUMBER >= 0x30000000L */
+	RUNTIME_CHECK(SSL_CTX_set_tlsext_ticket_key_cb(ctx, ticketkeys_cb) ==
+		      1);
+#endif /* OPENSSL_VERSION_NUMBER >= 0x30000000L */
+
+	isc_tlsctx_session_tickets(ctx, true);
+}
+
+/*
+ * Kernel TLS transmit offload.
+ *
+ * The TLS streams in the network manager feed OpenSSL through memory
+ * BIOs, so OpenSSL cannot hand the connections over to the kernel by
+ * itself.  Instead, the server application traffic secret is captured
+ * through the key log callback, a KeyUpdate message is sent right after
+ * the handshake so that the record sequence number is known to be zero,
+ * and the keys derived from the updated secret (RFC 8446, Section 7.2)
+ * are installed on the socket.  From then on, whatever is written to the
+ * socket is encrypted by the kernel.  Only TLS 1.3 is supported, as
+ * there is no way to learn the current record sequence number otherwise.
+ */
+#if HAVE_LINUX_TLS_H && defined(TLS_1_3_VERSION) && defined(TLS_TX)
+#define HAVE_KTLS 1
+
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif /* SOL_TLS */
+
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif /* TCP_ULP */
+
+#define KTLS_SECRET_LABEL "SERVER_TRAFFIC_SECRET_0 "
+
+typedef struct ktls_secret {
+	size_t len;
+	uint8_t secret[EVP_MAX_MD_SIZE];
+} ktls_secret_t;
+
+static isc_once_t ktls_once = ISC_ONCE_INIT;
+static int ktls_exidx = -1;
+
+static void
+ktls_exfree(void *parent ISC_ATTR_UNUSED, void *ptr,
+	    CRYPTO_EX_DATA *ad ISC_ATTR_UNUSED, int idx ISC_ATTR_UNUSED,
+	    long argl ISC_ATTR_UNUSED, void *argp ISC_ATTR_UNUSED) {
+	if (ptr != NULL) {
+		OPENSSL_clear_free(ptr, sizeof(ktls_secret_t));
+	}
+}
+
+static void
+ktls_initialize(void) {
+	ktls_exidx = SSL_get_ex_new_index(0, NULL, NULL, NULL, ktls_exfree);
+	RUNTIME_CHECK(ktls_exidx >= 0);
+}
+
+static void
+ktls_keylog(const SSL *ssl, const char *line) {
+	SSL *tls = UNCONST(ssl);
+	ktls_secret_t *secret = NULL;
+	const char *hex = NULL;
+	isc_buffer_t b;
+
+	if (getenv("SSLKEYLOGFILE") != NULL) {
+		sslkeylogfile_append(ssl, line);
+	}
+
+	if (strncmp(line, KTLS_SECRET_LABEL, strlen(KTLS_SECRET_LABEL)) != 0)
+	{
+		return;
+	}
+
+	/* "SERVER_TRAFFIC_SECRET_0 <client random> <secret>" */
+	hex = strrchr(line, ' ');
+	if (hex == NULL) {
+		return;
+	}
+
+	secret = OPENSSL_zalloc(sizeof(*secret));
+	if (secret == NULL) {
+		return;
+	}
+
+	isc_buffer_init(&b, secret->secret, sizeof(secret->secret));
+	if (isc_hex_decodestring(hex + 1, &b) != ISC_R_SUCCESS) {
+		OPENSSL_clear_free(secret, sizeof(*secret));
+		return;
+	}
+	secret->len = isc_buffer_usedlength(&b);
+
+	ktls_exfree(NULL, SSL_get_ex_data(tls, ktls_exidx), NULL, 0, 0, NULL);
+	if (SSL_set_ex_data(tls, ktls_exidx, secret) != 1) {
+		OPENSSL_clear_free(secret, sizeof(*secret));
+	}
+}
+
+/*
+ * HKDF-Expand-Label() from RFC 8446, Section 7.1, with an empty context.
+ */
+static bool
+ktls_expand_label(const EVP_MD *md, const uint8_t *secret, size_t secretlen,
+		  const char *label, uint8_t *out, size_t outlen) {
+	const char prefix[] = "tls13 ";
+	uint8_t info[2 + 1 + 255 + 1];
+	size_t labellen = strlen(prefix) + strlen(label);
+	size_t infolen = 0;
+	EVP_PKEY_CTX *pctx = NULL;
+	bool ret = false;
+
+	INSIST(labellen <= 255);
+
+	info[infolen++] = (outlen >> 8) & 0xff;
+	info[infolen++] = outlen & 0xff;
+	info[infolen++] = labellen;
+	memmove(&info[infolen], prefix, strlen(prefix));
+	infolen += strlen(prefix);
+	memmove(&info[infolen], label, strlen(label));
+	infolen += strlen(label);
+	info[infolen++] = 0;
+
+	pctx = EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, NULL);
+	if (pctx == NULL) {
+		return (false);
+	}
+
+	if (EVP_PKEY_derive_init(pctx) == 1 &&
+	    EVP_PKEY_CTX_hkdf_mode(pctx, EVP_PKEY_HKDEF_MODE_EXPAND_ONLY) ==
+		    1 &&
+	    EVP_PKEY_CTX_set_hkdf_md(pctx, md) == 1 &&
+	    EVP_PKEY_CTX_set1_hkdf_key(pctx, secret, secretlen) == 1 &&
+	    EVP_PKEY_CTX_add1_hkdf_info(pctx, info, infolen) == 1 &&
+	    EVP_PKEY_derive(pctx, out, &outlen) == 1)
+	{
+		ret = true;
+	}
+
+	EVP_PKEY_CTX_free(pctx);
+
+	return (ret);
+}
+
+/*
+ * Return the cipher type known to the kernel and the parameters of the
+ * TLS 1.3 cipher suite negotiated for 'tls', or 0 if the suite cannot
+ * be offloaded.
+ */
+static int
+ktls_cipher(isc_tls_t *tls, const EVP_MD **mdp, size_t *keylenp) {
+	const SSL_CIPHER *cipher = SSL_get_current_cipher(tls);
+
+	if (cipher == NULL) {
+		return (0);
+	}
+
+	switch (SSL_CIPHER_get_id(cipher)) {
+	case TLS1_3_CK_AES_128_GCM_SHA256:
+		*mdp = EVP_sha256();
+		*keylenp = TLS_CIPHER_AES_GCM_128_KEY_SIZE;
+		return (TLS_CIPHER_AES_GCM_128);
+	case TLS1_3_CK_AES_256_GCM_SHA384:
+		*mdp = EVP_sha384();
+		*keylenp = TLS_CIPHER_AES_GCM_256_KEY_SIZE;
+		return (TLS_CIPHER_AES_GCM_256);
+#ifdef TLS_CIPHER_CHACHA20_POLY1305
+	case TLS1_3_CK_CHACHA20_POLY1305_SHA256:
+		*mdp = EVP_sha256();
+		*keylenp = TLS_CIPHER_CHACHA20_POLY1305_KEY_SIZE;
+		return (TLS_CIPHER_CHACHA20_POLY1305);
+#endif /* TLS_CIPHER_CHACHA20_POLY1305 */
+	default:
+		return (0);
+	}
+}
+#endif /* HAVE_LINUX_TLS_H && defined(TLS_1_3_VERSION) && defined(TLS_TX) */
+
+void
+isc_tlsctx_enable_ktls(isc_tlsctx_t *ctx) {
+	REQUIRE(ctx != NULL);
+
+#if HAVE_KTLS
+	isc_once_do(&ktls_once, ktls_initialize);
+	SSL_CTX_set_keylog_callback(ctx, ktls_keylog);
+#endif /* HAVE_KTLS */
+}
+
+bool
+isc_tls_ktls_prepare(isc_tls_t *tls) {
+	REQUIRE(tls != NULL);
+
+#if HAVE_KTLS
+	ktls_secret_t *secret = NULL;
+	const EVP_MD *md = NULL;
+	size_t keylen = 0;
+	uint8_t updated[EVP_MAX_MD_SIZE];
+
+	if (SSL_CTX_get_keylog_callback(SSL_get_SSL_CTX(tls)) != ktls_keylog ||
+	    !SSL_is_server(tls) || SSL_version(tls) != TLS1_3_VERSION ||
+	    ktls_cipher(tls, &md, &keylen) == 0)
+	{
+		goto done;
+	}
+
+	secret = SSL_get_ex_data(tls, ktls_exidx);
+	if (secret == NULL || secret->len != (size_t)EVP_MD_size(md)) {
+		goto done;
+	}
+
+	/* The next application traffic secret, see RFC 8446, Section 7.2 */
+	if (!ktls_expand_label(md, secret->secret, secret->len, "traffic upd",
+			       updated, secret->len))
+	{
+		goto done;
+	}
+
+	/*
+	 * Send the KeyUpdate now; it is the last record encrypted by
+	 * OpenSSL.
+	 */
+	if (SSL_key_update(tls, SSL_KEY_UPDATE_NOT_REQUESTED) != 1 ||
+	    SSL_do_handshake(tls) != 1)
+	{
+		ERR_clear_error();
+		goto done;
+	}
+
+	memmove(secret->secret, updated, secret->len);
+	isc_safe_memwipe(updated, sizeof(updated));
+
+	return (true);
+
+done:
+	isc_safe_memwipe(updated, sizeof(updated));
+	/* The secret is not needed anymore */
+	if (secret != NULL) {
+		(void)SSL_set_ex_data(tls, ktls_exidx, NULL);
+		ktls_exfree(NULL, secret, NULL, 0, 0, NULL);
+	}
+	return (false);
+#else  /* HAVE_KTLS */
+	return (false);
+#endif /* HAVE_KTLS */
+}
+
+isc_result_t
+isc_tls_ktls_install(isc_tls_t *tls, int fd) {
+	REQUIRE(tls != NULL);
+	REQUIRE(fd >= 0);
+
+#if HAVE_KTLS
+	ktls_secret_t *secret = SSL_get_ex_data(tls, ktls_exidx);
+	const EVP_MD *md = NULL;
+	size_t keylen = 0;
+	uint8_t key[TLS_CIPHER_AES_GCM_256_KEY_SIZE];
+	uint8_t iv[TLS_CIPHER_AES_GCM_128_SALT_SIZE +
+		   TLS_CIPHER_AES_GCM_128_IV_SIZE];
+	union {
+		struct tls_crypto_info info;
+		struct tls12_crypto_info_aes_gcm_128 aes_gcm_128;
+		struct tls12_crypto_info_aes_gcm_256 aes_gcm_256;
+#ifdef TLS_CIPHER_CHACHA20_POLY1305
+		struct tls12_crypto_info_chacha20_poly1305 chacha20_poly1305;
+#endif /* TLS_CIPHER_CHACHA20_POLY1305 */
+	} crypto = { 0 };
+	socklen_t cryptolen = 0;
+	isc_result_t result = ISC_R_NOTIMPLEMENTED;
+	int cipher;
+
+	STATIC_ASSERT(sizeof(iv) == 12, "TLS 1.3 AEAD nonce size mismatch");
+
+	REQUIRE(secret != NULL);
+
+	cipher = ktls_cipher(tls, &md, &keylen);
+	INSIST(cipher != 0 && keylen <= sizeof(key));
+
+	if (!ktls_expand_label(md, secret->secret, secret->len, "key", key,
+			       keylen) ||
+	    !ktls_expand_label(md, secret->secret, secret->len, "iv", iv,
+			       sizeof(iv)))
+	{
+		result = ISC_R_TLSERROR;
+		goto cleanup;
+	}
+
+	crypto.info.version = TLS_1_3_VERSION;
+	crypto.info.cipher_type = cipher;
+
+	/* The record sequence number is zero after the KeyUpdate */
+	switch (cipher) {
+	case TLS_CIPHER_AES_GCM_128:
+		memmove(crypto.aes_gcm_128.key, key, keylen);
+		memmove(crypto.aes_gcm_128.salt, iv,
+			TLS_CIPHER_AES_GCM_128_SALT_SIZE);
+		memmove(crypto.aes_gcm_128.iv,
+			iv + TLS_CIPHER_AES_GCM_128_SALT_SIZE,
+			TLS_CIPHER_AES_GCM_128_IV_SIZE);
+		cryptolen = sizeof(crypto.aes_gcm_128);
+		break;
+	case TLS_CIPHER_AES_GCM_256:
+		memmove(crypto.aes_gcm_256.key, key, keylen);
+		memmove(crypto.aes_gcm_256.salt, iv,
+			TLS_CIPHER_AES_GCM_256_SALT_SIZE);
+		memmove(crypto.aes_gcm_256.iv,
+			iv + TLS_CIPHER_AES_GCM_256_SALT_SIZE,
+			TLS_CIPHER_AES_GCM_256_IV_SIZE);
+		cryptolen = sizeof(crypto.aes_gcm_256);
+		break;
+#ifdef TLS_CIPHER_CHACHA20_POLY1305
+	case TLS_CIPHER_CHACHA20_POLY1305:
+		memmove(crypto.chacha20_poly1305.key, key, keylen);
+		memmove(crypto.chacha20_poly1305.iv, iv, sizeof(iv));
+		cryptolen = sizeof(crypto.chacha20_poly1305);
+		break;
+#endif /* TLS_CIPHER_CHACHA20_POLY1305 */
+	default:
+		UNREACHABLE();
+	}
+
+	if (setsockopt(fd, SOL_TCP, TCP_ULP, "tls", sizeof("tls")) != 0 ||
+	    setsockopt(fd, SOL_TLS, TLS_TX, &crypto, cryptolen) != 0)
+	{
+		switch (errno) {
+		case ENOENT:
+		case ENOPROTOOPT:
+		case EOPNOTSUPP:
+		case EINVAL:
+			/* The kernel lacks the "tls" module or the cipher */
+			result = ISC_R_NOTIMPLEMENTED;
+			break;
+		default:
+			result = isc_errno_toresult(errno);
+			break;
+		}
+		goto cleanup;
+	}
+
+	result = ISC_R_SUCCESS;
+
+cleanup:
+	isc_safe_memwipe(&crypto, sizeof(crypto));
+	isc_safe_memwipe(key, sizeof(key));
+	isc_safe_memwipe(iv, sizeof(iv));
+	(void)SSL_set_ex_data(tls, ktls_exidx, NULL);
+	ktls_exfree(NULL, secret, NULL, 0, 0, NULL);
+
+	return (result);
+#else  /* HAVE_KTLS */
+	UNUSED(fd);
+
+	return (ISC_R_NOTIMPLEMENTED);
+#endif /* HAVE_KTLS */
+}
+
 isc_tls_t *
 isc_tls_create(isc_tlsctx_t *ctx) {
 	isc_tls_t *newctx = NULL;
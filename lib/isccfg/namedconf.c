@@ -137,6 +137,7 @@ static cfg_type_t cfg_type_server_key_kludge;
 static cfg_type_t cfg_type_size;
 static cfg_type_t cfg_type_sizenodefault;
 static cfg_type_t cfg_type_sizeorpercent;
+static cfg_type_t cfg_type_sizeorpercentnodefault;
 static cfg_type_t cfg_type_sizeval;
 static cfg_type_t cfg_type_sockaddr4wild;
 static cfg_type_t cfg_type_sockaddr6wild;
@@ -1286,6 +1287,7 @@ static cfg_clausedef_t options_clauses[] = {
 	{ "host-statistics-max", NULL, CFG_CLAUSEFLAG_ANCIENT },
 	{ "hostname", &cfg_type_qstringornone, 0 },
 	{ "interface-interval", &cfg_type_duration, 0 },
+	{ "intern-rdataslabs", &cfg_type_boolean, 0 },
 	{ "keep-response-order", &cfg_type_bracketed_aml,
 	  CFG_CLAUSEFLAG_OBSOLETE },
 	{ "listen-on", &cfg_type_listenon, CFG_CLAUSEFLAG_MULTI },
@@ -1298,10 +1300,12 @@ static cfg_clausedef_t options_clauses[] = {
 	{ "memstatistics-file", &cfg_type_qstring, 0 },
 	{ "multiple-cnames", NULL, CFG_CLAUSEFLAG_ANCIENT },
 	{ "named-xfer", NULL, CFG_CLAUSEFLAG_ANCIENT },
+	{ "notify-pipeline", &cfg_type_uint32, 0 },
 	{ "notify-rate", &cfg_type_uint32, 0 },
 	{ "pid-file", &cfg_type_qstringornone, 0 },
 	{ "port", &cfg_type_uint32, 0 },
 	{ "tls-port", &cfg_type_uint32, 0 },
+	{ "tls-ticket-key-lifetime", &cfg_type_duration, 0 },
 #if HAVE_LIBNGHTTP2
 	{ "http-port", &cfg_type_uint32, 0 },
 	{ "http-listener-clients", &cfg_type_uint32, 0 },
@@ -1324,6 +1328,7 @@ static cfg_clausedef_t options_clauses[] = {
 	{ "responselog", &cfg_type_boolean, 0 },
 	{ "secroots-file", &cfg_type_qstring, 0 },
 	{ "serial-queries", NULL, CFG_CLAUSEFLAG_ANCIENT },
+	{ "serial-query-pipeline", &cfg_type_uint32, 0 },
 	{ "serial-query-rate", &cfg_type_uint32, 0 },
 	{ "server-id", &cfg_type_serverid, 0 },
 	{ "session-keyalg", &cfg_type_astring, 0 },
@@ -1343,6 +1348,7 @@ static cfg_clausedef_t options_clauses[] = {
 	{ "tcp-initial-timeout", &cfg_type_uint32, 0 },
 	{ "tcp-keepalive-timeout", &cfg_type_uint32, 0 },
 	{ "tcp-listen-queue", &cfg_type_uint32, 0 },
+	{ "tcp-pipeline-depth", &cfg_type_uint32, 0 },
 	{ "tcp-receive-buffer", &cfg_type_uint32, 0 },
 	{ "tcp-send-buffer", &cfg_type_uint32, 0 },
 	{ "tkey-dhkey", NULL, CFG_CLAUSEFLAG_ANCIENT },
@@ -1356,6 +1362,7 @@ static cfg_clausedef_t options_clauses[] = {
 	{ "treat-cr-as-space", NULL, CFG_CLAUSEFLAG_ANCIENT },
 	{ "udp-receive-buffer", &cfg_type_uint32, 0 },
 	{ "udp-send-buffer", &cfg_type_uint32, 0 },
+	{ "udp-socket-reuse", &cfg_type_uint32, 0 },
 	{ "update-quota", &cfg_type_uint32, 0 },
 	{ "use-id-pool", NULL, CFG_CLAUSEFLAG_ANCIENT },
 	{ "use-ixfr", NULL, CFG_CLAUSEFLAG_ANCIENT },
@@ -2040,6 +2047,7 @@ static cfg_clausedef_t view_clauses[] = {
 	{ "attach-cache", &cfg_type_astring, 0 },
 	{ "auth-nxdomain", &cfg_type_boolean, 0 },
 	{ "cache-file", NULL, CFG_CLAUSEFLAG_ANCIENT },
+	{ "cache-wire-rdata", &cfg_type_boolean, 0 },
 	{ "catalog-zones", &cfg_type_catz, 0 },
 	{ "check-names", &cfg_type_checknames, CFG_CLAUSEFLAG_MULTI },
 	{ "cleaning-interval", NULL, CFG_CLAUSEFLAG_ANCIENT },
@@ -2080,6 +2088,7 @@ static cfg_clausedef_t view_clauses[] = {
 	{ "filter-aaaa", NULL, CFG_CLAUSEFLAG_ANCIENT },
 	{ "filter-aaaa-on-v4", NULL, CFG_CLAUSEFLAG_ANCIENT },
 	{ "filter-aaaa-on-v6", NULL, CFG_CLAUSEFLAG_ANCIENT },
+	{ "forwarder-connections", &cfg_type_uint32, 0 },
 	{ "glue-cache", NULL, CFG_CLAUSEFLAG_ANCIENT },
 	{ "ipv4only-enable", &cfg_type_boolean, 0 },
 	{ "ipv4only-contact", &cfg_type_astring, 0 },
@@ -2095,6 +2104,7 @@ static cfg_clausedef_t view_clauses[] = {
 	{ "max-cache-size", &cfg_type_sizeorpercent, 0 },
 	{ "max-cache-ttl", &cfg_type_duration, 0 },
 	{ "max-clients-per-query", &cfg_type_uint32, 0 },
+	{ "max-ncache-size", &cfg_type_sizeorpercentnodefault, 0 },
 	{ "max-ncache-ttl", &cfg_type_duration, 0 },
 	{ "max-recursion-depth", &cfg_type_uint32, 0 },
 	{ "max-recursion-queries", &cfg_type_uint32, 0 },
@@ -2120,6 +2130,8 @@ static cfg_clausedef_t view_clauses[] = {
 	{ "nxdomain-redirect", &cfg_type_astring, 0 },
 	{ "preferred-glue", &cfg_type_astring, 0 },
 	{ "prefetch", &cfg_type_prefetch, 0 },
+	{ "prefetch-popular-names", &cfg_type_uint32, 0 },
+	{ "prefetch-popular-rate", &cfg_type_uint32, 0 },
 	{ "provide-ixfr", &cfg_type_boolean, 0 },
 	{ "qname-minimization", &cfg_type_qminmethod, 0 },
 	/*
@@ -2135,6 +2147,7 @@ static cfg_clausedef_t view_clauses[] = {
 	{ "request-nsid", &cfg_type_boolean, 0 },
 	{ "request-sit", NULL, CFG_CLAUSEFLAG_ANCIENT },
 	{ "require-server-cookie", &cfg_type_boolean, 0 },
+	{ "resolver-hedge-budget", &cfg_type_uint32, 0 },
 	{ "resolver-nonbackoff-tries", NULL, CFG_CLAUSEFLAG_ANCIENT },
 	{ "resolver-query-timeout", &cfg_type_uint32, 0 },
 	{ "resolver-retry-interval", NULL, CFG_CLAUSEFLAG_ANCIENT },
@@ -2295,6 +2308,9 @@ static cfg_clausedef_t zone_clauses[] = {
 	  CFG_ZONE_PRIMARY | CFG_CLAUSEFLAG_OBSOLETE },
 	{ "dnssec-update-mode", &cfg_type_dnssecupdatemode,
 	  CFG_ZONE_PRIMARY | CFG_ZONE_SECONDARY | CFG_CLAUSEFLAG_OBSOLETE },
+	{ "dump-sync-size", &cfg_type_sizenodefault,
+	  CFG_ZONE_PRIMARY | CFG_ZONE_SECONDARY | CFG_ZONE_MIRROR |
+		  CFG_ZONE_STUB | CFG_ZONE_REDIRECT },
 	{ "forward", &cfg_type_forwardtype,
 	  CFG_ZONE_PRIMARY | CFG_ZONE_SECONDARY | CFG_ZONE_STUB |
 		  CFG_ZONE_STATICSTUB | CFG_ZONE_FORWARD },
@@ -2310,6 +2326,9 @@ static cfg_clausedef_t zone_clauses[] = {
 	{ "masterfile-style", &cfg_type_masterstyle,
 	  CFG_ZONE_PRIMARY | CFG_ZONE_SECONDARY | CFG_ZONE_MIRROR |
 		  CFG_ZONE_STUB | CFG_ZONE_REDIRECT },
+	{ "max-dump-rate", &cfg_type_sizenodefault,
+	  CFG_ZONE_PRIMARY | CFG_ZONE_SECONDARY | CFG_ZONE_MIRROR |
+		  CFG_ZONE_STUB | CFG_ZONE_REDIRECT },
 	{ "max-ixfr-log-size", NULL, CFG_CLAUSEFLAG_ANCIENT },
 	{ "max-ixfr-ratio", &cfg_type_ixfrratio,
 	  CFG_ZONE_PRIMARY | CFG_ZONE_SECONDARY | CFG_ZONE_MIRROR },
@@ -2373,6 +2392,8 @@ static cfg_clausedef_t zone_clauses[] = {
 	  CFG_ZONE_PRIMARY | CFG_ZONE_SECONDARY },
 	{ "sig-signing-type", &cfg_type_uint32,
 	  CFG_ZONE_PRIMARY | CFG_ZONE_SECONDARY },
+	{ "sig-signing-workers", &cfg_type_uint32,
+	  CFG_ZONE_PRIMARY | CFG_ZONE_SECONDARY },
 	{ "sig-validity-interval", &cfg_type_validityinterval,
 	  CFG_ZONE_PRIMARY | CFG_ZONE_SECONDARY | CFG_CLAUSEFLAG_OBSOLETE },
 	{ "dnskey-sig-validity", &cfg_type_uint32,
@@ -2897,6 +2918,28 @@ static cfg_type_t cfg_type_sizeorpercent = {
 	doc_parse_size_or_percent, &cfg_rep_string,	  sizeorpercent_enums
 };
 
+/*%
+ * A size in absolute values or percents, or "unlimited", but not
+ * "default".
+ */
+
+static void
+doc_size_or_percent_nodefault(cfg_printer_t *pctx, const cfg_type_t *type) {
+	UNUSED(type);
+	cfg_print_cstr(pctx, "( unlimited | ");
+	cfg_doc_terminal(pctx, &cfg_type_sizeval);
+	cfg_print_cstr(pctx, " | ");
+	cfg_doc_terminal(pctx, &cfg_type_percentage);
+	cfg_print_cstr(pctx, " )");
+}
+
+static const char *sizeorpercentnodefault_enums[] = { "unlimited", NULL };
+static cfg_type_t cfg_type_sizeorpercentnodefault = {
+	"size_or_percent_no_default",  parse_size_or_percent,
+	cfg_print_ustring,	       doc_size_or_percent_nodefault,
+	&cfg_rep_string,	       sizeorpercentnodefault_enums
+};
+
 /*%
  * An IXFR size ratio: percentage, or "unlimited".
  */
@@ -3975,6 +4018,7 @@ static cfg_clausedef_t tls_clauses[] = {
 	{ "cipher-suites", &cfg_type_astring, 0 },
 	{ "prefer-server-ciphers", &cfg_type_boolean, 0 },
 	{ "session-tickets", &cfg_type_boolean, 0 },
+	{ "kernel-tls", &cfg_type_boolean, 0 },
 	{ NULL, NULL, 0 }
 };
 
@@ -100,6 +100,8 @@
 #define TCPBUFFERS_FILLCOUNT 1U
 #define TCPBUFFERS_FREEMAX   8U
 
+#define NAMEBUF_SIZE 1024U
+
 #define WANTNSID(x)	(((x)->attributes & NS_CLIENTATTR_WANTNSID) != 0)
 #define WANTEXPIRE(x)	(((x)->attributes & NS_CLIENTATTR_WANTEXPIRE) != 0)
 #define WANTPAD(x)	(((x)->attributes & NS_CLIENTATTR_WANTPAD) != 0)
@@ -108,6 +110,19 @@
 #define MANAGER_MAGIC	 ISC_MAGIC('N', 'S', 'C', 'm')
 #define VALID_MANAGER(m) ISC_MAGIC_VALID(m, MANAGER_MAGIC)
 
+#define SCRATCH_ALIGN 8U /*%< must be a power of 2 */
+
+/*%
+ * A block of scratch memory, see ns_client_scratchget().  The blocks
+ * of a client are chained from the newest to the oldest.
+ */
+struct ns_clientscratch {
+	ns_clientscratch_t *next;
+	size_t		    size;
+	size_t		    used;
+	unsigned char	    data[];
+};
+
 /*
  * Enable ns_client_dropport() by default.
  */
@@ -220,14 +235,63 @@ ns_client_settimeout(ns_client_t *client, unsigned int seconds) {
 	/* XXXWPK TODO use netmgr to set timeout */
 }
 
+void *
+ns_client_scratchget(ns_client_t *client, size_t size) {
+	ns_clientscratch_t *block = NULL;
+	void *ptr = NULL;
+
+	REQUIRE(NS_CLIENT_VALID(client));
+
+	size = ISC_ALIGN(size, SCRATCH_ALIGN);
+
+	block = client->scratch;
+	if (block == NULL || block->size - block->used < size) {
+		size_t blocksize = ISC_MAX(size, NS_CLIENT_SCRATCH_BLOCK_SIZE);
+
+		block = isc_mem_get(client->manager->mctx,
+				    sizeof(*block) + blocksize);
+		*block = (ns_clientscratch_t){
+			.next = client->scratch,
+			.size = blocksize,
+		};
+		client->scratch = block;
+		client->nallocs++;
+	}
+
+	ptr = block->data + block->used;
+	block->used += size;
+
+	return (ptr);
+}
+
+/*
+ * Release all the scratch memory of the client at once.  Unless
+ * 'everything' is set, one block of the standard size is kept for
+ * the next request.
+ */
 static void
-client_extendederror_reset(ns_client_t *client) {
-	if (client->ede == NULL) {
-		return;
+client_scratch_reset(ns_client_t *client, bool everything) {
+	ns_clientscratch_t *block = client->scratch, *next = NULL;
+
+	client->scratch = NULL;
+	for (; block != NULL; block = next) {
+		next = block->next;
+		if (!everything && client->scratch == NULL &&
+		    block->size == NS_CLIENT_SCRATCH_BLOCK_SIZE)
+		{
+			block->next = NULL;
+			block->used = 0;
+			client->scratch = block;
+		} else {
+			isc_mem_put(client->manager->mctx, block,
+				    sizeof(*block) + block->size);
+		}
 	}
-	isc_mem_put(client->manager->mctx, client->ede->value,
-		    client->ede->length);
-	isc_mem_put(client->manager->mctx, client->ede, sizeof(dns_ednsopt_t));
+}
+
+static void
+client_extendederror_reset(ns_client_t *client) {
+	/* The option is in the scratch memory */
 	client->ede = NULL;
 }
 
@@ -264,10 +328,10 @@ ns_client_extendederror(ns_client_t *client, uint16_t code, const char *text) {
 		}
 	}
 
-	client->ede = isc_mem_get(client->manager->mctx, sizeof(dns_ednsopt_t));
+	client->ede = ns_client_scratchget(client, sizeof(dns_ednsopt_t));
 	client->ede->code = DNS_OPT_EDE;
 	client->ede->length = len;
-	client->ede->value = isc_mem_get(client->manager->mctx, len);
+	client->ede->value = ns_client_scratchget(client, len);
 	memmove(client->ede->value, ede, len);
 };
 
@@ -312,6 +376,8 @@ ns_client_endrequest(ns_client_t *client) {
 	}
 
 	client_extendederror_reset(client);
+	client->keytag = NULL;
+	client->keytag_len = 0;
 	client->signer = NULL;
 	client->udpsize = 512;
 	client->extflags = 0;
@@ -320,6 +386,20 @@ ns_client_endrequest(ns_client_t *client) {
 	dns_ecs_init(&client->ecs);
 	dns_message_reset(client->message, DNS_MESSAGE_INTENTPARSE);
 
+	/*
+	 * Nothing refers to the scratch memory of the request anymore.
+	 */
+	if (client->nallocs > 0) {
+		ns_client_log(client, NS_LOGCATEGORY_CLIENT,
+			      NS_LOGMODULE_CLIENT, ISC_LOG_DEBUG(3),
+			      "request allocated memory %u times",
+			      client->nallocs);
+		ns_stats_increment(client->manager->sctx->nsstats,
+				   ns_statscounter_reqalloc);
+		client->nallocs = 0;
+	}
+	client_scratch_reset(client, false);
+
 	/*
 	 * Clear all client attributes that are specific to the request
 	 */
@@ -467,6 +547,7 @@ client_sendpkg(ns_client_t *client, isc_buffer_t *buffer) {
 			 */
 			unsigned char *new_tcpbuf =
 				isc_mem_get(client->manager->mctx, used);
+			client->nallocs++;
 			memmove(new_tcpbuf, buffer->base, used);
 
 			/*
@@ -679,6 +760,18 @@ ns_client_send(ns_client_t *client) {
 	dns_compress_init(&cctx, client->manager->mctx, compflags);
 	cleanup_cctx = true;
 
+	/*
+	 * Most of the names in an authoritative answer are in the zone,
+	 * so let them skip the suffixes they have in common with its apex.
+	 */
+	if (client->query.authzone != NULL) {
+		const dns_compress_apex_t *apex =
+			dns_zone_getcompressapex(client->query.authzone);
+		if (apex != NULL) {
+			dns_compress_setapex(&cctx, apex);
+		}
+	}
+
 	result = dns_message_renderbegin(client->message, &cctx, &buffer);
 	if (result != ISC_R_SUCCESS) {
 		goto cleanup;
@@ -1540,11 +1633,9 @@ process_keytag(ns_client_t *client, isc_buffer_t *buf, size_t optlen) {
 		return (ISC_R_SUCCESS);
 	}
 
-	client->keytag = isc_mem_get(client->manager->mctx, optlen);
-	{
-		client->keytag_len = (uint16_t)optlen;
-		memmove(client->keytag, isc_buffer_current(buf), optlen);
-	}
+	client->keytag = ns_client_scratchget(client, optlen);
+	client->keytag_len = (uint16_t)optlen;
+	memmove(client->keytag, isc_buffer_current(buf), optlen);
 	isc_buffer_forward(buf, (unsigned int)optlen);
 	return (ISC_R_SUCCESS);
 }
@@ -1711,12 +1802,6 @@ ns__client_reset_cb(void *client0) {
 		client_put_tcp_buffer(client);
 	}
 
-	if (client->keytag != NULL) {
-		isc_mem_put(client->manager->mctx, client->keytag,
-			    client->keytag_len);
-		client->keytag_len = 0;
-	}
-
 	ns_client_async_reset(client);
 
 	client->state = NS_CLIENTSTATE_READY;
@@ -1743,6 +1828,7 @@ ns__client_put_cb(void *client0) {
 	 */
 	ns_query_free(client);
 	client_extendederror_reset(client);
+	client_scratch_reset(client, true);
 
 	client->magic = 0;
 
@@ -1950,8 +2036,17 @@ ns_client_request(isc_nmhandle_t *handle, isc_result_t eresult,
 				   ns_statscounter_requestv6);
 	}
 	if (TCP_CLIENT(client)) {
+		size_t depth = isc_nm_pipelinedepth(handle);
+
 		ns_stats_increment(client->manager->sctx->nsstats,
 				   ns_statscounter_requesttcp);
+		if (depth > 1) {
+			ns_stats_increment(client->manager->sctx->nsstats,
+					   ns_statscounter_tcppipelined);
+		}
+		ns_stats_update_if_greater(client->manager->sctx->nsstats,
+					   ns_statscounter_tcppipelinehighwater,
+					   depth);
 		switch (isc_sockaddr_pf(&client->peeraddr)) {
 		case AF_INET:
 			isc_histomulti_inc(client->manager->sctx->tcpinstats4,
@@ -1982,7 +2077,8 @@ ns_client_request(isc_nmhandle_t *handle, isc_result_t eresult,
 	/*
 	 * It's a request.  Parse it.
 	 */
-	result = dns_message_parse(client->message, client->buffer, 0);
+	result = dns_message_parse(client->message, client->buffer,
+				   DNS_MESSAGEPARSE_FASTQUERY);
 	if (result != ISC_R_SUCCESS) {
 		/*
 		 * Parsing the request failed.  Send a response
@@ -2552,6 +2648,7 @@ ns__client_setup(ns_client_t *client, ns_clientmgr_t *mgr, bool new) {
 			.manager = client->manager,
 			.message = client->message,
 			.query = client->query,
+			.scratch = client->scratch,
 		};
 	}
 
@@ -2609,7 +2706,8 @@ ns_clientmgr_create(ns_server_t *sctx, isc_loopmgr_t *loopmgr,
 	ns_clientmgr_t *manager = NULL;
 	isc_mem_t *mctx = NULL;
 
-	isc_mem_create(&mctx);
+	/* The clients of this manager all run on its loop */
+	isc_loop_createmctx(isc_loop_get(loopmgr, tid), &mctx);
 	isc_mem_setname(mctx, "clientmgr");
 
 	manager = isc_mem_get(mctx, sizeof(*manager));
@@ -2991,7 +3089,8 @@ ns_client_newnamebuf(ns_client_t *client) {
 
 	CTRACE("ns_client_newnamebuf");
 
-	isc_buffer_allocate(client->manager->mctx, &dbuf, 1024);
+	dbuf = ns_client_scratchget(client, sizeof(*dbuf) + NAMEBUF_SIZE);
+	isc_buffer_init(dbuf, dbuf + 1, NAMEBUF_SIZE);
 	ISC_LIST_APPEND(client->query.namebufs, dbuf, link);
 
 	CTRACE("ns_client_newnamebuf: done");
@@ -3084,8 +3183,7 @@ ns_client_newdbversion(ns_client_t *client, unsigned int n) {
 	ns_dbversion_t *dbversion = NULL;
 
 	for (i = 0; i < n; i++) {
-		dbversion = isc_mem_get(client->manager->mctx,
-					sizeof(*dbversion));
+		dbversion = ns_client_scratchget(client, sizeof(*dbversion));
 		*dbversion = (ns_dbversion_t){ 0 };
 		ISC_LIST_INITANDAPPEND(client->query.freeversions, dbversion,
 				       link);
@@ -80,8 +80,9 @@
  *** Types
  ***/
 
-#define NS_CLIENT_TCP_BUFFER_SIZE  65535
-#define NS_CLIENT_SEND_BUFFER_SIZE 4096
+#define NS_CLIENT_TCP_BUFFER_SIZE    65535
+#define NS_CLIENT_SEND_BUFFER_SIZE   4096
+#define NS_CLIENT_SCRATCH_BLOCK_SIZE 2048
 
 /*!
  * Client object states.  Ordering is significant: higher-numbered
@@ -138,6 +139,8 @@ typedef enum {
 
 typedef ISC_LIST(ns_client_t) client_list_t;
 
+typedef struct ns_clientscratch ns_clientscratch_t;
+
 /*% nameserver client manager structure */
 struct ns_clientmgr {
 	/* Unlocked. */
@@ -225,6 +228,14 @@ struct ns_client {
 	unsigned char *keytag;
 	uint16_t       keytag_len;
 
+	/*%
+	 * Memory for the temporary data of the current request, see
+	 * ns_client_scratchget(), and the number of times it had to be
+	 * allocated for this request.
+	 */
+	ns_clientscratch_t *scratch;
+	unsigned int	    nallocs;
+
 	/*%
 	 * Used to override the DNS response code in ns_client_error().
 	 * If set to -1, the rcode is determined from the result code,
@@ -484,10 +495,28 @@ ns_client_putrdataset(ns_client_t *client, dns_rdataset_t **rdatasetp);
  * used in query.c and in plugins.
  */
 
+void *
+ns_client_scratchget(ns_client_t *client, size_t size);
+/*%<
+ * Get 'size' bytes of memory for the temporary data of the current
+ * request: EDNS options, name buffers, database versions and the like.
+ * The memory is not freed piecemeal, it is all released at once when
+ * the request ends.
+ *
+ * The first NS_CLIENT_SCRATCH_BLOCK_SIZE bytes are kept by the client
+ * from one request to the next, so that most requests do not allocate
+ * any memory at all; the ones that do are counted in the
+ * ns_statscounter_reqalloc statistics counter.
+ *
+ * Requires:
+ *\li	'client' is a valid client.
+ */
+
 isc_result_t
 ns_client_newnamebuf(ns_client_t *client);
 /*%<
- * Allocate a name buffer for the client message.
+ * Get a name buffer for the client message from the client's scratch
+ * memory.
  */
 
 dns_name_t *
@@ -520,7 +549,8 @@ ns_client_releasename(ns_client_t *client, dns_name_t **namep);
 isc_result_t
 ns_client_newdbversion(ns_client_t *client, unsigned int n);
 /*%<
- * Allocate 'n' new database versions for use by client queries.
+ * Get 'n' new database versions for use by client queries from the
+ * client's scratch memory.
  */
 
 ns_dbversion_t *
@@ -114,7 +114,20 @@ enum {
 
 	ns_statscounter_recurshighwater = 68,
 
-	ns_statscounter_max = 69,
+	ns_statscounter_catzqueued = 69,
+	ns_statscounter_catzadded = 70,
+	ns_statscounter_catzmodified = 71,
+	ns_statscounter_catzdeleted = 72,
+	ns_statscounter_catzfailed = 73,
+	ns_statscounter_catzbatches = 74,
+	ns_statscounter_catzlatencyhighwater = 75,
+
+	ns_statscounter_tcppipelined = 76,
+	ns_statscounter_tcppipelinehighwater = 77,
+
+	ns_statscounter_reqalloc = 78,
+
+	ns_statscounter_max = 79,
 };
 
 void
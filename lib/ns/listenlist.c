@@ -74,8 +74,37 @@ listenelt_create(isc_mem_t *mctx, in_port_t port, dns_acl_t *acl,
 			 * handshake failures. See OpenSSL documentation for
 			 * 'SSL_CTX_set_session_id_context()', the "Warnings"
 			 * section.
+			 *
+			 * When the session ticket keys are shared between the
+			 * contexts, the session ID context is derived from the
+			 * TLS configuration instead, so that the sessions
+			 * established before a reconfiguration can still be
+			 * resumed after it.
 			 */
-			isc_tlsctx_set_random_session_id_context(sslctx);
+			if (tls_params->ticketkeys != NULL) {
+				const char *sid_ctx[] = {
+					tls_params->name,
+					is_http ? "doh" : "dot",
+					family == AF_INET6 ? "6" : "4",
+					tls_params->key != NULL
+						? tls_params->key
+						: "",
+					tls_params->cert != NULL
+						? tls_params->cert
+						: "",
+					tls_params->ca_file != NULL
+						? tls_params->ca_file
+						: "",
+					NULL,
+				};
+
+				isc_tlsctx_set_ticketkeys(
+					sslctx, tls_params->ticketkeys,
+					sid_ctx);
+			} else {
+				isc_tlsctx_set_random_session_id_context(
+					sslctx);
+			}
 
 			/*
 			 * If CA-bundle file is specified - enable client
@@ -150,6 +179,10 @@ listenelt_create(isc_mem_t *mctx, in_port_t port, dns_acl_t *acl,
 					sslctx, tls_params->session_tickets);
 			}
 
+			if (tls_params->kernel_tls) {
+				isc_tlsctx_enable_ktls(sslctx);
+			}
+
 #ifdef HAVE_LIBNGHTTP2
 			if (is_http) {
 				isc_tlsctx_enable_http2server_alpn(sslctx);
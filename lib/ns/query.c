@@ -56,6 +56,7 @@
 #include <dns/rdatasetiter.h>
 #include <dns/rdatastruct.h>
 #include <dns/rdatatype.h>
+#include <dns/refresher.h>
 #include <dns/resolver.h>
 #include <dns/result.h>
 #include <dns/stats.h>
@@ -725,28 +726,6 @@ query_next(ns_client_t *client, isc_result_t result) {
 	isc_nmhandle_detach(&client->reqhandle);
 }
 
-static void
-query_freefreeversions(ns_client_t *client, bool everything) {
-	ns_dbversion_t *dbversion, *dbversion_next;
-	unsigned int i;
-
-	for (dbversion = ISC_LIST_HEAD(client->query.freeversions), i = 0;
-	     dbversion != NULL; dbversion = dbversion_next, i++)
-	{
-		dbversion_next = ISC_LIST_NEXT(dbversion, link);
-		/*
-		 * If we're not freeing everything, we keep the first three
-		 * dbversions structures around.
-		 */
-		if (i > 3 || everything) {
-			ISC_LIST_UNLINK(client->query.freeversions, dbversion,
-					link);
-			isc_mem_put(client->manager->mctx, dbversion,
-				    sizeof(*dbversion));
-		}
-	}
-}
-
 void
 ns_query_cancel(ns_client_t *client) {
 	REQUIRE(NS_CLIENT_VALID(client));
@@ -768,7 +747,6 @@ ns_query_cancel(ns_client_t *client) {
 
 static void
 query_reset(ns_client_t *client, bool everything) {
-	isc_buffer_t *dbuf, *dbuf_next;
 	ns_dbversion_t *dbversion, *dbversion_next;
 
 	CTRACE(ISC_LOG_DEBUG(3), "query_reset");
@@ -783,7 +761,9 @@ query_reset(ns_client_t *client, bool everything) {
 	ns_query_cancel(client);
 
 	/*
-	 * Cleanup any active versions.
+	 * Cleanup any active versions.  The versions themselves, like
+	 * the name buffers, are in the client's scratch memory, which
+	 * is released at the end of the request.
 	 */
 	for (dbversion = ISC_LIST_HEAD(client->query.activeversions);
 	     dbversion != NULL; dbversion = dbversion_next)
@@ -791,10 +771,10 @@ query_reset(ns_client_t *client, bool everything) {
 		dbversion_next = ISC_LIST_NEXT(dbversion, link);
 		dns_db_closeversion(dbversion->db, &dbversion->version, false);
 		dns_db_detach(&dbversion->db);
-		ISC_LIST_INITANDAPPEND(client->query.freeversions, dbversion,
-				       link);
 	}
 	ISC_LIST_INIT(client->query.activeversions);
+	ISC_LIST_INIT(client->query.freeversions);
+	ISC_LIST_INIT(client->query.namebufs);
 
 	if (client->query.authdb != NULL) {
 		dns_db_detach(&client->query.authdb);
@@ -809,12 +789,8 @@ query_reset(ns_client_t *client, bool everything) {
 	if (client->query.dns64_sigaaaa != NULL) {
 		ns_client_putrdataset(client, &client->query.dns64_sigaaaa);
 	}
-	if (client->query.dns64_aaaaok != NULL) {
-		isc_mem_cput(client->manager->mctx, client->query.dns64_aaaaok,
-			     client->query.dns64_aaaaoklen, sizeof(bool));
-		client->query.dns64_aaaaok = NULL;
-		client->query.dns64_aaaaoklen = 0;
-	}
+	client->query.dns64_aaaaok = NULL;
+	client->query.dns64_aaaaoklen = 0;
 
 	ns_client_putrdataset(client, &client->query.redirect.rdataset);
 	ns_client_putrdataset(client, &client->query.redirect.sigrdataset);
@@ -829,18 +805,6 @@ query_reset(ns_client_t *client, bool everything) {
 		dns_zone_detach(&client->query.redirect.zone);
 	}
 
-	query_freefreeversions(client, everything);
-
-	for (dbuf = ISC_LIST_HEAD(client->query.namebufs); dbuf != NULL;
-	     dbuf = dbuf_next)
-	{
-		dbuf_next = ISC_LIST_NEXT(dbuf, link);
-		if (dbuf_next != NULL || everything) {
-			ISC_LIST_UNLINK(client->query.namebufs, dbuf, link);
-			isc_buffer_free(&dbuf);
-		}
-	}
-
 	if (client->query.restarts > 0) {
 		/*
 		 * client->query.qname was dynamically allocated.
@@ -903,8 +867,6 @@ ns_query_init(ns_client_t *client) {
 	client->query.redirect.fname =
 		dns_fixedname_initname(&client->query.redirect.fixed);
 	query_reset(client, false);
-	ns_client_newdbversion(client, 3);
-	ns_client_newnamebuf(client);
 }
 
 /*%
@@ -2812,6 +2774,13 @@ query_prefetch(ns_client_t *client, dns_name_t *qname,
 	       dns_rdataset_t *rdataset) {
 	CTRACE(ISC_LOG_DEBUG(3), "query_prefetch");
 
+	if (client->view->refresher != NULL &&
+	    (rdataset->attributes & DNS_RDATASETATTR_PREFETCH) != 0)
+	{
+		dns_refresher_hit(client->view->refresher, qname,
+				  rdataset->type, rdataset->ttl, client->now);
+	}
+
 	if (FETCH_RECTYPE_PREFETCH(client) != NULL ||
 	    client->view->prefetch_trigger == 0U ||
 	    rdataset->ttl > client->view->prefetch_trigger ||
@@ -4695,29 +4664,21 @@ dns64_aaaaok(ns_client_t *client, dns_rdataset_t *rdataset,
 	}
 
 	count = dns_rdataset_count(rdataset);
-	aaaaok = isc_mem_cget(client->manager->mctx, count, sizeof(bool));
+	aaaaok = ns_client_scratchget(client, count * sizeof(bool));
 
 	isc_netaddr_fromsockaddr(&netaddr, &client->peeraddr);
 	if (dns_dns64_aaaaok(dns64, &netaddr, client->signer, env, flags,
 			     rdataset, aaaaok, count))
 	{
 		for (i = 0; i < count; i++) {
-			if (aaaaok != NULL && !aaaaok[i]) {
-				SAVE(client->query.dns64_aaaaok, aaaaok);
+			if (!aaaaok[i]) {
+				client->query.dns64_aaaaok = aaaaok;
 				client->query.dns64_aaaaoklen = count;
 				break;
 			}
 		}
-		if (aaaaok != NULL) {
-			isc_mem_cput(client->manager->mctx, aaaaok, count,
-				     sizeof(bool));
-		}
 		return (true);
 	}
-	if (aaaaok != NULL) {
-		isc_mem_cput(client->manager->mctx, aaaaok, count,
-			     sizeof(bool));
-	}
 	return (false);
 }
 
@@ -11466,7 +11427,6 @@ log_tat(ns_client_t *client) {
 	char classbuf[DNS_RDATACLASS_FORMATSIZE];
 	isc_netaddr_t netaddr;
 	char *tags = NULL;
-	size_t taglen = 0;
 
 	if (!isc_log_wouldlog(ISC_LOG_INFO)) {
 		return;
@@ -11488,8 +11448,8 @@ log_tat(ns_client_t *client) {
 
 	if (client->query.qtype == dns_rdatatype_dnskey) {
 		uint16_t keytags = client->keytag_len / 2;
-		size_t len = taglen = sizeof("65000") * keytags + 1;
-		char *cp = tags = isc_mem_get(client->manager->mctx, taglen);
+		size_t len = sizeof("65000") * keytags + 1;
+		char *cp = tags = ns_client_scratchget(client, len);
 		int i = 0;
 
 		INSIST(client->keytag != NULL);
@@ -11514,9 +11474,6 @@ log_tat(ns_client_t *client) {
 	isc_log_write(NS_LOGCATEGORY_TAT, NS_LOGMODULE_QUERY, ISC_LOG_INFO,
 		      "trust-anchor-telemetry '%s/%s' from %s%s", namebuf,
 		      classbuf, clientbuf, tags != NULL ? tags : "");
-	if (tags != NULL) {
-		isc_mem_put(client->manager->mctx, tags, taglen);
-	}
 }
 
 static void
@@ -27,6 +27,28 @@
 #include <dns/fixedname.h>
 #include <dns/name.h>
 
+/*
+ * Besides compressing all the names into one large message, measure
+ * the time it takes to compress small messages with only a few names,
+ * which fit in the tiny part of the compression hash set, and typical
+ * authoritative responses with and without the template of the apex of
+ * their zone (see dns_compress_setapex()).
+ */
+
+#define SMALLNAMES 4
+
+/*
+ * A positive answer from a zone with its NS records in the authority
+ * section and their addresses in the additional section: the names are
+ * the question and answer, the apex, ns1 and ns2, ns1 and ns2.
+ */
+static const unsigned int shape[] = { 0, 0, 1, 2, 3, 2, 3 };
+
+typedef struct response {
+	dns_name_t names[4];
+	dns_compress_apex_t apex;
+} response_t;
+
 static void
 CHECKRESULT(isc_result_t result, const char *msg) {
 	if (result != ISC_R_SUCCESS) {
@@ -35,6 +57,139 @@ CHECKRESULT(isc_result_t result, const char *msg) {
 	}
 }
 
+static void
+report(const char *what, unsigned int messages, unsigned int repeat,
+       isc_time_t *start) {
+	isc_time_t finish = isc_time_now_hires();
+	uint64_t microseconds = isc_time_microdiff(&finish, start);
+
+	printf("%-8s %u messages, %u times, %10.3f ms, %8.1f ns/message\n",
+	       what, messages, repeat, microseconds / 1000.0,
+	       microseconds * 1000.0 / ((double)messages * repeat));
+}
+
+static void
+small(isc_mem_t *mctx, dns_fixedname_t *fixedname, unsigned int count,
+      unsigned int repeat) {
+	unsigned int messages = count / SMALLNAMES;
+	isc_time_t start = isc_time_now_hires();
+
+	if (messages == 0) {
+		return;
+	}
+
+	for (unsigned int n = 0; n < repeat; n++) {
+		for (unsigned int m = 0; m < messages; m++) {
+			static uint8_t wire[512];
+			dns_compress_t cctx;
+			isc_buffer_t buf;
+			isc_result_t result;
+
+			/* leave room for the header, like a real message */
+			isc_buffer_init(&buf, wire, sizeof(wire));
+			isc_buffer_add(&buf, 12);
+			dns_compress_init(&cctx, mctx, 0);
+
+			for (unsigned int i = 0; i < SMALLNAMES; i++) {
+				dns_name_t *name = dns_fixedname_name(
+					&fixedname[m * SMALLNAMES + i]);
+				result = dns_name_towire(name, &cctx, &buf,
+							 NULL);
+				CHECKRESULT(result, "dns_name_towire");
+			}
+			dns_compress_invalidate(&cctx);
+		}
+	}
+
+	report("small", messages, repeat, &start);
+}
+
+static void
+authoritative(isc_mem_t *mctx, dns_fixedname_t *fixedname,
+	      unsigned int count, unsigned int repeat) {
+	response_t *responses = isc_mem_cget(mctx, count, sizeof(*responses));
+	dns_fixedname_t fns1, fns2;
+	dns_name_t *ns1 = dns_fixedname_initname(&fns1);
+	dns_name_t *ns2 = dns_fixedname_initname(&fns2);
+	isc_result_t result;
+
+	result = dns_name_fromstring(ns1, "ns1", NULL, 0, NULL);
+	CHECKRESULT(result, "ns1");
+	result = dns_name_fromstring(ns2, "ns2", NULL, 0, NULL);
+	CHECKRESULT(result, "ns2");
+
+	/*
+	 * The zone of each name is made of its last two labels, and its
+	 * template is made in advance, as it would be for a real zone.
+	 */
+	for (unsigned int i = 0; i < count; i++) {
+		dns_name_t *qname = dns_fixedname_name(&fixedname[i]);
+		unsigned int labels = ISC_MIN(qname->labels, 3);
+		dns_fixedname_t fapex, fname;
+		dns_name_t *apex = dns_fixedname_initname(&fapex);
+		dns_name_t *name = dns_fixedname_initname(&fname);
+		response_t *r = &responses[i];
+
+		dns_name_getlabelsequence(qname, qname->labels - labels,
+					  labels, apex);
+
+		for (unsigned int j = 0; j < ARRAY_SIZE(r->names); j++) {
+			dns_name_init(&r->names[j], NULL);
+		}
+		dns_name_dupwithoffsets(qname, mctx, &r->names[0]);
+		dns_name_dupwithoffsets(apex, mctx, &r->names[1]);
+		result = dns_name_concatenate(ns1, apex, name, NULL);
+		CHECKRESULT(result, "dns_name_concatenate");
+		dns_name_dupwithoffsets(name, mctx, &r->names[2]);
+		result = dns_name_concatenate(ns2, apex, name, NULL);
+		CHECKRESULT(result, "dns_name_concatenate");
+		dns_name_dupwithoffsets(name, mctx, &r->names[3]);
+
+		dns_compress_apexinit(&r->apex, &r->names[1]);
+	}
+
+	for (int withapex = 0; withapex < 2; withapex++) {
+		isc_time_t start = isc_time_now_hires();
+
+		for (unsigned int n = 0; n < repeat; n++) {
+			for (unsigned int i = 0; i < count; i++) {
+				static uint8_t wire[512];
+				response_t *r = &responses[i];
+				dns_compress_t cctx;
+				isc_buffer_t buf;
+
+				isc_buffer_init(&buf, wire, sizeof(wire));
+				isc_buffer_add(&buf, 12);
+				dns_compress_init(&cctx, mctx, 0);
+				if (withapex) {
+					dns_compress_setapex(&cctx, &r->apex);
+				}
+
+				for (unsigned int j = 0; j < ARRAY_SIZE(shape);
+				     j++)
+				{
+					dns_name_t *name = &r->names[shape[j]];
+					result = dns_name_towire(name, &cctx,
+								 &buf, NULL);
+					CHECKRESULT(result, "dns_name_towire");
+				}
+				dns_compress_invalidate(&cctx);
+			}
+		}
+
+		report(withapex ? "apex" : "noapex", count, repeat, &start);
+	}
+
+	for (unsigned int i = 0; i < count; i++) {
+		for (unsigned int j = 0; j < ARRAY_SIZE(responses[i].names);
+		     j++)
+		{
+			dns_name_free(&responses[i].names[j], mctx);
+		}
+	}
+	isc_mem_cput(mctx, responses, count, sizeof(*responses));
+}
+
 int
 main(void) {
 	isc_result_t result;
@@ -98,6 +253,9 @@ main(void) {
 
 	printf("names %u\n", count);
 
+	small(mctx, fixedname, count, repeat);
+	authoritative(mctx, fixedname, count, repeat);
+
 	isc_mem_destroy(&mctx);
 
 	return (0);
@@ -0,0 +1,334 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*
+ * Measure how fast the resolver can create and join fetch contexts
+ * when all the loops are doing it at once.
+ *
+ * Each loop keeps a window of fetches outstanding for names picked at
+ * random from a shared set, so that some fetches create a new fetch
+ * context and others join one created by another loop.  The names are
+ * in forward-only zones, so that each fetch is also counted in the
+ * fetches-per-zone counters.  Every fetch is canceled as soon as it
+ * is created, and no query ever leaves the resolver: what is measured
+ * is the cost of finding, creating and destroying the fetch contexts
+ * and the zone counters.
+ */
+
+#include <arpa/inet.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <isc/async.h>
+#include <isc/atomic.h>
+#include <isc/buffer.h>
+#include <isc/loop.h>
+#include <isc/mem.h>
+#include <isc/netmgr.h>
+#include <isc/os.h>
+#include <isc/random.h>
+#include <isc/result.h>
+#include <isc/sockaddr.h>
+#include <isc/tid.h>
+#include <isc/time.h>
+#include <isc/tls.h>
+#include <isc/util.h>
+
+#include <dns/db.h>
+#include <dns/dispatch.h>
+#include <dns/fixedname.h>
+#include <dns/forward.h>
+#include <dns/name.h>
+#include <dns/rdataset.h>
+#include <dns/resolver.h>
+#include <dns/view.h>
+
+#include <tests/dns.h>
+
+#define NZONES 64
+#define WINDOW 64
+
+static size_t nnames = 1024;
+static size_t nfetches = 100000;
+
+static dns_fixedname_t *names = NULL;
+static dns_view_t *view = NULL;
+static dns_dispatch_t *dispatch = NULL;
+static isc_tlsctx_cache_t *tlsctx_cache = NULL;
+
+typedef struct bench_loop bench_loop_t;
+
+typedef struct slot {
+	bench_loop_t *bl;
+	dns_fetch_t *fetch;
+	dns_rdataset_t rdataset;
+	dns_rdataset_t sigrdataset;
+} slot_t;
+
+struct bench_loop {
+	slot_t slots[WINDOW];
+	size_t started;
+	size_t finished;
+	size_t failed;
+};
+
+static bench_loop_t *loops = NULL;
+static atomic_uint_fast32_t done;
+static isc_time_t start;
+static uint64_t cpu_start;
+
+static uint64_t
+cpu_usec(void) {
+	struct rusage ru;
+
+	RUNTIME_CHECK(getrusage(RUSAGE_SELF, &ru) == 0);
+
+	return ((ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000ULL +
+		ru.ru_utime.tv_usec + ru.ru_stime.tv_usec);
+}
+
+static void
+CHECKRESULT(isc_result_t result, const char *msg) {
+	if (result != ISC_R_SUCCESS) {
+		fprintf(stderr, "%s: %s\n", msg, isc_result_totext(result));
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void
+finish(void *arg) {
+	isc_time_t now = isc_time_now_hires();
+	uint64_t cpu = cpu_usec() - cpu_start;
+	uint64_t microseconds = isc_time_microdiff(&now, &start);
+	size_t total = 0, failed = 0;
+
+	UNUSED(arg);
+
+	for (size_t i = 0; i < isc_loopmgr_nloops(loopmgr); i++) {
+		total += loops[i].finished;
+		failed += loops[i].failed;
+	}
+
+	printf("%zu fetches (%zu failed) %10.3f ms %10.3f ms CPU "
+	       "%12.1f fetches/s\n",
+	       total, failed, microseconds / 1000.0, cpu / 1000.0,
+	       total * 1000000.0 / ISC_MAX(microseconds, 1));
+
+	dns_view_detach(&view);
+	dns_dispatch_detach(&dispatch);
+	isc_tlsctx_cache_detach(&tlsctx_cache);
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+static void
+fetch_done(void *arg);
+
+static void
+fetch_start(slot_t *slot) {
+	bench_loop_t *bl = slot->bl;
+	dns_name_t *name = NULL;
+	isc_result_t result;
+
+	name = dns_fixedname_name(&names[isc_random_uniform(nnames)]);
+	bl->started++;
+
+	dns_rdataset_init(&slot->rdataset);
+	dns_rdataset_init(&slot->sigrdataset);
+	result = dns_resolver_createfetch(
+		view->resolver, name, dns_rdatatype_a, NULL, NULL, NULL, NULL,
+		0, 0, 0, NULL, isc_loop(), fetch_done, slot, &slot->rdataset,
+		&slot->sigrdataset, &slot->fetch);
+	if (result != ISC_R_SUCCESS) {
+		bl->failed++;
+		bl->finished++;
+		return;
+	}
+
+	dns_resolver_cancelfetch(slot->fetch);
+}
+
+static void
+fetch_done(void *arg) {
+	dns_fetchresponse_t *resp = (dns_fetchresponse_t *)arg;
+	slot_t *slot = resp->arg;
+	bench_loop_t *bl = slot->bl;
+
+	if (resp->node != NULL) {
+		dns_db_detachnode(resp->db, &resp->node);
+	}
+	if (resp->db != NULL) {
+		dns_db_detach(&resp->db);
+	}
+	if (dns_rdataset_isassociated(&slot->rdataset)) {
+		dns_rdataset_disassociate(&slot->rdataset);
+	}
+	if (dns_rdataset_isassociated(&slot->sigrdataset)) {
+		dns_rdataset_disassociate(&slot->sigrdataset);
+	}
+	dns_resolver_destroyfetch(&slot->fetch);
+	isc_mem_putanddetach(&resp->mctx, resp, sizeof(*resp));
+
+	bl->finished++;
+
+	/* Start the next fetches, some of them may fail synchronously */
+	while (bl->started < nfetches && slot->fetch == NULL) {
+		fetch_start(slot);
+	}
+
+	if (bl->finished == nfetches &&
+	    atomic_fetch_add(&done, 1) + 1 == isc_loopmgr_nloops(loopmgr))
+	{
+		isc_async_run(isc_loop_main(loopmgr), finish, NULL);
+	}
+}
+
+static void
+run_loop(void *arg) {
+	bench_loop_t *bl = &loops[isc_tid()];
+
+	UNUSED(arg);
+
+	for (size_t i = 0; i < WINDOW; i++) {
+		slot_t *slot = &bl->slots[i];
+
+		slot->bl = bl;
+		while (bl->started < nfetches && slot->fetch == NULL) {
+			fetch_start(slot);
+		}
+	}
+
+	if (bl->finished == nfetches &&
+	    atomic_fetch_add(&done, 1) + 1 == isc_loopmgr_nloops(loopmgr))
+	{
+		isc_async_run(isc_loop_main(loopmgr), finish, NULL);
+	}
+}
+
+static void
+setup(void *arg) {
+	isc_result_t result;
+	isc_sockaddr_t local, forwarder;
+	isc_sockaddrlist_t forwarders;
+	dns_dispatchmgr_t *dispatchmgr = NULL;
+	struct in_addr localhost = { .s_addr = htonl(INADDR_LOOPBACK) };
+
+	UNUSED(arg);
+
+	result = dns_test_makeview("bench", true, true, &view);
+	CHECKRESULT(result, "dns_test_makeview");
+
+	dispatchmgr = dns_view_getdispatchmgr(view);
+	isc_sockaddr_any(&local);
+	result = dns_dispatch_createudp(dispatchmgr, &local, &dispatch);
+	CHECKRESULT(result, "dns_dispatch_createudp");
+	dns_dispatchmgr_detach(&dispatchmgr);
+
+	/* No query gets this far, but the forwarder must not answer */
+	isc_sockaddr_fromin(&forwarder, &localhost, 9);
+	ISC_LINK_INIT(&forwarder, link);
+	ISC_LIST_INIT(forwarders);
+	ISC_LIST_APPEND(forwarders, &forwarder, link);
+
+	for (size_t i = 0; i < NZONES; i++) {
+		dns_fixedname_t fixed;
+		dns_name_t *zone = dns_fixedname_initname(&fixed);
+		char text[64];
+
+		snprintf(text, sizeof(text), "zone%zu.example", i);
+		result = dns_name_fromstring(zone, text, dns_rootname, 0,
+					     NULL);
+		CHECKRESULT(result, text);
+		result = dns_fwdtable_add(view->fwdtable, zone, &forwarders,
+					  dns_fwdpolicy_only);
+		CHECKRESULT(result, "dns_fwdtable_add");
+	}
+
+	names = isc_mem_cget(mctx, nnames, sizeof(names[0]));
+	for (size_t i = 0; i < nnames; i++) {
+		dns_name_t *name = dns_fixedname_initname(&names[i]);
+		char text[64];
+
+		snprintf(text, sizeof(text), "name%zu.zone%zu.example", i,
+			 i % NZONES);
+		result = dns_name_fromstring(name, text, dns_rootname, 0,
+					     NULL);
+		CHECKRESULT(result, text);
+	}
+
+	isc_tlsctx_cache_create(mctx, &tlsctx_cache);
+	result = dns_view_createresolver(view, netmgr, 0, tlsctx_cache,
+					 dispatch, NULL);
+	CHECKRESULT(result, "dns_view_createresolver");
+	dns_resolver_setfetchesperzone(view->resolver, UINT32_MAX);
+	dns_view_freeze(view);
+
+	start = isc_time_now_hires();
+	cpu_start = cpu_usec();
+	for (size_t i = 0; i < isc_loopmgr_nloops(loopmgr); i++) {
+		isc_async_run(isc_loop_get(loopmgr, i), run_loop, NULL);
+	}
+}
+
+int
+main(int argc, char **argv) {
+	uint32_t nloops = isc_os_ncpus();
+
+	if (argc > 4) {
+		fprintf(stderr, "usage: %s [threads [fetches [names]]]\n",
+			argv[0]);
+		return (EXIT_FAILURE);
+	}
+	if (argc > 1) {
+		nloops = strtoul(argv[1], NULL, 10);
+	}
+	if (argc > 2) {
+		nfetches = strtoul(argv[2], NULL, 10);
+	}
+	if (argc > 3) {
+		nnames = strtoul(argv[3], NULL, 10);
+	}
+	if (nloops == 0 || nfetches == 0 || nnames == 0) {
+		fprintf(stderr, "usage: %s [threads [fetches [names]]]\n",
+			argv[0]);
+		return (EXIT_FAILURE);
+	}
+
+	setlinebuf(stdout);
+
+	printf("%u threads, %zu fetches each, %zu names in %u zones\n", nloops,
+	       nfetches, nnames, NZONES);
+
+	isc_mem_create(&mctx);
+	isc_loopmgr_create(mctx, nloops, &loopmgr);
+	isc_netmgr_create(mctx, loopmgr, &netmgr);
+
+	loops = isc_mem_cget(mctx, nloops, sizeof(loops[0]));
+	atomic_init(&done, 0);
+
+	isc_loop_setup(isc_loop_main(loopmgr), setup, NULL);
+	isc_loopmgr_run(loopmgr);
+
+	isc_mem_cput(mctx, loops, nloops, sizeof(loops[0]));
+	isc_mem_cput(mctx, names, nnames, sizeof(names[0]));
+
+	isc_netmgr_destroy(&netmgr);
+	isc_loopmgr_destroy(&loopmgr);
+	isc_mem_destroy(&mctx);
+
+	return (0);
+}
@@ -0,0 +1,599 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*
+ * An h2load-like benchmark of the DNS-over-HTTP/2 server in the network
+ * manager.
+ *
+ * The server runs in a child process and echoes the DNS messages back
+ * to the client.  The client opens a number of cleartext HTTP/2
+ * connections, keeps a number of streams in flight on each of them and
+ * reports the request rate and the CPU time used by the server per
+ * request.
+ */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <nghttp2/nghttp2.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <isc/commandline.h>
+#include <isc/loop.h>
+#include <isc/mem.h>
+#include <isc/netmgr.h>
+#include <isc/result.h>
+#include <isc/sockaddr.h>
+#include <isc/time.h>
+#include <isc/util.h>
+
+#define NQUERIES     4
+#define MAX_QUERY    64
+#define MAX_RESPONSE 512
+
+/* Server */
+
+typedef struct response {
+	isc_mem_t *mctx;
+	uint8_t data[MAX_RESPONSE];
+} response_t;
+
+static isc_mem_t *mctx = NULL;
+static isc_loopmgr_t *loopmgr = NULL;
+static isc_nm_t *netmgr = NULL;
+static isc_nm_http_endpoints_t *endpoints = NULL;
+static isc_nmsocket_t *listensock = NULL;
+
+static in_port_t port;
+static uint32_t max_streams = 100;
+static int readyfd = -1;
+
+static void
+response_sent(isc_nmhandle_t *handle, isc_result_t eresult, void *cbarg) {
+	response_t *response = cbarg;
+
+	UNUSED(handle);
+	UNUSED(eresult);
+
+	isc_mem_put(response->mctx, response, sizeof(*response));
+}
+
+static void
+request_recv(isc_nmhandle_t *handle, isc_result_t eresult,
+	     isc_region_t *region, void *cbarg) {
+	response_t *response = NULL;
+
+	UNUSED(cbarg);
+
+	if (eresult != ISC_R_SUCCESS) {
+		return;
+	}
+
+	INSIST(region->length <= MAX_RESPONSE);
+
+	response = isc_mem_get(mctx, sizeof(*response));
+	response->mctx = mctx;
+	memmove(response->data, region->base, region->length);
+
+	/* Turn the query into a response */
+	response->data[2] |= 0x80;
+
+	isc_nm_send(handle,
+		    &(isc_region_t){ response->data, region->length },
+		    response_sent, response);
+}
+
+static void
+server_start(void *arg) {
+	isc_sockaddr_t addr;
+	isc_result_t result;
+	struct in_addr in = { .s_addr = htonl(INADDR_LOOPBACK) };
+
+	UNUSED(arg);
+
+	isc_sockaddr_fromin(&addr, &in, port);
+
+	endpoints = isc_nm_http_endpoints_new(mctx);
+	result = isc_nm_http_endpoints_add(endpoints, ISC_NM_HTTP_DEFAULT_PATH,
+					   request_recv, NULL);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+
+	result = isc_nm_listenhttp(netmgr, ISC_NM_LISTEN_ALL, &addr, 128, NULL,
+				   NULL, endpoints, max_streams,
+				   ISC_NM_PROXY_NONE, &listensock);
+	if (result != ISC_R_SUCCESS) {
+		fprintf(stderr, "isc_nm_listenhttp(): %s\n",
+			isc_result_totext(result));
+		exit(EXIT_FAILURE);
+	}
+
+	/* Let the client know that we are listening */
+	RUNTIME_CHECK(write(readyfd, "", 1) == 1);
+	close(readyfd);
+}
+
+static void
+server_stop(void *arg) {
+	UNUSED(arg);
+
+	isc_nm_stoplistening(listensock);
+	isc_nmsocket_close(&listensock);
+	isc_nm_http_endpoints_detach(&endpoints);
+}
+
+static void
+server(uint32_t nloops) {
+	isc_mem_create(&mctx);
+	isc_loopmgr_create(mctx, nloops, &loopmgr);
+	isc_netmgr_create(mctx, loopmgr, &netmgr);
+
+	isc_loop_setup(isc_loop_main(loopmgr), server_start, NULL);
+	isc_loop_teardown(isc_loop_main(loopmgr), server_stop, NULL);
+
+	/* Runs until SIGTERM */
+	isc_loopmgr_run(loopmgr);
+
+	isc_netmgr_destroy(&netmgr);
+	isc_loopmgr_destroy(&loopmgr);
+	isc_mem_destroy(&mctx);
+
+	exit(EXIT_SUCCESS);
+}
+
+/* Client */
+
+typedef struct query {
+	uint8_t wire[MAX_QUERY];
+	size_t length;
+	char path[sizeof(ISC_NM_HTTP_DEFAULT_PATH) + MAX_QUERY * 2];
+} query_t;
+
+typedef struct conn {
+	int fd;
+	nghttp2_session *ngsession;
+	size_t inflight;
+} conn_t;
+
+static query_t queries[NQUERIES];
+static bool post = false;
+static size_t submitted = 0, completed = 0, failed = 0;
+static uint64_t bytes = 0;
+
+static void
+fail(const char *what) {
+	fprintf(stderr, "%s failed: %s\n", what, strerror(errno));
+	exit(EXIT_FAILURE);
+}
+
+static void
+base64url(const uint8_t *data, size_t length, char *out) {
+	static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+				       "abcdefghijklmnopqrstuvwxyz"
+				       "0123456789-_";
+	uint32_t bits = 0;
+	int nbits = 0;
+
+	for (size_t i = 0; i < length; i++) {
+		bits = (bits << 8) | data[i];
+		nbits += 8;
+		while (nbits >= 6) {
+			nbits -= 6;
+			*out++ = alphabet[(bits >> nbits) & 0x3f];
+		}
+	}
+	if (nbits > 0) {
+		*out++ = alphabet[(bits << (6 - nbits)) & 0x3f];
+	}
+	*out = '\0';
+}
+
+static void
+make_queries(void) {
+	/* ID 0, RD, one question */
+	static const char header[] = "\000\000\001\000\000\001"
+				     "\000\000\000\000\000\000";
+	/* example.com, type A, class IN */
+	static const char suffix[] = "\007example\003com\000"
+				     "\000\001\000\001";
+
+	for (size_t i = 0; i < NQUERIES; i++) {
+		query_t *q = &queries[i];
+		char label[16];
+		int n;
+
+		n = snprintf(label, sizeof(label), "www%zu", i);
+
+		memmove(q->wire, header, sizeof(header) - 1);
+		q->length = sizeof(header) - 1;
+		q->wire[q->length++] = n;
+		memmove(q->wire + q->length, label, n);
+		q->length += n;
+		memmove(q->wire + q->length, suffix, sizeof(suffix) - 1);
+		q->length += sizeof(suffix) - 1;
+
+		n = snprintf(q->path, sizeof(q->path), "%s?dns=",
+			     ISC_NM_HTTP_DEFAULT_PATH);
+		base64url(q->wire, q->length, q->path + n);
+	}
+}
+
+static ssize_t
+send_cb(nghttp2_session *ngsession, const uint8_t *data, size_t length,
+	int flags, void *user_data) {
+	conn_t *conn = user_data;
+	size_t left = length;
+
+	UNUSED(ngsession);
+	UNUSED(flags);
+
+	while (left > 0) {
+		ssize_t n = write(conn->fd, data, left);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			fail("write()");
+		}
+		data += n;
+		left -= n;
+	}
+
+	return (length);
+}
+
+static int
+header_cb(nghttp2_session *ngsession, const nghttp2_frame *frame,
+	  const uint8_t *name, size_t namelen, const uint8_t *value,
+	  size_t valuelen, uint8_t flags, void *user_data) {
+	UNUSED(ngsession);
+	UNUSED(flags);
+	UNUSED(user_data);
+
+	if (frame->hd.type == NGHTTP2_HEADERS && namelen == 7 &&
+	    memcmp(name, ":status", 7) == 0 &&
+	    (valuelen != 3 || memcmp(value, "200", 3) != 0))
+	{
+		failed++;
+	}
+
+	return (0);
+}
+
+static int
+data_chunk_cb(nghttp2_session *ngsession, uint8_t flags, int32_t stream_id,
+	      const uint8_t *data, size_t len, void *user_data) {
+	UNUSED(ngsession);
+	UNUSED(flags);
+	UNUSED(stream_id);
+	UNUSED(data);
+	UNUSED(user_data);
+
+	bytes += len;
+
+	return (0);
+}
+
+static int
+stream_close_cb(nghttp2_session *ngsession, int32_t stream_id,
+		uint32_t error_code, void *user_data) {
+	conn_t *conn = user_data;
+
+	UNUSED(ngsession);
+	UNUSED(stream_id);
+
+	if (error_code != NGHTTP2_NO_ERROR) {
+		failed++;
+	}
+	conn->inflight--;
+	completed++;
+
+	return (0);
+}
+
+static ssize_t
+post_read_cb(nghttp2_session *ngsession, int32_t stream_id, uint8_t *buf,
+	     size_t length, uint32_t *data_flags, nghttp2_data_source *source,
+	     void *user_data) {
+	query_t *q = source->ptr;
+
+	UNUSED(ngsession);
+	UNUSED(stream_id);
+	UNUSED(user_data);
+
+	INSIST(length >= q->length);
+	memmove(buf, q->wire, q->length);
+	*data_flags |= NGHTTP2_DATA_FLAG_EOF;
+
+	return (q->length);
+}
+
+#define MAKE_NV(name, value, len)                                       \
+	{                                                               \
+		(uint8_t *)(name), (uint8_t *)(value), sizeof(name) - 1, \
+			(len), NGHTTP2_NV_FLAG_NONE                      \
+	}
+
+#define MAKE_NV2(name, value) MAKE_NV(name, value, sizeof(value) - 1)
+
+static void
+submit_request(conn_t *conn) {
+	query_t *q = &queries[submitted % NQUERIES];
+	int32_t stream_id;
+
+	if (post) {
+		char clen[16];
+		nghttp2_data_provider data_prd = {
+			.source.ptr = q,
+			.read_callback = post_read_cb,
+		};
+		int len = snprintf(clen, sizeof(clen), "%zu", q->length);
+		const nghttp2_nv hdrs[] = {
+			MAKE_NV2(":method", "POST"),
+			MAKE_NV2(":scheme", "http"),
+			MAKE_NV2(":authority", "127.0.0.1"),
+			MAKE_NV2(":path", ISC_NM_HTTP_DEFAULT_PATH),
+			MAKE_NV2("content-type", "application/dns-message"),
+			MAKE_NV2("accept", "application/dns-message"),
+			MAKE_NV("content-length", clen, len),
+		};
+		stream_id = nghttp2_submit_request(conn->ngsession, NULL, hdrs,
+						   ARRAY_SIZE(hdrs), &data_prd,
+						   NULL);
+	} else {
+		const nghttp2_nv hdrs[] = {
+			MAKE_NV2(":method", "GET"),
+			MAKE_NV2(":scheme", "http"),
+			MAKE_NV2(":authority", "127.0.0.1"),
+			MAKE_NV(":path", q->path, strlen(q->path)),
+			MAKE_NV2("accept", "application/dns-message"),
+		};
+		stream_id = nghttp2_submit_request(conn->ngsession, NULL, hdrs,
+						   ARRAY_SIZE(hdrs), NULL,
+						   NULL);
+	}
+	RUNTIME_CHECK(stream_id > 0);
+
+	conn->inflight++;
+	submitted++;
+}
+
+static void
+conn_open(conn_t *conn, nghttp2_session_callbacks *callbacks) {
+	struct sockaddr_in sin = { .sin_family = AF_INET,
+				   .sin_port = htons(port),
+				   .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+	int on = 1;
+
+	conn->fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (conn->fd < 0 ||
+	    connect(conn->fd, (struct sockaddr *)&sin, sizeof(sin)) != 0)
+	{
+		fail("connect()");
+	}
+	(void)setsockopt(conn->fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+	RUNTIME_CHECK(nghttp2_session_client_new(&conn->ngsession, callbacks,
+						 conn) == 0);
+	RUNTIME_CHECK(nghttp2_submit_settings(conn->ngsession,
+					      NGHTTP2_FLAG_NONE, NULL,
+					      0) == 0);
+}
+
+static void
+client(size_t nconns, size_t nstreams, size_t total) {
+	nghttp2_session_callbacks *callbacks = NULL;
+	conn_t *conns = calloc(nconns, sizeof(conns[0]));
+	struct pollfd *pfds = calloc(nconns, sizeof(pfds[0]));
+	uint8_t buf[65536];
+
+	RUNTIME_CHECK(conns != NULL && pfds != NULL);
+
+	RUNTIME_CHECK(nghttp2_session_callbacks_new(&callbacks) == 0);
+	nghttp2_session_callbacks_set_send_callback(callbacks, send_cb);
+	nghttp2_session_callbacks_set_on_header_callback(callbacks, header_cb);
+	nghttp2_session_callbacks_set_on_data_chunk_recv_callback(
+		callbacks, data_chunk_cb);
+	nghttp2_session_callbacks_set_on_stream_close_callback(
+		callbacks, stream_close_cb);
+
+	for (size_t i = 0; i < nconns; i++) {
+		conn_open(&conns[i], callbacks);
+		pfds[i] = (struct pollfd){ .fd = conns[i].fd,
+					   .events = POLLIN };
+	}
+
+	while (completed < total) {
+		for (size_t i = 0; i < nconns; i++) {
+			conn_t *conn = &conns[i];
+
+			while (conn->inflight < nstreams && submitted < total) {
+				submit_request(conn);
+			}
+			RUNTIME_CHECK(nghttp2_session_send(conn->ngsession) ==
+				      0);
+		}
+
+		if (poll(pfds, nconns, -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			fail("poll()");
+		}
+
+		for (size_t i = 0; i < nconns; i++) {
+			ssize_t n;
+
+			if ((pfds[i].revents & (POLLIN | POLLHUP | POLLERR)) ==
+			    0)
+			{
+				continue;
+			}
+
+			n = read(conns[i].fd, buf, sizeof(buf));
+			if (n <= 0) {
+				fail("read()");
+			}
+			if (nghttp2_session_mem_recv(conns[i].ngsession, buf,
+						     n) != n)
+			{
+				fprintf(stderr, "nghttp2_session_mem_recv() "
+						"failed\n");
+				exit(EXIT_FAILURE);
+			}
+		}
+	}
+
+	for (size_t i = 0; i < nconns; i++) {
+		nghttp2_session_del(conns[i].ngsession);
+		close(conns[i].fd);
+	}
+	nghttp2_session_callbacks_del(callbacks);
+	free(pfds);
+	free(conns);
+}
+
+static in_port_t
+ephemeral_port(void) {
+	struct sockaddr_in sin = { .sin_family = AF_INET,
+				   .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+	socklen_t sinlen = sizeof(sin);
+	int fd;
+
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0 || bind(fd, (struct sockaddr *)&sin, sizeof(sin)) != 0 ||
+	    getsockname(fd, (struct sockaddr *)&sin, &sinlen) != 0)
+	{
+		fail("bind()");
+	}
+	close(fd);
+
+	return (ntohs(sin.sin_port));
+}
+
+static void
+usage(void) {
+	fprintf(stderr,
+		"usage: doh [-P] [-c clients] [-m streams] [-n requests] "
+		"[-t threads]\n"
+		"	-P	send POST requests instead of GET requests\n"
+		"	-c	number of connections (default: 10)\n"
+		"	-m	streams per connection (default: 10)\n"
+		"	-n	total number of requests (default: 100000)\n"
+		"	-t	number of server threads (default: 1)\n");
+}
+
+int
+main(int argc, char **argv) {
+	size_t nconns = 10, nstreams = 10, total = 100000;
+	uint32_t nloops = 1;
+	isc_time_t start, finish;
+	struct rusage ru;
+	int pipefd[2], opt, status;
+	char byte;
+	pid_t pid;
+
+	while ((opt = isc_commandline_parse(argc, argv, "c:m:n:Pt:")) != -1) {
+		switch (opt) {
+		case 'c':
+			nconns = strtoul(isc_commandline_argument, NULL, 10);
+			continue;
+		case 'm':
+			nstreams = strtoul(isc_commandline_argument, NULL, 10);
+			continue;
+		case 'n':
+			total = strtoul(isc_commandline_argument, NULL, 10);
+			continue;
+		case 'P':
+			post = true;
+			continue;
+		case 't':
+			nloops = strtoul(isc_commandline_argument, NULL, 10);
+			continue;
+		default:
+			usage();
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if (nconns == 0 || nstreams == 0 || total == 0 || nloops == 0) {
+		usage();
+		exit(EXIT_FAILURE);
+	}
+
+	if (nstreams > max_streams) {
+		max_streams = nstreams;
+	}
+
+	make_queries();
+	port = ephemeral_port();
+
+	if (pipe(pipefd) != 0) {
+		fail("pipe()");
+	}
+
+	pid = fork();
+	if (pid < 0) {
+		fail("fork()");
+	} else if (pid == 0) {
+		close(pipefd[0]);
+		readyfd = pipefd[1];
+		server(nloops);
+	}
+
+	close(pipefd[1]);
+	if (read(pipefd[0], &byte, 1) != 1) {
+		fprintf(stderr, "the server did not start\n");
+		exit(EXIT_FAILURE);
+	}
+	close(pipefd[0]);
+
+	printf("%zu %s requests, %zu clients, %zu streams per client, "
+	       "%" PRIu32 " server threads: ",
+	       total, post ? "POST" : "GET", nconns, nstreams, nloops);
+	fflush(stdout);
+
+	start = isc_time_now_hires();
+	client(nconns, nstreams, total);
+	finish = isc_time_now_hires();
+
+	kill(pid, SIGTERM);
+	if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+	    WEXITSTATUS(status) != EXIT_SUCCESS)
+	{
+		fprintf(stderr, "the server failed\n");
+		exit(EXIT_FAILURE);
+	}
+	RUNTIME_CHECK(getrusage(RUSAGE_CHILDREN, &ru) == 0);
+
+	uint64_t microseconds = isc_time_microdiff(&finish, &start);
+	uint64_t cpu = (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000ULL +
+		       ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+	printf("%0.0f req/s, %0.3f us server CPU per request, "
+	       "%" PRIu64 " bytes received, %zu failed\n",
+	       (double)total * 1000000.0 / microseconds, (double)cpu / total,
+	       bytes, failed);
+
+	return (failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,274 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*
+ * Compare the CPU time the server spends per DNS-over-TLS response when
+ * the responses are encrypted by OpenSSL over memory BIOs (as done by
+ * the network manager) and when they are encrypted by the kernel.
+ *
+ * The client runs in a child process over a loopback TCP connection, so
+ * only the CPU time of the sending side is accounted for.
+ */
+
+#include <arpa/inet.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <openssl/bio.h>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+
+#include <isc/random.h>
+#include <isc/result.h>
+#include <isc/time.h>
+#include <isc/tls.h>
+#include <isc/util.h>
+
+#define MESSAGE_SIZE 512
+
+static uint8_t message[MESSAGE_SIZE + 2];
+
+static void
+fail(const char *what) {
+	fprintf(stderr, "%s failed\n", what);
+	ERR_print_errors_fp(stderr);
+	exit(EXIT_FAILURE);
+}
+
+static void
+write_all(int fd, const uint8_t *buf, size_t len) {
+	while (len > 0) {
+		ssize_t n = write(fd, buf, len);
+		if (n <= 0) {
+			fail("write()");
+		}
+		buf += n;
+		len -= n;
+	}
+}
+
+static void
+flush(BIO *out, int fd) {
+	uint8_t buf[16384];
+	int n;
+
+	while ((n = BIO_read(out, buf, sizeof(buf))) > 0) {
+		write_all(fd, buf, n);
+	}
+}
+
+static void
+client(in_port_t port, size_t count) {
+	isc_tlsctx_t *ctx = NULL;
+	isc_tls_t *tls = NULL;
+	struct sockaddr_in sin = { .sin_family = AF_INET,
+				   .sin_port = port,
+				   .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+	uint8_t buf[16384];
+	size_t expected = count * sizeof(message), received = 0;
+	int fd, n;
+
+	fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0 || connect(fd, (struct sockaddr *)&sin, sizeof(sin)) != 0)
+	{
+		fail("connect()");
+	}
+
+	RUNTIME_CHECK(isc_tlsctx_createclient(&ctx) == ISC_R_SUCCESS);
+	tls = isc_tls_create(ctx);
+	RUNTIME_CHECK(tls != NULL);
+	SSL_set_fd(tls, fd);
+
+	if (SSL_connect(tls) != 1) {
+		fail("SSL_connect()");
+	}
+
+	while (received < expected) {
+		n = SSL_read(tls, buf, sizeof(buf));
+		if (n <= 0) {
+			fail("SSL_read()");
+		}
+		received += n;
+	}
+
+	isc_tls_free(&tls);
+	isc_tlsctx_free(&ctx);
+	close(fd);
+
+	exit(EXIT_SUCCESS);
+}
+
+static uint64_t
+cpu_usec(void) {
+	struct rusage ru;
+
+	RUNTIME_CHECK(getrusage(RUSAGE_SELF, &ru) == 0);
+
+	return ((ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000ULL +
+		ru.ru_utime.tv_usec + ru.ru_stime.tv_usec);
+}
+
+static void
+run(const char *what, bool kernel, size_t count) {
+	isc_tlsctx_t *ctx = NULL;
+	isc_tls_t *tls = NULL;
+	BIO *in = NULL, *out = NULL;
+	struct sockaddr_in sin = { .sin_family = AF_INET,
+				   .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+	socklen_t sinlen = sizeof(sin);
+	uint8_t buf[16384];
+	isc_time_t start, finish;
+	uint64_t cpu;
+	int lfd, fd, status;
+	pid_t pid;
+
+	lfd = socket(AF_INET, SOCK_STREAM, 0);
+	if (lfd < 0 || bind(lfd, (struct sockaddr *)&sin, sizeof(sin)) != 0 ||
+	    listen(lfd, 1) != 0 ||
+	    getsockname(lfd, (struct sockaddr *)&sin, &sinlen) != 0)
+	{
+		fail("listen()");
+	}
+
+	pid = fork();
+	if (pid < 0) {
+		fail("fork()");
+	} else if (pid == 0) {
+		close(lfd);
+		client(sin.sin_port, count);
+	}
+
+	fd = accept(lfd, NULL, NULL);
+	if (fd < 0) {
+		fail("accept()");
+	}
+	close(lfd);
+
+	RUNTIME_CHECK(isc_tlsctx_createserver(NULL, NULL, &ctx) ==
+		      ISC_R_SUCCESS);
+	if (kernel) {
+		isc_tlsctx_enable_ktls(ctx);
+	}
+	tls = isc_tls_create(ctx);
+	RUNTIME_CHECK(tls != NULL);
+	in = BIO_new(BIO_s_mem());
+	out = BIO_new(BIO_s_mem());
+	RUNTIME_CHECK(in != NULL && out != NULL);
+	SSL_set_bio(tls, in, out);
+	SSL_set_accept_state(tls);
+
+	for (;;) {
+		int rv = SSL_do_handshake(tls);
+		ssize_t n;
+
+		flush(out, fd);
+		if (rv == 1) {
+			break;
+		} else if (SSL_get_error(tls, rv) != SSL_ERROR_WANT_READ) {
+			fail("SSL_do_handshake()");
+		}
+
+		n = read(fd, buf, sizeof(buf));
+		if (n <= 0) {
+			fail("read()");
+		}
+		RUNTIME_CHECK(BIO_write(in, buf, n) == n);
+	}
+
+	if (kernel) {
+		isc_result_t result;
+
+		if (!isc_tls_ktls_prepare(tls)) {
+			printf("%s: not available for %s\n", what,
+			       SSL_get_cipher_name(tls));
+			kernel = false;
+		} else {
+			flush(out, fd);
+			result = isc_tls_ktls_install(tls, fd);
+			if (result != ISC_R_SUCCESS) {
+				printf("%s: not available: %s\n", what,
+				       isc_result_totext(result));
+				kernel = false;
+			}
+		}
+	}
+
+	printf("%s, %s, %zu responses of %d bytes: ", what,
+	       SSL_get_cipher_name(tls), count, MESSAGE_SIZE);
+	fflush(stdout);
+
+	start = isc_time_now_hires();
+	cpu = cpu_usec();
+
+	for (size_t i = 0; i < count; i++) {
+		if (kernel) {
+			write_all(fd, message, sizeof(message));
+		} else {
+			if (SSL_write(tls, message, sizeof(message)) !=
+			    (int)sizeof(message))
+			{
+				fail("SSL_write()");
+			}
+			flush(out, fd);
+		}
+	}
+
+	cpu = cpu_usec() - cpu;
+	finish = isc_time_now_hires();
+
+	uint64_t microseconds = isc_time_microdiff(&finish, &start);
+	printf("%0.3f us CPU per response, %0.0f responses/s\n",
+	       (double)cpu / count, (double)count * 1000000.0 / microseconds);
+	fflush(stdout);
+
+	if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+	    WEXITSTATUS(status) != EXIT_SUCCESS)
+	{
+		fail("client");
+	}
+
+	isc_tls_free(&tls);
+	isc_tlsctx_free(&ctx);
+	close(fd);
+}
+
+int
+main(int argc, char **argv) {
+	size_t count = 100000;
+
+	if (argc > 1) {
+		count = strtoul(argv[1], NULL, 10);
+		if (count == 0) {
+			fprintf(stderr, "usage: %s [count]\n", argv[0]);
+			return (EXIT_FAILURE);
+		}
+	}
+
+	message[0] = MESSAGE_SIZE >> 8;
+	message[1] = MESSAGE_SIZE & 0xff;
+	isc_random_buf(message + 2, MESSAGE_SIZE);
+
+	run("OpenSSL", false, count);
+	run("kernel TLS", true, count);
+
+	return (0);
+}
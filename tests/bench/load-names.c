@@ -470,6 +470,87 @@ static struct fun fun_list[] = {
 	{ NULL, NULL, NULL },
 };
 
+/*
+ * Loading a trie from names in DNS canonical order (as from a raw zone
+ * file), one at a time with dns_qp_insert() or in bulk with a
+ * dns_qpbuild_t.
+ */
+static size_t sorted[ARRAY_SIZE(item)];
+
+static int
+sorted_cmp(const void *a, const void *b) {
+	const size_t *ia = a, *ib = b;
+	return (dns_name_compare(&item[*ia].fixed.name,
+				 &item[*ib].fixed.name));
+}
+
+static void
+load_sorted(size_t lines) {
+	for (size_t n = 0; n < lines; n++) {
+		sorted[n] = n;
+	}
+	qsort(sorted, lines, sizeof(sorted[0]), sorted_cmp);
+
+	printf("\n%10s | %10s | %10s | %10s | %10s | %10s |\n", "sorted",
+	       "names", "load", "query", "final MB", "chunks");
+	printf("---------- | ---------- | ---------- | ---------- | "
+	       "---------- | ---------- |\n");
+
+	for (int bulk = 0; bulk < 2; bulk++) {
+		isc_mem_t *mem = NULL;
+		dns_qp_t *qp = NULL;
+		isc_result_t result;
+
+		isc_mem_create(&mem);
+		dns_qp_create(mem, &qpmethods, NULL, &qp);
+		size_t m0 = isc_mem_inuse(mem);
+
+		isc_time_t t0 = isc_time_now_hires();
+		if (bulk) {
+			dns_qpbuild_t *qpb = NULL;
+			dns_qpbuild_begin(qp, &qpb);
+			for (size_t n = 0; n < lines; n++) {
+				size_t i = sorted[n];
+				result = dns_qpbuild_add(qpb, &item[i], i);
+				CHECK(i, result);
+			}
+			dns_qpbuild_finish(&qpb);
+		} else {
+			for (size_t n = 0; n < lines; n++) {
+				size_t i = sorted[n];
+				result = dns_qp_insert(qp, &item[i], i);
+				CHECK(i, result);
+			}
+			sqz_qp(qp);
+		}
+
+		isc_time_t t1 = isc_time_now_hires();
+		for (size_t n = 0; n < lines; n++) {
+			void *pval = NULL;
+			result = get_qp(qp, n, &pval);
+			CHECK(n, result);
+			assert(pval == &item[n]);
+		}
+
+		isc_time_t t2 = isc_time_now_hires();
+		size_t m1 = isc_mem_inuse(mem);
+		dns_qp_memusage_t usage = dns_qp_memusage(qp);
+
+		printf("%10s | %10zu | %10.4f | %10.4f | %10.4f | %10zu |\n",
+		       bulk ? "qp build" : "qp insert", lines,
+		       (double)isc_time_microdiff(&t1, &t0) / (1000.0 * 1000.0),
+		       (double)isc_time_microdiff(&t2, &t1) / (1000.0 * 1000.0),
+		       (double)(m1 - m0) / (1024.0 * 1024.0),
+		       usage.chunk_count);
+
+		dns_qp_destroy(&qp);
+		isc_mem_destroy(&mem);
+	}
+
+	printf("---------- | ---------- | ---------- | ---------- | "
+	       "---------- | ---------- |\n");
+}
+
 #define FILE_CHECK(check, msg)                                                 \
 	do {                                                                   \
 		if (!(check)) {                                                \
@@ -618,4 +699,6 @@ main(int argc, char *argv[]) {
 
 	printf("---------- | ---------- | ---------- | ---------- | "
 	       "---------- | ---------- | ---------- |\n");
+
+	load_sorted(lines);
 }
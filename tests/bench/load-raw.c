@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*
+ * Compare the time it takes to load a zone from a text file, from a
+ * version 1 raw file, and from a version 2 raw file whose blocks are
+ * decoded in parallel.
+ *
+ * The zone is loaded from the given text file first, and dumped into
+ * the raw files in the current directory, which are removed at the end.
+ * The loads are asynchronous, as in named, so that the version 2 loader
+ * can use the work pool.
+ */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <isc/buffer.h>
+#include <isc/file.h>
+#include <isc/loop.h>
+#include <isc/mem.h>
+#include <isc/os.h>
+#include <isc/result.h>
+#include <isc/time.h>
+#include <isc/util.h>
+
+#include <dns/callbacks.h>
+#include <dns/db.h>
+#include <dns/fixedname.h>
+#include <dns/master.h>
+#include <dns/masterdump.h>
+#include <dns/name.h>
+
+#define RAWV1_FILE "load-raw.v1"
+#define RAWV2_FILE "load-raw.v2"
+
+static isc_loopmgr_t *loopmgr = NULL;
+static isc_mem_t *mctx = NULL;
+
+static dns_fixedname_t fixed;
+static dns_name_t *origin = NULL;
+
+static struct {
+	const char *what;
+	const char *file;
+	dns_masterformat_t format;
+} loads[] = {
+	{ "text", NULL, dns_masterformat_text },
+	{ "raw version 1", RAWV1_FILE, dns_masterformat_raw },
+	{ "raw version 2", RAWV2_FILE, dns_masterformat_raw },
+};
+
+static size_t current = 0;
+static dns_db_t *db = NULL;
+static dns_rdatacallbacks_t callbacks;
+static dns_loadctx_t *lctx = NULL;
+static isc_time_t start;
+static uint64_t cpu_start;
+
+static uint64_t
+cpu_usec(void) {
+	struct rusage ru;
+
+	RUNTIME_CHECK(getrusage(RUSAGE_SELF, &ru) == 0);
+
+	return ((ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000ULL +
+		ru.ru_utime.tv_usec + ru.ru_stime.tv_usec);
+}
+
+static void
+dump(uint32_t rawversion, const char *file) {
+	isc_result_t result;
+	dns_dbversion_t *version = NULL;
+	dns_masterrawheader_t header;
+
+	dns_master_initrawheader(&header);
+	header.version = rawversion;
+
+	dns_db_currentversion(db, &version);
+	result = dns_master_dump(mctx, db, version, &dns_master_style_default,
+				 file, dns_masterformat_raw, &header);
+	dns_db_closeversion(db, &version, false);
+	if (result != ISC_R_SUCCESS) {
+		fprintf(stderr, "dumping %s: %s\n", file,
+			isc_result_totext(result));
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void
+load_next(void *arg);
+
+static void
+load_done(void *arg, isc_result_t result) {
+	isc_time_t finish = isc_time_now_hires();
+	uint64_t cpu = cpu_usec() - cpu_start;
+	off_t size = 0;
+
+	UNUSED(arg);
+
+	if (result == ISC_R_SUCCESS) {
+		result = dns_db_endload(db, &callbacks);
+	} else {
+		(void)dns_db_endload(db, &callbacks);
+	}
+	dns_loadctx_detach(&lctx);
+	if (result != ISC_R_SUCCESS) {
+		fprintf(stderr, "loading %s: %s\n", loads[current].what,
+			isc_result_totext(result));
+		exit(EXIT_FAILURE);
+	}
+
+	if (loads[current].file != NULL) {
+		(void)isc_file_getsize(loads[current].file, &size);
+	}
+	printf("%-16s %10.3f ms %10.3f ms CPU %12" PRIu64 " bytes\n",
+	       loads[current].what, isc_time_microdiff(&finish, &start) / 1000.0,
+	       cpu / 1000.0, (uint64_t)size);
+
+	/* The raw files are dumped from the zone loaded from the text */
+	if (current == 0) {
+		dump(1, RAWV1_FILE);
+		dump(2, RAWV2_FILE);
+	}
+
+	dns_db_detach(&db);
+	current++;
+	load_next(NULL);
+}
+
+static void
+load_next(void *arg) {
+	isc_result_t result;
+	const char *file = arg;
+
+	if (current == ARRAY_SIZE(loads)) {
+		(void)isc_file_remove(RAWV1_FILE);
+		(void)isc_file_remove(RAWV2_FILE);
+		isc_loopmgr_shutdown(loopmgr);
+		return;
+	}
+	if (loads[current].file != NULL) {
+		file = loads[current].file;
+	}
+
+	result = dns_db_create(mctx, ZONEDB_DEFAULT, origin, dns_dbtype_zone,
+			       dns_rdataclass_in, 0, NULL, &db);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+
+	dns_rdatacallbacks_init_stdio(&callbacks);
+	result = dns_db_beginload(db, &callbacks);
+	RUNTIME_CHECK(result == ISC_R_SUCCESS);
+
+	start = isc_time_now_hires();
+	cpu_start = cpu_usec();
+	result = dns_master_loadfileasync(
+		file, origin, origin, dns_rdataclass_in, DNS_MASTER_ZONE, 0,
+		&callbacks, isc_loop(), load_done, NULL, &lctx, NULL, NULL,
+		mctx, loads[current].format, 0);
+	if (result != ISC_R_SUCCESS) {
+		fprintf(stderr, "loading %s: %s\n", file,
+			isc_result_totext(result));
+		exit(EXIT_FAILURE);
+	}
+}
+
+int
+main(int argc, char **argv) {
+	isc_result_t result;
+	isc_buffer_t buffer;
+	uint32_t nloops = isc_os_ncpus();
+
+	if (argc < 3 || argc > 4) {
+		fprintf(stderr, "usage: %s origin zonefile [threads]\n",
+			argv[0]);
+		return (EXIT_FAILURE);
+	}
+	if (argc > 3) {
+		nloops = strtoul(argv[3], NULL, 10);
+		if (nloops == 0) {
+			fprintf(stderr, "bad number of threads: %s\n",
+				argv[3]);
+			return (EXIT_FAILURE);
+		}
+	}
+
+	setlinebuf(stdout);
+
+	origin = dns_fixedname_initname(&fixed);
+	isc_buffer_constinit(&buffer, argv[1], strlen(argv[1]));
+	isc_buffer_add(&buffer, strlen(argv[1]));
+	result = dns_name_fromtext(origin, &buffer, dns_rootname, 0, NULL);
+	if (result != ISC_R_SUCCESS) {
+		fprintf(stderr, "bad origin %s: %s\n", argv[1],
+			isc_result_totext(result));
+		return (EXIT_FAILURE);
+	}
+
+	printf("%s with %u threads\n", argv[2], nloops);
+
+	isc_mem_create(&mctx);
+	isc_loopmgr_create(mctx, nloops, &loopmgr);
+	isc_loop_setup(isc_loop_main(loopmgr), load_next, argv[2]);
+	isc_loopmgr_run(loopmgr);
+	isc_loopmgr_destroy(&loopmgr);
+	isc_mem_destroy(&mctx);
+
+	return (0);
+}
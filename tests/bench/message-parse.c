@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*
+ * Compare the time it takes to parse incoming queries with the general
+ * message parser and with its fast path for simple queries (see
+ * DNS_MESSAGEPARSE_FASTQUERY).
+ *
+ * The query names are read from stdin, one per line.  A third of the
+ * queries are plain, the rest have an OPT record with a client cookie,
+ * as most queries from resolvers do.  The message is reused for all of
+ * them and reset after each one, like in ns_client_request().
+ */
+
+#include <err.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <isc/buffer.h>
+#include <isc/mem.h>
+#include <isc/result.h>
+#include <isc/time.h>
+#include <isc/util.h>
+
+#include <dns/fixedname.h>
+#include <dns/message.h>
+#include <dns/name.h>
+
+#define MAXQUERIES 65536
+#define QUERYSIZE  (DNS_MESSAGE_HEADERLEN + DNS_NAME_MAXWIRE + 4 + 11 + 12)
+
+static unsigned char queries[MAXQUERIES][QUERYSIZE];
+static size_t sizes[MAXQUERIES];
+static size_t count = 0;
+
+static const unsigned char opt[] = {
+	0x00, 0x00, 0x29, 0x04, 0xd0, 0x00, 0x00, 0x80, 0x00, 0x00, 0x0c,
+	0x00, 0x0a, 0x00, 0x08, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08,
+};
+
+static void
+CHECKRESULT(isc_result_t result, const char *msg) {
+	if (result != ISC_R_SUCCESS) {
+		printf("%s: %s\n", msg, isc_result_totext(result));
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void
+makequery(const dns_name_t *name, bool edns) {
+	isc_buffer_t buf;
+	isc_region_t r;
+
+	isc_buffer_init(&buf, queries[count], QUERYSIZE);
+	isc_buffer_putuint16(&buf, count & 0xffff); /* id */
+	isc_buffer_putuint16(&buf, 0x0100);	    /* RD */
+	isc_buffer_putuint16(&buf, 1);
+	isc_buffer_putuint16(&buf, 0);
+	isc_buffer_putuint16(&buf, 0);
+	isc_buffer_putuint16(&buf, edns ? 1 : 0);
+
+	dns_name_toregion(name, &r);
+	isc_buffer_putmem(&buf, r.base, r.length);
+	isc_buffer_putuint16(&buf, 1);
+	isc_buffer_putuint16(&buf, 1);
+
+	if (edns) {
+		isc_buffer_putmem(&buf, opt, sizeof(opt));
+	}
+
+	sizes[count++] = isc_buffer_usedlength(&buf);
+}
+
+static void
+bench(isc_mem_t *mctx, const char *what, unsigned int options,
+      unsigned int repeat) {
+	dns_message_t *msg = NULL;
+	isc_time_t start, finish;
+	uint64_t microseconds;
+
+	dns_message_create(mctx, NULL, NULL, DNS_MESSAGE_INTENTPARSE, &msg);
+
+	start = isc_time_now_hires();
+
+	for (unsigned int n = 0; n < repeat; n++) {
+		for (size_t i = 0; i < count; i++) {
+			isc_buffer_t source;
+			isc_result_t result;
+
+			isc_buffer_init(&source, queries[i], sizes[i]);
+			isc_buffer_add(&source, sizes[i]);
+			result = dns_message_parse(msg, &source, options);
+			CHECKRESULT(result, "dns_message_parse");
+			dns_message_reset(msg, DNS_MESSAGE_INTENTPARSE);
+		}
+	}
+
+	finish = isc_time_now_hires();
+	microseconds = isc_time_microdiff(&finish, &start);
+
+	printf("%-8s %zu queries, %u times, %10.3f ms, %8.1f ns/query\n",
+	       what, count, repeat, microseconds / 1000.0,
+	       microseconds * 1000.0 / ((double)count * repeat));
+
+	dns_message_detach(&msg);
+}
+
+int
+main(void) {
+	isc_result_t result;
+	isc_buffer_t buf;
+	isc_mem_t *mctx = NULL;
+	char *line = NULL;
+	size_t linecap = 0;
+	ssize_t linelen;
+
+	isc_mem_create(&mctx);
+
+	while ((linelen = getline(&line, &linecap, stdin)) > 0) {
+		dns_fixedname_t fixed;
+		dns_name_t *name = dns_fixedname_initname(&fixed);
+
+		if (line[linelen - 1] == '\n') {
+			line[--linelen] = '\0';
+		}
+		isc_buffer_init(&buf, line, linelen);
+		isc_buffer_add(&buf, linelen);
+
+		if (count == MAXQUERIES) {
+			errx(1, "too many names");
+		}
+		result = dns_name_fromtext(name, &buf, dns_rootname, 0, NULL);
+		CHECKRESULT(result, line);
+
+		makequery(name, count % 3 != 0);
+	}
+	free(line);
+
+	if (count == 0) {
+		errx(1, "no names on stdin");
+	}
+
+	bench(mctx, "general", 0, 100);
+	bench(mctx, "fast", DNS_MESSAGEPARSE_FASTQUERY, 100);
+
+	isc_mem_destroy(&mctx);
+
+	return (0);
+}
@@ -0,0 +1,248 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*
+ * Compare the ways of placing the loops on the CPUs (see
+ * isc_loopmgr_setaffinity()) by how much of the memory the loops use
+ * is on their own NUMA node, and how long it takes them to use it.
+ *
+ * Each loop allocates a set of buffers from a memory context created
+ * with isc_loop_createmctx(), like the client managers do, and then
+ * reads and writes them over and over.  At the end, each loop asks the
+ * kernel where the pages of its buffers are.  On a machine with one
+ * NUMA node, all the pages are local whatever the placement.
+ */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/syscall.h>
+#endif /* __linux__ */
+
+#include <isc/atomic.h>
+#include <isc/loop.h>
+#include <isc/mem.h>
+#include <isc/os.h>
+#include <isc/tid.h>
+#include <isc/time.h>
+#include <isc/util.h>
+
+#define BUFSIZE (16 * 1024)
+#define PAGESIZE 4096
+
+static size_t nbuffers = 1024;
+static size_t rounds = 50;
+
+static isc_loopmgr_t *loopmgr = NULL;
+static isc_mem_t *mctx = NULL;
+static uint32_t nloops;
+
+static struct {
+	const char *what;
+	isc_loopaffinity_t affinity;
+} modes[] = {
+	{ "none", isc_loopaffinity_none },
+	{ "cpu", isc_loopaffinity_cpu },
+	{ "numa", isc_loopaffinity_numa },
+};
+
+typedef struct result {
+	uint64_t local;
+	uint64_t remote;
+	uint64_t unknown;
+	uint64_t checksum;
+} result_t;
+
+static result_t *results = NULL;
+static atomic_uint_fast32_t done;
+
+static uint64_t
+cpu_usec(void) {
+	struct rusage ru;
+
+	RUNTIME_CHECK(getrusage(RUSAGE_SELF, &ru) == 0);
+
+	return ((ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000ULL +
+		ru.ru_utime.tv_usec + ru.ru_stime.tv_usec);
+}
+
+/*
+ * Find out which NUMA node each page of the buffers is on, and count
+ * them as local or remote to the node the loop is running on.
+ */
+static void
+count_pages(unsigned char **buffers, result_t *result) {
+#if defined(__linux__) && defined(SYS_move_pages)
+	size_t perbuf = BUFSIZE / PAGESIZE;
+	size_t npages = nbuffers * perbuf;
+	void **pages = isc_mem_cget(mctx, npages, sizeof(pages[0]));
+	int *status = isc_mem_cget(mctx, npages, sizeof(status[0]));
+	int cpu = sched_getcpu();
+	unsigned int node = isc_os_numanode(cpu < 0 ? 0 : cpu);
+
+	for (size_t i = 0; i < nbuffers; i++) {
+		for (size_t j = 0; j < perbuf; j++) {
+			pages[i * perbuf + j] = buffers[i] + j * PAGESIZE;
+		}
+	}
+
+	if (syscall(SYS_move_pages, 0, npages, pages, NULL, status, 0) == 0)
+	{
+		for (size_t i = 0; i < npages; i++) {
+			if (status[i] < 0) {
+				result->unknown++;
+			} else if ((unsigned int)status[i] == node) {
+				result->local++;
+			} else {
+				result->remote++;
+			}
+		}
+	} else {
+		result->unknown += npages;
+	}
+
+	isc_mem_cput(mctx, status, npages, sizeof(status[0]));
+	isc_mem_cput(mctx, pages, npages, sizeof(pages[0]));
+#else
+	UNUSED(buffers);
+
+	result->unknown += nbuffers * (BUFSIZE / PAGESIZE);
+#endif
+}
+
+static void
+workload(void *arg) {
+	isc_loop_t *loop = isc_loop();
+	result_t *result = &results[isc_tid()];
+	isc_mem_t *lmctx = NULL;
+	unsigned char **buffers = NULL;
+
+	UNUSED(arg);
+
+	isc_loop_createmctx(loop, &lmctx);
+	buffers = isc_mem_cget(lmctx, nbuffers, sizeof(buffers[0]));
+	for (size_t i = 0; i < nbuffers; i++) {
+		buffers[i] = isc_mem_get(lmctx, BUFSIZE);
+		memset(buffers[i], 0, BUFSIZE);
+	}
+
+	for (size_t r = 0; r < rounds; r++) {
+		for (size_t i = 0; i < nbuffers; i++) {
+			uint64_t *words = (uint64_t *)buffers[i];
+
+			for (size_t j = 0; j < BUFSIZE / sizeof(*words); j++) {
+				result->checksum += words[j];
+				words[j] += r ^ j;
+			}
+		}
+	}
+
+	count_pages(buffers, result);
+
+	for (size_t i = 0; i < nbuffers; i++) {
+		isc_mem_put(lmctx, buffers[i], BUFSIZE);
+	}
+	isc_mem_cput(lmctx, buffers, nbuffers, sizeof(buffers[0]));
+	isc_mem_destroy(&lmctx);
+
+	if (atomic_fetch_add(&done, 1) + 1 == nloops) {
+		isc_loopmgr_shutdown(loopmgr);
+	}
+}
+
+static void
+run(size_t m) {
+	result_t total = { 0 };
+	isc_time_t start, finish;
+	uint64_t cpu_start, cpu;
+	uint64_t pages;
+
+	results = isc_mem_cget(mctx, nloops, sizeof(results[0]));
+	atomic_init(&done, 0);
+
+	isc_loopmgr_setaffinity(modes[m].affinity);
+	isc_loopmgr_create(mctx, nloops, &loopmgr);
+	isc_loopmgr_setup(loopmgr, workload, NULL);
+
+	start = isc_time_now_hires();
+	cpu_start = cpu_usec();
+	isc_loopmgr_run(loopmgr);
+	cpu = cpu_usec() - cpu_start;
+	finish = isc_time_now_hires();
+
+	isc_loopmgr_destroy(&loopmgr);
+
+	for (size_t i = 0; i < nloops; i++) {
+		total.local += results[i].local;
+		total.remote += results[i].remote;
+		total.unknown += results[i].unknown;
+	}
+	pages = ISC_MAX(total.local + total.remote + total.unknown, 1);
+
+	printf("%-8s %10.3f ms %10.3f ms CPU %6.1f%% local %6.1f%% remote "
+	       "%6.1f%% unknown\n",
+	       modes[m].what, isc_time_microdiff(&finish, &start) / 1000.0,
+	       cpu / 1000.0, total.local * 100.0 / pages,
+	       total.remote * 100.0 / pages, total.unknown * 100.0 / pages);
+
+	isc_mem_cput(mctx, results, nloops, sizeof(results[0]));
+}
+
+int
+main(int argc, char **argv) {
+	nloops = isc_os_ncpus();
+
+	if (argc > 4) {
+		fprintf(stderr, "usage: %s [threads [buffers [rounds]]]\n",
+			argv[0]);
+		return (EXIT_FAILURE);
+	}
+	if (argc > 1) {
+		nloops = strtoul(argv[1], NULL, 10);
+	}
+	if (argc > 2) {
+		nbuffers = strtoul(argv[2], NULL, 10);
+	}
+	if (argc > 3) {
+		rounds = strtoul(argv[3], NULL, 10);
+	}
+	if (nloops == 0 || nbuffers == 0 || rounds == 0) {
+		fprintf(stderr, "usage: %s [threads [buffers [rounds]]]\n",
+			argv[0]);
+		return (EXIT_FAILURE);
+	}
+
+	setlinebuf(stdout);
+
+	printf("%u threads, %zu buffers of %u bytes each, %zu rounds\n",
+	       nloops, nbuffers, BUFSIZE, rounds);
+
+	isc_mem_create(&mctx);
+
+	/* "none" goes first, as the other modes leave this thread pinned */
+	for (size_t m = 0; m < ARRAY_SIZE(modes); m++) {
+		run(m);
+	}
+
+	isc_mem_destroy(&mctx);
+
+	return (0);
+}
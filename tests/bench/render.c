@@ -0,0 +1,305 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*
+ * Compare the time it takes to render responses from the cache when the
+ * rdata is converted to wire format record by record, and when it is
+ * copied as it is stored in the cache (see "cache-wire-rdata").
+ *
+ * The cache is filled with signed A records for a set of names in the
+ * same zone, and with the NS records of the zone.  Each response has
+ * the question, the A records and their signature in the answer
+ * section, and the NS records in the authority section.  Only the
+ * rendering of the message is timed, not its construction.
+ */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <isc/buffer.h>
+#include <isc/loop.h>
+#include <isc/mem.h>
+#include <isc/random.h>
+#include <isc/result.h>
+#include <isc/stdtime.h>
+#include <isc/time.h>
+#include <isc/util.h>
+
+#include <dns/compress.h>
+#include <dns/db.h>
+#include <dns/fixedname.h>
+#include <dns/message.h>
+#include <dns/name.h>
+#include <dns/rdata.h>
+#include <dns/rdatalist.h>
+#include <dns/rdataset.h>
+
+#include <tests/dns.h>
+
+#define SIGNATURE                                     \
+	"A 13 3 3600 20300101000000 20200101000000 " \
+	"12345 example.com. "                         \
+	"AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8g" \
+	"ISIjJCUmJygpKissLS4vMDEyMzQ1Njc4OTo7PD0+Pw=="
+
+static size_t nnames = 1000;
+static size_t nresponses = 1000000;
+
+static dns_db_t *db = NULL;
+static isc_stdtime_t now;
+
+static dns_fixedname_t zone;
+static dns_rdataset_t nsset;
+static dns_fixedname_t *names = NULL;
+static dns_rdataset_t *asets = NULL;
+static dns_rdataset_t *sigsets = NULL;
+
+static void
+CHECKRESULT(isc_result_t result, const char *msg) {
+	if (result != ISC_R_SUCCESS) {
+		fprintf(stderr, "%s: %s\n", msg, isc_result_totext(result));
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void
+add(const dns_name_t *name, dns_rdatatype_t type, dns_rdatatype_t covers,
+    const char **rdatas, size_t count) {
+	dns_rdatalist_t rdatalist;
+	dns_rdataset_t rdataset;
+	dns_rdata_t rdata[4];
+	unsigned char data[4][256];
+	dns_dbnode_t *node = NULL;
+	isc_result_t result;
+
+	INSIST(count <= ARRAY_SIZE(rdata));
+
+	dns_rdatalist_init(&rdatalist);
+	rdatalist.rdclass = dns_rdataclass_in;
+	rdatalist.type = type;
+	rdatalist.covers = covers;
+	rdatalist.ttl = 3600;
+	for (size_t i = 0; i < count; i++) {
+		dns_rdata_init(&rdata[i]);
+		result = dns_test_rdatafromstring(
+			&rdata[i], dns_rdataclass_in, type, data[i],
+			sizeof(data[i]), rdatas[i], false);
+		CHECKRESULT(result, rdatas[i]);
+		ISC_LIST_APPEND(rdatalist.rdata, &rdata[i], link);
+	}
+
+	dns_rdataset_init(&rdataset);
+	dns_rdatalist_tordataset(&rdatalist, &rdataset);
+	rdataset.trust = dns_trust_authanswer;
+
+	result = dns_db_findnode(db, name, true, &node);
+	CHECKRESULT(result, "dns_db_findnode");
+	result = dns_db_addrdataset(db, node, NULL, now, &rdataset, 0, NULL);
+	CHECKRESULT(result, "dns_db_addrdataset");
+	dns_db_detachnode(db, &node);
+	dns_rdataset_disassociate(&rdataset);
+}
+
+static void
+find(const dns_name_t *name, dns_rdatatype_t type, dns_rdataset_t *rdataset,
+     dns_rdataset_t *sigrdataset) {
+	dns_dbnode_t *node = NULL;
+	isc_result_t result;
+
+	result = dns_db_findnode(db, name, false, &node);
+	CHECKRESULT(result, "dns_db_findnode");
+	result = dns_db_findrdataset(db, node, NULL, type, 0, now, rdataset,
+				     sigrdataset);
+	CHECKRESULT(result, "dns_db_findrdataset");
+	dns_db_detachnode(db, &node);
+}
+
+static void
+fill(void) {
+	const char *ns[] = { "ns1.example.com.", "ns2.example.com.",
+			     "ns3.example.com.", "ns4.example.com." };
+	const char *a[] = { "192.0.2.1", "192.0.2.2" };
+	const char *sig[] = { SIGNATURE };
+	isc_result_t result;
+
+	result = dns_name_fromstring(dns_fixedname_initname(&zone),
+				     "example.com.", dns_rootname, 0, NULL);
+	CHECKRESULT(result, "dns_name_fromstring");
+	add(dns_fixedname_name(&zone), dns_rdatatype_ns, 0, ns,
+	    ARRAY_SIZE(ns));
+
+	for (size_t i = 0; i < nnames; i++) {
+		dns_name_t *name = dns_fixedname_initname(&names[i]);
+		char text[64];
+
+		snprintf(text, sizeof(text), "www%zu.example.com.", i);
+		result = dns_name_fromstring(name, text, dns_rootname, 0,
+					     NULL);
+		CHECKRESULT(result, text);
+
+		add(name, dns_rdatatype_a, 0, a, ARRAY_SIZE(a));
+		add(name, dns_rdatatype_rrsig, dns_rdatatype_a, sig,
+		    ARRAY_SIZE(sig));
+	}
+}
+
+static void
+addrdataset(dns_message_t *msg, const dns_name_t *owner,
+	    dns_section_t section, dns_rdataset_t *source) {
+	dns_name_t *name = NULL;
+	dns_rdataset_t *rdataset = NULL;
+
+	dns_message_gettempname(msg, &name);
+	dns_name_copy(owner, name);
+	dns_message_gettemprdataset(msg, &rdataset);
+	if (source != NULL) {
+		dns_rdataset_clone(source, rdataset);
+	} else {
+		dns_rdataset_makequestion(rdataset, dns_rdataclass_in,
+					  dns_rdatatype_a);
+	}
+	ISC_LIST_APPEND(name->list, rdataset, link);
+	dns_message_addname(msg, name, section);
+}
+
+static void
+bench(const char *what, bool wire) {
+	dns_message_t *msg = NULL;
+	static unsigned char buf[4096];
+	uint64_t microseconds = 0, bytes = 0;
+
+	/* The rdatasets are marked when they are found */
+	dns_db_setwirerdata(db, wire);
+	dns_rdataset_init(&nsset);
+	find(dns_fixedname_name(&zone), dns_rdatatype_ns, &nsset, NULL);
+	for (size_t i = 0; i < nnames; i++) {
+		dns_rdataset_init(&asets[i]);
+		dns_rdataset_init(&sigsets[i]);
+		find(dns_fixedname_name(&names[i]), dns_rdatatype_a, &asets[i],
+		     &sigsets[i]);
+	}
+
+	dns_message_create(mctx, NULL, NULL, DNS_MESSAGE_INTENTRENDER, &msg);
+
+	for (size_t n = 0; n < nresponses; n++) {
+		size_t i = isc_random_uniform(nnames);
+		dns_name_t *name = dns_fixedname_name(&names[i]);
+		isc_time_t start, finish;
+		dns_compress_t cctx;
+		isc_buffer_t buffer;
+		isc_result_t result;
+
+		addrdataset(msg, name, DNS_SECTION_QUESTION, NULL);
+		addrdataset(msg, name, DNS_SECTION_ANSWER, &asets[i]);
+		addrdataset(msg, name, DNS_SECTION_ANSWER, &sigsets[i]);
+		addrdataset(msg, dns_fixedname_name(&zone),
+			    DNS_SECTION_AUTHORITY, &nsset);
+
+		start = isc_time_now_hires();
+
+		isc_buffer_init(&buffer, buf, sizeof(buf));
+		dns_compress_init(&cctx, mctx, 0);
+		result = dns_message_renderbegin(msg, &cctx, &buffer);
+		CHECKRESULT(result, "dns_message_renderbegin");
+		for (dns_section_t section = DNS_SECTION_QUESTION;
+		     section < DNS_SECTION_MAX; section++)
+		{
+			result = dns_message_rendersection(msg, section, 0);
+			CHECKRESULT(result, "dns_message_rendersection");
+		}
+		result = dns_message_renderend(msg);
+		CHECKRESULT(result, "dns_message_renderend");
+		dns_compress_invalidate(&cctx);
+
+		finish = isc_time_now_hires();
+		microseconds += isc_time_microdiff(&finish, &start);
+		bytes += isc_buffer_usedlength(&buffer);
+
+		dns_message_reset(msg, DNS_MESSAGE_INTENTRENDER);
+	}
+
+	dns_message_detach(&msg);
+
+	printf("%-8s %zu responses, %10.3f ms, %8.1f ns/response, "
+	       "%6.1f bytes/response\n",
+	       what, nresponses, microseconds / 1000.0,
+	       microseconds * 1000.0 / nresponses,
+	       (double)bytes / nresponses);
+
+	dns_rdataset_disassociate(&nsset);
+	for (size_t i = 0; i < nnames; i++) {
+		dns_rdataset_disassociate(&asets[i]);
+		dns_rdataset_disassociate(&sigsets[i]);
+	}
+}
+
+static void
+run(void *arg) {
+	isc_result_t result;
+
+	UNUSED(arg);
+
+	result = dns_db_create(mctx, CACHEDB_DEFAULT, dns_rootname,
+			       dns_dbtype_cache, dns_rdataclass_in, 0, NULL,
+			       &db);
+	CHECKRESULT(result, "dns_db_create");
+
+	now = isc_stdtime_now();
+	fill();
+
+	bench("towire", false);
+	bench("wire", true);
+
+	dns_db_detach(&db);
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+int
+main(int argc, char **argv) {
+	if (argc > 3) {
+		fprintf(stderr, "usage: %s [responses [names]]\n", argv[0]);
+		return (EXIT_FAILURE);
+	}
+	if (argc > 1) {
+		nresponses = strtoul(argv[1], NULL, 10);
+	}
+	if (argc > 2) {
+		nnames = strtoul(argv[2], NULL, 10);
+	}
+	if (nresponses == 0 || nnames == 0) {
+		fprintf(stderr, "usage: %s [responses [names]]\n", argv[0]);
+		return (EXIT_FAILURE);
+	}
+
+	isc_mem_create(&mctx);
+	isc_loopmgr_create(mctx, 1, &loopmgr);
+
+	names = isc_mem_cget(mctx, nnames, sizeof(names[0]));
+	asets = isc_mem_cget(mctx, nnames, sizeof(asets[0]));
+	sigsets = isc_mem_cget(mctx, nnames, sizeof(sigsets[0]));
+
+	isc_loop_setup(isc_loop_main(loopmgr), run, NULL);
+	isc_loopmgr_run(loopmgr);
+
+	isc_mem_cput(mctx, names, nnames, sizeof(names[0]));
+	isc_mem_cput(mctx, asets, nnames, sizeof(asets[0]));
+	isc_mem_cput(mctx, sigsets, nnames, sizeof(sigsets[0]));
+
+	isc_loopmgr_destroy(&loopmgr);
+	isc_mem_destroy(&mctx);
+
+	return (0);
+}
@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*
+ * Compare the cost of a large number of zone maintenance timers when
+ * each of them is an isc_timer_t (a libuv timer in the loop heap) and
+ * when they are all kept on one isc_timerwheel_t.
+ *
+ * The timers are armed with the intervals typical for zone refresh,
+ * rearmed, cancelled, and finally all armed to expire within a second
+ * as happens during a refresh storm.
+ */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+#include <isc/loop.h>
+#include <isc/mem.h>
+#include <isc/random.h>
+#include <isc/time.h>
+#include <isc/timer.h>
+#include <isc/timerwheel.h>
+#include <isc/util.h>
+
+#define TICK 100 /* milliseconds */
+
+static size_t ntimers = 1000000;
+
+static isc_loopmgr_t *loopmgr = NULL;
+static isc_mem_t *mctx = NULL;
+
+static isc_timer_t **timers = NULL;
+static isc_timerwheel_entry_t *entries = NULL;
+static isc_timerwheel_t *wheel = NULL;
+static size_t fired = 0;
+
+static const char *phase = NULL;
+static isc_time_t start;
+static uint64_t cpu_start;
+
+static uint64_t
+cpu_usec(void) {
+	struct rusage ru;
+
+	RUNTIME_CHECK(getrusage(RUSAGE_SELF, &ru) == 0);
+
+	return ((ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000ULL +
+		ru.ru_utime.tv_usec + ru.ru_stime.tv_usec);
+}
+
+static void
+phase_start(const char *what) {
+	phase = what;
+	start = isc_time_now_hires();
+	cpu_start = cpu_usec();
+}
+
+static void
+phase_end(void) {
+	uint64_t cpu = cpu_usec() - cpu_start;
+	isc_time_t finish = isc_time_now_hires();
+	uint64_t microseconds = isc_time_microdiff(&finish, &start);
+
+	printf("%-24s %10.3f ms %10.3f ms CPU %8.1f ns CPU per timer\n", phase,
+	       microseconds / 1000.0, cpu / 1000.0,
+	       cpu * 1000.0 / (double)ntimers);
+}
+
+/* A zone refresh interval, between an hour and a day */
+static void
+refresh_interval(isc_interval_t *interval) {
+	isc_interval_set(interval, 3600 + isc_random_uniform(23 * 3600),
+			 isc_random_uniform(1000) * NS_PER_MS);
+}
+
+/* A refresh storm, everything expires within a second */
+static void
+storm_interval(isc_interval_t *interval) {
+	isc_interval_set(interval, 0, isc_random_uniform(1000) * NS_PER_MS);
+}
+
+static void
+wheel_fired(void *arg) {
+	UNUSED(arg);
+
+	if (++fired < ntimers) {
+		return;
+	}
+
+	phase_end();
+
+	isc_timerwheel_stats_t stats;
+	isc_timerwheel_getstats(wheel, &stats);
+	printf("wheel: %" PRIu64 " armed, %" PRIu64 " canceled, %" PRIu64
+	       " fired, %" PRIu64 " cascaded, %" PRIu64 " batches\n",
+	       stats.armed, stats.canceled, stats.fired, stats.cascaded,
+	       stats.batches);
+
+	isc_mem_cput(mctx, entries, ntimers, sizeof(entries[0]));
+	isc_timerwheel_detach(&wheel);
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+static void
+bench_wheel(void) {
+	isc_interval_t interval;
+
+	entries = isc_mem_cget(mctx, ntimers, sizeof(entries[0]));
+	isc_timerwheel_create(isc_loop(), TICK, &wheel);
+
+	phase_start("isc_timerwheel arm");
+	for (size_t i = 0; i < ntimers; i++) {
+		isc_timerwheel_entryinit(&entries[i], wheel_fired, NULL);
+		refresh_interval(&interval);
+		isc_timerwheel_arm(wheel, &entries[i], &interval);
+	}
+	phase_end();
+
+	phase_start("isc_timerwheel rearm");
+	for (size_t i = 0; i < ntimers; i++) {
+		refresh_interval(&interval);
+		isc_timerwheel_arm(wheel, &entries[i], &interval);
+	}
+	phase_end();
+
+	phase_start("isc_timerwheel cancel");
+	for (size_t i = 0; i < ntimers; i++) {
+		isc_timerwheel_cancel(&entries[i]);
+	}
+	phase_end();
+
+	fired = 0;
+	phase_start("isc_timerwheel expire");
+	for (size_t i = 0; i < ntimers; i++) {
+		storm_interval(&interval);
+		isc_timerwheel_arm(wheel, &entries[i], &interval);
+	}
+}
+
+static void
+timer_fired(void *arg) {
+	UNUSED(arg);
+
+	if (++fired < ntimers) {
+		return;
+	}
+
+	phase_end();
+
+	phase_start("isc_timer destroy");
+	for (size_t i = 0; i < ntimers; i++) {
+		isc_timer_destroy(&timers[i]);
+	}
+	phase_end();
+
+	isc_mem_cput(mctx, timers, ntimers, sizeof(timers[0]));
+
+	bench_wheel();
+}
+
+static void
+bench_timer(void *arg) {
+	isc_interval_t interval;
+
+	UNUSED(arg);
+
+	timers = isc_mem_cget(mctx, ntimers, sizeof(timers[0]));
+
+	phase_start("isc_timer arm");
+	for (size_t i = 0; i < ntimers; i++) {
+		isc_timer_create(isc_loop(), timer_fired, NULL, &timers[i]);
+		refresh_interval(&interval);
+		isc_timer_start(timers[i], isc_timertype_once, &interval);
+	}
+	phase_end();
+
+	phase_start("isc_timer rearm");
+	for (size_t i = 0; i < ntimers; i++) {
+		refresh_interval(&interval);
+		isc_timer_start(timers[i], isc_timertype_once, &interval);
+	}
+	phase_end();
+
+	phase_start("isc_timer cancel");
+	for (size_t i = 0; i < ntimers; i++) {
+		isc_timer_stop(timers[i]);
+	}
+	phase_end();
+
+	fired = 0;
+	phase_start("isc_timer expire");
+	for (size_t i = 0; i < ntimers; i++) {
+		storm_interval(&interval);
+		isc_timer_start(timers[i], isc_timertype_once, &interval);
+	}
+}
+
+int
+main(int argc, char **argv) {
+	if (argc > 1) {
+		ntimers = strtoul(argv[1], NULL, 10);
+		if (ntimers == 0) {
+			fprintf(stderr, "usage: %s [timers]\n", argv[0]);
+			return (EXIT_FAILURE);
+		}
+	}
+
+	setlinebuf(stdout);
+
+	printf("%zu timers, %u ms wheel tick\n", ntimers, TICK);
+
+	isc_mem_create(&mctx);
+	isc_loopmgr_create(mctx, 1, &loopmgr);
+	isc_loop_setup(isc_loop_main(loopmgr), bench_timer, NULL);
+	isc_loopmgr_run(loopmgr);
+	isc_loopmgr_destroy(&loopmgr);
+	isc_mem_destroy(&mctx);
+
+	return (0);
+}
@@ -0,0 +1,215 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/*
+ * Measure the cost of the full TLS handshakes compared to the ones
+ * resumed from a session ticket, and check that the tickets survive
+ * the replacement of the server TLS context (as happens on reconfig)
+ * and the rotation of the ticket keys.
+ *
+ * The handshakes are done in memory over a BIO pair, so that only the
+ * cryptography is measured.
+ */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <openssl/bio.h>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+
+#include <isc/mem.h>
+#include <isc/time.h>
+#include <isc/tls.h>
+#include <isc/util.h>
+
+#define SID_CTX "bench/dot"
+
+static isc_mem_t *mctx = NULL;
+static isc_tlsctx_ticketkeys_t *ticketkeys = NULL;
+
+static isc_tlsctx_t *
+server_ctx(void) {
+	isc_tlsctx_t *ctx = NULL;
+
+	RUNTIME_CHECK(isc_tlsctx_createserver(NULL, NULL, &ctx) ==
+		      ISC_R_SUCCESS);
+	isc_tlsctx_set_ticketkeys(ctx, ticketkeys,
+				  (const char *[]){ SID_CTX, NULL });
+
+	return (ctx);
+}
+
+/*
+ * Do one handshake, optionally offering 'session'; return whether the
+ * session was resumed and store the new session in '*sessionp'.
+ */
+static bool
+handshake(isc_tlsctx_t *sctx, isc_tlsctx_t *cctx, SSL_SESSION *session,
+	  SSL_SESSION **sessionp) {
+	isc_tls_t *server = isc_tls_create(sctx);
+	isc_tls_t *client = isc_tls_create(cctx);
+	BIO *sbio = NULL, *cbio = NULL;
+	bool sdone = false, cdone = false;
+	unsigned char byte;
+	bool resumed;
+
+	RUNTIME_CHECK(server != NULL && client != NULL);
+	RUNTIME_CHECK(BIO_new_bio_pair(&sbio, 0, &cbio, 0) == 1);
+	SSL_set_bio(server, sbio, sbio);
+	SSL_set_bio(client, cbio, cbio);
+	SSL_set_accept_state(server);
+	SSL_set_connect_state(client);
+
+	if (session != NULL) {
+		RUNTIME_CHECK(SSL_set_session(client, session) == 1);
+	}
+
+	while (!sdone || !cdone) {
+		int rv;
+
+		if (!cdone) {
+			rv = SSL_do_handshake(client);
+			if (rv == 1) {
+				cdone = true;
+			} else if (SSL_get_error(client, rv) !=
+				   SSL_ERROR_WANT_READ)
+			{
+				fprintf(stderr, "client handshake failed\n");
+				ERR_print_errors_fp(stderr);
+				exit(EXIT_FAILURE);
+			}
+		}
+		if (!sdone) {
+			rv = SSL_do_handshake(server);
+			if (rv == 1) {
+				sdone = true;
+			} else if (SSL_get_error(server, rv) !=
+				   SSL_ERROR_WANT_READ)
+			{
+				fprintf(stderr, "server handshake failed\n");
+				ERR_print_errors_fp(stderr);
+				exit(EXIT_FAILURE);
+			}
+		}
+	}
+
+	/* TLS 1.3 delivers the session tickets after the handshake */
+	(void)SSL_read(client, &byte, sizeof(byte));
+
+	resumed = SSL_session_reused(client);
+	if (sessionp != NULL) {
+		*sessionp = SSL_get1_session(client);
+	}
+
+	isc_tls_free(&client);
+	isc_tls_free(&server);
+
+	return (resumed);
+}
+
+static void
+time_it(const char *what, isc_tlsctx_t *sctx, isc_tlsctx_t *cctx,
+	SSL_SESSION *session, int count) {
+	isc_time_t start, finish;
+	int resumed = 0;
+
+	printf("%d %s handshakes: ", count, what);
+	fflush(stdout);
+
+	start = isc_time_now_hires();
+
+	for (int i = 0; i < count; i++) {
+		if (handshake(sctx, cctx, session, NULL)) {
+			resumed++;
+		}
+	}
+
+	finish = isc_time_now_hires();
+
+	uint64_t microseconds = isc_time_microdiff(&finish, &start);
+	printf("%0.2f us per handshake, %0.0f handshakes/s, %d resumed\n",
+	       (double)microseconds / count,
+	       (double)count * 1000000.0 / microseconds, resumed);
+	fflush(stdout);
+}
+
+static void
+print_stats(void) {
+	isc_tlsctx_ticketkeys_stats_t stats;
+
+	isc_tlsctx_ticketkeys_getstats(ticketkeys, &stats);
+	printf("tickets: %" PRIu64 " issued, %" PRIu64 " resumed, %" PRIu64
+	       " renewed, %" PRIu64 " rejected, %" PRIu64 " rotations\n",
+	       stats.issued, stats.resumed, stats.renewed, stats.rejected,
+	       stats.rotations);
+}
+
+int
+main(int argc, char **argv) {
+	isc_tlsctx_t *sctx = NULL, *cctx = NULL;
+	SSL_SESSION *session = NULL, *renewed = NULL;
+	int count = 1000;
+
+	if (argc > 1) {
+		count = atoi(argv[1]);
+		if (count <= 0) {
+			fprintf(stderr, "usage: %s [count]\n", argv[0]);
+			return (EXIT_FAILURE);
+		}
+	}
+
+	isc_mem_create(&mctx);
+	isc_tlsctx_ticketkeys_create(mctx, 3600, &ticketkeys);
+
+	sctx = server_ctx();
+	RUNTIME_CHECK(isc_tlsctx_createclient(&cctx) == ISC_R_SUCCESS);
+
+	(void)handshake(sctx, cctx, NULL, &session);
+	RUNTIME_CHECK(session != NULL);
+
+	time_it("full", sctx, cctx, NULL, count);
+	time_it("resumed", sctx, cctx, session, count);
+
+	/* A new server context, as created on reconfiguration */
+	isc_tlsctx_free(&sctx);
+	sctx = server_ctx();
+	printf("resumed after context replacement: %s\n",
+	       handshake(sctx, cctx, session, NULL) ? "yes" : "no");
+
+	/* An old key is still accepted and the ticket is reissued */
+	isc_tlsctx_ticketkeys_rotate(ticketkeys);
+	printf("resumed after one key rotation: %s\n",
+	       handshake(sctx, cctx, session, &renewed) ? "yes" : "no");
+
+	/* The tickets protected by the retired keys are rejected */
+	isc_tlsctx_ticketkeys_rotate(ticketkeys);
+	isc_tlsctx_ticketkeys_rotate(ticketkeys);
+	isc_tlsctx_ticketkeys_rotate(ticketkeys);
+	printf("resumed after key retirement: %s\n",
+	       handshake(sctx, cctx, session, NULL) ? "yes" : "no");
+
+	print_stats();
+
+	SSL_SESSION_free(renewed);
+	SSL_SESSION_free(session);
+	isc_tlsctx_free(&cctx);
+	isc_tlsctx_free(&sctx);
+	isc_tlsctx_ticketkeys_detach(&ticketkeys);
+	isc_mem_destroy(&mctx);
+
+	return (0);
+}
@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <arpa/inet.h>
+#include <inttypes.h>
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/sockaddr.h>
+#include <isc/tls.h>
+#include <isc/util.h>
+
+#include <dns/dispatch.h>
+#include <dns/view.h>
+#define KEEP_BEFORE
+
+/* Include the main file */
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wshadow"
+#undef CHECK
+#include "adb.c"
+#pragma GCC diagnostic pop
+
+#undef CHECK
+#include <tests/dns.h>
+
+static dns_view_t *view = NULL;
+static dns_dispatch_t *dispatch = NULL;
+static isc_tlsctx_cache_t *tlsctx_cache = NULL;
+static dns_adb_t *adb = NULL;
+static unsigned int naddrs = 0;
+
+static void
+adb_setup(void) {
+	isc_result_t result;
+	isc_sockaddr_t local;
+	dns_dispatchmgr_t *dispatchmgr = NULL;
+
+	result = dns_test_makeview("view", true, false, &view);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	dispatchmgr = dns_view_getdispatchmgr(view);
+	isc_sockaddr_any(&local);
+	result = dns_dispatch_createudp(dispatchmgr, &local, &dispatch);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_dispatchmgr_detach(&dispatchmgr);
+
+	isc_tlsctx_cache_create(mctx, &tlsctx_cache);
+	result = dns_view_createresolver(view, netmgr, 0, tlsctx_cache,
+					 dispatch, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	dns_view_getadb(view, &adb);
+	assert_non_null(adb);
+}
+
+static void
+adb_teardown(void) {
+	dns_adb_detach(&adb);
+	dns_view_detach(&view);
+	dns_dispatch_detach(&dispatch);
+	isc_tlsctx_cache_detach(&tlsctx_cache);
+
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+/*
+ * Get the address info of a server the ADB has not seen before.
+ */
+static dns_adbaddrinfo_t *
+newaddr(void) {
+	dns_adbaddrinfo_t *addr = NULL;
+	struct in_addr ina;
+	isc_sockaddr_t sa;
+	isc_result_t result;
+
+	ina.s_addr = htonl(0xc0000200 + naddrs++); /* 192.0.2.0/24 */
+	isc_sockaddr_fromin(&sa, &ina, 53);
+
+	result = dns_adb_findaddrinfo(adb, &sa, &addr, 0);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_int_equal(addr->entry->rttsamples, 0);
+
+	return (addr);
+}
+
+static void
+sample(dns_adbaddrinfo_t *addr, unsigned int rtt, unsigned int n) {
+	for (unsigned int i = 0; i < n; i++) {
+		dns_adb_rttsample(adb, addr, rtt);
+	}
+}
+
+/* no quantile is known until enough responses have been counted */
+ISC_LOOP_TEST_IMPL(rttquantile_minsamples) {
+	dns_adbaddrinfo_t *addr = NULL;
+
+	UNUSED(arg);
+
+	adb_setup();
+
+	addr = newaddr();
+	assert_int_equal(dns_adb_rttquantile(adb, addr, 500), 0);
+
+	sample(addr, 5000, ADB_RTT_MINSAMPLES - 1);
+	assert_int_equal(dns_adb_rttquantile(adb, addr, 500), 0);
+	assert_int_equal(dns_adb_rttquantile(adb, addr, 1000), 0);
+
+	sample(addr, 5000, 1);
+	assert_int_equal(dns_adb_rttquantile(adb, addr, 1), 6000);
+	assert_int_equal(dns_adb_rttquantile(adb, addr, 1000), 6000);
+
+	dns_adb_freeaddrinfo(adb, &addr);
+	adb_teardown();
+}
+
+/* each bucket takes the times up to and including its bound */
+ISC_LOOP_TEST_IMPL(rttquantile_buckets) {
+	dns_adbaddrinfo_t *addr = NULL;
+
+	UNUSED(arg);
+
+	adb_setup();
+
+	for (size_t i = 0; i < ADB_RTT_BUCKETS; i++) {
+		addr = newaddr();
+		sample(addr, rttbounds[i], ADB_RTT_MINSAMPLES);
+		assert_int_equal(dns_adb_rttquantile(adb, addr, 1000),
+				 rttbounds[i]);
+		dns_adb_freeaddrinfo(adb, &addr);
+
+		if (i + 1 == ADB_RTT_BUCKETS) {
+			break;
+		}
+
+		addr = newaddr();
+		sample(addr, rttbounds[i] + 1, ADB_RTT_MINSAMPLES);
+		assert_int_equal(dns_adb_rttquantile(adb, addr, 1000),
+				 rttbounds[i + 1]);
+		dns_adb_freeaddrinfo(adb, &addr);
+	}
+
+	/* the quantile is rounded up to a whole response */
+	addr = newaddr();
+	sample(addr, 1000, 90);
+	sample(addr, 100000, 10);
+	assert_int_equal(dns_adb_rttquantile(adb, addr, 900), 1000);
+	assert_int_equal(dns_adb_rttquantile(adb, addr, 901), 128000);
+	assert_int_equal(dns_adb_rttquantile(adb, addr, 1000), 128000);
+	dns_adb_freeaddrinfo(adb, &addr);
+
+	adb_teardown();
+}
+
+/* the counts are halved so that the recent responses weigh more */
+ISC_LOOP_TEST_IMPL(rttquantile_halving) {
+	dns_adbaddrinfo_t *addr = NULL;
+
+	UNUSED(arg);
+
+	adb_setup();
+
+	addr = newaddr();
+	sample(addr, 1000, ADB_RTT_MAXSAMPLES - 1);
+	assert_int_equal(addr->entry->rttsamples, ADB_RTT_MAXSAMPLES - 1);
+	assert_int_equal(addr->entry->rtthist[0], ADB_RTT_MAXSAMPLES - 1);
+
+	sample(addr, 1000, 1);
+	assert_int_equal(addr->entry->rttsamples, ADB_RTT_MAXSAMPLES / 2);
+	assert_int_equal(addr->entry->rtthist[0], ADB_RTT_MAXSAMPLES / 2);
+
+	/*
+	 * The server becomes slow: once there are as many slow responses
+	 * as there were fast ones left, the counts are halved again and
+	 * the slow responses soon make up most of the histogram.
+	 */
+	sample(addr, 100000, ADB_RTT_MAXSAMPLES / 2);
+	assert_int_equal(addr->entry->rttsamples, ADB_RTT_MAXSAMPLES / 2);
+	assert_int_equal(addr->entry->rtthist[0], ADB_RTT_MAXSAMPLES / 4);
+
+	sample(addr, 100000, ADB_RTT_MAXSAMPLES / 10);
+	assert_int_equal(dns_adb_rttquantile(adb, addr, 500), 128000);
+
+	dns_adb_freeaddrinfo(adb, &addr);
+	adb_teardown();
+}
+
+ISC_TEST_LIST_START
+ISC_TEST_ENTRY_CUSTOM(rttquantile_minsamples, setup_managers,
+		      teardown_managers)
+ISC_TEST_ENTRY_CUSTOM(rttquantile_buckets, setup_managers, teardown_managers)
+ISC_TEST_ENTRY_CUSTOM(rttquantile_halving, setup_managers, teardown_managers)
+ISC_TEST_LIST_END
+
+ISC_TEST_MAIN
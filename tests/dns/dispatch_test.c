@@ -24,6 +24,7 @@
 #define UNIT_TESTING
 #include <cmocka.h>
 
+#include <isc/async.h>
 #include <isc/buffer.h>
 #include <isc/managers.h>
 #include <isc/refcount.h>
@@ -559,6 +560,42 @@ connected_newtcp(isc_result_t eresult ISC_ATTR_UNUSED,
 	test_dispatch_done(test3);
 }
 
+static void
+connected_getpooled(isc_result_t eresult ISC_ATTR_UNUSED,
+		    isc_region_t *region ISC_ATTR_UNUSED, void *arg) {
+	test_dispatch_t *test1 = arg;
+
+	/* Client 2 */
+	isc_result_t result;
+	test_dispatch_t *test2 = isc_mem_get(mctx, sizeof(*test2));
+	*test2 = (test_dispatch_t){
+		.dispatchmgr = dns_dispatchmgr_ref(test1->dispatchmgr),
+	};
+
+	/* The pooled connection is not shared with the other queries */
+	result = dns_dispatch_gettcp(test2->dispatchmgr, &tcp_server_addr,
+				     &tcp_connect_addr, &test2->dispatch);
+	assert_int_equal(result, ISC_R_NOTFOUND);
+
+	result = dns_dispatch_getpooled(test2->dispatchmgr, &tcp_connect_addr,
+					&tcp_server_addr, NULL, 1,
+					&test2->dispatch);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	assert_ptr_equal(test1->dispatch, test2->dispatch);
+
+	result = dns_dispatch_add(test2->dispatch, isc_loop_main(loopmgr), 0,
+				  T_CLIENT_CONNECT, &tcp_server_addr, NULL,
+				  NULL, connected_shutdown, client_senddone,
+				  response_noop, test2, &test2->id,
+				  &test2->dispentry);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	dns_dispatch_connect(test2->dispentry);
+
+	test_dispatch_done(test1);
+}
+
 static void
 timeout_connected(isc_result_t eresult, isc_region_t *region ISC_ATTR_UNUSED,
 		  void *arg) {
@@ -796,6 +833,97 @@ ISC_LOOP_TEST_IMPL(dispatch_getnext) {
 	dns_dispatch_connect(test->dispentry);
 }
 
+static in_port_t reused_port = 0;
+
+static void
+response_reused(isc_result_t eresult, isc_region_t *region ISC_ATTR_UNUSED,
+		void *arg) {
+	test_dispatch_t *test = arg;
+	isc_sockaddr_t local;
+	isc_result_t result;
+
+	assert_int_equal(eresult, ISC_R_SUCCESS);
+
+	result = dns_dispentry_getlocaladdress(test->dispentry, &local);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_int_equal(isc_sockaddr_getport(&local), reused_port);
+
+	test_dispatch_shutdown(test);
+}
+
+static void
+reuse_socket(void *arg) {
+	test_dispatch_t *test = arg;
+	isc_result_t result;
+
+	result = dns_dispatch_add(
+		test->dispatch, isc_loop_main(loopmgr), 0, T_CLIENT_CONNECT,
+		&udp_server_addr, NULL, NULL, connected, client_senddone,
+		response_reused, test, &test->id, &test->dispentry);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	testdata.message[0] = (test->id >> 8) & 0xff;
+	testdata.message[1] = test->id & 0xff;
+
+	dns_dispatch_connect(test->dispentry);
+}
+
+static void
+response_reuse(isc_result_t eresult, isc_region_t *region ISC_ATTR_UNUSED,
+	       void *arg) {
+	test_dispatch_t *test = arg;
+	isc_sockaddr_t local;
+	isc_result_t result;
+
+	assert_int_equal(eresult, ISC_R_SUCCESS);
+
+	result = dns_dispentry_getlocaladdress(test->dispentry, &local);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	reused_port = isc_sockaddr_getport(&local);
+
+	/* The socket goes back to the pool when the query is done */
+	dns_dispatch_done(&test->dispentry);
+	isc_async_run(isc_loop_main(loopmgr), reuse_socket, test);
+}
+
+/* the next query to the same server is sent from the same socket */
+ISC_LOOP_TEST_IMPL(dispatch_udpreuse) {
+	isc_result_t result;
+	test_dispatch_t *test = isc_mem_get(mctx, sizeof(*test));
+	*test = (test_dispatch_t){ 0 };
+
+	/* Server */
+	result = isc_nm_listenudp(netmgr, ISC_NM_LISTEN_ONE, &udp_server_addr,
+				  nameserver, NULL, &sock);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	isc_loop_teardown(isc_loop_main(loopmgr), stop_listening, sock);
+
+	/* Client */
+	testdata.region.base = testdata.message;
+	testdata.region.length = sizeof(testdata.message);
+
+	result = dns_dispatchmgr_create(mctx, loopmgr, connect_nm,
+					&test->dispatchmgr);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_dispatchmgr_setudpreuse(test->dispatchmgr, 2);
+
+	result = dns_dispatch_createudp(test->dispatchmgr, &udp_connect_addr,
+					&test->dispatch);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_dispatch_add(
+		test->dispatch, isc_loop_main(loopmgr), 0, T_CLIENT_CONNECT,
+		&udp_server_addr, NULL, NULL, connected, client_senddone,
+		response_reuse, test, &test->id, &test->dispentry);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	testdata.message[0] = (test->id >> 8) & 0xff;
+	testdata.message[1] = test->id & 0xff;
+
+	dns_dispatch_connect(test->dispentry);
+}
+
 ISC_LOOP_TEST_IMPL(dispatch_gettcp) {
 	isc_result_t result;
 	test_dispatch_t *test = isc_mem_get(mctx, sizeof(*test));
@@ -861,9 +989,44 @@ ISC_LOOP_TEST_IMPL(dispatch_newtcp) {
 	dns_dispatch_connect(test->dispentry);
 }
 
+ISC_LOOP_TEST_IMPL(dispatch_getpooled) {
+	isc_result_t result;
+	test_dispatch_t *test = isc_mem_get(mctx, sizeof(*test));
+	*test = (test_dispatch_t){ 0 };
+
+	/* Server */
+	result = isc_nm_listenstreamdns(
+		netmgr, ISC_NM_LISTEN_ONE, &tcp_server_addr, nameserver, NULL,
+		accept_cb, NULL, 0, NULL, NULL, ISC_NM_PROXY_NONE, &sock);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	/* ensure we stop listening after the test is done */
+	isc_loop_teardown(isc_loop_main(loopmgr), stop_listening, sock);
+
+	result = dns_dispatchmgr_create(mctx, loopmgr, connect_nm,
+					&test->dispatchmgr);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	/* Client */
+	result = dns_dispatch_getpooled(test->dispatchmgr, &tcp_connect_addr,
+					&tcp_server_addr, NULL, 1,
+					&test->dispatch);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_dispatch_add(
+		test->dispatch, isc_loop_main(loopmgr), 0, T_CLIENT_CONNECT,
+		&tcp_server_addr, NULL, NULL, connected_getpooled,
+		client_senddone, response_noop, test, &test->id,
+		&test->dispentry);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	dns_dispatch_connect(test->dispentry);
+}
+
 ISC_TEST_LIST_START
 ISC_TEST_ENTRY_CUSTOM(dispatch_gettcp, setup_test, teardown_test)
 ISC_TEST_ENTRY_CUSTOM(dispatch_newtcp, setup_test, teardown_test)
+ISC_TEST_ENTRY_CUSTOM(dispatch_getpooled, setup_test, teardown_test)
 ISC_TEST_ENTRY_CUSTOM(dispatch_timeout_udp_response, setup_test, teardown_test)
 ISC_TEST_ENTRY_CUSTOM(dispatchset_create, setup_test, teardown_test)
 ISC_TEST_ENTRY_CUSTOM(dispatchset_get, setup_test, teardown_test)
@@ -872,6 +1035,7 @@ ISC_TEST_ENTRY_CUSTOM(dispatch_timeout_tcp_connect, setup_test, teardown_test)
 ISC_TEST_ENTRY_CUSTOM(dispatch_tcp_response, setup_test, teardown_test)
 ISC_TEST_ENTRY_CUSTOM(dispatch_tls_response, setup_test, teardown_test)
 ISC_TEST_ENTRY_CUSTOM(dispatch_getnext, setup_test, teardown_test)
+ISC_TEST_ENTRY_CUSTOM(dispatch_udpreuse, setup_test, teardown_test)
 ISC_TEST_LIST_END
 
 ISC_TEST_MAIN
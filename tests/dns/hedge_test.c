@@ -0,0 +1,346 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <arpa/inet.h>
+#include <inttypes.h>
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/netmgr.h>
+#include <isc/random.h>
+#include <isc/sockaddr.h>
+#include <isc/stats.h>
+#include <isc/tls.h>
+#include <isc/util.h>
+
+#include <dns/adb.h>
+#include <dns/dispatch.h>
+#include <dns/forward.h>
+#include <dns/resolver.h>
+#include <dns/view.h>
+#define KEEP_BEFORE
+
+/* Include the main file */
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wshadow"
+#undef CHECK
+#include "resolver.c"
+#pragma GCC diagnostic pop
+
+#undef CHECK
+#include <tests/dns.h>
+
+/*
+ * The fetches are forwarded to two local servers.  As far as the ADB
+ * knows, the first one always answers within a millisecond, so it is
+ * queried first and its response is late after HEDGE_MIN_US; but it
+ * never answers.  The second one answers at once.
+ */
+typedef struct server {
+	isc_sockaddr_t addr;
+	isc_nmsocket_t *sock;
+	bool answer;
+	atomic_uint queries;
+	unsigned char response[512];
+} server_t;
+
+static server_t servers[2];
+static dns_view_t *view = NULL;
+static dns_dispatch_t *dispatch = NULL;
+static isc_tlsctx_cache_t *tlsctx_cache = NULL;
+static isc_stats_t *stats = NULL;
+static dns_fetch_t *fetch = NULL;
+static dns_rdataset_t rdataset;
+
+static void
+server_senddone(isc_nmhandle_t *handle, isc_result_t eresult, void *arg) {
+	UNUSED(handle);
+	UNUSED(eresult);
+	UNUSED(arg);
+}
+
+/*
+ * Answer a query with its question and one A record for the QNAME.
+ */
+static void
+server_recv(isc_nmhandle_t *handle, isc_result_t eresult,
+	    isc_region_t *region, void *arg) {
+	static const unsigned char answer[] = {
+		0xc0, 0x0c,		/* the QNAME */
+		0x00, 0x01, 0x00, 0x01, /* A, IN */
+		0x00, 0x00, 0x01, 0x2c, /* TTL 300 */
+		0x00, 0x04, 192,  0,	2, 1,
+	};
+	server_t *server = arg;
+	isc_region_t r;
+	size_t qlen = 12;
+
+	if (eresult != ISC_R_SUCCESS) {
+		return;
+	}
+
+	atomic_fetch_add(&server->queries, 1);
+	if (!server->answer) {
+		return;
+	}
+
+	while (qlen < region->length && region->base[qlen] != 0) {
+		qlen += region->base[qlen] + 1;
+	}
+	qlen += 1 + 4;
+	assert_true(qlen <= region->length);
+	assert_true(qlen + sizeof(answer) <= sizeof(server->response));
+
+	memmove(server->response, region->base, qlen);
+	server->response[2] |= 0x84; /* QR, AA */
+	server->response[3] = 0x80;  /* RA, NOERROR */
+	memmove(&server->response[6], (unsigned char[]){ 0, 1, 0, 0, 0, 0 },
+		6);
+	memmove(&server->response[qlen], answer, sizeof(answer));
+
+	r.base = server->response;
+	r.length = qlen + sizeof(answer);
+	isc_nm_send(handle, &r, server_senddone, NULL);
+}
+
+static void
+stop_servers(void *arg) {
+	UNUSED(arg);
+
+	for (size_t i = 0; i < ARRAY_SIZE(servers); i++) {
+		if (servers[i].sock != NULL) {
+			isc_nm_stoplistening(servers[i].sock);
+			isc_nmsocket_close(&servers[i].sock);
+		}
+	}
+}
+
+static void
+hedge_setup(unsigned int budget) {
+	struct in_addr localhost = { .s_addr = htonl(INADDR_LOOPBACK) };
+	in_port_t port = 5300 + isc_random8() * 2;
+	isc_sockaddrlist_t forwarders;
+	dns_dispatchmgr_t *dispatchmgr = NULL;
+	dns_adb_t *adb = NULL;
+	isc_sockaddr_t local;
+	dns_fixedname_t fname;
+	isc_result_t result;
+
+	ISC_LIST_INIT(forwarders);
+	for (size_t i = 0; i < ARRAY_SIZE(servers); i++) {
+		server_t *server = &servers[i];
+
+		*server = (server_t){ .answer = (i == 1) };
+		isc_sockaddr_fromin(&server->addr, &localhost, port + i);
+		ISC_LINK_INIT(&server->addr, link);
+		ISC_LIST_APPEND(forwarders, &server->addr, link);
+
+		result = isc_nm_listenudp(netmgr, ISC_NM_LISTEN_ONE,
+					  &server->addr, server_recv, server,
+					  &server->sock);
+		assert_int_equal(result, ISC_R_SUCCESS);
+	}
+	isc_loop_teardown(mainloop, stop_servers, NULL);
+
+	result = dns_test_makeview("view", true, true, &view);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	dispatchmgr = dns_view_getdispatchmgr(view);
+	isc_sockaddr_any(&local);
+	result = dns_dispatch_createudp(dispatchmgr, &local, &dispatch);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_dispatchmgr_detach(&dispatchmgr);
+
+	dns_test_namefromstring("hedge.example", &fname);
+	result = dns_fwdtable_add(view->fwdtable, dns_fixedname_name(&fname),
+				  &forwarders, dns_fwdpolicy_only);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	isc_tlsctx_cache_create(mctx, &tlsctx_cache);
+	result = dns_view_createresolver(view, netmgr, 0, tlsctx_cache,
+					 dispatch, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_view_freeze(view);
+
+	isc_stats_create(mctx, &stats, dns_resstatscounter_max);
+	dns_resolver_setstats(view->resolver, stats);
+	dns_resolver_sethedgebudget(view->resolver, budget);
+
+	dns_view_getadb(view, &adb);
+	for (size_t i = 0; i < ARRAY_SIZE(servers); i++) {
+		dns_adbaddrinfo_t *addr = NULL;
+
+		result = dns_adb_findaddrinfo(adb, &servers[i].addr, &addr, 0);
+		assert_int_equal(result, ISC_R_SUCCESS);
+		dns_adb_adjustsrtt(adb, addr, i == 0 ? 1000 : 500000,
+				   DNS_ADB_RTTADJREPLACE);
+		if (i == 0) {
+			for (size_t j = 0; j < 100; j++) {
+				dns_adb_rttsample(adb, addr, 1000);
+			}
+		}
+		dns_adb_freeaddrinfo(adb, &addr);
+	}
+	dns_adb_detach(&adb);
+}
+
+static void
+hedge_teardown(void) {
+	isc_stats_detach(&stats);
+	dns_view_detach(&view);
+	dns_dispatch_detach(&dispatch);
+	isc_tlsctx_cache_detach(&tlsctx_cache);
+
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+static void
+fetch_start(isc_job_cb cb) {
+	dns_fixedname_t fname;
+	isc_result_t result;
+
+	dns_test_namefromstring("www.hedge.example", &fname);
+	dns_rdataset_init(&rdataset);
+	result = dns_resolver_createfetch(
+		view->resolver, dns_fixedname_name(&fname), dns_rdatatype_a,
+		NULL, NULL, NULL, NULL, 0,
+		DNS_FETCHOPT_NOVALIDATE | DNS_FETCHOPT_NOEDNS0, 0, NULL,
+		mainloop, cb, NULL, &rdataset, NULL, &fetch);
+	assert_int_equal(result, ISC_R_SUCCESS);
+}
+
+static void
+fetch_finish(dns_fetchresponse_t *resp) {
+	assert_int_equal(resp->result, ISC_R_SUCCESS);
+	assert_true(dns_rdataset_isassociated(&rdataset));
+	assert_int_equal(rdataset.type, dns_rdatatype_a);
+
+	if (resp->node != NULL) {
+		dns_db_detachnode(resp->db, &resp->node);
+	}
+	if (resp->db != NULL) {
+		dns_db_detach(&resp->db);
+	}
+	dns_rdataset_disassociate(&rdataset);
+	dns_resolver_destroyfetch(&fetch);
+	isc_mem_putanddetach(&resp->mctx, resp, sizeof(*resp));
+}
+
+static uint64_t
+counter(isc_statscounter_t id) {
+	return (isc_stats_get_counter(stats, id));
+}
+
+static void
+hedged_done(void *arg) {
+	fetch_finish(arg);
+
+	/* the hedged query was answered, the late one never was */
+	assert_int_equal(atomic_load(&servers[0].queries), 1);
+	assert_int_equal(atomic_load(&servers[1].queries), 1);
+	assert_int_equal(counter(dns_resstatscounter_hedged), 1);
+	assert_int_equal(counter(dns_resstatscounter_hedgeanswered), 1);
+	assert_int_equal(counter(dns_resstatscounter_hedgeoverbudget), 0);
+
+	hedge_teardown();
+}
+
+/* a late response makes the resolver ask the other server at once */
+ISC_LOOP_TEST_IMPL(hedge_fires) {
+	UNUSED(arg);
+
+	hedge_setup(100);
+	fetch_start(hedged_done);
+}
+
+static void
+overbudget_done(void *arg) {
+	fetch_finish(arg);
+
+	/*
+	 * The other server was only asked after the first query timed
+	 * out, not when the hedge timer fired.
+	 */
+	assert_int_equal(atomic_load(&servers[0].queries), 1);
+	assert_int_equal(atomic_load(&servers[1].queries), 1);
+	assert_int_equal(counter(dns_resstatscounter_hedged), 0);
+	assert_int_equal(counter(dns_resstatscounter_hedgeanswered), 0);
+	assert_int_equal(counter(dns_resstatscounter_hedgeoverbudget), 1);
+
+	hedge_teardown();
+}
+
+/* the first query only earns 1% of a hedged query */
+ISC_LOOP_TEST_IMPL(hedge_overbudget) {
+	UNUSED(arg);
+
+	hedge_setup(1);
+	fetch_start(overbudget_done);
+}
+
+/* the credits are earned, spent and capped as configured */
+ISC_LOOP_TEST_IMPL(hedge_credits) {
+	dns_resolver_t *res = NULL;
+
+	UNUSED(arg);
+
+	hedge_setup(0);
+	res = view->resolver;
+
+	/* nothing is earned while hedging is disabled */
+	hedge_earn(res);
+	assert_int_equal(atomic_load(&res->hedgecredit), 0);
+	assert_false(hedge_spend(res));
+
+	/* one hedged query for every twenty other queries */
+	dns_resolver_sethedgebudget(res, 5);
+	for (size_t i = 0; i < HEDGE_COST / 5 - 1; i++) {
+		hedge_earn(res);
+	}
+	assert_false(hedge_spend(res));
+	hedge_earn(res);
+	assert_true(hedge_spend(res));
+	assert_false(hedge_spend(res));
+
+	/* no more than a burst of HEDGE_MAXCREDIT is saved up */
+	dns_resolver_sethedgebudget(res, 100);
+	for (size_t i = 0; i < 2 * HEDGE_MAXCREDIT / HEDGE_COST; i++) {
+		hedge_earn(res);
+	}
+	assert_int_equal(atomic_load(&res->hedgecredit), HEDGE_MAXCREDIT);
+	hedge_refund(res);
+	assert_int_equal(atomic_load(&res->hedgecredit), HEDGE_MAXCREDIT);
+	for (size_t i = 0; i < HEDGE_MAXCREDIT / HEDGE_COST; i++) {
+		assert_true(hedge_spend(res));
+	}
+	assert_false(hedge_spend(res));
+
+	hedge_teardown();
+}
+
+ISC_TEST_LIST_START
+ISC_TEST_ENTRY_CUSTOM(hedge_fires, setup_managers, teardown_managers)
+ISC_TEST_ENTRY_CUSTOM(hedge_overbudget, setup_managers, teardown_managers)
+ISC_TEST_ENTRY_CUSTOM(hedge_credits, setup_managers, teardown_managers)
+ISC_TEST_LIST_END
+
+ISC_TEST_MAIN
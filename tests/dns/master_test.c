@@ -25,12 +25,16 @@
 #include <cmocka.h>
 
 #include <isc/dir.h>
+#include <isc/file.h>
+#include <isc/loop.h>
 #include <isc/string.h>
+#include <isc/timer.h>
 #include <isc/util.h>
 
 #include <dns/cache.h>
 #include <dns/callbacks.h>
 #include <dns/db.h>
+#include <dns/fixedname.h>
 #include <dns/master.h>
 #include <dns/masterdump.h>
 #include <dns/name.h>
@@ -515,11 +519,326 @@ ISC_RUN_TEST_IMPL(dumpraw) {
 	assert_true((header.flags & DNS_MASTERRAW_SOURCESERIALSET) != 0);
 	assert_int_equal(header.sourceserial, 12345);
 
+	/* Each raw format version since 1 can be asked for */
+	for (uint32_t rawversion = 1; rawversion <= DNS_RAWFORMAT_MAXVERSION;
+	     rawversion++)
+	{
+		dns_master_initrawheader(&header);
+		header.version = rawversion;
+
+		unlink("test.dump");
+		result = dns_master_dump(mctx, db, version,
+					 &dns_master_style_default, "test.dump",
+					 dns_masterformat_raw, &header);
+		assert_int_equal(result, ISC_R_SUCCESS);
+
+		result = test_master(NULL, "test.dump", dns_masterformat_raw,
+				     nullmsg, nullmsg);
+		assert_string_equal(isc_result_totext(result), "success");
+		assert_true(headerset);
+		assert_int_equal(header.version, rawversion);
+	}
+
+	/* A truncated block is an error */
+	{
+		off_t size;
+
+		result = isc_file_getsize("test.dump", &size);
+		assert_int_equal(result, ISC_R_SUCCESS);
+		result = isc_file_truncate("test.dump", size - 1);
+		assert_int_equal(result, ISC_R_SUCCESS);
+
+		result = test_master(NULL, "test.dump", dns_masterformat_raw,
+				     nullmsg, nullmsg);
+		assert_int_equal(result, ISC_R_UNEXPECTEDEND);
+	}
+
 	unlink("test.dump");
 	dns_db_closeversion(db, &version, false);
 	dns_db_detach(&db);
 }
 
+static dns_db_t *dumpdb = NULL;
+static dns_dumpctx_t *dumpctx = NULL;
+
+static void
+dumpasync_done(void *arg, isc_result_t result) {
+	dns_dumpstats_t stats;
+	off_t size;
+
+	UNUSED(arg);
+
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	/* Synced between the two nodes, written in one go */
+	dns_dumpctx_getstats(dumpctx, &stats);
+	assert_int_equal(stats.quanta, 1);
+	assert_int_equal(stats.syncs, 1);
+
+	result = isc_file_getsize("test.dump", &size);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_int_equal(stats.bytes, size);
+
+	result = test_master(NULL, "test.dump", dns_masterformat_raw, nullmsg,
+			     nullmsg);
+	assert_string_equal(isc_result_totext(result), "success");
+
+	unlink("test.dump");
+	dns_dumpctx_detach(&dumpctx);
+	dns_db_detach(&dumpdb);
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+/*
+ * Asynchronous dump test:
+ * dns_master_dumpasync() with dump options writes the same raw file and
+ * reports what it has written
+ */
+ISC_LOOP_TEST_IMPL(dumpasync) {
+	isc_result_t result;
+	dns_fixedname_t fixed;
+	dns_name_t *name = dns_fixedname_initname(&fixed);
+	dns_dumpopts_t opts = {
+		.maxrate = 1024 * 1024,
+		.syncsize = 1,
+	};
+
+	result = dns_name_fromstring(name, TEST_ORIGIN, dns_rootname, 0, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_db_create(mctx, ZONEDB_DEFAULT, name, dns_dbtype_zone,
+			       dns_rdataclass_in, 0, NULL, &dumpdb);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = isc_dir_chdir(SRCDIR);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_db_load(dumpdb, TESTS_DIR "/testdata/master/master1.data",
+			     dns_masterformat_text, 0);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = isc_dir_chdir(BUILDDIR);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_master_dumpasync(mctx, dumpdb, NULL,
+				      &dns_master_style_default, "test.dump",
+				      mainloop, dumpasync_done, NULL, &dumpctx,
+				      dns_masterformat_raw, NULL, &opts);
+	assert_int_equal(result, ISC_R_SUCCESS);
+}
+
+/*
+ * Load 'dumpdb' with a zone large enough to be dumped in several
+ * quanta when rate-limited.
+ */
+static void
+load_bigdb(void) {
+	isc_result_t result;
+	dns_fixedname_t fixed;
+	dns_name_t *name = dns_fixedname_initname(&fixed);
+	char txt[256];
+	FILE *f = NULL;
+
+	result = dns_name_fromstring(name, TEST_ORIGIN, dns_rootname, 0, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_db_create(mctx, ZONEDB_DEFAULT, name, dns_dbtype_zone,
+			       dns_rdataclass_in, 0, NULL, &dumpdb);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	memset(txt, 'x', sizeof(txt) - 1);
+	txt[sizeof(txt) - 1] = '\0';
+
+	f = fopen("test.big", "w");
+	assert_non_null(f);
+	fprintf(f, "$TTL 1000\n"
+		   "@ SOA ns hostmaster 1 3600 1800 604800 3600\n"
+		   "@ NS ns\n"
+		   "ns A 127.0.0.1\n");
+	for (size_t i = 0; i < 8192; i++) {
+		fprintf(f, "txt%zu TXT \"%s\"\n", i, txt);
+	}
+	assert_int_equal(fclose(f), 0);
+
+	result = dns_db_load(dumpdb, "test.big", dns_masterformat_text, 0);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	unlink("test.big");
+}
+
+static void
+dumpasync_throttled_done(void *arg, isc_result_t result) {
+	dns_dumpstats_t stats;
+	off_t size;
+
+	UNUSED(arg);
+
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	/* The zone is more than twice a quantum's worth of the rate */
+	dns_dumpctx_getstats(dumpctx, &stats);
+	assert_true(stats.quanta >= 3);
+	assert_int_equal(stats.syncs, 0);
+
+	result = isc_file_getsize("test.dump", &size);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_int_equal(stats.bytes, size);
+
+	result = test_master(NULL, "test.dump", dns_masterformat_raw, nullmsg,
+			     nullmsg);
+	assert_string_equal(isc_result_totext(result), "success");
+
+	unlink("test.dump");
+	dns_dumpctx_detach(&dumpctx);
+	dns_db_detach(&dumpdb);
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+/*
+ * Rate-limited asynchronous dump test:
+ * dns_master_dumpasync() with a rate limit writes the file in several
+ * quanta
+ */
+ISC_LOOP_TEST_IMPL(dumpasync_throttled) {
+	isc_result_t result;
+	dns_dumpopts_t opts = {
+		.maxrate = 4 * 1024 * 1024,
+	};
+
+	load_bigdb();
+
+	result = dns_master_dumpasync(mctx, dumpdb, NULL,
+				      &dns_master_style_default, "test.dump",
+				      mainloop, dumpasync_throttled_done, NULL,
+				      &dumpctx, dns_masterformat_raw, NULL,
+				      &opts);
+	assert_int_equal(result, ISC_R_SUCCESS);
+}
+
+static isc_timer_t *canceltimer = NULL;
+
+static void
+dumpasync_cancel_done(void *arg, isc_result_t result) {
+	dns_dumpstats_t stats;
+
+	UNUSED(arg);
+
+	assert_int_equal(result, ISC_R_CANCELED);
+
+	/* The dump stopped waiting for its second quantum */
+	dns_dumpctx_getstats(dumpctx, &stats);
+	assert_true(stats.quanta <= 2);
+	assert_false(isc_file_exists("test.dump"));
+
+	isc_timer_destroy(&canceltimer);
+	dns_dumpctx_detach(&dumpctx);
+	dns_db_detach(&dumpdb);
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+static void
+dumpasync_cancel_cb(void *arg) {
+	UNUSED(arg);
+
+	dns_dumpctx_cancel(dumpctx);
+}
+
+/*
+ * Canceled asynchronous dump test:
+ * dns_dumpctx_cancel() ends a rate-limited dump waiting for its next
+ * quantum right away, and removes the partial file
+ */
+ISC_LOOP_TEST_IMPL(dumpasync_cancel) {
+	isc_result_t result;
+	isc_interval_t interval;
+	dns_dumpopts_t opts = {
+		/* The first quantum is due again in days */
+		.maxrate = 1,
+	};
+
+	load_bigdb();
+
+	result = dns_master_dumpasync(mctx, dumpdb, NULL,
+				      &dns_master_style_default, "test.dump",
+				      mainloop, dumpasync_cancel_done, NULL,
+				      &dumpctx, dns_masterformat_raw, NULL,
+				      &opts);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	isc_timer_create(mainloop, dumpasync_cancel_cb, NULL, &canceltimer);
+	isc_interval_set(&interval, 0, 100 * NS_PER_MS);
+	isc_timer_start(canceltimer, isc_timertype_once, &interval);
+}
+
+static dns_loadctx_t *loadctx = NULL;
+static dns_fixedname_t lastfixed;
+static size_t loaded;
+
+static isc_result_t
+add_ordered(void *arg, const dns_name_t *owner,
+	    dns_rdataset_t *dataset DNS__DB_FLARG) {
+	dns_name_t *last = dns_fixedname_name(&lastfixed);
+
+	UNUSED(arg);
+	UNUSED(dataset);
+
+	assert_true(dns_name_compare(last, owner) <= 0);
+	dns_name_copy(owner, last);
+	loaded++;
+
+	return (ISC_R_SUCCESS);
+}
+
+static void
+loadraw_parallel_done(void *arg, isc_result_t result) {
+	UNUSED(arg);
+
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	/* The SOA, NS and A RRsets and the TXT ones */
+	assert_int_equal(loaded, 3 + 8192);
+	assert_true(headerset);
+	assert_int_equal(header.version, 2);
+
+	unlink("test.dump");
+	dns_loadctx_detach(&loadctx);
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+/*
+ * Parallel raw load test:
+ * the blocks of a large version 2 raw file, decoded in parallel, are
+ * all added to the database in the order they were dumped in
+ */
+ISC_LOOP_TEST_IMPL(loadraw_parallel) {
+	isc_result_t result;
+	dns_dbversion_t *version = NULL;
+	dns_masterrawheader_t rawheader;
+
+	load_bigdb();
+
+	dns_master_initrawheader(&rawheader);
+	rawheader.version = 2;
+	dns_db_currentversion(dumpdb, &version);
+	result = dns_master_dump(mctx, dumpdb, version,
+				 &dns_master_style_default, "test.dump",
+				 dns_masterformat_raw, &rawheader);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_db_closeversion(dumpdb, &version, false);
+	dns_db_detach(&dumpdb);
+
+	result = setup_master(nullmsg, nullmsg);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	callbacks.add = add_ordered;
+	dns_name_copy(dns_rootname, dns_fixedname_initname(&lastfixed));
+	loaded = 0;
+
+	result = dns_master_loadfileasync(
+		"test.dump", &dns_origin, &dns_origin, dns_rdataclass_in, 0, 0,
+		&callbacks, mainloop, loadraw_parallel_done, NULL, &loadctx,
+		NULL, NULL, mctx, dns_masterformat_raw, 0);
+	assert_int_equal(result, ISC_R_SUCCESS);
+}
+
 static const char *warn_expect_value;
 static bool warn_expect_result;
 
@@ -574,6 +893,10 @@ ISC_TEST_ENTRY(leadingzero)
 ISC_TEST_ENTRY(totext)
 ISC_TEST_ENTRY(loadraw)
 ISC_TEST_ENTRY(dumpraw)
+ISC_TEST_ENTRY_CUSTOM(dumpasync, setup_loopmgr, teardown_loopmgr)
+ISC_TEST_ENTRY_CUSTOM(dumpasync_throttled, setup_loopmgr, teardown_loopmgr)
+ISC_TEST_ENTRY_CUSTOM(dumpasync_cancel, setup_loopmgr, teardown_loopmgr)
+ISC_TEST_ENTRY_CUSTOM(loadraw_parallel, setup_loopmgr, teardown_loopmgr)
 ISC_TEST_ENTRY(toobig)
 ISC_TEST_ENTRY(maxrdata)
 ISC_TEST_ENTRY(neworigin)
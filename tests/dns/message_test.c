@@ -0,0 +1,220 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <inttypes.h>
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/buffer.h>
+#include <isc/mem.h>
+#include <isc/util.h>
+
+#include <dns/message.h>
+
+#include <tests/dns.h>
+
+/* A query with the RD bit, 'qd' questions and 'ar' additional records */
+#define HEADER(qd, ar) \
+	0x12, 0x34, 0x01, 0x00, 0x00, qd, 0x00, 0x00, 0x00, 0x00, 0x00, ar
+
+#define QUESTION(name, type) name, 0x00, type, 0x00, 0x01
+
+#define WWW                                                               \
+	0x03, 'w', 'w', 'w', 0x07, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 0x03, \
+		'c', 'o', 'm', 0x00
+
+#define COM 0x03, 'c', 'o', 'm', 0x00
+
+/* A compression pointer to itself */
+#define LOOP 0xc0, 0x0c
+
+/* OPT with a 4096 byte UDP size, the DO bit, and 'len' bytes of options */
+#define OPT(ercode, len) \
+	0x00, 0x00, 0x29, 0x10, 0x00, ercode, 0x00, 0x80, 0x00, 0x00, len
+
+#define COOKIE 0x00, 0x0a, 0x00, 0x08, 1, 2, 3, 4, 5, 6, 7, 8
+
+/* An A record without its address */
+#define BADA 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+
+/*
+ * These are parsed by the fast path...
+ */
+static const unsigned char plain[] = { HEADER(1, 0), QUESTION(WWW, 1) };
+
+static const unsigned char edns[] = { HEADER(1, 1), QUESTION(WWW, 28),
+				      OPT(0, 0) };
+
+static const unsigned char cookie[] = { HEADER(1, 1), QUESTION(WWW, 1),
+					OPT(0, 12), COOKIE };
+
+/* the extended rcode bits of the OPT TTL end up in the message rcode */
+static const unsigned char ercode[] = { HEADER(1, 1), QUESTION(WWW, 1),
+					OPT(1, 0) };
+
+/*
+ * ...and these are left to the general parser, successfully or not.
+ */
+static const unsigned char twoquestions[] = { HEADER(2, 0), QUESTION(WWW, 1),
+					      QUESTION(COM, 1) };
+
+static const unsigned char badoption[] = { HEADER(1, 1), QUESTION(WWW, 1),
+					   OPT(0, 4), 0x00, 0x0a, 0x00, 0x08 };
+
+static const unsigned char notopt[] = { HEADER(1, 1), QUESTION(WWW, 1),
+					BADA };
+
+static const unsigned char garbage[] = { HEADER(1, 0), QUESTION(WWW, 1),
+					 0xff };
+
+static const unsigned char pointer[] = { HEADER(1, 0), QUESTION(LOOP, 1) };
+
+static const unsigned char truncated[] = { HEADER(1, 1), QUESTION(WWW, 1),
+					   0x00, 0x00, 0x29 };
+
+static const struct {
+	const unsigned char *wire;
+	size_t size;
+	bool fast;
+} queries[] = {
+	{ plain, sizeof(plain), true },
+	{ edns, sizeof(edns), true },
+	{ cookie, sizeof(cookie), true },
+	{ ercode, sizeof(ercode), true },
+	{ twoquestions, sizeof(twoquestions), false },
+	{ badoption, sizeof(badoption), false },
+	{ notopt, sizeof(notopt), false },
+	{ garbage, sizeof(garbage), false },
+	{ pointer, sizeof(pointer), false },
+	{ truncated, sizeof(truncated), false },
+};
+
+static isc_result_t
+parse(dns_message_t *msg, const unsigned char *wire, size_t size,
+      unsigned int options, char *text, size_t textsize) {
+	isc_buffer_t source, target;
+	isc_result_t result;
+
+	isc_buffer_constinit(&source, wire, size);
+	isc_buffer_add(&source, size);
+	result = dns_message_parse(msg, &source, options);
+
+	isc_buffer_init(&target, text, textsize - 1);
+	if (result == ISC_R_SUCCESS) {
+		assert_int_equal(dns_message_totext(msg,
+						    &dns_master_style_debug, 0,
+						    &target),
+				 ISC_R_SUCCESS);
+	}
+	text[isc_buffer_usedlength(&target)] = '\0';
+
+	return (result);
+}
+
+/* the fast path parses the simple queries the same as the general one */
+ISC_RUN_TEST_IMPL(fastquery) {
+	for (size_t i = 0; i < ARRAY_SIZE(queries); i++) {
+		dns_message_t *general = NULL, *fast = NULL;
+		char generaltext[4096], fasttext[4096];
+		isc_result_t generalresult, fastresult;
+
+		dns_message_create(mctx, NULL, NULL, DNS_MESSAGE_INTENTPARSE,
+				   &general);
+		dns_message_create(mctx, NULL, NULL, DNS_MESSAGE_INTENTPARSE,
+				   &fast);
+
+		generalresult = parse(general, queries[i].wire,
+				      queries[i].size, 0, generaltext,
+				      sizeof(generaltext));
+		fastresult = parse(fast, queries[i].wire, queries[i].size,
+				   DNS_MESSAGEPARSE_FASTQUERY, fasttext,
+				   sizeof(fasttext));
+
+		assert_int_equal(fastresult, generalresult);
+		assert_string_equal(fasttext, generaltext);
+
+		/* Nothing came from the pools when the fast path was taken */
+		if (queries[i].fast) {
+			assert_int_equal(fastresult, ISC_R_SUCCESS);
+			assert_int_equal(
+				isc_mempool_getallocated(fast->namepool), 0);
+			assert_int_equal(
+				isc_mempool_getallocated(fast->rdspool), 0);
+		} else if (fastresult == ISC_R_SUCCESS) {
+			assert_true(
+				isc_mempool_getallocated(fast->namepool) > 0);
+		}
+
+		dns_message_detach(&general);
+		dns_message_detach(&fast);
+	}
+}
+
+/* a message parsed by the fast path can be answered and reused */
+ISC_RUN_TEST_IMPL(fastquery_reuse) {
+	dns_message_t *msg = NULL;
+	size_t inuse = 0;
+
+	dns_message_create(mctx, NULL, NULL, DNS_MESSAGE_INTENTPARSE, &msg);
+
+	for (size_t i = 0; i < 100; i++) {
+		const unsigned char *wire = queries[i % 4].wire;
+		size_t size = queries[i % 4].size;
+		isc_buffer_t source;
+		isc_result_t result;
+
+		isc_buffer_constinit(&source, wire, size);
+		isc_buffer_add(&source, size);
+		result = dns_message_parse(msg, &source,
+					   DNS_MESSAGEPARSE_FASTQUERY);
+		assert_int_equal(result, ISC_R_SUCCESS);
+		assert_int_equal(msg->counts[DNS_SECTION_QUESTION], 1);
+		assert_int_equal(dns_message_firstname(msg,
+						       DNS_SECTION_QUESTION),
+				 ISC_R_SUCCESS);
+
+		/* The question survives the reply, the OPT does not */
+		result = dns_message_reply(msg, true);
+		assert_int_equal(result, ISC_R_SUCCESS);
+		assert_null(dns_message_getopt(msg));
+		assert_int_equal(dns_message_firstname(msg,
+						       DNS_SECTION_QUESTION),
+				 ISC_R_SUCCESS);
+
+		dns_message_reset(msg, DNS_MESSAGE_INTENTPARSE);
+
+		/* After the first query, nothing more is allocated */
+		if (i == 0) {
+			inuse = isc_mem_inuse(mctx);
+		} else {
+			assert_int_equal(isc_mem_inuse(mctx), inuse);
+		}
+	}
+
+	dns_message_detach(&msg);
+}
+
+ISC_TEST_LIST_START
+ISC_TEST_ENTRY(fastquery)
+ISC_TEST_ENTRY(fastquery_reuse)
+ISC_TEST_LIST_END
+
+ISC_TEST_MAIN
@@ -452,6 +452,145 @@ ISC_RUN_TEST_IMPL(collision) {
 	dns_compress_invalidate(&cctx);
 }
 
+/*
+ * an entry which slides into the slot of a deleted one during a
+ * rollback is deleted too if it is past the rollback point
+ */
+ISC_RUN_TEST_IMPL(rollback_slide) {
+	dns_compress_t cctx;
+	unsigned int last;
+
+	dns_compress_init(&cctx, mctx, 0);
+	last = cctx.mask;
+
+	/*
+	 * Two entries with the same hash, the second one past its home
+	 * slot, and one with the next hash which is kept.
+	 */
+	cctx.set[3] = (dns_compress_slot_t){ .hash = 3, .coff = 100 };
+	cctx.set[4] = (dns_compress_slot_t){ .hash = 3, .coff = 200 };
+	cctx.set[5] = (dns_compress_slot_t){ .hash = 4, .coff = 50 };
+
+	/* and the same in the last slot, wrapping around to the first */
+	cctx.set[last] = (dns_compress_slot_t){ .hash = last, .coff = 40 };
+	cctx.set[0] = (dns_compress_slot_t){ .hash = last, .coff = 120 };
+	cctx.set[1] = (dns_compress_slot_t){ .hash = last, .coff = 300 };
+	cctx.count = 6;
+
+	dns_compress_rollback(&cctx, 100);
+
+	assert_int_equal(cctx.count, 2);
+	for (unsigned int slot = 0; slot <= cctx.mask; slot++) {
+		if (slot == 4) {
+			assert_int_equal(cctx.set[slot].hash, 4);
+			assert_int_equal(cctx.set[slot].coff, 50);
+		} else if (slot == last) {
+			assert_int_equal(cctx.set[slot].hash, last);
+			assert_int_equal(cctx.set[slot].coff, 40);
+		} else {
+			assert_int_equal(cctx.set[slot].coff, 0);
+		}
+	}
+
+	dns_compress_invalidate(&cctx);
+}
+
+static const char *apexnames[] = { "h%u.example.com.", "h%u.sub.example.com.",
+				   "h%u.Example.COM.", "example.com.",
+				   "h%u.example.net." };
+
+static unsigned int
+apex_towire(unsigned int count, dns_compress_flags_t flags,
+	    const dns_compress_apex_t *apex, uint8_t *wire, size_t size,
+	    uint16_t *maskp) {
+	isc_result_t result;
+	dns_compress_t cctx;
+	isc_buffer_t message;
+	unsigned int length;
+
+	isc_buffer_init(&message, wire, size);
+	isc_buffer_putuint16(&message, 0xEAD);
+
+	dns_compress_init(&cctx, mctx, flags);
+	if (apex != NULL) {
+		dns_compress_setapex(&cctx, apex);
+	}
+
+	for (unsigned int i = 0; i < count; i++) {
+		dns_fixedname_t fixed;
+		char namebuf[DNS_NAME_FORMATSIZE];
+
+		snprintf(namebuf, sizeof(namebuf),
+			 apexnames[i % ARRAY_SIZE(apexnames)], i / 2);
+		dns_test_namefromstring(namebuf, &fixed);
+		result = dns_name_towire(dns_fixedname_name(&fixed), &cctx,
+					 &message, NULL);
+		assert_int_equal(result, ISC_R_SUCCESS);
+	}
+
+	*maskp = cctx.mask;
+	length = isc_buffer_usedlength(&message);
+	dns_compress_invalidate(&cctx);
+
+	/* the names can be read back */
+	isc_buffer_setactive(&message, length);
+	isc_buffer_forward(&message, 2);
+	for (unsigned int i = 0; i < count; i++) {
+		dns_fixedname_t fixed, expected;
+		char namebuf[DNS_NAME_FORMATSIZE];
+
+		snprintf(namebuf, sizeof(namebuf),
+			 apexnames[i % ARRAY_SIZE(apexnames)], i / 2);
+		dns_test_namefromstring(namebuf, &expected);
+		result = dns_name_fromwire(dns_fixedname_initname(&fixed),
+					   &message, DNS_DECOMPRESS_ALWAYS,
+					   NULL);
+		assert_int_equal(result, ISC_R_SUCCESS);
+		assert_true(dns_name_caseequal(dns_fixedname_name(&fixed),
+					       dns_fixedname_name(&expected)));
+	}
+
+	return (length);
+}
+
+/*
+ * the apex template and the tiny hash set make no difference to the
+ * compressed names
+ */
+ISC_RUN_TEST_IMPL(compression_apex) {
+	dns_compress_flags_t flags[] = { 0, DNS_COMPRESS_CASE };
+	dns_fixedname_t fixed;
+	dns_compress_apex_t apex;
+	uint8_t plain[4096], wire[4096];
+	unsigned int plainlen, wirelen;
+	uint16_t plainmask, wiremask;
+
+	dns_test_namefromstring("example.com.", &fixed);
+	dns_compress_apexinit(&apex, dns_fixedname_name(&fixed));
+
+	for (size_t i = 0; i < ARRAY_SIZE(flags); i++) {
+		/* A few names fit in the tiny hash set */
+		plainlen = apex_towire(5, flags[i], NULL, plain, sizeof(plain),
+				       &plainmask);
+		wirelen = apex_towire(5, flags[i], &apex, wire, sizeof(wire),
+				      &wiremask);
+		assert_int_equal(plainmask, (1 << DNS_COMPRESS_TINYBITS) - 1);
+		assert_int_equal(wiremask, (1 << DNS_COMPRESS_TINYBITS) - 1);
+		assert_int_equal(wirelen, plainlen);
+		assert_memory_equal(wire, plain, plainlen);
+
+		/* More of them need the whole of the small hash set */
+		plainlen = apex_towire(60, flags[i], NULL, plain,
+				       sizeof(plain), &plainmask);
+		wirelen = apex_towire(60, flags[i], &apex, wire, sizeof(wire),
+				      &wiremask);
+		assert_int_equal(plainmask, (1 << DNS_COMPRESS_SMALLBITS) - 1);
+		assert_int_equal(wiremask, (1 << DNS_COMPRESS_SMALLBITS) - 1);
+		assert_int_equal(wirelen, plainlen);
+		assert_memory_equal(wire, plain, plainlen);
+	}
+}
+
 ISC_RUN_TEST_IMPL(fromregion) {
 	dns_name_t name;
 	isc_buffer_t b;
@@ -1006,6 +1145,8 @@ ISC_TEST_LIST_START
 ISC_TEST_ENTRY(fullcompare)
 ISC_TEST_ENTRY(compression)
 ISC_TEST_ENTRY(collision)
+ISC_TEST_ENTRY(rollback_slide)
+ISC_TEST_ENTRY(compression_apex)
 ISC_TEST_ENTRY(fromregion)
 ISC_TEST_ENTRY(istat)
 ISC_TEST_ENTRY(init)
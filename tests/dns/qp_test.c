@@ -425,6 +425,91 @@ check_partialmatch(dns_qp_t *qp, struct check_partialmatch check[]) {
 	}
 }
 
+ISC_RUN_TEST_IMPL(qpbuild) {
+	uint32_t item[ITER_ITEMS] = { 0 };
+
+	for (size_t tests = 0; tests < 100; tests++) {
+		dns_qp_t *qp = NULL, *qpb_qp = NULL;
+		dns_qpbuild_t *qpb = NULL;
+		dns_qpiter_t qpi, qpbi;
+		dns_qp_memusage_t usage, qpb_usage;
+		dns_qpkey_t key;
+		size_t keylen;
+		uint32_t ival, qpb_ival, last = 0;
+		isc_result_t result;
+
+		dns_qp_create(mctx, &qpiter_methods, item, &qp);
+		dns_qp_create(mctx, &qpiter_methods, item, &qpb_qp);
+
+		/* sometimes the trie already has a first leaf */
+		ival = 1 + isc_random_uniform(3);
+		if (isc_random_uniform(2) == 0) {
+			item[ival] = ival;
+			result = dns_qp_insert(qp, &item[ival], ival);
+			assert_int_equal(result, ISC_R_SUCCESS);
+			result = dns_qp_insert(qpb_qp, &item[ival], ival);
+			assert_int_equal(result, ISC_R_SUCCESS);
+			last = ival;
+		}
+
+		dns_qpbuild_begin(qpb_qp, &qpb);
+		for (ival = last + 1; ival < ITER_ITEMS; ival++) {
+			if (isc_random_uniform(3) == 0) {
+				continue;
+			}
+			item[ival] = ival;
+			result = dns_qp_insert(qp, &item[ival], ival);
+			assert_int_equal(result, ISC_R_SUCCESS);
+			result = dns_qpbuild_add(qpb, &item[ival], ival);
+			assert_int_equal(result, ISC_R_SUCCESS);
+			last = ival;
+		}
+		if (last > 1) {
+			result = dns_qpbuild_add(qpb, &item[last], last);
+			assert_int_equal(result, ISC_R_EXISTS);
+			item[1] = 1;
+			result = dns_qpbuild_add(qpb, &item[1], 1);
+			assert_int_equal(result, ISC_R_RANGE);
+		}
+		dns_qpbuild_finish(&qpb);
+		assert_null(qpb);
+
+		/* both tries have the same leaves */
+		dns_qpiter_init(qp, &qpi);
+		dns_qpiter_init(qpb_qp, &qpbi);
+		while (dns_qpiter_next(&qpi, NULL, NULL, &ival) ==
+		       ISC_R_SUCCESS)
+		{
+			result = dns_qpiter_next(&qpbi, NULL, NULL, &qpb_ival);
+			assert_int_equal(result, ISC_R_SUCCESS);
+			assert_int_equal(ival, qpb_ival);
+		}
+		result = dns_qpiter_next(&qpbi, NULL, NULL, &qpb_ival);
+		assert_int_equal(result, ISC_R_NOMORE);
+
+		/* and the same shape, without any garbage in the built one */
+		dns_qp_compact(qp, DNS_QPGC_ALL);
+		usage = dns_qp_memusage(qp);
+		qpb_usage = dns_qp_memusage(qpb_qp);
+		assert_int_equal(usage.leaves, qpb_usage.leaves);
+		assert_int_equal(usage.live, qpb_usage.live);
+		assert_true(qpb_usage.free <= 1);
+
+		/* the built trie can be modified as usual */
+		item[1] = 1;
+		result = dns_qp_insert(qpb_qp, &item[1], 1);
+		assert_true(result == ISC_R_SUCCESS || result == ISC_R_EXISTS);
+		keylen = qpiter_makekey(key, item, &item[1], 1);
+		result = dns_qp_getkey(qpb_qp, key, keylen, NULL, &ival);
+		assert_int_equal(result, ISC_R_SUCCESS);
+		assert_int_equal(ival, 1);
+
+		dns_qp_destroy(&qp);
+		dns_qp_destroy(&qpb_qp);
+		memset(item, 0, sizeof(item));
+	}
+}
+
 static void
 insert_str(dns_qp_t *qp, const char *str) {
 	isc_result_t result;
@@ -931,6 +1016,7 @@ ISC_TEST_LIST_START
 ISC_TEST_ENTRY(qpkey_name)
 ISC_TEST_ENTRY(qpkey_sort)
 ISC_TEST_ENTRY(qpiter)
+ISC_TEST_ENTRY(qpbuild)
 ISC_TEST_ENTRY(partialmatch)
 ISC_TEST_ENTRY(qpchain)
 ISC_TEST_ENTRY(predecessors)
@@ -25,6 +25,7 @@
 
 #include <isc/util.h>
 
+#include <dns/ncache.h>
 #include <dns/rbt.h>
 #include <dns/rdatalist.h>
 #include <dns/rdataset.h>
@@ -211,9 +212,306 @@ ISC_LOOP_TEST_IMPL(overmempurge_longname) {
 	isc_loopmgr_shutdown(loopmgr);
 }
 
+/*
+ * Add to a cache DB 'db' a negative entry for type A at <idx>.example.com,
+ * made of an SOA record which is the same for all the names and of an
+ * NSEC record of its own.  Returns the number of bytes of the records.
+ */
+static size_t
+ncache_addrdataset(dns_db_t *db, isc_stdtime_t now, int idx) {
+	static const unsigned char soa[] = {
+		/* owner, type SOA, trust, count, length */
+		7, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 3, 'c', 'o', 'm', 0, 0, 6,
+		dns_trust_authauthority, 0, 1, 0, 26,
+		/* mname, rname, serial, refresh, retry, expire, minimum */
+		1, 'a', 0, 1, 'b', 0, 0, 0, 0, 1, 0, 0, 0, 2, 0, 0, 0, 3, 0, 0,
+		0, 4, 0, 0, 0, 5
+	};
+	unsigned char own[64];
+	unsigned int n;
+	isc_result_t result;
+	dns_rdata_t rdata1 = DNS_RDATA_INIT, rdata2 = DNS_RDATA_INIT;
+	dns_dbnode_t *node = NULL;
+	dns_rdatalist_t rdatalist;
+	dns_rdataset_t rdataset;
+	dns_fixedname_t fname;
+	char namebuf[DNS_NAME_FORMATSIZE];
+
+	snprintf(namebuf, sizeof(namebuf), "%d.example.com.", idx);
+	dns_test_namefromstring(namebuf, &fname);
+
+	/*
+	 * An NSEC record owned by the name itself, which points back at
+	 * it and has no type bitmap.
+	 */
+	memset(own, 0, sizeof(own));
+	snprintf((char *)own + 1, sizeof(own) - 1, "%d", idx);
+	own[0] = strlen((char *)own + 1);
+	memmove(own + own[0] + 1, soa, 13);
+	n = own[0] + 14;
+	own[n + 1] = 47; /* type NSEC */
+	own[n + 4] = 1;	 /* count */
+	own[n + 6] = n;	 /* length */
+	memmove(own + n + 7, own, n);
+
+	result = dns_db_findnode(db, dns_fixedname_name(&fname), true, &node);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	rdata1.data = (unsigned char *)soa;
+	rdata1.length = sizeof(soa);
+	rdata1.rdclass = dns_rdataclass_in;
+	rdata2.data = own;
+	rdata2.length = 2 * n + 7;
+	rdata2.rdclass = dns_rdataclass_in;
+
+	dns_rdatalist_init(&rdatalist);
+	rdatalist.rdclass = dns_rdataclass_in;
+	rdatalist.type = 0;
+	rdatalist.covers = dns_rdatatype_a;
+	rdatalist.ttl = 3600;
+	ISC_LIST_APPEND(rdatalist.rdata, &rdata1, link);
+	ISC_LIST_APPEND(rdatalist.rdata, &rdata2, link);
+
+	dns_rdataset_init(&rdataset);
+	dns_rdatalist_tordataset(&rdatalist, &rdataset);
+	rdataset.attributes |= DNS_RDATASETATTR_NEGATIVE;
+	rdataset.trust = dns_trust_authauthority;
+
+	result = dns_db_addrdataset(db, node, NULL, now, &rdataset, 0, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	/* The records read back are the ones that were added */
+	dns_rdataset_disassociate(&rdataset);
+	result = dns_db_findrdataset(db, node, NULL, dns_rdatatype_a, 0, now,
+				     &rdataset, NULL);
+	assert_int_equal(result, DNS_R_NCACHENXRRSET);
+	assert_int_equal(dns_rdataset_count(&rdataset), 2);
+	for (result = dns_rdataset_first(&rdataset); result == ISC_R_SUCCESS;
+	     result = dns_rdataset_next(&rdataset))
+	{
+		dns_rdata_t rdata = DNS_RDATA_INIT;
+		dns_rdataset_t records;
+		dns_name_t found;
+		const unsigned char *expected = NULL;
+
+		dns_name_init(&found, NULL);
+		dns_rdataset_init(&records);
+		dns_ncache_current(&rdataset, &found, &records);
+		if (records.type == dns_rdatatype_soa) {
+			assert_int_equal(records.trust,
+					 dns_trust_authauthority);
+			expected = soa + 18;
+		} else {
+			assert_int_equal(records.type, dns_rdatatype_nsec);
+			assert_int_equal(records.trust, dns_trust_none);
+			assert_true(dns_name_equal(&found,
+						   dns_fixedname_name(&fname)));
+			expected = own + n + 5;
+		}
+
+		assert_int_equal(dns_rdataset_count(&records), 1);
+		result = dns_rdataset_first(&records);
+		assert_int_equal(result, ISC_R_SUCCESS);
+		dns_rdataset_current(&records, &rdata);
+		assert_int_equal(rdata.length, expected[0] * 256 + expected[1]);
+		assert_memory_equal(rdata.data, expected + 2, rdata.length);
+		dns_rdataset_disassociate(&records);
+	}
+	dns_rdataset_disassociate(&rdataset);
+
+	dns_db_detachnode(db, &node);
+
+	return (rdata1.length + rdata2.length);
+}
+
+/* the negative entries share the records they have in common */
+ISC_LOOP_TEST_IMPL(ncache_shared) {
+	isc_result_t result;
+	dns_db_t *db = NULL;
+	isc_mem_t *mctx2 = NULL;
+	isc_stdtime_t now = isc_stdtime_now();
+	uint64_t positive, negative, proofs;
+	size_t records = 0;
+
+	isc_mem_create(&mctx2);
+
+	result = dns_db_create(mctx2, CACHEDB_DEFAULT, dns_rootname,
+			       dns_dbtype_cache, dns_rdataclass_in, 0, NULL,
+			       &db);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	for (int i = 0; i < 1000; i++) {
+		records += ncache_addrdataset(db, now, i);
+	}
+
+	result = dns_db_getcachemem(db, &positive, &negative, &proofs);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	if (verbose) {
+		print_message("# positive: %" PRIu64 " negative: %" PRIu64
+			      " proofs: %" PRIu64 " records: %zu\n",
+			      positive, negative, proofs, records);
+	}
+	assert_int_equal(positive, 0);
+	assert_true(negative < 1000 * sizeof(dns_slabheader_t) + records);
+	assert_true(proofs > 0);
+	assert_true(proofs < records);
+
+	/* All the memory is given back when the entries go away */
+	dns_db_detach(&db);
+	isc_mem_destroy(&mctx2);
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+/* the negative entries are kept within their budget */
+ISC_LOOP_TEST_IMPL(ncache_budget) {
+	size_t budget = 64 * 1024;
+	isc_result_t result;
+	dns_db_t *db = NULL;
+	isc_mem_t *mctx2 = NULL;
+	isc_stdtime_t now = isc_stdtime_now();
+	uint64_t negative, proofs;
+
+	isc_mem_create(&mctx2);
+
+	result = dns_db_create(mctx2, CACHEDB_DEFAULT, dns_rootname,
+			       dns_dbtype_cache, dns_rdataclass_in, 0, NULL,
+			       &db);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_db_setmaxncachesize(db, budget);
+
+	/* The positive entries are left alone */
+	for (int i = 0; i < 100; i++) {
+		overmempurge_addrdataset(db, now, 100000 + i, 50053, 100,
+					 false);
+	}
+
+	for (int i = 0; i < 10000; i++) {
+		ncache_addrdataset(db, now, i);
+
+		/* The shared records are counted against the budget too */
+		result = dns_db_getcachemem(db, NULL, &negative, &proofs);
+		assert_int_equal(result, ISC_R_SUCCESS);
+		assert_true(negative + proofs <= budget + 1024);
+	}
+
+	for (int i = 0; i < 100; i++) {
+		dns_fixedname_t fname;
+		dns_dbnode_t *node = NULL;
+		dns_rdataset_t rdataset;
+		char namebuf[DNS_NAME_FORMATSIZE];
+
+		snprintf(namebuf, sizeof(namebuf), "%d.example.com.",
+			 100000 + i);
+		dns_test_namefromstring(namebuf, &fname);
+		result = dns_db_findnode(db, dns_fixedname_name(&fname), false,
+					 &node);
+		assert_int_equal(result, ISC_R_SUCCESS);
+
+		dns_rdataset_init(&rdataset);
+		result = dns_db_findrdataset(db, node, NULL, 50053, 0, now,
+					     &rdataset, NULL);
+		assert_int_equal(result, ISC_R_SUCCESS);
+		dns_rdataset_disassociate(&rdataset);
+		dns_db_detachnode(db, &node);
+	}
+
+	dns_db_detach(&db);
+	isc_mem_destroy(&mctx2);
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+/*
+ * The trust of the records of a negative entry, which is raised once
+ * they are validated, is the entry's own and not that of the records
+ * it shares with the others.
+ */
+static dns_trust_t
+ncache_gettrust(dns_db_t *db, isc_stdtime_t now, int idx, bool secure) {
+	isc_result_t result;
+	dns_dbnode_t *node = NULL;
+	dns_rdataset_t rdataset, soaset;
+	dns_fixedname_t fname;
+	char namebuf[DNS_NAME_FORMATSIZE];
+	dns_trust_t trust;
+
+	snprintf(namebuf, sizeof(namebuf), "%d.example.com.", idx);
+	dns_test_namefromstring(namebuf, &fname);
+	result = dns_db_findnode(db, dns_fixedname_name(&fname), false, &node);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	dns_rdataset_init(&rdataset);
+	result = dns_db_findrdataset(db, node, NULL, dns_rdatatype_a, 0, now,
+				     &rdataset, NULL);
+	assert_int_equal(result, DNS_R_NCACHENXRRSET);
+
+	dns_test_namefromstring("example.com.", &fname);
+	dns_rdataset_init(&soaset);
+	result = dns_ncache_getrdataset(&rdataset, dns_fixedname_name(&fname),
+					dns_rdatatype_soa, &soaset);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	if (secure) {
+		dns_rdataset_settrust(&soaset, dns_trust_secure);
+	}
+	trust = soaset.trust;
+
+	dns_rdataset_disassociate(&soaset);
+	dns_rdataset_disassociate(&rdataset);
+	dns_db_detachnode(db, &node);
+
+	return (trust);
+}
+
+/* the trust set on a negative entry is not seen by the others */
+ISC_LOOP_TEST_IMPL(ncache_trust) {
+	isc_result_t result;
+	dns_db_t *db = NULL;
+	isc_mem_t *mctx2 = NULL;
+	isc_stdtime_t now = isc_stdtime_now();
+	uint64_t before, after, step;
+
+	isc_mem_create(&mctx2);
+
+	result = dns_db_create(mctx2, CACHEDB_DEFAULT, dns_rootname,
+			       dns_dbtype_cache, dns_rdataclass_in, 0, NULL,
+			       &db);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	/* An entry like the others only adds its own record to the pool */
+	ncache_addrdataset(db, now, 0);
+	ncache_addrdataset(db, now, 1);
+	result = dns_db_getcachemem(db, NULL, NULL, &before);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	ncache_addrdataset(db, now, 2);
+	result = dns_db_getcachemem(db, NULL, NULL, &after);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	step = after - before;
+
+	assert_int_equal(ncache_gettrust(db, now, 1, true), dns_trust_secure);
+	assert_int_equal(ncache_gettrust(db, now, 1, false), dns_trust_secure);
+	assert_int_equal(ncache_gettrust(db, now, 0, false),
+			 dns_trust_authauthority);
+	assert_int_equal(ncache_gettrust(db, now, 2, false),
+			 dns_trust_authauthority);
+
+	/* and the shared records are still found in the pool afterwards */
+	ncache_addrdataset(db, now, 3);
+	result = dns_db_getcachemem(db, NULL, NULL, &before);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_int_equal(before - after, step);
+	assert_int_equal(ncache_gettrust(db, now, 3, false),
+			 dns_trust_authauthority);
+
+	dns_db_detach(&db);
+	isc_mem_destroy(&mctx2);
+	isc_loopmgr_shutdown(loopmgr);
+}
+
 ISC_TEST_LIST_START
 ISC_TEST_ENTRY_CUSTOM(overmempurge_bigrdata, setup_managers, teardown_managers)
 ISC_TEST_ENTRY_CUSTOM(overmempurge_longname, setup_managers, teardown_managers)
+ISC_TEST_ENTRY_CUSTOM(ncache_shared, setup_managers, teardown_managers)
+ISC_TEST_ENTRY_CUSTOM(ncache_budget, setup_managers, teardown_managers)
+ISC_TEST_ENTRY_CUSTOM(ncache_trust, setup_managers, teardown_managers)
 ISC_TEST_LIST_END
 
 ISC_TEST_MAIN
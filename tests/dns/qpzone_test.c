@@ -30,6 +30,7 @@
 #include <dns/rdataset.h>
 #include <dns/rdataslab.h>
 #include <dns/rdatastruct.h>
+#include <dns/slabpool.h>
 #define KEEP_BEFORE
 
 /* Include the main file */
@@ -216,9 +217,192 @@ ISC_RUN_TEST_IMPL(setownercase) {
 	assert_true(dns_name_caseequal(name1, name2));
 }
 
+static void
+sharedslab_add(dns_db_t *db, const dns_name_t *name,
+	       dns_rdataset_t *rdataset) {
+	isc_result_t result;
+	dns_dbversion_t *version = NULL;
+	dns_dbnode_t *node = NULL;
+
+	result = dns_db_newversion(db, &version);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_db_findnode(db, name, true, &node);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_db_addrdataset(db, node, version, 0, rdataset, 0, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_db_detachnode(db, &node);
+	dns_db_closeversion(db, &version, true);
+}
+
+static void
+sharedslab_find(dns_db_t *db, const dns_name_t *name,
+		dns_rdataset_t *rdataset) {
+	isc_result_t result;
+	dns_dbnode_t *node = NULL;
+
+	result = dns_db_findnode(db, name, false, &node);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_db_findrdataset(db, node, NULL, dns_rdatatype_a, 0, 0,
+				     rdataset, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_db_detachnode(db, &node);
+}
+
+/* rdataslabs shared between a raw and a secure database */
+ISC_RUN_TEST_IMPL(sharedslab) {
+	isc_result_t result;
+	dns_db_t *raw = NULL, *secure = NULL;
+	dns_fixedname_t forigin, fname;
+	dns_name_t *origin = dns_fixedname_initname(&forigin);
+	dns_name_t *name = dns_fixedname_initname(&fname);
+	unsigned char data[2][4] = { { 192, 0, 2, 1 }, { 192, 0, 2, 2 } };
+	dns_rdata_t rdata[2] = { DNS_RDATA_INIT, DNS_RDATA_INIT };
+	dns_rdatalist_t rdatalist;
+	dns_rdataset_t rdataset, rawset, secureset;
+	dns_rdata_t found = DNS_RDATA_INIT;
+	uint64_t owned = 0, shared = 0;
+
+	UNUSED(state);
+
+	dns_test_namefromstring("example.", &forigin);
+	dns_test_namefromstring("www.example.", &fname);
+
+	result = dns__qpzone_create(mctx, origin, dns_dbtype_zone,
+				    dns_rdataclass_in, 0, NULL, NULL, &raw);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_db_setslabsharing(raw, true);
+	result = dns__qpzone_create(mctx, origin, dns_dbtype_zone,
+				    dns_rdataclass_in, 0, NULL, NULL, &secure);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	dns_rdatalist_init(&rdatalist);
+	rdatalist.rdclass = dns_rdataclass_in;
+	rdatalist.type = dns_rdatatype_a;
+	rdatalist.ttl = 300;
+	for (size_t i = 0; i < ARRAY_SIZE(rdata); i++) {
+		isc_region_t r = { .base = data[i], .length = 4 };
+		dns_rdata_fromregion(&rdata[i], dns_rdataclass_in,
+				     dns_rdatatype_a, &r);
+		ISC_LIST_APPEND(rdatalist.rdata, &rdata[i], link);
+	}
+	dns_rdataset_init(&rdataset);
+	dns_rdatalist_tordataset(&rdatalist, &rdataset);
+	sharedslab_add(raw, name, &rdataset);
+	dns_rdataset_disassociate(&rdataset);
+
+	/* The secure database refers to the rdataslab of the raw one */
+	dns_rdataset_init(&rawset);
+	sharedslab_find(raw, name, &rawset);
+	sharedslab_add(secure, name, &rawset);
+
+	dns_rdataset_init(&secureset);
+	sharedslab_find(secure, name, &secureset);
+	assert_ptr_equal(rawset.slab.raw, secureset.slab.raw);
+	dns_rdataset_disassociate(&rawset);
+
+	result = dns_db_getslabstats(raw, &owned, &shared);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_true(owned > 0);
+	assert_int_equal(shared, 0);
+
+	result = dns_db_getslabstats(secure, &owned, &shared);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_int_equal(owned, 0);
+	assert_true(shared > 0);
+
+	/* The shared data outlives the raw database */
+	dns_db_detach(&raw);
+	assert_int_equal(dns_rdataset_count(&secureset), 2);
+	result = dns_rdataset_first(&secureset);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_rdataset_current(&secureset, &found);
+	assert_int_equal(dns_rdata_compare(&found, &rdata[0]), 0);
+	dns_rdataset_disassociate(&secureset);
+
+	dns_db_detach(&secure);
+}
+
+/* identical rdataslabs interned in a slab pool */
+ISC_RUN_TEST_IMPL(slabpool) {
+	isc_result_t result;
+	dns_slabpool_t *pool = NULL;
+	dns_slabpool_stats_t stats;
+	dns_db_t *db[2] = { NULL, NULL };
+	dns_fixedname_t forigin[2], fname[2];
+	unsigned char data[4] = { 192, 0, 2, 1 };
+	dns_rdata_t rdata = DNS_RDATA_INIT;
+	dns_rdatalist_t rdatalist;
+	dns_rdataset_t rdataset, found[2];
+	isc_region_t r = { .base = data, .length = sizeof(data) };
+
+	UNUSED(state);
+
+	dns_slabpool_create(mctx, &pool);
+
+	dns_test_namefromstring("example.", &forigin[0]);
+	dns_test_namefromstring("www.example.", &fname[0]);
+	dns_test_namefromstring("example.net.", &forigin[1]);
+	dns_test_namefromstring("www.example.net.", &fname[1]);
+
+	dns_rdatalist_init(&rdatalist);
+	rdatalist.rdclass = dns_rdataclass_in;
+	rdatalist.type = dns_rdatatype_a;
+	rdatalist.ttl = 300;
+	dns_rdata_fromregion(&rdata, dns_rdataclass_in, dns_rdatatype_a, &r);
+	ISC_LIST_APPEND(rdatalist.rdata, &rdata, link);
+
+	/* The same RRset in two zones */
+	for (size_t i = 0; i < ARRAY_SIZE(db); i++) {
+		result = dns__qpzone_create(
+			mctx, dns_fixedname_name(&forigin[i]), dns_dbtype_zone,
+			dns_rdataclass_in, 0, NULL, NULL, &db[i]);
+		assert_int_equal(result, ISC_R_SUCCESS);
+		dns_db_setslabpool(db[i], pool);
+
+		dns_rdataset_init(&rdataset);
+		dns_rdatalist_tordataset(&rdatalist, &rdataset);
+		sharedslab_add(db[i], dns_fixedname_name(&fname[i]),
+			       &rdataset);
+		dns_rdataset_disassociate(&rdataset);
+
+		dns_rdataset_init(&found[i]);
+		sharedslab_find(db[i], dns_fixedname_name(&fname[i]),
+				&found[i]);
+	}
+
+	/* ... is stored once */
+	assert_ptr_equal(found[0].slab.raw, found[1].slab.raw);
+	dns_rdataset_disassociate(&found[0]);
+	dns_rdataset_disassociate(&found[1]);
+
+	dns_slabpool_getstats(pool, &stats);
+	assert_int_equal(stats.entries, 1);
+	assert_int_equal(stats.references, 2);
+	assert_int_equal(stats.lookups, 2);
+	assert_int_equal(stats.hits, 1);
+	assert_int_equal(stats.saved, stats.bytes);
+
+	/* Purging keeps the rdataslabs still in use */
+	dns_slabpool_purge(pool);
+	dns_slabpool_getstats(pool, &stats);
+	assert_int_equal(stats.entries, 1);
+
+	dns_db_detach(&db[0]);
+	dns_db_detach(&db[1]);
+
+	dns_slabpool_purge(pool);
+	dns_slabpool_getstats(pool, &stats);
+	assert_int_equal(stats.entries, 0);
+	assert_int_equal(stats.references, 0);
+
+	dns_slabpool_detach(&pool);
+}
+
 ISC_TEST_LIST_START
 ISC_TEST_ENTRY(ownercase)
 ISC_TEST_ENTRY(setownercase)
+ISC_TEST_ENTRY(sharedslab)
+ISC_TEST_ENTRY(slabpool)
 ISC_TEST_LIST_END
 
 ISC_TEST_MAIN
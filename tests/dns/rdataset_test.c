@@ -23,8 +23,12 @@
 #define UNIT_TESTING
 #include <cmocka.h>
 
+#include <isc/buffer.h>
 #include <isc/util.h>
 
+#include <dns/compress.h>
+#include <dns/fixedname.h>
+#include <dns/rdatalist.h>
 #include <dns/rdataset.h>
 #include <dns/rdatastruct.h>
 
@@ -101,8 +105,93 @@ ISC_RUN_TEST_IMPL(trimttl) {
 	assert_int_equal(sigrdataset.ttl, 0);
 }
 
+static size_t
+render(dns_rdatatype_t type, const char **rdatas, size_t count, bool wire,
+       unsigned char *out, size_t size) {
+	dns_fixedname_t fname;
+	dns_rdatalist_t rdatalist;
+	dns_rdataset_t rdataset;
+	dns_rdata_t rdata[4];
+	unsigned char data[4][64];
+	dns_compress_t cctx;
+	isc_buffer_t target;
+	unsigned int rendered = 0;
+	isc_result_t result;
+
+	REQUIRE(count <= ARRAY_SIZE(rdata));
+
+	dns_test_namefromstring("example.com.", &fname);
+
+	dns_rdatalist_init(&rdatalist);
+	rdatalist.rdclass = dns_rdataclass_in;
+	rdatalist.type = type;
+	rdatalist.ttl = 300;
+	for (size_t i = 0; i < count; i++) {
+		dns_rdata_init(&rdata[i]);
+		result = dns_test_rdatafromstring(&rdata[i], dns_rdataclass_in,
+						  type, data[i],
+						  sizeof(data[i]), rdatas[i],
+						  false);
+		assert_int_equal(result, ISC_R_SUCCESS);
+		ISC_LIST_APPEND(rdatalist.rdata, &rdata[i], link);
+	}
+
+	dns_rdataset_init(&rdataset);
+	dns_rdatalist_tordataset(&rdatalist, &rdataset);
+	if (wire) {
+		rdataset.attributes |= DNS_RDATASETATTR_WIRE;
+	}
+
+	isc_buffer_init(&target, out, size);
+	dns_compress_init(&cctx, mctx, 0);
+	result = dns_rdataset_towire(&rdataset, dns_fixedname_name(&fname),
+				     &cctx, &target, 0, &rendered);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_int_equal(rendered, count);
+	dns_compress_invalidate(&cctx);
+	dns_rdataset_disassociate(&rdataset);
+
+	return (isc_buffer_usedlength(&target));
+}
+
+/* rdata rendered as it is only differs in its uncompressed names */
+ISC_RUN_TEST_IMPL(towire_wire) {
+	const char *a[] = { "192.0.2.1", "192.0.2.2" };
+	const char *ns[] = { "ns1.example.com.", "ns2.example.com." };
+	unsigned char normal[512], wire[512];
+	size_t normallen, wirelen;
+
+	UNUSED(state);
+
+	/* Nothing to compress: the result is the same */
+	normallen = render(dns_rdatatype_a, a, ARRAY_SIZE(a), false, normal,
+			   sizeof(normal));
+	wirelen = render(dns_rdatatype_a, a, ARRAY_SIZE(a), true, wire,
+			 sizeof(wire));
+	assert_int_equal(wirelen, normallen);
+	assert_memory_equal(wire, normal, normallen);
+
+	/*
+	 * The owner names are still compressed, but the NS names are
+	 * not: the first is 17 bytes instead of 4 for "ns1" and a pointer
+	 * to the owner, the second is 17 bytes instead of 6.
+	 */
+	normallen = render(dns_rdatatype_ns, ns, ARRAY_SIZE(ns), false, normal,
+			   sizeof(normal));
+	wirelen = render(dns_rdatatype_ns, ns, ARRAY_SIZE(ns), true, wire,
+			 sizeof(wire));
+	assert_int_equal(normallen, 13 + 10 + 6 + 2 + 10 + 6);
+	assert_int_equal(wirelen, 13 + 10 + 17 + 2 + 10 + 17);
+	assert_memory_equal(wire, normal, 13 + 10 - 2);
+
+	/* A record which just fits in the buffer is rendered */
+	wirelen = render(dns_rdatatype_ns, ns, 1, true, wire, 13 + 10 + 17);
+	assert_int_equal(wirelen, 13 + 10 + 17);
+}
+
 ISC_TEST_LIST_START
 ISC_TEST_ENTRY(trimttl)
+ISC_TEST_ENTRY(towire_wire)
 ISC_TEST_LIST_END
 
 ISC_TEST_MAIN
@@ -0,0 +1,314 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <arpa/inet.h>
+#include <inttypes.h>
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/mem.h>
+#include <isc/sockaddr.h>
+#include <isc/stats.h>
+#include <isc/tls.h>
+#include <isc/urcu.h>
+#include <isc/util.h>
+
+#include <dns/dispatch.h>
+#include <dns/forward.h>
+#include <dns/refresher.h>
+#include <dns/view.h>
+#define KEEP_BEFORE
+
+/* Include the main file */
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wshadow"
+#undef CHECK
+#include "refresher.c"
+#pragma GCC diagnostic pop
+
+#undef CHECK
+#include <tests/dns.h>
+
+static isc_mem_t *vmctx = NULL;
+static dns_view_t *view = NULL;
+static dns_dispatch_t *dispatch = NULL;
+static isc_tlsctx_cache_t *tlsctx_cache = NULL;
+static isc_stats_t *stats = NULL;
+static dns_refresher_t *refresher = NULL;
+
+/*
+ * The view has a memory context of its own, so that the teardown can
+ * check that everything the view, its resolver and its refresher
+ * allocated has been freed.
+ */
+static int
+setup_test(void **state) {
+	isc_mem_create(&vmctx);
+	setup_managers(state);
+
+	return (0);
+}
+
+static int
+teardown_test(void **state) {
+	teardown_managers(state);
+
+	rcu_barrier();
+	assert_int_equal(isc_mem_inuse(vmctx), 0);
+	isc_mem_destroy(&vmctx);
+
+	return (0);
+}
+
+/*
+ * The names under example are forwarded to a server which never
+ * answers, so that the refreshes stay in progress until they are
+ * canceled.
+ */
+static void
+refresher_setup(uint32_t size, uint32_t rate) {
+	struct in_addr ina = { .s_addr = htonl(0xc0000201) }; /* 192.0.2.1 */
+	isc_sockaddr_t local, forwarder;
+	isc_sockaddrlist_t forwarders;
+	dns_dispatchmgr_t *dispatchmgr = NULL;
+	dns_cache_t *cache = NULL;
+	dns_fixedname_t fname;
+	isc_result_t result;
+
+	result = dns_dispatchmgr_create(mctx, loopmgr, netmgr, &dispatchmgr);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_view_create(vmctx, dispatchmgr, dns_rdataclass_in, "view",
+				 &view);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_cache_create(loopmgr, dns_rdataclass_in, "", vmctx,
+				  &cache);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_view_setcache(view, cache, false);
+	dns_cache_detach(&cache);
+
+	isc_sockaddr_any(&local);
+	result = dns_dispatch_createudp(dispatchmgr, &local, &dispatch);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_dispatchmgr_detach(&dispatchmgr);
+
+	isc_sockaddr_fromin(&forwarder, &ina, 53);
+	ISC_LINK_INIT(&forwarder, link);
+	ISC_LIST_INIT(forwarders);
+	ISC_LIST_APPEND(forwarders, &forwarder, link);
+	dns_test_namefromstring("example", &fname);
+	result = dns_fwdtable_add(view->fwdtable, dns_fixedname_name(&fname),
+				  &forwarders, dns_fwdpolicy_only);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	isc_tlsctx_cache_create(mctx, &tlsctx_cache);
+	result = dns_view_createresolver(view, netmgr, 0, tlsctx_cache,
+					 dispatch, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_view_freeze(view);
+
+	isc_stats_create(mctx, &stats, dns_resstatscounter_max);
+	dns_resolver_setstats(view->resolver, stats);
+
+	dns_refresher_create(view, size, rate, &view->refresher);
+	refresher = view->refresher;
+}
+
+static void
+refresher_teardown(void) {
+	refresher = NULL;
+	isc_stats_detach(&stats);
+	dns_view_detach(&view);
+	dns_dispatch_detach(&dispatch);
+	isc_tlsctx_cache_detach(&tlsctx_cache);
+
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+/*
+ * Count 'n' answers from the cache for 'owner'/A, which expire in
+ * 'ttl' seconds.
+ */
+static void
+hit(const char *owner, unsigned int n, dns_ttl_t ttl) {
+	dns_fixedname_t fname;
+	isc_stdtime_t now = isc_stdtime_now();
+
+	dns_test_namefromstring(owner, &fname);
+	for (unsigned int i = 0; i < n; i++) {
+		dns_refresher_hit(refresher, dns_fixedname_name(&fname),
+				  dns_rdatatype_a, ttl, now);
+	}
+}
+
+/*
+ * The table entry for 'owner'/A, or NULL if it is not popular enough
+ * to be in the table.
+ */
+static refresh_entry_t *
+tracked(const char *owner) {
+	dns_fixedname_t fname;
+	refresh_key_t key = { .type = dns_rdatatype_a };
+	refresh_entry_t *entry = NULL;
+	isc_result_t result;
+
+	dns_test_namefromstring(owner, &fname);
+	key.name = dns_fixedname_name(&fname);
+
+	LOCK(&refresher->lock);
+	result = isc_hashmap_find(refresher->table,
+				  (uint32_t)hash_key(key.name, key.type),
+				  match_entry, &key, (void **)&entry);
+	UNLOCK(&refresher->lock);
+
+	return (result == ISC_R_SUCCESS ? entry : NULL);
+}
+
+static uint64_t
+counter(isc_statscounter_t id) {
+	return (isc_stats_get_counter(stats, id));
+}
+
+/* the sketch counts the hits of a name, and forgets them over time */
+ISC_LOOP_TEST_IMPL(refresher_sketch) {
+	UNUSED(arg);
+
+	refresher_setup(4, 10);
+
+	/* a name is only offered to the table every REFRESH_OFFER hits */
+	hit("a.example", REFRESH_OFFER - 1, 300);
+	assert_null(tracked("a.example"));
+	assert_int_equal(refresher->used, 0);
+
+	hit("a.example", 1, 300);
+	assert_non_null(tracked("a.example"));
+	assert_int_equal(tracked("a.example")->count, REFRESH_OFFER);
+
+	hit("a.example", REFRESH_OFFER, 300);
+	assert_int_equal(tracked("a.example")->count, 2 * REFRESH_OFFER);
+
+	/* the counters are halved, in the sketch and in the table */
+	decay(refresher);
+	assert_int_equal(tracked("a.example")->count, REFRESH_OFFER);
+
+	hit("a.example", REFRESH_OFFER, 300);
+	assert_int_equal(tracked("a.example")->count, 2 * REFRESH_OFFER);
+	assert_int_equal(refresher->used, 1);
+
+	refresher_teardown();
+}
+
+/* only the most popular names are kept in the table */
+ISC_LOOP_TEST_IMPL(refresher_popular) {
+	UNUSED(arg);
+
+	refresher_setup(2, 10);
+
+	hit("a.example", 4 * REFRESH_OFFER, 300);
+	assert_int_equal(atomic_load(&refresher->floor), 0);
+	hit("b.example", 2 * REFRESH_OFFER, 300);
+	assert_int_equal(refresher->used, 2);
+	assert_int_equal(atomic_load(&refresher->floor), 2 * REFRESH_OFFER);
+
+	/* a name hit less than the least popular one stays out */
+	hit("c.example", 2 * REFRESH_OFFER, 300);
+	assert_null(tracked("c.example"));
+
+	/* and replaces it once it is hit more */
+	hit("c.example", REFRESH_OFFER, 300);
+	assert_non_null(tracked("c.example"));
+	assert_int_equal(tracked("c.example")->count, 3 * REFRESH_OFFER);
+	assert_null(tracked("b.example"));
+	assert_non_null(tracked("a.example"));
+	assert_int_equal(atomic_load(&refresher->floor), 3 * REFRESH_OFFER);
+
+	refresher_teardown();
+}
+
+/* the names due for a refresh are refetched as fast as the rate allows */
+ISC_LOOP_TEST_IMPL(refresher_rate) {
+	char owner[DNS_NAME_FORMATSIZE];
+
+	UNUSED(arg);
+
+	refresher_setup(6, 2);
+
+	/* the more popular the name, the sooner it is refreshed */
+	for (size_t i = 0; i < 6; i++) {
+		snprintf(owner, sizeof(owner), "n%zu.example", i);
+		hit(owner, (i + 1) * REFRESH_OFFER, 0);
+	}
+
+	/* the bucket starts full, with a second's worth of fetches */
+	tick(refresher);
+	assert_int_equal(counter(dns_resstatscounter_refresh), 2);
+	assert_int_equal(counter(dns_resstatscounter_refreshdeferred), 4);
+	assert_true(tracked("n5.example")->refreshing);
+	assert_true(tracked("n4.example")->refreshing);
+	assert_false(tracked("n3.example")->refreshing);
+
+	/*
+	 * The entries being refreshed are not replaced, so a new name
+	 * takes the place of the least popular of the others.
+	 */
+	assert_int_equal(atomic_load(&refresher->floor), REFRESH_OFFER);
+	hit("new.example", 8 * REFRESH_OFFER, 0);
+	assert_int_equal(refresher->used, 6);
+	assert_null(tracked("n0.example"));
+	assert_non_null(tracked("n4.example"));
+	assert_non_null(tracked("n5.example"));
+	assert_int_equal(atomic_load(&refresher->floor), 2 * REFRESH_OFFER);
+
+	/* then it fills up by a tenth of the rate each tick */
+	for (size_t i = 0; i < 1000 / REFRESH_TICK / 2 - 1; i++) {
+		tick(refresher);
+		assert_int_equal(counter(dns_resstatscounter_refresh), 2);
+	}
+	tick(refresher);
+	assert_int_equal(counter(dns_resstatscounter_refresh), 3);
+	assert_true(tracked("new.example")->refreshing);
+
+	refresher_teardown();
+}
+
+/* the view and its resolver are freed while the refresher is busy */
+ISC_LOOP_TEST_IMPL(refresher_shutdown) {
+	UNUSED(arg);
+
+	refresher_setup(4, 10);
+
+	hit("a.example", REFRESH_OFFER, 0);
+	tick(refresher);
+	assert_true(tracked("a.example")->refreshing);
+
+	/* the checks are made by teardown_test() */
+	refresher_teardown();
+}
+
+ISC_TEST_LIST_START
+ISC_TEST_ENTRY_CUSTOM(refresher_sketch, setup_test, teardown_test)
+ISC_TEST_ENTRY_CUSTOM(refresher_popular, setup_test, teardown_test)
+ISC_TEST_ENTRY_CUSTOM(refresher_rate, setup_test, teardown_test)
+ISC_TEST_ENTRY_CUSTOM(refresher_shutdown, setup_test, teardown_test)
+ISC_TEST_LIST_END
+
+ISC_TEST_MAIN
@@ -184,6 +184,29 @@ ISC_LOOP_TEST_IMPL(settimeout_overmax) {
 	isc_loopmgr_shutdown(loopmgr);
 }
 
+/* dns_resolver_sethedgebudget */
+ISC_LOOP_TEST_IMPL(sethedgebudget) {
+	dns_resolver_t *resolver = NULL;
+
+	mkres(&resolver);
+
+	/* disabled by default */
+	assert_int_equal(dns_resolver_gethedgebudget(resolver), 0);
+
+	dns_resolver_sethedgebudget(resolver, 5);
+	assert_int_equal(dns_resolver_gethedgebudget(resolver), 5);
+
+	/* no more than one hedged query per query */
+	dns_resolver_sethedgebudget(resolver, 1000);
+	assert_int_equal(dns_resolver_gethedgebudget(resolver), 100);
+
+	dns_resolver_sethedgebudget(resolver, 0);
+	assert_int_equal(dns_resolver_gethedgebudget(resolver), 0);
+
+	destroy_resolver(&resolver);
+	isc_loopmgr_shutdown(loopmgr);
+}
+
 ISC_TEST_LIST_START
 ISC_TEST_ENTRY_CUSTOM(create, setup_test, teardown_test)
 ISC_TEST_ENTRY_CUSTOM(gettimeout, setup_test, teardown_test)
@@ -191,6 +214,7 @@ ISC_TEST_ENTRY_CUSTOM(settimeout, setup_test, teardown_test)
 ISC_TEST_ENTRY_CUSTOM(settimeout_default, setup_test, teardown_test)
 ISC_TEST_ENTRY_CUSTOM(settimeout_belowmin, setup_test, teardown_test)
 ISC_TEST_ENTRY_CUSTOM(settimeout_overmax, setup_test, teardown_test)
+ISC_TEST_ENTRY_CUSTOM(sethedgebudget, setup_test, teardown_test)
 ISC_TEST_LIST_END
 
 ISC_TEST_MAIN
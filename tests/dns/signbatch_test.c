@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <inttypes.h>
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/loop.h>
+#include <isc/util.h>
+
+#include <dns/zone.h>
+#define KEEP_BEFORE
+
+/* Include the main file */
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wshadow"
+#undef CHECK
+#include "zone.c"
+#pragma GCC diagnostic pop
+
+#undef CHECK
+#include <tests/dns.h>
+
+static dns_zonemgr_t *zmgr = NULL;
+static dns_zone_t *zone = NULL;
+static dns_db_t *db = NULL;
+static dns_dbversion_t *version = NULL;
+static dns_rdataset_t soa;
+static dst_key_t *keys[DNS_MAXZONEKEYS];
+static unsigned int nkeys;
+static dns_diff_t diff;
+static isc_stdtime_t now;
+
+static int
+setup_test(void **state) {
+	setup_loopmgr(state);
+	setup_netmgr(state);
+
+	return (0);
+}
+
+static int
+teardown_test(void **state) {
+	teardown_netmgr(state);
+	teardown_loopmgr(state);
+
+	return (0);
+}
+
+/*
+ * Prepare a zone managed by a zone manager, so its RRSIGs can be
+ * generated by the work pool, along with its signing keys and a new
+ * version of its database.
+ */
+static void
+signzone_setup(void) {
+	dns_dbnode_t *node = NULL;
+	isc_result_t result;
+
+	now = isc_stdtime_now();
+
+	dns_zonemgr_create(mctx, netmgr, &zmgr);
+	result = dns_test_makezone("example", &zone, NULL, false);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_zonemgr_managezone(zmgr, zone);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_test_loaddb(&db, dns_dbtype_zone, "example",
+				 "testdata/master/master18.data");
+	assert_int_equal(result, DNS_R_SEENINCLUDE);
+
+	result = dns_zone_setkeydirectory(zone, TESTS_DIR "/testkeys");
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_zone_findkeys(zone, db, NULL, now, mctx, DNS_MAXZONEKEYS,
+				   keys, &nkeys);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_int_equal(nkeys, 2);
+
+	result = dns_db_newversion(db, &version);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_db_findnode(db, dns_db_origin(db), false, &node);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_rdataset_init(&soa);
+	result = dns_db_findrdataset(db, node, version, dns_rdatatype_soa, 0,
+				     0, &soa, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_db_detachnode(db, &node);
+
+	dns_diff_init(mctx, &diff);
+}
+
+static void
+signzone_teardown(void) {
+	dns_diff_clear(&diff);
+	dns_rdataset_disassociate(&soa);
+	dns_db_closeversion(db, &version, false);
+	dns_db_detach(&db);
+	for (unsigned int i = 0; i < nkeys; i++) {
+		dst_key_free(&keys[i]);
+	}
+
+	dns_zonemgr_releasezone(zmgr, zone);
+	dns_zone_detach(&zone);
+	dns_zonemgr_shutdown(zmgr);
+	dns_zonemgr_detach(&zmgr);
+
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+/*
+ * The inception time of the RRSIG queued as job 'i', which makes each
+ * of them different.
+ */
+static isc_stdtime_t
+job_inception(size_t i) {
+	return (now - 86400 + i);
+}
+
+/* the RRSIGs are generated in parallel and added in order */
+ISC_LOOP_TEST_IMPL(signbatch_parallel) {
+	dns_zone_signingstats_t stats;
+	dns_difftuple_t *tuple = NULL;
+	signbatch_t batch;
+	isc_result_t result;
+	size_t njobs, i;
+
+	UNUSED(arg);
+
+	signzone_setup();
+
+	signbatch_init(zone, &batch);
+	assert_int_equal(batch.workers, isc_loopmgr_nloops(loopmgr));
+
+	/* a full batch is flushed when the next job is queued */
+	njobs = 2 * batch.size + 3;
+	for (i = 0; i < njobs; i++) {
+		result = signbatch_add(&batch, db, version, &diff,
+				       dns_db_origin(db), &soa,
+				       keys[i % nkeys], job_inception(i),
+				       now + 3600);
+		assert_int_equal(result, ISC_R_SUCCESS);
+	}
+	assert_true(signbatch_pending(&batch, dns_db_origin(db),
+				      dns_rdatatype_soa));
+
+	result = signbatch_flush(&batch, db, version, &diff);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_int_equal(batch.count, 0);
+	assert_false(signbatch_pending(&batch, dns_db_origin(db),
+				       dns_rdatatype_soa));
+
+	i = 0;
+	for (tuple = ISC_LIST_HEAD(diff.tuples); tuple != NULL;
+	     tuple = ISC_LIST_NEXT(tuple, link))
+	{
+		dns_rdata_rrsig_t rrsig;
+
+		assert_int_equal(tuple->op, DNS_DIFFOP_ADDRESIGN);
+		result = dns_rdata_tostruct(&tuple->rdata, &rrsig, NULL);
+		assert_int_equal(result, ISC_R_SUCCESS);
+		assert_int_equal(rrsig.timesigned, job_inception(i));
+		assert_int_equal(rrsig.keyid, dst_key_id(keys[i % nkeys]));
+		i++;
+	}
+	assert_int_equal(i, njobs);
+
+	dns_zone_getsigningstats(zone, &stats);
+	assert_int_equal(stats.signatures, njobs);
+	assert_true(stats.offloaded <= njobs);
+
+	signbatch_destroy(&batch);
+	signzone_teardown();
+}
+
+/* the RRSIGs that could not be generated are not counted */
+ISC_LOOP_TEST_IMPL(signbatch_failure) {
+	dns_zone_signingstats_t stats;
+	dst_key_t *public = NULL;
+	signbatch_t batch;
+	isc_result_t result;
+
+	UNUSED(arg);
+
+	signzone_setup();
+
+	result = dst_key_fromfile(dns_db_origin(db), dst_key_id(keys[0]),
+				  dst_key_alg(keys[0]), DST_TYPE_PUBLIC,
+				  TESTS_DIR "/testkeys", mctx, &public);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	signbatch_init(zone, &batch);
+	for (size_t i = 0; i < 4; i++) {
+		result = signbatch_add(&batch, db, version, &diff,
+				       dns_db_origin(db), &soa,
+				       i == 2 ? public : keys[0],
+				       job_inception(i), now + 3600);
+		assert_int_equal(result, ISC_R_SUCCESS);
+	}
+
+	result = signbatch_flush(&batch, db, version, &diff);
+	assert_int_equal(result, DST_R_NOTPRIVATEKEY);
+	assert_int_equal(batch.count, 0);
+
+	dns_zone_getsigningstats(zone, &stats);
+	assert_int_equal(stats.signatures, 2);
+
+	signbatch_destroy(&batch);
+	dst_key_free(&public);
+	signzone_teardown();
+}
+
+ISC_TEST_LIST_START
+ISC_TEST_ENTRY_CUSTOM(signbatch_parallel, setup_test, teardown_test)
+ISC_TEST_ENTRY_CUSTOM(signbatch_failure, setup_test, teardown_test)
+ISC_TEST_LIST_END
+
+ISC_TEST_MAIN
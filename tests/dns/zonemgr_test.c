@@ -25,9 +25,12 @@
 
 #include <isc/buffer.h>
 #include <isc/timer.h>
+#include <isc/urcu.h>
 #include <isc/util.h>
 
+#include <dns/masterdump.h>
 #include <dns/name.h>
+#include <dns/slabpool.h>
 #include <dns/view.h>
 #include <dns/zone.h>
 
@@ -187,11 +190,61 @@ ISC_LOOP_TEST_IMPL(zonemgr_unreachable) {
 	isc_loopmgr_shutdown(loopmgr);
 }
 
+/* the interned rdataslabs of an unloaded zone are purged */
+ISC_LOOP_TEST_IMPL(zonemgr_slabpurge) {
+	dns_zonemgr_t *myzonemgr = NULL;
+	dns_zone_t *zone = NULL;
+	dns_slabpool_stats_t stats;
+	isc_result_t result;
+
+	UNUSED(arg);
+
+	dns_zonemgr_create(mctx, netmgr, &myzonemgr);
+	dns_zonemgr_setinternslabs(myzonemgr, true);
+
+	result = dns_test_makezone("example", &zone, NULL, false);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_zonemgr_managezone(myzonemgr, zone);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_zone_setfile(zone, TESTS_DIR "/testdata/zt/zone1.db",
+				  dns_masterformat_text,
+				  &dns_master_style_default);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_zone_load(zone, false);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = dns_zonemgr_getslabpoolstats(myzonemgr, &stats);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_true(stats.entries > 0);
+
+	dns_zone_unload(zone);
+	rcu_barrier();
+
+	result = dns_zonemgr_getslabpoolstats(myzonemgr, &stats);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	assert_int_equal(stats.entries, 0);
+	assert_int_equal(stats.bytes, 0);
+
+	dns_zonemgr_setinternslabs(myzonemgr, false);
+	result = dns_zonemgr_getslabpoolstats(myzonemgr, &stats);
+	assert_int_equal(result, ISC_R_NOTFOUND);
+
+	dns_zonemgr_releasezone(myzonemgr, zone);
+	dns_zone_detach(&zone);
+	dns_zonemgr_shutdown(myzonemgr);
+	dns_zonemgr_detach(&myzonemgr);
+	assert_null(myzonemgr);
+
+	isc_loopmgr_shutdown(loopmgr);
+}
+
 ISC_TEST_LIST_START
 ISC_TEST_ENTRY_CUSTOM(zonemgr_create, setup_test, teardown_test)
 ISC_TEST_ENTRY_CUSTOM(zonemgr_managezone, setup_test, teardown_test)
 ISC_TEST_ENTRY_CUSTOM(zonemgr_createzone, setup_test, teardown_test)
 ISC_TEST_ENTRY_CUSTOM(zonemgr_unreachable, setup_test, teardown_test)
+ISC_TEST_ENTRY_CUSTOM(zonemgr_slabpurge, setup_test, teardown_test)
 ISC_TEST_LIST_END
 
 ISC_TEST_MAIN
@@ -0,0 +1,355 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <inttypes.h>
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/loop.h>
+#include <isc/sockaddr.h>
+#include <isc/thread.h>
+#include <isc/util.h>
+
+#include <dns/zone.h>
+#define KEEP_BEFORE
+
+/* Include the main file */
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wshadow"
+#undef CHECK
+#include "zone.c"
+#pragma GCC diagnostic pop
+
+#undef CHECK
+#include <tests/dns.h>
+
+#define NENTRIES 16
+#define DEPTH	 8
+#define RTT	 1000
+#define NRACE	 256
+
+static dns_zonepeer_entry_t entries[NENTRIES];
+static size_t nsent;
+static size_t ndone;
+
+static int
+setup_test(void **state) {
+	setup_loopmgr(state);
+	setup_netmgr(state);
+
+	memset(entries, 0, sizeof(entries));
+	nsent = ndone = 0;
+
+	return (0);
+}
+
+static int
+teardown_test(void **state) {
+	teardown_netmgr(state);
+	teardown_loopmgr(state);
+
+	return (0);
+}
+
+static void
+entry_cb(void *arg) {
+	UNUSED(arg);
+}
+
+/*
+ * Check the state of the peer and keep track of the entries that have
+ * been sent; they are sent in the order they were queued.
+ */
+static void
+check_peer(dns_zonepeer_t *peer, unsigned int window) {
+	assert_int_equal(peer->window, window);
+	assert_int_equal(peer->inflight, ISC_MIN(window, NENTRIES - ndone));
+	assert_int_equal(peer->queued + peer->inflight + ndone, NENTRIES);
+
+	nsent = ndone + peer->inflight;
+}
+
+static void
+done(isc_result_t result, uint64_t rtt) {
+	assert_true(ndone < nsent);
+	zonepeer_done(&entries[ndone++].peer, result, rtt);
+}
+
+ISC_LOOP_TEST_IMPL(zonepeer_window) {
+	dns_zonemgr_t *zmgr = NULL;
+	dns_zonepeer_t *peer = NULL;
+	isc_sockaddr_t addr;
+	struct in_addr in = { .s_addr = htonl(INADDR_LOOPBACK) };
+
+	UNUSED(arg);
+
+	dns_zonemgr_create(mctx, netmgr, &zmgr);
+	dns_zonemgr_setserialquerypipeline(zmgr, DEPTH);
+	isc_sockaddr_fromin(&addr, &in, 53);
+
+	for (size_t i = 0; i < NENTRIES; i++) {
+		zonepeer_enqueue(zmgr, zmgr->refreshpeers,
+				 &zmgr->serialquerypipeline, &addr, &entries[i],
+				 mainloop, entry_cb, &entries[i]);
+	}
+	peer = entries[0].peer;
+	for (size_t i = 1; i < NENTRIES; i++) {
+		assert_ptr_equal(entries[i].peer, peer);
+	}
+	check_peer(peer, ZONEPEER_INITWINDOW);
+	assert_false(entries[0].batched);
+	assert_true(entries[1].batched);
+
+	/* A window of timely responses opens the window by one message */
+	for (size_t i = 0; i < ZONEPEER_INITWINDOW; i++) {
+		done(ISC_R_SUCCESS, RTT);
+	}
+	check_peer(peer, ZONEPEER_INITWINDOW + 1);
+	assert_int_equal(peer->completed, ZONEPEER_INITWINDOW);
+	assert_int_equal(peer->minrtt, RTT);
+	assert_int_equal(peer->srtt, RTT);
+
+	/* A slow response starts the count again */
+	for (size_t i = 0; i < ZONEPEER_INITWINDOW; i++) {
+		done(ISC_R_SUCCESS, RTT);
+	}
+	done(ISC_R_SUCCESS, RTT * ZONEPEER_RTTFACTOR + 1);
+	check_peer(peer, ZONEPEER_INITWINDOW + 1);
+	assert_int_equal(peer->acked, 0);
+
+	/* A failure halves the window */
+	done(ISC_R_TIMEDOUT, 0);
+	assert_int_equal(peer->window, (ZONEPEER_INITWINDOW + 1) / 2);
+	assert_int_equal(peer->failed, 1);
+
+	/* Canceled queries do not count */
+	done(ISC_R_CANCELED, 0);
+	assert_int_equal(peer->window, (ZONEPEER_INITWINDOW + 1) / 2);
+	assert_int_equal(peer->failed, 1);
+
+	/* Nothing more is sent until the messages in flight are answered */
+	while (peer->inflight > (ZONEPEER_INITWINDOW + 1) / 2) {
+		assert_int_equal(peer->queued, NENTRIES - nsent);
+		done(ISC_R_SUCCESS, RTT);
+	}
+	check_peer(peer, (ZONEPEER_INITWINDOW + 1) / 2);
+
+	/* The window never exceeds the configured depth */
+	zonepeers_setdepth(zmgr, zmgr->refreshpeers,
+			   &zmgr->serialquerypipeline, 1);
+	assert_int_equal(peer->window, 1);
+
+	/* Turning the pipelining off cancels the queued messages */
+	zonepeers_setdepth(zmgr, zmgr->refreshpeers,
+			   &zmgr->serialquerypipeline, 0);
+	assert_int_equal(peer->queued, 0);
+	assert_int_equal(peer->inflight, NENTRIES - ndone);
+	for (size_t i = nsent; i < NENTRIES; i++) {
+		assert_true(entries[i].canceled);
+	}
+
+	for (size_t i = ndone; i < NENTRIES; i++) {
+		zonepeer_release(&entries[i].peer);
+	}
+	assert_int_equal(peer->inflight, 0);
+
+	dns_zonemgr_shutdown(zmgr);
+	dns_zonemgr_detach(&zmgr);
+
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+/* A message that is retried is still in flight */
+ISC_LOOP_TEST_IMPL(zonepeer_retry) {
+	dns_zonemgr_t *zmgr = NULL;
+	dns_zonepeer_t *peer = NULL;
+	isc_sockaddr_t addr;
+	struct in_addr in = { .s_addr = htonl(INADDR_LOOPBACK) };
+
+	UNUSED(arg);
+
+	dns_zonemgr_create(mctx, netmgr, &zmgr);
+	dns_zonemgr_setnotifypipeline(zmgr, 1);
+	isc_sockaddr_fromin(&addr, &in, 53);
+
+	for (size_t i = 0; i < 2; i++) {
+		zonepeer_enqueue(zmgr, zmgr->notifypeers,
+				 &zmgr->notifypipeline, &addr, &entries[i],
+				 mainloop, entry_cb, &entries[i]);
+	}
+	peer = entries[0].peer;
+	assert_int_equal(peer->inflight, 1);
+	assert_int_equal(peer->queued, 1);
+
+	/* The failure is accounted for, the second message is held back */
+	zonepeer_update(peer, ISC_R_TIMEDOUT, 0);
+	assert_int_equal(peer->failed, 1);
+	assert_int_equal(peer->inflight, 1);
+	assert_int_equal(peer->queued, 1);
+
+	zonepeer_release(&entries[0].peer);
+	assert_int_equal(peer->inflight, 1);
+	assert_int_equal(peer->queued, 0);
+	zonepeer_done(&entries[1].peer, ISC_R_SUCCESS, RTT);
+	assert_int_equal(peer->inflight, 0);
+	assert_int_equal(peer->completed, 1);
+
+	dns_zonemgr_shutdown(zmgr);
+	dns_zonemgr_detach(&zmgr);
+
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+/* Nothing is queued once the pipelining has been turned off */
+ISC_LOOP_TEST_IMPL(zonepeer_disabled) {
+	dns_zonemgr_t *zmgr = NULL;
+	isc_sockaddr_t addr;
+	struct in_addr in = { .s_addr = htonl(INADDR_LOOPBACK) };
+
+	UNUSED(arg);
+
+	dns_zonemgr_create(mctx, netmgr, &zmgr);
+	assert_int_equal(dns_zonemgr_getnotifypipeline(zmgr), 0);
+	isc_sockaddr_fromin(&addr, &in, 53);
+
+	zonepeer_enqueue(zmgr, zmgr->notifypeers, &zmgr->notifypipeline,
+			 &addr, &entries[0], mainloop, entry_cb, &entries[0]);
+	assert_true(entries[0].canceled);
+	assert_null(entries[0].peer);
+	assert_int_equal(isc_hashmap_count(zmgr->notifypeers), 0);
+
+	dns_zonemgr_shutdown(zmgr);
+	dns_zonemgr_detach(&zmgr);
+
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+static dns_zonemgr_t *racezmgr = NULL;
+static dns_zonepeer_entry_t raceentries[2][NRACE];
+static atomic_size_t nqueued;
+static atomic_size_t nraced;
+
+/* Every entry is sent or canceled, and the zone manager can go away */
+static void
+race_cb(void *arg) {
+	dns_zonepeer_entry_t *entry = arg;
+
+	if (entry->peer != NULL) {
+		zonepeer_release(&entry->peer);
+	}
+	if (atomic_fetch_add(&nraced, 1) + 1 < 2 * NRACE) {
+		return;
+	}
+
+	dns_zonemgr_shutdown(racezmgr);
+	dns_zonemgr_detach(&racezmgr);
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+/*
+ * Queue the entries of one of the peer tables while the pipelining is
+ * being turned off.
+ */
+static void *
+race_enqueue(void *arg) {
+	dns_zonepeer_entry_t *raceentry = arg;
+	isc_sockaddr_t addr;
+	struct in_addr in = { .s_addr = htonl(INADDR_LOOPBACK) };
+
+	isc_sockaddr_fromin(&addr, &in, 53);
+	for (size_t i = 0; i < NRACE; i++) {
+		if (raceentry == raceentries[0]) {
+			zonepeer_enqueue(racezmgr, racezmgr->notifypeers,
+					 &racezmgr->notifypipeline, &addr,
+					 &raceentry[i], mainloop, race_cb,
+					 &raceentry[i]);
+		} else {
+			zonepeer_enqueue(racezmgr, racezmgr->refreshpeers,
+					 &racezmgr->serialquerypipeline, &addr,
+					 &raceentry[i], mainloop, race_cb,
+					 &raceentry[i]);
+		}
+		atomic_fetch_add(&nqueued, 1);
+	}
+
+	return (NULL);
+}
+
+static void
+check_queues(isc_hashmap_t *peers) {
+	isc_result_t result;
+	isc_hashmap_iter_t *it = NULL;
+
+	isc_hashmap_iter_create(peers, &it);
+	for (result = isc_hashmap_iter_first(it); result == ISC_R_SUCCESS;
+	     result = isc_hashmap_iter_next(it))
+	{
+		dns_zonepeer_t *peer = NULL;
+
+		isc_hashmap_iter_current(it, (void **)&peer);
+		assert_int_equal(peer->queued, 0);
+	}
+	isc_hashmap_iter_destroy(&it);
+}
+
+/* Nothing is left queued when the pipelining is turned off meanwhile */
+ISC_LOOP_TEST_IMPL(zonepeer_shutdown) {
+	isc_thread_t threads[2];
+
+	UNUSED(arg);
+
+	memset(raceentries, 0, sizeof(raceentries));
+	atomic_init(&nqueued, 0);
+	atomic_init(&nraced, 0);
+
+	dns_zonemgr_create(mctx, netmgr, &racezmgr);
+	dns_zonemgr_setnotifypipeline(racezmgr, DEPTH);
+	dns_zonemgr_setserialquerypipeline(racezmgr, DEPTH);
+
+	for (size_t i = 0; i < ARRAY_SIZE(threads); i++) {
+		isc_thread_create(race_enqueue, raceentries[i], &threads[i]);
+	}
+	while (atomic_load(&nqueued) < NRACE / 2) {
+		sched_yield();
+	}
+	zonepeers_setdepth(racezmgr, racezmgr->notifypeers,
+			   &racezmgr->notifypipeline, 0);
+	zonepeers_setdepth(racezmgr, racezmgr->refreshpeers,
+			   &racezmgr->serialquerypipeline, 0);
+	for (size_t i = 0; i < ARRAY_SIZE(threads); i++) {
+		isc_thread_join(threads[i], NULL);
+	}
+
+	check_queues(racezmgr->notifypeers);
+	check_queues(racezmgr->refreshpeers);
+
+	/* the callbacks run on this loop and finish the test */
+}
+
+ISC_TEST_LIST_START
+ISC_TEST_ENTRY_CUSTOM(zonepeer_window, setup_test, teardown_test)
+ISC_TEST_ENTRY_CUSTOM(zonepeer_retry, setup_test, teardown_test)
+ISC_TEST_ENTRY_CUSTOM(zonepeer_disabled, setup_test, teardown_test)
+ISC_TEST_ENTRY_CUSTOM(zonepeer_shutdown, setup_test, teardown_test)
+ISC_TEST_LIST_END
+
+ISC_TEST_MAIN
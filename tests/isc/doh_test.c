@@ -1113,6 +1113,167 @@ ISC_LOOP_TEST_IMPL(doh_recv_send_GET_TLS_quota) {
 	doh_recv_send(arg);
 }
 
+/*
+ * Several streams are in flight on a single session at a time, in
+ * rounds, so the server-side stream objects of a round are reused by
+ * the next one.  Every message is different and has to come back on
+ * the stream it was sent on.
+ */
+#define NSTREAMS 8
+#define NROUNDS	 4
+
+static uint64_t stream_msgs[NSTREAMS];
+static isc_nmsocket_h2_t *stream_h2s[NSTREAMS * NROUNDS];
+static atomic_int_fast64_t streams_reused = 0;
+
+static void
+doh_streams_request_cb(isc_nmhandle_t *handle, isc_result_t eresult,
+		       isc_region_t *region, void *cbarg) {
+	int_fast64_t n;
+
+	UNUSED(cbarg);
+
+	if (eresult != ISC_R_SUCCESS) {
+		return;
+	}
+
+	assert_int_equal(region->length, sizeof(stream_msgs[0]));
+
+	n = atomic_fetch_add(&sreads, 1);
+	INSIST(n < NSTREAMS * NROUNDS);
+	for (int_fast64_t i = 0; i < n - n % NSTREAMS; i++) {
+		if (stream_h2s[i] == handle->sock->h2) {
+			atomic_fetch_add(&streams_reused, 1);
+			break;
+		}
+	}
+	stream_h2s[n] = handle->sock->h2;
+
+	isc_nm_send(handle, region, doh_reply_sent_cb, NULL);
+}
+
+static void
+doh_streams_send(isc_nmhandle_t *handle);
+
+static void
+doh_streams_reply_cb(isc_nmhandle_t *handle, isc_result_t eresult,
+		     isc_region_t *region, void *cbarg) {
+	uint64_t *msg = cbarg;
+	int_fast64_t n;
+
+	assert_int_equal(eresult, ISC_R_SUCCESS);
+	assert_int_equal(region->length, sizeof(*msg));
+	assert_memory_equal(region->base, msg, sizeof(*msg));
+
+	n = atomic_fetch_add(&creads, 1) + 1;
+	if (n == NSTREAMS * NROUNDS) {
+		isc_loopmgr_shutdown(loopmgr);
+	} else if (n % NSTREAMS == 0) {
+		doh_streams_send(handle);
+	}
+}
+
+static void
+doh_streams_send(isc_nmhandle_t *handle) {
+	for (size_t i = 0; i < NSTREAMS; i++) {
+		isc_result_t result = isc__nm_http_request(
+			handle,
+			&(isc_region_t){ .base = (uint8_t *)&stream_msgs[i],
+					 .length = sizeof(stream_msgs[i]) },
+			doh_streams_reply_cb, &stream_msgs[i]);
+		assert_int_equal(result, ISC_R_SUCCESS);
+		atomic_fetch_add(&csends, 1);
+	}
+}
+
+static void
+doh_streams_connect_cb(isc_nmhandle_t *handle, isc_result_t result,
+		       void *arg) {
+	UNUSED(arg);
+
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	doh_streams_send(handle);
+}
+
+static void
+doh_recv_streams(void *arg ISC_ATTR_UNUSED) {
+	isc_nm_t *listen_nm = nm[0];
+	isc_nm_t *connect_nm = nm[1];
+	isc_result_t result = ISC_R_SUCCESS;
+	isc_nmsocket_t *listen_sock = NULL;
+	char req_url[256];
+	isc_tlsctx_t *ctx = NULL;
+
+	for (size_t i = 0; i < NSTREAMS; i++) {
+		stream_msgs[i] = send_magic + i;
+	}
+	memset(stream_h2s, 0, sizeof(stream_h2s));
+	atomic_store(&streams_reused, 0);
+
+	result = isc_nm_http_endpoints_add(endpoints, ISC_NM_HTTP_DEFAULT_PATH,
+					   doh_streams_request_cb, NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	result = isc_nm_listenhttp(
+		listen_nm, ISC_NM_LISTEN_ALL, &tcp_listen_addr, 0, NULL,
+		atomic_load(&use_TLS) ? server_tlsctx : NULL, endpoints, 0,
+		get_proxy_type(), &listen_sock);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	sockaddr_to_url(&tcp_listen_addr, atomic_load(&use_TLS), req_url,
+			sizeof(req_url), ISC_NM_HTTP_DEFAULT_PATH);
+
+	if (atomic_load(&use_TLS)) {
+		ctx = client_tlsctx;
+	}
+
+	isc_nm_httpconnect(connect_nm, NULL, &tcp_listen_addr, req_url,
+			   atomic_load(&POST), doh_streams_connect_cb, NULL,
+			   ctx, client_sess_cache, 5000, get_proxy_type(),
+			   NULL);
+
+	isc_loop_teardown(mainloop, listen_sock_close, listen_sock);
+}
+
+static int
+doh_recv_streams_teardown(void **state) {
+	X(csends);
+	X(creads);
+	X(sreads);
+	X(ssends);
+	X(streams_reused);
+
+	assert_int_equal(atomic_load(&csends), NSTREAMS * NROUNDS);
+	assert_int_equal(atomic_load(&creads), NSTREAMS * NROUNDS);
+	assert_int_equal(atomic_load(&sreads), NSTREAMS * NROUNDS);
+	assert_true(atomic_load(&streams_reused) > 0);
+
+	return (teardown_test(state));
+}
+
+ISC_LOOP_TEST_IMPL(doh_recv_streams_POST) {
+	atomic_store(&POST, true);
+	doh_recv_streams(arg);
+}
+
+ISC_LOOP_TEST_IMPL(doh_recv_streams_GET) {
+	atomic_store(&POST, false);
+	doh_recv_streams(arg);
+}
+
+ISC_LOOP_TEST_IMPL(doh_recv_streams_POST_TLS) {
+	atomic_store(&use_TLS, true);
+	atomic_store(&POST, true);
+	doh_recv_streams(arg);
+}
+
+ISC_LOOP_TEST_IMPL(doh_recv_streams_GET_TLS) {
+	atomic_store(&use_TLS, true);
+	atomic_store(&POST, false);
+	doh_recv_streams(arg);
+}
+
 static int
 doh_bad_connect_uri_teardown(void **state) {
 	X(total_sends);
@@ -2156,6 +2317,14 @@ ISC_TEST_ENTRY_CUSTOM(doh_recv_send_GET_TLS_quota, setup_test,
 		      doh_recv_send_teardown)
 ISC_TEST_ENTRY_CUSTOM(doh_recv_send_POST_TLS_quota, setup_test,
 		      doh_recv_send_teardown)
+ISC_TEST_ENTRY_CUSTOM(doh_recv_streams_POST, setup_test,
+		      doh_recv_streams_teardown)
+ISC_TEST_ENTRY_CUSTOM(doh_recv_streams_GET, setup_test,
+		      doh_recv_streams_teardown)
+ISC_TEST_ENTRY_CUSTOM(doh_recv_streams_POST_TLS, setup_test,
+		      doh_recv_streams_teardown)
+ISC_TEST_ENTRY_CUSTOM(doh_recv_streams_GET_TLS, setup_test,
+		      doh_recv_streams_teardown)
 ISC_TEST_ENTRY_CUSTOM(doh_bad_connect_uri, setup_test,
 		      doh_bad_connect_uri_teardown)
 /* PROXY */
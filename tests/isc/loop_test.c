@@ -25,10 +25,12 @@
 #include <cmocka.h>
 
 #include <isc/atomic.h>
+#include <isc/helper.h>
 #include <isc/loop.h>
 #include <isc/os.h>
 #include <isc/result.h>
 #include <isc/util.h>
+#include <isc/work.h>
 
 #include "loop.c"
 
@@ -130,12 +132,81 @@ ISC_RUN_TEST_IMPL(isc_loopmgr_sigterm) {
 	isc_loopmgr_run(loopmgr);
 }
 
+static atomic_size_t loopcpus = 0;
+static atomic_size_t helpercpus = 0;
+static atomic_size_t workcpus = 0;
+
+static int
+setup_pinned(void **state) {
+	isc_loopmgr_setaffinity(isc_loopaffinity_cpu);
+	setup_loopmgr(state);
+	isc_loopmgr_setaffinity(isc_loopaffinity_none);
+
+	return (0);
+}
+
+static void
+pinned_done(void *arg) {
+	UNUSED(arg);
+
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+static void
+pinned_helper(void *arg) {
+	UNUSED(arg);
+
+	atomic_store(&helpercpus, isc_os_cpulist(NULL, 0));
+
+	isc_async_run(mainloop, pinned_done, NULL);
+}
+
+static void
+pinned_work(void *arg) {
+	UNUSED(arg);
+
+	atomic_store(&workcpus, isc_os_cpulist(NULL, 0));
+}
+
+static void
+pinned_worked(void *arg) {
+	UNUSED(arg);
+
+	isc_helper_run(mainloop, pinned_helper, NULL);
+}
+
+static void
+pinned_loop(void *arg) {
+	UNUSED(arg);
+
+	atomic_store(&loopcpus, isc_os_cpulist(NULL, 0));
+
+	isc_work_enqueue(mainloop, pinned_work, pinned_worked, NULL);
+}
+
+/*
+ * only the loops are pinned, the helpers and the work pool can run on
+ * any CPU, and so can this thread once the loops are done
+ */
+ISC_RUN_TEST_IMPL(isc_loopmgr_affinity) {
+	size_t ncpus = isc_os_cpulist(NULL, 0);
+
+	isc_loop_setup(mainloop, pinned_loop, NULL);
+	isc_loopmgr_run(loopmgr);
+
+	assert_int_equal(atomic_load(&loopcpus), 1);
+	assert_int_equal(atomic_load(&helpercpus), ncpus);
+	assert_int_equal(atomic_load(&workcpus), ncpus);
+	assert_int_equal(isc_os_cpulist(NULL, 0), ncpus);
+}
+
 ISC_TEST_LIST_START
 ISC_TEST_ENTRY_CUSTOM(isc_loopmgr, setup_loopmgr, teardown_loopmgr)
 ISC_TEST_ENTRY_CUSTOM(isc_loopmgr_pause, setup_loopmgr, teardown_loopmgr)
 ISC_TEST_ENTRY_CUSTOM(isc_loopmgr_runjob, setup_loopmgr, teardown_loopmgr)
 ISC_TEST_ENTRY_CUSTOM(isc_loopmgr_sigint, setup_loopmgr, teardown_loopmgr)
 ISC_TEST_ENTRY_CUSTOM(isc_loopmgr_sigterm, setup_loopmgr, teardown_loopmgr)
+ISC_TEST_ENTRY_CUSTOM(isc_loopmgr_affinity, setup_pinned, teardown_loopmgr)
 ISC_TEST_LIST_END
 
 ISC_TEST_MAIN
@@ -36,6 +36,7 @@
 #include <isc/quota.h>
 #include <isc/refcount.h>
 #include <isc/sockaddr.h>
+#include <isc/timer.h>
 #include <isc/util.h>
 #include <isc/uv.h>
 
@@ -127,6 +128,192 @@ ISC_LOOP_TEST_IMPL(tcpdns_recv_send) {
 	}
 }
 
+/*
+ * The client pipelines more messages than the server is allowed to
+ * process at a time.  The server holds on to the messages it gets, so
+ * the connection must stop being read once the pipelining depth is
+ * reached, and resume once the responses have been sent.
+ */
+#define PIPELINE_DEPTH 4
+#define PIPELINE_NMSGS (3 * PIPELINE_DEPTH)
+
+static isc_nmhandle_t *pipeline_held[PIPELINE_DEPTH];
+static size_t pipeline_nheld = 0;
+static size_t pipeline_pauses = 0;
+static isc_timer_t *pipeline_timer = NULL;
+static atomic_uint_fast32_t pipeline_replies = 0;
+
+static void
+pipeline_send_cb(isc_nmhandle_t *handle, isc_result_t eresult, void *cbarg) {
+	UNUSED(eresult);
+	UNUSED(cbarg);
+
+	isc_nmhandle_detach(&handle);
+}
+
+static void
+pipeline_release(void *arg) {
+	UNUSED(arg);
+
+	isc_timer_destroy(&pipeline_timer);
+
+	/* Nothing has been read while the server was busy */
+	assert_int_equal(pipeline_nheld, PIPELINE_DEPTH);
+
+	pipeline_nheld = 0;
+	for (size_t i = 0; i < PIPELINE_DEPTH; i++) {
+		isc_nmhandle_t *handle = pipeline_held[i];
+
+		pipeline_held[i] = NULL;
+		isc_nm_send(handle, &send_msg, pipeline_send_cb, NULL);
+	}
+}
+
+static void
+pipeline_read_cb(isc_nmhandle_t *handle, isc_result_t eresult,
+		 isc_region_t *region, void *cbarg) {
+	size_t depth;
+
+	UNUSED(region);
+	UNUSED(cbarg);
+
+	if (eresult != ISC_R_SUCCESS) {
+		return;
+	}
+
+	atomic_fetch_add(&sreads, 1);
+
+	assert_true(pipeline_nheld < PIPELINE_DEPTH);
+	depth = isc_nm_pipelinedepth(handle);
+	assert_true(depth > pipeline_nheld && depth <= PIPELINE_DEPTH);
+
+	isc_nmhandle_attach(handle, &pipeline_held[pipeline_nheld++]);
+	if (pipeline_nheld == PIPELINE_DEPTH) {
+		isc_interval_t interval;
+
+		pipeline_pauses++;
+		isc_interval_set(&interval, 0, 100000000);
+		isc_timer_create(isc_loop(), pipeline_release, NULL,
+				 &pipeline_timer);
+		isc_timer_start(pipeline_timer, isc_timertype_once, &interval);
+	}
+}
+
+static void
+pipeline_reply_cb(isc_nmhandle_t *handle, isc_result_t eresult,
+		  isc_region_t *region, void *cbarg) {
+	UNUSED(region);
+	UNUSED(cbarg);
+
+	assert_int_equal(eresult, ISC_R_SUCCESS);
+
+	if (atomic_fetch_add(&pipeline_replies, 1) + 1 == PIPELINE_NMSGS) {
+		isc_loopmgr_shutdown(loopmgr);
+		return;
+	}
+
+	isc_nm_read(handle, pipeline_reply_cb, NULL);
+}
+
+static void
+pipeline_csend_cb(isc_nmhandle_t *handle, isc_result_t eresult,
+		  void *cbarg) {
+	UNUSED(cbarg);
+
+	if (eresult == ISC_R_SUCCESS) {
+		atomic_fetch_add(&csends, 1);
+	}
+	isc_nmhandle_detach(&handle);
+}
+
+static void
+pipeline_connect_cb(isc_nmhandle_t *handle, isc_result_t eresult,
+		    void *cbarg) {
+	UNUSED(cbarg);
+
+	assert_int_equal(eresult, ISC_R_SUCCESS);
+
+	isc_nm_read(handle, pipeline_reply_cb, NULL);
+
+	for (size_t i = 0; i < PIPELINE_NMSGS; i++) {
+		isc_nmhandle_t *sendhandle = NULL;
+
+		isc_nmhandle_attach(handle, &sendhandle);
+		isc_nm_send(sendhandle, &send_msg, pipeline_csend_cb, NULL);
+	}
+}
+
+static int
+tcpdns_pipeline_setup(void **state) {
+	pipeline_nheld = 0;
+	pipeline_pauses = 0;
+	atomic_store(&pipeline_replies, 0);
+
+	return (setup_netmgr_test(state));
+}
+
+static int
+tcpdns_pipeline_teardown(void **state) {
+	X(csends);
+	X(sreads);
+	X(pipeline_replies);
+
+	assert_int_equal(atomic_load(&csends), PIPELINE_NMSGS);
+	assert_int_equal(atomic_load(&sreads), PIPELINE_NMSGS);
+	assert_int_equal(atomic_load(&pipeline_replies), PIPELINE_NMSGS);
+	assert_int_equal(pipeline_pauses, PIPELINE_NMSGS / PIPELINE_DEPTH);
+
+	return (teardown_netmgr_test(state));
+}
+
+ISC_LOOP_TEST_IMPL(tcpdns_pipeline) {
+	isc_nm_setpipelinedepth(listen_nm, PIPELINE_DEPTH);
+	start_listening(ISC_NM_LISTEN_ONE, noop_accept_cb, pipeline_read_cb);
+
+	isc_nm_streamdnsconnect(connect_nm, &tcp_connect_addr, &tcp_listen_addr,
+				pipeline_connect_cb, NULL, T_CONNECT, NULL,
+				NULL, get_proxy_type(), NULL);
+}
+
+/*
+ * By default, the handles of a connection are limited as they were
+ * before the pipelining depth could be set: the messages processed at
+ * the same time and the handle used for reading make 23.
+ */
+static isc_result_t
+pipeline_default_accept_cb(isc_nmhandle_t *handle, isc_result_t eresult,
+			   void *cbarg) {
+	UNUSED(cbarg);
+
+	if (eresult != ISC_R_SUCCESS) {
+		return (eresult);
+	}
+
+	assert_int_equal(handle->sock->active_handles_max,
+			 ISC_NETMGR_MAX_STREAM_CLIENTS_PER_CONN);
+	isc_loopmgr_shutdown(loopmgr);
+
+	return (ISC_R_SUCCESS);
+}
+
+static void
+pipeline_default_connect_cb(isc_nmhandle_t *handle, isc_result_t eresult,
+			    void *cbarg) {
+	UNUSED(handle);
+	UNUSED(eresult);
+	UNUSED(cbarg);
+}
+
+ISC_LOOP_TEST_IMPL(tcpdns_pipeline_default) {
+	assert_int_equal(isc_nm_getpipelinedepth(listen_nm), 22);
+	start_listening(ISC_NM_LISTEN_ONE, pipeline_default_accept_cb,
+			noop_recv_cb);
+
+	isc_nm_streamdnsconnect(connect_nm, &tcp_connect_addr, &tcp_listen_addr,
+				pipeline_default_connect_cb, NULL, T_CONNECT,
+				NULL, NULL, get_proxy_type(), NULL);
+}
+
 /* PROXY tests */
 
 ISC_LOOP_TEST_IMPL(proxy_tcpdns_noop) { loop_test_tcpdns_noop(arg); }
@@ -158,6 +345,10 @@ ISC_TEST_ENTRY_CUSTOM(tcpdns_recv_two, stream_recv_two_setup,
 		      stream_recv_two_teardown)
 ISC_TEST_ENTRY_CUSTOM(tcpdns_recv_send, stream_recv_send_setup,
 		      stream_recv_send_teardown)
+ISC_TEST_ENTRY_CUSTOM(tcpdns_pipeline, tcpdns_pipeline_setup,
+		      tcpdns_pipeline_teardown)
+ISC_TEST_ENTRY_CUSTOM(tcpdns_pipeline_default, setup_netmgr_test,
+		      teardown_netmgr_test)
 /* PROXY */
 
 ISC_TEST_ENTRY_CUSTOM(proxy_tcpdns_noop, proxystream_noop_setup,
@@ -0,0 +1,224 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+/* ! \file */
+
+#include <inttypes.h>
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <openssl/bio.h>
+#include <openssl/ssl.h>
+
+#include <isc/mem.h>
+#include <isc/tls.h>
+#include <isc/util.h>
+
+#include <tests/isc.h>
+
+static const char *sid_ctx[] = { "test", "dot", NULL };
+
+static isc_tlsctx_t *
+server_ctx(isc_tlsctx_ticketkeys_t *keys) {
+	isc_tlsctx_t *ctx = NULL;
+
+	assert_int_equal(isc_tlsctx_createserver(NULL, NULL, &ctx),
+			 ISC_R_SUCCESS);
+	isc_tlsctx_set_ticketkeys(ctx, keys, sid_ctx);
+
+	return (ctx);
+}
+
+/*
+ * Do one handshake in memory, offering 'session' if it is not NULL;
+ * return whether the session was resumed and store the session the
+ * client ends up with in '*sessionp'.
+ */
+static bool
+handshake(isc_tlsctx_t *sctx, isc_tlsctx_t *cctx, SSL_SESSION *session,
+	  SSL_SESSION **sessionp) {
+	isc_tls_t *server = isc_tls_create(sctx);
+	isc_tls_t *client = isc_tls_create(cctx);
+	BIO *sbio = NULL, *cbio = NULL;
+	bool sdone = false, cdone = false;
+	unsigned char byte;
+	bool resumed;
+
+	assert_non_null(server);
+	assert_non_null(client);
+	assert_int_equal(BIO_new_bio_pair(&sbio, 0, &cbio, 0), 1);
+	SSL_set_bio(server, sbio, sbio);
+	SSL_set_bio(client, cbio, cbio);
+	SSL_set_accept_state(server);
+	SSL_set_connect_state(client);
+
+	if (session != NULL) {
+		assert_int_equal(SSL_set_session(client, session), 1);
+	}
+
+	while (!sdone || !cdone) {
+		int rv;
+
+		if (!cdone) {
+			rv = SSL_do_handshake(client);
+			if (rv == 1) {
+				cdone = true;
+			} else {
+				assert_int_equal(SSL_get_error(client, rv),
+						 SSL_ERROR_WANT_READ);
+			}
+		}
+		if (!sdone) {
+			rv = SSL_do_handshake(server);
+			if (rv == 1) {
+				sdone = true;
+			} else {
+				assert_int_equal(SSL_get_error(server, rv),
+						 SSL_ERROR_WANT_READ);
+			}
+		}
+	}
+
+	/* TLS 1.3 delivers the session tickets after the handshake */
+	(void)SSL_read(client, &byte, sizeof(byte));
+
+	resumed = SSL_session_reused(client);
+	if (sessionp != NULL) {
+		*sessionp = SSL_get1_session(client);
+		assert_non_null(*sessionp);
+	}
+
+	isc_tls_free(&client);
+	isc_tls_free(&server);
+
+	return (resumed);
+}
+
+/* the tickets survive the replacement of the server context */
+ISC_RUN_TEST_IMPL(ticketkeys_reconfig) {
+	isc_tlsctx_ticketkeys_t *keys = NULL;
+	isc_tlsctx_ticketkeys_stats_t stats;
+	isc_tlsctx_t *sctx = NULL, *cctx = NULL;
+	SSL_SESSION *session = NULL;
+
+	isc_tlsctx_ticketkeys_create(mctx, 3600, &keys);
+	sctx = server_ctx(keys);
+	assert_int_equal(isc_tlsctx_createclient(&cctx), ISC_R_SUCCESS);
+
+	assert_false(handshake(sctx, cctx, NULL, &session));
+	assert_true(handshake(sctx, cctx, session, NULL));
+
+	isc_tlsctx_free(&sctx);
+	sctx = server_ctx(keys);
+	assert_true(handshake(sctx, cctx, session, NULL));
+
+	isc_tlsctx_ticketkeys_getstats(keys, &stats);
+	assert_true(stats.issued > 0);
+	assert_int_equal(stats.resumed, 2);
+	assert_int_equal(stats.renewed, 0);
+	assert_int_equal(stats.rejected, 0);
+	assert_int_equal(stats.rotations, 0);
+
+	SSL_SESSION_free(session);
+	isc_tlsctx_free(&cctx);
+	isc_tlsctx_free(&sctx);
+	isc_tlsctx_ticketkeys_detach(&keys);
+}
+
+/*
+ * after a rotation, the tickets issued with the previous keys are
+ * still accepted and renewed until the keys are retired
+ */
+ISC_RUN_TEST_IMPL(ticketkeys_rotate) {
+	isc_tlsctx_ticketkeys_t *keys = NULL;
+	isc_tlsctx_ticketkeys_stats_t stats;
+	isc_tlsctx_t *sctx = NULL, *cctx = NULL;
+	SSL_SESSION *session = NULL, *renewed = NULL;
+
+	isc_tlsctx_ticketkeys_create(mctx, 0, &keys);
+	sctx = server_ctx(keys);
+	assert_int_equal(isc_tlsctx_createclient(&cctx), ISC_R_SUCCESS);
+
+	assert_false(handshake(sctx, cctx, NULL, &session));
+
+	isc_tlsctx_ticketkeys_rotate(keys);
+	assert_true(handshake(sctx, cctx, session, &renewed));
+
+	isc_tlsctx_ticketkeys_getstats(keys, &stats);
+	assert_int_equal(stats.rotations, 1);
+	assert_int_equal(stats.resumed, 1);
+	assert_int_equal(stats.renewed, 1);
+
+	/* the current key and two older ones are kept */
+	isc_tlsctx_ticketkeys_rotate(keys);
+	assert_true(handshake(sctx, cctx, session, NULL));
+	isc_tlsctx_ticketkeys_rotate(keys);
+	assert_false(handshake(sctx, cctx, session, NULL));
+
+	isc_tlsctx_ticketkeys_getstats(keys, &stats);
+	assert_int_equal(stats.rotations, 3);
+	assert_int_equal(stats.rejected, 1);
+
+	/* the renewed ticket uses a key that is not retired yet */
+	assert_true(handshake(sctx, cctx, renewed, NULL));
+
+	SSL_SESSION_free(renewed);
+	SSL_SESSION_free(session);
+	isc_tlsctx_free(&cctx);
+	isc_tlsctx_free(&sctx);
+	isc_tlsctx_ticketkeys_detach(&keys);
+}
+
+/* replacing the keys of a context releases the previous ones */
+ISC_RUN_TEST_IMPL(ticketkeys_replace) {
+	isc_mem_t *kmctx = NULL;
+	isc_tlsctx_ticketkeys_t *keys1 = NULL, *keys2 = NULL;
+	isc_tlsctx_t *sctx = NULL, *cctx = NULL;
+	SSL_SESSION *session = NULL;
+
+	isc_mem_create(&kmctx);
+	isc_tlsctx_ticketkeys_create(kmctx, 3600, &keys1);
+	isc_tlsctx_ticketkeys_create(kmctx, 3600, &keys2);
+
+	sctx = server_ctx(keys1);
+	assert_int_equal(isc_tlsctx_createclient(&cctx), ISC_R_SUCCESS);
+	assert_false(handshake(sctx, cctx, NULL, &session));
+
+	/* the context only holds a reference to the new keys */
+	isc_tlsctx_set_ticketkeys(sctx, keys2, sid_ctx);
+	isc_tlsctx_ticketkeys_detach(&keys1);
+	assert_false(handshake(sctx, cctx, session, NULL));
+
+	isc_tlsctx_ticketkeys_detach(&keys2);
+	isc_tlsctx_free(&sctx);
+	assert_int_equal(isc_mem_inuse(kmctx), 0);
+
+	SSL_SESSION_free(session);
+	isc_tlsctx_free(&cctx);
+	isc_mem_destroy(&kmctx);
+}
+
+ISC_TEST_LIST_START
+ISC_TEST_ENTRY(ticketkeys_reconfig)
+ISC_TEST_ENTRY(ticketkeys_rotate)
+ISC_TEST_ENTRY(ticketkeys_replace)
+ISC_TEST_LIST_END
+
+ISC_TEST_MAIN
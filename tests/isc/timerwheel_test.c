@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <inttypes.h>
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/job.h>
+#include <isc/loop.h>
+#include <isc/time.h>
+#include <isc/timerwheel.h>
+#include <isc/util.h>
+
+#include "timerwheel.c"
+
+#include <tests/isc.h>
+
+#define TICK 10 /* milliseconds */
+
+typedef struct wtest {
+	isc_timerwheel_entry_t entry;
+	isc_time_t armed;
+	uint64_t interval; /* milliseconds */
+	int order;
+} wtest_t;
+
+static isc_timerwheel_t *wheel = NULL;
+static int fired = 0;
+static int expected = 0;
+
+static void
+wtest_arm(wtest_t *wt, uint64_t interval) {
+	isc_interval_t i;
+
+	isc_interval_set(&i, interval / MS_PER_SEC,
+			 (interval % MS_PER_SEC) * NS_PER_MS);
+
+	wt->armed = isc_loop_now(mainloop);
+	wt->interval = interval;
+	isc_timerwheel_arm(wheel, &wt->entry, &i);
+	assert_true(isc_timerwheel_armed(&wt->entry));
+}
+
+static void
+wtest_done(void) {
+	if (++fired == expected) {
+		isc_timerwheel_detach(&wheel);
+		isc_loopmgr_shutdown(loopmgr);
+	}
+}
+
+static void
+wtest_cb(void *arg) {
+	wtest_t *wt = arg;
+	isc_time_t now = isc_loop_now(mainloop);
+	uint64_t elapsed = isc_time_microdiff(&now, &wt->armed) / US_PER_MS;
+
+	/* Disarmed before being run, and never early */
+	assert_false(isc_timerwheel_armed(&wt->entry));
+	assert_true(elapsed >= wt->interval);
+
+	/* The timers fire in the order of their expiration */
+	assert_int_equal(wt->order, fired);
+
+	wtest_done();
+}
+
+static wtest_t wtests[8];
+
+ISC_LOOP_TEST_IMPL(timerwheel_order) {
+	/* More than a tick apart, so each of them expires on its own tick */
+	static const uint64_t intervals[] = { 0,   1,   30,  60,
+					      150, 400, 700, 1300 };
+
+	fired = 0;
+	expected = ARRAY_SIZE(intervals);
+
+	isc_timerwheel_create(mainloop, TICK, &wheel);
+
+	/* Arm them in the reverse order */
+	for (size_t i = ARRAY_SIZE(intervals); i-- > 0;) {
+		isc_timerwheel_entryinit(&wtests[i].entry, wtest_cb,
+					 &wtests[i]);
+		wtests[i].order = i;
+		wtest_arm(&wtests[i], intervals[i]);
+	}
+}
+
+static void
+canceled_cb(void *arg) {
+	UNUSED(arg);
+
+	fail_msg("canceled timer fired");
+}
+
+ISC_LOOP_TEST_IMPL(timerwheel_cancel) {
+	fired = 0;
+	expected = 2;
+
+	isc_timerwheel_create(mainloop, TICK, &wheel);
+
+	/* Canceled when armed to expire now, in a slot and cascading */
+	isc_timerwheel_entryinit(&wtests[0].entry, canceled_cb, NULL);
+	wtest_arm(&wtests[0], 0);
+	isc_timerwheel_entryinit(&wtests[1].entry, canceled_cb, NULL);
+	wtest_arm(&wtests[1], 50);
+	isc_timerwheel_entryinit(&wtests[2].entry, canceled_cb, NULL);
+	wtest_arm(&wtests[2], 900);
+
+	isc_timerwheel_cancel(&wtests[0].entry);
+	isc_timerwheel_cancel(&wtests[1].entry);
+	isc_timerwheel_cancel(&wtests[2].entry);
+	assert_false(isc_timerwheel_armed(&wtests[0].entry));
+	assert_false(isc_timerwheel_armed(&wtests[1].entry));
+	assert_false(isc_timerwheel_armed(&wtests[2].entry));
+
+	/* Cancelling a disarmed timer is a no-op */
+	isc_timerwheel_cancel(&wtests[2].entry);
+
+	isc_timerwheel_entryinit(&wtests[3].entry, wtest_cb, &wtests[3]);
+	wtests[3].order = 0;
+	wtest_arm(&wtests[3], 20);
+	isc_timerwheel_entryinit(&wtests[4].entry, wtest_cb, &wtests[4]);
+	wtests[4].order = 1;
+	wtest_arm(&wtests[4], 1000);
+}
+
+static void
+rearm_cb(void *arg) {
+	wtest_t *wt = arg;
+
+	/* Rearm once from the callback, then check the second expiration */
+	isc_timerwheel_entryinit(&wt->entry, wtest_cb, wt);
+	wtest_arm(wt, 30);
+}
+
+ISC_LOOP_TEST_IMPL(timerwheel_rearm) {
+	fired = 0;
+	expected = 2;
+
+	isc_timerwheel_create(mainloop, TICK, &wheel);
+
+	/* Rearmed to expire later */
+	isc_timerwheel_entryinit(&wtests[0].entry, wtest_cb, &wtests[0]);
+	wtests[0].order = 1;
+	wtest_arm(&wtests[0], 10);
+	wtest_arm(&wtests[0], 800);
+
+	/* Rearmed to expire sooner */
+	isc_timerwheel_entryinit(&wtests[1].entry, rearm_cb, &wtests[1]);
+	wtests[1].order = 0;
+	wtest_arm(&wtests[1], 2000);
+	wtest_arm(&wtests[1], 100);
+}
+
+static void
+stats_cb(void *arg) {
+	isc_timerwheel_stats_t stats;
+
+	UNUSED(arg);
+
+	isc_timerwheel_getstats(wheel, &stats);
+	assert_int_equal(stats.armed, 3);
+	assert_int_equal(stats.canceled, 1);
+	assert_int_equal(stats.fired, 1);
+	assert_int_equal(stats.batches, 1);
+
+	/* 1000 ticks away: placed on the second level, then cascaded */
+	assert_true(stats.cascaded >= 1);
+
+	isc_timerwheel_cancel(&wtests[1].entry);
+	isc_timerwheel_detach(&wheel);
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+ISC_LOOP_TEST_IMPL(timerwheel_stats) {
+	isc_interval_t interval;
+
+	isc_timerwheel_create(mainloop, 1, &wheel);
+
+	isc_interval_set(&interval, 1, 0);
+	isc_timerwheel_entryinit(&wtests[0].entry, stats_cb, NULL);
+	isc_timerwheel_arm(wheel, &wtests[0].entry, &interval);
+
+	isc_interval_set(&interval, 2, 0);
+	isc_timerwheel_entryinit(&wtests[1].entry, canceled_cb, NULL);
+	isc_timerwheel_arm(wheel, &wtests[1].entry, &interval);
+
+	isc_timerwheel_entryinit(&wtests[2].entry, canceled_cb, NULL);
+	isc_timerwheel_arm(wheel, &wtests[2].entry, NULL);
+	isc_timerwheel_cancel(&wtests[2].entry);
+}
+
+ISC_TEST_LIST_START
+
+ISC_TEST_ENTRY_CUSTOM(timerwheel_order, setup_loopmgr, teardown_loopmgr)
+ISC_TEST_ENTRY_CUSTOM(timerwheel_cancel, setup_loopmgr, teardown_loopmgr)
+ISC_TEST_ENTRY_CUSTOM(timerwheel_rearm, setup_loopmgr, teardown_loopmgr)
+ISC_TEST_ENTRY_CUSTOM(timerwheel_stats, setup_loopmgr, teardown_loopmgr)
+
+ISC_TEST_LIST_END
+
+ISC_TEST_MAIN
@@ -42,6 +42,7 @@
 #include "uv_wrap.h"
 #define KEEP_BEFORE
 
+#include "netmgr/tlsstream.c"
 #include "netmgr_common.h"
 
 #include <tests/isc.h>
@@ -91,6 +92,50 @@ ISC_LOOP_TEST_IMPL(tls_recv_send_sendback) {
 	stream_recv_send(arg);
 }
 
+/* kernel TLS */
+
+static int
+stream_recv_send_ktls_setup(void **state) {
+	int r = stream_recv_send_setup(state);
+
+	isc_tlsctx_enable_ktls(tcp_listen_tlsctx);
+
+	return (r);
+}
+
+static int
+stream_recv_send_nofileno_setup(void **state) {
+	WILL_RETURN(uv_fileno, UV_EBADF);
+
+	return (stream_recv_send_ktls_setup(state));
+}
+
+static int
+stream_recv_send_nofileno_teardown(void **state) {
+	RESET_RETURN;
+
+	return (stream_recv_send_teardown(state));
+}
+
+/*
+ * The server sends a KeyUpdate before it tries to hand the connection
+ * over to the kernel; the data must arrive whether or not the kernel
+ * takes it.
+ */
+ISC_LOOP_TEST_IMPL(tls_recv_send_ktls) {
+	allow_send_back = true;
+	stream_recv_send(arg);
+}
+
+/*
+ * The offload is refused after the KeyUpdate has been sent, so OpenSSL
+ * has to carry on with the updated keys.
+ */
+ISC_LOOP_TEST_IMPL(tls_recv_send_ktls_refused) {
+	allow_send_back = true;
+	stream_recv_send(arg);
+}
+
 /* TLS quota */
 
 ISC_LOOP_TEST_IMPL(tls_recv_one_quota) {
@@ -173,6 +218,13 @@ ISC_TEST_ENTRY_CUSTOM(tls_recv_send, stream_recv_send_setup,
 ISC_TEST_ENTRY_CUSTOM(tls_recv_send_sendback, stream_recv_send_setup,
 		      stream_recv_send_teardown)
 
+/* kernel TLS */
+ISC_TEST_ENTRY_CUSTOM(tls_recv_send_ktls, stream_recv_send_ktls_setup,
+		      stream_recv_send_teardown)
+ISC_TEST_ENTRY_CUSTOM(tls_recv_send_ktls_refused,
+		      stream_recv_send_nofileno_setup,
+		      stream_recv_send_nofileno_teardown)
+
 /* TLS quota */
 ISC_TEST_ENTRY_CUSTOM(tls_recv_one_quota, stream_recv_one_setup,
 		      stream_recv_one_teardown)
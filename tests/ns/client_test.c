@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) Internet Systems Consortium, Inc. ("ISC")
+ *
+ * SPDX-License-Identifier: MPL-2.0
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, you can obtain one at https://mozilla.org/MPL/2.0/.
+ *
+ * See the COPYRIGHT file distributed with this work for additional
+ * information regarding copyright ownership.
+ */
+
+#include <inttypes.h>
+#include <sched.h> /* IWYU pragma: keep */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UNIT_TESTING
+#include <cmocka.h>
+
+#include <isc/util.h>
+
+#include <dns/db.h>
+#include <dns/rdatalist.h>
+#include <dns/view.h>
+
+#include <ns/client.h>
+#include <ns/hooks.h>
+#include <ns/query.h>
+#include <ns/server.h>
+#include <ns/stats.h>
+
+#include <tests/ns.h>
+
+static uint64_t
+reqallocs(void) {
+	return (ns_stats_get_counter(sctx->nsstats, ns_statscounter_reqalloc));
+}
+
+/* the scratch memory is handed out in order and released at once */
+ISC_LOOP_TEST_IMPL(ns_client_scratchget) {
+	ns_client_t *client = NULL;
+	isc_nmhandle_t *handle = NULL;
+	unsigned char *p1 = NULL, *p2 = NULL, *p3 = NULL, *big = NULL;
+	uint64_t before = reqallocs();
+	isc_result_t result;
+	size_t inuse;
+
+	ns_test_getclient(NULL, false, &client);
+	client->state = NS_CLIENTSTATE_WORKING;
+
+	p1 = ns_client_scratchget(client, 1);
+	p2 = ns_client_scratchget(client, 10);
+	assert_int_equal((uintptr_t)p1 % 8, 0);
+	assert_ptr_equal(p2, p1 + 8);
+	assert_int_equal(client->nallocs, 1);
+
+	/* a larger request gets a block of its own */
+	big = ns_client_scratchget(client, 2 * NS_CLIENT_SCRATCH_BLOCK_SIZE);
+	memset(big, 0, 2 * NS_CLIENT_SCRATCH_BLOCK_SIZE);
+	assert_int_equal(client->nallocs, 2);
+
+	/* which is full, so the next one needs a new block */
+	p3 = ns_client_scratchget(client, 16);
+	assert_int_equal(client->nallocs, 3);
+
+	inuse = isc_mem_inuse(client->manager->mctx);
+	ns_client_endrequest(client);
+	assert_int_equal(client->nallocs, 0);
+	assert_int_equal(reqallocs(), before + 1);
+	assert_true(isc_mem_inuse(client->manager->mctx) <
+		    inuse - 2 * NS_CLIENT_SCRATCH_BLOCK_SIZE);
+
+	/* the last block of the standard size is kept and reused */
+	client->state = NS_CLIENTSTATE_WORKING;
+	assert_ptr_equal(ns_client_scratchget(client, 16), p3);
+	assert_int_equal(client->nallocs, 0);
+
+	ns_client_endrequest(client);
+	assert_int_equal(reqallocs(), before + 1);
+
+	/* the client is expected to be in a view when it is released */
+	result = dns_test_makeview("view", false, false, &client->view);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	handle = client->handle;
+	isc_nmhandle_detach(&client->handle);
+	isc_nmhandle_detach(&handle);
+
+	isc_loop_teardown(mainloop, shutdown_interfacemgr, NULL);
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+static void
+send_noop(isc_buffer_t *buffer) {
+	UNUSED(buffer);
+}
+
+/*
+ * Store an A RRset for 'owner' in the cache of 'view'.
+ */
+static void
+cache_a(dns_view_t *view, const char *owner, const char *address) {
+	dns_fixedname_t fname;
+	dns_dbnode_t *node = NULL;
+	dns_rdata_t rdata = DNS_RDATA_INIT;
+	dns_rdatalist_t rdatalist;
+	dns_rdataset_t rdataset;
+	unsigned char buf[4];
+	isc_result_t result;
+
+	dns_test_namefromstring(owner, &fname);
+	result = dns_test_rdatafromstring(&rdata, dns_rdataclass_in,
+					  dns_rdatatype_a, buf, sizeof(buf),
+					  address, false);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	dns_rdatalist_init(&rdatalist);
+	rdatalist.ttl = 300;
+	rdatalist.type = dns_rdatatype_a;
+	rdatalist.rdclass = dns_rdataclass_in;
+	ISC_LIST_APPEND(rdatalist.rdata, &rdata, link);
+
+	dns_rdataset_init(&rdataset);
+	dns_rdatalist_tordataset(&rdatalist, &rdataset);
+	rdataset.trust = dns_trust_answer;
+
+	result = dns_db_findnode(view->cachedb, dns_fixedname_name(&fname),
+				 true, &node);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	result = dns_db_addrdataset(view->cachedb, node, NULL, 0, &rdataset, 0,
+				    NULL);
+	assert_int_equal(result, ISC_R_SUCCESS);
+	dns_db_detachnode(view->cachedb, &node);
+	dns_rdataset_disassociate(&rdataset);
+}
+
+static ns_hookresult_t
+check_nallocs(void *arg, void *data, isc_result_t *resultp) {
+	query_ctx_t *qctx = arg;
+	bool *sent = data;
+
+	assert_int_equal(qctx->client->message->rcode, dns_rcode_noerror);
+	assert_false(ISC_LIST_EMPTY(
+		qctx->client->message->sections[DNS_SECTION_ANSWER]));
+	assert_int_equal(qctx->client->nallocs, 0);
+	*sent = true;
+
+	*resultp = ISC_R_UNSET;
+	return (NS_HOOK_CONTINUE);
+}
+
+/* an answer from the cache does not allocate per-request memory */
+ISC_LOOP_TEST_IMPL(ns_client_cachedanswer) {
+	query_ctx_t *qctx = NULL;
+	isc_result_t result;
+	bool sent = false;
+	uint64_t before = reqallocs();
+	const ns_hook_t hook = {
+		.action = check_nallocs,
+		.action_data = &sent,
+	};
+	const ns_test_qctx_create_params_t qctx_params = {
+		.qname = "cached.example",
+		.qtype = dns_rdatatype_a,
+		.qflags = DNS_MESSAGEFLAG_RD,
+		.with_cache = true,
+	};
+
+	ns_hooktable_create(mctx, &ns__hook_table);
+	ns_hook_add(ns__hook_table, mctx, NS_QUERY_DONE_SEND, &hook);
+
+	result = ns_test_qctx_create(&qctx_params, &qctx);
+	assert_int_equal(result, ISC_R_SUCCESS);
+
+	cache_a(qctx->client->view, "cached.example", "192.0.2.1");
+
+	isc_sockaddr_any(&qctx->client->peeraddr); /* for sortlist */
+	qctx->client->sendcb = send_noop;
+
+	/*
+	 * As if the client had answered a query before, so that it
+	 * already holds a block of scratch memory.
+	 */
+	(void)ns_client_scratchget(qctx->client, 1);
+	qctx->client->nallocs = 0;
+
+	isc_nmhandle_attach(qctx->client->handle, &qctx->client->reqhandle);
+	qctx->client->state = NS_CLIENTSTATE_WORKING;
+	ns__query_start(qctx);
+	assert_true(sent);
+
+	ns_test_qctx_destroy(&qctx);
+	ns_hooktable_free(mctx, (void **)&ns__hook_table);
+
+	assert_int_equal(reqallocs(), before);
+
+	isc_loop_teardown(mainloop, shutdown_interfacemgr, NULL);
+	isc_loopmgr_shutdown(loopmgr);
+}
+
+ISC_TEST_LIST_START
+ISC_TEST_ENTRY_CUSTOM(ns_client_scratchget, setup_server, teardown_server)
+ISC_TEST_ENTRY_CUSTOM(ns_client_cachedanswer, setup_server, teardown_server)
+ISC_TEST_LIST_END
+
+ISC_TEST_MAIN